@@ -0,0 +1,97 @@
+/*
+ * gcbvext.h
+ *
+ * Copyright (c) 2012,
+ * Texas Instruments, Inc. and Vivante Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Texas Instruments, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL TEXAS INSTRUMENTS, INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Entry points libbltsville_gc2d exports on top of the BLTsville API. Other
+ * implementations do not have them, so clients import them with dlsym() and
+ * fall back to bv_blt() when they are missing. Include bltsville.h first.
+ */
+
+#ifndef GCBVEXT_H
+#define GCBVEXT_H
+
+/* Forward declarations */
+struct bvbltparams;
+struct bvcallbackerror;
+struct bvrect;
+
+/*
+ * gcbvfill() - Solid fill of a list of rectangles with one command sequence.
+ * Takes the parameters of the equivalent single rectangle fill, with rects
+ * standing for dstrect; the rectangles are clipped to cliprect with
+ * BVFLAG_CLIP.
+ */
+enum bverror gcbvfill(struct bvbltparams *bltparams,
+		      unsigned int count,
+		      const struct bvrect *rects);
+
+typedef enum bverror (*BVFN_GCFILL)(struct bvbltparams *bltparams,
+				    unsigned int count,
+				    const struct bvrect *rects);
+
+/*
+ * gcbvfence_*() - Completion fences, for clients that poll(2) instead of
+ * taking callbacks. A fence is an eventfd counting completed asynchronous
+ * batches; a read returns the number of batches completed since the last
+ * one.
+ *
+ * gcbvfence_blt() submits bltparams as an asynchronous batch signalling
+ * *fence once it completes. A negative *fence is replaced by a new fence,
+ * which the client destroys; a fence may be reused for any number of
+ * batches. The call takes the place of bv_blt(), so bltparams->callbackfn
+ * has to be NULL; BVFLAG_BATCH_BEGIN and BVFLAG_BATCH_CONTINUE calls submit
+ * nothing and leave *fence alone.
+ *
+ * gcbvfence_signal() can also be passed as the callbackfn of a BVFLAG_ASYNC
+ * bv_blt() with the fence as its callbackdata.
+ */
+
+/* Returns the new fence, or a negative error code. */
+int gcbvfence_create(void);
+void gcbvfence_destroy(int fence);
+
+enum bverror gcbvfence_blt(struct bvbltparams *bltparams, int *fence);
+
+void gcbvfence_signal(struct bvcallbackerror *err, unsigned long callbackdata);
+
+/* Waits up to timeoutms (-1 for ever) for the fence. Returns the number of
+ * batches completed, 0 on timeout, or a negative error code. */
+int gcbvfence_wait(int fence, int timeoutms);
+
+typedef int (*BVFN_GCFENCE_CREATE)(void);
+typedef void (*BVFN_GCFENCE_DESTROY)(int fence);
+typedef enum bverror (*BVFN_GCFENCE_BLT)(struct bvbltparams *bltparams,
+					 int *fence);
+typedef void (*BVFN_GCFENCE_SIGNAL)(struct bvcallbackerror *err,
+				    unsigned long callbackdata);
+typedef int (*BVFN_GCFENCE_WAIT)(int fence, int timeoutms);
+
+#endif /* GCBVEXT_H */
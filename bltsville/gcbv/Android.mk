@@ -28,9 +28,10 @@
 #
 
 LOCAL_PATH:= $(call my-dir)
-include $(CLEAR_VARS)
-LOCAL_SRC_FILES := \
+
+GCBV_SRC_FILES := \
 	gcmain.c \
+	gccpu.c \
 	mirror/gcbv.c \
 	mirror/gcparser.c \
 	mirror/gcmap.c \
@@ -40,14 +41,19 @@ LOCAL_SRC_FILES := \
 	mirror/gcfilter.c \
 	mirror/gcdbglog.c
 
-LOCAL_CFLAGS :=
-
-LOCAL_C_INCLUDES := \
+GCBV_C_INCLUDES := \
 	$(LOCAL_PATH)/mirror \
 	$(LOCAL_PATH)/mirror/include \
 	$(LOCAL_PATH)/../bltsville/include \
 	$(LOCAL_PATH)/../ocd/include
 
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES := $(GCBV_SRC_FILES)
+
+LOCAL_CFLAGS :=
+
+LOCAL_C_INCLUDES := $(GCBV_C_INCLUDES)
+
 VERSION_H := $(LOCAL_PATH)/version.h
 BV_VERSION := $(shell grep "VER_FILEVERSION_STR" $(VERSION_H) | sed "s,.*\"\([0-9.]*\)\\\0.*,\1,")
 
@@ -83,3 +89,46 @@ ALL_DEFAULT_INSTALLED_MODULES += $(SYMLINKS) $(SYMLINKS1)
 # for mm/mmm
 all_modules: $(SYMLINKS) $(SYMLINKS1)
 
+# Host tools, built from bench/<tool>.c on top of the in-process emulator
+# (see gcemu.h), which only they link in:
+#   gcbvbench     measures the CPU cost of bv_blt; GCBV_EMULATE=2 also
+#                 checks copy and fill results.
+#   gcfiltergen   generates mirror/gcfilterpreset.h and checks the filter
+#                 kernel store against calculate_sync_filter; it includes
+#                 mirror/gcfilter.c itself.
+#   gccachebench  checks what gcbvcacheop maintains against the regions
+#                 asked for and counts the cache ioctls.
+#   gcfencebench  runs asynchronous batches and measures how their
+#                 completions reach the client.
+#   gccpubench    checks the CPU blitter against the emulator and times it
+#                 against the GPU path.
+#   gctempbench   alternates two pass scale blits of different sizes to
+#                 measure the temporary surface pool.
+#
+# gcbv-host-tool: $(1) tool name, $(2) default GCEMU_* mode, $(3) extra
+# CFLAGS, $(4) gcbv sources to leave out.
+define gcbv-host-tool
+include $$(CLEAR_VARS)
+LOCAL_SRC_FILES := \
+	$$(filter-out $(4),$$(GCBV_SRC_FILES)) \
+	gcemu.c \
+	bench/$(1).c
+
+LOCAL_CFLAGS := -DGCBV_EMULATOR=1 -DGCEMU_DEFAULT=$(2) $(3)
+
+LOCAL_C_INCLUDES := $$(GCBV_C_INCLUDES)
+
+LOCAL_LDLIBS := -lpthread
+
+LOCAL_MODULE_TAGS    := optional
+LOCAL_MODULE         := $(1)
+
+include $$(BUILD_HOST_EXECUTABLE)
+endef
+
+$(eval $(call gcbv-host-tool,gcbvbench,GCEMU_DECODE,-DGCBV_PROFILE=1,))
+$(eval $(call gcbv-host-tool,gcfiltergen,GCEMU_DECODE,,mirror/gcfilter.c))
+$(eval $(call gcbv-host-tool,gccachebench,GCEMU_DECODE,,))
+$(eval $(call gcbv-host-tool,gcfencebench,GCEMU_DECODE,,))
+$(eval $(call gcbv-host-tool,gccpubench,GCEMU_EXECUTE,,))
+$(eval $(call gcbv-host-tool,gctempbench,GCEMU_DECODE,,))
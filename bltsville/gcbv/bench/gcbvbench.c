@@ -0,0 +1,757 @@
+/*
+ * Copyright (c) 2012,
+ * Texas Instruments, Inc. and Vivante Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Texas Instruments, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL TEXAS INSTRUMENTS, INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * gcbvbench - measures the CPU cost of bv_blt on top of the in-process
+ * emulator.
+ *
+ * Usage: gcbvbench [-n iterations] [-w width] [-h height] [-i | -f]
+ *                  [-t threads] [test...]
+ *
+ * Runs each of the copy, fill, blend, scale, rotate, yuv, frame, tiles and
+ * tilelist tests (or the ones given) and prints, per bv_blt, the process
+ * CPU time, the wall time spent in the parse, map, build and commit phases
+ * (all in microseconds) and what was committed, including the GCIOCTL_MAP
+ * and GCIOCTL_UNMAP calls. Buffers are mapped once up front unless -i is
+ * given, in which case bv_blt maps them implicitly; -f also passes new
+ * descriptors of the same buffers to every bv_blt, the way hwc does every
+ * frame. The buffers are virtual, so their mappings are reused across
+ * bv_blt calls only with GCBV_MAPCACHE_VIRTUAL=1.
+ *
+ * The frame test copies the source in horizontal bands batched the way hwc
+ * batches its layers: one batch per frame, with only the rectangles changing
+ * between the blits. Its figures are per frame of FRAME_BANDS blits.
+ *
+ * The tiles test fills the destination as TILE_RECTS damaged tiles, one
+ * batched bv_blt per tile the way hwc clears them, and the tilelist test
+ * passes the same tiles to a single gcbvfill. Their figures are per fill
+ * of all the tiles.
+ *
+ * With GCBV_EMULATE=2 the copy and fill results are checked as well; the
+ * exit status is non zero if a bv_blt fails or a result is wrong.
+ *
+ * Small blits are kept off the CPU blitter, whatever GCBV_CPUBLIT says.
+ *
+ * -t runs each test on 1, 2, 4... up to the given number of threads at
+ * once, each doing the given number of iterations, and prints the blits
+ * per second of wall time and how long bv_blt waited for locks held by
+ * the other threads, per blit.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include "gcmain.h"
+#include "gcemu.h"
+#include "gccpu.h"
+
+struct bench_surface {
+	struct bvbuffdesc desc;
+	struct bvsurfgeom geom;
+};
+
+struct bench_test {
+	char *name;
+	void (*setup)(struct bvbltparams *params);
+	bool (*check)(struct bvbltparams *params);
+
+	/* Issues the blits of an iteration; a single bv_blt if NULL. */
+	enum bverror (*blt)(struct bvbltparams *params);
+};
+
+static unsigned int g_width = 640;
+static unsigned int g_height = 480;
+static bool g_implicit;
+static bool g_fresh;
+
+static struct bench_surface g_dst;
+static struct bench_surface g_src;
+static struct bench_surface g_half;
+static struct bench_surface g_rotated;
+static struct bench_surface g_yuv;
+static struct bench_surface g_solid;
+
+static unsigned int g_solidcolor = 0xFF204080;
+
+static bool surface_alloc(struct bench_surface *surface,
+			  enum ocdformat format, unsigned int width,
+			  unsigned int height, unsigned int bpp)
+{
+	unsigned int i;
+
+	memset(surface, 0, sizeof(*surface));
+
+	surface->geom.structsize = sizeof(struct bvsurfgeom);
+	surface->geom.format = format;
+	surface->geom.width = width;
+	surface->geom.height = height;
+	surface->geom.virtstride = ((width * bpp / 8) + 63) & ~63;
+
+	/* Planar formats keep their chroma below the luma plane. */
+	surface->desc.structsize = sizeof(struct bvbuffdesc);
+	surface->desc.length = surface->geom.virtstride * height;
+	if (format == OCDFMT_NV12)
+		surface->desc.length = surface->desc.length * 3 / 2;
+
+	if (posix_memalign(&surface->desc.virtaddr, 4096,
+			   surface->desc.length) != 0)
+		return false;
+
+	for (i = 0; i < surface->desc.length / 4; i += 1)
+		((unsigned int *) surface->desc.virtaddr)[i] = i * 2654435761U;
+
+	return true;
+}
+
+static void surface_free(struct bench_surface *surface)
+{
+	free(surface->desc.virtaddr);
+	surface->desc.virtaddr = NULL;
+}
+
+static void set_rect(struct bvrect *rect, unsigned int width,
+		     unsigned int height)
+{
+	rect->left = 0;
+	rect->top = 0;
+	rect->width = width;
+	rect->height = height;
+}
+
+static unsigned int get_pixel(struct bench_surface *surface,
+			      unsigned int x, unsigned int y)
+{
+	unsigned char *row;
+
+	row = (unsigned char *) surface->desc.virtaddr
+	    + y * surface->geom.virtstride;
+
+	return ((unsigned int *) row)[x];
+}
+
+
+/*******************************************************************************
+ * Tests.
+ */
+
+static void setup_dst(struct bvbltparams *params)
+{
+	params->dstdesc = &g_dst.desc;
+	params->dstgeom = &g_dst.geom;
+	set_rect(&params->dstrect, g_width, g_height);
+}
+
+static void setup_copy(struct bvbltparams *params)
+{
+	setup_dst(params);
+
+	params->flags = BVFLAG_ROP;
+	params->op.rop = 0xCCCC;
+	params->src1.desc = &g_src.desc;
+	params->src1geom = &g_src.geom;
+	set_rect(&params->src1rect, g_width, g_height);
+}
+
+static bool check_copy(struct bvbltparams *params)
+{
+	unsigned int x, y;
+
+	for (y = 0; y < g_height; y += 1)
+		for (x = 0; x < g_width; x += 1)
+			if (get_pixel(&g_dst, x, y) != get_pixel(&g_src, x, y))
+				return false;
+
+	return true;
+}
+
+static void setup_fill(struct bvbltparams *params)
+{
+	setup_dst(params);
+
+	params->flags = BVFLAG_ROP;
+	params->op.rop = 0xCCCC;
+	params->src1.desc = &g_solid.desc;
+	params->src1geom = &g_solid.geom;
+	set_rect(&params->src1rect, 1, 1);
+}
+
+static bool check_fill(struct bvbltparams *params)
+{
+	unsigned int x, y;
+
+	for (y = 0; y < g_height; y += 1)
+		for (x = 0; x < g_width; x += 1)
+			if (get_pixel(&g_dst, x, y) != g_solidcolor)
+				return false;
+
+	return true;
+}
+
+static void setup_blend(struct bvbltparams *params)
+{
+	setup_dst(params);
+
+	params->flags = BVFLAG_BLEND;
+	params->op.blend = BVBLEND_SRC1OVER;
+	params->src1.desc = &g_src.desc;
+	params->src1geom = &g_src.geom;
+	set_rect(&params->src1rect, g_width, g_height);
+	params->src2.desc = &g_dst.desc;
+	params->src2geom = &g_dst.geom;
+	set_rect(&params->src2rect, g_width, g_height);
+}
+
+static void setup_scale(struct bvbltparams *params)
+{
+	setup_dst(params);
+
+	params->flags = BVFLAG_ROP;
+	params->op.rop = 0xCCCC;
+	params->scalemode = BVSCALE_FASTEST;
+	params->src1.desc = &g_half.desc;
+	params->src1geom = &g_half.geom;
+	set_rect(&params->src1rect, g_width / 2, g_height / 2);
+}
+
+static void setup_rotate(struct bvbltparams *params)
+{
+	setup_dst(params);
+
+	params->flags = BVFLAG_ROP;
+	params->op.rop = 0xCCCC;
+	params->src1.desc = &g_rotated.desc;
+	params->src1geom = &g_rotated.geom;
+	set_rect(&params->src1rect, g_width, g_height);
+}
+
+static void setup_yuv(struct bvbltparams *params)
+{
+	setup_dst(params);
+
+	params->flags = BVFLAG_ROP;
+	params->op.rop = 0xCCCC;
+	params->scalemode = BVSCALE_FASTEST;
+	params->src1.desc = &g_yuv.desc;
+	params->src1geom = &g_yuv.geom;
+	set_rect(&params->src1rect, g_width, g_height);
+}
+
+#define FRAME_BANDS 8
+
+static enum bverror blt_frame(struct bvbltparams *params)
+{
+	enum bverror bverror = BVERR_NONE;
+	unsigned int i, top;
+
+	for (i = 0; i < FRAME_BANDS; i += 1) {
+		top = g_height * i / FRAME_BANDS;
+		params->dstrect.top = top;
+		params->dstrect.height = g_height * (i + 1) / FRAME_BANDS - top;
+		params->src1rect = params->dstrect;
+
+		params->flags &= ~BVFLAG_BATCH_MASK;
+		if (i == 0)
+			params->flags |= BVFLAG_BATCH_BEGIN;
+		else if (i < FRAME_BANDS - 1)
+			params->flags |= BVFLAG_BATCH_CONTINUE;
+		else
+			params->flags |= BVFLAG_BATCH_END;
+
+		params->batchflags = BVBATCH_DSTRECT_ORIGIN |
+				     BVBATCH_DSTRECT_SIZE |
+				     BVBATCH_SRC1RECT_ORIGIN |
+				     BVBATCH_SRC1RECT_SIZE;
+
+		bverror = bv_blt(params);
+		if (bverror != BVERR_NONE)
+			break;
+	}
+
+	return bverror;
+}
+
+#define TILE_COLUMNS 8
+#define TILE_ROWS 4
+#define TILE_RECTS (TILE_COLUMNS * TILE_ROWS)
+
+/* Damaged tiles covering the destination. */
+static void get_tile_rect(struct bvrect *rect, unsigned int i)
+{
+	unsigned int x = i % TILE_COLUMNS, y = i / TILE_COLUMNS;
+
+	rect->left = g_width * x / TILE_COLUMNS;
+	rect->top = g_height * y / TILE_ROWS;
+	rect->width = g_width * (x + 1) / TILE_COLUMNS - rect->left;
+	rect->height = g_height * (y + 1) / TILE_ROWS - rect->top;
+}
+
+/* One fill per tile, batched. */
+static enum bverror blt_tiles(struct bvbltparams *params)
+{
+	enum bverror bverror = BVERR_NONE;
+	unsigned int i;
+
+	for (i = 0; i < TILE_RECTS; i += 1) {
+		get_tile_rect(&params->dstrect, i);
+
+		params->flags &= ~BVFLAG_BATCH_MASK;
+		if (i == 0)
+			params->flags |= BVFLAG_BATCH_BEGIN;
+		else if (i < TILE_RECTS - 1)
+			params->flags |= BVFLAG_BATCH_CONTINUE;
+		else
+			params->flags |= BVFLAG_BATCH_END;
+
+		params->batchflags = BVBATCH_DSTRECT_ORIGIN |
+				     BVBATCH_DSTRECT_SIZE;
+
+		bverror = bv_blt(params);
+		if (bverror != BVERR_NONE)
+			break;
+	}
+
+	return bverror;
+}
+
+/* All the tiles in one fill. */
+static enum bverror blt_tilelist(struct bvbltparams *params)
+{
+	struct bvrect rects[TILE_RECTS];
+	unsigned int i;
+
+	for (i = 0; i < TILE_RECTS; i += 1)
+		get_tile_rect(&rects[i], i);
+
+	return gcbvfill(params, TILE_RECTS, rects);
+}
+
+static struct bench_test g_tests[] = {
+	{ "copy", setup_copy, check_copy },
+	{ "fill", setup_fill, check_fill },
+	{ "blend", setup_blend, NULL },
+	{ "scale", setup_scale, NULL },
+	{ "rotate", setup_rotate, NULL },
+	{ "yuv", setup_yuv, NULL },
+	{ "frame", setup_copy, check_copy, blt_frame },
+	{ "tiles", setup_fill, check_fill, blt_tiles },
+	{ "tilelist", setup_fill, check_fill, blt_tilelist },
+};
+
+#define TEST_COUNT (sizeof(g_tests) / sizeof(g_tests[0]))
+
+
+/*******************************************************************************
+ * Driver.
+ */
+
+static struct bench_surface *g_surfaces[] = {
+	&g_dst, &g_src, &g_half, &g_rotated, &g_yuv, &g_solid
+};
+
+#define SURFACE_COUNT (sizeof(g_surfaces) / sizeof(g_surfaces[0]))
+
+static bool surfaces_init(void)
+{
+	unsigned int i;
+
+	if (!surface_alloc(&g_dst, OCDFMT_RGBA24, g_width, g_height, 32) ||
+	    !surface_alloc(&g_src, OCDFMT_RGBA24, g_width, g_height, 32) ||
+	    !surface_alloc(&g_half, OCDFMT_RGBA24,
+			   g_width / 2, g_height / 2, 32) ||
+	    !surface_alloc(&g_rotated, OCDFMT_RGBA24, g_height, g_width, 32) ||
+	    !surface_alloc(&g_yuv, OCDFMT_NV12, g_width, g_height, 8) ||
+	    !surface_alloc(&g_solid, OCDFMT_RGBA24, 1, 1, 32))
+		return false;
+
+	/* Geometries describe the rotated view; the buffer itself is
+	 * allocated portrait. */
+	g_rotated.geom.orientation = 90;
+	g_rotated.geom.width = g_width;
+	g_rotated.geom.height = g_height;
+
+	*(unsigned int *) g_solid.desc.virtaddr = g_solidcolor;
+
+	if (g_implicit)
+		return true;
+
+	for (i = 0; i < SURFACE_COUNT; i += 1)
+		if (bv_map(&g_surfaces[i]->desc) != BVERR_NONE)
+			return false;
+
+	return true;
+}
+
+static void surfaces_exit(void)
+{
+	unsigned int i;
+
+	/* Implicitly mapped buffers are unmapped as well, so that gcbv
+	 * drops its cached mappings before the memory is freed. */
+	for (i = 0; i < SURFACE_COUNT; i += 1) {
+		if (g_surfaces[i]->desc.virtaddr != NULL)
+			bv_unmap(&g_surfaces[i]->desc);
+		surface_free(g_surfaces[i]);
+	}
+}
+
+static enum bverror run_blt(struct bench_test *test,
+			    struct bvbltparams *params)
+{
+	return test->blt ? test->blt(params) : bv_blt(params);
+}
+
+static double get_cputime(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Points the bv_blt at new, unmapped descriptors of the same buffers. */
+static void renew_descs(struct bvbltparams *params,
+			struct bvbuffdesc *descs[3],
+			struct bvbuffdesc fresh[3])
+{
+	unsigned int i;
+
+	for (i = 0; i < 3; i += 1) {
+		if (descs[i] == NULL)
+			continue;
+
+		fresh[i] = *descs[i];
+		fresh[i].map = NULL;
+	}
+
+	params->dstdesc = &fresh[0];
+	if (descs[1] != NULL)
+		params->src1.desc = &fresh[1];
+	if (descs[2] != NULL)
+		params->src2.desc = &fresh[2];
+}
+
+static bool run_test(struct bench_test *test, unsigned int iterations,
+		     bool execute)
+{
+	struct bvbltparams params;
+	struct bvbuffdesc *descs[3];
+	struct bvbuffdesc fresh[3];
+	struct gcemustats stats;
+	unsigned long long phase[GCPROF_PHASE_COUNT];
+	enum bverror bverror;
+	double start, elapsed;
+	unsigned int i, ops;
+	bool ok = true;
+
+	memset(&params, 0, sizeof(params));
+	params.structsize = sizeof(params);
+	test->setup(&params);
+
+	descs[0] = params.dstdesc;
+	descs[1] = params.src1.desc;
+	descs[2] = params.src2.desc;
+
+	/* Warm up, and verify the result with a clean destination. */
+	memset(g_dst.desc.virtaddr, 0, g_dst.desc.length);
+	if (g_fresh)
+		renew_descs(&params, descs, fresh);
+	bverror = run_blt(test, &params);
+	if (bverror != BVERR_NONE) {
+		printf("%-8s bv_blt failed (0x%08X): %s\n", test->name,
+		       bverror, params.errdesc ? params.errdesc : "");
+		return false;
+	}
+
+	gcemu_getstats(&stats, true);
+	if (execute && (test->check != NULL) && (stats.skipped == 0)) {
+		ok = test->check(&params);
+		if (!ok)
+			printf("%-8s wrong result\n", test->name);
+	}
+
+	gcprof_read(phase, true);
+	start = get_cputime();
+
+	for (i = 0; i < iterations; i += 1) {
+		if (g_fresh)
+			renew_descs(&params, descs, fresh);
+		bverror = run_blt(test, &params);
+		if (bverror != BVERR_NONE) {
+			printf("%-8s bv_blt failed (0x%08X): %s\n",
+			       test->name, bverror,
+			       params.errdesc ? params.errdesc : "");
+			return false;
+		}
+	}
+
+	elapsed = get_cputime() - start;
+	gcprof_read(phase, true);
+	gcemu_getstats(&stats, true);
+
+	for (ops = 0, i = 0; i < 16; i += 1)
+		ops += stats.ops[i];
+
+	for (i = 0; i < 4; i += 1)
+		ops += stats.filterpasses[i];
+
+	printf("%-8s %8.2f %8.2f %8.2f %8.2f %8.2f %6.2f %6.2f %8llu %6u %8llu",
+	       test->name, elapsed / iterations,
+	       phase[GCPROF_PARSE] / 1e3 / iterations,
+	       phase[GCPROF_MAP] / 1e3 / iterations,
+	       phase[GCPROF_BUILD] / 1e3 / iterations,
+	       phase[GCPROF_COMMIT] / 1e3 / iterations,
+	       (double) stats.maps / iterations,
+	       (double) stats.unmaps / iterations,
+	       stats.bytes / (stats.commits ? stats.commits : 1),
+	       ops / iterations,
+	       stats.pixels / iterations);
+
+	if (execute)
+		printf(" %u/%u", stats.executed, stats.executed + stats.skipped);
+
+	printf("\n");
+
+	return ok;
+}
+
+struct bench_thread {
+	pthread_t thread;
+	struct bench_test *test;
+	unsigned int iterations;
+	pthread_barrier_t *barrier;
+	unsigned long long lockwait;
+	unsigned int lockwaits;
+	bool ok;
+};
+
+static double get_walltime(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void *run_thread(void *arg)
+{
+	struct bench_thread *thread = arg;
+	struct bvbltparams params;
+	struct bvbuffdesc *descs[3];
+	struct bvbuffdesc fresh[3];
+	unsigned int i;
+
+	memset(&params, 0, sizeof(params));
+	params.structsize = sizeof(params);
+	thread->test->setup(&params);
+
+	descs[0] = params.dstdesc;
+	descs[1] = params.src1.desc;
+	descs[2] = params.src2.desc;
+
+	thread->ok = true;
+	gcprof_readlocks(&thread->lockwait, &thread->lockwaits, true);
+	pthread_barrier_wait(thread->barrier);
+
+	for (i = 0; i < thread->iterations; i += 1) {
+		if (g_fresh)
+			renew_descs(&params, descs, fresh);
+		if (run_blt(thread->test, &params) != BVERR_NONE) {
+			thread->ok = false;
+			break;
+		}
+	}
+
+	gcprof_readlocks(&thread->lockwait, &thread->lockwaits, true);
+	return NULL;
+}
+
+static bool run_threads(struct bench_test *test, unsigned int iterations,
+			unsigned int count)
+{
+	struct bench_thread threads[count];
+	pthread_barrier_t barrier;
+	unsigned long long lockwait = 0;
+	unsigned int lockwaits = 0;
+	unsigned int i, started;
+	double start, elapsed;
+	bool ok = true;
+
+	pthread_barrier_init(&barrier, NULL, count + 1);
+
+	for (started = 0; started < count; started += 1) {
+		threads[started].test = test;
+		threads[started].iterations = iterations;
+		threads[started].barrier = &barrier;
+		if (pthread_create(&threads[started].thread, NULL,
+				   run_thread, &threads[started]) != 0)
+			break;
+	}
+
+	/* Without all the threads the barrier would never open. */
+	if (started < count) {
+		fprintf(stderr, "failed to start %u threads.\n", count);
+		exit(1);
+	}
+
+	pthread_barrier_wait(&barrier);
+	start = get_walltime();
+
+	for (i = 0; i < count; i += 1) {
+		pthread_join(threads[i].thread, NULL);
+		lockwait += threads[i].lockwait;
+		lockwaits += threads[i].lockwaits;
+		if (!threads[i].ok)
+			ok = false;
+	}
+
+	elapsed = get_walltime() - start;
+	pthread_barrier_destroy(&barrier);
+
+	if (!ok) {
+		printf("%-8s %7u bv_blt failed\n", test->name, count);
+		return false;
+	}
+
+	printf("%-8s %7u %10.0f %8.3f %8.2f\n", test->name, count,
+	       iterations * count / (elapsed / 1e6),
+	       (double) lockwaits / (iterations * count),
+	       lockwait / 1e3 / (iterations * count));
+
+	return true;
+}
+
+static void usage(char *name)
+{
+	unsigned int i;
+
+	fprintf(stderr, "usage: %s [-n iterations] [-w width] [-h height] "
+		"[-i | -f] [-t threads] [test...]\ntests:", name);
+
+	for (i = 0; i < TEST_COUNT; i += 1)
+		fprintf(stderr, " %s", g_tests[i].name);
+
+	fprintf(stderr, "\n");
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int iterations = 1000;
+	unsigned int threads = 0;
+	unsigned int i, j, count;
+	bool execute, ok = true;
+	char *env;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:w:h:ift:")) != -1) {
+		switch (opt) {
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		case 'w':
+			g_width = atoi(optarg) & ~1;
+			break;
+		case 'h':
+			g_height = atoi(optarg) & ~1;
+			break;
+		case 'i':
+			g_implicit = true;
+			break;
+		case 'f':
+			g_implicit = true;
+			g_fresh = true;
+			break;
+		case 't':
+			threads = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if ((iterations == 0) || (g_width < 2) || (g_height < 2)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	/* What is measured is the GPU path; gccpubench covers the CPU one. */
+	gccpu_setthreshold(0);
+
+	env = getenv("GCBV_EMULATE");
+	execute = (env ? atoi(env) : GCEMU_DEFAULT) == GCEMU_EXECUTE;
+
+	if (!surfaces_init()) {
+		fprintf(stderr, "failed to set up the surfaces.\n");
+		surfaces_exit();
+		return 1;
+	}
+
+	printf("%ux%u, %u iterations, %s mapping%s\n", g_width, g_height,
+	       iterations, g_implicit ? "implicit" : "explicit",
+	       g_fresh ? ", new descriptors" : "");
+
+	if (threads != 0)
+		printf("%-8s %7s %10s %8s %8s\n", "test", "threads",
+		       "blits/s", "waits", "wait us");
+	else
+		printf("%-8s %8s %8s %8s %8s %8s %6s %6s %8s %6s %8s%s\n",
+		       "test", "cpu us", "parse", "map", "build", "commit",
+		       "maps", "unmaps", "bytes", "ops", "pixels",
+		       execute ? " executed" : "");
+
+	for (i = 0; i < TEST_COUNT; i += 1) {
+		if (optind < argc) {
+			for (j = optind; j < (unsigned int) argc; j += 1)
+				if (strcmp(argv[j], g_tests[i].name) == 0)
+					break;
+			if (j == (unsigned int) argc)
+				continue;
+		}
+
+		if (threads == 0) {
+			if (!run_test(&g_tests[i], iterations, execute))
+				ok = false;
+			continue;
+		}
+
+		for (count = 1; count < threads * 2; count *= 2) {
+			if (count > threads)
+				count = threads;
+			if (!run_threads(&g_tests[i], iterations, count))
+				ok = false;
+		}
+	}
+
+	surfaces_exit();
+
+	return ok ? 0 : 1;
+}
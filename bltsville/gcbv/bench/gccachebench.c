@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2012,
+ * Texas Instruments, Inc. and Vivante Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Texas Instruments, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL TEXAS INSTRUMENTS, INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * gccachebench - checks and measures the cache maintenance path.
+ *
+ * Usage: gccachebench [-n frames]
+ *        gccachebench -v [lists]
+ *
+ * Without options hands each scenario's regions to gcbvcacheop for the
+ * given number of frames and prints, per frame, the GCIOCTL_CACHE calls and
+ * the bytes they name, next to what the same regions cost unmerged: one
+ * call per three regions, each region as given.
+ *
+ * -v hands random region lists to gcbvcacheop and checks, as seen by the
+ * emulator, that every requested byte is maintained and that invalidations,
+ * and lists said to span several buffers, maintain nothing else. The exit
+ * status is non zero if a check fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "gcmain.h"
+#include "gcbv.h"
+#include "gcemu.h"
+
+#define MAX_REGIONS 64
+
+struct bench_scenario {
+	char *name;
+	int (*setup)(struct c2dmrgn rgn[]);
+};
+
+/* Only the addresses matter, the buffer is never touched. */
+static char *g_base = (char *) 0x10000000;
+
+static const char *g_opnames[] = { "flush", "clean", "invalidate" };
+
+
+/*******************************************************************************
+ * Scenarios.
+ */
+
+static void set_region(struct c2dmrgn *rgn, long stride, unsigned int x,
+		       unsigned int y, unsigned int span, unsigned int lines)
+{
+	rgn->start = g_base + y * stride + x;
+	rgn->span = span;
+	rgn->lines = lines;
+	rgn->stride = stride;
+}
+
+/* A damaged area of 720p ARGB reported as a grid of 64x32 tiles. */
+static int setup_tiles(struct c2dmrgn rgn[])
+{
+	int count = 0;
+	unsigned int x, y;
+
+	for (y = 0; y < 4; y += 1)
+		for (x = 0; x < 6; x += 1)
+			set_region(&rgn[count++], 1280 * 4, (128 + x * 64) * 4,
+				   96 + y * 32, 64 * 4, 32);
+
+	return count;
+}
+
+/* Small rectangles scattered over 720p ARGB. */
+static int setup_scattered(struct c2dmrgn rgn[])
+{
+	int count;
+
+	for (count = 0; count < 16; count += 1)
+		set_region(&rgn[count], 1280 * 4,
+			   ((count * 389) % 1200) * 4, (count * 97) % 680,
+			   40 * 4, 20);
+
+	return count;
+}
+
+/* Overlapping windows, the way a stack of dialogs gets damaged. */
+static int setup_overlap(struct c2dmrgn rgn[])
+{
+	int count;
+
+	for (count = 0; count < 8; count += 1)
+		set_region(&rgn[count], 1280 * 4, (200 + count * 24) * 4,
+			   100 + count * 16, 480 * 4, 320);
+
+	return count;
+}
+
+/* Full 720p NV12 frame, the luma and chroma planes back to back. */
+static int setup_nv12(struct c2dmrgn rgn[])
+{
+	set_region(&rgn[0], 1280, 0, 0, 1280, 720);
+	set_region(&rgn[1], 1280, 0, 720, 1280, 360);
+
+	return 2;
+}
+
+/* Quarter of a 720p YV12 frame, three planes. */
+static int setup_yv12(struct c2dmrgn rgn[])
+{
+	set_region(&rgn[0], 1280, 0, 0, 640, 360);
+	set_region(&rgn[1], 640, 0, 1440, 320, 180);
+	set_region(&rgn[2], 640, 0, 1800, 320, 180);
+
+	return 3;
+}
+
+static struct bench_scenario g_scenarios[] = {
+	{ "tiles", setup_tiles },
+	{ "scattered", setup_scattered },
+	{ "overlap", setup_overlap },
+	{ "nv12", setup_nv12 },
+	{ "yv12", setup_yv12 },
+};
+
+
+/*******************************************************************************
+ * Benchmark.
+ */
+
+static double get_cputime(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static bool run_scenario(struct bench_scenario *scenario,
+			 enum bvcacheop cacheop, unsigned int frames)
+{
+	struct c2dmrgn rgn[MAX_REGIONS];
+	struct gcemustats stats;
+	unsigned long long bytes = 0;
+	double start, elapsed;
+	unsigned int i;
+	int count;
+
+	count = scenario->setup(rgn);
+	for (i = 0; i < (unsigned int) count; i += 1)
+		bytes += rgn[i].span * rgn[i].lines;
+
+	gcemu_getstats(&stats, true);
+	start = get_cputime();
+
+	for (i = 0; i < frames; i += 1)
+		if (gcbvcacheop(count, rgn, cacheop, true) != BVERR_NONE) {
+			printf("%-10s %-10s gcbvcacheop failed\n",
+			       scenario->name, g_opnames[cacheop]);
+			return false;
+		}
+
+	elapsed = get_cputime() - start;
+	gcemu_getstats(&stats, true);
+
+	printf("%-10s %-10s %7d %8d %10llu %8.2f %10llu %8.2f\n",
+	       scenario->name, g_opnames[cacheop], count, (count + 2) / 3,
+	       bytes, (double) stats.cacheops / frames,
+	       stats.cachebytes / frames, elapsed / frames);
+
+	return true;
+}
+
+static int benchmark(unsigned int frames)
+{
+	unsigned int i;
+	bool ok = true;
+
+	printf("%u frames\n", frames);
+	printf("%-10s %-10s %7s %8s %10s %8s %10s %8s\n",
+	       "scenario", "op", "regions", "ioctls", "bytes",
+	       "ioctls", "bytes", "cpu us");
+
+	for (i = 0; i < countof(g_scenarios); i += 1) {
+		if (!run_scenario(&g_scenarios[i], BVCACHE_CPU_TO_DEVICE,
+				  frames))
+			ok = false;
+		if (!run_scenario(&g_scenarios[i], BVCACHE_CPU_FROM_DEVICE,
+				  frames))
+			ok = false;
+	}
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/*******************************************************************************
+ * Coverage check.
+ */
+
+#define CHECK_SIZE (64 * 1024)
+
+static unsigned char g_requested[CHECK_SIZE];
+static unsigned char g_maintained[CHECK_SIZE];
+static unsigned int g_outside;
+
+static void mark_region(unsigned char *map, struct c2dmrgn *rgn)
+{
+	long offset;
+	size_t line, i;
+
+	for (line = 0; line < rgn->lines; line += 1) {
+		offset = rgn->start + line * rgn->stride - g_base;
+
+		for (i = 0; i < rgn->span; i += 1) {
+			if ((offset + (long) i < 0) ||
+			    (offset + (long) i >= CHECK_SIZE)) {
+				g_outside += 1;
+				continue;
+			}
+
+			map[offset + i] = 1;
+		}
+	}
+}
+
+static void cache_hook(struct gcicache *gcicache)
+{
+	int i;
+
+	for (i = 0; i < gcicache->count; i += 1)
+		mark_region(g_maintained, &gcicache->rgn[i]);
+}
+
+/* Random region inside the check buffer, bottom up one time in ten. */
+static void random_region(struct c2dmrgn *rgn)
+{
+	static const long strides[] = { 64, 128, 256, 1024 };
+	long stride;
+	unsigned int lines, span, top;
+
+	stride = strides[rand() % countof(strides)];
+	lines = 1 + rand() % 16;
+	span = 1 + rand() % stride;
+	if ((rand() % 4) == 0)
+		span = stride;
+
+	top = rand() % (CHECK_SIZE / stride - lines);
+	set_region(rgn, stride, rand() % (stride - span + 1), top,
+		   span, lines);
+
+	if ((rand() % 10) == 0) {
+		rgn->start += (lines - 1) * stride;
+		rgn->stride = -stride;
+	}
+}
+
+static int verify(unsigned int lists)
+{
+	struct c2dmrgn rgn[MAX_REGIONS];
+	enum bvcacheop cacheop;
+	bool onebuffer;
+	unsigned long long requested = 0, maintained = 0;
+	unsigned int errors = 0;
+	unsigned int i, j, missing, extra;
+	int count;
+
+	srand(1);
+	gcemu_setcachehook(cache_hook);
+
+	for (i = 0; i < lists; i += 1) {
+		memset(g_requested, 0, sizeof(g_requested));
+		memset(g_maintained, 0, sizeof(g_maintained));
+		g_outside = 0;
+
+		count = rand() % MAX_REGIONS;
+		cacheop = rand() % 3;
+		onebuffer = (rand() % 2) == 0;
+
+		for (j = 0; j < (unsigned int) count; j += 1) {
+			random_region(&rgn[j]);
+			mark_region(g_requested, &rgn[j]);
+		}
+
+		gcbvcacheop(count, rgn, cacheop, onebuffer);
+
+		for (missing = 0, extra = 0, j = 0; j < CHECK_SIZE; j += 1) {
+			requested += g_requested[j];
+			maintained += g_maintained[j];
+			missing += g_requested[j] && !g_maintained[j];
+			extra += !g_requested[j] && g_maintained[j];
+		}
+
+		if ((missing == 0) && (g_outside == 0) &&
+		    ((extra == 0) || (onebuffer &&
+				      (cacheop != BVCACHE_CPU_FROM_DEVICE))))
+			continue;
+
+		if (errors++ < 10)
+			fprintf(stderr, "list %u (%d regions, %s%s): %u bytes "
+				"missed, %u extra, %u outside\n", i, count,
+				g_opnames[cacheop],
+				onebuffer ? "" : ", several buffers",
+				missing, extra, g_outside);
+	}
+
+	gcemu_setcachehook(NULL);
+
+	printf("%u lists, %.2f bytes maintained per byte requested: %s\n",
+	       lists, requested ? (double) maintained / requested : 0.0,
+	       errors ? "FAILED" : "ok");
+
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+	if ((argc > 1) && (strcmp(argv[1], "-v") == 0))
+		return verify((argc > 2) ? (unsigned int) atoi(argv[2]) : 10000);
+
+	if ((argc > 1) && (strcmp(argv[1], "-n") == 0) && (argc > 2))
+		return benchmark(atoi(argv[2]));
+
+	if (argc == 1)
+		return benchmark(10000);
+
+	fprintf(stderr, "usage: gccachebench [-n frames | -v [lists]]\n");
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,823 @@
+/*
+ * Copyright (c) 2012,
+ * Texas Instruments, Inc. and Vivante Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Texas Instruments, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL TEXAS INSTRUMENTS, INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * gccpubench - checks the CPU blitter against the GPU and finds where the
+ * GPU starts to pay off.
+ *
+ * Usage: gccpubench [-n iterations] [-m max] [-i]
+ *        gccpubench -v [blits]
+ *
+ * Without -v runs fills, copies, quarter turn rotations and blends of
+ * squares from 2x2 up to max (256 by default) pixels, through bv_blt with
+ * the blitter forced on and forced off, and prints the wall time of each
+ * in microseconds, then per operation the first size at which the GPU is
+ * faster and the GCBV_CPUBLIT threshold that puts the crossover there.
+ * Buffers are mapped up front unless -i is given. On the host run it with
+ * GCBV_EMULATE=1, so that the emulator does not add pixel work to the GPU
+ * side; the figures that matter come from the target.
+ *
+ * -v runs random blits through the blitter and checks the whole
+ * destination buffer, pixel for pixel, against the same blit done by the
+ * emulator (GCBV_EMULATE=2, the default for this tool) when it can run it,
+ * and against a reference model of the GC320 otherwise: the emulator
+ * leaves rotation and blending alone, so those follow the orientation
+ * convention of gcblit.c and Cd = Cs + Cd * (1 - As) rounded to nearest,
+ * one pixel at a time. It also checks that a blit is taken again once an
+ * asynchronous batch completes. The exit status is non zero if a blit is
+ * declined or a pixel differs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "gcmain.h"
+#include "gcemu.h"
+#include "gccpu.h"
+
+#define VERIFY_SIZE 48
+
+struct bench_surface {
+	struct bvbuffdesc desc;
+	struct bvsurfgeom geom;
+	unsigned int bpp;
+};
+
+struct bench_format {
+	enum ocdformat format;
+	unsigned int bpp;
+	bool alpha;
+};
+
+enum bench_op {
+	BENCH_FILL,
+	BENCH_COPY,
+	BENCH_ROTATE,
+	BENCH_BLEND,
+
+	BENCH_OP_COUNT
+};
+
+static const char * const g_opnames[] = { "fill", "copy", "rotate", "blend" };
+
+static const struct bench_format g_formats[] = {
+	{ OCDFMT_RGBA24, 4, true },
+	{ OCDFMT_BGRA24, 4, true },
+	{ OCDFMT_ARGB24, 4, true },
+	{ OCDFMT_ABGR24, 4, true },
+	{ OCDFMT_RGBx24, 4, false },
+	{ OCDFMT_xRGB24, 4, false },
+	{ OCDFMT_RGB16, 2, false },
+	{ OCDFMT_BGR16, 2, false },
+};
+
+
+/*******************************************************************************
+ * Surfaces.
+ */
+
+static bool surface_alloc(struct bench_surface *surface,
+			  const struct bench_format *format,
+			  unsigned int width, unsigned int height,
+			  int orientation)
+{
+	unsigned int physwidth;
+
+	memset(surface, 0, sizeof(*surface));
+
+	physwidth = ((orientation % 180) == 0) ? width : height;
+
+	surface->bpp = format->bpp;
+	surface->geom.structsize = sizeof(struct bvsurfgeom);
+	surface->geom.format = format->format;
+	surface->geom.width = width;
+	surface->geom.height = height;
+	surface->geom.orientation = orientation;
+	surface->geom.virtstride = ((physwidth * format->bpp) + 63) & ~63;
+
+	surface->desc.structsize = sizeof(struct bvbuffdesc);
+	surface->desc.length = surface->geom.virtstride
+			     * (((orientation % 180) == 0) ? height : width);
+
+	return posix_memalign(&surface->desc.virtaddr, 64,
+			      surface->desc.length) == 0;
+}
+
+static void surface_free(struct bench_surface *surface)
+{
+	free(surface->desc.virtaddr);
+	surface->desc.virtaddr = NULL;
+}
+
+/* Random pixels; with premultiplied alpha, half of them valid (no
+ * component above the alpha) and a good share opaque or transparent. */
+static void surface_randomize(struct bench_surface *surface,
+			      bool premultiplied)
+{
+	unsigned char *ptr = surface->desc.virtaddr;
+	unsigned int alpha, i, j;
+
+	for (i = 0; i < surface->desc.length; i += 1)
+		ptr[i] = rand();
+
+	if (!premultiplied)
+		return;
+
+	for (i = 0; i < surface->desc.length; i += 4) {
+		switch (rand() % 4) {
+		case 0:
+			alpha = 0;
+			break;
+		case 1:
+			alpha = 255;
+			break;
+		case 2:
+			alpha = rand() % 256;
+			break;
+		default:
+			continue;
+		}
+
+		/* Byte order does not matter: all four at most alpha. */
+		for (j = 0; j < 4; j += 1)
+			ptr[i + j] = alpha ? rand() % (alpha + 1) : 0;
+		ptr[i + rand() % 4] = alpha;
+	}
+}
+
+/* The logical pixel in memory; see set_rect in gccpu.c. */
+static unsigned char *get_pixel_ptr(struct bench_surface *surface,
+				    int x, int y)
+{
+	int width = surface->geom.width;
+	int height = surface->geom.height;
+	int px, py;
+
+	switch (((surface->geom.orientation % 360) + 360) % 360) {
+	case 90:
+		px = y;
+		py = width - 1 - x;
+		break;
+
+	case 180:
+		px = width - 1 - x;
+		py = height - 1 - y;
+		break;
+
+	case 270:
+		px = height - 1 - y;
+		py = x;
+		break;
+
+	default:
+		px = x;
+		py = y;
+	}
+
+	return (unsigned char *) surface->desc.virtaddr
+	     + py * surface->geom.virtstride + px * surface->bpp;
+}
+
+static void set_rect(struct bvrect *rect, int left, int top,
+		     unsigned int width, unsigned int height)
+{
+	rect->left = left;
+	rect->top = top;
+	rect->width = width;
+	rect->height = height;
+}
+
+static void setup_params(struct bvbltparams *params, enum bench_op op,
+			 struct bench_surface *dst,
+			 struct bench_surface *src1,
+			 struct bench_surface *src2)
+{
+	memset(params, 0, sizeof(*params));
+	params->structsize = sizeof(struct bvbltparams);
+
+	if (op == BENCH_BLEND) {
+		params->flags = BVFLAG_BLEND;
+		params->op.blend = BVBLEND_SRC1OVER;
+		params->src2.desc = &src2->desc;
+		params->src2geom = &src2->geom;
+	} else {
+		params->flags = BVFLAG_ROP;
+		params->op.rop = 0xCCCC;
+	}
+
+	params->dstdesc = &dst->desc;
+	params->dstgeom = &dst->geom;
+	params->src1.desc = &src1->desc;
+	params->src1geom = &src1->geom;
+}
+
+static unsigned int get_commits(void)
+{
+	struct gcemustats stats;
+
+	gcemu_getstats(&stats, false);
+	return stats.commits;
+}
+
+
+/*******************************************************************************
+ * Equivalence check.
+ */
+
+static const struct bench_format *random_format(bool alpha)
+{
+	const struct bench_format *format;
+
+	do
+		format = &g_formats[rand() % countof(g_formats)];
+	while (alpha && !format->alpha);
+
+	return format;
+}
+
+static int random_orientation(void)
+{
+	static const int orientations[] = { 0, 90, 180, 270, -90, 450 };
+
+	return orientations[rand() % countof(orientations)];
+}
+
+/* Random rectangle of the given size inside the surface. */
+static void random_rect(struct bench_surface *surface, struct bvrect *rect,
+			unsigned int width, unsigned int height)
+{
+	set_rect(rect, rand() % (surface->geom.width - width + 1),
+		 rand() % (surface->geom.height - height + 1), width, height);
+}
+
+static bool allocate_random(struct bench_surface *surface,
+			    const struct bench_format *format,
+			    int orientation, unsigned int minwidth,
+			    unsigned int minheight, bool premultiplied)
+{
+	unsigned int width, height;
+
+	width = minwidth + rand() % (VERIFY_SIZE - minwidth + 1);
+	height = minheight + rand() % (VERIFY_SIZE - minheight + 1);
+
+	if (!surface_alloc(surface, format, width, height, orientation))
+		return false;
+
+	surface_randomize(surface, premultiplied);
+	return true;
+}
+
+/* Value a GPU fill from the source pixel leaves in a pixel of the given
+ * format; the emulator ignores the destination orientation. */
+static bool get_fill_reference(struct bvbltparams *fill,
+			       const struct bench_format *format,
+			       unsigned char *pixel)
+{
+	struct bench_surface scratch;
+	struct bvbltparams params = *fill;
+	bool ok;
+
+	if (!surface_alloc(&scratch, format, 1, 1, 0))
+		return false;
+
+	params.flags &= ~BVFLAG_CLIP;
+	params.dstdesc = &scratch.desc;
+	params.dstgeom = &scratch.geom;
+	set_rect(&params.dstrect, 0, 0, 1, 1);
+
+	gccpu_setthreshold(0);
+	ok = bv_blt(&params) == BVERR_NONE;
+	memcpy(pixel, scratch.desc.virtaddr, format->bpp);
+
+	surface_free(&scratch);
+	return ok;
+}
+
+static void blend_reference(unsigned char *dst, unsigned char *src1,
+			    unsigned char *src2, unsigned int alphabyte)
+{
+	unsigned int inverse = 255 - src1[alphabyte];
+	unsigned int i, value;
+
+	for (i = 0; i < 4; i += 1) {
+		value = src1[i] + (src2[i] * inverse + 127) / 255;
+		dst[i] = (value > 255) ? 255 : value;
+	}
+}
+
+/* Byte of the alpha in memory. */
+static unsigned int get_alpha_byte(enum ocdformat format)
+{
+	switch (format) {
+	case OCDFMT_RGBA24:
+	case OCDFMT_BGRA24:
+		return 3;
+
+	default:
+		return 0;
+	}
+}
+
+/* Clipped destination rectangle and the offset of the sources. */
+static bool get_clipped(struct bvbltparams *params, struct bvrect *clipped)
+{
+	int left = params->dstrect.left;
+	int top = params->dstrect.top;
+	int right = left + params->dstrect.width;
+	int bottom = top + params->dstrect.height;
+
+	if ((params->flags & BVFLAG_CLIP) != 0) {
+		left = max(left, params->cliprect.left);
+		top = max(top, params->cliprect.top);
+		right = min(right, params->cliprect.left +
+				   (int) params->cliprect.width);
+		bottom = min(bottom, params->cliprect.top +
+				     (int) params->cliprect.height);
+	}
+
+	if ((left >= right) || (top >= bottom))
+		return false;
+
+	set_rect(clipped, left, top, right - left, bottom - top);
+	return true;
+}
+
+static bool run_reference(struct bvbltparams *params, enum bench_op op,
+			  const struct bench_format *dstformat,
+			  struct bench_surface *dst,
+			  struct bench_surface *src1,
+			  struct bench_surface *src2)
+{
+	unsigned char fillpixel[4];
+	struct bvrect clipped;
+	int dx, dy, x, y;
+
+	if (!get_clipped(params, &clipped))
+		return false;
+
+	if ((op == BENCH_FILL) &&
+	    !get_fill_reference(params, dstformat, fillpixel))
+		return false;
+
+	dx = clipped.left - params->dstrect.left;
+	dy = clipped.top - params->dstrect.top;
+
+	for (y = 0; y < (int) clipped.height; y += 1)
+		for (x = 0; x < (int) clipped.width; x += 1) {
+			unsigned char *d = get_pixel_ptr(dst,
+							 clipped.left + x,
+							 clipped.top + y);
+			int sx1 = params->src1rect.left + dx + x;
+			int sy1 = params->src1rect.top + dy + y;
+			int sx2 = params->src2rect.left + dx + x;
+			int sy2 = params->src2rect.top + dy + y;
+
+			switch (op) {
+			case BENCH_FILL:
+				memcpy(d, fillpixel, dst->bpp);
+				break;
+
+			case BENCH_COPY:
+			case BENCH_ROTATE:
+				memcpy(d, get_pixel_ptr(src1, sx1, sy1),
+				       dst->bpp);
+				break;
+
+			default:
+				blend_reference(d,
+						get_pixel_ptr(src1, sx1, sy1),
+						get_pixel_ptr(src2, sx2, sy2),
+						get_alpha_byte(dstformat->format));
+			}
+		}
+
+	return true;
+}
+
+static bool verify_blit(unsigned int index)
+{
+	const struct bench_format *dstformat, *srcformat;
+	struct bench_surface dst, src1, src2, *blendsrc2;
+	struct bvbltparams params;
+	struct gcemustats stats;
+	unsigned char *initial = NULL, *cpu = NULL;
+	enum bench_op op = rand() % BENCH_OP_COUNT;
+	unsigned int width, height, commits;
+	bool gpu, ok = false;
+
+	memset(&src2, 0, sizeof(src2));
+
+	/* Surfaces and rectangles. */
+	dstformat = random_format(op == BENCH_BLEND);
+	srcformat = (op == BENCH_FILL) ? random_format(false) : dstformat;
+
+	if (!allocate_random(&dst, dstformat,
+			     (op == BENCH_COPY) ? 0 : random_orientation(),
+			     1, 1, op == BENCH_BLEND))
+		return false;
+
+	/* A 1x1 source is a fill, which blending leaves to the GPU. */
+	do {
+		width = 1 + rand() % dst.geom.width;
+		height = 1 + rand() % dst.geom.height;
+	} while ((op == BENCH_BLEND) && (width * height == 1));
+
+	if (width * height == 1)
+		op = BENCH_FILL;
+
+	if (op == BENCH_FILL) {
+		if (!allocate_random(&src1, srcformat, 0, 1, 1, false))
+			goto exit;
+	} else if (!allocate_random(&src1, srcformat,
+				    (op == BENCH_COPY) ? 0
+						       : random_orientation(),
+				    width, height, op == BENCH_BLEND)) {
+		goto exit;
+	}
+
+	setup_params(&params, op, &dst, &src1, &src2);
+	random_rect(&dst, &params.dstrect, width, height);
+	if (op == BENCH_FILL)
+		random_rect(&src1, &params.src1rect, 1, 1);
+	else
+		random_rect(&src1, &params.src1rect, width, height);
+
+	/* Blend onto the destination or from a third surface. */
+	blendsrc2 = &dst;
+	if (op == BENCH_BLEND) {
+		if ((rand() % 2) == 0) {
+			params.src2.desc = &dst.desc;
+			params.src2geom = &dst.geom;
+			params.src2rect = params.dstrect;
+		} else {
+			if (!allocate_random(&src2, dstformat,
+					     random_orientation(),
+					     width, height, true))
+				goto exit;
+
+			random_rect(&src2, &params.src2rect, width, height);
+			blendsrc2 = &src2;
+		}
+	}
+
+	/* Clip one blit in two. */
+	if ((rand() % 2) == 0) {
+		params.flags |= BVFLAG_CLIP;
+		set_rect(&params.cliprect, rand() % dst.geom.width,
+			 rand() % dst.geom.height,
+			 1 + rand() % dst.geom.width,
+			 1 + rand() % dst.geom.height);
+
+		/* Nothing left; bv_blt fails those. */
+		if (!get_clipped(&params, &params.cliprect)) {
+			params.cliprect = params.dstrect;
+			params.cliprect.width = 1;
+		}
+	}
+
+	initial = malloc(dst.desc.length);
+	cpu = malloc(dst.desc.length);
+	if ((initial == NULL) || (cpu == NULL))
+		goto exit;
+
+	memcpy(initial, dst.desc.virtaddr, dst.desc.length);
+
+	/* CPU. */
+	commits = get_commits();
+	gccpu_setthreshold(~0U);
+
+	if (bv_blt(&params) != BVERR_NONE) {
+		fprintf(stderr, "blit %u (%s): bv_blt failed: %s\n", index,
+			g_opnames[op], params.errdesc ? params.errdesc : "");
+		goto exit;
+	}
+
+	if (get_commits() != commits) {
+		fprintf(stderr, "blit %u (%s): left to the GPU\n", index,
+			g_opnames[op]);
+		goto exit;
+	}
+
+	memcpy(cpu, dst.desc.virtaddr, dst.desc.length);
+	memcpy(dst.desc.virtaddr, initial, dst.desc.length);
+
+	/* GPU if the emulator runs it, the reference model otherwise. */
+	gpu = ((op == BENCH_FILL) || (op == BENCH_COPY)) &&
+	      (dst.geom.orientation == 0);
+
+	if (gpu) {
+		gcemu_getstats(&stats, true);
+		gccpu_setthreshold(0);
+
+		if ((bv_blt(&params) != BVERR_NONE) ||
+		    (gcemu_getstats(&stats, false), stats.executed != 1) ||
+		    (stats.skipped != 0)) {
+			fprintf(stderr, "blit %u (%s): not run by the "
+				"emulator\n", index, g_opnames[op]);
+			goto exit;
+		}
+	} else if (!run_reference(&params, op, dstformat, &dst, &src1,
+				  blendsrc2)) {
+		fprintf(stderr, "blit %u (%s): no reference\n", index,
+			g_opnames[op]);
+		goto exit;
+	}
+
+	if (memcmp(cpu, dst.desc.virtaddr, dst.desc.length) != 0) {
+		fprintf(stderr, "blit %u (%s, %s): %dx%d at %d,%d %d deg, "
+			"from %d,%d %d deg: differs\n", index, g_opnames[op],
+			gpu ? "gpu" : "reference", width, height,
+			params.dstrect.left, params.dstrect.top,
+			dst.geom.orientation, params.src1rect.left,
+			params.src1rect.top, src1.geom.orientation);
+		goto exit;
+	}
+
+	ok = true;
+
+exit:
+	free(initial);
+	free(cpu);
+	surface_free(&src2);
+	surface_free(&src1);
+	surface_free(&dst);
+	return ok;
+}
+
+static void async_done(struct bvcallbackerror *err,
+		       unsigned long callbackdata)
+{
+	*(volatile bool *) callbackdata = true;
+}
+
+/* An asynchronous batch keeps the blitter off only until it completes. */
+static bool verify_async(void)
+{
+	static const struct bench_format format = { OCDFMT_RGBA24, 4, true };
+	struct bench_surface dst, src;
+	struct bvbltparams params;
+	volatile bool done = false;
+	unsigned int commits, i;
+	bool ok = false;
+
+	memset(&src, 0, sizeof(src));
+	if (!surface_alloc(&dst, &format, 16, 16, 0) ||
+	    !surface_alloc(&src, &format, 16, 16, 0))
+		goto exit;
+
+	setup_params(&params, BENCH_COPY, &dst, &src, NULL);
+	set_rect(&params.dstrect, 0, 0, 16, 16);
+	set_rect(&params.src1rect, 0, 0, 16, 16);
+
+	/* Asynchronous blits always go to the GPU. */
+	gccpu_setthreshold(~0U);
+	params.flags |= BVFLAG_ASYNC;
+	params.callbackfn = async_done;
+	params.callbackdata = (unsigned long) &done;
+
+	if (bv_blt(&params) != BVERR_NONE)
+		goto exit;
+
+	for (i = 0; (i < 1000) && !done; i += 1)
+		usleep(1000);
+
+	/* The completion callback may run ahead of the one retiring the
+	 * batch; give that one a moment too. */
+	usleep(10000);
+
+	params.flags &= ~BVFLAG_ASYNC;
+	params.callbackfn = NULL;
+	commits = get_commits();
+
+	ok = done && (bv_blt(&params) == BVERR_NONE) &&
+	     (get_commits() == commits);
+
+exit:
+	if (!ok)
+		fprintf(stderr, "blit after an asynchronous batch left to "
+			"the GPU\n");
+
+	surface_free(&src);
+	surface_free(&dst);
+	return ok;
+}
+
+static int verify(unsigned int blits)
+{
+	unsigned int errors = 0;
+	unsigned int i;
+
+	srand(1);
+
+	if (!verify_async())
+		errors += 1;
+
+	for (i = 0; i < blits; i += 1)
+		if (!verify_blit(i) && (errors++ >= 10))
+			break;
+
+	printf("%u blits: %s\n", i, errors ? "FAILED" : "ok");
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+/*******************************************************************************
+ * Crossover benchmark.
+ */
+
+/* Blit cost weights in gccpu.c. */
+static const unsigned int g_weights[] = { 1, 2, 4, 32 };
+
+static double get_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static double time_blits(struct bvbltparams *params, unsigned int iterations,
+			 unsigned int threshold)
+{
+	double start;
+	unsigned int i;
+
+	gccpu_setthreshold(threshold);
+	start = get_time();
+
+	for (i = 0; i < iterations; i += 1)
+		if (bv_blt(params) != BVERR_NONE)
+			return -1.0;
+
+	return (get_time() - start) / iterations;
+}
+
+static bool run_op(enum bench_op op, unsigned int iterations,
+		   unsigned int max, bool implicit)
+{
+	static const struct bench_format format = { OCDFMT_RGBA24, 4, true };
+	struct bench_surface dst, src1, src2, solid;
+	struct bvbltparams params;
+	unsigned int size, crossover = 0;
+	double cpu, gpu;
+	bool ok = false;
+
+	memset(&dst, 0, sizeof(dst));
+	memset(&src1, 0, sizeof(src1));
+	memset(&src2, 0, sizeof(src2));
+	memset(&solid, 0, sizeof(solid));
+
+	if (!surface_alloc(&dst, &format, max, max,
+			   (op == BENCH_ROTATE) ? 90 : 0) ||
+	    !surface_alloc(&src1, &format, max, max, 0) ||
+	    !surface_alloc(&src2, &format, max, max, 0) ||
+	    !surface_alloc(&solid, &format, 1, 1, 0))
+		goto exit;
+
+	surface_randomize(&dst, true);
+	surface_randomize(&src1, true);
+	surface_randomize(&src2, true);
+	surface_randomize(&solid, true);
+
+	if (!implicit &&
+	    ((bv_map(&dst.desc) != BVERR_NONE) ||
+	     (bv_map(&src1.desc) != BVERR_NONE) ||
+	     (bv_map(&src2.desc) != BVERR_NONE) ||
+	     (bv_map(&solid.desc) != BVERR_NONE)))
+		goto exit;
+
+	setup_params(&params, op, &dst,
+		     (op == BENCH_FILL) ? &solid : &src1, &src2);
+
+	for (size = 2; size <= max; size *= 2) {
+		set_rect(&params.dstrect, 0, 0, size, size);
+		set_rect(&params.src2rect, 0, 0, size, size);
+		if (op == BENCH_FILL)
+			set_rect(&params.src1rect, 0, 0, 1, 1);
+		else
+			set_rect(&params.src1rect, 0, 0, size, size);
+
+		cpu = time_blits(&params, iterations, ~0U);
+		gpu = time_blits(&params, iterations, 0);
+		if ((cpu < 0.0) || (gpu < 0.0)) {
+			printf("%-8s bv_blt failed: %s\n", g_opnames[op],
+			       params.errdesc ? params.errdesc : "");
+			goto exit;
+		}
+
+		printf("%-8s %4ux%-4u %8u %10.2f %10.2f\n", g_opnames[op],
+		       size, size, size * size, cpu, gpu);
+
+		if ((crossover == 0) && (gpu < cpu))
+			crossover = size;
+	}
+
+	if (crossover == 0)
+		printf("%-8s cpu faster up to %ux%u\n", g_opnames[op],
+		       max, max);
+	else
+		printf("%-8s gpu faster from %ux%u, threshold %u\n",
+		       g_opnames[op], crossover, crossover,
+		       crossover * crossover / 2 * g_weights[op]);
+
+	ok = true;
+
+exit:
+	if (!implicit) {
+		bv_unmap(&solid.desc);
+		bv_unmap(&src2.desc);
+		bv_unmap(&src1.desc);
+		bv_unmap(&dst.desc);
+	}
+
+	surface_free(&solid);
+	surface_free(&src2);
+	surface_free(&src1);
+	surface_free(&dst);
+	return ok;
+}
+
+static int benchmark(unsigned int iterations, unsigned int max, bool implicit)
+{
+	unsigned int op;
+	bool ok = true;
+
+	printf("%u iterations, %s mapping\n", iterations,
+	       implicit ? "implicit" : "explicit");
+	printf("%-8s %9s %8s %10s %10s\n", "op", "size", "pixels",
+	       "cpu us", "gpu us");
+
+	for (op = 0; op < BENCH_OP_COUNT; op += 1)
+		if (!run_op(op, iterations, max, implicit))
+			ok = false;
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int iterations = 1000;
+	unsigned int max = 256;
+	bool implicit = false;
+	int opt;
+
+	if ((argc > 1) && (strcmp(argv[1], "-v") == 0))
+		return verify((argc > 2) ? (unsigned int) atoi(argv[2]) : 10000);
+
+	while ((opt = getopt(argc, argv, "n:m:i")) != -1) {
+		switch (opt) {
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+
+		case 'm':
+			max = atoi(optarg);
+			break;
+
+		case 'i':
+			implicit = true;
+			break;
+
+		default:
+			fprintf(stderr, "usage: gccpubench [-n iterations] "
+				"[-m max] [-i] | -v [blits]\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	if ((iterations == 0) || (max < 2)) {
+		fprintf(stderr, "iterations must be positive, max at least "
+			"2\n");
+		return EXIT_FAILURE;
+	}
+
+	return benchmark(iterations, max, implicit);
+}
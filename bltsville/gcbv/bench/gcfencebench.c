@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2012,
+ * Texas Instruments, Inc. and Vivante Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Texas Instruments, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL TEXAS INSTRUMENTS, INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * gcfencebench - measures how asynchronous batch completions reach the
+ * client.
+ *
+ * Usage: gcfencebench [-n batches] [-b burst]
+ *
+ * Submits the given number of small asynchronous fills, burst at a time,
+ * and after each burst waits for all of its batches to complete, either
+ * through a callback posting a semaphore per batch or through a completion
+ * fence, as the callback of a bv_blt or handed back by gcbvfence_blt.
+ * Prints, per batch, the time from the last bv_blt of the burst
+ * returning to the client waking up with every batch complete (the
+ * emulator completes batches as they are committed, so this is all
+ * notification latency), the context switches of the whole process and
+ * how many times the client woke up.
+ *
+ * The exit status is non zero if a bv_blt or a wait fails or a completion
+ * goes missing.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <semaphore.h>
+#include <sys/resource.h>
+#include "gcmain.h"
+#include "gcemu.h"
+
+#define SURFACE_SIZE 64
+
+/* Wait given up on, in milliseconds. */
+#define WAIT_TIMEOUT 1000
+
+struct bench_mode {
+	char *name;
+	bool (*init)(struct bvbltparams *params);
+	void (*exit)(void);
+
+	/* Submits one batch. */
+	enum bverror (*blt)(struct bvbltparams *params);
+
+	/* Returns the number of wakeups it took for count batches to
+	 * complete, or -1 on failure. */
+	int (*wait)(unsigned int count);
+};
+
+static unsigned int g_dstbuffer[SURFACE_SIZE * SURFACE_SIZE]
+	__attribute__((aligned(4096)));
+static unsigned int g_solidbuffer[16] __attribute__((aligned(64))) = {
+	0xFF204080
+};
+
+static struct bvbuffdesc g_dstdesc;
+static struct bvsurfgeom g_dstgeom;
+static struct bvbuffdesc g_soliddesc;
+static struct bvsurfgeom g_solidgeom;
+
+static sem_t g_completed;
+static int g_fence = -1;
+
+
+/*******************************************************************************
+ * Notification modes.
+ */
+
+static void callback_post(struct bvcallbackerror *err,
+			  unsigned long callbackdata)
+{
+	sem_post(&g_completed);
+}
+
+static bool init_callback(struct bvbltparams *params)
+{
+	if (sem_init(&g_completed, 0, 0) != 0)
+		return false;
+
+	params->callbackfn = callback_post;
+	params->callbackdata = 0;
+	return true;
+}
+
+static void exit_callback(void)
+{
+	sem_destroy(&g_completed);
+}
+
+static int wait_callback(unsigned int count)
+{
+	struct timespec timeout;
+	unsigned int wakeups = 0;
+
+	clock_gettime(CLOCK_REALTIME, &timeout);
+	timeout.tv_sec += WAIT_TIMEOUT / 1000;
+
+	while (count > 0) {
+		if (sem_timedwait(&g_completed, &timeout) != 0)
+			return -1;
+
+		count -= 1;
+		wakeups += 1;
+	}
+
+	return wakeups;
+}
+
+static bool init_fence(struct bvbltparams *params)
+{
+	g_fence = gcbvfence_create();
+	if (g_fence < 0)
+		return false;
+
+	params->callbackfn = gcbvfence_signal;
+	params->callbackdata = g_fence;
+	return true;
+}
+
+static void exit_fence(void)
+{
+	if (g_fence >= 0)
+		gcbvfence_destroy(g_fence);
+	g_fence = -1;
+}
+
+/* The first gcbvfence_blt creates the fence. */
+static bool init_fenceblt(struct bvbltparams *params)
+{
+	g_fence = -1;
+	return true;
+}
+
+static enum bverror fenceblt(struct bvbltparams *params)
+{
+	return gcbvfence_blt(params, &g_fence);
+}
+
+static int wait_fence(unsigned int count)
+{
+	unsigned int wakeups = 0;
+	int completed;
+
+	while (count > 0) {
+		completed = gcbvfence_wait(g_fence, WAIT_TIMEOUT);
+		if ((completed <= 0) || ((unsigned int) completed > count))
+			return -1;
+
+		count -= completed;
+		wakeups += 1;
+	}
+
+	return wakeups;
+}
+
+static struct bench_mode g_modes[] = {
+	{ "callback", init_callback, exit_callback, bv_blt, wait_callback },
+	{ "fence", init_fence, exit_fence, bv_blt, wait_fence },
+	{ "fenceblt", init_fenceblt, exit_fence, fenceblt, wait_fence },
+};
+
+
+/*******************************************************************************
+ * Benchmark.
+ */
+
+static void surface_init(struct bvbuffdesc *desc, struct bvsurfgeom *geom,
+			 void *buffer, unsigned int size)
+{
+	memset(desc, 0, sizeof(*desc));
+	desc->structsize = sizeof(struct bvbuffdesc);
+	desc->virtaddr = buffer;
+	desc->length = size * size * 4;
+	if (desc->length < 64)
+		desc->length = 64;
+
+	memset(geom, 0, sizeof(*geom));
+	geom->structsize = sizeof(struct bvsurfgeom);
+	geom->format = OCDFMT_RGBA24;
+	geom->width = size;
+	geom->height = size;
+	geom->virtstride = ((size * 4) + 63) & ~63;
+}
+
+static void setup_fill(struct bvbltparams *params)
+{
+	memset(params, 0, sizeof(*params));
+	params->structsize = sizeof(struct bvbltparams);
+	params->flags = BVFLAG_ROP | BVFLAG_ASYNC;
+	params->op.rop = 0xCCCC;
+
+	params->dstdesc = &g_dstdesc;
+	params->dstgeom = &g_dstgeom;
+	params->dstrect.width = SURFACE_SIZE;
+	params->dstrect.height = SURFACE_SIZE;
+
+	params->src1.desc = &g_soliddesc;
+	params->src1geom = &g_solidgeom;
+	params->src1rect.width = 1;
+	params->src1rect.height = 1;
+}
+
+static double get_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static long get_switches(void)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+static bool run_mode(struct bench_mode *mode, unsigned int batches,
+		     unsigned int burst)
+{
+	struct bvbltparams params;
+	double latency = 0.0, submitted;
+	unsigned long long wakeups = 0;
+	unsigned int done, count, i;
+	long switches;
+	int result;
+
+	setup_fill(&params);
+	if (!mode->init(&params)) {
+		printf("%-10s init failed\n", mode->name);
+		return false;
+	}
+
+	switches = get_switches();
+
+	for (done = 0; done < batches; done += count) {
+		count = min(burst, batches - done);
+
+		for (i = 0; i < count; i += 1)
+			if (mode->blt(&params) != BVERR_NONE) {
+				printf("%-10s bv_blt failed: %s\n", mode->name,
+				       params.errdesc ? params.errdesc : "");
+				mode->exit();
+				return false;
+			}
+
+		submitted = get_time();
+
+		result = mode->wait(count);
+		if (result < 0) {
+			printf("%-10s completions missing after batch %u\n",
+			       mode->name, done);
+			mode->exit();
+			return false;
+		}
+
+		latency += get_time() - submitted;
+		wakeups += result;
+	}
+
+	switches = get_switches() - switches;
+	mode->exit();
+
+	printf("%-10s %7u %5u %10.2f %10.2f %10.2f\n",
+	       mode->name, batches, burst, latency / batches,
+	       (double) switches / batches, (double) wakeups / batches);
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int batches = 10000;
+	unsigned int burst = 1;
+	unsigned int i;
+	bool ok = true;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:b:")) != -1) {
+		switch (opt) {
+		case 'n':
+			batches = atoi(optarg);
+			break;
+
+		case 'b':
+			burst = atoi(optarg);
+			break;
+
+		default:
+			fprintf(stderr, "usage: gcfencebench "
+				"[-n batches] [-b burst]\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	if ((batches == 0) || (burst == 0)) {
+		fprintf(stderr, "batches and burst must be positive\n");
+		return EXIT_FAILURE;
+	}
+
+	surface_init(&g_dstdesc, &g_dstgeom, g_dstbuffer, SURFACE_SIZE);
+	surface_init(&g_soliddesc, &g_solidgeom, g_solidbuffer, 1);
+
+	if ((bv_map(&g_dstdesc) != BVERR_NONE) ||
+	    (bv_map(&g_soliddesc) != BVERR_NONE)) {
+		fprintf(stderr, "bv_map failed\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("%-10s %7s %5s %10s %10s %10s\n", "mode", "batches", "burst",
+	       "latency us", "switches", "wakeups");
+
+	for (i = 0; i < countof(g_modes); i += 1)
+		if (!run_mode(&g_modes[i], batches, burst))
+			ok = false;
+
+	bv_unmap(&g_soliddesc);
+	bv_unmap(&g_dstdesc);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2012,
+ * Texas Instruments, Inc. and Vivante Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Texas Instruments, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL TEXAS INSTRUMENTS, INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * gcfiltergen - generates, checks and measures the filter kernel presets.
+ *
+ * Usage: gcfiltergen > mirror/gcfilterpreset.h
+ *        gcfiltergen -v [max]
+ *        gcfiltergen -b [iterations]
+ *
+ * Without options prints the preset table for the ratios below. -v checks
+ * that the presets and every kernel handed out by the filter kernel store,
+ * for all source and destination sizes up to max (256 by default) and with
+ * the runtime cache disabled, tiny and at its default size, are identical
+ * to the computed ones. -b prints the cost of computing a kernel against
+ * the cost of a preset and of a cache hit.
+ *
+ * Regenerate the table whenever calculate_sync_filter changes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Built with the rest of the library, minus gcfilter.c. */
+#include "gcfilter.c"
+
+/* Destination to source ratios the presets are computed for: identity
+ * (and all upscales), then the common panel, video and thumbnail
+ * downscales. */
+static const struct {
+	unsigned int dst;
+	unsigned int src;
+} g_ratios[] = {
+	{ 1, 1 },
+	{ 4, 5 },
+	{ 3, 4 },
+	{ 2, 3 },
+	{ 5, 8 },
+	{ 9, 16 },
+	{ 1, 2 },
+	{ 4, 9 },
+	{ 3, 8 },
+	{ 1, 3 },
+	{ 1, 4 },
+};
+
+static const unsigned int g_kernelsizes[] = { 1, 3, 5, 7, 9 };
+
+static int compare_scale(const void *a, const void *b)
+{
+	GC_SCALE_TYPE scalea = *(const GC_SCALE_TYPE *) a;
+	GC_SCALE_TYPE scaleb = *(const GC_SCALE_TYPE *) b;
+
+	return (scalea > scaleb) - (scalea < scaleb);
+}
+
+/* Fills scales with the distinct preset scales for the kernel size in
+ * ascending order, returns their number. */
+static unsigned int get_preset_scales(unsigned int kernelsize,
+				      GC_SCALE_TYPE *scales)
+{
+	unsigned int count = 0;
+	unsigned int i, j;
+	GC_SCALE_TYPE scale;
+
+	for (i = 0; i < countof(g_ratios); i += 1) {
+		scale = get_filter_scale(kernelsize,
+					 g_ratios[i].src, g_ratios[i].dst);
+
+		for (j = 0; j < count; j += 1)
+			if (scales[j] == scale)
+				break;
+
+		if (j == count)
+			scales[count++] = scale;
+	}
+
+	qsort(scales, count, sizeof(GC_SCALE_TYPE), compare_scale);
+	return count;
+}
+
+static void generate(void)
+{
+	GC_SCALE_TYPE scales[countof(g_ratios)];
+	short kernelarray[GC_COEFFICIENT_COUNT];
+	unsigned int count;
+	unsigned int i, j, k;
+
+	printf("/*\n"
+	       " * Generated by gcfiltergen, do not edit.\n"
+	       " *\n"
+	       " * SINC filter kernels for the common scale ratios, sorted"
+	       " by kernel size\n"
+	       " * and scale. Must match what calculate_sync_filter computes;"
+	       " regenerate\n"
+	       " * with \"gcfiltergen > mirror/gcfilterpreset.h\" and check"
+	       " with \"gcfiltergen -v\".\n"
+	       " */\n"
+	       "\n"
+	       "#ifndef GCFILTERPRESET_H\n"
+	       "#define GCFILTERPRESET_H\n"
+	       "\n"
+	       "static const struct gcfilterpreset gcfilterpresets[] = {\n");
+
+	for (i = 0; i < countof(g_kernelsizes); i += 1) {
+		count = get_preset_scales(g_kernelsizes[i], scales);
+
+		for (j = 0; j < count; j += 1) {
+			calculate_sync_filter(g_kernelsizes[i], scales[j],
+					      kernelarray);
+
+			printf("\t{\n\t\t%u, 0x%08X,\n\t\t{",
+			       g_kernelsizes[i], scales[j]);
+
+			for (k = 0; k < GC_COEFFICIENT_COUNT; k += 1) {
+				if ((k % GC_TAP_COUNT) == 0)
+					printf("\n\t\t\t");
+				else
+					printf(" ");
+
+				printf("%d,", kernelarray[k]);
+			}
+
+			printf("\n\t\t}\n\t},\n");
+		}
+	}
+
+	printf("};\n"
+	       "\n"
+	       "#endif\n");
+}
+
+/* Walks all the size pairs up to max, from the smallest or the largest. */
+static unsigned int check_store(unsigned int max, bool reverse)
+{
+	short expected[GC_COEFFICIENT_COUNT];
+	short kernelarray[GC_COEFFICIENT_COUNT];
+	unsigned int errors = 0;
+	unsigned int i, x, y;
+	unsigned int kernelsize, srcsize, dstsize;
+	GC_SCALE_TYPE scale;
+
+	for (i = 0; i < countof(g_kernelsizes); i += 1) {
+		kernelsize = g_kernelsizes[i];
+
+		for (x = 1; x <= max; x += 1) {
+			for (y = 1; y <= max; y += 1) {
+				srcsize = reverse ? (max + 1 - x) : x;
+				dstsize = reverse ? (max + 1 - y) : y;
+
+				/* What load_filter used to compute, without
+				 * the "filter off" shortcut. */
+				scale = (dstsize >= srcsize)
+				      ? GC_SCALE_ONE
+				      : computescale(dstsize, srcsize);
+				calculate_sync_filter(kernelsize, scale,
+						      expected);
+
+				scale = get_filter_scale(kernelsize,
+							 srcsize, dstsize);
+				get_filter_kernel(GC_FILTER_SYNC, kernelsize,
+						  scale, kernelarray);
+
+				if (memcmp(kernelarray, expected,
+					   sizeof(expected)) == 0)
+					continue;
+
+				if (errors++ < 10)
+					fprintf(stderr,
+						"mismatch: %u taps, %u -> %u\n",
+						kernelsize, srcsize, dstsize);
+			}
+		}
+	}
+
+	return errors;
+}
+
+static int verify(unsigned int max)
+{
+	static const unsigned int cachesizes[] = { 0, 3, GC_FILTER_CACHE_MAX };
+	struct gccontext *gccontext = get_context();
+	short kernelarray[GC_COEFFICIENT_COUNT];
+	unsigned int errors = 0;
+	unsigned int i;
+
+	/* The table itself. */
+	for (i = 0; i < countof(gcfilterpresets); i += 1) {
+		if ((i > 0) &&
+		    ((gcfilterpresets[i - 1].kernelsize >
+		      gcfilterpresets[i].kernelsize) ||
+		     ((gcfilterpresets[i - 1].kernelsize ==
+		       gcfilterpresets[i].kernelsize) &&
+		      (gcfilterpresets[i - 1].scale >=
+		       gcfilterpresets[i].scale)))) {
+			fprintf(stderr, "preset %u out of order\n", i);
+			errors += 1;
+		}
+
+		calculate_sync_filter(gcfilterpresets[i].kernelsize,
+				      gcfilterpresets[i].scale,
+				      kernelarray);
+
+		if (memcmp(kernelarray, gcfilterpresets[i].kernelarray,
+			   sizeof(kernelarray)) != 0) {
+			fprintf(stderr, "preset %u (%u taps, 0x%08X) is stale\n",
+				i, gcfilterpresets[i].kernelsize,
+				gcfilterpresets[i].scale);
+			errors += 1;
+		}
+	}
+
+	/* The store, going through misses, hits and evictions. */
+	for (i = 0; i < countof(cachesizes); i += 1) {
+		free_filtercache();
+		gccontext->filtercache.max = cachesizes[i];
+
+		errors += check_store(max, false);
+		errors += check_store(max, true);
+
+		if (gccontext->filtercache.count > cachesizes[i]) {
+			fprintf(stderr, "cache holds %u kernels, max %u\n",
+				gccontext->filtercache.count, cachesizes[i]);
+			errors += 1;
+		}
+	}
+
+	printf("%u presets, sizes up to %u: %s\n",
+	       (unsigned int) countof(gcfilterpresets), max,
+	       errors ? "FAILED" : "ok");
+
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static double get_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int benchmark(unsigned int iterations)
+{
+	struct gccontext *gccontext = get_context();
+	short kernelarray[GC_COEFFICIENT_COUNT];
+	double computed, preset, cached, start;
+	unsigned int i, j;
+	unsigned int kernelsize;
+	GC_SCALE_TYPE presetscale, cachedscale;
+
+	/* 1:2 is a preset, 480 -> 317 is not. */
+	presetscale = computescale(1, 2);
+	cachedscale = computescale(317, 480);
+
+	free_filtercache();
+	gccontext->filtercache.max = GC_FILTER_CACHE_MAX;
+
+	printf("taps   computed ns   preset ns   cached ns\n");
+
+	for (i = 1; i < countof(g_kernelsizes); i += 1) {
+		kernelsize = g_kernelsizes[i];
+
+		start = get_time();
+		for (j = 0; j < iterations; j += 1)
+			calculate_sync_filter(kernelsize, cachedscale,
+					      kernelarray);
+		computed = (get_time() - start) / iterations;
+
+		start = get_time();
+		for (j = 0; j < iterations; j += 1)
+			get_filter_kernel(GC_FILTER_SYNC, kernelsize,
+					  presetscale, kernelarray);
+		preset = (get_time() - start) / iterations;
+
+		start = get_time();
+		for (j = 0; j < iterations; j += 1)
+			get_filter_kernel(GC_FILTER_SYNC, kernelsize,
+					  cachedscale, kernelarray);
+		cached = (get_time() - start) / iterations;
+
+		printf("%4u   %11.0f   %9.0f   %9.0f\n",
+		       kernelsize, computed, preset, cached);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc == 1) {
+		generate();
+		return EXIT_SUCCESS;
+	}
+
+	if (strcmp(argv[1], "-v") == 0)
+		return verify((argc > 2) ? (unsigned int) atoi(argv[2]) : 256);
+
+	if (strcmp(argv[1], "-b") == 0)
+		return benchmark((argc > 2)
+				 ? (unsigned int) atoi(argv[2]) : 10000);
+
+	fprintf(stderr, "usage: gcfiltergen [-v [max] | -b [iterations]]\n");
+	return EXIT_FAILURE;
+}
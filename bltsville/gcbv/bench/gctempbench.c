@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2012,
+ * Texas Instruments, Inc. and Vivante Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Texas Instruments, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL TEXAS INSTRUMENTS, INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * gctempbench - measures the temporary surface pool on top of the
+ * in-process emulator.
+ *
+ * Usage: gctempbench [-n iterations]
+ *
+ * Runs two pass (9 tap) scale blits of a 640x480 source to destination
+ * rectangles of SCALE_SIZES different sizes in turn, so that every blit
+ * needs a temporary surface of another size than the one before. Each
+ * run is done synchronously and asynchronously, with the default pool
+ * budget and with none, which frees every surface as soon as another
+ * size is asked for, the way a single temporary surface used to be
+ * replaced. Each run starts from an empty pool and map cache once the
+ * callbacks of the run before have all returned. Prints the wall time per blit in microseconds, the
+ * GCIOCTL_MAP and GCIOCTL_UNMAP calls per blit, and the bytes the pool
+ * holds at the end.
+ *
+ * The exit status is non zero if a bv_blt fails, an asynchronous batch
+ * does not complete or its temporary surfaces do not come back to the
+ * pool.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <semaphore.h>
+#include "gcmain.h"
+#include "gcemu.h"
+#include "gcbv.h"
+
+#define SOURCE_WIDTH	640
+#define SOURCE_HEIGHT	480
+#define SCALE_SIZES	3
+
+/* Wait given up on, in milliseconds. */
+#define WAIT_TIMEOUT	1000
+
+static const struct {
+	unsigned int width;
+	unsigned int height;
+} g_sizes[SCALE_SIZES] = {
+	{ 200, 150 },
+	{ 1280, 720 },
+	{ 500, 700 },
+};
+
+struct bench_surface {
+	struct bvbuffdesc desc;
+	struct bvsurfgeom geom;
+};
+
+static struct bench_surface g_src;
+static struct bench_surface g_dst;
+
+static sem_t g_completed;
+
+
+/*******************************************************************************
+ * Surfaces.
+ */
+
+static bool surface_alloc(struct bench_surface *surface,
+			  unsigned int width, unsigned int height)
+{
+	memset(surface, 0, sizeof(*surface));
+
+	surface->geom.structsize = sizeof(struct bvsurfgeom);
+	surface->geom.format = OCDFMT_RGBA24;
+	surface->geom.width = width;
+	surface->geom.height = height;
+	surface->geom.virtstride = width * 4;
+
+	surface->desc.structsize = sizeof(struct bvbuffdesc);
+	surface->desc.length = surface->geom.virtstride * height;
+
+	if (posix_memalign(&surface->desc.virtaddr, 4096,
+			   surface->desc.length) != 0) {
+		surface->desc.virtaddr = NULL;
+		return false;
+	}
+
+	memset(surface->desc.virtaddr, 0x80, surface->desc.length);
+	return bv_map(&surface->desc) == BVERR_NONE;
+}
+
+static void surface_free(struct bench_surface *surface)
+{
+	if (surface->desc.map != NULL)
+		bv_unmap(&surface->desc);
+
+	free(surface->desc.virtaddr);
+	surface->desc.virtaddr = NULL;
+}
+
+
+/*******************************************************************************
+ * Pool state.
+ */
+
+static void get_pool(unsigned int *size, unsigned int *idle)
+{
+	struct gccontext *gccontext = get_context();
+	struct list_head *head;
+
+	GCLOCK(&gccontext->templock);
+
+	*size = gccontext->temppool.size;
+	*idle = 0;
+
+	list_for_each(head, &gccontext->temppool.lru) {
+		struct gctempsurface *gctempsurface
+			= list_entry(head, struct gctempsurface, lrulink);
+
+		if (gctempsurface->refcount == 0)
+			*idle += gctempsurface->desc->length;
+	}
+
+	GCUNLOCK(&gccontext->templock);
+}
+
+/* Asynchronous batches let go of their surfaces after the client
+ * callback. */
+static bool wait_pool(void)
+{
+	unsigned int size, idle;
+	unsigned int i;
+
+	for (i = 0; i < WAIT_TIMEOUT; i += 1) {
+		get_pool(&size, &idle);
+		if (size == idle)
+			return true;
+
+		usleep(1000);
+	}
+
+	return false;
+}
+
+
+/*******************************************************************************
+ * Runs.
+ */
+
+static void callback_post(struct bvcallbackerror *err,
+			  unsigned long callbackdata)
+{
+	sem_post(&g_completed);
+}
+
+static bool wait_completed(unsigned int count)
+{
+	struct timespec timeout;
+
+	clock_gettime(CLOCK_REALTIME, &timeout);
+	timeout.tv_sec += WAIT_TIMEOUT / 1000;
+
+	while (count > 0) {
+		if (sem_timedwait(&g_completed, &timeout) != 0)
+			return false;
+
+		count -= 1;
+	}
+
+	return true;
+}
+
+/* Callbacks run one after the other on the callback thread, so once a
+ * marker blit has called back every batch before it is done with its
+ * own callback. */
+static bool flush_callbacks(void)
+{
+	struct bvbltparams params;
+
+	memset(&params, 0, sizeof(params));
+	params.structsize = sizeof(struct bvbltparams);
+	params.flags = BVFLAG_ROP | BVFLAG_ASYNC;
+	params.op.rop = 0xCCCC;
+	params.dstdesc = &g_dst.desc;
+	params.dstgeom = &g_dst.geom;
+	params.dstrect.width = 1;
+	params.dstrect.height = 1;
+	params.src1.desc = &g_src.desc;
+	params.src1geom = &g_src.geom;
+	params.src1rect.width = 1;
+	params.src1rect.height = 1;
+	params.callbackfn = callback_post;
+
+	return (bv_blt(&params) == BVERR_NONE) && wait_completed(1);
+}
+
+static double get_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static bool run(unsigned int iterations, bool async, unsigned int budget)
+{
+	struct bvbltparams params;
+	struct gcemustats stats;
+	unsigned int i, size, idle;
+	double start, time;
+	const char *mode;
+
+	memset(&params, 0, sizeof(params));
+	params.structsize = sizeof(struct bvbltparams);
+	params.flags = BVFLAG_ROP | (async ? BVFLAG_ASYNC : 0);
+	params.op.rop = 0xCCCC;
+	params.scalemode = BVSCALE_BEST;
+	params.dstdesc = &g_dst.desc;
+	params.dstgeom = &g_dst.geom;
+	params.src1.desc = &g_src.desc;
+	params.src1geom = &g_src.geom;
+	params.src1rect.width = SOURCE_WIDTH;
+	params.src1rect.height = SOURCE_HEIGHT;
+
+	if (async) {
+		params.callbackfn = callback_post;
+		params.callbackdata = 0;
+	}
+
+	/* Start from an empty pool and map cache, with nothing of the
+	 * previous run left to count against this one. */
+	if (!wait_pool() || !flush_callbacks()) {
+		fprintf(stderr, "previous run did not complete.\n");
+		return false;
+	}
+
+	free_temppool();
+	free_mapcache();
+	get_context()->temppool.budget = budget;
+
+	gcemu_getstats(&stats, true);
+	start = get_time();
+
+	for (i = 0; i < iterations; i += 1) {
+		params.dstrect.width = g_sizes[i % SCALE_SIZES].width;
+		params.dstrect.height = g_sizes[i % SCALE_SIZES].height;
+
+		if (bv_blt(&params) != BVERR_NONE) {
+			fprintf(stderr, "bv_blt failed: %s\n",
+				params.errdesc ? params.errdesc : "");
+			return false;
+		}
+	}
+
+	if (async && !wait_completed(iterations)) {
+		fprintf(stderr, "batches did not complete.\n");
+		return false;
+	}
+
+	time = (get_time() - start) / iterations;
+
+	/* The unmaps done as the surfaces come back, and those of the
+	 * mappings the next batch would evict, belong to this run. */
+	if (!wait_pool() || !flush_callbacks()) {
+		fprintf(stderr, "temporary surfaces not returned.\n");
+		return false;
+	}
+
+	gcemu_getstats(&stats, false);
+	get_pool(&size, &idle);
+
+	mode = async ? "async" : "sync";
+	printf("%-6s %-8s %10.2f %8.2f %8.2f %10u\n", mode,
+	       budget ? "pool" : "none", time,
+	       (double) stats.maps / iterations,
+	       (double) stats.unmaps / iterations, size);
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int iterations = 300;
+	unsigned int budget;
+	bool ok = false;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+
+		default:
+			fprintf(stderr, "usage: gctempbench [-n iterations]\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (iterations == 0) {
+		fprintf(stderr, "iterations must be positive\n");
+		return EXIT_FAILURE;
+	}
+
+	if (sem_init(&g_completed, 0, 0) != 0)
+		return EXIT_FAILURE;
+
+	if (!surface_alloc(&g_src, SOURCE_WIDTH, SOURCE_HEIGHT) ||
+	    !surface_alloc(&g_dst, 1280, 720)) {
+		fprintf(stderr, "failed to set up the surfaces.\n");
+		goto exit;
+	}
+
+	budget = get_context()->temppool.budget;
+
+	printf("%u iterations, %ux%u to", iterations,
+	       SOURCE_WIDTH, SOURCE_HEIGHT);
+	for (opt = 0; opt < SCALE_SIZES; opt += 1)
+		printf(" %ux%u", g_sizes[opt].width, g_sizes[opt].height);
+	printf("\n%-6s %-8s %10s %8s %8s %10s\n", "mode", "budget",
+	       "us/blit", "maps", "unmaps", "pool bytes");
+
+	ok = run(iterations, false, budget) &&
+	     run(iterations, false, 0) &&
+	     run(iterations, true, budget) &&
+	     run(iterations, true, 0);
+
+exit:
+	surface_free(&g_dst);
+	surface_free(&g_src);
+	sem_destroy(&g_completed);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
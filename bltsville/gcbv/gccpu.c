@@ -0,0 +1,795 @@
+/*
+ * Copyright (c) 2012,
+ * Texas Instruments, Inc. and Vivante Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Texas Instruments, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL TEXAS INSTRUMENTS, INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gcmain.h"
+#include "gcbv.h"
+#include "gccpu.h"
+#include <pthread.h>
+
+#define GCZONE_NONE		0
+#define GCZONE_ALL		(~0U)
+#define GCZONE_BLIT		(1 << 0)
+#define GCZONE_DISPATCH		(1 << 1)
+
+GCDBG_FILTERDEF(cpu, GCZONE_NONE,
+		"blit",
+		"dispatch")
+
+
+/*******************************************************************************
+ * Dispatcher state.
+ */
+
+/* Default threshold, in fill pixels. */
+#define GC_CPU_THRESHOLD	8192
+
+/* Cost of a pixel relative to a fill pixel, measured with gccpubench. */
+#define GC_CPU_COST_FILL	1
+#define GC_CPU_COST_COPY	2
+#define GC_CPU_COST_ROTATE	4
+#define GC_CPU_COST_BLEND	32
+
+/* Threshold scale when a surface has no GPU mapping yet. */
+#define GC_CPU_UNMAPPED		2
+
+struct gccpustate {
+	unsigned int threshold;
+
+	/* Asynchronous batches committed, and how many of them are known to
+	 * be complete. Each one is retired by a callback armed behind it;
+	 * the GPU runs batches in commit order, so those committed before a
+	 * synchronous batch are complete once it is as well. */
+	pthread_mutex_t lock;
+	unsigned int queued;
+	unsigned int done;
+};
+
+static struct gccpustate g_cpu = {
+	.threshold = GC_CPU_THRESHOLD,
+	.lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+enum gccpuop {
+	GC_CPU_FILL,
+	GC_CPU_COPY,
+	GC_CPU_BLEND
+};
+
+struct gccpusurface {
+	struct bvbuffdesc *desc;
+	struct bvsurfgeom *geom;
+	struct bvformatxlate format;
+
+	/* Orientation in quarter turns counter clockwise. */
+	unsigned int angle;
+
+	/* Bytes per pixel. */
+	unsigned int bpp;
+
+	/* Address of the top left pixel of the rectangle and the address
+	 * steps to the pixel on its right and to the one below it, all in
+	 * the orientation of the surface. */
+	unsigned char *origin;
+	long xstep;
+	long ystep;
+};
+
+/* A rectangle walked as runs of pixels adjacent in destination memory. */
+struct gccpuwalk {
+	unsigned int count;		/* pixels per run */
+	unsigned int runs;
+
+	unsigned char *dst;
+	long dstnext;			/* step to the next pixel */
+	long dstrun;			/* step to the next run */
+
+	unsigned char *src[2];
+	long srcnext[2];
+	long srcrun[2];
+};
+
+
+/*******************************************************************************
+ * Surface parsing.
+ */
+
+static bool get_surface(struct bvbltparams *bvbltparams,
+			struct bvbuffdesc *desc,
+			struct bvsurfgeom *geom,
+			struct gccpusurface *surface)
+{
+	struct surfaceinfo surfaceinfo;
+	unsigned int physwidth, physheight;
+	int orientation;
+
+	if ((desc == NULL) || (desc->structsize < STRUCTSIZE(desc, map)) ||
+	    (desc->virtaddr == NULL))
+		return false;
+
+	/* Buffers described by their pages may have no CPU mapping. */
+	if ((desc->structsize >= STRUCTSIZE(desc, auxptr)) &&
+	    (desc->auxtype != BVAT_NONE))
+		return false;
+
+	if ((geom == NULL) || (geom->structsize < STRUCTSIZE(geom, palette)))
+		return false;
+
+	surfaceinfo.geom = geom;
+	if (parse_format(bvbltparams, &surfaceinfo) != BVERR_NONE)
+		return false;
+
+	if ((surfaceinfo.format.type != BVFMT_RGB) ||
+	    ((surfaceinfo.format.bitspp != 16) &&
+	     (surfaceinfo.format.bitspp != 32)))
+		return false;
+
+	orientation = geom->orientation % 360;
+	if (orientation < 0)
+		orientation += 360;
+
+	if ((orientation % 90) != 0)
+		return false;
+
+	surface->desc = desc;
+	surface->geom = geom;
+	surface->format = surfaceinfo.format;
+	surface->angle = orientation / 90;
+	surface->bpp = surfaceinfo.format.bitspp / 8;
+
+	if ((surface->angle % 2) == 0) {
+		physwidth = geom->width;
+		physheight = geom->height;
+	} else {
+		physwidth = geom->height;
+		physheight = geom->width;
+	}
+
+	/* What parse_destination and parse_source insist on. */
+	if ((geom->virtstride <= 0) ||
+	    ((geom->virtstride & (surface->format.bitspp - 1)) != 0))
+		return false;
+
+	if ((physwidth * surface->bpp > (unsigned long) geom->virtstride) ||
+	    (physheight * geom->virtstride > desc->length) ||
+	    (geom->width * geom->height * surface->format.allocbitspp / 8 >
+	     desc->length))
+		return false;
+
+	return true;
+}
+
+/* Points the surface at the rectangle, false if it is outside. */
+static bool set_rect(struct gccpusurface *surface, int left, int top,
+		     int width, int height)
+{
+	struct bvsurfgeom *geom = surface->geom;
+	long stride = geom->virtstride;
+	long bpp = surface->bpp;
+	int x, y;
+
+	if ((left < 0) || (top < 0) || (width <= 0) || (height <= 0) ||
+	    (left + width > (int) geom->width) ||
+	    (top + height > (int) geom->height))
+		return false;
+
+	/* Physical position of the logical pixel, the way gcblit.c computes
+	 * the source surface shift. */
+	switch (surface->angle) {
+	case ROT_ANGLE_0:
+		x = left;
+		y = top;
+		surface->xstep = bpp;
+		surface->ystep = stride;
+		break;
+
+	case ROT_ANGLE_90:
+		x = top;
+		y = geom->width - 1 - left;
+		surface->xstep = -stride;
+		surface->ystep = bpp;
+		break;
+
+	case ROT_ANGLE_180:
+		x = geom->width - 1 - left;
+		y = geom->height - 1 - top;
+		surface->xstep = -bpp;
+		surface->ystep = -stride;
+		break;
+
+	default:
+		x = geom->height - 1 - top;
+		y = left;
+		surface->xstep = stride;
+		surface->ystep = -bpp;
+	}
+
+	surface->origin = (unsigned char *) surface->desc->virtaddr
+			+ y * stride + x * bpp;
+
+	return true;
+}
+
+/* Physical extent of a width x height rectangle set with set_rect. */
+static void get_region(struct gccpusurface *surface, unsigned int width,
+		       unsigned int height, struct c2dmrgn *rgn)
+{
+	long right = (long) (width - 1) * surface->xstep;
+	long down = (long) (height - 1) * surface->ystep;
+
+	rgn->start = (char *) surface->origin + min(right, 0L) + min(down, 0L);
+	rgn->stride = surface->geom->virtstride;
+
+	if ((surface->angle % 2) == 0) {
+		rgn->span = width * surface->bpp;
+		rgn->lines = height;
+	} else {
+		rgn->span = height * surface->bpp;
+		rgn->lines = width;
+	}
+}
+
+static bool overlap(struct bvbuffdesc *desc1, struct bvbuffdesc *desc2)
+{
+	unsigned char *start1 = desc1->virtaddr;
+	unsigned char *start2 = desc2->virtaddr;
+
+	return (start1 < start2 + desc2->length) &&
+	       (start2 < start1 + desc1->length);
+}
+
+/* Same pixels, the way same_phys_area finds a source that is the
+ * destination. */
+static bool same_area(struct gccpusurface *surface1, struct bvrect *rect1,
+		      struct gccpusurface *surface2, struct bvrect *rect2)
+{
+	return (surface1->desc->virtaddr == surface2->desc->virtaddr) &&
+	       (surface1->geom->virtstride == surface2->geom->virtstride) &&
+	       (surface1->angle == surface2->angle) &&
+	       (rect1->left == rect2->left) && (rect1->top == rect2->top) &&
+	       (rect1->width == rect2->width) &&
+	       (rect1->height == rect2->height);
+}
+
+static bool mapped(struct gccpusurface *surface)
+{
+	return surface->desc->map != NULL;
+}
+
+
+/*******************************************************************************
+ * Pixel operations.
+ */
+
+/* Fill color as the destination pixel; the GC320 drops the low bits of
+ * each component and writes the alpha into the unused byte of xRGB. */
+static unsigned int get_fill_pixel(unsigned int color,
+				   struct bvformatxlate *format)
+{
+	const struct bvcsrgb *comp = format->cs.rgb.comp;
+	unsigned int a = color >> 24;
+	unsigned int r = (color >> 16) & 0xFF;
+	unsigned int g = (color >> 8) & 0xFF;
+	unsigned int b = color & 0xFF;
+
+	if (format->bitspp == 32)
+		return (a << comp->a.shift) | (r << comp->r.shift) |
+		       (g << comp->g.shift) | (b << comp->b.shift);
+
+	return ((r >> (8 - comp->r.size)) << comp->r.shift) |
+	       ((g >> (8 - comp->g.size)) << comp->g.shift) |
+	       ((b >> (8 - comp->b.size)) << comp->b.shift);
+}
+
+/* Fill destinations are the formats get_fill_pixel converts to. */
+static bool valid_fill(struct bvformatxlate *format)
+{
+	const struct bvcsrgb *comp = format->cs.rgb.comp;
+
+	if (format->bitspp == 32)
+		return (comp->r.size == 8) && (comp->g.size == 8) &&
+		       (comp->b.size == 8);
+
+	return (comp->r.size == 5) && (comp->g.size == 6) &&
+	       (comp->b.size == 5);
+}
+
+/* Premultiplied source over destination, Cd = Cs + Cd * (1 - As) on every
+ * channel, alpha included, rounded to nearest and saturated. Two channels
+ * at a time, each in a 16 bit lane: x * (255 - As) + 128 stays below 65536
+ * and (t + (t >> 8)) >> 8 of it is the rounded division by 255. */
+static inline unsigned int blend_pixel(unsigned int src, unsigned int dst,
+				       unsigned int alphashift)
+{
+	unsigned int inverse = 255 - ((src >> alphashift) & 0xFF);
+	unsigned int rb, ag, carry;
+
+	if (inverse == 0)
+		return src;
+
+	rb = (dst & 0x00FF00FF) * inverse + 0x00800080;
+	rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+	rb += src & 0x00FF00FF;
+
+	ag = ((dst >> 8) & 0x00FF00FF) * inverse + 0x00800080;
+	ag = ((ag + ((ag >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+	ag += (src >> 8) & 0x00FF00FF;
+
+	/* Saturate the lanes that went past 255. */
+	carry = rb & 0x01000100;
+	rb = (rb | (carry - (carry >> 8))) & 0x00FF00FF;
+
+	carry = ag & 0x01000100;
+	ag = (ag | (carry - (carry >> 8))) & 0x00FF00FF;
+
+	return rb | (ag << 8);
+}
+
+
+/*******************************************************************************
+ * Blitters.
+ */
+
+static void get_walk(struct gccpusurface *dst, struct gccpusurface *src[],
+		     unsigned int srccount, unsigned int width,
+		     unsigned int height, struct gccpuwalk *walk)
+{
+	/* Runs go along the destination rows; when the destination is
+	 * rotated by a quarter turn they are logical columns. */
+	bool columns = (dst->angle % 2) != 0;
+	unsigned int i;
+
+	walk->count = columns ? height : width;
+	walk->runs = columns ? width : height;
+
+	walk->dst = dst->origin;
+	walk->dstnext = columns ? dst->ystep : dst->xstep;
+	walk->dstrun = columns ? dst->xstep : dst->ystep;
+
+	for (i = 0; i < srccount; i += 1) {
+		walk->src[i] = src[i]->origin;
+		walk->srcnext[i] = columns ? src[i]->ystep : src[i]->xstep;
+		walk->srcrun[i] = columns ? src[i]->xstep : src[i]->ystep;
+	}
+}
+
+/* First byte of a run that may go backwards in memory. */
+static inline unsigned char *get_run_start(unsigned char *ptr, long next,
+					   unsigned int count)
+{
+	return (next < 0) ? ptr + (long) (count - 1) * next : ptr;
+}
+
+static void fill(struct gccpuwalk *walk, unsigned int bpp,
+		 unsigned int pixel)
+{
+	unsigned char *dst = walk->dst;
+	unsigned char *first;
+	unsigned int size = walk->count * bpp;
+	unsigned int filled, run;
+
+	/* Store one pixel and double it up to the first run, then copy
+	 * that run to the others; memcpy beats a loop of pixel stores. */
+	first = get_run_start(dst, walk->dstnext, walk->count);
+
+	if (bpp == 4)
+		*(unsigned int *) first = pixel;
+	else
+		*(unsigned short *) first = (unsigned short) pixel;
+
+	for (filled = bpp; filled < size; filled *= 2)
+		memcpy(first + filled, first, min(filled, size - filled));
+
+	for (run = 1; run < walk->runs; run += 1) {
+		dst += walk->dstrun;
+		memcpy(get_run_start(dst, walk->dstnext, walk->count),
+		       first, size);
+	}
+}
+
+static void copy(struct gccpuwalk *walk, unsigned int bpp)
+{
+	unsigned char *dst = walk->dst;
+	unsigned char *src = walk->src[0];
+	long dstnext = walk->dstnext;
+	long srcnext = walk->srcnext[0];
+	unsigned int run, i;
+
+	for (run = 0; run < walk->runs; run += 1,
+	     dst += walk->dstrun, src += walk->srcrun[0]) {
+		unsigned char *d = dst, *s = src;
+
+		/* Same orientation: the run is contiguous in both. */
+		if (dstnext == srcnext) {
+			memcpy(get_run_start(dst, dstnext, walk->count),
+			       get_run_start(src, srcnext, walk->count),
+			       walk->count * bpp);
+			continue;
+		}
+
+		if (bpp == 4)
+			for (i = 0; i < walk->count; i += 1,
+			     d += dstnext, s += srcnext)
+				*(unsigned int *) d = *(unsigned int *) s;
+		else
+			for (i = 0; i < walk->count; i += 1,
+			     d += dstnext, s += srcnext)
+				*(unsigned short *) d = *(unsigned short *) s;
+	}
+}
+
+/* src[0] over src[1] into the destination; src[1] may be the destination
+ * itself. 32 bit only. */
+static void blend(struct gccpuwalk *walk, unsigned int alphashift)
+{
+	unsigned char *dst = walk->dst;
+	unsigned char *src1 = walk->src[0];
+	unsigned char *src2 = walk->src[1];
+	unsigned int run, i;
+
+	for (run = 0; run < walk->runs; run += 1, dst += walk->dstrun,
+	     src1 += walk->srcrun[0], src2 += walk->srcrun[1]) {
+		unsigned char *d = dst, *s1 = src1, *s2 = src2;
+
+		if ((walk->srcnext[0] == 4) && (walk->srcnext[1] == 4) &&
+		    (walk->dstnext == 4)) {
+			unsigned int *d32 = (unsigned int *) d;
+			unsigned int *s132 = (unsigned int *) s1;
+			unsigned int *s232 = (unsigned int *) s2;
+
+			for (i = 0; i < walk->count; i += 1)
+				d32[i] = blend_pixel(s132[i], s232[i],
+						     alphashift);
+			continue;
+		}
+
+		for (i = 0; i < walk->count; i += 1, d += walk->dstnext,
+		     s1 += walk->srcnext[0], s2 += walk->srcnext[1])
+			*(unsigned int *) d
+				= blend_pixel(*(unsigned int *) s1,
+					      *(unsigned int *) s2,
+					      alphashift);
+	}
+}
+
+
+/*******************************************************************************
+ * Dispatcher.
+ */
+
+/* Reads the fill color the way getfillcolor does. */
+static unsigned int get_fill_color(struct gccpusurface *src,
+				   struct bvrect *rect)
+{
+	unsigned char *ptr;
+	unsigned int srcpixel;
+
+	ptr = (unsigned char *) src->desc->virtaddr
+	    + rect->top * src->geom->virtstride
+	    + rect->left * src->bpp;
+
+	if (src->bpp == 4)
+		srcpixel = *(unsigned int *) ptr;
+	else
+		srcpixel = *(unsigned short *) ptr;
+
+	return getinternalcolor(srcpixel, &src->format);
+}
+
+static bool idle(void)
+{
+	bool idle;
+
+	pthread_mutex_lock(&g_cpu.lock);
+	idle = (g_cpu.done == g_cpu.queued);
+	pthread_mutex_unlock(&g_cpu.lock);
+
+	return idle;
+}
+
+bool gccpu_blt(struct bvbltparams *bvbltparams)
+{
+	struct gccpusurface dst, src1, src2;
+	struct gccpusurface *src[2];
+	struct gccpuwalk walk;
+	struct c2dmrgn rgn[3];
+	struct bvrect *dstrect = &bvbltparams->dstrect;
+	struct bvrect *cliprect = &bvbltparams->cliprect;
+	unsigned long long cost, threshold;
+	unsigned int srccount = 0, pixel = 0, weight;
+	enum gccpuop cpuop;
+	int left, top, right, bottom;
+	int i;
+
+	GCENTER(GCZONE_DISPATCH);
+
+	if (g_cpu.threshold == 0)
+		goto decline;
+
+	/* Synchronous, unbatched and no flags beyond clipping. */
+	if ((bvbltparams->flags & ~(BVFLAG_OP_MASK | BVFLAG_CLIP)) != 0)
+		goto decline;
+
+	switch (bvbltparams->flags & BVFLAG_OP_MASK) {
+	case BVFLAG_ROP:
+		if (bvbltparams->op.rop != 0xCCCC)
+			goto decline;
+
+		cpuop = GC_CPU_COPY;
+		break;
+
+	case BVFLAG_BLEND:
+		if (bvbltparams->op.blend != BVBLEND_SRC1OVER)
+			goto decline;
+
+		cpuop = GC_CPU_BLEND;
+		break;
+
+	default:
+		goto decline;
+	}
+
+	if (!get_surface(bvbltparams, bvbltparams->dstdesc,
+			 bvbltparams->dstgeom, &dst) ||
+	    !get_surface(bvbltparams, bvbltparams->src1.desc,
+			 bvbltparams->src1geom, &src1))
+		goto decline;
+
+	/* Clip the destination the way parse_destination does, the sources
+	 * move with its top left corner. */
+	left = dstrect->left;
+	top = dstrect->top;
+	right = left + (int) dstrect->width;
+	bottom = top + (int) dstrect->height;
+
+	if ((bvbltparams->flags & BVFLAG_CLIP) != 0) {
+		if ((cliprect->left < GC_CLIP_RESET_LEFT) ||
+		    (cliprect->top < GC_CLIP_RESET_TOP) ||
+		    (cliprect->left + (int) cliprect->width >
+		     GC_CLIP_RESET_RIGHT) ||
+		    (cliprect->top + (int) cliprect->height >
+		     GC_CLIP_RESET_BOTTOM))
+			goto decline;
+
+		left = max(left, cliprect->left);
+		top = max(top, cliprect->top);
+		right = min(right, cliprect->left + (int) cliprect->width);
+		bottom = min(bottom, cliprect->top + (int) cliprect->height);
+	}
+
+	if (!set_rect(&dst, left, top, right - left, bottom - top))
+		goto decline;
+
+	if ((bvbltparams->src1rect.width == 1) &&
+	    (bvbltparams->src1rect.height == 1)) {
+		/* Solid fill from a single pixel; bv_blt fills from a 1x1
+		 * source even when asked to blend. */
+		if ((cpuop != GC_CPU_COPY) ||
+		    !set_rect(&src1, bvbltparams->src1rect.left,
+			      bvbltparams->src1rect.top, 1, 1) ||
+		    !valid_fill(&dst.format))
+			goto decline;
+
+		cpuop = GC_CPU_FILL;
+		weight = GC_CPU_COST_FILL;
+	} else {
+		/* Same size as the destination, no scaling. */
+		if ((bvbltparams->src1rect.width != dstrect->width) ||
+		    (bvbltparams->src1rect.height != dstrect->height) ||
+		    overlap(src1.desc, dst.desc))
+			goto decline;
+
+		if (!set_rect(&src1,
+			      bvbltparams->src1rect.left + left - dstrect->left,
+			      bvbltparams->src1rect.top + top - dstrect->top,
+			      right - left, bottom - top))
+			goto decline;
+
+		/* Raw copies keep the format. */
+		if ((src1.format.format != dst.format.format) ||
+		    (src1.format.swizzle != dst.format.swizzle) ||
+		    (src1.format.bitspp != dst.format.bitspp) ||
+		    (src1.format.cs.rgb.comp != dst.format.cs.rgb.comp))
+			goto decline;
+
+		src[srccount++] = &src1;
+		weight = (src1.angle == dst.angle)
+		       ? GC_CPU_COST_COPY : GC_CPU_COST_ROTATE;
+	}
+
+	if (cpuop == GC_CPU_BLEND) {
+		if (!get_surface(bvbltparams, bvbltparams->src2.desc,
+				 bvbltparams->src2geom, &src2))
+			goto decline;
+
+		if ((bvbltparams->src2rect.width != dstrect->width) ||
+		    (bvbltparams->src2rect.height != dstrect->height))
+			goto decline;
+
+		if (!set_rect(&src2,
+			      bvbltparams->src2rect.left + left - dstrect->left,
+			      bvbltparams->src2rect.top + top - dstrect->top,
+			      right - left, bottom - top))
+			goto decline;
+
+		/* Either the destination itself or apart from it. */
+		if (!same_area(&src2, &bvbltparams->src2rect,
+			       &dst, dstrect) &&
+		    overlap(src2.desc, dst.desc))
+			goto decline;
+
+		if ((src2.format.format != dst.format.format) ||
+		    (src2.format.swizzle != dst.format.swizzle) ||
+		    (src2.format.cs.rgb.comp != dst.format.cs.rgb.comp) ||
+		    (dst.format.bitspp != 32) ||
+		    (dst.format.cs.rgb.comp->a.size != 8) ||
+		    !dst.format.premultiplied)
+			goto decline;
+
+		src[srccount++] = &src2;
+		weight = GC_CPU_COST_BLEND;
+	}
+
+	/* Worth it? */
+	cost = (unsigned long long) (right - left) * (bottom - top) * weight;
+	threshold = g_cpu.threshold;
+
+	if (!mapped(&dst) || !mapped(&src1) ||
+	    ((cpuop == GC_CPU_BLEND) && !mapped(&src2)))
+		threshold *= GC_CPU_UNMAPPED;
+
+	if (cost > threshold) {
+		GCDBG(GCZONE_DISPATCH, "cost %llu over %llu.\n",
+		      cost, threshold);
+		goto decline;
+	}
+
+	/* Never overtake the GPU. */
+	if (!idle()) {
+		GCDBG(GCZONE_DISPATCH, "asynchronous batches pending.\n");
+		goto decline;
+	}
+
+	GCDBG(GCZONE_BLIT, "op %d, %dx%d, cost %llu.\n",
+	      cpuop, right - left, bottom - top, cost);
+
+	/* Whatever the CPU caches hold may be older than what the GPU
+	 * wrote; write it back and drop it before touching the surfaces. */
+	get_region(&dst, right - left, bottom - top, &rgn[0]);
+	if (cpuop == GC_CPU_FILL)
+		get_region(&src1, 1, 1, &rgn[1]);
+
+	for (i = 0; i < (int) srccount; i += 1)
+		get_region(src[i], right - left, bottom - top, &rgn[i + 1]);
+
+	gcbvcacheop((cpuop == GC_CPU_FILL) ? 2 : srccount + 1, rgn,
+		    BVCACHE_BIDIRECTIONAL, false);
+
+	if (cpuop == GC_CPU_FILL)
+		pixel = get_fill_pixel(get_fill_color(&src1,
+						      &bvbltparams->src1rect),
+				       &dst.format);
+
+	get_walk(&dst, src, srccount, right - left, bottom - top, &walk);
+
+	switch (cpuop) {
+	case GC_CPU_FILL:
+		fill(&walk, dst.bpp, pixel);
+		break;
+
+	case GC_CPU_COPY:
+		copy(&walk, dst.bpp);
+		break;
+
+	default:
+		blend(&walk, dst.format.cs.rgb.comp->a.shift);
+	}
+
+	/* Leave the result where the GPU sees it. */
+	gcbvcacheop(1, rgn, BVCACHE_CPU_TO_DEVICE, true);
+
+	GCEXIT(GCZONE_DISPATCH);
+	return true;
+
+decline:
+	GCEXIT(GCZONE_DISPATCH);
+	return false;
+}
+
+void gccpu_setthreshold(unsigned int threshold)
+{
+	g_cpu.threshold = threshold;
+}
+
+
+/*******************************************************************************
+ * Asynchronous batch tracking.
+ */
+
+unsigned int gccpu_commit_begin(struct gcicommit *gcicommit)
+{
+	unsigned int ticket;
+
+	pthread_mutex_lock(&g_cpu.lock);
+	ticket = g_cpu.queued;
+	pthread_mutex_unlock(&g_cpu.lock);
+
+	return ticket;
+}
+
+/* Marks the batches up to ticket complete. Called with the lock held. */
+static void retire(unsigned int ticket)
+{
+	if ((int) (ticket - g_cpu.done) > 0)
+		g_cpu.done = ticket;
+}
+
+static void retire_callback(void *callbackparam)
+{
+	pthread_mutex_lock(&g_cpu.lock);
+	retire((unsigned int) (unsigned long) callbackparam);
+	pthread_mutex_unlock(&g_cpu.lock);
+}
+
+void gccpu_commit_end(struct gcicommit *gcicommit, unsigned int ticket)
+{
+	struct gcicallbackarm gcicallbackarm;
+
+	if (gcicommit->gcerror != GCERR_NONE)
+		return;
+
+	pthread_mutex_lock(&g_cpu.lock);
+
+	/* Counted once the commit returns, so blits ordered after the
+	 * bv_blt that queued the batch see it. */
+	if (gcicommit->asynchronous)
+		ticket = ++g_cpu.queued;
+	else
+		retire(ticket);
+
+	pthread_mutex_unlock(&g_cpu.lock);
+
+	if (!gcicommit->asynchronous)
+		return;
+
+	/* Retire the batch once it completes; without a callback it is
+	 * only retired by the next synchronous batch. */
+	gcicallbackarm.callback = retire_callback;
+	gcicallbackarm.callbackparam = (void *) (unsigned long) ticket;
+	gc_callback_wrapper(&gcicallbackarm);
+
+	if (gcicallbackarm.gcerror != GCERR_NONE)
+		GCDBG(GCZONE_DISPATCH, "no completion callback.\n");
+}
+
+void gccpu_init(void)
+{
+	GCDBG_REGISTER(cpu);
+
+	get_context()->cpublt = gccpu_blt;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2012,
+ * Texas Instruments, Inc. and Vivante Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Texas Instruments, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL TEXAS INSTRUMENTS, INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GCCPU_H
+#define GCCPU_H
+
+struct gcicommit;
+
+/*******************************************************************************
+ * CPU blitter.
+ *
+ * Small blits cost far less to do on the CPU than to turn into a command
+ * buffer, commit and wait for. gccpu_blt is hooked into bv_blt and takes
+ * synchronous, unbatched blits it can do with the same result as the GC320:
+ *
+ *   - copies (ROP 0xCCCC) between surfaces of the same RGB format, rotated
+ *     by any multiple of 90 degrees relative to each other;
+ *   - solid fills (ROP 0xCCCC from a 1x1 source) of 32 bit RGB and RGB565
+ *     surfaces;
+ *   - BVBLEND_SRC1OVER of premultiplied 32 bit surfaces of the same format.
+ *
+ * All surfaces need a CPU address. A blit is taken when its cost, in pixels
+ * weighted by operation, is within the threshold; the threshold is raised
+ * for buffers the GPU would have to map first. Set with the GCBV_CPUBLIT
+ * environment variable, 0 keeps everything on the GPU. Blits are never
+ * taken while an asynchronous batch may still be running, so the CPU never
+ * overtakes GPU work queued before it.
+ *
+ * The CPU caches are flushed over the surfaces before the blit and cleaned
+ * over the destination after it, the way the buffers look to the GPU.
+ */
+
+/* Hooks the blitter into bv_blt. */
+void gccpu_init(void);
+
+/* Returns true if the blit was done, false to leave it to the GPU. */
+bool gccpu_blt(struct bvbltparams *bvbltparams);
+
+void gccpu_setthreshold(unsigned int threshold);
+
+/* Bracket GCIOCTL_COMMIT to track the asynchronous batches in flight. */
+unsigned int gccpu_commit_begin(struct gcicommit *gcicommit);
+void gccpu_commit_end(struct gcicommit *gcicommit, unsigned int ticket);
+
+#endif
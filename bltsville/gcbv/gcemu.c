@@ -0,0 +1,934 @@
+/*
+ * Copyright (c) 2012,
+ * Texas Instruments, Inc. and Vivante Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Texas Instruments, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL TEXAS INSTRUMENTS, INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gcmain.h"
+#include "gcemu.h"
+#include <time.h>
+
+#define GCZONE_NONE		0
+#define GCZONE_ALL		(~0U)
+#define GCZONE_MAPPING		(1 << 0)
+#define GCZONE_COMMIT		(1 << 1)
+#define GCZONE_EXEC		(1 << 2)
+#define GCZONE_CALLBACK		(1 << 3)
+
+GCDBG_FILTERDEF(emu, GCZONE_NONE,
+		"mapping",
+		"commit",
+		"exec",
+		"callback")
+
+
+/*******************************************************************************
+ * Emulator state.
+ */
+
+/* Emulated GPU address space. Map handles are the GPU addresses of the
+ * buffers, so the fixups resolve to addresses the way the MMU would. */
+#define GCEMU_VA_BASE		0x10000000UL
+#define GCEMU_VA_END		0xF0000000UL
+
+/* LOAD_STATE addresses are 16 bits wide. */
+#define GCEMU_REG_COUNT		0x10000
+
+/* Reported through GCIOCTL_GETCAPS. */
+#define GCEMU_MODEL		0x320
+#define GCEMU_REVISION		0x5007
+
+struct gcemumap {
+	/* Page aligned GPU address and size of the mapping. */
+	unsigned long address;
+	unsigned int size;
+
+	/* GPU address of the first byte of the buffer. */
+	unsigned long handle;
+
+	/* Host address of the first byte of the buffer, NULL if the buffer
+	 * was given as an array of physical pages. */
+	unsigned char *logical;
+
+	/* Mapping list sorted by address (gcemumap). */
+	struct list_head link;
+};
+
+struct gcemucallback {
+	void (*callback) (void *callbackparam);
+	void *callbackparam;
+
+	/* Pending or vacant list (gcemucallback). */
+	struct list_head link;
+};
+
+/* GCIOCTL_CALLBACK_ALLOC object. */
+struct gcemuqueue {
+	/* Callbacks ready to be returned by GCIOCTL_CALLBACK_WAIT. */
+	struct list_head pending;		/* gcemucallback */
+
+	/* Set by gcemu_interrupt. */
+	bool interrupted;
+
+	/* Queue list (gcemuqueue). */
+	struct list_head link;
+};
+
+static struct gcemu {
+	int mode;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+
+	struct list_head maplist;		/* gcemumap */
+	struct list_head queuelist;		/* gcemuqueue */
+	struct list_head callbackvac;		/* gcemucallback */
+
+	/* Register file, kept across commits like the hardware does. */
+	unsigned int *regs;
+
+	/* Copy of the command buffer being executed; the kernel driver
+	 * patches its own copy, never the client buffer. */
+	unsigned int *cmdbuf;
+
+	struct gcemustats stats;
+
+	void (*cachehook) (struct gcicache *gcicache);
+} g_emu;
+
+
+/*******************************************************************************
+ * Mapping.
+ */
+
+static struct gcemumap *find_map(unsigned long address, unsigned int size)
+{
+	struct list_head *head;
+	struct gcemumap *gcemumap;
+
+	list_for_each(head, &g_emu.maplist) {
+		gcemumap = list_entry(head, struct gcemumap, link);
+		if (address < gcemumap->address)
+			break;
+
+		if (address - gcemumap->address <= gcemumap->size &&
+		    size <= gcemumap->address + gcemumap->size - address)
+			return gcemumap;
+	}
+
+	return NULL;
+}
+
+/* Host pointer to size bytes at a GPU address, NULL if not accessible. */
+static unsigned char *translate(unsigned long address, unsigned int size)
+{
+	struct gcemumap *gcemumap = find_map(address, size);
+
+	if ((gcemumap == NULL) || (gcemumap->logical == NULL))
+		return NULL;
+
+	return gcemumap->logical + (address - gcemumap->handle);
+}
+
+static void emu_map(struct gcimap *gcimap)
+{
+	struct list_head *head;
+	struct gcemumap *gcemumap, *next;
+	unsigned long address = GCEMU_VA_BASE;
+	unsigned int offset;
+
+	offset = (gcimap->pagearray == NULL)
+	       ? (unsigned long) gcimap->buf.logical & ~PAGE_MASK
+	       : gcimap->buf.offset;
+
+	gcemumap = gcalloc(struct gcemumap, sizeof(struct gcemumap));
+	if (gcemumap == NULL) {
+		gcimap->gcerror = GCERR_OODM;
+		return;
+	}
+
+	gcemumap->size = (offset + gcimap->size + PAGE_SIZE - 1) & PAGE_MASK;
+	gcemumap->logical = (gcimap->pagearray == NULL)
+			  ? gcimap->buf.logical : NULL;
+
+	/* First fit; the list is sorted by address. */
+	list_for_each(head, &g_emu.maplist) {
+		next = list_entry(head, struct gcemumap, link);
+		if (next->address - address >= gcemumap->size)
+			break;
+		address = next->address + next->size;
+	}
+
+	if (GCEMU_VA_END - address < gcemumap->size) {
+		gcfree(gcemumap);
+		gcimap->gcerror = GCERR_MMU_OOM;
+		return;
+	}
+
+	gcemumap->address = address;
+	gcemumap->handle = address + offset;
+	list_add_tail(&gcemumap->link, head);
+
+	gcimap->handle = gcemumap->handle;
+	gcimap->gcerror = GCERR_NONE;
+	g_emu.stats.maps += 1;
+
+	GCDBG(GCZONE_MAPPING, "mapped 0x%08lX, %d bytes\n",
+	      gcemumap->handle, gcimap->size);
+}
+
+static enum gcerror unmap_handle(unsigned long handle)
+{
+	struct gcemumap *gcemumap = find_map(handle, 0);
+
+	if ((gcemumap == NULL) || (gcemumap->handle != handle)) {
+		GCERR("unmapping invalid handle 0x%08lX.\n", handle);
+		return GCERR_NOT_FOUND;
+	}
+
+	list_del(&gcemumap->link);
+	gcfree(gcemumap);
+	g_emu.stats.unmaps += 1;
+
+	GCDBG(GCZONE_MAPPING, "unmapped 0x%08lX\n", handle);
+	return GCERR_NONE;
+}
+
+
+/*******************************************************************************
+ * Callbacks.
+ */
+
+static struct gcemuqueue *find_queue(unsigned long handle)
+{
+	struct list_head *head;
+
+	list_for_each(head, &g_emu.queuelist)
+		if ((unsigned long) list_entry(head, struct gcemuqueue, link)
+		    == handle)
+			return (struct gcemuqueue *) handle;
+
+	return NULL;
+}
+
+/* Work is complete when the commit returns, so callbacks are ready as soon
+ * as they are armed. */
+static enum gcerror queue_callback(unsigned long handle,
+				   void (*callback) (void *callbackparam),
+				   void *callbackparam)
+{
+	struct gcemuqueue *gcemuqueue = find_queue(handle);
+	struct gcemucallback *gcemucallback;
+
+	if (gcemuqueue == NULL)
+		return GCERR_NOT_FOUND;
+
+	if (list_empty(&g_emu.callbackvac)) {
+		gcemucallback = gcalloc(struct gcemucallback,
+					sizeof(struct gcemucallback));
+		if (gcemucallback == NULL)
+			return GCERR_OODM;
+	} else {
+		gcemucallback = list_entry(g_emu.callbackvac.next,
+					   struct gcemucallback, link);
+		list_del(&gcemucallback->link);
+	}
+
+	gcemucallback->callback = callback;
+	gcemucallback->callbackparam = callbackparam;
+	list_add_tail(&gcemucallback->link, &gcemuqueue->pending);
+	g_emu.stats.callbacks += 1;
+
+	pthread_cond_broadcast(&g_emu.cond);
+	return GCERR_NONE;
+}
+
+static int emu_callback_wait(struct gcicallbackwait *gcicallbackwait)
+{
+	struct gcemuqueue *gcemuqueue;
+	struct gcemucallback *gcemucallback;
+	struct timespec timeout;
+
+	clock_gettime(CLOCK_REALTIME, &timeout);
+	timeout.tv_sec += gcicallbackwait->timeoutms / 1000;
+	timeout.tv_nsec += (gcicallbackwait->timeoutms % 1000) * 1000000;
+	if (timeout.tv_nsec >= 1000000000) {
+		timeout.tv_sec += 1;
+		timeout.tv_nsec -= 1000000000;
+	}
+
+	while (1) {
+		gcemuqueue = find_queue(gcicallbackwait->handle);
+		if (gcemuqueue == NULL) {
+			gcicallbackwait->gcerror = GCERR_NOT_FOUND;
+			return 0;
+		}
+
+		if (gcemuqueue->interrupted)
+			return -EINTR;
+
+		if (!list_empty(&gcemuqueue->pending))
+			break;
+
+		/* A zero timeout polls, like wait_event_timeout does. */
+		if ((gcicallbackwait->timeoutms == 0) ||
+		    pthread_cond_timedwait(&g_emu.cond, &g_emu.mutex,
+					   &timeout) == ETIMEDOUT) {
+			gcicallbackwait->gcerror = GCERR_TIMEOUT;
+			return 0;
+		}
+	}
+
+	gcemucallback = list_entry(gcemuqueue->pending.next,
+				   struct gcemucallback, link);
+	list_move(&gcemucallback->link, &g_emu.callbackvac);
+
+	gcicallbackwait->callback = gcemucallback->callback;
+	gcicallbackwait->callbackparam = gcemucallback->callbackparam;
+	gcicallbackwait->gcerror = GCERR_NONE;
+
+	GCDBG(GCZONE_CALLBACK, "callback 0x%08lX(0x%08lX).\n",
+	      (unsigned long) gcicallbackwait->callback,
+	      (unsigned long) gcicallbackwait->callbackparam);
+	return 0;
+}
+
+static void free_queue(struct gcemuqueue *gcemuqueue)
+{
+	list_splice_init(&gcemuqueue->pending, &g_emu.callbackvac);
+	list_del(&gcemuqueue->link);
+	gcfree(gcemuqueue);
+
+	/* Release waiters on the queue. */
+	pthread_cond_broadcast(&g_emu.cond);
+}
+
+
+/*******************************************************************************
+ * Command execution.
+ */
+
+static unsigned int get_bytespp(unsigned int format)
+{
+	switch (format) {
+	case GCREG_DE_FORMAT_X4R4G4B4:
+	case GCREG_DE_FORMAT_A4R4G4B4:
+	case GCREG_DE_FORMAT_X1R5G5B5:
+	case GCREG_DE_FORMAT_A1R5G5B5:
+	case GCREG_DE_FORMAT_R5G6B5:
+		return 2;
+
+	case GCREG_DE_FORMAT_X8R8G8B8:
+	case GCREG_DE_FORMAT_A8R8G8B8:
+		return 4;
+
+	default:
+		/* Not implemented by the emulator. */
+		return 0;
+	}
+}
+
+/* Converts the A8R8G8B8 clear color to the destination format. */
+static bool get_clear_pixel(unsigned int color, unsigned int format,
+			    unsigned int swizzle, unsigned int *pixel)
+{
+	unsigned int a = color >> 24;
+	unsigned int r = (color >> 16) & 0xFF;
+	unsigned int g = (color >> 8) & 0xFF;
+	unsigned int b = color & 0xFF;
+
+	switch (format) {
+	case GCREG_DE_FORMAT_X8R8G8B8:
+	case GCREG_DE_FORMAT_A8R8G8B8:
+		switch (swizzle) {
+		case GCREG_DE_SWIZZLE_ARGB:
+			*pixel = (a << 24) | (r << 16) | (g << 8) | b;
+			return true;
+		case GCREG_DE_SWIZZLE_RGBA:
+			*pixel = (r << 24) | (g << 16) | (b << 8) | a;
+			return true;
+		case GCREG_DE_SWIZZLE_ABGR:
+			*pixel = (a << 24) | (b << 16) | (g << 8) | r;
+			return true;
+		case GCREG_DE_SWIZZLE_BGRA:
+			*pixel = (b << 24) | (g << 16) | (r << 8) | a;
+			return true;
+		}
+		return false;
+
+	case GCREG_DE_FORMAT_R5G6B5:
+		if (swizzle == GCREG_DE_SWIZZLE_ARGB)
+			*pixel = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+		else if (swizzle == GCREG_DE_SWIZZLE_ABGR)
+			*pixel = ((b >> 3) << 11) | ((g >> 2) << 5) | (r >> 3);
+		else
+			return false;
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+/* Source register set; source 0 is programmed through the original 2D
+ * registers and the others through the Block4 ones. */
+struct gcemusrc {
+	unsigned long address;
+	unsigned int stride;
+	union {
+		struct gcregsrcconfig reg;
+		unsigned int raw;
+	} config;
+	union {
+		struct gcregsrcorigin reg;
+		unsigned int raw;
+	} origin;
+	union {
+		struct gcregrotangle reg;
+		unsigned int raw;
+	} rotangle;
+	union {
+		struct gcregrop reg;
+		unsigned int raw;
+	} rop;
+	union {
+		struct gcregalphacontrol reg;
+		unsigned int raw;
+	} alphacontrol;
+};
+
+static void get_src(unsigned int index, struct gcemusrc *src)
+{
+	unsigned int *regs = g_emu.regs;
+
+	if (index == 0) {
+		src->address = regs[gcregSrcAddressRegAddrs];
+		src->stride = regs[gcregSrcStrideRegAddrs];
+		src->config.raw = regs[gcregSrcConfigRegAddrs];
+		src->origin.raw = regs[gcregSrcOriginRegAddrs];
+		src->rotangle.raw = regs[gcregRotAngleRegAddrs];
+		src->rop.raw = regs[gcregRopRegAddrs];
+		src->alphacontrol.raw = regs[gcregAlphaControlRegAddrs];
+	} else {
+		src->address = regs[gcregBlock4SrcAddressRegAddrs + index];
+		src->stride = regs[gcregBlock4SrcStrideRegAddrs + index];
+		src->config.raw = regs[gcregBlock4SrcConfigRegAddrs + index];
+		src->origin.raw = regs[gcregBlock4SrcOriginRegAddrs + index];
+		src->rotangle.raw = regs[gcregBlock4RotAngleRegAddrs + index];
+		src->rop.raw = regs[gcregBlock4RopRegAddrs + index];
+		src->alphacontrol.raw
+			= regs[gcregBlock4AlphaControlRegAddrs + index];
+	}
+}
+
+/* Runs one START_DE rectangle on host memory. Only what a copy or a fill
+ * needs is implemented; returns false for anything else, leaving the
+ * destination untouched. */
+static bool execute(unsigned int command, struct gcrect *rect)
+{
+	unsigned int *regs = g_emu.regs;
+	union {
+		struct gcregdstconfig reg;
+		unsigned int raw;
+	} dstconfig;
+	struct gcemusrc src[4];
+	unsigned char *dst, *srcptr[4];
+	unsigned int width, height, dstbpp, srccount, pixel, i, x, y;
+	unsigned long dststride;
+
+	width = rect->right - rect->left;
+	height = rect->bottom - rect->top;
+	if ((rect->left < 0) || (rect->top < 0) ||
+	    (rect->right <= rect->left) || (rect->bottom <= rect->top))
+		return false;
+
+	dstconfig.raw = regs[gcregDestConfigRegAddrs];
+	dstbpp = get_bytespp(dstconfig.reg.format);
+	dststride = regs[gcregDestStrideRegAddrs];
+	if (dstbpp == 0)
+		return false;
+
+	dst = translate(regs[gcregDestAddressRegAddrs]
+				+ rect->top * dststride + rect->left * dstbpp,
+			(height - 1) * dststride + width * dstbpp);
+	if (dst == NULL)
+		return false;
+
+	switch (command) {
+	case GCREG_DEST_CONFIG_COMMAND_CLEAR:
+		if (!get_clear_pixel(regs[gcregClearPixelValue32RegAddrs],
+				     dstconfig.reg.format,
+				     dstconfig.reg.swizzle, &pixel))
+			return false;
+
+		for (y = 0; y < height; y += 1, dst += dststride)
+			for (x = 0; x < width; x += 1)
+				if (dstbpp == 4)
+					((unsigned int *) dst)[x] = pixel;
+				else
+					((unsigned short *) dst)[x] = pixel;
+		return true;
+
+	case GCREG_DEST_CONFIG_COMMAND_BIT_BLT:
+		srccount = 1;
+		break;
+
+	case GCREG_DEST_CONFIG_COMMAND_MULTI_SOURCE_BLT:
+		srccount = (regs[gcregDEMultiSourceRegAddrs] & 7) + 1;
+		break;
+
+	default:
+		return false;
+	}
+
+	/* Sources are drawn in order; validate all of them first. */
+	for (i = 0; i < srccount; i += 1) {
+		int sx = rect->left, sy = rect->top;
+
+		get_src(i, &src[i]);
+
+		/* Same format copies with ROP3 SRCCOPY only. */
+		if ((src[i].config.reg.format != dstconfig.reg.format) ||
+		    (src[i].config.reg.swizzle != dstconfig.reg.swizzle) ||
+		    (src[i].rop.reg.fg != 0xCC) ||
+		    src[i].alphacontrol.reg.enable ||
+		    src[i].rotangle.reg.src || src[i].rotangle.reg.dst ||
+		    src[i].rotangle.reg.src_mirror ||
+		    src[i].rotangle.reg.dst_mirror)
+			return false;
+
+		/* Multi-source blits read each source at the destination
+		 * coordinates, plain blits start at the source origin. */
+		if (command == GCREG_DEST_CONFIG_COMMAND_BIT_BLT) {
+			sx = src[i].origin.reg.x;
+			sy = src[i].origin.reg.y;
+		}
+
+		srcptr[i] = translate(src[i].address
+					+ sy * src[i].stride + sx * dstbpp,
+				      (height - 1) * src[i].stride
+					+ width * dstbpp);
+		if (srcptr[i] == NULL)
+			return false;
+	}
+
+	for (i = 0; i < srccount; i += 1)
+		for (y = 0; y < height; y += 1)
+			memmove(dst + y * dststride,
+				srcptr[i] + y * src[i].stride,
+				width * dstbpp);
+
+	return true;
+}
+
+static void start_de(struct gcrect *rect)
+{
+	unsigned int command;
+
+	command = (g_emu.regs[gcregDestConfigRegAddrs] >> 12) & 0xF;
+
+	g_emu.stats.ops[command] += 1;
+	g_emu.stats.pixels += (unsigned long long)
+			      abs(rect->right - rect->left)
+			      * abs(rect->bottom - rect->top);
+
+	GCDBG(GCZONE_EXEC, "command %d, (%d,%d)-(%d,%d)\n",
+	      command, rect->left, rect->top, rect->right, rect->bottom);
+
+	if (g_emu.mode != GCEMU_EXECUTE)
+		return;
+
+	if (execute(command, rect))
+		g_emu.stats.executed += 1;
+	else
+		g_emu.stats.skipped += 1;
+}
+
+static void start_vr(void)
+{
+	unsigned int *regs = g_emu.regs;
+	union {
+		struct gcregvrconfig reg;
+		unsigned int raw;
+	} config;
+	union {
+		struct gcregvrtargetwindowlow reg;
+		unsigned int raw;
+	} lt;
+	union {
+		struct gcregvrtargetwindowhigh reg;
+		unsigned int raw;
+	} rb;
+
+	config.raw = regs[gcregVRConfigRegAddrs];
+	if (config.reg.start_mask != GCREG_VR_CONFIG_MASK_START_ENABLED)
+		return;
+
+	lt.raw = regs[gcregVRTargetWindowLowRegAddrs];
+	rb.raw = regs[gcregVRTargetWindowHighRegAddrs];
+
+	g_emu.stats.filterpasses[config.reg.start] += 1;
+	g_emu.stats.pixels += (unsigned long long)
+			      abs((int) rb.reg.right - (int) lt.reg.left)
+			      * abs((int) rb.reg.bottom - (int) lt.reg.top);
+
+	GCDBG(GCZONE_EXEC, "filter pass %d, (%d,%d)-(%d,%d)\n",
+	      config.reg.start, lt.reg.left, lt.reg.top,
+	      rb.reg.right, rb.reg.bottom);
+
+	/* Filter passes are only counted. */
+	if (g_emu.mode == GCEMU_EXECUTE)
+		g_emu.stats.skipped += 1;
+}
+
+/* Walks the command stream; see gc_parse_command_buffer for the format.
+ * Register state persists across buffers and commits. */
+static enum gcerror decode(unsigned int *buffer, unsigned int count)
+{
+	unsigned int i, j, command, statecount, address;
+	struct gcrect rect;
+
+	for (i = 0; i < count;) {
+		command = (buffer[i] >> 27) & 0x1F;
+
+		switch (command) {
+		case GCREG_COMMAND_OPCODE_LOAD_STATE:
+			statecount = (buffer[i] >> 16) & 0x3FF;
+			address = buffer[i] & 0xFFFF;
+
+			if ((i + 1 + statecount > count) ||
+			    (address + statecount > GCEMU_REG_COUNT))
+				goto fail;
+
+			memcpy(&g_emu.regs[address], &buffer[i + 1],
+			       statecount * sizeof(unsigned int));
+
+			/* Writing the VR config register kicks off a filter
+			 * pass. */
+			if ((address <= gcregVRConfigRegAddrs) &&
+			    (address + statecount > gcregVRConfigRegAddrs))
+				start_vr();
+
+			/* Commands are 64-bit aligned. */
+			i += 1 + statecount + ((~statecount) & 1);
+			break;
+
+		case GCREG_COMMAND_OPCODE_STARTDE:
+			statecount = (buffer[i] >> 8) & 0xFF;
+			i += 2;
+
+			if (i + statecount * 2 > count)
+				goto fail;
+
+			for (j = 0; j < statecount; j += 1, i += 2) {
+				rect.left = buffer[i] & 0xFFFF;
+				rect.top = buffer[i] >> 16;
+				rect.right = buffer[i + 1] & 0xFFFF;
+				rect.bottom = buffer[i + 1] >> 16;
+				start_de(&rect);
+			}
+			break;
+
+		case GCREG_COMMAND_OPCODE_END:
+		case GCREG_COMMAND_OPCODE_NOP:
+		case GCREG_COMMAND_OPCODE_WAIT:
+		case GCREG_COMMAND_OPCODE_STALL:
+			i += 2;
+			break;
+
+		default:
+			goto fail;
+		}
+	}
+
+	return GCERR_NONE;
+
+fail:
+	GCERR("bad command 0x%08X at offset 0x%X.\n", buffer[i], i * 4);
+	return GCERR_CMD_CONSISTENCY;
+}
+
+static void emu_commit(struct gcicommit *gcicommit)
+{
+	struct list_head *bufferhead, *fixuphead;
+	struct gcbuffer *gcbuffer;
+	struct gcfixup *gcfixup;
+	struct gcschedunmap *gcschedunmap;
+	unsigned int i, count;
+
+	gcicommit->gcerror = GCERR_NONE;
+
+	list_for_each(bufferhead, &gcicommit->buffer) {
+		gcbuffer = list_entry(bufferhead, struct gcbuffer, link);
+		count = gcbuffer->tail - gcbuffer->head;
+
+		GCDBG(GCZONE_COMMIT, "buffer 0x%08lX, %d bytes\n",
+		      (unsigned long) gcbuffer, count * 4);
+
+		memcpy(g_emu.cmdbuf, gcbuffer->head,
+		       count * sizeof(unsigned int));
+
+		list_for_each(fixuphead, &gcbuffer->fixup) {
+			gcfixup = list_entry(fixuphead, struct gcfixup, link);
+
+			for (i = 0; i < gcfixup->count; i += 1) {
+				if (gcfixup->fixup[i].dataoffset >= count) {
+					gcicommit->gcerror
+						= GCERR_CMD_CONSISTENCY;
+					return;
+				}
+
+				g_emu.cmdbuf[gcfixup->fixup[i].dataoffset]
+					+= gcfixup->fixup[i].surfoffset;
+			}
+
+			g_emu.stats.fixups += gcfixup->count;
+		}
+
+		gcicommit->gcerror = decode(g_emu.cmdbuf, count);
+		if (gcicommit->gcerror != GCERR_NONE)
+			return;
+
+		g_emu.stats.buffers += 1;
+		g_emu.stats.bytes += count * sizeof(unsigned int);
+	}
+
+	g_emu.stats.commits += 1;
+
+	/* Scheduled unmappings. */
+	list_for_each(bufferhead, &gcicommit->unmap) {
+		gcschedunmap = list_entry(bufferhead, struct gcschedunmap,
+					  link);
+		unmap_handle(gcschedunmap->handle);
+	}
+
+	if (gcicommit->callback != NULL)
+		gcicommit->gcerror = queue_callback(gcicommit->handle,
+						    gcicommit->callback,
+						    gcicommit->callbackparam);
+}
+
+
+/*******************************************************************************
+ * IOCTL entry.
+ */
+
+int gcemu_ioctl(__unused int handle, unsigned int code, void *arg)
+{
+	struct gcicaps *gcicaps;
+	struct gcimap *gcimap;
+	struct gcicache *gcicache;
+	struct gcicallback *gcicallback;
+	struct gcicallbackarm *gcicallbackarm;
+	struct gcemuqueue *gcemuqueue;
+	int result = 0;
+	int i;
+
+	pthread_mutex_lock(&g_emu.mutex);
+
+	switch (code) {
+	case GCIOCTL_GETCAPS:
+		gcicaps = (struct gcicaps *) arg;
+		memset(gcicaps, 0, sizeof(struct gcicaps));
+		gcicaps->gcerror = GCERR_NONE;
+		gcicaps->gcmodel = GCEMU_MODEL;
+		gcicaps->gcrevision = GCEMU_REVISION;
+		break;
+
+	case GCIOCTL_COMMIT:
+		emu_commit((struct gcicommit *) arg);
+		break;
+
+	case GCIOCTL_MAP:
+		emu_map((struct gcimap *) arg);
+		break;
+
+	case GCIOCTL_UNMAP:
+		gcimap = (struct gcimap *) arg;
+		gcimap->gcerror = unmap_handle(gcimap->handle);
+		break;
+
+	case GCIOCTL_CACHE:
+		/* Host memory is coherent. */
+		gcicache = (struct gcicache *) arg;
+		if ((gcicache->count < 0) ||
+		    (gcicache->count > (int) countof(gcicache->rgn))) {
+			result = -EINVAL;
+			break;
+		}
+
+		g_emu.stats.cacheops += 1;
+		for (i = 0; i < gcicache->count; i += 1)
+			g_emu.stats.cachebytes += gcicache->rgn[i].span
+						* gcicache->rgn[i].lines;
+
+		if (g_emu.cachehook != NULL)
+			g_emu.cachehook(gcicache);
+		break;
+
+	case GCIOCTL_CALLBACK_ALLOC:
+		gcicallback = (struct gcicallback *) arg;
+		gcemuqueue = gcalloc(struct gcemuqueue,
+				     sizeof(struct gcemuqueue));
+		if (gcemuqueue == NULL) {
+			gcicallback->gcerror = GCERR_OODM;
+			break;
+		}
+
+		INIT_LIST_HEAD(&gcemuqueue->pending);
+		gcemuqueue->interrupted = false;
+		list_add(&gcemuqueue->link, &g_emu.queuelist);
+
+		gcicallback->handle = (unsigned long) gcemuqueue;
+		gcicallback->gcerror = GCERR_NONE;
+		break;
+
+	case GCIOCTL_CALLBACK_FREE:
+		gcicallback = (struct gcicallback *) arg;
+		gcemuqueue = find_queue(gcicallback->handle);
+		if (gcemuqueue == NULL) {
+			gcicallback->gcerror = GCERR_NOT_FOUND;
+			break;
+		}
+
+		free_queue(gcemuqueue);
+		gcicallback->gcerror = GCERR_NONE;
+		break;
+
+	case GCIOCTL_CALLBACK_WAIT:
+		result = emu_callback_wait((struct gcicallbackwait *) arg);
+		break;
+
+	case GCIOCTL_CALLBACK_ARM:
+		gcicallbackarm = (struct gcicallbackarm *) arg;
+		gcicallbackarm->gcerror
+			= queue_callback(gcicallbackarm->handle,
+					 gcicallbackarm->callback,
+					 gcicallbackarm->callbackparam);
+		break;
+
+	default:
+		result = -ENOTTY;
+	}
+
+	pthread_mutex_unlock(&g_emu.mutex);
+	return result;
+}
+
+void gcemu_interrupt(__unused pthread_t thread)
+{
+	struct list_head *head;
+
+	pthread_mutex_lock(&g_emu.mutex);
+
+	list_for_each(head, &g_emu.queuelist)
+		list_entry(head, struct gcemuqueue, link)->interrupted = true;
+
+	pthread_cond_broadcast(&g_emu.cond);
+	pthread_mutex_unlock(&g_emu.mutex);
+}
+
+void gcemu_getstats(struct gcemustats *stats, bool reset)
+{
+	pthread_mutex_lock(&g_emu.mutex);
+
+	*stats = g_emu.stats;
+	if (reset)
+		memset(&g_emu.stats, 0, sizeof(g_emu.stats));
+
+	pthread_mutex_unlock(&g_emu.mutex);
+}
+
+void gcemu_setcachehook(void (*hook) (struct gcicache *gcicache))
+{
+	pthread_mutex_lock(&g_emu.mutex);
+	g_emu.cachehook = hook;
+	pthread_mutex_unlock(&g_emu.mutex);
+}
+
+
+/*******************************************************************************
+ * Init/cleanup.
+ */
+
+int gcemu_open(int mode)
+{
+	GCDBG_REGISTER(emu);
+
+	g_emu.regs = gcalloc(unsigned int,
+			     GCEMU_REG_COUNT * sizeof(unsigned int));
+	g_emu.cmdbuf = gcalloc(unsigned int, GC_BUFFER_SIZE);
+	if ((g_emu.regs == NULL) || (g_emu.cmdbuf == NULL)) {
+		GCERR("failed to allocate emulator state.\n");
+		gcfree(g_emu.regs);
+		gcfree(g_emu.cmdbuf);
+		return -1;
+	}
+
+	memset(g_emu.regs, 0, GCEMU_REG_COUNT * sizeof(unsigned int));
+	memset(&g_emu.stats, 0, sizeof(g_emu.stats));
+
+	INIT_LIST_HEAD(&g_emu.maplist);
+	INIT_LIST_HEAD(&g_emu.queuelist);
+	INIT_LIST_HEAD(&g_emu.callbackvac);
+
+	pthread_mutex_init(&g_emu.mutex, NULL);
+	pthread_cond_init(&g_emu.cond, NULL);
+
+	g_emu.mode = mode;
+
+	/* Any positive value other than a real descriptor would do. */
+	return 1;
+}
+
+void gcemu_close(__unused int handle)
+{
+	struct list_head *head;
+
+	while (!list_empty(&g_emu.maplist)) {
+		head = g_emu.maplist.next;
+		list_del(head);
+		gcfree(list_entry(head, struct gcemumap, link));
+	}
+
+	while (!list_empty(&g_emu.queuelist))
+		free_queue(list_entry(g_emu.queuelist.next,
+				      struct gcemuqueue, link));
+
+	while (!list_empty(&g_emu.callbackvac)) {
+		head = g_emu.callbackvac.next;
+		list_del(head);
+		gcfree(list_entry(head, struct gcemucallback, link));
+	}
+
+	gcfree(g_emu.regs);
+	gcfree(g_emu.cmdbuf);
+	g_emu.regs = NULL;
+	g_emu.cmdbuf = NULL;
+
+	pthread_cond_destroy(&g_emu.cond);
+	pthread_mutex_destroy(&g_emu.mutex);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2012,
+ * Texas Instruments, Inc. and Vivante Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Texas Instruments, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL TEXAS INSTRUMENTS, INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GCEMU_H
+#define GCEMU_H
+
+#include <pthread.h>
+#include <gcreg.h>
+
+struct gcicache;
+
+/*******************************************************************************
+ * In-process GC320 emulation.
+ *
+ * Stands in for /dev/gcioctl so that gcbv can be profiled and regression
+ * tested off-target. Mappings get addresses in an emulated GPU address
+ * space, committed command buffers are copied, fixed up and decoded the way
+ * the kernel driver and the GPU would, and callbacks are delivered through
+ * the regular callback thread as soon as the commit returns.
+ *
+ * Selected at load time with the GCBV_EMULATE environment variable, which
+ * takes one of the GCEMU_* modes and defaults to GCEMU_DEFAULT. Only the
+ * host tools, built with GCBV_EMULATOR set, link the emulator in; the
+ * library ignores GCBV_EMULATE otherwise.
+ */
+
+#if !defined(GCBV_EMULATOR)
+#define GCBV_EMULATOR 0
+#endif
+
+#define GCEMU_OFF	0	/* Use the kernel driver. */
+#define GCEMU_DECODE	1	/* Decode and count operations only. */
+#define GCEMU_EXECUTE	2	/* Also run copies and fills on host memory. */
+
+#if !defined(GCEMU_DEFAULT)
+#define GCEMU_DEFAULT GCEMU_OFF
+#endif
+
+struct gcemustats {
+	unsigned int maps;
+	unsigned int unmaps;
+	unsigned int commits;
+	unsigned int buffers;
+	unsigned long long bytes;	/* command buffer bytes committed */
+	unsigned int fixups;
+	unsigned int callbacks;
+
+	/* START_DE rectangles per GCREG_DEST_CONFIG_COMMAND_* value. */
+	unsigned int ops[16];
+
+	/* Video rasterizer (filter blit) passes per GCREG_VR_CONFIG_START_*
+	 * value. */
+	unsigned int filterpasses[4];
+
+	/* Destination pixels touched by START_DE and filter passes. */
+	unsigned long long pixels;
+
+	/* GCIOCTL_CACHE calls and the bytes in the regions they name. */
+	unsigned int cacheops;
+	unsigned long long cachebytes;
+
+	/* GCEMU_EXECUTE only: rectangles run on host memory and rectangles
+	 * using states the emulator does not implement, left untouched. */
+	unsigned int executed;
+	unsigned int skipped;
+};
+
+/* Returns the handle passed to gcemu_ioctl, or -1 on failure. */
+int gcemu_open(int mode);
+void gcemu_close(int handle);
+
+/* Same contract as ioctl(2) on /dev/gcioctl. */
+int gcemu_ioctl(int handle, unsigned int code, void *arg);
+
+/* Makes pending and future GCIOCTL_CALLBACK_WAIT calls return -EINTR,
+ * the way a signal interrupts the kernel wait. */
+void gcemu_interrupt(pthread_t thread);
+
+void gcemu_getstats(struct gcemustats *stats, bool reset);
+
+/* Has every GCIOCTL_CACHE request passed to hook as well, for tools that
+ * check what gets maintained; NULL removes the hook. */
+void gcemu_setcachehook(void (*hook) (struct gcicache *gcicache));
+
+#endif
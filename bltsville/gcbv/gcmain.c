@@ -29,7 +29,11 @@
 
 #include "gcmain.h"
 #include "gcbv.h"
-#include <semaphore.h>
+#include "gcemu.h"
+#include "gccpu.h"
+#include <poll.h>
+#include <time.h>
+#include <sys/eventfd.h>
 
 #if ANDROID
 #include <cutils/log.h>
@@ -49,9 +53,57 @@ GCDBG_FILTERDEF(gcmain, GCZONE_NONE,
 static int g_handle;
 
 
+/*******************************************************************************
+ * IOCTL backends; the kernel driver or the in-process emulator.
+ */
+
+struct gcbackend {
+	int (*ioctl) (int handle, unsigned int code, void *arg);
+
+	/* Interrupts a GCIOCTL_CALLBACK_WAIT blocked in the thread. */
+	void (*interrupt) (pthread_t thread);
+};
+
+static int dev_ioctl(int handle, unsigned int code, void *arg)
+{
+	return ioctl(handle, code, arg);
+}
+
+static void dev_interrupt(pthread_t thread)
+{
+	pthread_kill(thread, SIGINT);
+}
+
+static const struct gcbackend g_devbackend = {
+	.ioctl = dev_ioctl,
+	.interrupt = dev_interrupt
+};
+
+#if GCBV_EMULATOR
+static const struct gcbackend g_emubackend = {
+	.ioctl = gcemu_ioctl,
+	.interrupt = gcemu_interrupt
+};
+#endif
+
+static const struct gcbackend *g_backend = &g_devbackend;
+
+
 /*******************************************************************************
  * Callback manager.
  */
+
+/* How long the callback thread blocks in GCIOCTL_CALLBACK_WAIT. Stopping
+ * the thread interrupts the wait, so this only bounds the shutdown of a
+ * thread the interrupt missed. */
+#define GC_CALLBACK_TIMEOUT	2000
+
+/* Callbacks collected per wakeup before blocking again. */
+#define GC_CALLBACK_DRAIN	32
+
+/* Distinct fences signalled per wakeup. */
+#define GC_CALLBACK_FENCES	8
+
 enum gccallbackinfo_status {
 	UNINIT,
 	SUPPORTED,
@@ -64,6 +116,11 @@ static const char * const g_statusNames[] = {
 	"UNSUPPORTED"
 };
 
+struct gcfencesignal {
+	int fence;
+	unsigned int count;
+};
+
 struct gccallbackinfo {
 	/* Callback status */
 	enum gccallbackinfo_status status;
@@ -71,24 +128,62 @@ struct gccallbackinfo {
 	/* Callback handle. */
 	unsigned long handle;
 
-	/* Termination semaphore. */
-	sem_t stop;
+	/* Termination eventfd, readable once a stop is requested. */
+	int stopfd;
 
 	/* Callback thread handle. */
 	pthread_t thread;
 
     /* Start/stop mutex */
 	pthread_mutex_t mutex;
+
+	/* Fence signals held back while the callback thread drains
+	 * completions, so that a fence is written once per wakeup. Only
+	 * accessed by the callback thread. */
+	bool draining;
+	struct gcfencesignal fence[GC_CALLBACK_FENCES];
+	unsigned int fencecount;
 };
 
 struct gccallbackinfo g_callbackinfo = {
-	.status = UNINIT
+	.status = UNINIT,
+	.stopfd = -1
 };
 
+static void signal_eventfd(int fd, unsigned int count)
+{
+	uint64_t value = count;
+
+	if (write(fd, &value, sizeof(value)) != sizeof(value))
+		GCERR("eventfd %d write failed (%d).\n", fd, errno);
+}
+
+static void flush_fences(struct gccallbackinfo *gccallbackinfo)
+{
+	unsigned int i;
+
+	for (i = 0; i < gccallbackinfo->fencecount; i += 1)
+		signal_eventfd(gccallbackinfo->fence[i].fence,
+			       gccallbackinfo->fence[i].count);
+
+	gccallbackinfo->fencecount = 0;
+}
+
+static bool stop_requested(struct gccallbackinfo *gccallbackinfo)
+{
+	struct pollfd pollfd;
+
+	pollfd.fd = gccallbackinfo->stopfd;
+	pollfd.events = POLLIN;
+
+	return poll(&pollfd, 1, 0) > 0;
+}
+
 static void *callbackthread(void *_gccallbackinfo)
 {
 	struct gccallbackinfo *gccallbackinfo;
 	struct gcicallbackwait gccmdcallbackwait;
+	unsigned int count;
 	int result;
 
 	/* Get callback info. */
@@ -96,31 +191,52 @@ static void *callbackthread(void *_gccallbackinfo)
 
 	/* Initialize the command. */
 	gccmdcallbackwait.handle = gccallbackinfo->handle;
-	gccmdcallbackwait.timeoutms = 2000;
 
-	/* Enter wait loop. */
-	while (1) {
-		/* Call the kernel to wait for callback event. */
-		result = ioctl(g_handle, GCIOCTL_CALLBACK_WAIT,
-			       &gccmdcallbackwait);
+	/* Enter wait loop; the stop request is checked before every
+	 * blocking wait so that one arriving while callbacks run is not
+	 * left for the timeout. */
+	while (!stop_requested(gccallbackinfo)) {
+		/* Block for the first callback, then collect the ones
+		 * already signalled without sleeping again. */
+		gccmdcallbackwait.timeoutms = GC_CALLBACK_TIMEOUT;
+		gccallbackinfo->draining = true;
+
+		for (count = 0; count < GC_CALLBACK_DRAIN; count += 1) {
+			/* Call the kernel to wait for callback event. */
+			result = g_backend->ioctl(g_handle,
+						  GCIOCTL_CALLBACK_WAIT,
+						  &gccmdcallbackwait);
+			if ((result != 0) ||
+			    (gccmdcallbackwait.gcerror != GCERR_NONE))
+				break;
+
+			/* Work completed. */
+			GCDBG(GCZONE_CALLBACK,
+			      "callback 0x%08X(0x%08X).\n",
+			      (unsigned int)
+				gccmdcallbackwait.callback,
+			      (unsigned int)
+				gccmdcallbackwait.callbackparam);
+
+			/* Invoke the callback. */
+			gccmdcallbackwait.callback(
+				gccmdcallbackwait.callbackparam);
+
+			gccmdcallbackwait.timeoutms = 0;
+		}
+
+		gccallbackinfo->draining = false;
+		flush_fences(gccallbackinfo);
+
+		GCDBG(GCZONE_CALLBACK, "%u callback(s) per wakeup.\n", count);
+
 		if (result == 0) {
-			if (gccmdcallbackwait.gcerror == GCERR_NONE) {
-				/* Work completed. */
-				GCDBG(GCZONE_CALLBACK,
-				      "callback 0x%08X(0x%08X).\n",
-				      (unsigned int)
-					gccmdcallbackwait.callback,
-				      (unsigned int)
-					gccmdcallbackwait.callbackparam);
-
-				/* Invoke the callback. */
-				gccmdcallbackwait.callback(
-					gccmdcallbackwait.callbackparam);
-			} else if (gccmdcallbackwait.gcerror == GCERR_TIMEOUT) {
-				/* Timeout. */
-				GCDBG(GCZONE_CALLBACK,
-				      "callback wait timeout.\n");
-			} else {
+			if (gccmdcallbackwait.gcerror == GCERR_TIMEOUT) {
+				/* Timeout, or nothing left to drain. */
+				if (count == 0)
+					GCDBG(GCZONE_CALLBACK,
+					      "callback wait timeout.\n");
+			} else if (gccmdcallbackwait.gcerror != GCERR_NONE) {
 				/* Error occurred. */
 				GCERR("callback wait failed (0x%08X).\n",
 				      gccmdcallbackwait.gcerror);
@@ -130,14 +246,9 @@ static void *callbackthread(void *_gccallbackinfo)
 			GCERR("callback wait ioctl failed (%d).\n", result);
 			break;
 		}
-
-		/* Stop requested? */
-		if (sem_trywait(&gccallbackinfo->stop) == 0) {
-			GCDBG(GCZONE_CALLBACK, "terminating.\n");
-			break;
-		}
 	}
 
+	GCDBG(GCZONE_CALLBACK, "terminating.\n");
 	return NULL;
 }
 
@@ -170,9 +281,9 @@ static int callback_start(struct gccallbackinfo *gccallbackinfo)
 
 	if (gccallbackinfo->status == SUPPORTED) {
 		/* Initialize callback. */
-		result = ioctl(g_handle,
-			       GCIOCTL_CALLBACK_ALLOC,
-			       &gccmdcallback);
+		result = g_backend->ioctl(g_handle,
+					  GCIOCTL_CALLBACK_ALLOC,
+					  &gccmdcallback);
 		if (result != 0) {
 			GCERR("callback ioctl failed (%d).\n", result);
 			goto fail;
@@ -187,13 +298,17 @@ static int callback_start(struct gccallbackinfo *gccallbackinfo)
 
 		gccallbackinfo->handle = gccmdcallback.handle;
 
-		/* Initialize the termination semaphore. */
-		result = sem_init(&gccallbackinfo->stop, 0, 0);
-		if (result != 0) {
-			GCERR("callback semaphore init failed (%d).\n", result);
+		/* Initialize the termination eventfd. */
+		gccallbackinfo->stopfd = eventfd(0, EFD_CLOEXEC);
+		if (gccallbackinfo->stopfd < 0) {
+			result = -errno;
+			GCERR("callback eventfd init failed (%d).\n", result);
 			goto fail;
 		}
 
+		gccallbackinfo->draining = false;
+		gccallbackinfo->fencecount = 0;
+
 		/* Start the thread. */
 		result = pthread_create(&gccallbackinfo->thread, NULL,
 					callbackthread, gccallbackinfo);
@@ -207,7 +322,13 @@ static int callback_start(struct gccallbackinfo *gccallbackinfo)
 
 fail:
 	if (gccmdcallback.handle != 0) {
-		ioctl(g_handle, GCIOCTL_CALLBACK_FREE, &gccmdcallback);
+		if (gccallbackinfo->stopfd >= 0) {
+			close(gccallbackinfo->stopfd);
+			gccallbackinfo->stopfd = -1;
+		}
+
+		g_backend->ioctl(g_handle, GCIOCTL_CALLBACK_FREE,
+				 &gccmdcallback);
 		gccallbackinfo->handle = 0;
 	}
 
@@ -227,8 +348,10 @@ static void callback_stop(struct gccallbackinfo *gccallbackinfo)
 
 	if (gccallbackinfo->status == SUPPORTED) {
 		if (gccallbackinfo->thread) {
-			sem_post(&gccallbackinfo->stop);
-			pthread_kill(gccallbackinfo->thread, SIGINT);
+			/* The eventfd stops a thread running callbacks, the
+			 * interrupt one blocked in the wait. */
+			signal_eventfd(gccallbackinfo->stopfd, 1);
+			g_backend->interrupt(gccallbackinfo->thread);
 
 			GCDBG(GCZONE_CALLBACK,
 			      "waiting to join callback thread...\n");
@@ -237,13 +360,17 @@ static void callback_stop(struct gccallbackinfo *gccallbackinfo)
 			gccallbackinfo->thread = 0;
 		}
 
+		close(gccallbackinfo->stopfd);
+		gccallbackinfo->stopfd = -1;
+
 		/* Free kernel resources. */
 		gccmdcallback.handle = gccallbackinfo->handle;
-		ioctl(g_handle, GCIOCTL_CALLBACK_FREE, &gccmdcallback);
+		g_backend->ioctl(g_handle, GCIOCTL_CALLBACK_FREE,
+				 &gccmdcallback);
 		gccallbackinfo->handle = 0;
 	}
 
-	gccallbackinfo->status == UNINIT;
+	gccallbackinfo->status = UNINIT;
 
 	pthread_mutex_unlock(&gccallbackinfo->mutex);
 
@@ -251,6 +378,127 @@ static void callback_stop(struct gccallbackinfo *gccallbackinfo)
 }
 
 
+/*******************************************************************************
+ * Completion fences (see gcbvext.h). The completions collected by one wakeup
+ * of the callback thread are written with a single signal per fence.
+ */
+
+int gcbvfence_create(void)
+{
+	int fence;
+
+	fence = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (fence < 0) {
+		GCERR("fence eventfd init failed (%d).\n", errno);
+		return -errno;
+	}
+
+	return fence;
+}
+
+void gcbvfence_destroy(int fence)
+{
+	close(fence);
+}
+
+void gcbvfence_signal(struct bvcallbackerror *err, unsigned long callbackdata)
+{
+	struct gccallbackinfo *gccallbackinfo = &g_callbackinfo;
+	int fence = (int) callbackdata;
+	unsigned int i;
+
+	/* On the callback thread, add up the completions of the wakeup. */
+	if (pthread_equal(pthread_self(), gccallbackinfo->thread) &&
+	    gccallbackinfo->draining) {
+		for (i = 0; i < gccallbackinfo->fencecount; i += 1)
+			if (gccallbackinfo->fence[i].fence == fence) {
+				gccallbackinfo->fence[i].count += 1;
+				return;
+			}
+
+		if (i < GC_CALLBACK_FENCES) {
+			gccallbackinfo->fence[i].fence = fence;
+			gccallbackinfo->fence[i].count = 1;
+			gccallbackinfo->fencecount += 1;
+			return;
+		}
+	}
+
+	signal_eventfd(fence, 1);
+}
+
+enum bverror gcbvfence_blt(struct bvbltparams *bvbltparams, int *fence)
+{
+	enum bverror bverror;
+	unsigned long flags = bvbltparams->flags;
+	bool created = false;
+
+	if (bvbltparams->callbackfn != NULL) {
+		BVSETBLTERROR(BVERR_FLAGS, "callback given with a fence");
+		goto exit;
+	}
+
+	/* Calls in the middle of a batch submit nothing to signal. */
+	if (((flags & BVFLAG_BATCH_MASK) == BVFLAG_BATCH_BEGIN) ||
+	    ((flags & BVFLAG_BATCH_MASK) == BVFLAG_BATCH_CONTINUE)) {
+		bverror = bv_blt(bvbltparams);
+		goto exit;
+	}
+
+	if (*fence < 0) {
+		*fence = gcbvfence_create();
+		if (*fence < 0) {
+			BVSETBLTERROR(BVERR_OOM, "fence creation failed");
+			goto exit;
+		}
+		created = true;
+	}
+
+	bvbltparams->flags |= BVFLAG_ASYNC;
+	bvbltparams->callbackfn = gcbvfence_signal;
+	bvbltparams->callbackdata = *fence;
+
+	bverror = bv_blt(bvbltparams);
+
+	bvbltparams->flags = flags;
+	bvbltparams->callbackfn = NULL;
+	bvbltparams->callbackdata = 0;
+
+	if ((bverror != BVERR_NONE) && created) {
+		gcbvfence_destroy(*fence);
+		*fence = -1;
+	}
+
+exit:
+	return bverror;
+}
+
+int gcbvfence_wait(int fence, int timeoutms)
+{
+	struct pollfd pollfd;
+	uint64_t value;
+	int result;
+
+	pollfd.fd = fence;
+	pollfd.events = POLLIN;
+
+	do
+		result = poll(&pollfd, 1, timeoutms);
+	while ((result < 0) && (errno == EINTR));
+
+	if (result < 0)
+		return -errno;
+
+	if (result == 0)
+		return 0;
+
+	if (read(fence, &value, sizeof(value)) != sizeof(value))
+		return (errno == EAGAIN) ? 0 : -errno;
+
+	return (int) value;
+}
+
+
 /*******************************************************************************
  * IOCTL wrappers.
  */
@@ -267,7 +515,7 @@ void gc_getcaps_wrapper(struct gcicaps *gcicaps)
 
 	GCPRINTDELAY();
 
-	result = ioctl(g_handle, GCIOCTL_GETCAPS, gcicaps);
+	result = g_backend->ioctl(g_handle, GCIOCTL_GETCAPS, gcicaps);
 	if (result != 0) {
 		GCERR("ioctl failed (%d).\n", result);
 		gcicaps->gcerror = GCERR_IOCTL;
@@ -279,7 +527,7 @@ void gc_map_wrapper(struct gcimap *gcmap)
 	int result;
 
 	GCPRINTDELAY();
-	result = ioctl(g_handle, GCIOCTL_MAP, gcmap);
+	result = g_backend->ioctl(g_handle, GCIOCTL_MAP, gcmap);
 
 	if (result != 0) {
 		GCERR("ioctl failed (%d).\n", result);
@@ -292,7 +540,7 @@ void gc_unmap_wrapper(struct gcimap *gcmap)
 	int result;
 
 	GCPRINTDELAY();
-	result = ioctl(g_handle, GCIOCTL_UNMAP, gcmap);
+	result = g_backend->ioctl(g_handle, GCIOCTL_UNMAP, gcmap);
 
 	if (result != 0) {
 		GCERR("ioctl failed (%d).\n", result);
@@ -302,6 +550,7 @@ void gc_unmap_wrapper(struct gcimap *gcmap)
 
 void gc_commit_wrapper(struct gcicommit *gccommit)
 {
+	unsigned int ticket;
 	int result;
 
 	GCPRINTDELAY();
@@ -312,12 +561,15 @@ void gc_commit_wrapper(struct gcicommit *gccommit)
 		callback_start(&g_callbackinfo);
 
 	gccommit->handle = g_callbackinfo.handle;
-	result = ioctl(g_handle, GCIOCTL_COMMIT, gccommit);
+	ticket = gccpu_commit_begin(gccommit);
+	result = g_backend->ioctl(g_handle, GCIOCTL_COMMIT, gccommit);
 
 	if (result != 0) {
 		GCERR("ioctl failed (%d).\n", result);
 		gccommit->gcerror = GCERR_IOCTL;
 	}
+
+	gccpu_commit_end(gccommit, ticket);
 }
 
 void gc_callback_wrapper(struct gcicallbackarm *gcicallbackarm)
@@ -329,7 +581,8 @@ void gc_callback_wrapper(struct gcicallbackarm *gcicallbackarm)
 	callback_start(&g_callbackinfo);
 
 	gcicallbackarm->handle = g_callbackinfo.handle;
-	result = ioctl(g_handle, GCIOCTL_CALLBACK_ARM, gcicallbackarm);
+	result = g_backend->ioctl(g_handle, GCIOCTL_CALLBACK_ARM,
+				  gcicallbackarm);
 	if (result != 0) {
 		GCERR("ioctl failed (%d).\n", result);
 		gcicallbackarm->gcerror = GCERR_IOCTL;
@@ -337,6 +590,100 @@ void gc_callback_wrapper(struct gcicallbackarm *gcicallbackarm)
 }
 
 
+/*******************************************************************************
+ * Phase timing.
+ */
+
+#if GCBV_PROFILE
+#define GCPROF_DEPTH 8
+
+static __thread struct {
+	enum gcprofphase stack[GCPROF_DEPTH];
+	int depth;
+	unsigned long long last;
+	unsigned long long time[GCPROF_PHASE_COUNT];
+	unsigned long long lockwait;
+	unsigned int lockwaits;
+} g_prof;
+
+/* Charge the time since the last transition to the current phase. */
+static void prof_charge(void)
+{
+	struct timespec ts;
+	unsigned long long now;
+
+	/* The monotonic clock is cheap enough to read at every transition,
+	 * the thread CPU clock is not. */
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	now = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+
+	if (g_prof.last != 0)
+		g_prof.time[g_prof.stack[g_prof.depth]] += now - g_prof.last;
+	g_prof.last = now;
+}
+
+void gcprof_push(enum gcprofphase phase)
+{
+	prof_charge();
+	if (g_prof.depth < GCPROF_DEPTH - 1)
+		g_prof.depth += 1;
+	g_prof.stack[g_prof.depth] = phase;
+}
+
+void gcprof_switch(enum gcprofphase phase)
+{
+	prof_charge();
+	g_prof.stack[g_prof.depth] = phase;
+}
+
+void gcprof_pop(void)
+{
+	prof_charge();
+	if (g_prof.depth > 0)
+		g_prof.depth -= 1;
+}
+
+void gcprof_read(unsigned long long time[GCPROF_PHASE_COUNT], bool reset)
+{
+	prof_charge();
+	memcpy(time, g_prof.time, sizeof(g_prof.time));
+	if (reset)
+		memset(g_prof.time, 0, sizeof(g_prof.time));
+}
+
+int gcprof_lock(pthread_mutex_t *lock)
+{
+	struct timespec start, end;
+	int result;
+
+	/* Only contended locks are timed. */
+	if (pthread_mutex_trylock(lock) == 0)
+		return 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	result = pthread_mutex_lock(lock);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	g_prof.lockwait += (end.tv_sec - start.tv_sec) * 1000000000ULL
+			 + end.tv_nsec - start.tv_nsec;
+	g_prof.lockwaits += 1;
+
+	return result;
+}
+
+void gcprof_readlocks(unsigned long long *time, unsigned int *count,
+		      bool reset)
+{
+	*time = g_prof.lockwait;
+	*count = g_prof.lockwaits;
+	if (reset) {
+		g_prof.lockwait = 0;
+		g_prof.lockwaits = 0;
+	}
+}
+#endif
+
+
 /*******************************************************************************
  * Convert floating point in 0..1 range to an 8-bit value in range 0..255.
  */
@@ -449,26 +796,196 @@ void free_surface(struct bvbuffdesc *bvbuffdesc,
 
 /*******************************************************************************
  * Cache operation wrapper.
+ *
+ * Takes any number of regions. Regions that overlap or touch are merged and
+ * the rest go to the driver GC_CACHE_REGIONS at a time. Cleans and flushes
+ * of regions of one buffer are widened to a single range spanning all the
+ * regions when they add up to GC_CACHE_WHOLE_THRESHOLD, past which the
+ * driver maintains the whole cache anyway, or when less than half of that
+ * range lies between them. Regions of separate buffers are never widened,
+ * the pages between the buffers may not be mapped. Invalidations are never
+ * widened either, as that would drop CPU writes next to the regions.
  */
 
+#define GC_CACHE_REGIONS		countof(((struct gcicache *) 0)->rgn)
+#define GC_CACHE_WHOLE_THRESHOLD	L2THRESHOLD
+
+/* Regions handled without allocating. */
+#define GC_CACHE_LOCAL			16
+
+static char *get_region_end(struct c2dmrgn *rgn)
+{
+	return rgn->start + (rgn->lines - 1) * rgn->stride + rgn->span;
+}
+
+/* Turns regions whose lines follow each other into a single line. */
+static void linearize_region(struct c2dmrgn *rgn)
+{
+	if ((rgn->lines > 1) &&
+	    ((rgn->stride <= 0) || (rgn->span < (size_t) rgn->stride)))
+		return;
+
+	rgn->span = get_region_end(rgn) - rgn->start;
+	rgn->lines = 1;
+	rgn->stride = rgn->span;
+}
+
+/* Merges rgn2 into rgn1 if the result covers exactly the two regions. */
+static bool merge_region(struct c2dmrgn *rgn1, struct c2dmrgn *rgn2)
+{
+	struct c2dmrgn *upper, *lower;
+	char *end1, *end2;
+	long offset;
+
+	end1 = get_region_end(rgn1);
+	end2 = get_region_end(rgn2);
+
+	/* Overlapping or adjacent ranges. */
+	if ((rgn1->lines == 1) && (rgn2->lines == 1)) {
+		if ((rgn2->start > end1) || (rgn1->start > end2))
+			return false;
+
+		rgn1->start = min(rgn1->start, rgn2->start);
+		rgn1->span = max(end1, end2) - rgn1->start;
+		rgn1->stride = rgn1->span;
+		return true;
+	}
+
+	if ((rgn1->stride != rgn2->stride) || (rgn1->stride <= 0))
+		return false;
+
+	upper = (rgn1->start <= rgn2->start) ? rgn1 : rgn2;
+	lower = (rgn1->start <= rgn2->start) ? rgn2 : rgn1;
+	offset = lower->start - upper->start;
+
+	/* Rectangles on the same lines, side by side or overlapping. */
+	if ((rgn1->lines == rgn2->lines) && (offset <= (long) upper->span)) {
+		rgn1->span = max(upper->span, offset + lower->span);
+		rgn1->start = upper->start;
+		linearize_region(rgn1);
+		return true;
+	}
+
+	/* Rectangles in the same columns, one above or over the other. */
+	if ((rgn1->span == rgn2->span) && ((offset % rgn1->stride) == 0) &&
+	    (offset <= (long) (upper->lines * upper->stride))) {
+		rgn1->lines = max(upper->lines,
+				  offset / rgn1->stride + lower->lines);
+		rgn1->start = upper->start;
+		linearize_region(rgn1);
+		return true;
+	}
+
+	return false;
+}
+
+/* Merges the regions in place, returns the number left. */
+static int merge_regions(int count, struct c2dmrgn rgn[])
+{
+	bool merged;
+	int i, j;
+
+	do {
+		merged = false;
+
+		for (i = 0; i < count; i += 1) {
+			for (j = i + 1; j < count; j += 1) {
+				if (!merge_region(&rgn[i], &rgn[j]))
+					continue;
+
+				rgn[j--] = rgn[--count];
+				merged = true;
+			}
+		}
+	} while (merged);
+
+	return count;
+}
+
+/* Replaces the regions with the range spanning them all when worth it. */
+static int widen_regions(int count, struct c2dmrgn rgn[])
+{
+	unsigned long bytes = 0;
+	char *start, *end;
+	int i;
+
+	start = rgn[0].start;
+	end = get_region_end(&rgn[0]);
+
+	for (i = 0; i < count; i += 1) {
+		/* Bottom up regions have no simple extent. */
+		if (rgn[i].stride < 0)
+			return count;
+
+		bytes += rgn[i].span * rgn[i].lines;
+		start = min(start, rgn[i].start);
+		end = max(end, get_region_end(&rgn[i]));
+	}
+
+	if ((count == 1) && (rgn[0].lines == 1))
+		return count;
+
+	if ((bytes < GC_CACHE_WHOLE_THRESHOLD) &&
+	    ((unsigned long) (end - start) > bytes * 2))
+		return count;
+
+	rgn[0].start = start;
+	rgn[0].span = end - start;
+	rgn[0].lines = 1;
+	rgn[0].stride = rgn[0].span;
+
+	return 1;
+}
+
 enum bverror gcbvcacheop(int count, struct c2dmrgn rgn[],
-			 enum bvcacheop cacheop)
+			 enum bvcacheop cacheop, bool onebuffer)
 {
 	int result;
 	struct gcicache xfer;
+	struct c2dmrgn local[GC_CACHE_LOCAL];
+	struct c2dmrgn *list;
+	int i, used;
 
-	if ((count < 0) || (count > 3))
+	if ((count < 0) || (cacheop > BVCACHE_CPU_FROM_DEVICE))
 		return BVERR_CACHEOP;
 
-	xfer.count = count;
+	if (count <= GC_CACHE_LOCAL) {
+		list = local;
+	} else {
+		list = gcalloc(struct c2dmrgn, count * sizeof(struct c2dmrgn));
+		if (list == NULL)
+			return BVERR_OOM;
+	}
+
+	/* Drop empty regions. */
+	for (i = 0, used = 0; i < count; i += 1) {
+		if ((rgn[i].span == 0) || (rgn[i].lines == 0))
+			continue;
+
+		list[used] = rgn[i];
+		linearize_region(&list[used]);
+		used += 1;
+	}
+
+	used = merge_regions(used, list);
+	if ((used > 0) && onebuffer && (cacheop != BVCACHE_CPU_FROM_DEVICE))
+		used = widen_regions(used, list);
+
 	xfer.dir = cacheop;
-	memcpy(xfer.rgn, rgn, count * sizeof(struct c2dmrgn));
 
-	GCPRINTDELAY();
-	result = ioctl(g_handle, GCIOCTL_CACHE, &xfer);
+	for (i = 0; i < used; i += xfer.count) {
+		xfer.count = min(used - i, (int) GC_CACHE_REGIONS);
+		memcpy(xfer.rgn, &list[i], xfer.count * sizeof(struct c2dmrgn));
 
-	if (result != 0)
-		GCERR("ioctl failed (%d).\n", result);
+		GCPRINTDELAY();
+		result = g_backend->ioctl(g_handle, GCIOCTL_CACHE, &xfer);
+
+		if (result != 0)
+			GCERR("ioctl failed (%d).\n", result);
+	}
+
+	if (list != local)
+		gcfree(list);
 
 	return BVERR_NONE;
 }
@@ -481,6 +998,9 @@ enum bverror gcbvcacheop(int count, struct c2dmrgn rgn[],
 void  __attribute__((constructor)) dev_init(void)
 {
 	char *env;
+#if GCBV_EMULATOR
+	int emulate;
+#endif
 
 	env = getenv("GCBV_DEBUG");
 	if (env && (atol(env) != 0))
@@ -491,14 +1011,63 @@ void  __attribute__((constructor)) dev_init(void)
 
 	GCENTER(GCZONE_INIT);
 
-	g_handle = open("/dev/gcioctl", O_RDWR);
-	if (g_handle == -1) {
-		GCERR("failed to open device (%d).\n", errno);
-		goto fail;
+#if GCBV_EMULATOR
+	env = getenv("GCBV_EMULATE");
+	emulate = env ? atoi(env) : GCEMU_DEFAULT;
+
+	if (emulate != GCEMU_OFF) {
+		g_handle = gcemu_open(emulate);
+		if (g_handle == -1) {
+			GCERR("failed to start the emulator.\n");
+			goto fail;
+		}
+
+		g_backend = &g_emubackend;
+	}
+#endif
+
+	if (g_backend == &g_devbackend) {
+		g_handle = open("/dev/gcioctl", O_RDWR);
+		if (g_handle == -1) {
+			GCERR("failed to open device (%d).\n", errno);
+			goto fail;
+		}
 	}
 
 	bv_init();
 
+	/* Size of the idle mappings to keep, in kilobytes. */
+	env = getenv("GCBV_MAPCACHE");
+	if (env)
+		get_context()->mapcachebudget = atol(env) * 1024;
+
+	/* Cache virtual buffers too; the client then has to bv_unmap()
+	 * them before freeing them. */
+	env = getenv("GCBV_MAPCACHE_VIRTUAL");
+	if (env)
+		get_context()->mapcachevirtual = (atoi(env) != 0);
+
+	/* Number of computed filter kernels to keep. */
+	env = getenv("GCBV_FILTERCACHE");
+	if (env)
+		get_context()->filtercache.max = atol(env);
+
+	/* Size of the temporary surfaces to keep, in kilobytes, and the
+	 * number of requests an idle one is kept for. */
+	env = getenv("GCBV_TEMPPOOL");
+	if (env)
+		get_context()->temppool.budget = atol(env) * 1024;
+
+	env = getenv("GCBV_TEMPAGE");
+	if (env)
+		get_context()->temppool.maxage = atol(env);
+
+	/* Weighted pixels below which blits run on the CPU. */
+	gccpu_init();
+	env = getenv("GCBV_CPUBLIT");
+	if (env)
+		gccpu_setthreshold(atol(env));
+
 	pthread_mutex_init(&g_callbackinfo.mutex, 0);
 
 	GCEXIT(GCZONE_INIT);
@@ -521,7 +1090,12 @@ void __attribute__((destructor)) dev_exit(void)
 	callback_stop(&g_callbackinfo);
 
 	if (g_handle != 0) {
-		close(g_handle);
+#if GCBV_EMULATOR
+		if (g_backend == &g_emubackend)
+			gcemu_close(g_handle);
+		else
+#endif
+			close(g_handle);
 		g_handle = 0;
 	}
 
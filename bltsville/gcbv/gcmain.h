@@ -43,6 +43,7 @@
 #include <bltsville.h>
 #include <bvinternal.h>
 #include <bverror.h>
+#include <gcbvext.h>
 
 #define GC_DEV_NAME	"gc2duser"
 
@@ -65,6 +66,10 @@
 
 #define EXPORT_SYMBOL(sym)
 
+#if !defined(__unused)
+#define __unused __attribute__((unused))
+#endif
+
 #define gc_debug_blt(...)
 
 typedef int64_t s64;
@@ -127,8 +132,52 @@ unsigned char gcfp2norm8(float value);
  * Cache operation wrapper.
  */
 
+/* Set onebuffer only when every region lies in the same buffer. */
 enum bverror gcbvcacheop(int count, struct c2dmrgn rgn[],
-			 enum bvcacheop cacheop);
+			 enum bvcacheop cacheop, bool onebuffer);
+
+
+/*******************************************************************************
+ * Per phase timing of bv_blt, enabled with GCBV_PROFILE. Time is charged
+ * to the innermost phase on the calling thread, so a mapping done while
+ * parsing counts as mapping only.
+ */
+
+#if !defined(GCBV_PROFILE)
+#define GCBV_PROFILE 0
+#endif
+
+enum gcprofphase {
+	GCPROF_IDLE,		/* outside of the library */
+	GCPROF_PARSE,		/* argument validation and surface parsing */
+	GCPROF_MAP,		/* buffer mapping */
+	GCPROF_BUILD,		/* command buffer generation */
+	GCPROF_COMMIT,		/* GCIOCTL_COMMIT */
+
+	GCPROF_PHASE_COUNT
+};
+
+#if GCBV_PROFILE
+void gcprof_push(enum gcprofphase phase);
+void gcprof_switch(enum gcprofphase phase);
+void gcprof_pop(void);
+
+/* Nanoseconds spent in each phase by the calling thread. */
+void gcprof_read(unsigned long long time[GCPROF_PHASE_COUNT], bool reset);
+
+/* Nanoseconds the calling thread waited for gcbv locks held by other
+ * threads, and how many times it had to. */
+void gcprof_readlocks(unsigned long long *time, unsigned int *count,
+		      bool reset);
+
+#define GCPROF_PUSH(phase)	gcprof_push(phase)
+#define GCPROF_SWITCH(phase)	gcprof_switch(phase)
+#define GCPROF_POP()		gcprof_pop()
+#else
+#define GCPROF_PUSH(phase)
+#define GCPROF_SWITCH(phase)
+#define GCPROF_POP()
+#endif
 
 
 /*******************************************************************************
@@ -65,6 +65,240 @@ GCDBG_FILTERDEF(buffer, GCZONE_NONE,
 )
 
 
+/*******************************************************************************
+ * Vacant object caches.
+ */
+
+static void release_batch(struct list_head *head)
+{
+	gcfree(list_entry(head, struct gcbatch, link));
+}
+
+static void release_buffer(struct list_head *head)
+{
+	gcfree(list_entry(head, struct gcbuffer, link));
+}
+
+static void release_fixup(struct list_head *head)
+{
+	gcfree(list_entry(head, struct gcfixup, link));
+}
+
+static void init_vacant(struct gcvacant *gcvacant)
+{
+	INIT_LIST_HEAD(&gcvacant->list);
+	gcvacant->count = 0;
+}
+
+/* Moves up to count objects from the head of one list to the other. */
+static void move_vacant(struct gcvacant *from, struct gcvacant *to,
+			unsigned int count)
+{
+	while ((from->count > 0) && (count > 0)) {
+		list_move(from->list.next, &to->list);
+		from->count -= 1;
+		to->count += 1;
+		count -= 1;
+	}
+}
+
+static struct gcmagazine *get_magazine(void)
+{
+	struct gccontext *gccontext = get_context();
+	struct gcmagazine *gcmagazine;
+
+	if (!gccontext->magazineenable)
+		return NULL;
+
+	gcmagazine = GCTHREAD_GET(gccontext->magazinekey);
+	if (gcmagazine != NULL)
+		return gcmagazine;
+
+	/* Without a magazine the thread goes to the shared lists. */
+	gcmagazine = gcalloc(struct gcmagazine, sizeof(struct gcmagazine));
+	if (gcmagazine == NULL)
+		return NULL;
+
+	init_vacant(&gcmagazine->batchvac);
+	init_vacant(&gcmagazine->buffervac);
+	init_vacant(&gcmagazine->fixupvac);
+
+	if (GCTHREAD_SET(gccontext->magazinekey, gcmagazine) != 0) {
+		gcfree(gcmagazine);
+		return NULL;
+	}
+
+	GCLOCK(&gccontext->batchlock);
+	list_add(&gcmagazine->link, &gccontext->magazines);
+	GCUNLOCK(&gccontext->batchlock);
+
+	GCDBG(GCZONE_BATCH_ALLOC, "new magazine = 0x%08X\n",
+	      (unsigned int) gcmagazine);
+
+	return gcmagazine;
+}
+
+/* Takes a vacant object off the magazine, refilling the magazine from the
+ * shared list when it is empty. Returns NULL if both are empty. */
+static struct list_head *get_vacant(struct gcvacant *magazine,
+				    struct gcvacant *shared,
+				    GCLOCK_TYPE *lock,
+				    unsigned int max)
+{
+	struct gcvacant *vacant = magazine;
+	struct list_head *head = NULL;
+
+	if ((magazine == NULL) || (magazine->count == 0)) {
+		GCLOCK(lock);
+
+		if (magazine == NULL)
+			vacant = shared;
+		else
+			move_vacant(shared, magazine, max / 2);
+
+		if (vacant->count > 0) {
+			head = vacant->list.next;
+			list_del(head);
+			vacant->count -= 1;
+		}
+
+		GCUNLOCK(lock);
+	} else {
+		head = magazine->list.next;
+		list_del(head);
+		magazine->count -= 1;
+	}
+
+	return head;
+}
+
+/* Returns an object to the magazine; once the magazine overflows, its
+ * least recently freed half goes to the shared list, and whatever does not
+ * fit there is released. */
+static void put_vacant(struct gcvacant *magazine,
+		       struct gcvacant *shared,
+		       GCLOCK_TYPE *lock,
+		       unsigned int max,
+		       unsigned int sharedmax,
+		       struct list_head *head,
+		       void (*release)(struct list_head *head))
+{
+	if (magazine == NULL) {
+		GCLOCK(lock);
+
+		if (shared->count < sharedmax) {
+			list_add(head, &shared->list);
+			shared->count += 1;
+		} else {
+			release(head);
+		}
+
+		GCUNLOCK(lock);
+		return;
+	}
+
+	list_add(head, &magazine->list);
+	magazine->count += 1;
+
+	if (magazine->count <= max)
+		return;
+
+	GCLOCK(lock);
+
+	while (magazine->count > max / 2) {
+		head = magazine->list.prev;
+		magazine->count -= 1;
+
+		if (shared->count < sharedmax) {
+			list_move(head, &shared->list);
+			shared->count += 1;
+		} else {
+			list_del(head);
+			release(head);
+		}
+	}
+
+	GCUNLOCK(lock);
+}
+
+static void release_vacant(struct gcvacant *gcvacant,
+			   void (*release)(struct list_head *head))
+{
+	struct list_head *head;
+
+	while (!list_empty(&gcvacant->list)) {
+		head = gcvacant->list.next;
+		list_del(head);
+		release(head);
+	}
+
+	gcvacant->count = 0;
+}
+
+/* Thread exit destructor; hands the cached objects back to the shared
+ * lists, within their limits. */
+void free_magazine(void *ptr)
+{
+	struct gccontext *gccontext = get_context();
+	struct gcmagazine *gcmagazine = ptr;
+
+	GCLOCK(&gccontext->batchlock);
+	list_del(&gcmagazine->link);
+	move_vacant(&gcmagazine->batchvac, &gccontext->batchvac,
+		    GC_VACANT_BATCH_MAX - min(gccontext->batchvac.count,
+					      GC_VACANT_BATCH_MAX));
+	GCUNLOCK(&gccontext->batchlock);
+
+	GCLOCK(&gccontext->bufferlock);
+	move_vacant(&gcmagazine->buffervac, &gccontext->buffervac,
+		    GC_VACANT_BUFFER_MAX - min(gccontext->buffervac.count,
+					       GC_VACANT_BUFFER_MAX));
+	GCUNLOCK(&gccontext->bufferlock);
+
+	GCLOCK(&gccontext->fixuplock);
+	move_vacant(&gcmagazine->fixupvac, &gccontext->fixupvac,
+		    GC_VACANT_FIXUP_MAX - min(gccontext->fixupvac.count,
+					      GC_VACANT_FIXUP_MAX));
+	GCUNLOCK(&gccontext->fixuplock);
+
+	release_vacant(&gcmagazine->batchvac, release_batch);
+	release_vacant(&gcmagazine->buffervac, release_buffer);
+	release_vacant(&gcmagazine->fixupvac, release_fixup);
+
+	GCDBG(GCZONE_BATCH_ALLOC, "magazine freed = 0x%08X\n",
+	      (unsigned int) gcmagazine);
+
+	gcfree(gcmagazine);
+}
+
+/* Moves the contents of all magazines to the shared lists, to be freed
+ * along with them. */
+void free_magazines(void)
+{
+	struct gccontext *gccontext = get_context();
+	struct gcmagazine *gcmagazine;
+
+	if (!gccontext->magazineenable)
+		return;
+
+	GCTHREAD_KEY_DESTROY(gccontext->magazinekey);
+	gccontext->magazineenable = false;
+
+	while (!list_empty(&gccontext->magazines)) {
+		gcmagazine = list_entry(gccontext->magazines.next,
+					struct gcmagazine, link);
+		list_del(&gcmagazine->link);
+
+		move_vacant(&gcmagazine->batchvac, &gccontext->batchvac, ~0U);
+		move_vacant(&gcmagazine->buffervac, &gccontext->buffervac,
+			    ~0U);
+		move_vacant(&gcmagazine->fixupvac, &gccontext->fixupvac, ~0U);
+
+		gcfree(gcmagazine);
+	}
+}
+
+
 /*******************************************************************************
  * Batch/command buffer management.
  */
@@ -80,15 +314,19 @@ enum bverror allocate_batch(struct bvbltparams *bvbltparams,
 {
 	enum bverror bverror;
 	struct gccontext *gccontext = get_context();
+	struct gcmagazine *gcmagazine;
+	struct list_head *head;
 	struct gcbatch *temp;
 	struct gcbuffer *gcbuffer;
 
 	GCENTER(GCZONE_BATCH_ALLOC);
 
-	/* Lock access to batch management. */
-	GCLOCK(&gccontext->batchlock);
+	gcmagazine = get_magazine();
+	head = get_vacant(gcmagazine ? &gcmagazine->batchvac : NULL,
+			  &gccontext->batchvac, &gccontext->batchlock,
+			  GC_MAGAZINE_BATCH_MAX);
 
-	if (list_empty(&gccontext->batchvac)) {
+	if (head == NULL) {
 		temp = gcalloc(struct gcbatch, sizeof(struct gcbatch));
 		if (temp == NULL) {
 			BVSETBLTERROR(BVERR_OOM,
@@ -99,10 +337,7 @@ enum bverror allocate_batch(struct bvbltparams *bvbltparams,
 		GCDBG(GCZONE_BATCH_ALLOC, "allocated new batch = 0x%08X\n",
 		      (unsigned int) temp);
 	} else {
-		struct list_head *head;
-		head = gccontext->batchvac.next;
 		temp = list_entry(head, struct gcbatch, link);
-		list_del(head);
 
 		GCDBG(GCZONE_BATCH_ALLOC, "reusing batch = 0x%08X\n",
 		      (unsigned int) temp);
@@ -113,8 +348,12 @@ enum bverror allocate_batch(struct bvbltparams *bvbltparams,
 	temp->batchend = do_end;
 	INIT_LIST_HEAD(&temp->buffer);
 	INIT_LIST_HEAD(&temp->unmap);
+	INIT_LIST_HEAD(&temp->temp);
 	INIT_LIST_HEAD(&temp->link);
 
+	/* No fill color converted yet, see getfillcolor(). */
+	temp->fillcomp = NULL;
+
 	bverror = append_buffer(bvbltparams, temp, &gcbuffer);
 	if (bverror != BVERR_NONE) {
 		free_batch(temp);
@@ -127,9 +366,6 @@ enum bverror allocate_batch(struct bvbltparams *bvbltparams,
 	      (unsigned int) temp);
 
 exit:
-	/* Unlock access to batch management. */
-	GCUNLOCK(&gccontext->batchlock);
-
 	GCEXITARG(GCZONE_BATCH_ALLOC, "bv%s = %d\n",
 		  (bverror == BVERR_NONE) ? "result" : "error", bverror);
 	return bverror;
@@ -139,40 +375,53 @@ void free_batch(struct gcbatch *gcbatch)
 {
 	struct list_head *head;
 	struct gccontext *gccontext = get_context();
+	struct gcmagazine *gcmagazine;
 	struct gcbuffer *gcbuffer;
 
 	GCENTERARG(GCZONE_BATCH_ALLOC, "batch = 0x%08X\n",
 		   (unsigned int) gcbatch);
 
-	/* Lock access. */
-	GCLOCK(&gccontext->batchlock);
-	GCLOCK(&gccontext->bufferlock);
-	GCLOCK(&gccontext->fixuplock);
-	GCLOCK(&gccontext->maplock);
+	gcmagazine = get_magazine();
 
 	/* Free implicit unmappings. */
-	list_splice_init(&gcbatch->unmap, &gccontext->unmapvac);
+	if (!list_empty(&gcbatch->unmap)) {
+		GCLOCK(&gccontext->maplock);
+		list_splice_init(&gcbatch->unmap, &gccontext->unmapvac);
+		GCUNLOCK(&gccontext->maplock);
+	}
+
+	/* Return temporary surfaces. */
+	release_temp(gcbatch);
 
 	/* Free command buffers. */
 	while (!list_empty(&gcbatch->buffer)) {
 		head = gcbatch->buffer.next;
 		gcbuffer = list_entry(head, struct gcbuffer, link);
+		list_del(head);
 
 		/* Free fixups. */
-		list_splice_init(&gcbuffer->fixup, &gccontext->fixupvac);
+		while (!list_empty(&gcbuffer->fixup)) {
+			head = gcbuffer->fixup.next;
+			list_del(head);
+
+			put_vacant(gcmagazine ? &gcmagazine->fixupvac : NULL,
+				   &gccontext->fixupvac, &gccontext->fixuplock,
+				   GC_MAGAZINE_FIXUP_MAX, GC_VACANT_FIXUP_MAX,
+				   head, release_fixup);
+		}
 
 		/* Free the command buffer. */
-		list_move(&gcbuffer->link, &gccontext->buffervac);
+		put_vacant(gcmagazine ? &gcmagazine->buffervac : NULL,
+			   &gccontext->buffervac, &gccontext->bufferlock,
+			   GC_MAGAZINE_BUFFER_MAX, GC_VACANT_BUFFER_MAX,
+			   &gcbuffer->link, release_buffer);
 	}
 
 	/* Free the batch. */
-	list_add(&gcbatch->link, &gccontext->batchvac);
-
-	/* Unlock access. */
-	GCUNLOCK(&gccontext->maplock);
-	GCUNLOCK(&gccontext->fixuplock);
-	GCUNLOCK(&gccontext->bufferlock);
-	GCUNLOCK(&gccontext->batchlock);
+	put_vacant(gcmagazine ? &gcmagazine->batchvac : NULL,
+		   &gccontext->batchvac, &gccontext->batchlock,
+		   GC_MAGAZINE_BATCH_MAX, GC_VACANT_BATCH_MAX,
+		   &gcbatch->link, release_batch);
 
 	GCEXIT(GCZONE_BATCH_ALLOC);
 }
@@ -183,15 +432,19 @@ enum bverror append_buffer(struct bvbltparams *bvbltparams,
 {
 	enum bverror bverror;
 	struct gccontext *gccontext = get_context();
+	struct gcmagazine *gcmagazine;
+	struct list_head *head;
 	struct gcbuffer *temp;
 
 	GCENTERARG(GCZONE_BUFFER_ALLOC, "batch = 0x%08X\n",
 		   (unsigned int) gcbatch);
 
-	/* Lock access to buffer management. */
-	GCLOCK(&gccontext->bufferlock);
+	gcmagazine = get_magazine();
+	head = get_vacant(gcmagazine ? &gcmagazine->buffervac : NULL,
+			  &gccontext->buffervac, &gccontext->bufferlock,
+			  GC_MAGAZINE_BUFFER_MAX);
 
-	if (list_empty(&gccontext->buffervac)) {
+	if (head == NULL) {
 		temp = gcalloc(struct gcbuffer, GC_BUFFER_SIZE);
 		if (temp == NULL) {
 			BVSETBLTERROR(BVERR_OOM,
@@ -199,21 +452,17 @@ enum bverror append_buffer(struct bvbltparams *bvbltparams,
 			goto exit;
 		}
 
-		list_add_tail(&temp->link, &gcbatch->buffer);
-
 		GCDBG(GCZONE_BUFFER_ALLOC, "allocated new buffer = 0x%08X\n",
 		      (unsigned int) temp);
 	} else {
-		struct list_head *head;
-		head = gccontext->buffervac.next;
 		temp = list_entry(head, struct gcbuffer, link);
 
-		list_move_tail(&temp->link, &gcbatch->buffer);
-
 		GCDBG(GCZONE_BUFFER_ALLOC, "reusing buffer = 0x%08X\n",
 		      (unsigned int) temp);
 	}
 
+	list_add_tail(&temp->link, &gcbatch->buffer);
+
 	INIT_LIST_HEAD(&temp->fixup);
 	temp->pixelcount = 0;
 	temp->head = temp->tail = (unsigned int *) (temp + 1);
@@ -226,9 +475,6 @@ enum bverror append_buffer(struct bvbltparams *bvbltparams,
 	bverror = BVERR_NONE;
 
 exit:
-	/* Unlock access to buffer management. */
-	GCUNLOCK(&gccontext->bufferlock);
-
 	GCEXITARG(GCZONE_BUFFER_ALLOC, "bv%s = %d\n",
 		  (bverror == BVERR_NONE) ? "result" : "error", bverror);
 	return bverror;
@@ -240,31 +486,34 @@ static enum bverror allocate_fixup(struct bvbltparams *bvbltparams,
 {
 	enum bverror bverror = BVERR_NONE;
 	struct gccontext *gccontext = get_context();
+	struct gcmagazine *gcmagazine;
+	struct list_head *head;
 	struct gcfixup *temp;
 
-	if (list_empty(&gccontext->fixupvac)) {
+	gcmagazine = get_magazine();
+	head = get_vacant(gcmagazine ? &gcmagazine->fixupvac : NULL,
+			  &gccontext->fixupvac, &gccontext->fixuplock,
+			  GC_MAGAZINE_FIXUP_MAX);
+
+	if (head == NULL) {
 		temp = gcalloc(struct gcfixup, sizeof(struct gcfixup));
 		if (temp == NULL) {
 			BVSETBLTERROR(BVERR_OOM, "fixup allocation failed");
 			goto exit;
 		}
 
-		list_add_tail(&temp->link, &gcbuffer->fixup);
-
 		GCDBG(GCZONE_FIXUP_ALLOC,
 		      "new fixup struct allocated = 0x%08X\n",
 		      (unsigned int) temp);
 	} else {
-		struct list_head *head;
-		head = gccontext->fixupvac.next;
 		temp = list_entry(head, struct gcfixup, link);
 
-		list_move_tail(&temp->link, &gcbuffer->fixup);
-
 		GCDBG(GCZONE_FIXUP_ALLOC, "fixup struct reused = 0x%08X\n",
 			(unsigned int) temp);
 	}
 
+	list_add_tail(&temp->link, &gcbuffer->fixup);
+
 	temp->count = 0;
 	*gcfixup = temp;
 
@@ -278,7 +527,6 @@ enum bverror add_fixup(struct bvbltparams *bvbltparams,
 		       unsigned int surfoffset)
 {
 	enum bverror bverror = BVERR_NONE;
-	struct gccontext *gccontext = get_context();
 	struct list_head *head;
 	struct gcbuffer *buffer;
 	struct gcfixup *gcfixup;
@@ -286,9 +534,6 @@ enum bverror add_fixup(struct bvbltparams *bvbltparams,
 	GCENTERARG(GCZONE_FIXUP, "batch = 0x%08X, fixup ptr = 0x%08X\n",
 		   (unsigned int) gcbatch, (unsigned int) ptr);
 
-	/* Lock access to fixup management. */
-	GCLOCK(&gccontext->fixuplock);
-
 	/* Get the current command buffer. */
 	if (list_empty(&gcbatch->buffer)) {
 		GCERR("no command buffers are allocated");
@@ -329,9 +574,6 @@ enum bverror add_fixup(struct bvbltparams *bvbltparams,
 	GCDBG(GCZONE_FIXUP, "surface offset = 0x%08X\n", surfoffset);
 
 exit:
-	/* Unlock access to fixup management. */
-	GCUNLOCK(&gccontext->fixuplock);
-
 	GCEXITARG(GCZONE_FIXUP, "bv%s = %d\n",
 		  (bverror == BVERR_NONE) ? "result" : "error", bverror);
 	return bverror;
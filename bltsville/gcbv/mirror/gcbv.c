@@ -244,23 +244,14 @@ struct gccallbackbltsville {
 	unsigned long data;
 };
 
-/* Information for freeing a surface. */
-struct gccallbackfreesurface {
-	/* Pointer to the buffer descriptor. */
-	struct bvbuffdesc *desc;
-
-	/* Pointer to the buffer. */
-	void *ptr;
-};
-
 /* Callback information. */
 struct gccallbackinfo {
 	union {
 		/* BLTsville callback function. */
 		struct gccallbackbltsville callback;
 
-		/* Information for freeing a surface. */
-		struct gccallbackfreesurface freesurface;
+		/* Temporary surface holds to drop (gctempref). */
+		struct list_head temp;
 	} info;
 
 	/* Previous/next callback information. */
@@ -333,140 +324,282 @@ void callbackbltsville(void *callbackinfo)
 	GCEXIT(GCZONE_CALLBACK);
 }
 
-void callbackfreesurface(void *callbackinfo)
+
+/*******************************************************************************
+ * Temporary surface pool.
+ */
+
+/* Smallest bucket with surfaces of at least size bytes. */
+static unsigned int get_temp_bucket(unsigned int size)
+{
+	unsigned int bucket = 0;
+
+	while ((bucket < GC_TEMP_BUCKETS - 1) &&
+	       ((unsigned int) (PAGE_SIZE << bucket) < size))
+		bucket += 1;
+
+	return bucket;
+}
+
+/* Called with templock held. */
+static void destroy_temp(struct gctempsurface *gctempsurface)
+{
+	struct gctemppool *temppool = &get_context()->temppool;
+
+	GCDBG(GCZONE_TEMP, "freeing %d bytes @ 0x%08X\n",
+	      gctempsurface->desc->length,
+	      (unsigned int) gctempsurface->buffer);
+
+	list_del(&gctempsurface->link);
+	list_del(&gctempsurface->lrulink);
+
+	temppool->size -= gctempsurface->desc->length;
+
+	bv_unmap(gctempsurface->desc);
+	free_surface(gctempsurface->desc, gctempsurface->buffer);
+	gcfree(gctempsurface);
+}
+
+/* Frees the unused surfaces that are too old, then the least recently
+ * used ones until size more bytes fit the budget. Called with templock
+ * held. */
+static void trim_temp(unsigned int size)
+{
+	struct gctemppool *temppool = &get_context()->temppool;
+	struct gctempsurface *gctempsurface;
+	struct list_head *head, *temphead;
+
+	list_for_each_safe(head, temphead, &temppool->lru) {
+		gctempsurface = list_entry(head, struct gctempsurface,
+					   lrulink);
+
+		/* Still held by a batch. */
+		if (gctempsurface->refcount != 0)
+			continue;
+
+		if ((temppool->requests - gctempsurface->lastuse
+			<= temppool->maxage) &&
+		    (temppool->size + size <= temppool->budget))
+			break;
+
+		destroy_temp(gctempsurface);
+	}
+}
+
+/* Drops the holds on the list. */
+static void put_temp(struct list_head *list)
+{
+	struct gccontext *gccontext = get_context();
+	struct gctempref *gctempref;
+
+	GCLOCK(&gccontext->templock);
+
+	while (!list_empty(list)) {
+		gctempref = list_entry(list->next, struct gctempref, link);
+		gctempref->surface->refcount -= 1;
+		list_move(&gctempref->link, &gccontext->temppool.refvac);
+	}
+
+	GCUNLOCK(&gccontext->templock);
+}
+
+void callbacktemp(void *callbackinfo)
 {
 	struct gccallbackinfo *gccallbackinfo;
 
 	GCENTER(GCZONE_CALLBACK);
 
 	gccallbackinfo = (struct gccallbackinfo *) callbackinfo;
-	GCDBG(GCZONE_CALLBACK, "freeing descriptir @ 0x%08X\n",
-	      (unsigned int) gccallbackinfo->info.freesurface.desc);
-	GCDBG(GCZONE_CALLBACK, "freeing memory @ 0x%08X\n",
-	      (unsigned int) gccallbackinfo->info.freesurface.ptr);
-
-	free_surface(gccallbackinfo->info.freesurface.desc,
-		     gccallbackinfo->info.freesurface.ptr);
+	put_temp(&gccallbackinfo->info.temp);
 	free_callback(gccallbackinfo);
 
 	GCEXIT(GCZONE_CALLBACK);
 }
 
-
-/*******************************************************************************
- * Temporary buffer management.
- */
-
 enum bverror allocate_temp(struct bvbltparams *bvbltparams,
-			   unsigned int size)
+			   struct gcbatch *gcbatch,
+			   unsigned int size,
+			   struct bvbuffdesc **tmpbuffdesc)
 {
-	enum bverror bverror;
+	enum bverror bverror = BVERR_NONE;
 	struct gccontext *gccontext = get_context();
+	struct gctemppool *temppool = &gccontext->temppool;
+	struct gctempsurface *gctempsurface;
+	struct gctempref *gctempref;
+	struct list_head *head;
+	unsigned int bucket, length;
 
-	GCENTER(GCZONE_TEMP);
+	GCENTERARG(GCZONE_TEMP, "size = %d\n", size);
 
-	/* Existing buffer too small? */
-	if ((gccontext->tmpbuffdesc != NULL) &&
-	    (gccontext->tmpbuffdesc->length < size)) {
-		GCDBG(GCZONE_TEMP, "freeing current buffer.\n");
-		bverror = free_temp(true);
-		if (bverror != BVERR_NONE) {
-			bvbltparams->errdesc = gccontext->bverrorstr;
+	/* A surface the batch already holds will do. */
+	list_for_each(head, &gcbatch->temp) {
+		gctempref = list_entry(head, struct gctempref, link);
+		if (gctempref->surface->desc->length >= size) {
+			GCDBG(GCZONE_TEMP, "reusing batch surface.\n");
+			*tmpbuffdesc = gctempref->surface->desc;
 			goto exit;
 		}
 	}
 
-	/* Allocate new buffer if necessary. */
-	if ((size > 0) && (gccontext->tmpbuffdesc == NULL)) {
-		/* Allocate temporary surface. */
-		bverror = allocate_surface(&gccontext->tmpbuffdesc,
-					   &gccontext->tmpbuff,
-					   size);
-		if (bverror != BVERR_NONE) {
-			bvbltparams->errdesc = gccontext->bverrorstr;
-			goto exit;
-		}
+	bucket = get_temp_bucket(size);
+	length = max((unsigned int) (PAGE_SIZE << bucket), size);
 
-		GCDBG(GCZONE_TEMP, "buffdesc @ 0x%08X\n",
-		      gccontext->tmpbuffdesc);
-		GCDBG(GCZONE_TEMP, "allocated @ 0x%08X\n",
-		      gccontext->tmpbuff);
-		GCDBG(GCZONE_TEMP, "size = %d\n",
-		      size);
+	GCLOCK(&gccontext->templock);
 
-		/* Map the buffer explicitly. */
-		bverror = bv_map(gccontext->tmpbuffdesc);
-		if (bverror != BVERR_NONE) {
-			bvbltparams->errdesc = gccontext->bverrorstr;
-			goto exit;
+	temppool->requests += 1;
+
+	if (list_empty(&temppool->refvac)) {
+		gctempref = gcalloc(struct gctempref,
+				    sizeof(struct gctempref));
+		if (gctempref == NULL) {
+			BVSETBLTERROR(BVERR_OOM,
+				      "temporary surface allocation failed");
+			goto unlock;
+		}
+	} else {
+		gctempref = list_entry(temppool->refvac.next,
+				       struct gctempref, link);
+		list_del(&gctempref->link);
+	}
+
+	/* Any surface of the bucket will do, held or not. */
+	list_for_each(head, &temppool->bucket[bucket]) {
+		gctempsurface = list_entry(head, struct gctempsurface, link);
+		if (gctempsurface->desc->length >= size) {
+			GCDBG(GCZONE_TEMP, "reusing pool surface.\n");
+			goto found;
 		}
 	}
 
-	/* Success. */
-	bverror = BVERR_NONE;
+	/* Make room for a new one. */
+	trim_temp(length);
+
+	gctempsurface = gcalloc(struct gctempsurface,
+				sizeof(struct gctempsurface));
+	if (gctempsurface == NULL) {
+		BVSETBLTERROR(BVERR_OOM,
+			      "temporary surface allocation failed");
+		goto fail;
+	}
+
+	bverror = allocate_surface(&gctempsurface->desc,
+				   &gctempsurface->buffer,
+				   length);
+	if (bverror != BVERR_NONE) {
+		bvbltparams->errdesc = gccontext->bverrorstr;
+		gcfree(gctempsurface);
+		goto fail;
+	}
+
+	/* Map the surface explicitly, it stays mapped in the pool. */
+	bverror = bv_map(gctempsurface->desc);
+	if (bverror != BVERR_NONE) {
+		bvbltparams->errdesc = gccontext->bverrorstr;
+		free_surface(gctempsurface->desc, gctempsurface->buffer);
+		gcfree(gctempsurface);
+		goto fail;
+	}
+
+	GCDBG(GCZONE_TEMP, "allocated %d bytes @ 0x%08X\n",
+	      length, (unsigned int) gctempsurface->buffer);
+
+	gctempsurface->bucket = bucket;
+	gctempsurface->refcount = 0;
+	list_add(&gctempsurface->link, &temppool->bucket[bucket]);
+	INIT_LIST_HEAD(&gctempsurface->lrulink);
+	temppool->size += length;
+
+found:
+	gctempsurface->refcount += 1;
+	gctempsurface->lastuse = temppool->requests;
+	list_move_tail(&gctempsurface->lrulink, &temppool->lru);
+
+	gctempref->surface = gctempsurface;
+	list_add(&gctempref->link, &gcbatch->temp);
+
+	/* Let go of the surfaces left unused for too long. */
+	trim_temp(0);
+
+	*tmpbuffdesc = gctempsurface->desc;
+	goto unlock;
+
+fail:
+	list_add(&gctempref->link, &temppool->refvac);
+
+unlock:
+	GCUNLOCK(&gccontext->templock);
 
 exit:
-	GCEXIT(GCZONE_TEMP);
+	GCEXITARG(GCZONE_TEMP, "bv%s = %d\n",
+		  (bverror == BVERR_NONE) ? "result" : "error", bverror);
 	return bverror;
 }
 
-enum bverror free_temp(bool schedule)
+void release_temp(struct gcbatch *gcbatch)
+{
+	if (!list_empty(&gcbatch->temp))
+		put_temp(&gcbatch->temp);
+}
+
+enum bverror schedule_temp(struct bvbltparams *bvbltparams,
+			   struct gcbatch *gcbatch)
 {
 	enum bverror bverror;
-	struct gccontext *gccontext = get_context();
 	struct gccallbackinfo *gccallbackinfo;
 	struct gcicallbackarm gcicallbackarm;
 
-	/* Is the buffer allocated? */
-	if (gccontext->tmpbuffdesc == NULL) {
-		bverror = BVERR_NONE;
-		goto exit;
-	}
-
-	/* Unmap the buffer. */
-	bverror = bv_unmap(gccontext->tmpbuffdesc);
-	if (bverror != BVERR_NONE)
-		goto exit;
+	if (list_empty(&gcbatch->temp))
+		return BVERR_NONE;
 
-	/* Cannot be mapped. */
-	if (gccontext->tmpbuffdesc->map != NULL) {
-		BVSETERROR(BVERR_OOM, "temporary buffer is still mapped");
+	/* Holds never dropped keep the surfaces the GPU may still be
+	 * using from being freed. */
+	bverror = get_callbackinfo(&gccallbackinfo);
+	if (bverror != BVERR_NONE) {
+		INIT_LIST_HEAD(&gcbatch->temp);
+		BVSETBLTERROR(BVERR_OOM, "callback allocation failed");
 		goto exit;
 	}
 
-	/* Free the buffer. */
-	if (schedule) {
-		bverror = get_callbackinfo(&gccallbackinfo);
-		if (bverror != BVERR_NONE) {
-			BVSETERROR(BVERR_OOM,
-				   "callback allocation failed");
-			goto exit;
-		}
+	INIT_LIST_HEAD(&gccallbackinfo->info.temp);
+	list_splice_init(&gcbatch->temp, &gccallbackinfo->info.temp);
 
-		gccallbackinfo->info.freesurface.desc = gccontext->tmpbuffdesc;
-		gccallbackinfo->info.freesurface.ptr = gccontext->tmpbuff;
-		gcicallbackarm.callback = callbackfreesurface;
-		gcicallbackarm.callbackparam = gccallbackinfo;
+	gcicallbackarm.callback = callbacktemp;
+	gcicallbackarm.callbackparam = gccallbackinfo;
+	gc_callback_wrapper(&gcicallbackarm);
 
-		/* Schedule to free the buffer. */
-		gc_callback_wrapper(&gcicallbackarm);
+	if (gcicallbackarm.gcerror != GCERR_NONE)
+		BVSETBLTERROR(BVERR_OOM, "unable to schedule callback");
 
-		/* Error? */
-		if (gcicallbackarm.gcerror != GCERR_NONE) {
-			BVSETERROR(BVERR_OOM, "unable to schedule callback");
-			goto exit;
-		}
-	} else {
-		/* Free the buffer immediately. */
-		free_surface(gccontext->tmpbuffdesc, gccontext->tmpbuff);
+exit:
+	return bverror;
+}
+
+/* Frees the surfaces no batch holds. */
+void free_temppool(void)
+{
+	struct gccontext *gccontext = get_context();
+	struct gctemppool *temppool = &gccontext->temppool;
+	struct gctempsurface *gctempsurface;
+	struct gctempref *gctempref;
+	struct list_head *head, *temphead;
+
+	GCLOCK(&gccontext->templock);
+
+	list_for_each_safe(head, temphead, &temppool->lru) {
+		gctempsurface = list_entry(head, struct gctempsurface,
+					   lrulink);
+		if (gctempsurface->refcount == 0)
+			destroy_temp(gctempsurface);
 	}
 
-	/* Reset the buffer descriptor. */
-	gccontext->tmpbuffdesc = NULL;
-	gccontext->tmpbuff = NULL;
+	while (!list_empty(&temppool->refvac)) {
+		gctempref = list_entry(temppool->refvac.next,
+				       struct gctempref, link);
+		list_del(&gctempref->link);
+		gcfree(gctempref);
+	}
 
-exit:
-	return bverror;
+	GCUNLOCK(&gccontext->templock);
 }
 
 
@@ -1105,7 +1238,7 @@ void bv_init(void)
 {
 	struct gccontext *gccontext = get_context();
 	struct gcicaps gcicaps;
-	unsigned i, j;
+	unsigned i;
 
 	GCDBG_REGISTER(bv);
 	GCDBG_REGISTER(parser);
@@ -1120,18 +1253,44 @@ void bv_init(void)
 	GCLOCK_INIT(&gccontext->fixuplock);
 	GCLOCK_INIT(&gccontext->maplock);
 	GCLOCK_INIT(&gccontext->callbacklock);
+	GCLOCK_INIT(&gccontext->templock);
 
 	INIT_LIST_HEAD(&gccontext->unmapvac);
-	INIT_LIST_HEAD(&gccontext->buffervac);
-	INIT_LIST_HEAD(&gccontext->fixupvac);
-	INIT_LIST_HEAD(&gccontext->batchvac);
+	INIT_LIST_HEAD(&gccontext->buffervac.list);
+	INIT_LIST_HEAD(&gccontext->fixupvac.list);
+	INIT_LIST_HEAD(&gccontext->batchvac.list);
+	INIT_LIST_HEAD(&gccontext->magazines);
 	INIT_LIST_HEAD(&gccontext->callbacklist);
 	INIT_LIST_HEAD(&gccontext->callbackvac);
 
+	/* Magazines are released when their thread exits. */
+	gccontext->magazineenable
+		= (GCTHREAD_KEY_INIT(&gccontext->magazinekey,
+				     free_magazine) == 0);
+
+	/* Initialize the mapping cache. */
+	for (i = 0; i < GC_MAP_CACHE_HASH; i += 1)
+		INIT_LIST_HEAD(&gccontext->mapcache[i]);
+	INIT_LIST_HEAD(&gccontext->maplru);
+	gccontext->mapcachebudget = GC_MAP_CACHE_BUDGET;
+	gccontext->mapcachevirtual = false;
+
 	/* Initialize the filter cache. */
-	for (i = 0; i < GC_FILTER_COUNT; i += 1)
-		for (j = 0; j < GC_TAP_COUNT; j += 1)
-			INIT_LIST_HEAD(&gccontext->filtercache[i][j].list);
+	for (i = 0; i < GC_FILTER_CACHE_HASH; i += 1)
+		INIT_LIST_HEAD(&gccontext->filtercache.hash[i]);
+	INIT_LIST_HEAD(&gccontext->filtercache.lru);
+	gccontext->filtercache.max = GC_FILTER_CACHE_MAX;
+
+	/* Initialize the temporary surface pool. */
+	for (i = 0; i < GC_TEMP_BUCKETS; i += 1)
+		INIT_LIST_HEAD(&gccontext->temppool.bucket[i]);
+	INIT_LIST_HEAD(&gccontext->temppool.lru);
+	INIT_LIST_HEAD(&gccontext->temppool.refvac);
+	gccontext->temppool.budget = GC_TEMP_POOL_BUDGET;
+	gccontext->temppool.maxage = GC_TEMP_POOL_AGE;
+
+	/* Decode the known formats. */
+	init_parser();
 
 	/* Query hardware caps. */
 	gc_getcaps_wrapper(&gcicaps);
@@ -1159,6 +1318,11 @@ void bv_exit(void)
 	struct gcbatch *gcbatch;
 	struct gccallbackinfo *gccallbackinfo;
 
+	free_temppool();
+	free_mapcache();
+	free_filtercache();
+	free_magazines();
+
 	while (gccontext->buffmapvac != NULL) {
 		bvbuffmap = gccontext->buffmapvac;
 		gccontext->buffmapvac = bvbuffmap->nextmap;
@@ -1172,22 +1336,22 @@ void bv_exit(void)
 		gcfree(gcschedunmap);
 	}
 
-	while (!list_empty(&gccontext->buffervac)) {
-		head = gccontext->buffervac.next;
+	while (!list_empty(&gccontext->buffervac.list)) {
+		head = gccontext->buffervac.list.next;
 		gcbuffer = list_entry(head, struct gcbuffer, link);
 		list_del(head);
 		gcfree(gcbuffer);
 	}
 
-	while (!list_empty(&gccontext->fixupvac)) {
-		head = gccontext->fixupvac.next;
+	while (!list_empty(&gccontext->fixupvac.list)) {
+		head = gccontext->fixupvac.list.next;
 		gcfixup = list_entry(head, struct gcfixup, link);
 		list_del(head);
 		gcfree(gcfixup);
 	}
 
-	while (!list_empty(&gccontext->batchvac)) {
-		head = gccontext->batchvac.next;
+	while (!list_empty(&gccontext->batchvac.list)) {
+		head = gccontext->batchvac.list.next;
 		gcbatch = list_entry(head, struct gcbatch, link);
 		list_del(head);
 		gcfree(gcbatch);
@@ -1204,8 +1368,6 @@ void bv_exit(void)
 		list_del(head);
 		gcfree(gccallbackinfo);
 	}
-
-	free_temp(false);
 }
 
 
@@ -1247,7 +1409,6 @@ enum bverror bv_unmap(struct bvbuffdesc *bvbuffdesc)
 	struct bvbuffmap *prev = NULL;
 	struct bvbuffmap *bvbuffmap;
 	struct bvbuffmapinfo *bvbuffmapinfo;
-	struct gcimap gcimap;
 
 	GCENTERARG(GCZONE_MAPPING, "bvbuffdesc = 0x%08X\n",
 		   (unsigned int) bvbuffdesc);
@@ -1268,7 +1429,9 @@ enum bverror bv_unmap(struct bvbuffdesc *bvbuffdesc)
 	/* Is the buffer mapped? */
 	bvbuffmap = bvbuffdesc->map;
 	if (bvbuffmap == NULL) {
+		/* Drop the cached mapping, the buffer may be freed. */
 		GCDBG(GCZONE_MAPPING, "buffer isn't mapped.\n");
+		invalidate_mapping(bvbuffdesc);
 		goto exit;
 	}
 
@@ -1339,17 +1502,12 @@ enum bverror bv_unmap(struct bvbuffdesc *bvbuffdesc)
 	/* Do we have implicit mappings? */
 	if (bvbuffmapinfo->automap > 0) {
 		GCDBG(GCZONE_MAPPING, "have implicit unmappings.\n");
+		invalidate_mapping(bvbuffdesc);
 		goto exit;
 	}
 
 	/* Unmap the buffer. */
-	memset(&gcimap, 0, sizeof(gcimap));
-	gcimap.handle = bvbuffmapinfo->handle;
-	gc_unmap_wrapper(&gcimap);
-	if (gcimap.gcerror != GCERR_NONE) {
-		BVSETERROR(BVERR_OOM, "unable to free gccore memory");
-		goto exit;
-	}
+	release_mapping(bvbuffmapinfo);
 
 	/* Remove from the buffer descriptor list. */
 	if (prev == NULL)
@@ -1373,7 +1531,11 @@ exit:
 	return bverror;
 }
 
-enum bverror bv_blt(struct bvbltparams *bvbltparams)
+/* Fills take the destination rectangles from fillrects, when not NULL,
+ * instead of dstrect; other operations fail. */
+static enum bverror blt(struct bvbltparams *bvbltparams,
+			const struct bvrect *fillrects,
+			unsigned int fillcount)
 {
 	enum bverror bverror = BVERR_NONE;
 	struct gccontext *gccontext = get_context();
@@ -1393,6 +1555,7 @@ enum bverror bv_blt(struct bvbltparams *bvbltparams)
 
 	GCENTERARG(GCZONE_BLIT, "bvbltparams = 0x%08X\n",
 		   (unsigned int) bvbltparams);
+	GCPROF_PUSH(GCPROF_PARSE);
 
 	/* Verify blt parameters structure. */
 	if (bvbltparams == NULL) {
@@ -1408,6 +1571,11 @@ enum bverror bv_blt(struct bvbltparams *bvbltparams)
 	/* Reset the error message. */
 	bvbltparams->errdesc = NULL;
 
+	/* Small blits may cost less on the CPU than a commit. */
+	if ((fillrects == NULL) && (gccontext->cpublt != NULL) &&
+	    gccontext->cpublt(bvbltparams))
+		goto exit;
+
 	/* Verify the destination parameters structure. */
 	res = verify_surface(0, (union bvinbuff *) &bvbltparams->dstdesc,
 				bvbltparams->dstgeom);
@@ -1681,7 +1849,13 @@ enum bverror bv_blt(struct bvbltparams *bvbltparams)
 			BVSETBLTERROR(BVERR_OP,
 				      "operation not supported");
 			goto exit;
+		} else if ((fillrects != NULL) && (srccount != 1)) {
+			BVSETBLTERROR(BVERR_OP,
+				      "rectangle list needs a solid fill");
+			goto exit;
 		} else {
+			GCPROF_SWITCH(GCPROF_BUILD);
+
 			for (i = 0; i < srccount; i += 1) {
 				int srcw, srch;
 				GCDBG(GCZONE_BLIT,
@@ -1726,7 +1900,14 @@ enum bverror bv_blt(struct bvbltparams *bvbltparams)
 					GCDBG(GCZONE_BLIT, "  op: fill.\n");
 					bverror = do_fill(bvbltparams,
 							  gcbatch,
-							  &srcinfo[i]);
+							  &srcinfo[i],
+							  fillrects,
+							  fillcount);
+				} else if (fillrects != NULL) {
+					BVSETBLTERROR(BVERR_OP,
+						      "rectangle list needs "
+						      "a solid fill");
+					goto exit;
 				} else if ((srcw == (int)dstrect->width) &&
 					   (srch == (int)dstrect->height)) {
 					GCDBG(GCZONE_BLIT, "  op: bitblit.\n");
@@ -1750,6 +1931,7 @@ enum bverror bv_blt(struct bvbltparams *bvbltparams)
 		struct gcmoflush *flush;
 
 		GCDBG(GCZONE_BLIT, "preparing to submit the batch.\n");
+		GCPROF_SWITCH(GCPROF_BUILD);
 
 		/* Finalize the current operation. */
 		bverror = gcbatch->batchend(bvbltparams, gcbatch);
@@ -1836,7 +2018,9 @@ enum bverror bv_blt(struct bvbltparams *bvbltparams)
 		list_splice_init(&gcbatch->buffer, &gcicommit.buffer);
 
 		GCDBG(GCZONE_BLIT, "submitting the batch.\n");
+		GCPROF_PUSH(GCPROF_COMMIT);
 		gc_commit_wrapper(&gcicommit);
+		GCPROF_POP();
 
 		/* Move the lists back to the batch. */
 		list_splice_init(&gcicommit.buffer, &gcbatch->buffer);
@@ -1859,6 +2043,14 @@ enum bverror bv_blt(struct bvbltparams *bvbltparams)
 			}
 		}
 
+		/* Temporary surfaces go back to the pool once the GPU is
+		 * done; synchronous batches are done already. */
+		if (gcicommit.asynchronous) {
+			bverror = schedule_temp(bvbltparams, gcbatch);
+			if (bverror != BVERR_NONE)
+				goto exit;
+		}
+
 		GCDBG(GCZONE_BLIT, "batch is submitted.\n");
 	}
 
@@ -1868,6 +2060,72 @@ exit:
 		bvbltparams->batch = NULL;
 	}
 
+	GCPROF_POP();
+	GCEXITARG(GCZONE_BLIT, "bv%s = %d\n",
+		  (bverror == BVERR_NONE) ? "result" : "error", bverror);
+	return bverror;
+}
+
+enum bverror bv_blt(struct bvbltparams *bvbltparams)
+{
+	return blt(bvbltparams, NULL, 0);
+}
+
+enum bverror gcbvfill(struct bvbltparams *bvbltparams,
+		      unsigned int count,
+		      const struct bvrect *rects)
+{
+	enum bverror bverror;
+	struct bvbltparams params;
+	int left, top, right, bottom;
+	unsigned int i;
+
+	GCENTERARG(GCZONE_BLIT, "count = %d\n", count);
+
+	if (bvbltparams == NULL) {
+		BVSETERROR(BVERR_BLTPARAMS_VERS, "bvbltparams is NULL");
+		goto exit;
+	}
+
+	if (bvbltparams->structsize < STRUCTSIZE(bvbltparams, callbackdata)) {
+		BVSETERROR(BVERR_BLTPARAMS_VERS, "argument has invalid size");
+		goto exit;
+	}
+
+	if ((count == 0) || (rects == NULL)) {
+		BVSETBLTERROR(BVERR_DSTRECT, "no rectangles to fill");
+		goto exit;
+	}
+
+	/* The bounding rectangle stands for dstrect in the validation and
+	 * the clipping, then do_fill handles the list itself. */
+	left = rects[0].left;
+	top = rects[0].top;
+	right = rects[0].left + (int) rects[0].width;
+	bottom = rects[0].top + (int) rects[0].height;
+
+	for (i = 1; i < count; i += 1) {
+		left = min(left, rects[i].left);
+		top = min(top, rects[i].top);
+		right = max(right, rects[i].left + (int) rects[i].width);
+		bottom = max(bottom, rects[i].top + (int) rects[i].height);
+	}
+
+	params = *bvbltparams;
+	params.dstrect.left = left;
+	params.dstrect.top = top;
+	params.dstrect.width = right - left;
+	params.dstrect.height = bottom - top;
+	params.batchflags |= BVBATCH_DESTRECT;
+
+	bverror = blt(&params, rects, count);
+
+	bvbltparams->errdesc = params.errdesc;
+	bvbltparams->batch = params.batch;
+	if ((params.flags & BVFLAG_BATCH_MASK) == BVFLAG_BATCH_BEGIN)
+		bvbltparams->batchflags = params.batchflags;
+
+exit:
 	GCEXITARG(GCZONE_BLIT, "bv%s = %d\n",
 		  (bverror == BVERR_NONE) ? "result" : "error", bverror);
 	return bverror;
@@ -1882,12 +2140,17 @@ enum bverror bv_cache(struct bvcopparams *copparams)
 
 	struct c2dmrgn rgn[3];
 	int container_size = 0;
+	int count;
 
 	unsigned long subsample;
 	unsigned long vendor;
 	unsigned long layout;
 	unsigned long size;
 	unsigned long container;
+	unsigned int ysample;
+	unsigned int top, bottom, left, right;
+	long stride2;
+	char *plane2;
 
 	subsample = copparams->geom->format & OCDFMTDEF_SUBSAMPLE_MASK;
 	vendor = copparams->geom->format & OCDFMTDEF_VENDOR_MASK;
@@ -1900,6 +2163,11 @@ enum bverror bv_cache(struct bvcopparams *copparams)
 		goto exit;
 	}
 
+	/* Buffers the CPU does not access through a mapping of its own
+	 * have nothing to maintain. */
+	if (copparams->desc->virtaddr == NULL)
+		goto exit;
+
 	if (copparams->geom->orientation % 180 != 0) {
 		true_width = copparams->rect->height;
 		true_height = copparams->rect->width;
@@ -1934,6 +2202,11 @@ enum bverror bv_cache(struct bvcopparams *copparams)
 		break;
 	}
 
+	/* Chroma lines covered by the rectangle in planar formats. */
+	ysample = (subsample == OCDFMTDEF_SUBSAMPLE_420_YCbCr) ? 2 : 1;
+	top = copparams->rect->top / ysample;
+	bottom = (copparams->rect->top + true_height + ysample - 1) / ysample;
+
 	switch (layout) {
 	case OCDFMTDEF_PACKED:
 		switch (subsample) {
@@ -1967,7 +2240,7 @@ enum bverror bv_cache(struct bvcopparams *copparams)
 				vert_offset * rgn[0].stride +
 				horiz_offset);
 
-		gcbvcacheop(1, rgn, copparams->cacheop);
+		count = 1;
 		break;
 
 	case OCDFMTDEF_2_PLANE_YCbCr:
@@ -1980,26 +2253,68 @@ enum bverror bv_cache(struct bvcopparams *copparams)
 			 copparams->rect->top * rgn[0].stride +
 			 copparams->rect->left);
 
-		rgn[1].span = true_width;
-		rgn[1].lines = true_height / 2;
-		rgn[1].stride = copparams->geom->virtstride;
-		rgn[1].start = rgn[0].start +
-			copparams->geom->height * rgn[0].stride;
+		/* Interleaved U and V below, one byte pair per two pixels. */
+		left = copparams->rect->left & ~1;
+		right = (copparams->rect->left + true_width + 1) & ~1;
+		plane2 = (char *) copparams->desc->virtaddr
+		       + copparams->geom->height * rgn[0].stride;
+
+		rgn[1].span = right - left;
+		rgn[1].lines = bottom - top;
+		rgn[1].stride = rgn[0].stride;
+		rgn[1].start = plane2 + top * rgn[1].stride + left;
 
 		GCDBG(GCZONE_CACHE,
 		      "virtaddr %p start[0] 0x%08x start[1] 0x%08x\n",
 		      copparams->desc->virtaddr, rgn[0].start, rgn[1].start);
 
-		gcbvcacheop(2, rgn, copparams->cacheop);
+		count = 2;
+		break;
+
+	case OCDFMTDEF_3_PLANE_STACKED:
+		/* 1 byte per pixel */
+		rgn[0].span = true_width;
+		rgn[0].lines = true_height;
+		rgn[0].stride = copparams->geom->virtstride;
+		rgn[0].start = (void *)
+			((unsigned long) copparams->desc->virtaddr +
+			 copparams->rect->top * rgn[0].stride +
+			 copparams->rect->left);
+
+		/* U and V planes below, half the stride each. */
+		left = copparams->rect->left / 2;
+		right = (copparams->rect->left + true_width + 1) / 2;
+		stride2 = rgn[0].stride / 2;
+		plane2 = (char *) copparams->desc->virtaddr
+		       + copparams->geom->height * rgn[0].stride;
+
+		rgn[1].span = right - left;
+		rgn[1].lines = bottom - top;
+		rgn[1].stride = stride2;
+		rgn[1].start = plane2 + top * stride2 + left;
+
+		rgn[2] = rgn[1];
+		rgn[2].start += stride2
+			      * (copparams->geom->height / ysample);
+
+		GCDBG(GCZONE_CACHE,
+		      "virtaddr %p start[0] 0x%08x start[1] 0x%08x "
+		      "start[2] 0x%08x\n",
+		      copparams->desc->virtaddr, rgn[0].start, rgn[1].start,
+		      rgn[2].start);
+
+		count = 3;
 		break;
 
 	default:
 		GCERR("format 0x%x (%d) not supported.\n",
 		      copparams->geom->format, copparams->geom->format);
 		bverror = BVERR_FORMAT;
-		break;
+		goto exit;
 	}
 
+	bverror = gcbvcacheop(count, rgn, copparams->cacheop, true);
+
 exit:
 	if (bverror != BVERR_NONE)
 		GCERR("bverror = %d\n", bverror);
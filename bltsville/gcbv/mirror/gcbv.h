@@ -111,7 +111,8 @@ do { \
 #define GC_PHASE_MAX_COUNT	(1 << GC_PHASE_BITS)
 #define GC_PHASE_LOAD_COUNT	(GC_PHASE_MAX_COUNT / 2 + 1)
 #define GC_COEFFICIENT_COUNT	(GC_PHASE_LOAD_COUNT * GC_TAP_COUNT)
-#define GC_FILTER_CACHE_MAX	10
+#define GC_FILTER_CACHE_MAX	32
+#define GC_FILTER_CACHE_HASH	16
 
 enum gcfiltertype {
 	GC_FILTER_SYNC,
@@ -121,19 +122,120 @@ enum gcfiltertype {
 	GC_FILTER_COUNT
 };
 
+/* Kernels are keyed by the 1.31 fixed point scale they are computed for,
+ * which is the only input to the coefficients besides the kernel size. */
 struct gcfilterkernel {
 	enum gcfiltertype type;
 	unsigned int kernelsize;
-	unsigned int srcsize;
-	unsigned int dstsize;
-	unsigned int scalefactor;
+	unsigned int scale;
+	short kernelarray[GC_COEFFICIENT_COUNT];
+	struct list_head link;			/* hash bucket */
+	struct list_head lrulink;
+};
+
+/* Build-time computed kernels for common ratios, see gcfilterpreset.h. */
+struct gcfilterpreset {
+	unsigned int kernelsize;
+	unsigned int scale;
 	short kernelarray[GC_COEFFICIENT_COUNT];
-	struct list_head link;
 };
 
 struct gcfiltercache {
 	unsigned int count;
-	struct list_head list;			/* gcfilterkernel */
+	unsigned int max;
+	struct list_head hash[GC_FILTER_CACHE_HASH];	/* gcfilterkernel */
+	struct list_head lru;			/* gcfilterkernel */
+};
+
+
+/*******************************************************************************
+ * Mapping cache definitions.
+ */
+
+/* Default size of the idle mappings kept in the mapping cache. */
+#define GC_MAP_CACHE_BUDGET	(32 * 1024 * 1024)
+#define GC_MAP_CACHE_HASH	64
+
+
+/*******************************************************************************
+ * Temporary surface pool definitions.
+ *
+ * Multi-pass operations take their intermediate surfaces from a pool of
+ * mapped surfaces sized in powers of two pages, GC_TEMP_BUCKETS sizes from
+ * one page up; the last bucket takes whatever is larger. The GPU runs the
+ * batches in order, so any batch may use a surface another one still has
+ * queued, but a surface is only freed once no batch holds it. Unused
+ * surfaces go once the pool passes budget bytes or after maxage requests.
+ */
+
+#define GC_TEMP_BUCKETS		16
+#define GC_TEMP_POOL_BUDGET	(16 * 1024 * 1024)
+#define GC_TEMP_POOL_AGE	256
+
+struct gctempsurface {
+	struct bvbuffdesc *desc;
+	void *buffer;
+	unsigned int bucket;
+
+	/* Number of batches holding the surface, being built or running. */
+	int refcount;
+
+	/* Pool request count when the surface was last handed out. */
+	unsigned int lastuse;
+
+	/* Bucket list (gctempsurface). */
+	struct list_head link;
+
+	/* LRU list (gctempsurface). */
+	struct list_head lrulink;
+};
+
+/* Hold of a batch on a temporary surface. */
+struct gctempref {
+	struct gctempsurface *surface;
+	struct list_head link;
+};
+
+struct gctemppool {
+	/* Bytes allocated. */
+	unsigned int size;
+	unsigned int budget;
+	unsigned int maxage;
+	unsigned int requests;
+	struct list_head bucket[GC_TEMP_BUCKETS];	/* gctempsurface */
+	struct list_head lru;			/* gctempsurface */
+	struct list_head refvac;		/* gctempref */
+};
+
+
+/*******************************************************************************
+ * Vacant object caches.
+ *
+ * Each thread calling bv_blt keeps a magazine of vacant batches, command
+ * buffers and fixups it allocates from and frees to without locking. Empty
+ * magazines are refilled from the shared vacant lists and full ones drained
+ * to them half a magazine at a time; objects beyond the shared list limits
+ * are released.
+ */
+
+#define GC_MAGAZINE_BATCH_MAX	4
+#define GC_MAGAZINE_BUFFER_MAX	8
+#define GC_MAGAZINE_FIXUP_MAX	16
+
+#define GC_VACANT_BATCH_MAX	16
+#define GC_VACANT_BUFFER_MAX	32
+#define GC_VACANT_FIXUP_MAX	64
+
+struct gcvacant {
+	struct list_head list;
+	unsigned int count;
+};
+
+struct gcmagazine {
+	struct gcvacant batchvac;		/* gcbatch */
+	struct gcvacant buffervac;		/* gcbuffer */
+	struct gcvacant fixupvac;		/* gcfixup */
+	struct list_head link;
 };
 
 
@@ -159,9 +261,14 @@ struct gccontext {
 	/* Dynamically allocated structure cache. */
 	struct bvbuffmap *buffmapvac;		/* bvbuffmap */
 	struct list_head unmapvac;		/* gcschedunmap */
-	struct list_head buffervac;		/* gcbuffer */
-	struct list_head fixupvac;		/* gcfixup */
-	struct list_head batchvac;		/* gcbatch */
+	struct gcvacant buffervac;		/* gcbuffer */
+	struct gcvacant fixupvac;		/* gcfixup */
+	struct gcvacant batchvac;		/* gcbatch */
+
+	/* Per-thread magazines in front of the vacant lists above. */
+	GCTHREAD_KEY_TYPE magazinekey;
+	bool magazineenable;
+	struct list_head magazines;		/* gcmagazine */
 
 	/* Callback lists. */
 	struct list_head callbacklist;		/* gccallbackinfo */
@@ -173,14 +280,27 @@ struct gccontext {
 	GCLOCK_TYPE fixuplock;
 	GCLOCK_TYPE maplock;
 	GCLOCK_TYPE callbacklock;
-
-	/* Kernel table cache. */
-	struct gcfilterkernel *loadedfilter;	/* gcfilterkernel */
-	struct gcfiltercache filtercache[GC_FILTER_COUNT][GC_TAP_COUNT];
-
-	/* Temporary buffer descriptor. */
-	struct bvbuffdesc *tmpbuffdesc;
-	void *tmpbuff;
+	GCLOCK_TYPE templock;
+
+	/* Mapping cache; idle entries are kept on the LRU list until they
+	 * take more than mapcachebudget bytes. Virtual buffers are cached
+	 * only if mapcachevirtual is set. */
+	struct list_head mapcache[GC_MAP_CACHE_HASH];	/* gcmapentry */
+	struct list_head maplru;		/* gcmapentry */
+	unsigned int mapcachebudget;
+	unsigned int mapcachesize;
+	bool mapcachevirtual;
+
+	/* Kernel table cache; runtime computed kernels not found in the
+	 * preset table, at most filtercache.max of them. */
+	struct gcfiltercache filtercache;
+
+	/* Temporary surface pool. */
+	struct gctemppool temppool;
+
+	/* Optional CPU blitter offered every bv_blt first; returns true if
+	 * it did the blit. */
+	bool (*cpublt) (struct bvbltparams *bvbltparams);
 };
 
 
@@ -188,11 +308,36 @@ struct gccontext {
  * Mapping structures.
  */
 
+/* GC MMU mapping shared by all bvbuffmap records of the same buffer. The
+ * buffer is identified by the gcimap used to map it; the page array, if
+ * any, is copied after the structure. */
+struct gcmapentry {
+	struct gcimap gcimap;
+	unsigned int pagecount;
+
+	/* Number of bvbuffmap records using the mapping. */
+	int refcount;
+
+	/* Set once the buffer may be gone, or from the start for buffers
+	 * left out of the cache; the mapping is no longer found and is
+	 * unmapped as soon as it becomes idle. */
+	bool stale;
+
+	/* Hash bucket list (gcmapentry). */
+	struct list_head link;
+
+	/* LRU list of idle mappings (gcmapentry). */
+	struct list_head lrulink;
+};
+
 /* bvbuffmap struct attachment. */
 struct bvbuffmapinfo {
 	/* Mapped handle for the buffer. */
 	unsigned long handle;
 
+	/* Mapping cache entry the handle belongs to. */
+	struct gcmapentry *entry;
+
 	/* Number of times the client explicitly mapped this buffer. */
 	int usermap;
 
@@ -466,6 +611,12 @@ struct gcbatch {
 	int dstoffsetX;
 	int dstoffsetY;
 
+	/* Last fill colour converted in the batch, for the source pixel
+	 * value and channel layout it was converted from. */
+	const struct bvcsrgb *fillcomp;
+	unsigned int fillpixel;
+	unsigned int fillcolor;
+
 #if GCDEBUG_ENABLE
 	/* Rectangle validation storage. */
 	struct bvrect prevdstrect;
@@ -483,6 +634,9 @@ struct gcbatch {
 	/* Scheduled implicit unmappings (gcschedunmap). */
 	struct list_head unmap;
 
+	/* Temporary surfaces held (gctempref). */
+	struct list_head temp;
+
 	/* Batch linked list (gcbatch). */
 	struct list_head link;
 };
@@ -499,6 +653,7 @@ struct gccontext *get_context(void);
 bool valid_rect(struct bvsurfgeom *bvsurfgeom, struct gcrect *gcrect);
 
 /* Parsers. */
+void init_parser(void);
 enum bverror parse_format(struct bvbltparams *bvbltparams,
 			  struct surfaceinfo *surfaceinfo);
 enum bverror parse_blend(struct bvbltparams *bvbltparams,
@@ -525,8 +680,16 @@ enum bverror do_map(struct bvbuffdesc *bvbuffdesc,
 		    struct gcbatch *gcbatch,
 		    struct bvbuffmap **map);
 void do_unmap_implicit(struct gcbatch *gcbatch);
+void release_mapping(struct bvbuffmapinfo *bvbuffmapinfo);
+void invalidate_mapping(struct bvbuffdesc *bvbuffdesc);
+void free_mapcache(void);
+
+/* Filter kernel cache. */
+void free_filtercache(void);
 
 /* Batch/command buffer management. */
+void free_magazine(void *gcmagazine);
+void free_magazines(void);
 enum bverror do_end(struct bvbltparams *bvbltparams,
 		    struct gcbatch *gcbatch);
 enum bverror allocate_batch(struct bvbltparams *bvbltparams,
@@ -545,10 +708,16 @@ enum bverror claim_buffer(struct bvbltparams *bvbltparams,
 			  unsigned int size,
 			  void **buffer);
 
-/* Temporary buffer management. */
+/* Temporary surface pool; surfaces are held by the batch until
+ * release_temp returns them, or schedule_temp once the GPU is done. */
 enum bverror allocate_temp(struct bvbltparams *bvbltparams,
-			   unsigned int size);
-enum bverror free_temp(bool schedule);
+			   struct gcbatch *gcbatch,
+			   unsigned int size,
+			   struct bvbuffdesc **tmpbuffdesc);
+void release_temp(struct gcbatch *gcbatch);
+enum bverror schedule_temp(struct bvbltparams *bvbltparams,
+			   struct gcbatch *gcbatch);
+void free_temppool(void);
 
 /* Program the destination. */
 enum bverror set_dst(struct bvbltparams *bltparams,
@@ -576,10 +745,16 @@ enum bverror set_yuvsrc_index(struct bvbltparams *bvbltparams,
 			      struct bvbuffmap *srcmap,
 			      unsigned int index);
 
+/* Convert a pixel to the A8R8G8B8 fill color. */
+unsigned int getinternalcolor(unsigned int srcpixel,
+			      struct bvformatxlate *format);
+
 /* Rendering entry points. */
 enum bverror do_fill(struct bvbltparams *bltparams,
 		     struct gcbatch *gcbatch,
-		     struct surfaceinfo *srcinfo);
+		     struct surfaceinfo *srcinfo,
+		     const struct bvrect *rects,
+		     unsigned int rectcount);
 enum bverror do_blit(struct bvbltparams *bltparams,
 		     struct gcbatch *gcbatch,
 		     struct surfaceinfo *srcinfo);
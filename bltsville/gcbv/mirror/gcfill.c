@@ -41,6 +41,9 @@ GCDBG_FILTERDEF(fill, GCZONE_NONE,
 		"color",
 		"fill")
 
+/* Rectangles a START_DE command takes at most. */
+#define GC_FILL_RECT_MAX	255U
+
 
 static inline unsigned int extract_component(unsigned int pixel,
 					     const struct bvcomponent *desc)
@@ -86,12 +89,38 @@ static inline unsigned int extract_component(unsigned int pixel,
 	return component8;
 }
 
-static unsigned int getinternalcolor(void *ptr, struct bvformatxlate *format)
+unsigned int getinternalcolor(unsigned int srcpixel,
+			      struct bvformatxlate *format)
 {
-	unsigned int srcpixel, dstpixel;
+	unsigned int dstpixel;
 	unsigned int r, g, b, a;
 
-	switch (format->bitspp) {
+	r = extract_component(srcpixel, &format->cs.rgb.comp->r);
+	g = extract_component(srcpixel, &format->cs.rgb.comp->g);
+	b = extract_component(srcpixel, &format->cs.rgb.comp->b);
+	a = extract_component(srcpixel, &format->cs.rgb.comp->a);
+
+	GCDBG(GCZONE_COLOR, "(r,g,b,a)=0x%02X,0x%02X,0x%02X,0x%02X\n",
+	      r, g, b, a);
+
+	dstpixel = (a << 24) | (r << 16) | (g <<  8) | b;
+
+	GCDBG(GCZONE_COLOR, "dstpixel=0x%08X\n", dstpixel);
+
+	return dstpixel;
+}
+
+static unsigned int getfillcolor(struct gcbatch *batch,
+				 struct surfaceinfo *srcinfo)
+{
+	unsigned char *ptr;
+	unsigned int srcpixel;
+
+	ptr = (unsigned char *) srcinfo->buf.desc->virtaddr
+	    + srcinfo->rect.top * srcinfo->geom->virtstride
+	    + srcinfo->rect.left * srcinfo->format.bitspp / 8;
+
+	switch (srcinfo->format.bitspp) {
 	case 16:
 		srcpixel = *(unsigned short *) ptr;
 		GCDBG(GCZONE_COLOR, "srcpixel=0x%08X\n", srcpixel);
@@ -107,31 +136,92 @@ static unsigned int getinternalcolor(void *ptr, struct bvformatxlate *format)
 		GCDBG(GCZONE_COLOR, "srcpixel=0x%08X\n", srcpixel);
 	}
 
-	r = extract_component(srcpixel, &format->cs.rgb.comp->r);
-	g = extract_component(srcpixel, &format->cs.rgb.comp->g);
-	b = extract_component(srcpixel, &format->cs.rgb.comp->b);
-	a = extract_component(srcpixel, &format->cs.rgb.comp->a);
+	/* Same colour as the previous fill of the batch? The component
+	 * tables are static, so they identify the channel layout. */
+	if ((batch->fillcomp != srcinfo->format.cs.rgb.comp) ||
+	    (batch->fillpixel != srcpixel)) {
+		batch->fillcomp = srcinfo->format.cs.rgb.comp;
+		batch->fillpixel = srcpixel;
+		batch->fillcolor = getinternalcolor(srcpixel,
+						    &srcinfo->format);
+	}
 
-	GCDBG(GCZONE_COLOR, "(r,g,b,a)=0x%02X,0x%02X,0x%02X,0x%02X\n",
-	      r, g, b, a);
+	return batch->fillcolor;
+}
 
-	dstpixel = (a << 24) | (r << 16) | (g <<  8) | b;
+/* Clips the rectangle and moves it to the adjusted destination origin, the
+ * way parse_destination and process_dest_rotation do for dstrect. Returns
+ * false if nothing is left of it. */
+static bool get_fillrect(struct bvbltparams *bvbltparams,
+			 struct gcbatch *batch,
+			 const struct bvrect *rect,
+			 struct gccmdstartderect *fillrect)
+{
+	struct bvrect *cliprect;
+	int left, top, right, bottom;
 
-	GCDBG(GCZONE_COLOR, "dstpixel=0x%08X\n", dstpixel);
+	left = rect->left;
+	top = rect->top;
+	right = rect->left + (int) rect->width;
+	bottom = rect->top + (int) rect->height;
 
-	return dstpixel;
+	if ((bvbltparams->flags & BVFLAG_CLIP) == BVFLAG_CLIP) {
+		cliprect = &bvbltparams->cliprect;
+
+		left = max(left, cliprect->left);
+		top = max(top, cliprect->top);
+		right = min(right, cliprect->left + (int) cliprect->width);
+		bottom = min(bottom, cliprect->top + (int) cliprect->height);
+	}
+
+	if ((left >= right) || (top >= bottom))
+		return false;
+
+	fillrect->left = left - batch->dstclipped.left
+		       + batch->dstadjusted.left;
+	fillrect->top = top - batch->dstclipped.top
+		      + batch->dstadjusted.top;
+	fillrect->right = right - batch->dstclipped.left
+			+ batch->dstadjusted.left;
+	fillrect->bottom = bottom - batch->dstclipped.top
+			 + batch->dstadjusted.top;
+
+	return true;
+}
+
+/* Fills count START_DE rectangles from the list, starting at *index. */
+static void put_fillrects(struct bvbltparams *bvbltparams,
+			  struct gcbatch *batch,
+			  const struct bvrect *rects,
+			  unsigned int *index,
+			  struct gccmdstartderect *fillrect,
+			  unsigned int count)
+{
+	while (count > 0) {
+		if (get_fillrect(bvbltparams, batch, &rects[*index],
+				 fillrect)) {
+			fillrect += 1;
+			count -= 1;
+		}
+
+		*index += 1;
+	}
 }
 
 enum bverror do_fill(struct bvbltparams *bvbltparams,
 		     struct gcbatch *batch,
-		     struct surfaceinfo *srcinfo)
+		     struct surfaceinfo *srcinfo,
+		     const struct bvrect *rects,
+		     unsigned int rectcount)
 {
 	enum bverror bverror;
 	struct gccontext *gccontext = get_context();
 	struct surfaceinfo *dstinfo;
 	struct gcmofill *gcmofill;
-	unsigned char *fillcolorptr;
+	struct gccmdstartde *startde;
+	struct gccmdstartderect fillrect;
 	struct bvbuffmap *dstmap = NULL;
+	unsigned int fillcount, count, index, i;
 
 	GCENTER(GCZONE_FILL);
 
@@ -181,12 +271,33 @@ enum bverror do_fill(struct bvbltparams *bvbltparams,
 			       BVBATCH_CLIPRECT |
 			       BVBATCH_DESTRECT);
 
+	/* Count what is left of the rectangle list after clipping. */
+	if (rects == NULL) {
+		fillcount = 1;
+	} else {
+		fillcount = 0;
+		for (i = 0; i < rectcount; i += 1)
+			if (get_fillrect(bvbltparams, batch, &rects[i],
+					 &fillrect))
+				fillcount += 1;
+
+		GCDBG(GCZONE_FILL, "%d of %d rectangles to fill.\n",
+		      fillcount, rectcount);
+
+		if (fillcount == 0)
+			goto exit;
+	}
+
 	/***********************************************************************
 	** Allocate command buffer.
 	*/
 
+	/* The first START_DE comes with the state. */
+	count = min(fillcount, GC_FILL_RECT_MAX);
+
 	bverror = claim_buffer(bvbltparams, batch,
-			       sizeof(struct gcmofill),
+			       sizeof(struct gcmofill) +
+			       (count - 1) * sizeof(struct gccmdstartderect),
 			       (void **) &gcmofill);
 	if (bverror != BVERR_NONE)
 		goto exit;
@@ -216,14 +327,8 @@ enum bverror do_fill(struct bvbltparams *bvbltparams,
 	** Set fill color.
 	*/
 
-	fillcolorptr
-		= (unsigned char *) srcinfo->buf.desc->virtaddr
-		+ srcinfo->rect.top * srcinfo->geom->virtstride
-		+ srcinfo->rect.left * srcinfo->format.bitspp / 8;
-
 	gcmofill->clearcolor_ldst = gcmofill_clearcolor_ldst;
-	gcmofill->clearcolor.raw = getinternalcolor(fillcolorptr,
-						    &srcinfo->format);
+	gcmofill->clearcolor.raw = getfillcolor(batch, srcinfo);
 
 	/***********************************************************************
 	** Configure and start fill.
@@ -246,10 +351,40 @@ enum bverror do_fill(struct bvbltparams *bvbltparams,
 	gcmofill->startde.cmd.fld = gcfldstartde;
 
 	/* Set destination rectangle. */
-	gcmofill->rect.left = batch->dstadjusted.left;
-	gcmofill->rect.top = batch->dstadjusted.top;
-	gcmofill->rect.right = batch->dstadjusted.right;
-	gcmofill->rect.bottom = batch->dstadjusted.bottom;
+	if (rects == NULL) {
+		gcmofill->rect.left = batch->dstadjusted.left;
+		gcmofill->rect.top = batch->dstadjusted.top;
+		gcmofill->rect.right = batch->dstadjusted.right;
+		gcmofill->rect.bottom = batch->dstadjusted.bottom;
+		goto exit;
+	}
+
+	gcmofill->startde.cmd.fld.rectcount = count;
+
+	index = 0;
+	put_fillrects(bvbltparams, batch, rects, &index,
+		      &gcmofill->rect, count);
+	fillcount -= count;
+
+	/* The rest of the list goes to START_DE commands of their own. */
+	while (fillcount > 0) {
+		count = min(fillcount, GC_FILL_RECT_MAX);
+
+		bverror = claim_buffer(bvbltparams, batch,
+				       sizeof(struct gccmdstartde) +
+				       count * sizeof(struct gccmdstartderect),
+				       (void **) &startde);
+		if (bverror != BVERR_NONE)
+			goto exit;
+
+		startde->cmd.fld = gcfldstartde;
+		startde->cmd.fld.rectcount = count;
+
+		put_fillrects(bvbltparams, batch, rects, &index,
+			      (struct gccmdstartderect *) (startde + 1),
+			      count);
+		fillcount -= count;
+	}
 
 exit:
 	GCEXITARG(GCZONE_FILL, "bv%s = %d\n",
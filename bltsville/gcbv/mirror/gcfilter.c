@@ -31,6 +31,7 @@
  */
 
 #include "gcbv.h"
+#include "gcfilterpreset.h"
 
 #define GCZONE_NONE		0
 #define GCZONE_ALL		(~0U)
@@ -337,9 +338,10 @@ static GC_COORD_TYPE sinc_filter(GC_COORD_TYPE x, int radius)
  * Filter kernel generator based on SINC function.
  */
 
-static void calculate_sync_filter(struct gcfilterkernel *gcfilterkernel)
+static void calculate_sync_filter(unsigned int kernelsize,
+				  GC_SCALE_TYPE scale,
+				  short *kernelarray)
 {
-	GC_SCALE_TYPE scale;
 	GC_COORD_TYPE subpixset[GC_TAP_COUNT];
 	GC_COORD_TYPE subpixeloffset;
 	GC_COORD_TYPE x, weight;
@@ -347,26 +349,17 @@ static void calculate_sync_filter(struct gcfilterkernel *gcfilterkernel)
 	short convweightsum;
 	int kernelhalf, padding;
 	int subpixpos, kernelpos;
-	short *kernelarray;
 	short count, adjustfrom, adjustment;
 	int index;
 
-	/* Compute the scale factor. */
-	scale = (gcfilterkernel->dstsize >= gcfilterkernel->srcsize)
-	      ? GC_SCALE_ONE
-	      : computescale(gcfilterkernel->dstsize, gcfilterkernel->srcsize);
-
 	/* Calculate the kernel half. */
-	kernelhalf = (int) (gcfilterkernel->kernelsize >> 1);
+	kernelhalf = (int) (kernelsize >> 1);
 
 	/* Init the subpixel offset. */
 	subpixeloffset = GC_COORD_HALF;
 
 	/* Determine kernel padding size. */
-	padding = (GC_TAP_COUNT - gcfilterkernel->kernelsize) / 2;
-
-	/* Set initial kernel array pointer. */
-	kernelarray = gcfilterkernel->kernelarray;
+	padding = (GC_TAP_COUNT - kernelsize) / 2;
 
 	/* Loop through each subpixel. */
 	for (subpixpos = 0; subpixpos < GC_PHASE_LOAD_COUNT; subpixpos += 1) {
@@ -383,13 +376,13 @@ static void calculate_sync_filter(struct gcfilterkernel *gcfilterkernel)
 			}
 
 			/* Pad with zeros right side. */
-			if (index >= (int) gcfilterkernel->kernelsize) {
+			if (index >= (int) kernelsize) {
 				subpixset[kernelpos] = GC_COORD_ZERO;
 				continue;
 			}
 
 			/* "Filter off" case. */
-			if (gcfilterkernel->kernelsize == 1) {
+			if (kernelsize == 1) {
 				subpixset[kernelpos] = GC_COORD_ONE;
 
 				/* Update the sum of the weights. */
@@ -460,105 +453,213 @@ static void calculate_sync_filter(struct gcfilterkernel *gcfilterkernel)
 
 
 /*******************************************************************************
- * Loads a filter into the GPU.
+ * Filter kernel store.
+ *
+ * Kernels come from the preset table generated at build time for the common
+ * ratios first, then from the cache of kernels computed at run time, and are
+ * only computed when found in neither. All three produce the same
+ * coefficients for a given kernel size and scale.
  */
 
-static enum bverror load_filter(struct bvbltparams *bvbltparams,
-				struct gcbatch *batch,
-				enum gcfiltertype type,
-				unsigned int kernelsize,
-				unsigned int scalefactor,
-				unsigned int srcsize,
-				unsigned int dstsize,
-				struct gccmdldstate arraystate)
+static GC_SCALE_TYPE get_filter_scale(unsigned int kernelsize,
+				      unsigned int srcsize,
+				      unsigned int dstsize)
+{
+	/* The "filter off" kernel does not depend on the scale. */
+	if ((kernelsize == 1) || (dstsize >= srcsize))
+		return GC_SCALE_ONE;
+
+	return computescale(dstsize, srcsize);
+}
+
+static const struct gcfilterpreset *find_preset(unsigned int kernelsize,
+						GC_SCALE_TYPE scale)
+{
+	const struct gcfilterpreset *preset;
+	int low, high, middle;
+
+	/* The table is sorted by kernel size, then by scale. */
+	low = 0;
+	high = countof(gcfilterpresets) - 1;
+
+	while (low <= high) {
+		middle = (low + high) / 2;
+		preset = &gcfilterpresets[middle];
+
+		if ((preset->kernelsize < kernelsize) ||
+		    ((preset->kernelsize == kernelsize) &&
+		     (preset->scale < scale)))
+			low = middle + 1;
+		else if ((preset->kernelsize > kernelsize) ||
+			 (preset->scale > scale))
+			high = middle - 1;
+		else
+			return preset;
+	}
+
+	return NULL;
+}
+
+static unsigned int get_filterhash(enum gcfiltertype type,
+				   unsigned int kernelsize,
+				   GC_SCALE_TYPE scale)
+{
+	unsigned int hash;
+
+	hash = scale ^ (kernelsize << 24) ^ (type << 28);
+	hash ^= hash >> 16;
+	hash ^= hash >> 8;
+
+	return hash % GC_FILTER_CACHE_HASH;
+}
+
+static struct gcfilterkernel *find_kernel(enum gcfiltertype type,
+					  unsigned int kernelsize,
+					  GC_SCALE_TYPE scale,
+					  unsigned int hash)
 {
-	enum bverror bverror = BVERR_NONE;
 	struct gccontext *gccontext = get_context();
-	struct gcfiltercache *filtercache;
-	struct list_head *filterlist;
-	struct list_head *filterhead;
+	struct list_head *head;
 	struct gcfilterkernel *gcfilterkernel;
-	struct gcmofilterkernel *gcmofilterkernel;
 
-	GCDBG(GCZONE_KERNEL, "kernelsize = %d\n", kernelsize);
-	GCDBG(GCZONE_KERNEL, "srcsize = %d\n", srcsize);
-	GCDBG(GCZONE_KERNEL, "dstsize = %d\n", dstsize);
-	GCDBG(GCZONE_KERNEL, "scalefactor = 0x%08X\n", scalefactor);
-
-	/* Is the filter already loaded? */
-	if ((gccontext->loadedfilter != NULL) &&
-	    (gccontext->loadedfilter->type == type) &&
-	    (gccontext->loadedfilter->kernelsize == kernelsize) &&
-	    (gccontext->loadedfilter->scalefactor == scalefactor)) {
-		GCDBG(GCZONE_KERNEL, "filter already computed.\n");
-		gcfilterkernel = gccontext->loadedfilter;
-		goto load;
+	list_for_each(head, &gccontext->filtercache.hash[hash]) {
+		gcfilterkernel = list_entry(head, struct gcfilterkernel, link);
+
+		if ((gcfilterkernel->scale == scale) &&
+		    (gcfilterkernel->kernelsize == kernelsize) &&
+		    (gcfilterkernel->type == type))
+			return gcfilterkernel;
 	}
 
-	/* Get the proper filter cache. */
-	filtercache = &gccontext->filtercache[type][kernelsize];
-	filterlist = &filtercache->list;
+	return NULL;
+}
+
+/* Returns a cache entry for the new kernel, recycling the least recently
+ * used one when the cache is full; NULL if caching is disabled or the
+ * allocation failed. */
+static struct gcfilterkernel *add_kernel(unsigned int hash)
+{
+	struct gccontext *gccontext = get_context();
+	struct gcfiltercache *filtercache = &gccontext->filtercache;
+	struct gcfilterkernel *gcfilterkernel;
+
+	if (filtercache->max == 0)
+		return NULL;
 
-	/* Try to find existing filter. */
-	GCDBG(GCZONE_KERNEL, "scanning for existing filter.\n");
-	list_for_each(filterhead, filterlist) {
-		gcfilterkernel = list_entry(filterhead,
+	if (filtercache->count >= filtercache->max) {
+		GCDBG(GCZONE_KERNEL,
+		      "reached the maximum number of filters.\n");
+		gcfilterkernel = list_entry(filtercache->lru.prev,
 					    struct gcfilterkernel,
-					    link);
-		if (gcfilterkernel->scalefactor == scalefactor) {
-			GCDBG(GCZONE_KERNEL, "filter found @ 0x%08X.\n",
-			      (unsigned int) gcfilterkernel);
-			break;
-		}
+					    lrulink);
+		list_del(&gcfilterkernel->link);
+		list_del(&gcfilterkernel->lrulink);
+	} else {
+		GCDBG(GCZONE_KERNEL, "allocating new filter.\n");
+		gcfilterkernel = gcalloc(struct gcfilterkernel,
+					 sizeof(struct gcfilterkernel));
+		if (gcfilterkernel == NULL)
+			return NULL;
+
+		filtercache->count += 1;
 	}
 
-	/* Found the filter? */
-	if (filterhead != filterlist) {
-		/* Move the filter to the head of the list. */
-		if (filterlist->next != filterhead) {
-			GCDBG(GCZONE_KERNEL, "moving to the head.\n");
-			list_move(filterhead, filterlist);
-		}
-	} else {
-		GCDBG(GCZONE_KERNEL, "filter not found.\n");
-		if (filtercache->count == GC_FILTER_CACHE_MAX) {
-			GCDBG(GCZONE_KERNEL,
-			      "reached the maximum number of filters.\n");
-			filterhead = filterlist->prev;
-			list_move(filterhead, filterlist);
-
-			gcfilterkernel = list_entry(filterhead,
-						    struct gcfilterkernel,
-						    link);
-		} else {
-			GCDBG(GCZONE_KERNEL, "allocating new filter.\n");
-			gcfilterkernel = gcalloc(struct gcfilterkernel,
-						 sizeof(struct gcfilterkernel));
-			if (gcfilterkernel == NULL) {
-				BVSETBLTERROR(BVERR_OOM,
-					      "filter allocation failed");
-				goto exit;
-			}
+	list_add(&gcfilterkernel->link, &filtercache->hash[hash]);
+	list_add(&gcfilterkernel->lrulink, &filtercache->lru);
+
+	return gcfilterkernel;
+}
 
-			list_add(&gcfilterkernel->link, filterlist);
+/* Fills kernelarray with the coefficients for the kernel size and scale. */
+static void get_filter_kernel(enum gcfiltertype type,
+			      unsigned int kernelsize,
+			      GC_SCALE_TYPE scale,
+			      short *kernelarray)
+{
+	struct gccontext *gccontext = get_context();
+	const struct gcfilterpreset *preset;
+	struct gcfilterkernel *gcfilterkernel;
+	unsigned int hash;
+
+	/* Common ratio? */
+	if (type == GC_FILTER_SYNC) {
+		preset = find_preset(kernelsize, scale);
+		if (preset != NULL) {
+			GCDBG(GCZONE_KERNEL, "using preset filter.\n");
+			memcpy(kernelarray, preset->kernelarray,
+			       sizeof(preset->kernelarray));
+			return;
 		}
+	}
 
-		/* Update the number of filters. */
-		filtercache->count += 1;
+	/* Computed before? */
+	hash = get_filterhash(type, kernelsize, scale);
+	gcfilterkernel = find_kernel(type, kernelsize, scale, hash);
+	if (gcfilterkernel != NULL) {
+		GCDBG(GCZONE_KERNEL, "filter found @ 0x%08X.\n",
+		      (unsigned int) gcfilterkernel);
+		list_move(&gcfilterkernel->lrulink,
+			  &gccontext->filtercache.lru);
+		memcpy(kernelarray, gcfilterkernel->kernelarray,
+		       sizeof(gcfilterkernel->kernelarray));
+		return;
+	}
+
+	GCDBG(GCZONE_KERNEL, "filter not found.\n");
+	calculate_sync_filter(kernelsize, scale, kernelarray);
 
-		/* Initialize the filter. */
+	/* Failing to cache the kernel only costs recomputing it. */
+	gcfilterkernel = add_kernel(hash);
+	if (gcfilterkernel != NULL) {
 		gcfilterkernel->type = type;
 		gcfilterkernel->kernelsize = kernelsize;
-		gcfilterkernel->srcsize = srcsize;
-		gcfilterkernel->dstsize = dstsize;
-		gcfilterkernel->scalefactor = scalefactor;
+		gcfilterkernel->scale = scale;
+		memcpy(gcfilterkernel->kernelarray, kernelarray,
+		       sizeof(gcfilterkernel->kernelarray));
+	}
+}
 
-		/* Compute the coefficients. */
-		calculate_sync_filter(gcfilterkernel);
+void free_filtercache(void)
+{
+	struct gccontext *gccontext = get_context();
+	struct gcfiltercache *filtercache = &gccontext->filtercache;
+	struct gcfilterkernel *gcfilterkernel;
+
+	while (!list_empty(&filtercache->lru)) {
+		gcfilterkernel = list_entry(filtercache->lru.next,
+					    struct gcfilterkernel,
+					    lrulink);
+		list_del(&gcfilterkernel->link);
+		list_del(&gcfilterkernel->lrulink);
+		gcfree(gcfilterkernel);
 	}
 
-load:
-	GCDBG(GCZONE_KERNEL, "loading filter.\n");
+	filtercache->count = 0;
+}
+
+
+/*******************************************************************************
+ * Loads a filter into the GPU.
+ */
+
+static enum bverror load_filter(struct bvbltparams *bvbltparams,
+				struct gcbatch *batch,
+				enum gcfiltertype type,
+				unsigned int kernelsize,
+				unsigned int srcsize,
+				unsigned int dstsize,
+				struct gccmdldstate arraystate)
+{
+	enum bverror bverror;
+	struct gcmofilterkernel *gcmofilterkernel;
+	GC_SCALE_TYPE scale;
+
+	GCDBG(GCZONE_KERNEL, "kernelsize = %d\n", kernelsize);
+	GCDBG(GCZONE_KERNEL, "srcsize = %d\n", srcsize);
+	GCDBG(GCZONE_KERNEL, "dstsize = %d\n", dstsize);
+
+	scale = get_filter_scale(kernelsize, srcsize, dstsize);
+	GCDBG(GCZONE_KERNEL, "scale = 0x%08X\n", scale);
 
 	/* Load the filter. */
 	bverror = claim_buffer(bvbltparams, batch,
@@ -568,12 +669,8 @@ load:
 		goto exit;
 
 	gcmofilterkernel->kernelarray_ldst = arraystate;
-	memcpy(&gcmofilterkernel->kernelarray,
-	       gcfilterkernel->kernelarray,
-	       sizeof(gcfilterkernel->kernelarray));
-
-	/* Set the filter. */
-	gccontext->loadedfilter = gcfilterkernel;
+	get_filter_kernel(type, kernelsize, scale,
+			  (short *) &gcmofilterkernel->kernelarray);
 
 exit:
 	return bverror;
@@ -1437,7 +1534,6 @@ enum bverror do_filter(struct bvbltparams *bvbltparams,
 		bverror = load_filter(bvbltparams, batch,
 				      GC_FILTER_SYNC,
 				      gcfilter->horkernelsize,
-				      gcfilter->horscalefactor,
 				      srcwidth, dstwidth,
 				      gcmofilterkernel_horizontal_ldst);
 		if (bverror != BVERR_NONE)
@@ -1447,7 +1543,6 @@ enum bverror do_filter(struct bvbltparams *bvbltparams,
 		bverror = load_filter(bvbltparams, batch,
 				      GC_FILTER_SYNC,
 				      gcfilter->verkernelsize,
-				      gcfilter->verscalefactor,
 				      srcheight, dstheight,
 				      gcmofilterkernel_vertical_ldst);
 		if (bverror != BVERR_NONE)
@@ -1614,12 +1709,12 @@ enum bverror do_filter(struct bvbltparams *bvbltparams,
 		GCDBG(GCZONE_FILTER, "tmp size (bytes) = %d\n", tmpsize);
 
 		/* Allocate the temporary buffer. */
-		bverror = allocate_temp(bvbltparams, tmpsize);
+		bverror = allocate_temp(bvbltparams, batch, tmpsize,
+					&tmpinfo.buf.desc);
 		if (bverror != BVERR_NONE)
 			goto exit;
 
 		/* Map the temporary buffer. */
-		tmpinfo.buf.desc = gccontext->tmpbuffdesc;
 		bverror = do_map(tmpinfo.buf.desc, batch, &tmpmap);
 		if (bverror != BVERR_NONE) {
 			bvbltparams->errdesc = gccontext->bverrorstr;
@@ -1641,7 +1736,6 @@ enum bverror do_filter(struct bvbltparams *bvbltparams,
 		bverror = load_filter(bvbltparams, batch,
 				      GC_FILTER_SYNC,
 				      gcfilter->verkernelsize,
-				      gcfilter->verscalefactor,
 				      srcheight, dstheight,
 				      gcmofilterkernel_shared_ldst);
 		if (bverror != BVERR_NONE)
@@ -1714,7 +1808,6 @@ enum bverror do_filter(struct bvbltparams *bvbltparams,
 		bverror = load_filter(bvbltparams, batch,
 				      GC_FILTER_SYNC,
 				      gcfilter->horkernelsize,
-				      gcfilter->horscalefactor,
 				      srcwidth, dstwidth,
 				      gcmofilterkernel_shared_ldst);
 		if (bverror != BVERR_NONE)
@@ -1745,7 +1838,6 @@ enum bverror do_filter(struct bvbltparams *bvbltparams,
 			bverror = load_filter(bvbltparams, batch,
 					      GC_FILTER_SYNC,
 					      gcfilter->horkernelsize,
-					      gcfilter->horscalefactor,
 					      srcwidth, dstwidth,
 					      gcmofilterkernel_shared_ldst);
 			if (bverror != BVERR_NONE)
@@ -1764,7 +1856,6 @@ enum bverror do_filter(struct bvbltparams *bvbltparams,
 			bverror = load_filter(bvbltparams, batch,
 					      GC_FILTER_SYNC,
 					      gcfilter->verkernelsize,
-					      gcfilter->verscalefactor,
 					      srcheight, dstheight,
 					      gcmofilterkernel_shared_ldst);
 			if (bverror != BVERR_NONE)
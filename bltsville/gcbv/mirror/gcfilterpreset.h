@@ -0,0 +1,1005 @@
+/*
+ * Generated by gcfiltergen, do not edit.
+ *
+ * SINC filter kernels for the common scale ratios, sorted by kernel size
+ * and scale. Must match what calculate_sync_filter computes; regenerate
+ * with "gcfiltergen > mirror/gcfilterpreset.h" and check with "gcfiltergen -v".
+ */
+
+#ifndef GCFILTERPRESET_H
+#define GCFILTERPRESET_H
+
+static const struct gcfilterpreset gcfilterpresets[] = {
+	{
+		1, 0x80000000,
+		{
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+		}
+	},
+	{
+		3, 0x20000000,
+		{
+			0, 0, 0, 6188, 6189, 4007, 0, 0, 0,
+			0, 0, 0, 6116, 6196, 4072, 0, 0, 0,
+			0, 0, 0, 6043, 6204, 4137, 0, 0, 0,
+			0, 0, 0, 5972, 6210, 4202, 0, 0, 0,
+			0, 0, 0, 5901, 6216, 4267, 0, 0, 0,
+			0, 0, 0, 5830, 6222, 4332, 0, 0, 0,
+			0, 0, 0, 5759, 6227, 4398, 0, 0, 0,
+			0, 0, 0, 5688, 6232, 4464, 0, 0, 0,
+			0, 0, 0, 5618, 6236, 4530, 0, 0, 0,
+			0, 0, 0, 5549, 6239, 4596, 0, 0, 0,
+			0, 0, 0, 5478, 6243, 4663, 0, 0, 0,
+			0, 0, 0, 5410, 6245, 4729, 0, 0, 0,
+			0, 0, 0, 5341, 6247, 4796, 0, 0, 0,
+			0, 0, 0, 5272, 6249, 4863, 0, 0, 0,
+			0, 0, 0, 5203, 6250, 4931, 0, 0, 0,
+			0, 0, 0, 5135, 6251, 4998, 0, 0, 0,
+			0, 0, 0, 5067, 6251, 5066, 0, 0, 0,
+		}
+	},
+	{
+		3, 0x2AAAAAAA,
+		{
+			0, 0, 0, 6703, 6703, 2978, 0, 0, 0,
+			0, 0, 0, 6574, 6729, 3081, 0, 0, 0,
+			0, 0, 0, 6446, 6754, 3184, 0, 0, 0,
+			0, 0, 0, 6319, 6777, 3288, 0, 0, 0,
+			0, 0, 0, 6193, 6798, 3393, 0, 0, 0,
+			0, 0, 0, 6067, 6818, 3499, 0, 0, 0,
+			0, 0, 0, 5942, 6835, 3607, 0, 0, 0,
+			0, 0, 0, 5818, 6851, 3715, 0, 0, 0,
+			0, 0, 0, 5694, 6866, 3824, 0, 0, 0,
+			0, 0, 0, 5570, 6879, 3935, 0, 0, 0,
+			0, 0, 0, 5448, 6890, 4046, 0, 0, 0,
+			0, 0, 0, 5327, 6899, 4158, 0, 0, 0,
+			0, 0, 0, 5207, 6906, 4271, 0, 0, 0,
+			0, 0, 0, 5087, 6912, 4385, 0, 0, 0,
+			0, 0, 0, 4967, 6917, 4500, 0, 0, 0,
+			0, 0, 0, 4850, 6919, 4615, 0, 0, 0,
+			0, 0, 0, 4732, 6920, 4732, 0, 0, 0,
+		}
+	},
+	{
+		3, 0x30000000,
+		{
+			0, 0, 0, 6983, 6983, 2418, 0, 0, 0,
+			0, 0, 0, 6822, 7027, 2535, 0, 0, 0,
+			0, 0, 0, 6661, 7069, 2654, 0, 0, 0,
+			0, 0, 0, 6502, 7107, 2775, 0, 0, 0,
+			0, 0, 0, 6344, 7142, 2898, 0, 0, 0,
+			0, 0, 0, 6185, 7175, 3024, 0, 0, 0,
+			0, 0, 0, 6028, 7205, 3151, 0, 0, 0,
+			0, 0, 0, 5872, 7232, 3280, 0, 0, 0,
+			0, 0, 0, 5717, 7256, 3411, 0, 0, 0,
+			0, 0, 0, 5563, 7278, 3543, 0, 0, 0,
+			0, 0, 0, 5410, 7296, 3678, 0, 0, 0,
+			0, 0, 0, 5258, 7312, 3814, 0, 0, 0,
+			0, 0, 0, 5108, 7325, 3951, 0, 0, 0,
+			0, 0, 0, 4958, 7335, 4091, 0, 0, 0,
+			0, 0, 0, 4810, 7342, 4232, 0, 0, 0,
+			0, 0, 0, 4664, 7346, 4374, 0, 0, 0,
+			0, 0, 0, 4518, 7348, 4518, 0, 0, 0,
+		}
+	},
+	{
+		3, 0x38E38E38,
+		{
+			0, 0, 0, 7442, 7442, 1500, 0, 0, 0,
+			0, 0, 0, 7223, 7533, 1628, 0, 0, 0,
+			0, 0, 0, 7004, 7619, 1761, 0, 0, 0,
+			0, 0, 0, 6786, 7699, 1899, 0, 0, 0,
+			0, 0, 0, 6568, 7774, 2042, 0, 0, 0,
+			0, 0, 0, 6352, 7843, 2189, 0, 0, 0,
+			0, 0, 0, 6137, 7906, 2341, 0, 0, 0,
+			0, 0, 0, 5923, 7964, 2497, 0, 0, 0,
+			0, 0, 0, 5710, 8016, 2658, 0, 0, 0,
+			0, 0, 0, 5499, 8062, 2823, 0, 0, 0,
+			0, 0, 0, 5290, 8102, 2992, 0, 0, 0,
+			0, 0, 0, 5083, 8136, 3165, 0, 0, 0,
+			0, 0, 0, 4878, 8164, 3342, 0, 0, 0,
+			0, 0, 0, 4677, 8185, 3522, 0, 0, 0,
+			0, 0, 0, 4476, 8201, 3707, 0, 0, 0,
+			0, 0, 0, 4280, 8210, 3894, 0, 0, 0,
+			0, 0, 0, 4086, 8213, 4085, 0, 0, 0,
+		}
+	},
+	{
+		3, 0x40000000,
+		{
+			0, 0, 0, 7761, 7761, 862, 0, 0, 0,
+			0, 0, 0, 7495, 7909, 980, 0, 0, 0,
+			0, 0, 0, 7229, 8049, 1106, 0, 0, 0,
+			0, 0, 0, 6962, 8181, 1241, 0, 0, 0,
+			0, 0, 0, 6696, 8305, 1383, 0, 0, 0,
+			0, 0, 0, 6431, 8420, 1533, 0, 0, 0,
+			0, 0, 0, 6166, 8527, 1691, 0, 0, 0,
+			0, 0, 0, 5903, 8624, 1857, 0, 0, 0,
+			0, 0, 0, 5642, 8712, 2030, 0, 0, 0,
+			0, 0, 0, 5383, 8790, 2211, 0, 0, 0,
+			0, 0, 0, 5127, 8858, 2399, 0, 0, 0,
+			0, 0, 0, 4874, 8916, 2594, 0, 0, 0,
+			0, 0, 0, 4624, 8964, 2796, 0, 0, 0,
+			0, 0, 0, 4378, 9001, 3005, 0, 0, 0,
+			0, 0, 0, 4136, 9028, 3220, 0, 0, 0,
+			0, 0, 0, 3900, 9044, 3440, 0, 0, 0,
+			0, 0, 0, 3667, 9050, 3667, 0, 0, 0,
+		}
+	},
+	{
+		3, 0x48000000,
+		{
+			0, 0, 0, 8026, 8027, 331, 0, 0, 0,
+			0, 0, 0, 7709, 8258, 417, 0, 0, 0,
+			0, 0, 0, 7389, 8480, 515, 0, 0, 0,
+			0, 0, 0, 7069, 8691, 624, 0, 0, 0,
+			0, 0, 0, 6747, 8892, 745, 0, 0, 0,
+			0, 0, 0, 6426, 9080, 878, 0, 0, 0,
+			0, 0, 0, 6105, 9256, 1023, 0, 0, 0,
+			0, 0, 0, 5787, 9417, 1180, 0, 0, 0,
+			0, 0, 0, 5470, 9564, 1350, 0, 0, 0,
+			0, 0, 0, 5157, 9696, 1531, 0, 0, 0,
+			0, 0, 0, 4847, 9812, 1725, 0, 0, 0,
+			0, 0, 0, 4544, 9910, 1930, 0, 0, 0,
+			0, 0, 0, 4245, 9992, 2147, 0, 0, 0,
+			0, 0, 0, 3953, 10056, 2375, 0, 0, 0,
+			0, 0, 0, 3668, 10102, 2614, 0, 0, 0,
+			0, 0, 0, 3392, 10129, 2863, 0, 0, 0,
+			0, 0, 0, 3123, 10139, 3122, 0, 0, 0,
+		}
+	},
+	{
+		3, 0x50000000,
+		{
+			0, 0, 0, 8167, 8168, 49, 0, 0, 0,
+			0, 0, 0, 7798, 8498, 88, 0, 0, 0,
+			0, 0, 0, 7424, 8820, 140, 0, 0, 0,
+			0, 0, 0, 7048, 9131, 205, 0, 0, 0,
+			0, 0, 0, 6671, 9429, 284, 0, 0, 0,
+			0, 0, 0, 6295, 9711, 378, 0, 0, 0,
+			0, 0, 0, 5919, 9977, 488, 0, 0, 0,
+			0, 0, 0, 5545, 10225, 614, 0, 0, 0,
+			0, 0, 0, 5175, 10452, 757, 0, 0, 0,
+			0, 0, 0, 4811, 10657, 916, 0, 0, 0,
+			0, 0, 0, 4453, 10837, 1094, 0, 0, 0,
+			0, 0, 0, 4103, 10993, 1288, 0, 0, 0,
+			0, 0, 0, 3762, 11122, 1500, 0, 0, 0,
+			0, 0, 0, 3431, 11224, 1729, 0, 0, 0,
+			0, 0, 0, 3113, 11297, 1974, 0, 0, 0,
+			0, 0, 0, 2807, 11341, 2236, 0, 0, 0,
+			0, 0, 0, 2514, 11356, 2514, 0, 0, 0,
+		}
+	},
+	{
+		3, 0x55555555,
+		{
+			0, 0, 0, 8191, 8193, 0, 0, 0, 0,
+			0, 0, 0, 7785, 8594, 5, 0, 0, 0,
+			0, 0, 0, 7374, 8988, 22, 0, 0, 0,
+			0, 0, 0, 6960, 9372, 52, 0, 0, 0,
+			0, 0, 0, 6544, 9743, 97, 0, 0, 0,
+			0, 0, 0, 6130, 10097, 157, 0, 0, 0,
+			0, 0, 0, 5718, 10433, 233, 0, 0, 0,
+			0, 0, 0, 5308, 10748, 328, 0, 0, 0,
+			0, 0, 0, 4905, 11038, 441, 0, 0, 0,
+			0, 0, 0, 4509, 11301, 574, 0, 0, 0,
+			0, 0, 0, 4123, 11534, 727, 0, 0, 0,
+			0, 0, 0, 3747, 11736, 901, 0, 0, 0,
+			0, 0, 0, 3384, 11904, 1096, 0, 0, 0,
+			0, 0, 0, 3034, 12037, 1313, 0, 0, 0,
+			0, 0, 0, 2702, 12132, 1550, 0, 0, 0,
+			0, 0, 0, 2385, 12190, 1809, 0, 0, 0,
+			0, 0, 0, 2087, 12210, 2087, 0, 0, 0,
+		}
+	},
+	{
+		3, 0x60000000,
+		{
+			0, 0, 0, 8192, 8192, 0, 0, 0, 0,
+			0, 0, 0, 7668, 8716, 0, 0, 0, 0,
+			0, 0, 0, 7146, 9238, 0, 0, 0, 0,
+			0, 0, 0, 6630, 9754, 0, 0, 0, 0,
+			0, 0, 0, 6122, 10262, 0, 0, 0, 0,
+			0, 0, 0, 5624, 10760, 0, 0, 0, 0,
+			0, 0, 0, 5138, 11243, 3, 0, 0, 0,
+			0, 0, 0, 4662, 11700, 22, 0, 0, 0,
+			0, 0, 0, 4199, 12126, 59, 0, 0, 0,
+			0, 0, 0, 3751, 12515, 118, 0, 0, 0,
+			0, 0, 0, 3322, 12863, 199, 0, 0, 0,
+			0, 0, 0, 2914, 13166, 304, 0, 0, 0,
+			0, 0, 0, 2528, 13420, 436, 0, 0, 0,
+			0, 0, 0, 2167, 13621, 596, 0, 0, 0,
+			0, 0, 0, 1833, 13766, 785, 0, 0, 0,
+			0, 0, 0, 1528, 13854, 1002, 0, 0, 0,
+			0, 0, 0, 1250, 13884, 1250, 0, 0, 0,
+		}
+	},
+	{
+		3, 0x66666666,
+		{
+			0, 0, 0, 8191, 8193, 0, 0, 0, 0,
+			0, 0, 0, 7586, 8798, 0, 0, 0, 0,
+			0, 0, 0, 6985, 9399, 0, 0, 0, 0,
+			0, 0, 0, 6393, 9991, 0, 0, 0, 0,
+			0, 0, 0, 5813, 10571, 0, 0, 0, 0,
+			0, 0, 0, 5250, 11134, 0, 0, 0, 0,
+			0, 0, 0, 4707, 11677, 0, 0, 0, 0,
+			0, 0, 0, 4186, 12198, 0, 0, 0, 0,
+			0, 0, 0, 3692, 12692, 0, 0, 0, 0,
+			0, 0, 0, 3224, 13151, 9, 0, 0, 0,
+			0, 0, 0, 2782, 13562, 40, 0, 0, 0,
+			0, 0, 0, 2370, 13920, 94, 0, 0, 0,
+			0, 0, 0, 1989, 14220, 175, 0, 0, 0,
+			0, 0, 0, 1641, 14458, 285, 0, 0, 0,
+			0, 0, 0, 1328, 14630, 426, 0, 0, 0,
+			0, 0, 0, 1050, 14734, 600, 0, 0, 0,
+			0, 0, 0, 808, 14769, 807, 0, 0, 0,
+		}
+	},
+	{
+		3, 0x80000000,
+		{
+			0, 0, 0, 8192, 8192, 0, 0, 0, 0,
+			0, 0, 0, 7171, 9213, 0, 0, 0, 0,
+			0, 0, 0, 6175, 10209, 0, 0, 0, 0,
+			0, 0, 0, 5224, 11160, 0, 0, 0, 0,
+			0, 0, 0, 4336, 12048, 0, 0, 0, 0,
+			0, 0, 0, 3527, 12857, 0, 0, 0, 0,
+			0, 0, 0, 2805, 13579, 0, 0, 0, 0,
+			0, 0, 0, 2175, 14209, 0, 0, 0, 0,
+			0, 0, 0, 1638, 14746, 0, 0, 0, 0,
+			0, 0, 0, 1191, 15193, 0, 0, 0, 0,
+			0, 0, 0, 828, 15556, 0, 0, 0, 0,
+			0, 0, 0, 543, 15841, 0, 0, 0, 0,
+			0, 0, 0, 327, 16057, 0, 0, 0, 0,
+			0, 0, 0, 173, 16211, 0, 0, 0, 0,
+			0, 0, 0, 72, 16312, 0, 0, 0, 0,
+			0, 0, 0, 17, 16367, 0, 0, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+		}
+	},
+	{
+		5, 0x20000000,
+		{
+			0, 0, 3177, 4159, 4160, 3177, 1711, 0, 0,
+			0, 0, 3126, 4131, 4165, 3209, 1753, 0, 0,
+			0, 0, 3076, 4102, 4169, 3243, 1794, 0, 0,
+			0, 0, 3027, 4073, 4173, 3275, 1836, 0, 0,
+			0, 0, 2977, 4044, 4177, 3307, 1879, 0, 0,
+			0, 0, 2927, 4015, 4181, 3340, 1921, 0, 0,
+			0, 0, 2878, 3986, 4184, 3372, 1964, 0, 0,
+			0, 0, 2830, 3956, 4188, 3403, 2007, 0, 0,
+			0, 0, 2782, 3927, 4190, 3435, 2050, 0, 0,
+			0, 0, 2734, 3897, 4193, 3466, 2094, 0, 0,
+			0, 0, 2686, 3867, 4195, 3498, 2138, 0, 0,
+			0, 0, 2639, 3837, 4196, 3530, 2182, 0, 0,
+			0, 0, 2592, 3807, 4198, 3561, 2226, 0, 0,
+			0, 0, 2545, 3777, 4199, 3592, 2271, 0, 0,
+			0, 0, 2499, 3746, 4200, 3623, 2316, 0, 0,
+			0, 0, 2453, 3716, 4200, 3654, 2361, 0, 0,
+			0, 0, 2407, 3685, 4200, 3685, 2407, 0, 0,
+		}
+	},
+	{
+		5, 0x2AAAAAAA,
+		{
+			0, 0, 2957, 4871, 4872, 2957, 727, 0, 0,
+			0, 0, 2872, 4819, 4890, 3022, 781, 0, 0,
+			0, 0, 2789, 4766, 4907, 3086, 836, 0, 0,
+			0, 0, 2706, 4713, 4922, 3151, 892, 0, 0,
+			0, 0, 2624, 4658, 4937, 3215, 950, 0, 0,
+			0, 0, 2544, 4603, 4950, 3279, 1008, 0, 0,
+			0, 0, 2463, 4548, 4963, 3343, 1067, 0, 0,
+			0, 0, 2384, 4492, 4974, 3406, 1128, 0, 0,
+			0, 0, 2306, 4435, 4984, 3470, 1189, 0, 0,
+			0, 0, 2229, 4378, 4992, 3533, 1252, 0, 0,
+			0, 0, 2153, 4321, 5000, 3595, 1315, 0, 0,
+			0, 0, 2078, 4263, 5006, 3658, 1379, 0, 0,
+			0, 0, 2004, 4204, 5012, 3719, 1445, 0, 0,
+			0, 0, 1930, 4145, 5016, 3782, 1511, 0, 0,
+			0, 0, 1858, 4085, 5019, 3843, 1579, 0, 0,
+			0, 0, 1787, 4025, 5021, 3904, 1647, 0, 0,
+			0, 0, 1717, 3965, 5021, 3965, 1716, 0, 0,
+		}
+	},
+	{
+		5, 0x30000000,
+		{
+			0, 0, 2767, 5297, 5298, 2767, 255, 0, 0,
+			0, 0, 2664, 5231, 5329, 2852, 308, 0, 0,
+			0, 0, 2564, 5163, 5357, 2937, 363, 0, 0,
+			0, 0, 2465, 5094, 5384, 3022, 419, 0, 0,
+			0, 0, 2367, 5024, 5409, 3107, 477, 0, 0,
+			0, 0, 2270, 4953, 5432, 3192, 537, 0, 0,
+			0, 0, 2175, 4881, 5453, 3276, 599, 0, 0,
+			0, 0, 2081, 4807, 5473, 3361, 662, 0, 0,
+			0, 0, 1989, 4733, 5490, 3445, 727, 0, 0,
+			0, 0, 1898, 4658, 5505, 3529, 794, 0, 0,
+			0, 0, 1809, 4582, 5518, 3613, 862, 0, 0,
+			0, 0, 1721, 4505, 5529, 3697, 932, 0, 0,
+			0, 0, 1635, 4427, 5538, 3780, 1004, 0, 0,
+			0, 0, 1551, 4348, 5545, 3863, 1077, 0, 0,
+			0, 0, 1468, 4269, 5550, 3945, 1152, 0, 0,
+			0, 0, 1387, 4189, 5553, 4027, 1228, 0, 0,
+			0, 0, 1307, 4108, 5554, 4108, 1307, 0, 0,
+		}
+	},
+	{
+		5, 0x38E38E38,
+		{
+			0, 0, 2302, 6076, 6076, 2303, -373, 0, 0,
+			0, 0, 2174, 5982, 6141, 2424, -337, 0, 0,
+			0, 0, 2048, 5886, 6202, 2546, -298, 0, 0,
+			0, 0, 1924, 5787, 6260, 2669, -256, 0, 0,
+			0, 0, 1803, 5686, 6313, 2793, -211, 0, 0,
+			0, 0, 1685, 5582, 6363, 2917, -163, 0, 0,
+			0, 0, 1569, 5475, 6408, 3044, -112, 0, 0,
+			0, 0, 1456, 5366, 6450, 3170, -58, 0, 0,
+			0, 0, 1346, 5255, 6487, 3296, 0, 0, 0,
+			0, 0, 1239, 5142, 6520, 3423, 60, 0, 0,
+			0, 0, 1134, 5027, 6549, 3550, 124, 0, 0,
+			0, 0, 1033, 4911, 6574, 3676, 190, 0, 0,
+			0, 0, 935, 4792, 6594, 3803, 260, 0, 0,
+			0, 0, 839, 4673, 6609, 3930, 333, 0, 0,
+			0, 0, 747, 4551, 6620, 4056, 410, 0, 0,
+			0, 0, 658, 4429, 6627, 4181, 489, 0, 0,
+			0, 0, 572, 4305, 6630, 4305, 572, 0, 0,
+		}
+	},
+	{
+		5, 0x40000000,
+		{
+			0, 0, 1801, 6715, 6715, 1802, -649, 0, 0,
+			0, 0, 1656, 6597, 6821, 1948, -638, 0, 0,
+			0, 0, 1516, 6475, 6921, 2096, -624, 0, 0,
+			0, 0, 1380, 6347, 7015, 2248, -606, 0, 0,
+			0, 0, 1247, 6215, 7104, 2402, -584, 0, 0,
+			0, 0, 1118, 6079, 7186, 2560, -559, 0, 0,
+			0, 0, 994, 5939, 7262, 2719, -530, 0, 0,
+			0, 0, 874, 5796, 7331, 2880, -497, 0, 0,
+			0, 0, 758, 5648, 7394, 3043, -459, 0, 0,
+			0, 0, 647, 5498, 7450, 3207, -418, 0, 0,
+			0, 0, 540, 5344, 7498, 3374, -372, 0, 0,
+			0, 0, 438, 5188, 7539, 3540, -321, 0, 0,
+			0, 0, 342, 5029, 7573, 3707, -267, 0, 0,
+			0, 0, 249, 4868, 7600, 3874, -207, 0, 0,
+			0, 0, 161, 4706, 7619, 4041, -143, 0, 0,
+			0, 0, 78, 4541, 7630, 4209, -74, 0, 0,
+			0, 0, 0, 4375, 7634, 4375, 0, 0, 0,
+		}
+	},
+	{
+		5, 0x48000000,
+		{
+			0, 0, 1137, 7399, 7399, 1138, -689, 0, 0,
+			0, 0, 984, 7247, 7562, 1299, -708, 0, 0,
+			0, 0, 837, 7087, 7718, 1467, -725, 0, 0,
+			0, 0, 697, 6920, 7865, 1641, -739, 0, 0,
+			0, 0, 562, 6746, 8004, 1822, -750, 0, 0,
+			0, 0, 434, 6566, 8134, 2007, -757, 0, 0,
+			0, 0, 313, 6380, 8255, 2197, -761, 0, 0,
+			0, 0, 198, 6189, 8365, 2393, -761, 0, 0,
+			0, 0, 90, 5992, 8465, 2593, -756, 0, 0,
+			0, 0, -11, 5791, 8554, 2797, -747, 0, 0,
+			0, 0, -106, 5586, 8632, 3005, -733, 0, 0,
+			0, 0, -194, 5377, 8699, 3216, -714, 0, 0,
+			0, 0, -275, 5165, 8754, 3429, -689, 0, 0,
+			0, 0, -349, 4951, 8797, 3644, -659, 0, 0,
+			0, 0, -417, 4734, 8828, 3862, -623, 0, 0,
+			0, 0, -478, 4517, 8846, 4080, -581, 0, 0,
+			0, 0, -532, 4298, 8852, 4298, -532, 0, 0,
+		}
+	},
+	{
+		5, 0x50000000,
+		{
+			0, 0, 440, 8006, 8006, 441, -509, 0, 0,
+			0, 0, 293, 7806, 8233, 600, -548, 0, 0,
+			0, 0, 154, 7597, 8451, 768, -586, 0, 0,
+			0, 0, 24, 7378, 8658, 948, -624, 0, 0,
+			0, 0, -96, 7150, 8854, 1137, -661, 0, 0,
+			0, 0, -208, 6915, 9038, 1335, -696, 0, 0,
+			0, 0, -310, 6671, 9210, 1543, -730, 0, 0,
+			0, 0, -403, 6421, 9367, 1759, -760, 0, 0,
+			0, 0, -487, 6166, 9510, 1983, -788, 0, 0,
+			0, 0, -562, 5905, 9638, 2216, -813, 0, 0,
+			0, 0, -628, 5640, 9750, 2456, -834, 0, 0,
+			0, 0, -686, 5372, 9846, 2702, -850, 0, 0,
+			0, 0, -735, 5101, 9925, 2955, -862, 0, 0,
+			0, 0, -776, 4829, 9987, 3213, -869, 0, 0,
+			0, 0, -809, 4556, 10031, 3476, -870, 0, 0,
+			0, 0, -835, 4283, 10058, 3743, -865, 0, 0,
+			0, 0, -853, 4012, 10067, 4011, -853, 0, 0,
+		}
+	},
+	{
+		5, 0x55555555,
+		{
+			0, 0, 0, 8359, 8360, 0, -335, 0, 0,
+			0, 0, -135, 8119, 8630, 146, -376, 0, 0,
+			0, 0, -259, 7867, 8890, 305, -419, 0, 0,
+			0, 0, -372, 7604, 9138, 477, -463, 0, 0,
+			0, 0, -474, 7332, 9373, 661, -508, 0, 0,
+			0, 0, -565, 7052, 9593, 857, -553, 0, 0,
+			0, 0, -645, 6763, 9799, 1065, -598, 0, 0,
+			0, 0, -715, 6468, 9988, 1286, -643, 0, 0,
+			0, 0, -774, 6168, 10159, 1517, -686, 0, 0,
+			0, 0, -824, 5863, 10313, 1759, -727, 0, 0,
+			0, 0, -864, 5556, 10448, 2011, -767, 0, 0,
+			0, 0, -894, 5245, 10563, 2274, -804, 0, 0,
+			0, 0, -917, 4935, 10659, 2544, -837, 0, 0,
+			0, 0, -930, 4624, 10733, 2824, -867, 0, 0,
+			0, 0, -936, 4314, 10787, 3111, -892, 0, 0,
+			0, 0, -935, 4007, 10819, 3405, -912, 0, 0,
+			0, 0, -926, 3703, 10830, 3703, -926, 0, 0,
+		}
+	},
+	{
+		5, 0x60000000,
+		{
+			0, 0, -727, 8945, 8945, -726, -53, 0, 0,
+			0, 0, -814, 8597, 9302, -626, -75, 0, 0,
+			0, 0, -887, 8236, 9645, -509, -101, 0, 0,
+			0, 0, -945, 7865, 9972, -376, -132, 0, 0,
+			0, 0, -990, 7485, 10282, -227, -166, 0, 0,
+			0, 0, -1022, 7098, 10573, -60, -205, 0, 0,
+			0, 0, -1043, 6705, 10843, 125, -246, 0, 0,
+			0, 0, -1052, 6309, 11092, 327, -292, 0, 0,
+			0, 0, -1051, 5912, 11318, 545, -340, 0, 0,
+			0, 0, -1040, 5515, 11520, 780, -391, 0, 0,
+			0, 0, -1021, 5119, 11697, 1033, -444, 0, 0,
+			0, 0, -994, 4727, 11848, 1302, -499, 0, 0,
+			0, 0, -961, 4340, 11973, 1587, -555, 0, 0,
+			0, 0, -921, 3959, 12071, 1886, -611, 0, 0,
+			0, 0, -877, 3587, 12141, 2201, -668, 0, 0,
+			0, 0, -829, 3224, 12183, 2529, -723, 0, 0,
+			0, 0, -777, 2871, 12197, 2870, -777, 0, 0,
+		}
+	},
+	{
+		5, 0x66666666,
+		{
+			0, 0, -1024, 9215, 9217, -1024, 0, 0, 0,
+			0, 0, -1071, 8791, 9628, -961, -3, 0, 0,
+			0, 0, -1103, 8354, 10022, -880, -9, 0, 0,
+			0, 0, -1120, 7907, 10399, -782, -20, 0, 0,
+			0, 0, -1125, 7454, 10755, -664, -36, 0, 0,
+			0, 0, -1117, 6997, 11089, -529, -56, 0, 0,
+			0, 0, -1098, 6537, 11399, -372, -82, 0, 0,
+			0, 0, -1069, 6078, 11684, -196, -113, 0, 0,
+			0, 0, -1033, 5622, 11943, 0, -148, 0, 0,
+			0, 0, -989, 5170, 12174, 217, -188, 0, 0,
+			0, 0, -939, 4725, 12377, 454, -233, 0, 0,
+			0, 0, -884, 4289, 12549, 711, -281, 0, 0,
+			0, 0, -826, 3863, 12692, 989, -334, 0, 0,
+			0, 0, -764, 3449, 12803, 1286, -390, 0, 0,
+			0, 0, -701, 3048, 12883, 1603, -449, 0, 0,
+			0, 0, -637, 2662, 12931, 1938, -510, 0, 0,
+			0, 0, -573, 2292, 12947, 2291, -573, 0, 0,
+		}
+	},
+	{
+		5, 0x80000000,
+		{
+			0, 0, -1025, 9217, 9217, -1025, 0, 0, 0,
+			0, 0, -929, 8514, 9913, -1114, 0, 0, 0,
+			0, 0, -831, 7813, 10599, -1197, 0, 0, 0,
+			0, 0, -733, 7115, 11271, -1269, 0, 0, 0,
+			0, 0, -635, 6424, 11923, -1328, 0, 0, 0,
+			0, 0, -541, 5745, 12550, -1370, 0, 0, 0,
+			0, 0, -451, 5082, 13148, -1395, 0, 0, 0,
+			0, 0, -368, 4439, 13710, -1397, 0, 0, 0,
+			0, 0, -291, 3818, 14232, -1375, 0, 0, 0,
+			0, 0, -222, 3223, 14708, -1325, 0, 0, 0,
+			0, 0, -162, 2657, 15133, -1244, 0, 0, 0,
+			0, 0, -112, 2123, 15504, -1131, 0, 0, 0,
+			0, 0, -71, 1623, 15814, -982, 0, 0, 0,
+			0, 0, -39, 1159, 16060, -796, 0, 0, 0,
+			0, 0, -17, 733, 16239, -571, 0, 0, 0,
+			0, 0, -5, 347, 16348, -306, 0, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+		}
+	},
+	{
+		7, 0x20000000,
+		{
+			0, 1604, 2803, 3564, 3564, 2803, 1604, 442, 0,
+			0, 1562, 2765, 3544, 3570, 2830, 1641, 472, 0,
+			0, 1520, 2727, 3524, 3575, 2858, 1677, 503, 0,
+			0, 1479, 2687, 3504, 3580, 2885, 1714, 535, 0,
+			0, 1438, 2650, 3483, 3585, 2912, 1750, 566, 0,
+			0, 1397, 2612, 3462, 3589, 2938, 1788, 598, 0,
+			0, 1357, 2573, 3441, 3593, 2965, 1824, 631, 0,
+			0, 1317, 2535, 3420, 3597, 2991, 1860, 664, 0,
+			0, 1278, 2497, 3398, 3600, 3017, 1897, 697, 0,
+			0, 1239, 2460, 3376, 3603, 3042, 1934, 730, 0,
+			0, 1200, 2422, 3354, 3605, 3068, 1971, 764, 0,
+			0, 1162, 2384, 3331, 3607, 3093, 2009, 798, 0,
+			0, 1124, 2346, 3309, 3609, 3117, 2046, 833, 0,
+			0, 1086, 2308, 3286, 3611, 3142, 2083, 868, 0,
+			0, 1049, 2271, 3262, 3611, 3167, 2121, 903, 0,
+			0, 1012, 2233, 3239, 3612, 3191, 2158, 939, 0,
+			0, 975, 2196, 3215, 3612, 3215, 2196, 975, 0,
+		}
+	},
+	{
+		7, 0x2AAAAAAA,
+		{
+			0, 820, 2977, 4652, 4652, 2977, 820, -514, 0,
+			0, 760, 2905, 4615, 4675, 3040, 880, -491, 0,
+			0, 701, 2833, 4577, 4697, 3104, 939, -467, 0,
+			0, 644, 2761, 4538, 4717, 3166, 999, -441, 0,
+			0, 587, 2689, 4497, 4736, 3229, 1060, -414, 0,
+			0, 531, 2618, 4456, 4753, 3290, 1122, -386, 0,
+			0, 477, 2546, 4413, 4769, 3351, 1185, -357, 0,
+			0, 424, 2475, 4369, 4783, 3412, 1248, -327, 0,
+			0, 372, 2404, 4324, 4796, 3472, 1312, -296, 0,
+			0, 321, 2333, 4278, 4808, 3531, 1376, -263, 0,
+			0, 272, 2262, 4230, 4817, 3590, 1442, -229, 0,
+			0, 223, 2192, 4182, 4826, 3648, 1507, -194, 0,
+			0, 176, 2121, 4133, 4833, 3705, 1574, -158, 0,
+			0, 130, 2052, 4082, 4838, 3762, 1640, -120, 0,
+			0, 85, 1983, 4031, 4842, 3817, 1708, -82, 0,
+			0, 42, 1913, 3979, 4844, 3872, 1776, -42, 0,
+			0, 0, 1844, 3926, 4845, 3925, 1844, 0, 0,
+		}
+	},
+	{
+		7, 0x30000000,
+		{
+			0, 318, 2968, 5314, 5314, 2968, 318, -816, 0,
+			0, 254, 2876, 5267, 5354, 3058, 383, -808, 0,
+			0, 192, 2784, 5218, 5392, 3147, 449, -798, 0,
+			0, 132, 2692, 5166, 5427, 3236, 517, -786, 0,
+			0, 74, 2600, 5112, 5460, 3324, 587, -773, 0,
+			0, 18, 2507, 5057, 5490, 3412, 658, -758, 0,
+			0, -37, 2416, 4999, 5518, 3499, 730, -741, 0,
+			0, -89, 2325, 4939, 5543, 3585, 804, -723, 0,
+			0, -140, 2234, 4877, 5566, 3671, 879, -703, 0,
+			0, -189, 2143, 4814, 5586, 3756, 956, -682, 0,
+			0, -236, 2052, 4748, 5604, 3840, 1034, -658, 0,
+			0, -282, 1964, 4681, 5618, 3923, 1113, -633, 0,
+			0, -325, 1874, 4612, 5631, 4004, 1194, -606, 0,
+			0, -367, 1787, 4541, 5640, 4085, 1275, -577, 0,
+			0, -407, 1699, 4469, 5647, 4165, 1358, -547, 0,
+			0, -444, 1612, 4395, 5651, 4243, 1442, -515, 0,
+			0, -480, 1527, 4319, 5652, 4319, 1527, -480, 0,
+		}
+	},
+	{
+		7, 0x38E38E38,
+		{
+			0, -549, 2702, 6477, 6477, 2703, -549, -877, 0,
+			0, -604, 2572, 6409, 6560, 2841, -493, -901, 0,
+			0, -656, 2443, 6336, 6637, 2980, -433, -923, 0,
+			0, -704, 2314, 6258, 6711, 3119, -369, -945, 0,
+			0, -749, 2186, 6176, 6779, 3259, -303, -964, 0,
+			0, -791, 2059, 6089, 6843, 3399, -232, -983, 0,
+			0, -830, 1931, 5999, 6902, 3539, -158, -999, 0,
+			0, -866, 1807, 5904, 6955, 3679, -81, -1014, 0,
+			0, -898, 1682, 5805, 7003, 3818, 0, -1026, 0,
+			0, -927, 1560, 5702, 7046, 3957, 83, -1037, 0,
+			0, -954, 1440, 5596, 7083, 4094, 171, -1046, 0,
+			0, -977, 1320, 5486, 7115, 4231, 261, -1052, 0,
+			0, -997, 1204, 5372, 7141, 4366, 355, -1057, 0,
+			0, -1014, 1089, 5256, 7161, 4499, 451, -1058, 0,
+			0, -1028, 976, 5136, 7176, 4631, 551, -1058, 0,
+			0, -1040, 866, 5014, 7185, 4760, 653, -1054, 0,
+			0, -1049, 758, 4889, 7188, 4889, 758, -1049, 0,
+		}
+	},
+	{
+		7, 0x40000000,
+		{
+			0, -1096, 2227, 7340, 7340, 2228, -1096, -559, 0,
+			0, -1128, 2068, 7245, 7464, 2401, -1065, -601, 0,
+			0, -1155, 1910, 7144, 7581, 2576, -1030, -642, 0,
+			0, -1178, 1754, 7035, 7692, 2754, -989, -684, 0,
+			0, -1198, 1600, 6921, 7796, 2933, -943, -725, 0,
+			0, -1212, 1448, 6799, 7893, 3114, -893, -765, 0,
+			0, -1223, 1299, 6672, 7982, 3297, -838, -805, 0,
+			0, -1230, 1152, 6539, 8064, 3481, -777, -845, 0,
+			0, -1234, 1010, 6400, 8138, 3665, -712, -883, 0,
+			0, -1233, 870, 6256, 8203, 3850, -641, -921, 0,
+			0, -1229, 733, 6106, 8261, 4034, -564, -957, 0,
+			0, -1222, 601, 5952, 8309, 4219, -483, -992, 0,
+			0, -1211, 472, 5793, 8350, 4402, -397, -1025, 0,
+			0, -1197, 348, 5630, 8381, 4584, -305, -1057, 0,
+			0, -1180, 227, 5463, 8403, 4765, -208, -1086, 0,
+			0, -1161, 111, 5293, 8417, 4944, -107, -1113, 0,
+			0, -1138, 0, 5120, 8421, 5119, 0, -1138, 0,
+		}
+	},
+	{
+		7, 0x48000000,
+		{
+			0, -1382, 1468, 8138, 8138, 1468, -1382, -64, 0,
+			0, -1374, 1283, 7997, 8307, 1666, -1392, -103, 0,
+			0, -1361, 1102, 7848, 8468, 1867, -1396, -144, 0,
+			0, -1344, 926, 7689, 8620, 2075, -1396, -186, 0,
+			0, -1323, 755, 7523, 8762, 2288, -1390, -231, 0,
+			0, -1298, 589, 7348, 8895, 2504, -1378, -276, 0,
+			0, -1269, 429, 7166, 9018, 2724, -1360, -324, 0,
+			0, -1237, 274, 6977, 9130, 2948, -1336, -372, 0,
+			0, -1202, 127, 6781, 9231, 3175, -1306, -422, 0,
+			0, -1164, -16, 6579, 9322, 3405, -1269, -473, 0,
+			0, -1123, -150, 6371, 9400, 3636, -1226, -524, 0,
+			0, -1080, -280, 6159, 9467, 3869, -1175, -576, 0,
+			0, -1035, -400, 5941, 9522, 4103, -1118, -629, 0,
+			0, -988, -516, 5720, 9566, 4337, -1054, -681, 0,
+			0, -939, -623, 5495, 9596, 4571, -982, -734, 0,
+			0, -889, -724, 5267, 9615, 4804, -903, -786, 0,
+			0, -838, -817, 5037, 9621, 5036, -817, -838, 0,
+		}
+	},
+	{
+		7, 0x50000000,
+		{
+			0, -1281, 590, 8744, 8744, 590, -1281, 278, 0,
+			0, -1231, 395, 8539, 8955, 794, -1330, 262, 0,
+			0, -1179, 211, 8325, 9155, 1005, -1375, 242, 0,
+			0, -1123, 34, 8100, 9344, 1225, -1416, 220, 0,
+			0, -1065, -133, 7866, 9521, 1454, -1453, 194, 0,
+			0, -1006, -291, 7625, 9686, 1689, -1485, 166, 0,
+			0, -944, -441, 7375, 9838, 1932, -1511, 135, 0,
+			0, -882, -579, 7119, 9976, 2181, -1532, 101, 0,
+			0, -819, -710, 6857, 10102, 2437, -1547, 64, 0,
+			0, -755, -831, 6590, 10213, 2697, -1555, 25, 0,
+			0, -692, -941, 6318, 10310, 2964, -1557, -18, 0,
+			0, -628, -1041, 6042, 10392, 3234, -1552, -63, 0,
+			0, -565, -1133, 5763, 10460, 3508, -1538, -111, 0,
+			0, -503, -1215, 5482, 10513, 3786, -1518, -161, 0,
+			0, -442, -1288, 5199, 10551, 4066, -1489, -213, 0,
+			0, -382, -1352, 4915, 10574, 4348, -1452, -267, 0,
+			0, -324, -1406, 4631, 10582, 4631, -1406, -324, 0,
+		}
+	},
+	{
+		7, 0x55555555,
+		{
+			0, -1044, 0, 9062, 9062, 1, -1044, 347, 0,
+			0, -974, -187, 8808, 9302, 199, -1112, 348, 0,
+			0, -902, -363, 8544, 9530, 408, -1179, 346, 0,
+			0, -830, -527, 8270, 9745, 627, -1243, 342, 0,
+			0, -758, -679, 7987, 9946, 857, -1304, 335, 0,
+			0, -686, -819, 7696, 10133, 1097, -1362, 325, 0,
+			0, -614, -949, 7398, 10305, 1347, -1415, 312, 0,
+			0, -544, -1066, 7094, 10463, 1605, -1464, 296, 0,
+			0, -475, -1172, 6786, 10605, 1872, -1508, 276, 0,
+			0, -407, -1266, 6473, 10731, 2146, -1547, 254, 0,
+			0, -342, -1348, 6157, 10840, 2429, -1579, 227, 0,
+			0, -278, -1421, 5839, 10934, 2718, -1606, 198, 0,
+			0, -217, -1481, 5519, 11011, 3013, -1626, 165, 0,
+			0, -158, -1532, 5199, 11070, 3314, -1638, 129, 0,
+			0, -103, -1573, 4879, 11113, 3620, -1641, 89, 0,
+			0, -50, -1605, 4561, 11139, 3931, -1638, 46, 0,
+			0, 0, -1626, 4244, 11148, 4244, -1626, 0, 0,
+		}
+	},
+	{
+		7, 0x60000000,
+		{
+			0, -382, -1059, 9536, 9536, -1059, -382, 194, 0,
+			0, -302, -1205, 9182, 9853, -895, -464, 215, 0,
+			0, -225, -1334, 8816, 10154, -715, -548, 236, 0,
+			0, -153, -1446, 8441, 10439, -518, -635, 256, 0,
+			0, -85, -1542, 8058, 10706, -306, -723, 276, 0,
+			0, -21, -1623, 7668, 10955, -79, -811, 295, 0,
+			0, 39, -1690, 7273, 11186, 163, -900, 313, 0,
+			0, 93, -1741, 6874, 11396, 422, -989, 329, 0,
+			0, 143, -1779, 6472, 11586, 694, -1076, 344, 0,
+			0, 188, -1804, 6070, 11756, 980, -1163, 357, 0,
+			0, 228, -1816, 5668, 11903, 1280, -1247, 368, 0,
+			0, 263, -1816, 5267, 12029, 1593, -1328, 376, 0,
+			0, 293, -1804, 4869, 12132, 1919, -1406, 381, 0,
+			0, 319, -1783, 4475, 12213, 2256, -1479, 383, 0,
+			0, 340, -1752, 4086, 12271, 2603, -1546, 382, 0,
+			0, 357, -1713, 3704, 12306, 2961, -1609, 378, 0,
+			0, 369, -1663, 3328, 12317, 3328, -1664, 369, 0,
+		}
+	},
+	{
+		7, 0x66666666,
+		{
+			0, 0, -1561, 9722, 9722, -1561, 0, 62, 0,
+			0, 65, -1667, 9311, 10101, -1433, -72, 79, 0,
+			0, 125, -1754, 8888, 10462, -1286, -148, 97, 0,
+			0, 179, -1823, 8455, 10806, -1120, -229, 116, 0,
+			0, 227, -1877, 8014, 11131, -934, -314, 137, 0,
+			0, 269, -1912, 7567, 11434, -730, -403, 159, 0,
+			0, 305, -1932, 7115, 11716, -505, -496, 181, 0,
+			0, 335, -1937, 6661, 11974, -262, -592, 205, 0,
+			0, 360, -1928, 6205, 12208, 1, -690, 228, 0,
+			0, 380, -1907, 5750, 12417, 282, -790, 252, 0,
+			0, 394, -1873, 5298, 12600, 581, -891, 275, 0,
+			0, 403, -1828, 4850, 12756, 898, -992, 297, 0,
+			0, 408, -1773, 4407, 12884, 1232, -1093, 319, 0,
+			0, 408, -1709, 3971, 12985, 1582, -1192, 339, 0,
+			0, 404, -1636, 3544, 13057, 1947, -1289, 357, 0,
+			0, 397, -1558, 3127, 13100, 2328, -1383, 373, 0,
+			0, 386, -1472, 2721, 13115, 2721, -1473, 386, 0,
+		}
+	},
+	{
+		7, 0x80000000,
+		{
+			0, 400, -2226, 10018, 10018, -2226, 400, 0, 0,
+			0, 366, -2125, 9327, 10694, -2309, 431, 0, 0,
+			0, 330, -2008, 8624, 11350, -2371, 459, 0, 0,
+			0, 293, -1877, 7916, 11981, -2411, 482, 0, 0,
+			0, 256, -1737, 7207, 12584, -2425, 499, 0, 0,
+			0, 220, -1587, 6500, 13153, -2411, 509, 0, 0,
+			0, 185, -1433, 5801, 13686, -2367, 512, 0, 0,
+			0, 151, -1274, 5113, 14179, -2292, 507, 0, 0,
+			0, 120, -1115, 4441, 14628, -2183, 493, 0, 0,
+			0, 92, -955, 3788, 15030, -2040, 469, 0, 0,
+			0, 68, -800, 3158, 15384, -1861, 435, 0, 0,
+			0, 47, -648, 2553, 15687, -1645, 390, 0, 0,
+			0, 30, -502, 1977, 15936, -1392, 335, 0, 0,
+			0, 16, -363, 1432, 16132, -1101, 268, 0, 0,
+			0, 7, -232, 920, 16272, -772, 189, 0, 0,
+			0, 1, -111, 442, 16356, -404, 100, 0, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+		}
+	},
+	{
+		9, 0x20000000,
+		{
+			461, 1624, 2779, 3498, 3498, 2779, 1625, 461, -341,
+			429, 1584, 2745, 3482, 3506, 2807, 1661, 493, -323,
+			397, 1544, 2710, 3466, 3514, 2835, 1697, 526, -305,
+			366, 1504, 2675, 3449, 3521, 2863, 1734, 558, -286,
+			335, 1465, 2641, 3431, 3527, 2890, 1771, 591, -267,
+			304, 1425, 2606, 3414, 3533, 2917, 1809, 624, -248,
+			274, 1386, 2570, 3395, 3539, 2944, 1846, 657, -227,
+			244, 1347, 2535, 3377, 3544, 2970, 1883, 691, -207,
+			215, 1309, 2500, 3358, 3548, 2996, 1919, 725, -186,
+			187, 1270, 2464, 3338, 3552, 3021, 1956, 760, -164,
+			159, 1232, 2429, 3318, 3556, 3046, 1992, 794, -142,
+			131, 1194, 2393, 3298, 3559, 3071, 2029, 829, -120,
+			104, 1157, 2356, 3277, 3561, 3096, 2065, 865, -97,
+			77, 1119, 2321, 3256, 3563, 3120, 2102, 900, -74,
+			51, 1082, 2285, 3234, 3564, 3143, 2139, 936, -50,
+			25, 1045, 2248, 3212, 3565, 3167, 2175, 972, -25,
+			0, 1009, 2212, 3189, 3565, 3189, 2211, 1009, 0,
+		}
+	},
+	{
+		9, 0x2AAAAAAA,
+		{
+			-625, 939, 3281, 5037, 5037, 3282, 939, -625, -881,
+			-653, 873, 3211, 5007, 5070, 3355, 1008, -597, -890,
+			-680, 808, 3140, 4976, 5101, 3428, 1076, -567, -898,
+			-705, 744, 3068, 4943, 5130, 3500, 1145, -535, -906,
+			-728, 681, 2996, 4908, 5157, 3571, 1215, -503, -913,
+			-751, 618, 2922, 4871, 5182, 3642, 1286, -468, -918,
+			-772, 557, 2849, 4832, 5205, 3711, 1358, -433, -923,
+			-792, 496, 2776, 4791, 5225, 3780, 1430, -396, -926,
+			-810, 436, 2701, 4749, 5244, 3848, 1502, -357, -929,
+			-827, 378, 2627, 4704, 5261, 3914, 1575, -317, -931,
+			-843, 320, 2552, 4658, 5275, 3980, 1649, -276, -931,
+			-857, 264, 2476, 4610, 5287, 4044, 1723, -233, -930,
+			-870, 209, 2401, 4560, 5297, 4107, 1798, -190, -928,
+			-882, 155, 2325, 4509, 5305, 4169, 1872, -144, -925,
+			-892, 102, 2250, 4456, 5310, 4229, 1948, -98, -921,
+			-901, 50, 2174, 4402, 5314, 4288, 2023, -50, -916,
+			-909, 0, 2099, 4345, 5315, 4345, 2098, 0, -909,
+		}
+	},
+	{
+		9, 0x30000000,
+		{
+			-1048, 377, 3353, 5868, 5868, 3354, 377, -1048, -717,
+			-1062, 303, 3260, 5829, 5922, 3458, 454, -1036, -744,
+			-1073, 230, 3165, 5788, 5972, 3562, 532, -1022, -770,
+			-1083, 159, 3068, 5743, 6020, 3665, 613, -1005, -796,
+			-1091, 89, 2972, 5695, 6065, 3767, 695, -987, -821,
+			-1097, 22, 2875, 5644, 6106, 3868, 779, -967, -846,
+			-1102, -44, 2777, 5589, 6144, 3969, 865, -944, -870,
+			-1104, -108, 2678, 5532, 6178, 4068, 953, -920, -893,
+			-1105, -171, 2580, 5472, 6209, 4166, 1041, -893, -915,
+			-1104, -232, 2481, 5409, 6237, 4262, 1131, -864, -936,
+			-1102, -290, 2381, 5343, 6261, 4358, 1222, -833, -956,
+			-1097, -347, 2282, 5274, 6281, 4451, 1314, -799, -975,
+			-1092, -401, 2184, 5202, 6297, 4543, 1408, -764, -993,
+			-1084, -454, 2085, 5128, 6310, 4633, 1502, -726, -1010,
+			-1075, -505, 1987, 5051, 6320, 4721, 1597, -686, -1026,
+			-1065, -553, 1889, 4972, 6325, 4807, 1693, -644, -1040,
+			-1053, -600, 1791, 4891, 6327, 4891, 1790, -600, -1053,
+		}
+	},
+	{
+		9, 0x38E38E38,
+		{
+			-1187, -659, 3024, 7014, 7014, 3024, -659, -1187, 0,
+			-1163, -727, 2885, 6948, 7105, 3175, -590, -1214, -35,
+			-1137, -792, 2745, 6877, 7190, 3328, -517, -1240, -70,
+			-1109, -854, 2606, 6800, 7270, 3480, -439, -1263, -107,
+			-1080, -911, 2467, 6718, 7345, 3632, -359, -1284, -144,
+			-1049, -966, 2328, 6631, 7415, 3785, -275, -1303, -182,
+			-1016, -1017, 2190, 6539, 7479, 3937, -187, -1320, -221,
+			-982, -1064, 2053, 6442, 7537, 4088, -96, -1334, -260,
+			-947, -1108, 1916, 6341, 7589, 4239, 0, -1345, -301,
+			-911, -1149, 1781, 6235, 7636, 4388, 99, -1354, -341,
+			-873, -1185, 1646, 6125, 7676, 4536, 201, -1360, -382,
+			-835, -1219, 1514, 6011, 7711, 4683, 306, -1363, -424,
+			-796, -1248, 1383, 5892, 7739, 4828, 415, -1363, -466,
+			-756, -1274, 1254, 5770, 7761, 4970, 526, -1360, -507,
+			-715, -1297, 1126, 5645, 7777, 5111, 640, -1354, -549,
+			-674, -1316, 1001, 5516, 7787, 5248, 758, -1345, -591,
+			-633, -1332, 878, 5384, 7790, 5384, 878, -1332, -633,
+		}
+	},
+	{
+		9, 0x40000000,
+		{
+			-783, -1300, 2413, 7625, 7625, 2413, -1299, -783, 473,
+			-733, -1341, 2242, 7521, 7738, 2591, -1257, -834, 457,
+			-682, -1377, 2072, 7410, 7844, 2771, -1209, -884, 439,
+			-631, -1409, 1904, 7294, 7944, 2952, -1155, -934, 419,
+			-580, -1435, 1737, 7171, 8037, 3135, -1097, -982, 398,
+			-529, -1458, 1575, 7042, 8124, 3319, -1033, -1030, 374,
+			-478, -1475, 1414, 6909, 8203, 3503, -965, -1076, 349,
+			-427, -1489, 1257, 6770, 8275, 3688, -891, -1121, 322,
+			-377, -1498, 1102, 6626, 8340, 3874, -811, -1164, 292,
+			-327, -1502, 950, 6477, 8398, 4059, -728, -1205, 262,
+			-277, -1503, 802, 6324, 8448, 4244, -639, -1244, 229,
+			-229, -1500, 659, 6167, 8490, 4428, -545, -1281, 195,
+			-181, -1493, 519, 6006, 8525, 4611, -446, -1316, 159,
+			-134, -1482, 383, 5841, 8553, 4793, -342, -1349, 121,
+			-88, -1468, 251, 5673, 8572, 4973, -232, -1379, 82,
+			-44, -1450, 123, 5502, 8584, 5152, -119, -1406, 42,
+			0, -1430, 0, 5328, 8588, 5328, 0, -1430, 0,
+		}
+	},
+	{
+		9, 0x48000000,
+		{
+			-96, -1638, 1544, 8113, 8113, 1544, -1638, -96, 538,
+			-42, -1632, 1349, 7956, 8250, 1741, -1636, -152, 550,
+			11, -1621, 1158, 7791, 8380, 1942, -1628, -210, 561,
+			62, -1605, 972, 7620, 8501, 2147, -1616, -268, 571,
+			111, -1584, 793, 7442, 8614, 2355, -1597, -328, 578,
+			157, -1559, 620, 7260, 8718, 2565, -1572, -389, 584,
+			202, -1530, 452, 7071, 8814, 2778, -1542, -450, 589,
+			244, -1497, 290, 6878, 8901, 2994, -1505, -512, 591,
+			284, -1460, 133, 6681, 8979, 3212, -1461, -575, 591,
+			321, -1420, -16, 6479, 9048, 3431, -1411, -637, 589,
+			356, -1377, -159, 6274, 9109, 3651, -1356, -700, 586,
+			389, -1331, -296, 6065, 9160, 3873, -1293, -763, 580,
+			419, -1282, -425, 5853, 9202, 4095, -1224, -825, 571,
+			446, -1230, -549, 5638, 9234, 4317, -1147, -886, 561,
+			472, -1178, -666, 5422, 9258, 4540, -1065, -947, 548,
+			494, -1122, -775, 5203, 9272, 4762, -975, -1007, 532,
+			515, -1065, -879, 4983, 9277, 4982, -879, -1065, 515,
+		}
+	},
+	{
+		9, 0x50000000,
+		{
+			474, -1563, 616, 8548, 8548, 616, -1562, 474, 233,
+			506, -1509, 413, 8336, 8724, 824, -1608, 438, 260,
+			534, -1451, 221, 8115, 8890, 1038, -1648, 398, 287,
+			558, -1390, 36, 7888, 9045, 1259, -1681, 355, 314,
+			579, -1325, -139, 7654, 9190, 1486, -1711, 309, 341,
+			597, -1258, -306, 7414, 9325, 1719, -1734, 260, 367,
+			612, -1189, -463, 7168, 9449, 1957, -1752, 209, 393,
+			624, -1117, -612, 6918, 9561, 2200, -1763, 154, 419,
+			632, -1044, -751, 6664, 9662, 2447, -1767, 97, 444,
+			637, -970, -880, 6406, 9752, 2699, -1765, 37, 468,
+			640, -894, -1001, 6144, 9830, 2954, -1754, -26, 491,
+			640, -819, -1112, 5880, 9896, 3213, -1737, -90, 513,
+			637, -743, -1214, 5614, 9951, 3474, -1712, -157, 534,
+			632, -667, -1307, 5347, 9993, 3738, -1679, -226, 553,
+			624, -591, -1391, 5078, 10023, 4004, -1638, -296, 571,
+			614, -516, -1465, 4809, 10041, 4272, -1590, -368, 587,
+			601, -441, -1532, 4540, 10048, 4540, -1532, -441, 601,
+		}
+	},
+	{
+		9, 0x55555555,
+		{
+			673, -1320, 0, 8839, 8839, 0, -1320, 673, 0,
+			680, -1240, -197, 8591, 9052, 208, -1392, 659, 23,
+			684, -1156, -383, 8334, 9254, 425, -1463, 642, 47,
+			685, -1073, -558, 8069, 9445, 651, -1530, 622, 73,
+			682, -988, -722, 7797, 9623, 886, -1590, 597, 99,
+			676, -901, -875, 7519, 9789, 1129, -1648, 568, 127,
+			668, -815, -1016, 7234, 9941, 1380, -1698, 535, 155,
+			656, -728, -1147, 6944, 10081, 1639, -1744, 499, 184,
+			642, -641, -1265, 6650, 10206, 1904, -1784, 458, 214,
+			625, -555, -1374, 6352, 10318, 2177, -1817, 414, 244,
+			606, -470, -1470, 6050, 10415, 2455, -1842, 365, 275,
+			585, -387, -1555, 5747, 10497, 2739, -1861, 313, 306,
+			562, -305, -1630, 5442, 10565, 3027, -1870, 257, 336,
+			538, -225, -1695, 5136, 10618, 3320, -1873, 198, 367,
+			512, -148, -1749, 4830, 10656, 3617, -1866, 135, 397,
+			485, -73, -1793, 4524, 10679, 3917, -1851, 69, 427,
+			456, 0, -1827, 4220, 10686, 4220, -1827, 0, 456,
+		}
+	},
+	{
+		9, 0x60000000,
+		{
+			582, -534, -1150, 9388, 9388, -1150, -533, 582, -189,
+			547, -428, -1316, 9066, 9701, -968, -642, 615, -191,
+			511, -323, -1467, 8732, 10000, -771, -750, 645, -193,
+			473, -223, -1602, 8388, 10284, -557, -861, 674, -192,
+			435, -125, -1720, 8033, 10551, -328, -971, 699, -190,
+			396, -31, -1823, 7669, 10802, -84, -1081, 722, -186,
+			356, 60, -1911, 7298, 11034, 175, -1188, 740, -180,
+			317, 145, -1984, 6921, 11247, 448, -1294, 755, -171,
+			278, 225, -2042, 6539, 11440, 736, -1397, 766, -161,
+			239, 301, -2085, 6153, 11612, 1037, -1497, 773, -149,
+			201, 372, -2115, 5764, 11763, 1350, -1592, 775, -134,
+			164, 437, -2131, 5374, 11892, 1676, -1683, 772, -117,
+			128, 496, -2134, 4985, 11998, 2012, -1767, 764, -98,
+			93, 550, -2124, 4596, 12081, 2359, -1844, 750, -77,
+			60, 598, -2103, 4210, 12140, 2715, -1913, 731, -54,
+			29, 640, -2071, 3828, 12176, 3079, -1976, 707, -28,
+			0, 676, -2028, 3450, 12188, 3450, -2028, 676, 0,
+		}
+	},
+	{
+		9, 0x66666666,
+		{
+			319, 0, -1739, 9672, 9672, -1739, 0, 319, -120,
+			275, 100, -1871, 9294, 10049, -1589, -106, 364, -132,
+			231, 196, -1984, 8902, 10411, -1421, -216, 409, -144,
+			188, 285, -2078, 8498, 10756, -1233, -332, 455, -155,
+			147, 368, -2155, 8084, 11082, -1025, -451, 499, -165,
+			107, 445, -2214, 7660, 11388, -797, -573, 543, -175,
+			69, 515, -2255, 7229, 11672, -550, -697, 585, -184,
+			33, 578, -2280, 6792, 11934, -284, -822, 625, -192,
+			0, 635, -2290, 6351, 12171, 1, -949, 663, -198,
+			-32, 684, -2283, 5907, 12384, 304, -1075, 698, -203,
+			-61, 726, -2261, 5462, 12570, 624, -1201, 731, -206,
+			-87, 760, -2225, 5018, 12729, 961, -1324, 759, -207,
+			-111, 788, -2178, 4576, 12860, 1315, -1444, 784, -206,
+			-132, 809, -2118, 4139, 12963, 1683, -1561, 804, -203,
+			-151, 824, -2047, 3707, 13037, 2065, -1672, 819, -198,
+			-167, 831, -1965, 3282, 13081, 2460, -1777, 829, -190,
+			-180, 833, -1875, 2866, 13096, 2866, -1875, 833, -180,
+		}
+	},
+	{
+		9, 0x80000000,
+		{
+			-207, 979, -2720, 10140, 10140, -2720, 979, -207, 0,
+			-191, 940, -2623, 9466, 10798, -2793, 1010, -223, 0,
+			-173, 894, -2505, 8780, 11436, -2842, 1030, -236, 0,
+			-154, 841, -2370, 8086, 12051, -2863, 1039, -246, 0,
+			-136, 783, -2218, 7388, 12637, -2855, 1039, -254, 0,
+			-117, 720, -2053, 6690, 13193, -2816, 1025, -258, 0,
+			-99, 654, -1877, 5995, 13714, -2744, 1000, -259, 0,
+			-82, 585, -1692, 5308, 14196, -2637, 961, -255, 0,
+			-66, 515, -1501, 4632, 14638, -2495, 908, -247, 0,
+			-51, 444, -1306, 3970, 15035, -2316, 842, -234, 0,
+			-38, 374, -1109, 3327, 15385, -2099, 761, -217, 0,
+			-26, 304, -913, 2704, 15685, -1844, 668, -194, 0,
+			-17, 238, -719, 2105, 15934, -1551, 560, -166, 0,
+			-10, 172, -528, 1533, 16130, -1219, 438, -132, 0,
+			-5, 111, -344, 990, 16271, -850, 304, -93, 0,
+			-2, 53, -167, 479, 16356, -443, 157, -49, 0,
+			0, 0, 0, 0, 16384, 0, 0, 0, 0,
+		}
+	},
+};
+
+#endif
@@ -40,6 +40,379 @@ GCDBG_FILTERDEF(map, GCZONE_NONE,
 		"mapping")
 
 
+/*******************************************************************************
+ * Mapping cache.
+ *
+ * All bvbuffmap records of the same buffer share one GC MMU mapping, and the
+ * mapping outlives the last of them on an LRU list, so that clients passing
+ * new descriptors for the same buffers every frame do not map and unmap
+ * them every time. Buffers given as page arrays are identified by their
+ * pages. Virtual buffers can only be identified by address and size, which
+ * a freed and reallocated buffer may share, so they are cached only when
+ * mapcachevirtual is set; a client turning it on has to call bv_unmap()
+ * with a descriptor of a virtual buffer before freeing it.
+ *
+ * Idle entries may still be used by asynchronous batches the GPU has not
+ * executed yet, so unmapping one outside of a batch waits for a callback
+ * armed behind the work committed so far.
+ *
+ * Everything here is called with the mapping list locked.
+ */
+
+static unsigned int get_pagecount(struct gcimap *gcimap)
+{
+	if (gcimap->pagearray == NULL)
+		return 0;
+
+	return (gcimap->buf.offset + gcimap->size + gcimap->pagesize - 1)
+	     / gcimap->pagesize;
+}
+
+static unsigned int get_maphash(struct gcimap *gcimap,
+				unsigned int pagecount)
+{
+	unsigned long hash;
+	unsigned int i;
+
+	if (gcimap->pagearray == NULL) {
+		hash = (unsigned long) gcimap->buf.logical >> 12;
+	} else {
+		hash = gcimap->buf.offset;
+		for (i = 0; i < pagecount; i += 1)
+			hash = hash * 31 + (gcimap->pagearray[i] >> 12);
+	}
+
+	hash ^= gcimap->size;
+	hash ^= hash >> 16;
+	hash ^= hash >> 8;
+
+	return hash % GC_MAP_CACHE_HASH;
+}
+
+static struct gcmapentry *find_mapentry(struct gcimap *gcimap,
+					unsigned int pagecount,
+					unsigned int hash)
+{
+	struct gccontext *gccontext = get_context();
+	struct list_head *head;
+	struct gcmapentry *entry;
+
+	list_for_each(head, &gccontext->mapcache[hash]) {
+		entry = list_entry(head, struct gcmapentry, link);
+
+		if ((entry->gcimap.size != gcimap->size) ||
+		    (entry->pagecount != pagecount))
+			continue;
+
+		if (pagecount == 0) {
+			if (entry->gcimap.buf.logical == gcimap->buf.logical)
+				return entry;
+		} else if ((entry->gcimap.buf.offset == gcimap->buf.offset) &&
+			   (entry->gcimap.pagesize == gcimap->pagesize) &&
+			   (memcmp(entry->gcimap.pagearray, gcimap->pagearray,
+				   pagecount * sizeof(unsigned long)) == 0)) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static void unmap_handle(unsigned long handle)
+{
+	struct gcimap gcimap;
+
+	memset(&gcimap, 0, sizeof(gcimap));
+	gcimap.handle = handle;
+	gc_unmap_wrapper(&gcimap);
+	if (gcimap.gcerror != GCERR_NONE)
+		GCERR("failed to unmap handle 0x%08X.\n",
+		      (unsigned int) handle);
+}
+
+static void callbackunmap(void *callbackparam)
+{
+	unmap_handle((unsigned long) callbackparam);
+}
+
+/* Unmaps the handle once the batches committed so far have executed. */
+static void defer_unmap(unsigned long handle)
+{
+	struct gcicallbackarm gcicallbackarm;
+
+	gcicallbackarm.callback = callbackunmap;
+	gcicallbackarm.callbackparam = (void *) handle;
+	gc_callback_wrapper(&gcicallbackarm);
+
+	if (gcicallbackarm.gcerror != GCERR_NONE) {
+		GCDBG(GCZONE_MAPPING, "no callback, unmapping now.\n");
+		unmap_handle(handle);
+	}
+}
+
+/* Unmaps an idle entry; with a batch, the unmapping is scheduled to happen
+ * once the batch is done with the buffers it uses. */
+static void free_mapentry(struct gcmapentry *entry, struct gcbatch *batch)
+{
+	struct gccontext *gccontext = get_context();
+	struct gcschedunmap *gcschedunmap = NULL;
+
+	GCDBG(GCZONE_MAPPING, "unmapping handle 0x%08X, %d bytes.\n",
+	      (unsigned int) entry->gcimap.handle, entry->gcimap.size);
+
+	if (batch != NULL) {
+		if (!list_empty(&gccontext->unmapvac)) {
+			gcschedunmap = list_entry(gccontext->unmapvac.next,
+						  struct gcschedunmap, link);
+			list_move(&gcschedunmap->link, &batch->unmap);
+		} else {
+			gcschedunmap = gcalloc(struct gcschedunmap,
+					       sizeof(struct gcschedunmap));
+			if (gcschedunmap != NULL)
+				list_add(&gcschedunmap->link, &batch->unmap);
+		}
+	}
+
+	if (gcschedunmap != NULL)
+		gcschedunmap->handle = entry->gcimap.handle;
+	else
+		defer_unmap(entry->gcimap.handle);
+
+	if (!entry->stale)
+		list_del(&entry->link);
+
+	gcfree(entry);
+}
+
+/* Unmaps the least recently used idle entries over the budget. */
+static void trim_mapcache(struct gcbatch *batch)
+{
+	struct gccontext *gccontext = get_context();
+	struct gcmapentry *entry;
+
+	while (gccontext->mapcachesize > gccontext->mapcachebudget) {
+		entry = list_entry(gccontext->maplru.prev,
+				   struct gcmapentry, lrulink);
+
+		list_del(&entry->lrulink);
+		gccontext->mapcachesize -= entry->gcimap.size;
+
+		free_mapentry(entry, batch);
+	}
+}
+
+static void put_mapentry(struct gcmapentry *entry, struct gcbatch *batch)
+{
+	struct gccontext *gccontext = get_context();
+
+	entry->refcount -= 1;
+	if (entry->refcount > 0)
+		return;
+
+	if (entry->stale) {
+		free_mapentry(entry, batch);
+		return;
+	}
+
+	GCDBG(GCZONE_MAPPING, "handle 0x%08X is idle.\n",
+	      (unsigned int) entry->gcimap.handle);
+
+	list_add(&entry->lrulink, &gccontext->maplru);
+	gccontext->mapcachesize += entry->gcimap.size;
+}
+
+static void invalidate_mapentry(struct gcmapentry *entry)
+{
+	struct gccontext *gccontext = get_context();
+
+	if (entry->stale)
+		return;
+
+	GCDBG(GCZONE_MAPPING, "invalidating handle 0x%08X.\n",
+	      (unsigned int) entry->gcimap.handle);
+
+	if (entry->refcount == 0) {
+		list_del(&entry->lrulink);
+		gccontext->mapcachesize -= entry->gcimap.size;
+		free_mapentry(entry, NULL);
+	} else {
+		list_del(&entry->link);
+		entry->stale = true;
+	}
+}
+
+/* Describes the buffer for GCIOCTL_MAP. */
+static enum bverror get_mapinfo(struct bvbuffdesc *bvbuffdesc,
+				struct gcimap *gcimap)
+{
+	enum bverror bverror = BVERR_NONE;
+	struct bvphysdesc *bvphysdesc;
+
+	gcimap->gcerror = GCERR_NONE;
+	gcimap->handle = 0;
+
+	if (bvbuffdesc->auxtype == BVAT_PHYSDESC) {
+		bvphysdesc = (struct bvphysdesc *) bvbuffdesc->auxptr;
+
+		if (bvphysdesc->structsize <
+		    STRUCTSIZE(bvphysdesc, pageoffset)) {
+			BVSETERROR(BVERR_BUFFERDESC_VERS,
+				   "unsupported bvphysdesc version");
+			goto exit;
+		}
+
+		if ((bvphysdesc->pagearray == NULL) ||
+		    (bvphysdesc->pagesize == 0)) {
+			BVSETERROR(BVERR_BUFFERDESC,
+				   "invalid bvphysdesc page array");
+			goto exit;
+		}
+
+		gcimap->buf.offset = bvphysdesc->pageoffset;
+		gcimap->pagesize = bvphysdesc->pagesize;
+		gcimap->pagearray = bvphysdesc->pagearray;
+		gcimap->size = bvbuffdesc->length;
+
+		GCDBG(GCZONE_MAPPING, "pagesize = %lu\n",
+		      bvphysdesc->pagesize);
+		GCDBG(GCZONE_MAPPING, "pagearray = 0x%08X\n",
+		      (unsigned int) bvphysdesc->pagearray);
+		GCDBG(GCZONE_MAPPING, "pageoffset = %lu\n",
+		      bvphysdesc->pageoffset);
+	} else {
+		gcimap->buf.logical = bvbuffdesc->virtaddr;
+		gcimap->pagesize = 0;
+		gcimap->pagearray = NULL;
+		gcimap->size = bvbuffdesc->length;
+
+		GCDBG(GCZONE_MAPPING, "specified virtaddr = 0x%08X\n",
+		      (unsigned int) bvbuffdesc->virtaddr);
+		GCDBG(GCZONE_MAPPING, "aligned virtaddr = 0x%08X\n",
+		      (unsigned int) gcimap->buf.logical);
+	}
+
+	GCDBG(GCZONE_MAPPING, "mapping size = %d\n", gcimap->size);
+
+exit:
+	return bverror;
+}
+
+/* Returns the cache entry of the buffer, mapping it if needed. */
+static enum bverror get_mapentry(struct bvbuffdesc *bvbuffdesc,
+				 struct gcmapentry **mapentry)
+{
+	enum bverror bverror;
+	struct gccontext *gccontext = get_context();
+	struct gcmapentry *entry;
+	struct gcimap gcimap;
+	unsigned int pagecount, hash;
+	bool cached;
+
+	bverror = get_mapinfo(bvbuffdesc, &gcimap);
+	if (bverror != BVERR_NONE)
+		goto exit;
+
+	pagecount = get_pagecount(&gcimap);
+	hash = get_maphash(&gcimap, pagecount);
+	cached = (pagecount != 0) || gccontext->mapcachevirtual;
+
+	entry = cached ? find_mapentry(&gcimap, pagecount, hash) : NULL;
+	if (entry != NULL) {
+		GCDBG(GCZONE_MAPPING, "cached handle 0x%08X.\n",
+		      (unsigned int) entry->gcimap.handle);
+
+		if (entry->refcount == 0) {
+			list_del(&entry->lrulink);
+			gccontext->mapcachesize -= entry->gcimap.size;
+		}
+
+		entry->refcount += 1;
+		*mapentry = entry;
+		goto exit;
+	}
+
+	entry = gcalloc(struct gcmapentry, sizeof(struct gcmapentry)
+		      + pagecount * sizeof(unsigned long));
+	if (entry == NULL) {
+		BVSETERROR(BVERR_OOM, "failed to allocate mapping cache entry");
+		goto exit;
+	}
+
+	gc_map_wrapper(&gcimap);
+	if (gcimap.gcerror != GCERR_NONE) {
+		gcfree(entry);
+		BVSETERROR(BVERR_OOM, "unable to allocate gccore memory");
+		goto exit;
+	}
+
+	/* Keep a copy of the page array to identify the buffer by. */
+	entry->gcimap = gcimap;
+	if (pagecount != 0) {
+		entry->gcimap.pagearray = (unsigned long *) (entry + 1);
+		memcpy(entry->gcimap.pagearray, gcimap.pagearray,
+		       pagecount * sizeof(unsigned long));
+	}
+
+	entry->pagecount = pagecount;
+	entry->refcount = 1;
+
+	/* An entry left out of the cache is unmapped once unused. */
+	entry->stale = !cached;
+	if (cached)
+		list_add(&entry->link, &gccontext->mapcache[hash]);
+
+	*mapentry = entry;
+
+exit:
+	return bverror;
+}
+
+void release_mapping(struct bvbuffmapinfo *bvbuffmapinfo)
+{
+	/* The client may free the buffer after an explicit unmap. */
+	invalidate_mapentry(bvbuffmapinfo->entry);
+	put_mapentry(bvbuffmapinfo->entry, NULL);
+	bvbuffmapinfo->entry = NULL;
+}
+
+void invalidate_mapping(struct bvbuffdesc *bvbuffdesc)
+{
+	struct gcmapentry *entry;
+	struct gcimap gcimap;
+	unsigned int pagecount, hash;
+
+	if (get_mapinfo(bvbuffdesc, &gcimap) != BVERR_NONE)
+		return;
+
+	pagecount = get_pagecount(&gcimap);
+	hash = get_maphash(&gcimap, pagecount);
+
+	entry = find_mapentry(&gcimap, pagecount, hash);
+	if (entry != NULL)
+		invalidate_mapentry(entry);
+}
+
+void free_mapcache(void)
+{
+	struct gccontext *gccontext = get_context();
+	struct gcmapentry *entry;
+
+	GCLOCK(&gccontext->maplock);
+
+	while (!list_empty(&gccontext->maplru)) {
+		entry = list_entry(gccontext->maplru.next,
+				   struct gcmapentry, lrulink);
+
+		list_del(&entry->lrulink);
+		gccontext->mapcachesize -= entry->gcimap.size;
+
+		free_mapentry(entry, NULL);
+	}
+
+	GCUNLOCK(&gccontext->maplock);
+}
+
+
 /*******************************************************************************
  * Memory management.
  */
@@ -56,13 +429,13 @@ enum bverror do_map(struct bvbuffdesc *bvbuffdesc,
 	struct gccontext *gccontext = get_context();
 	struct bvbuffmap *bvbuffmap;
 	struct bvbuffmapinfo *bvbuffmapinfo;
-	struct bvphysdesc *bvphysdesc;
+	struct gcmapentry *mapentry;
 	bool mappedbyothers;
-	struct gcimap gcimap;
 	struct gcschedunmap *gcschedunmap;
 
 	GCENTERARG(GCZONE_MAPPING, "bvbuffdesc = 0x%08X\n",
 		   (unsigned int) bvbuffdesc);
+	GCPROF_PUSH(GCPROF_MAP);
 
 	/* Lock access to the mapping list. */
 	GCLOCK(&gccontext->maplock);
@@ -94,64 +467,18 @@ enum bverror do_map(struct bvbuffdesc *bvbuffdesc,
 			gccontext->buffmapvac = bvbuffmap->nextmap;
 		}
 
-		/* Setup buffer mapping. Here we need to check and make sure
-		 * that the buffer starts at a location that is supported by
-		 * the hw. If it is not, offset is computed and the buffer is
-		 * extended by the value of the offset. */
-		gcimap.gcerror = GCERR_NONE;
-		gcimap.handle = 0;
-
-		if (bvbuffdesc->auxtype == BVAT_PHYSDESC) {
-			bvphysdesc = (struct bvphysdesc *) bvbuffdesc->auxptr;
+		GCDBG(GCZONE_MAPPING, "new mapping (%s):\n",
+		      (batch == NULL) ? "explicit" : "implicit");
 
-			if (bvphysdesc->structsize <
-			    STRUCTSIZE(bvphysdesc, pageoffset)) {
-				BVSETERROR(BVERR_BUFFERDESC_VERS,
-					   "unsupported bvphysdesc version");
-				goto fail;
-			}
-
-			gcimap.buf.offset = bvphysdesc->pageoffset;
-			gcimap.pagesize = bvphysdesc->pagesize;
-			gcimap.pagearray = bvphysdesc->pagearray;
-			gcimap.size = bvbuffdesc->length;
-
-			GCDBG(GCZONE_MAPPING, "new mapping (%s):\n",
-			      (batch == NULL) ? "explicit" : "implicit");
-			GCDBG(GCZONE_MAPPING, "pagesize = %lu\n",
-			      bvphysdesc->pagesize);
-			GCDBG(GCZONE_MAPPING, "pagearray = 0x%08X\n",
-			      (unsigned int) bvphysdesc->pagearray);
-			GCDBG(GCZONE_MAPPING, "pageoffset = %lu\n",
-			      bvphysdesc->pageoffset);
-			GCDBG(GCZONE_MAPPING, "mapping size = %d\n",
-			      gcimap.size);
-		} else {
-			gcimap.buf.logical = bvbuffdesc->virtaddr;
-			gcimap.pagesize = 0;
-			gcimap.pagearray = NULL;
-			gcimap.size = bvbuffdesc->length;
-
-			GCDBG(GCZONE_MAPPING, "new mapping (%s):\n",
-			      (batch == NULL) ? "explicit" : "implicit");
-			GCDBG(GCZONE_MAPPING, "specified virtaddr = 0x%08X\n",
-			      (unsigned int) bvbuffdesc->virtaddr);
-			GCDBG(GCZONE_MAPPING, "aligned virtaddr = 0x%08X\n",
-			      (unsigned int) gcimap.buf.logical);
-			GCDBG(GCZONE_MAPPING, "mapping size = %d\n",
-			      gcimap.size);
-		}
-
-		gc_map_wrapper(&gcimap);
-		if (gcimap.gcerror != GCERR_NONE) {
-			BVSETERROR(BVERR_OOM,
-				   "unable to allocate gccore memory");
+		/* Get the shared mapping of the buffer. */
+		bverror = get_mapentry(bvbuffdesc, &mapentry);
+		if (bverror != BVERR_NONE)
 			goto fail;
-		}
 
 		/* Set map handle. */
 		bvbuffmapinfo = (struct bvbuffmapinfo *) bvbuffmap->handle;
-		bvbuffmapinfo->handle = gcimap.handle;
+		bvbuffmapinfo->handle = mapentry->gcimap.handle;
+		bvbuffmapinfo->entry = mapentry;
 
 		/* Initialize reference counters. */
 		if (batch == NULL) {
@@ -229,6 +556,7 @@ enum bverror do_map(struct bvbuffdesc *bvbuffdesc,
 	/* Unlock access to the mapping list. */
 	GCUNLOCK(&gccontext->maplock);
 
+	GCPROF_POP();
 	GCEXITARG(GCZONE_MAPPING, "handle = 0x%08X\n",
 		  bvbuffmapinfo->handle);
 	return BVERR_NONE;
@@ -242,6 +570,7 @@ fail:
 	/* Unlock access to the mapping list. */
 	GCUNLOCK(&gccontext->maplock);
 
+	GCPROF_POP();
 	GCEXITARG(GCZONE_MAPPING, "bverror = %d\n", bverror);
 	return bverror;
 }
@@ -319,10 +648,7 @@ void do_unmap_implicit(struct gcbatch *batch)
 			continue;
 		}
 
-		GCDBG(GCZONE_MAPPING, "  ready for unmapping.\n");
-
-		/* Set the handle. */
-		gcschedunmap->handle = bvbuffmapinfo->handle;
+		GCDBG(GCZONE_MAPPING, "  releasing the mapping.\n");
 
 		/* Remove from the buffer descriptor. */
 		if (prev == NULL)
@@ -333,8 +659,16 @@ void do_unmap_implicit(struct gcbatch *batch)
 		/* Add to the vacant list. */
 		bvbuffmap->nextmap = gccontext->buffmapvac;
 		gccontext->buffmapvac = bvbuffmap;
+
+		/* The mapping stays cached; the batch only unmaps what gets
+		 * evicted. */
+		list_move(head, &gccontext->unmapvac);
+		put_mapentry(bvbuffmapinfo->entry, batch);
+		bvbuffmapinfo->entry = NULL;
 	}
 
+	trim_mapcache(batch);
+
 	/* Unlock access to the mapping list. */
 	GCUNLOCK(&gccontext->maplock);
 
@@ -170,17 +170,14 @@ static const unsigned int container[] = {
 	 64	/* OCDFMTDEF_CONTAINER_64BIT */
 };
 
-enum bverror parse_format(struct bvbltparams *bvbltparams,
-			  struct surfaceinfo *surfaceinfo)
+static enum bverror decode_format(struct bvbltparams *bvbltparams,
+				  enum ocdformat ocdformat,
+				  struct bvformatxlate *format)
 {
 	enum bverror bverror = BVERR_NONE;
-	struct bvformatxlate *format;
-	enum ocdformat ocdformat;
 	unsigned int cs, std, alpha, subsample, layout;
 	unsigned int reversed, leftjust, swizzle, cont, bits;
 
-	format = &surfaceinfo->format;
-	ocdformat = surfaceinfo->geom->format;
 	GCENTERARG(GCZONE_FORMAT, "ocdformat = 0x%08X\n", ocdformat);
 
 	cs = (ocdformat & OCDFMTDEF_CS_MASK)
@@ -494,6 +491,136 @@ exit:
 }
 
 
+/*******************************************************************************
+ * Pixel format table.
+ *
+ * The formats below are decoded once by init_parser into a table sorted by
+ * ocdformat value; parse_format looks them up and only decodes formats not
+ * in the table, which is also how unsupported formats get reported.
+ */
+
+static const enum ocdformat gcformats[] = {
+	/* RGB without alpha. */
+	OCDFMT_RGB12, OCDFMT_xRGB12, OCDFMT_1RGB12,
+	OCDFMT_BGR12, OCDFMT_xBGR12, OCDFMT_1BGR12,
+	OCDFMT_RGBx12, OCDFMT_RGB112,
+	OCDFMT_BGRx12, OCDFMT_BGR112,
+	OCDFMT_RGB15, OCDFMT_xRGB15, OCDFMT_1RGB15,
+	OCDFMT_BGR15, OCDFMT_xBGR15, OCDFMT_1BGR15,
+	OCDFMT_RGBx15, OCDFMT_RGB115,
+	OCDFMT_BGRx15, OCDFMT_BGR115,
+	OCDFMT_RGB16, OCDFMT_BGR16,
+	OCDFMT_xRGB24, OCDFMT_1RGB24,
+	OCDFMT_xBGR24, OCDFMT_1BGR24,
+	OCDFMT_RGBx24, OCDFMT_RGB124,
+	OCDFMT_BGRx24, OCDFMT_BGR124,
+
+	/* RGB with premultiplied alpha. */
+	OCDFMT_ARGB12, OCDFMT_ABGR12, OCDFMT_RGBA12, OCDFMT_BGRA12,
+	OCDFMT_ARGB15, OCDFMT_ABGR15, OCDFMT_RGBA15, OCDFMT_BGRA15,
+	OCDFMT_ARGB24, OCDFMT_ABGR24, OCDFMT_RGBA24, OCDFMT_BGRA24,
+
+	/* RGB with non-premultiplied alpha. */
+	OCDFMT_nARGB12, OCDFMT_nABGR12, OCDFMT_nRGBA12, OCDFMT_nBGRA12,
+	OCDFMT_nARGB15, OCDFMT_nABGR15, OCDFMT_nRGBA15, OCDFMT_nBGRA15,
+	OCDFMT_nARGB24, OCDFMT_nABGR24, OCDFMT_nRGBA24, OCDFMT_nBGRA24,
+
+	/* YUV. */
+	OCDFMT_UYVY, OCDFMT_UYVY_601, OCDFMT_UYVY_709,
+	OCDFMT_VYUY, OCDFMT_VYUY_601, OCDFMT_VYUY_709,
+	OCDFMT_YUYV, OCDFMT_YUYV_601, OCDFMT_YUYV_709,
+	OCDFMT_YVYU, OCDFMT_YVYU_601, OCDFMT_YVYU_709,
+	OCDFMT_IYUV, OCDFMT_IYUV_601, OCDFMT_IYUV_709,
+	OCDFMT_YV12, OCDFMT_YV12_601, OCDFMT_YV12_709,
+	OCDFMT_NV12, OCDFMT_NV12_601, OCDFMT_NV12_709,
+	OCDFMT_NV21, OCDFMT_NV21_601, OCDFMT_NV21_709
+};
+
+struct gcformatentry {
+	enum ocdformat ocdformat;
+	struct bvformatxlate format;
+};
+
+/* Read only once init_parser returns. */
+static struct gcformatentry gcformattable[countof(gcformats)];
+static unsigned int gcformatcount;
+
+static const struct bvformatxlate *find_format(enum ocdformat ocdformat)
+{
+	const struct gcformatentry *entry;
+	int low, high, middle;
+
+	low = 0;
+	high = gcformatcount - 1;
+
+	while (low <= high) {
+		middle = (low + high) / 2;
+		entry = &gcformattable[middle];
+
+		if (entry->ocdformat < ocdformat)
+			low = middle + 1;
+		else if (entry->ocdformat > ocdformat)
+			high = middle - 1;
+		else
+			return &entry->format;
+	}
+
+	return NULL;
+}
+
+void init_parser(void)
+{
+	struct bvbltparams bvbltparams;
+	struct bvformatxlate format;
+	enum ocdformat ocdformat;
+	unsigned int i, j;
+
+	memset(&bvbltparams, 0, sizeof(bvbltparams));
+	gcformatcount = 0;
+
+	for (i = 0; i < countof(gcformats); i += 1) {
+		ocdformat = gcformats[i];
+
+		if (decode_format(&bvbltparams, ocdformat, &format)
+				!= BVERR_NONE) {
+			GCERR("failed to decode format 0x%08X\n", ocdformat);
+			continue;
+		}
+
+		/* Aliases share the entry. */
+		if (find_format(ocdformat) != NULL)
+			continue;
+
+		/* Keep the table sorted. */
+		for (j = gcformatcount; j > 0; j -= 1) {
+			if (gcformattable[j - 1].ocdformat < ocdformat)
+				break;
+
+			gcformattable[j] = gcformattable[j - 1];
+		}
+
+		gcformattable[j].ocdformat = ocdformat;
+		gcformattable[j].format = format;
+		gcformatcount += 1;
+	}
+
+	GCDBG(GCZONE_FORMAT, "%d formats in the table.\n", gcformatcount);
+}
+
+enum bverror parse_format(struct bvbltparams *bvbltparams,
+			  struct surfaceinfo *surfaceinfo)
+{
+	const struct bvformatxlate *format;
+
+	format = find_format(surfaceinfo->geom->format);
+	if (format == NULL)
+		return decode_format(bvbltparams, surfaceinfo->geom->format,
+				     &surfaceinfo->format);
+
+	surfaceinfo->format = *format;
+	return BVERR_NONE;
+}
+
 /*******************************************************************************
  * Alpha blending parser.
  */
@@ -1387,6 +1514,7 @@ enum bverror parse_destination(struct bvbltparams *bvbltparams,
 	enum bverror bverror = BVERR_NONE;
 
 	GCENTER(GCZONE_DEST);
+	GCPROF_PUSH(GCPROF_PARSE);
 
 	GCDBG(GCZONE_DEST, "parsing destination\n");
 
@@ -1644,6 +1772,7 @@ enum bverror parse_destination(struct bvbltparams *bvbltparams,
 	}
 
 exit:
+	GCPROF_POP();
 	GCEXITARG(GCZONE_DEST, "bv%s = %d\n",
 		  (bverror == BVERR_NONE) ? "result" : "error", bverror);
 	return bverror;
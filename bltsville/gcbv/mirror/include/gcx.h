@@ -74,14 +74,41 @@
 		GCERR("failed to destroy mutex.\n"); \
 	}
 
+#if defined(GCBV_PROFILE) && GCBV_PROFILE
+/* Same as pthread_mutex_lock, also accounts for the time spent waiting. */
+int gcprof_lock(pthread_mutex_t *lock);
+
+#define GCLOCK(lock) \
+	if (gcprof_lock(lock)) { \
+		GCERR("failed to lock mutex.\n"); \
+	}
+#else
 #define GCLOCK(lock) \
 	if (pthread_mutex_lock(lock)) { \
 		GCERR("failed to lock mutex.\n"); \
 	}
+#endif
 
 #define GCUNLOCK(lock) \
 	if (pthread_mutex_unlock(lock)) { \
 		GCERR("failed to unlock mutex.\n"); \
 	}
 
+/* Per-thread data; KEY_INIT evaluates to zero on success and the
+ * destructor runs on exit of each thread that set a value. */
+#define GCTHREAD_KEY_TYPE \
+	pthread_key_t
+
+#define GCTHREAD_KEY_INIT(key, destructor) \
+	pthread_key_create(key, destructor)
+
+#define GCTHREAD_KEY_DESTROY(key) \
+	pthread_key_delete(key)
+
+#define GCTHREAD_GET(key) \
+	pthread_getspecific(key)
+
+#define GCTHREAD_SET(key, value) \
+	pthread_setspecific(key, value)
+
 #endif
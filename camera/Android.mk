@@ -317,3 +317,75 @@ LOCAL_MODULE_TAGS := optional
 include $(BUILD_HEAPTRACKED_SHARED_LIBRARY)
 
 endif
+
+# ====================
+#  JPEG encoder test
+# --------------------
+# Runs on the target, see test/Encoder_libjpeg_test.cpp
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    test/Encoder_libjpeg_test.cpp \
+    Encoder_libjpeg.cpp \
+    NV12_resize.cpp \
+    TICameraParameters.cpp
+
+LOCAL_C_INCLUDES := $(TI_CAMERAHAL_COMMON_INCLUDES)
+
+LOCAL_SHARED_LIBRARIES := $(TI_CAMERAHAL_COMMON_SHARED_LIBRARIES)
+
+LOCAL_CFLAGS := $(TI_CAMERAHAL_COMMON_CFLAGS)
+
+LOCAL_CPPFLAGS := $(TI_CAMERAHAL_COMMON_CPPFLAGS)
+
+LOCAL_MODULE := camera_encoder_test
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_EXECUTABLE)
+
+# ====================
+#  Buffer slot map test
+# --------------------
+# Runs on the target, see test/BufferSlotMap_test.cpp
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    test/BufferSlotMap_test.cpp
+
+LOCAL_C_INCLUDES := $(TI_CAMERAHAL_COMMON_INCLUDES)
+
+LOCAL_SHARED_LIBRARIES := libutils
+
+LOCAL_CFLAGS := $(TI_CAMERAHAL_COMMON_CFLAGS)
+
+LOCAL_CPPFLAGS := $(TI_CAMERAHAL_COMMON_CPPFLAGS)
+
+LOCAL_MODULE := camera_slotmap_test
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_EXECUTABLE)
+
+# ====================
+#  Preview callback ring test
+# --------------------
+# Runs on the target, see test/PreviewCallbackRing_test.cpp
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    test/PreviewCallbackRing_test.cpp
+
+LOCAL_C_INCLUDES := $(TI_CAMERAHAL_COMMON_INCLUDES)
+
+LOCAL_SHARED_LIBRARIES := libcutils
+
+LOCAL_CFLAGS := $(TI_CAMERAHAL_COMMON_CFLAGS)
+
+LOCAL_CPPFLAGS := $(TI_CAMERAHAL_COMMON_CPPFLAGS)
+
+LOCAL_MODULE := camera_callback_ring_test
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_EXECUTABLE)
@@ -38,9 +38,16 @@ void AppCallbackNotifierEncoderCallback(void* main_jpeg,
                                         void* cookie4,
                                         bool canceled)
 {
-    if (cookie1 && !canceled) {
+    if (cookie1) {
         AppCallbackNotifier* cb = (AppCallbackNotifier*) cookie1;
-        cb->EncoderDoneCb(main_jpeg, thumb_jpeg, type, cookie2, cookie3, cookie4);
+
+        // the thumbnail source is let go whether or not the encode finished
+        if (thumb_jpeg) {
+            cb->releaseThumbnailSource(((Encoder_libjpeg::params *) thumb_jpeg)->src);
+        }
+        if (!canceled) {
+            cb->EncoderDoneCb(main_jpeg, thumb_jpeg, type, cookie2, cookie3, cookie4);
+        }
     }
 
     if (main_jpeg) {
@@ -57,10 +64,18 @@ void AppCallbackNotifierEncoderCallback(void* main_jpeg,
 
 /*--------------------NotificationHandler Class STARTS here-----------------------------*/
 
+void AppCallbackNotifier::releaseThumbnailSource(const void *src)
+{
+    android::AutoMutex lock(mLock);
+
+    // thumbnail source was a preview callback slot, let it be reused
+    mPreviewRing.release(previewSlotFor(src));
+}
+
 void AppCallbackNotifier::EncoderDoneCb(void* main_jpeg, void* thumb_jpeg, CameraFrame::FrameType type, void* cookie1, void* cookie2, void *cookie3)
 {
-    camera_memory_t* encoded_mem = NULL;
-    Encoder_libjpeg::params *main_param = NULL, *thumb_param = NULL;
+    JpegBuffer* encoded_mem = NULL;
+    Encoder_libjpeg::params *main_param = NULL;
     size_t jpeg_size;
     uint8_t* src = NULL;
     CameraBuffer *camera_buffer;
@@ -77,40 +92,20 @@ void AppCallbackNotifier::EncoderDoneCb(void* main_jpeg, void* thumb_jpeg, Camer
         goto exit;
     }
 
-    encoded_mem = (camera_memory_t*) cookie1;
+    encoded_mem = (JpegBuffer*) cookie1;
     main_param = (Encoder_libjpeg::params *) main_jpeg;
     jpeg_size = main_param->jpeg_size;
     camera_buffer = (CameraBuffer *)cookie3;
     src = main_param->src;
 
-    if(encoded_mem && encoded_mem->data && (jpeg_size > 0)) {
-        if (cookie2) {
-            ExifElementsTable* exif = (ExifElementsTable*) cookie2;
-            Section_t* exif_section = NULL;
-
-            exif->insertExifToJpeg((unsigned char*) encoded_mem->data, jpeg_size);
-
-            if(thumb_jpeg) {
-                thumb_param = (Encoder_libjpeg::params *) thumb_jpeg;
-                exif->insertExifThumbnailImage((const char*)thumb_param->dst,
-                                               (int)thumb_param->jpeg_size);
-            }
-
-            exif_section = FindSection(M_EXIF);
+    // The encoder wrote the complete file, EXIF included, at the start of the
+    // shared region
+    if(encoded_mem && (jpeg_size > 0)) {
+        picture = encoded_mem->share(mRequestMemory, jpeg_size);
 
-            if (exif_section) {
-                picture = mRequestMemory(-1, jpeg_size + exif_section->Size, 1, NULL);
-                if (picture && picture->data) {
-                    exif->saveJpeg((unsigned char*) picture->data, jpeg_size + exif_section->Size);
-                }
-            }
-            delete exif;
+        if (cookie2) {
+            delete (ExifElementsTable*) cookie2;
             cookie2 = NULL;
-        } else {
-            picture = mRequestMemory(-1, jpeg_size, 1, NULL);
-            if (picture && picture->data) {
-                memcpy(picture->data, encoded_mem->data, jpeg_size);
-            }
         }
     }
     } // scope for mutex lock
@@ -147,9 +142,7 @@ void AppCallbackNotifier::EncoderDoneCb(void* main_jpeg, void* thumb_jpeg, Camer
     }
 
     if (mNotifierState == AppCallbackNotifier::NOTIFIER_STARTED) {
-        if (encoded_mem) {
-            encoded_mem->release(encoded_mem);
-        }
+        delete encoded_mem;
         if (cookie2) {
             delete (ExifElementsTable*) cookie2;
         }
@@ -174,6 +167,8 @@ status_t AppCallbackNotifier::initialize()
     LOG_FUNCTION_NAME;
 
     mPreviewMemory = 0;
+    mPreviewRing.setLatestOnly(false);
+    mPreviewRing.reset(MAX_BUFFERS);
 
     mMeasurementEnabled = false;
 
@@ -245,6 +240,37 @@ void AppCallbackNotifier::setMeasurements(bool enable)
     LOG_FUNCTION_NAME_EXIT;
 }
 
+void AppCallbackNotifier::setPreviewCallbackLatestOnly(bool latestOnly)
+{
+    android::AutoMutex lock(mLock);
+
+    mPreviewRing.setLatestOnly(latestOnly);
+}
+
+bool AppCallbackNotifier::isPreviewCallbackFrame(int frameType)
+{
+    return ( CameraFrame::PREVIEW_FRAME_SYNC == frameType ) ||
+           ( CameraFrame::FRAME_DATA_SYNC == frameType );
+}
+
+int AppCallbackNotifier::previewSlotFor(const void *data) const
+{
+    const uint8_t *base;
+    size_t slotSize;
+
+    if (!mPreviewMemory || !data) {
+        return -1;
+    }
+
+    base = (const uint8_t *) mPreviewMemory->data;
+    slotSize = mPreviewMemory->size / MAX_BUFFERS;
+    if ((data < base) || (data >= (base + mPreviewMemory->size)) || (0 == slotSize)) {
+        return -1;
+    }
+
+    return ((const uint8_t *) data - base) / slotSize;
+}
+
 
 //All sub-components of Camera HAL call this whenever any error happens
 void AppCallbackNotifier::errorNotify(int error)
@@ -845,6 +871,7 @@ void AppCallbackNotifier::copyAndSendPreviewFrame(CameraFrame* frame, int32_t ms
 {
     camera_memory_t* picture = NULL;
     CameraBuffer * dest = NULL;
+    int slot = -1;
 
     // scope for lock
     {
@@ -859,7 +886,14 @@ void AppCallbackNotifier::copyAndSendPreviewFrame(CameraFrame* frame, int32_t ms
             goto exit;
         }
 
-        dest = &mPreviewBuffers[mPreviewBufCount];
+        // With latest-only, a frame the app is too far behind to see is
+        // returned unconverted
+        slot = mPreviewRing.acquire(isPreviewCallbackFrame(frame->mFrameType));
+        if (slot < 0) {
+            goto exit;
+        }
+
+        dest = &mPreviewBuffers[slot];
         if (mExternalLocking) {
             lockBufferAndUpdatePtrs(frame);
         }
@@ -886,6 +920,7 @@ void AppCallbackNotifier::copyAndSendPreviewFrame(CameraFrame* frame, int32_t ms
             } else {
               if ((NULL == frame->mYuv[0]) || (NULL == frame->mYuv[1])){
                 CAMHAL_LOGEA("Error! One of the YUV Pointer is NULL");
+                dest = NULL;
                 goto exit;
               }
               else{
@@ -900,6 +935,7 @@ void AppCallbackNotifier::copyAndSendPreviewFrame(CameraFrame* frame, int32_t ms
                            mPreviewPixelFormat);
               }
             }
+            mPreviewRing.converted(slot);
         }
     }
 
@@ -911,15 +947,19 @@ void AppCallbackNotifier::copyAndSendPreviewFrame(CameraFrame* frame, int32_t ms
        (dest != NULL) && (dest->mapped != NULL)) {
         android::AutoMutex locker(mLock);
         if ( mPreviewMemory )
-            mDataCb(msgType, mPreviewMemory, mPreviewBufCount, NULL, mCallbackCookie);
+            mDataCb(msgType, mPreviewMemory, slot, NULL, mCallbackCookie);
     }
 
-    if (mExternalLocking) {
+    if (mExternalLocking && (slot >= 0)) {
         unlockBufferAndUpdatePtrs(frame);
     }
 
-    // increment for next buffer
-    mPreviewBufCount = (mPreviewBufCount + 1) % AppCallbackNotifier::MAX_BUFFERS;
+    if (slot >= 0) {
+        android::AutoMutex locker(mLock);
+        // the app got its own copy during the callback, the slot only stays
+        // around as the most recent frame for snapshot thumbnails
+        mPreviewRing.release(slot);
+    }
 }
 
 status_t AppCallbackNotifier::dummyRaw()
@@ -977,6 +1017,12 @@ void AppCallbackNotifier::notifyFrame()
         }
     }
 
+    frame = (CameraFrame *) msg.arg1;
+    if ( (AppCallbackNotifier::NOTIFIER_CMD_PROCESS_FRAME == msg.command) &&
+         (NULL != frame) && isPreviewCallbackFrame(frame->mFrameType) ) {
+        mPreviewRing.dequeued();
+    }
+
     bool ret = true;
 
     frame = NULL;
@@ -1027,10 +1073,11 @@ void AppCallbackNotifier::notifyFrame()
                     Encoder_libjpeg::params *main_jpeg = NULL, *tn_jpeg = NULL;
                     void* exif_data = NULL;
                     const char *previewFormat = NULL;
-                    camera_memory_t* raw_picture = mRequestMemory(-1, frame->mLength, 1, NULL);
+                    JpegBuffer* jpeg_buffer = JpegBuffer::allocate(
+                            Encoder_libjpeg::jpegSizeBound(frame->mAlignment/2, frame->mHeight));
 
-                    if(raw_picture) {
-                        buf = raw_picture->data;
+                    if(jpeg_buffer) {
+                        buf = jpeg_buffer->data;
                     }
 
                     android::CameraParameters parameters;
@@ -1066,7 +1113,7 @@ void AppCallbackNotifier::notifyFrame()
                         main_jpeg->src = (uint8_t *)frame->mBuffer->mapped;
                         main_jpeg->src_size = frame->mLength;
                         main_jpeg->dst = (uint8_t*) buf;
-                        main_jpeg->dst_size = frame->mLength;
+                        main_jpeg->dst_size = jpeg_buffer ? jpeg_buffer->size : 0;
                         main_jpeg->quality = encode_quality;
                         main_jpeg->in_width = frame->mAlignment/2; // use stride here
                         main_jpeg->in_height = frame->mHeight;
@@ -1080,6 +1127,7 @@ void AppCallbackNotifier::notifyFrame()
                         else { //if ( CameraFrame::FORMAT_YUV422I_YUYV & frame->mQuirks)
                             main_jpeg->format = android::CameraParameters::PIXEL_FORMAT_YUV422I;
                         }
+                        main_jpeg->exif = (ExifElementsTable*) exif_data;
                     }
 
                     tn_width = parameters.getInt(android::CameraParameters::KEY_JPEG_THUMBNAIL_WIDTH);
@@ -1098,7 +1146,12 @@ void AppCallbackNotifier::notifyFrame()
                     if (tn_jpeg) {
                         int width, height;
                         parameters.getPreviewSize(&width,&height);
-                        current_snapshot = (mPreviewBufCount + MAX_BUFFERS - 1) % MAX_BUFFERS;
+                        {
+                            android::AutoMutex lock(mLock);
+                            // hold the slot until the encode ends, preview
+                            // callbacks must not overwrite the thumbnail source
+                            current_snapshot = mPreviewRing.holdLatest();
+                        }
                         tn_jpeg->src = (uint8_t *)mPreviewBuffers[current_snapshot].mapped;
                         tn_jpeg->src_size = mPreviewMemory->size / MAX_BUFFERS;
                         tn_jpeg->dst_size = CameraHal::calculateBufferSize(previewFormat,
@@ -1113,6 +1166,7 @@ void AppCallbackNotifier::notifyFrame()
                         tn_jpeg->right_crop = 0;
                         tn_jpeg->start_offset = 0;
                         tn_jpeg->format = android::CameraParameters::PIXEL_FORMAT_YUV420SP;;
+                        tn_jpeg->exif = NULL;
                     }
 
                     android::sp<Encoder_libjpeg> encoder = new Encoder_libjpeg(main_jpeg,
@@ -1120,7 +1174,7 @@ void AppCallbackNotifier::notifyFrame()
                                                       AppCallbackNotifierEncoderCallback,
                                                       (CameraFrame::FrameType)frame->mFrameType,
                                                       this,
-                                                      raw_picture,
+                                                      jpeg_buffer,
                                                       exif_data, frame->mBuffer);
                     gEncoderQueue.add(frame->mBuffer->mapped, encoder);
 #ifdef ANDROID_API_N_OR_LATER
@@ -1345,6 +1399,9 @@ void AppCallbackNotifier::frameCallback(CameraFrame* caFrame)
             {
               msg.command = AppCallbackNotifier::NOTIFIER_CMD_PROCESS_FRAME;
               msg.arg1 = frame;
+              if ( isPreviewCallbackFrame(frame->mFrameType) ) {
+                  mPreviewRing.queued();
+              }
               mFrameQ.put(&msg);
             }
         else
@@ -1369,6 +1426,9 @@ void AppCallbackNotifier::flushAndReturnFrames()
         mFrameQ.get(&msg);
         frame = (CameraFrame*) msg.arg1;
         if (frame) {
+            if ( isPreviewCallbackFrame(frame->mFrameType) ) {
+                mPreviewRing.dequeued();
+            }
             mFrameProvider->returnFrame(frame->mBuffer,
                                         (CameraFrame::FrameType) frame->mFrameType);
         }
@@ -1632,6 +1692,7 @@ status_t AppCallbackNotifier::startPreviewCallbacks(android::CameraParameters &p
         mPreviewBuffers[i].opaque = (unsigned char*) mPreviewMemory->data + (i*size);
         mPreviewBuffers[i].mapped = mPreviewBuffers[i].opaque;
     }
+    mPreviewRing.reset(MAX_BUFFERS);
 
     if ( mCameraHal->msgTypeEnabled(CAMERA_MSG_PREVIEW_FRAME ) ) {
          mFrameProvider->enableFrameNotification(CameraFrame::PREVIEW_FRAME_SYNC);
@@ -1641,8 +1702,6 @@ status_t AppCallbackNotifier::startPreviewCallbacks(android::CameraParameters &p
          mFrameProvider->enableFrameNotification(CameraFrame::SNAPSHOT_FRAME);
     }
 
-    mPreviewBufCount = 0;
-
     mPreviewing = true;
 
     LOG_FUNCTION_NAME_EXIT;
@@ -1705,6 +1764,9 @@ status_t AppCallbackNotifier::stopPreviewCallbacks()
 
     {
     android::AutoMutex lock(mLock);
+    CAMHAL_LOGI("Preview callback frames: %u converted, %u skipped, %u dropped",
+                mPreviewRing.convertedFrames(), mPreviewRing.skippedFrames(),
+                mPreviewRing.droppedFrames());
     mPreviewMemory->release(mPreviewMemory);
     mPreviewMemory = 0;
     }
@@ -1987,16 +2049,14 @@ status_t AppCallbackNotifier::stop()
 
     while(!gEncoderQueue.isEmpty()) {
         android::sp<Encoder_libjpeg> encoder = gEncoderQueue.valueAt(0);
-        camera_memory_t* encoded_mem = NULL;
+        JpegBuffer* encoded_mem = NULL;
         ExifElementsTable* exif = NULL;
 
         if(encoder.get()) {
             encoder->cancel();
 
             encoder->getCookies(NULL, (void**) &encoded_mem, (void**) &exif);
-            if (encoded_mem) {
-                encoded_mem->release(encoded_mem);
-            }
+            delete encoded_mem;
             if (exif) {
                 delete exif;
             }
@@ -346,6 +346,46 @@ void BufferSourceAdapter::destroy()
     LOG_FUNCTION_NAME_EXIT;
 }
 
+void BufferSourceAdapter::resetSlots(int count)
+{
+    mSlotOwner.clear();
+    if (count > 0) {
+        mSlotOwner.insertAt(BUFFER_OWNER_WINDOW, 0, count);
+    }
+    mHandleSlots.reset(count);
+}
+
+void BufferSourceAdapter::registerSlot(int slot, BufferOwner owner)
+{
+    mBuffers[slot].index = slot;
+    mSlotOwner.editItemAt(slot) = owner;
+    mHandleSlots.insert(mBuffers[slot].opaque, slot);
+}
+
+int BufferSourceAdapter::findSlot(const buffer_handle_t *handle) const
+{
+    if (NULL == mBuffers) {
+        return -1;
+    }
+
+    return mHandleSlots.find(handle);
+}
+
+int BufferSourceAdapter::findSlot(const CameraBuffer *buffer) const
+{
+    if ((NULL == mBuffers) || (NULL == buffer)) {
+        return -1;
+    }
+
+    // the slot index is only trusted if it points back at the same buffer
+    if ((buffer->index < 0) || (buffer->index >= (int) mSlotOwner.size()) ||
+        (&mBuffers[buffer->index] != buffer)) {
+        return -1;
+    }
+
+    return buffer->index;
+}
+
 CameraBuffer* BufferSourceAdapter::allocateBufferList(int width, int dummyHeight, const char* format,
                                                       int &bytes, int numBufs)
 {
@@ -396,6 +436,7 @@ CameraBuffer* BufferSourceAdapter::allocateBufferList(int width, int dummyHeight
 
     CAMHAL_LOGDB("Configuring %d buffers for ANativeWindow", numBufs);
     mBufferCount = numBufs;
+    resetSlots(mBufferCount);
 
     // re-calculate height depending on stride and size
     int height = getHeightFromFormat(format, width, bytes);
@@ -442,7 +483,7 @@ CameraBuffer* BufferSourceAdapter::allocateBufferList(int width, int dummyHeight
         mBuffers[i].opaque = (void *)handle;
         mBuffers[i].type = CAMERA_BUFFER_ANW;
         mBuffers[i].format = mPixelFormat;
-        mFramesWithCameraAdapterMap.add(handle, i);
+        registerSlot(i, BUFFER_OWNER_CAMERA_ADAPTER);
 
         bytes = CameraHal::calculateBufferSize(format, width, height);
     }
@@ -476,7 +517,7 @@ CameraBuffer* BufferSourceAdapter::allocateBufferList(int width, int dummyHeight
             }
             goto fail;
         }
-        mFramesWithCameraAdapterMap.removeItem((buffer_handle_t *) mBuffers[i].opaque);
+        mSlotOwner.editItemAt(i) = BUFFER_OWNER_WINDOW;
     }
 
     mFrameWidth = width;
@@ -487,14 +528,17 @@ CameraBuffer* BufferSourceAdapter::allocateBufferList(int width, int dummyHeight
 
  fail:
     // need to cancel buffers if any were dequeued
-    for (int start = 0; start < i && i > 0; start++) {
+    for (int start = 0; (start < mBufferCount) && mBufferSource; start++) {
+        if (mSlotOwner[start] != BUFFER_OWNER_CAMERA_ADAPTER) {
+            continue;
+        }
         int err = mBufferSource->cancel_buffer(mBufferSource,
                 (buffer_handle_t *) mBuffers[start].opaque);
         if (err != 0) {
           CAMHAL_LOGEB("cancelBuffer failed w/ error 0x%08x", err);
           break;
         }
-        mFramesWithCameraAdapterMap.removeItem((buffer_handle_t *) mBuffers[start].opaque);
+        mSlotOwner.editItemAt(start) = BUFFER_OWNER_WINDOW;
     }
 
     freeBufferList(mBuffers);
@@ -532,34 +576,34 @@ CameraBuffer *BufferSourceAdapter::getBuffers(bool reset) {
         android::Rect bounds(mFrameWidth, mFrameHeight);
         void *y_uv[2];
         CameraBuffer * newBuffers = NULL;
-        unsigned int index = 0;
-        android::KeyedVector<void*, int> missingIndices;
+        int index = 0;
+        int dequeued = 0;
+        android::Vector<bool> placed;
 
         newBuffers = new CameraBuffer [lnumBufs];
         memset (newBuffers, 0, sizeof(CameraBuffer) * lnumBufs);
-
-        // Use this vector to figure out missing indices
-        for (int i = 0; i < mBufferCount; i++) {
-            missingIndices.add(mBuffers[i].opaque, i);
-        }
+        placed.insertAt(false, 0, lnumBufs);
 
         // assign buffers that we have already dequeued
-        for (index = 0; index < mFramesWithCameraAdapterMap.size(); index++) {
-            int value = mFramesWithCameraAdapterMap.valueAt(index);
-            newBuffers[index].opaque = mBuffers[value].opaque;
-            newBuffers[index].type = mBuffers[value].type;
-            newBuffers[index].format = mBuffers[value].format;
-            newBuffers[index].mapped = mBuffers[value].mapped;
-            mFramesWithCameraAdapterMap.replaceValueAt(index, index);
-            missingIndices.removeItem(newBuffers[index].opaque);
+        for (int slot = 0; slot < mBufferCount; slot++) {
+            if (mSlotOwner[slot] != BUFFER_OWNER_CAMERA_ADAPTER) {
+                continue;
+            }
+            newBuffers[index].opaque = mBuffers[slot].opaque;
+            newBuffers[index].type = mBuffers[slot].type;
+            newBuffers[index].format = mBuffers[slot].format;
+            newBuffers[index].mapped = mBuffers[slot].mapped;
+            placed.editItemAt(slot) = true;
+            index++;
         }
 
         mBufferSource->get_min_undequeued_buffer_count(mBufferSource, &undequeued);
 
         // dequeue the rest of the buffers
-        for (index; index < (unsigned int)(mBufferCount-undequeued); index++) {
+        for (; index < (mBufferCount - undequeued); index++) {
             buffer_handle_t *handle;
             int stride;  // dummy variable to get stride
+            int slot;
 
             err = mBufferSource->dequeue_buffer(mBufferSource, &handle, &stride);
             if (err != 0) {
@@ -568,39 +612,56 @@ CameraBuffer *BufferSourceAdapter::getBuffers(bool reset) {
                     CAMHAL_LOGEA("Preview surface abandoned!");
                     mBufferSource = NULL;
                 }
+                delete [] newBuffers;
                 goto fail;
             }
             newBuffers[index].opaque = (void *)handle;
             newBuffers[index].type = CAMERA_BUFFER_ANW;
             newBuffers[index].format = mPixelFormat;
-            mFramesWithCameraAdapterMap.add(handle, index);
 
             mBufferSource->lock_buffer(mBufferSource, handle);
             mapper.lock(*handle, CAMHAL_GRALLOC_USAGE, bounds, y_uv);
             newBuffers[index].mapped = y_uv[0];
             CAMHAL_LOGDB("got handle %p", handle);
 
-            missingIndices.removeItem(newBuffers[index].opaque);
+            // track ownership in the current list too, so the buffer is
+            // returned to the window should we fail before the swap
+            slot = findSlot(handle);
+            if (slot >= 0) {
+                mSlotOwner.editItemAt(slot) = BUFFER_OWNER_CAMERA_ADAPTER;
+                placed.editItemAt(slot) = true;
+            }
         }
+        dequeued = index;
 
         // now we need to figure out which buffers aren't dequeued
         // which are in mBuffers but not newBuffers yet
-        if ((mBufferCount - index) != missingIndices.size()) {
+        for (int slot = 0; (slot < mBufferCount) && (index < lnumBufs); slot++) {
+            if (placed[slot]) {
+                continue;
+            }
+
+            CAMHAL_LOGD("Filling at %d", slot);
+            newBuffers[index].opaque = mBuffers[slot].opaque;
+            newBuffers[index].type = mBuffers[slot].type;
+            newBuffers[index].format = mBuffers[slot].format;
+            newBuffers[index].mapped = mBuffers[slot].mapped;
+            index++;
+        }
+
+        if (index != lnumBufs) {
             CAMHAL_LOGD("Hrmm somethings gone awry. We are missing a different number"
                         " of buffers than we can fill");
         }
-        for (unsigned int i = 0; i < missingIndices.size(); i++) {
-            int j = missingIndices.valueAt(i);
-
-            CAMHAL_LOGD("Filling at %d", j);
-            newBuffers[index].opaque = mBuffers[j].opaque;
-            newBuffers[index].type = mBuffers[j].type;
-            newBuffers[index].format = mBuffers[j].format;
-            newBuffers[index].mapped = mBuffers[j].mapped;
-        }
 
         delete [] mBuffers;
         mBuffers = newBuffers;
+
+        resetSlots(lnumBufs);
+        for (int slot = 0; slot < index; slot++) {
+            registerSlot(slot, (slot < dequeued) ? BUFFER_OWNER_CAMERA_ADAPTER :
+                                                   BUFFER_OWNER_WINDOW);
+        }
     }
 
     return mBuffers;
@@ -656,7 +717,8 @@ CameraBuffer* BufferSourceAdapter::getBufferList(int *num) {
     CAMHAL_LOGD("got handle %p", handle);
     mBuffers[0].opaque = (void *)handle;
     mBuffers[0].type = CAMERA_BUFFER_ANW;
-    mFramesWithCameraAdapterMap.add(handle, 0);
+    resetSlots(mBufferCount);
+    registerSlot(0, BUFFER_OWNER_CAMERA_ADAPTER);
 
     err = extendedOps()->get_buffer_dimension(mBufferSource, &mBuffers[0].width, &mBuffers[0].height);
     err = extendedOps()->get_buffer_format(mBufferSource, &formatSource);
@@ -771,13 +833,10 @@ status_t BufferSourceAdapter::returnBuffersToWindow()
 
     //Give the buffers back to display here -  sort of free it
     if (mBufferSource) {
-        for(unsigned int i = 0; i < mFramesWithCameraAdapterMap.size(); i++) {
-            int value = mFramesWithCameraAdapterMap.valueAt(i);
-            buffer_handle_t *handle = (buffer_handle_t *) mBuffers[value].opaque;
+        for(unsigned int i = 0; i < mSlotOwner.size(); i++) {
+            buffer_handle_t *handle = (buffer_handle_t *) mBuffers[i].opaque;
 
-            // if buffer index is out of bounds skip
-            if ((value < 0) || (value >= mBufferCount)) {
-                CAMHAL_LOGEA("Potential out bounds access to handle...skipping");
+            if (mSlotOwner[i] != BUFFER_OWNER_CAMERA_ADAPTER) {
                 continue;
             }
 
@@ -795,13 +854,14 @@ status_t BufferSourceAdapter::returnBuffersToWindow()
                               -ret);
                 return -ret;
             }
+            mSlotOwner.editItemAt(i) = BUFFER_OWNER_WINDOW;
         }
     } else {
          CAMHAL_LOGE("mBufferSource is NULL");
     }
 
-     ///Clear the frames with camera adapter map
-     mFramesWithCameraAdapterMap.clear();
+     ///Forget the slots, mBuffers is about to go away
+     resetSlots(0);
 
      return ret;
 
@@ -843,7 +903,7 @@ void BufferSourceAdapter::addFrame(CameraFrame* frame)
     }
 }
 
-void BufferSourceAdapter::handleFrameCallback(CameraFrame* frame)
+bool BufferSourceAdapter::handleFrameCallback(CameraFrame* frame)
 {
     status_t ret = NO_ERROR;
     buffer_handle_t *handle = NULL;
@@ -855,22 +915,18 @@ void BufferSourceAdapter::handleFrameCallback(CameraFrame* frame)
 
     if (!mBuffers || !frame->mBuffer) {
         CAMHAL_LOGEA("Adapter sent BufferSourceAdapter a NULL frame?");
-        return;
+        return false;
     }
 
-    for ( i = 0; i < mBufferCount; i++ ) {
-        if (frame->mBuffer == &mBuffers[i]) {
-            break;
-        }
-    }
+    i = findSlot(frame->mBuffer);
 
-    if (i >= mBufferCount) {
+    if (i < 0) {
         CAMHAL_LOGD("Can't find frame in buffer list");
         if (frame->mFrameType != CameraFrame::REPROCESS_INPUT_FRAME) {
             mFrameProvider->returnFrame(frame->mBuffer,
                     static_cast<CameraFrame::FrameType>(frame->mFrameType));
         }
-        return;
+        return false;
     }
 
     handle = (buffer_handle_t *) mBuffers[i].opaque;
@@ -882,7 +938,13 @@ void BufferSourceAdapter::handleFrameCallback(CameraFrame* frame)
         CAMHAL_LOGD("Unlock %p (buffer #%d)", handle, i);
         mapper.unlock(*handle);
         extendedOps()->release_buffer(mBufferSource, mBuffers[i].privateData);
-        return;
+        mSlotOwner.editItemAt(i) = BUFFER_OWNER_WINDOW;
+        return false;
+    }
+
+    if (NULL == mBufferSource) {
+        CAMHAL_LOGEA("Buffer source is gone, dropping frame");
+        return false;
     }
 
     CameraHal::getXYFromOffset(&x, &y, frame->mOffset, frame->mAlignment, mPixelFormat);
@@ -913,18 +975,36 @@ void BufferSourceAdapter::handleFrameCallback(CameraFrame* frame)
     ret = mBufferSource->enqueue_buffer(mBufferSource, handle);
     if (ret != 0) {
         CAMHAL_LOGE("Surface::queueBuffer returned error %d", ret);
-        goto fail;
+        goto requeue;
     }
 
-    mFramesWithCameraAdapterMap.removeItem((buffer_handle_t *) frame->mBuffer->opaque);
+    mSlotOwner.editItemAt(i) = BUFFER_OWNER_WINDOW;
+
+    return true;
 
-    return;
+requeue:
+    // the buffer never left us, map it again so it can be refilled
+    {
+        void *y_uv[2];
+        android::Rect bounds(mFrameWidth, mFrameHeight);
+        mapper.lock(*handle, CAMHAL_GRALLOC_USAGE, bounds, y_uv);
+        mBuffers[i].mapped = y_uv[0];
+    }
 
 fail:
-    mFramesWithCameraAdapterMap.clear();
-    mBufferSource = NULL;
-    mReturnFrame->requestExit();
-    mQueueFrame->requestExit();
+    if ( (-ENODEV == ret) || (ENODEV == ret) ) {
+        // surface abandoned, nothing left to recover
+        CAMHAL_LOGEA("Preview surface abandoned!");
+        mBufferSource = NULL;
+        mReturnFrame->requestExit();
+        mQueueFrame->requestExit();
+        return false;
+    }
+
+    // only this slot is affected, hand it straight back to the camera adapter
+    mFrameProvider->returnFrame(&mBuffers[i], formatToOutputFrameType(mPixelFormat));
+
+    return false;
 }
 
 
@@ -957,6 +1037,13 @@ bool BufferSourceAdapter::handleFrameReturn()
         return false;
     }
 
+    i = findSlot(buf);
+    if (i < 0) {
+        CAMHAL_LOGEB("Failed to find handle %p", buf);
+        mBufferSource->cancel_buffer(mBufferSource, buf);
+        return false;
+    }
+
     err = mBufferSource->lock_buffer(mBufferSource, buf);
     if (err != 0) {
         CAMHAL_LOGEB("lockbuffer failed: %s (%d)", strerror(-err), -err);
@@ -971,16 +1058,7 @@ bool BufferSourceAdapter::handleFrameReturn()
 
     mapper.lock(*buf, CAMHAL_GRALLOC_USAGE, bounds, y_uv);
 
-    for(i = 0; i < mBufferCount; i++) {
-        if (mBuffers[i].opaque == buf)
-            break;
-    }
-
-    if (i >= mBufferCount) {
-        CAMHAL_LOGEB("Failed to find handle %p", buf);
-    }
-
-    mFramesWithCameraAdapterMap.add((buffer_handle_t *) mBuffers[i].opaque, i);
+    mSlotOwner.editItemAt(i) = BUFFER_OWNER_CAMERA_ADAPTER;
 
     CAMHAL_LOGVB("handleFrameReturn: found graphic buffer %d of %d", i, mBufferCount - 1);
 
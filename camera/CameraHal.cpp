@@ -959,6 +959,18 @@ int CameraHal::setParameters(const android::CameraParameters& params)
                 }
 
             }
+
+        if( (valstr = params.get(TICameraParameters::KEY_PREVIEW_CALLBACK_LATEST_ONLY)) != NULL )
+            {
+            CAMHAL_LOGDB("Preview callback latest only set to %s", valstr);
+            mParameters.set(TICameraParameters::KEY_PREVIEW_CALLBACK_LATEST_ONLY, valstr);
+
+            if ( NULL != mAppCallbackNotifier.get() )
+                {
+                mAppCallbackNotifier->setPreviewCallbackLatestOnly(
+                        strcmp(valstr, android::CameraParameters::TRUE) == 0);
+                }
+            }
 #endif
 
         if( (valstr = params.get(android::CameraParameters::KEY_EXPOSURE_COMPENSATION)) != NULL)
@@ -27,8 +27,11 @@
 #include "NV12_resize.h"
 #include "TICameraParameters.h"
 
+#include <cutils/ashmem.h>
+
 #include <stdlib.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -52,6 +55,13 @@ struct integer_string_pair {
     const char* string;
 };
 
+// jhead needs a jpeg to hang the EXIF section on. Only the headers are parsed
+// when building the section, so a bare SOI followed by an empty SOS is enough.
+static const unsigned char exif_host_jpeg[] = {
+    0xFF, 0xD8, // SOI
+    0xFF, 0xDA, 0x00, 0x02, // SOS
+};
+
 static integer_string_pair degress_to_exif_lut [] = {
     // degrees, exif_orientation
     {0,   "1"},
@@ -59,12 +69,17 @@ static integer_string_pair degress_to_exif_lut [] = {
     {180, "3"},
     {270, "8"},
 };
+// Largest APP1 segment, the length field is 16 bits and counts itself
+#define EXIF_MAX_SECTION_SIZE 0xFFFF
+
 struct libjpeg_destination_mgr : jpeg_destination_mgr {
     libjpeg_destination_mgr(uint8_t* input, int size);
 
     uint8_t* buf;
     int bufsize;
     size_t jpegsize;
+    bool overflow;
+    JOCTET scratch[256]; // takes the output past the end of buf
 };
 
 static void libjpeg_init_destination (j_compress_ptr cinfo) {
@@ -73,19 +88,26 @@ static void libjpeg_init_destination (j_compress_ptr cinfo) {
     dest->next_output_byte = dest->buf;
     dest->free_in_buffer = dest->bufsize;
     dest->jpegsize = 0;
+    dest->overflow = false;
 }
 
 static boolean libjpeg_empty_output_buffer(j_compress_ptr cinfo) {
     libjpeg_destination_mgr* dest = (libjpeg_destination_mgr*)cinfo->dest;
 
-    dest->next_output_byte = dest->buf;
-    dest->free_in_buffer = dest->bufsize;
-    return TRUE; // ?
+    // Starting over at the beginning of buf would overwrite the headers. The
+    // rest of the stream is thrown away instead and the encode fails.
+    if (!dest->overflow) {
+        CAMHAL_LOGEB("Encoder: output overflows the %d byte buffer", dest->bufsize);
+        dest->overflow = true;
+    }
+    dest->next_output_byte = dest->scratch;
+    dest->free_in_buffer = sizeof(dest->scratch);
+    return TRUE;
 }
 
 static void libjpeg_term_destination (j_compress_ptr cinfo) {
     libjpeg_destination_mgr* dest = (libjpeg_destination_mgr*)cinfo->dest;
-    dest->jpegsize = dest->bufsize - dest->free_in_buffer;
+    dest->jpegsize = dest->overflow ? 0 : dest->bufsize - dest->free_in_buffer;
 }
 
 libjpeg_destination_mgr::libjpeg_destination_mgr(uint8_t* input, int size) {
@@ -97,6 +119,7 @@ libjpeg_destination_mgr::libjpeg_destination_mgr(uint8_t* input, int size) {
     this->bufsize = size;
 
     jpegsize = 0;
+    overflow = false;
 }
 
 /* private static functions */
@@ -355,6 +378,34 @@ void ExifElementsTable::saveJpeg(unsigned char* jpeg, size_t jpeg_size) {
     }
 }
 
+const Section_t* ExifElementsTable::createExifSection(const char* thumb, int thumb_len) {
+    if (jpeg_opened) {
+        DiscardData();
+        jpeg_opened = false;
+    }
+
+    ResetJpgfile();
+    if (ReadJpegSectionsFromBuffer((unsigned char*) exif_host_jpeg, sizeof(exif_host_jpeg),
+                                   READ_METADATA)) {
+        jpeg_opened = true;
+#ifdef ANDROID_API_JB_OR_LATER
+        create_EXIF(table, exif_tag_count, gps_tag_count, has_datetime_tag);
+#else
+        create_EXIF(table, exif_tag_count, gps_tag_count);
+#endif
+    }
+
+    if (!jpeg_opened) {
+        return NULL;
+    }
+
+    if (thumb) {
+        insertExifThumbnailImage(thumb, thumb_len);
+    }
+
+    return FindSection(M_EXIF);
+}
+
 /* public functions */
 ExifElementsTable::~ExifElementsTable() {
     int num_elements = gps_tag_count + exif_tag_count;
@@ -422,7 +473,29 @@ status_t ExifElementsTable::insertElement(const char* tag, const char* value) {
     return ret;
 }
 
+/* public static functions */
+size_t Encoder_libjpeg::jpegSizeBound(int width, int height) {
+    // Worst case for a baseline 4:2:0 stream: every 16x16 MCU padded out and
+    // coded at 3 bytes per pixel, plus room for the tables and markers and
+    // the largest APP1 segment, which carries the EXIF data and thumbnail.
+    // The bound is loose on purpose, untouched pages of the buffer are never
+    // committed.
+    size_t padded_width = (width + 15) & ~15;
+    size_t padded_height = (height + 15) & ~15;
+
+    return padded_width * padded_height * 3 + 2048 + 2 + EXIF_MAX_SECTION_SIZE;
+}
+
 /* private member functions */
+void Encoder_libjpeg::waitThumbnail() {
+    if (mThumb.get()) {
+        // wait until tn jpeg thread exits.
+        mThumb->join();
+        mThumb.clear();
+        mThumb = NULL;
+    }
+}
+
 size_t Encoder_libjpeg::encode(params* input) {
     jpeg_compress_struct    cinfo;
     jpeg_error_mgr jerr;
@@ -500,13 +573,50 @@ size_t Encoder_libjpeg::encode(params* input) {
     jpeg_set_quality(&cinfo, input->quality, TRUE);
     cinfo.dct_method = JDCT_IFAST;
 
+    if (input->exif) {
+        // EXIF files carry APP1 in place of the JFIF header
+        cinfo.write_JFIF_header = FALSE;
+    }
+
     jpeg_start_compress(&cinfo, TRUE);
 
+    if (input->exif) {
+        // The EXIF section embeds the thumbnail, so it has to be finished
+        // before anything past the markers can be written.
+        const Section_t* exif_section = NULL;
+
+        waitThumbnail();
+
+        if (mThumbnailInput && (mThumbnailInput->jpeg_size > 0)) {
+            exif_section = input->exif->createExifSection((const char*) mThumbnailInput->dst,
+                                                          (int) mThumbnailInput->jpeg_size);
+        } else {
+            exif_section = input->exif->createExifSection(NULL, 0);
+        }
+
+        // libjpeg can't write a segment this long, keep the tags and drop
+        // the thumbnail
+        if (exif_section && (exif_section->Size > EXIF_MAX_SECTION_SIZE)) {
+            CAMHAL_LOGEB("Encoder: %u byte EXIF section, thumbnail left out",
+                         exif_section->Size);
+            exif_section = input->exif->createExifSection(NULL, 0);
+        }
+
+        // Section data starts with the two byte segment length, which
+        // libjpeg writes on its own
+        if (exif_section && (exif_section->Size > 2)) {
+            jpeg_write_marker(&cinfo, JPEG_APP0 + 1,
+                              (const JOCTET*) exif_section->Data + 2,
+                              exif_section->Size - 2);
+        }
+    }
+
     row_tmp = (uint8_t*)malloc((out_width - right_crop) * 3);
     row_src = src + start_offset;
     row_uv = src + out_width * out_height * bpp;
 
-    while ((cinfo.next_scanline < cinfo.image_height) && !mCancelEncoding) {
+    while ((cinfo.next_scanline < cinfo.image_height) && !mCancelEncoding &&
+           !dest_mgr.overflow) {
         JSAMPROW row[1];    /* pointer to JSAMPLE row[s] */
 
         // convert input yuv format to yuv444
@@ -531,7 +641,7 @@ size_t Encoder_libjpeg::encode(params* input) {
 
     // no need to finish encoding routine if we are prematurely stopping
     // we will end up crashing in dest_mgr since data is incomplete
-    if (!mCancelEncoding)
+    if (!mCancelEncoding && !dest_mgr.overflow)
         jpeg_finish_compress(&cinfo);
     jpeg_destroy_compress(&cinfo);
 
@@ -543,5 +653,27 @@ size_t Encoder_libjpeg::encode(params* input) {
     return dest_mgr.jpegsize;
 }
 
+JpegBuffer* JpegBuffer::allocate(size_t size) {
+    int fd = ashmem_create_region("camera-jpeg", size);
+    if (fd < 0) {
+        CAMHAL_LOGEB("ashmem_create_region failed for %zu bytes", size);
+        return NULL;
+    }
+
+    void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        CAMHAL_LOGEB("mmap failed for %zu bytes", size);
+        close(fd);
+        return NULL;
+    }
+
+    return new JpegBuffer(fd, (uint8_t*) data, size);
+}
+
+JpegBuffer::~JpegBuffer() {
+    munmap(data, size);
+    close(fd);
+}
+
 } // namespace Camera
 } // namespace Ti
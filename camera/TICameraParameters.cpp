@@ -75,6 +75,7 @@ const char TICameraParameters::KEY_TEMP_BRACKETING_RANGE_POS[] = "temporal-brack
 const char TICameraParameters::KEY_TEMP_BRACKETING_RANGE_NEG[] = "temporal-bracketing-range-negative";
 const char TICameraParameters::KEY_FLUSH_SHOT_CONFIG_QUEUE[] = "flush-shot-config-queue";
 const char TICameraParameters::KEY_MEASUREMENT_ENABLE[] = "measurement";
+const char TICameraParameters::KEY_PREVIEW_CALLBACK_LATEST_ONLY[] = "preview-callback-latest-only";
 const char TICameraParameters::KEY_GBCE[] = "gbce";
 const char TICameraParameters::KEY_GBCE_SUPPORTED[] = "gbce-supported";
 const char TICameraParameters::KEY_GLBCE[] = "glbce";
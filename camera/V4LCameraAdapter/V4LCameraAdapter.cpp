@@ -57,6 +57,8 @@ namespace Camera {
 static void convertYUV422i_yuyvTouyvy(uint8_t *src, uint8_t *dest, size_t size );
 static void convertYUV422ToNV12Tiler(unsigned char *src, unsigned char *dest, int width, int height );
 static void convertYUV422ToNV12(unsigned char *src, unsigned char *dest, int width, int height );
+static void convertYUV422ToNV12Scaled(unsigned char *src, int srcWidth, int srcHeight,
+                                      unsigned char *dest, int width, int height );
 
 android::Mutex gV4LAdapterLock;
 char device[15];
@@ -312,8 +314,8 @@ status_t V4LCameraAdapter::restartPreview ()
 
     LOG_FUNCTION_NAME;
 
-    //configure for preview size and pixel format.
-    mParams.getPreviewSize(&width, &height);
+    //configure for preview size (picture size in ZSL mode) and pixel format.
+    getStreamSize(width, height);
 
     ret = v4lSetFormat (width, height, mPixelFormat);
     if (ret < 0) {
@@ -469,6 +471,12 @@ status_t V4LCameraAdapter::fillThisBuffer(CameraBuffer *frameBuf, CameraFrame::F
         }
 
     } else {
+        // ZSL may keep the frame a little longer, and give back an older one
+        idx = holdZslFrame(idx);
+        if (idx < 0) {
+            return ret;
+        }
+
         v4l2_buffer buf;
         buf.index = idx;
         buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -518,7 +526,18 @@ status_t V4LCameraAdapter::setParameters(const android::CameraParameters &params
     android::AutoMutex lock(mLock);
 
     if(!mPreviewing && !mCapturing) {
-        params.getPreviewSize(&width, &height);
+        const char *capMode = params.get(TICameraParameters::KEY_CAP_MODE);
+
+        // ZSL keeps raw YUYV frames, it is not available behind the decoder
+        mZslMode = (NULL != capMode) &&
+                   (strcmp(capMode, TICameraParameters::HIGH_QUALITY_ZSL_MODE) == 0) &&
+                   !isNeedToUseDecoder() && (0 < mZslHistoryLimit);
+
+        if (mZslMode) {
+            params.getPictureSize(&width, &height);
+        } else {
+            params.getPreviewSize(&width, &height);
+        }
         CAMHAL_LOGDB("Width * Height %d x %d format 0x%x", width, height, mPixelFormat);
         ret = v4lSetFormat( width, height, mPixelFormat);
         if (ret < 0) {
@@ -674,6 +693,7 @@ status_t V4LCameraAdapter::takePicture() {
     char *fp = NULL;
     CameraBuffer *buffer = NULL;
     CameraFrame frame;
+    const nsecs_t shutterTime = systemTime(SYSTEM_TIME_MONOTONIC);
 
     LOG_FUNCTION_NAME;
 
@@ -684,6 +704,23 @@ status_t V4LCameraAdapter::takePicture() {
         return BAD_VALUE;
     }
 
+    if (mZslMode && mPreviewing) {
+        index = pinZslFrame(shutterTime);
+        if (0 <= index) {
+            // the stream keeps running, the frame is pinned until copied
+            mCapturing = true;
+            mLock.unlock();
+            ret = takeZslPicture(index, shutterTime);
+            mLock.lock();
+            if (NO_ERROR != ret) {
+                mCapturing = false;
+            }
+            LOG_FUNCTION_NAME_EXIT;
+            return ret;
+        }
+        CAMHAL_LOGW("ZSL capture not possible, stopping stream for capture");
+    }
+
     mPreviewing = false;
     mLock.unlock();
 
@@ -861,6 +898,8 @@ status_t V4LCameraAdapter::startPreview()
         goto EXIT;
     }
 
+    resetZslHistory(mZslMode);
+
     for (int i = 0; i < mPreviewBufferCountQueueable; i++) {
         v4l2_buffer buf;
 
@@ -931,6 +970,8 @@ status_t V4LCameraAdapter::stopPreview()
         mDecoder->stop();
         mDecoder->flush();
     }
+    // a ZSL capture may still be copying out of a mapped buffer
+    waitZslFrame();
     ret = v4lStopStreaming(mPreviewBufferCount);
     if (ret < 0) {
         CAMHAL_LOGEB("StopStreaming: FAILED: %s", strerror(errno));
@@ -945,6 +986,7 @@ status_t V4LCameraAdapter::stopPreview()
     mPreviewThread->requestExitAndWait();
     mPreviewThread.clear();
 
+    resetZslHistory(false);
 
     LOG_FUNCTION_NAME_EXIT;
     return ret;
@@ -1009,10 +1051,18 @@ char * V4LCameraAdapter::GetFrame(int &index, int &filledLen)
     index = buf.index;
     filledLen = buf.bytesused;
 
+    // Drivers stamp the frame when its capture starts, on CLOCK_MONOTONIC like
+    // systemTime(). Stamps from another clock, or none, get the dequeue time.
+    const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    nsecs_t timestamp = s2ns(buf.timestamp.tv_sec) + us2ns(buf.timestamp.tv_usec);
+    if ((timestamp <= 0) || (timestamp > now) || (now - timestamp > s2ns(1))) {
+        timestamp = now;
+    }
+
     android::sp<MediaBuffer>& inBuffer = mInBuffers.editItemAt(index);
     {
         android::AutoMutex bufferLock(inBuffer->getLock());
-        inBuffer->setTimestamp(systemTime(SYSTEM_TIME_MONOTONIC));
+        inBuffer->setTimestamp(timestamp);
         inBuffer->filledLen = buf.bytesused;
     }
     debugShowFPS();
@@ -1180,6 +1230,12 @@ V4LCameraAdapter::V4LCameraAdapter(size_t sensor_index, CameraHal* hal)
     property_get("camera.v4l.skipframes", value, "1");
     mSkipFramesCount = atoi(value);
 
+    // V4L buffers held back from the driver for ZSL, 0 disables ZSL
+    property_get("camera.v4l.zsl.frames", value, "2");
+    mZslHistoryLimit = atoi(value);
+    mZslMode = false;
+    resetZslHistory(false);
+
     LOG_FUNCTION_NAME_EXIT;
 }
 
@@ -1372,9 +1428,257 @@ static void convertYUV422ToNV12(unsigned char *src, unsigned char *dest, int wid
     LOG_FUNCTION_NAME_EXIT;
 }
 
+static void convertYUV422ToNV12Scaled(unsigned char *src, int srcWidth, int srcHeight,
+                                      unsigned char *dest, int width, int height ) {
+    //downscale YUV422I to YUV420 NV12 (nearest neighbour) directly into preview buffers (Tiler memory).
+    int stride = 4096;
+    int src_stride = srcWidth * 2;
+    unsigned char *dst_uv = dest + (height * stride);
+
+    LOG_FUNCTION_NAME;
 
+    for(int i = 0; i < height; i++) {
+        unsigned char *row = src + ((i * srcHeight) / height) * src_stride;
+        unsigned char *dst_y = dest + (i * stride);
+
+        for(int j = 0; j < width; j++) {
+            dst_y[j] = row[((j * srcWidth) / width) * 2];
+        }
+
+        if (!(i & 0x1)) {
+            unsigned char *uv = dst_uv + ((i / 2) * stride);
+            for(int j = 0; j < width; j += 2) {
+                // take U and V from the macropixel holding the sampled pixel
+                unsigned char *mp = row + (((j * srcWidth) / width) & ~1) * 2;
+                uv[j] = mp[1];
+                uv[j + 1] = mp[3];
+            }
+        }
+    }
+
+    LOG_FUNCTION_NAME_EXIT;
+}
+
+
+/* Zero shutter lag history */
+// ---------------------------------------------------------------------------
 
+void V4LCameraAdapter::getStreamSize(int &width, int &height)
+{
+    if (mZslMode) {
+        mParams.getPictureSize(&width, &height);
+    } else {
+        mParams.getPreviewSize(&width, &height);
+    }
+}
+
+void V4LCameraAdapter::resetZslHistory(bool streaming)
+{
+    android::AutoMutex lock(mZslLock);
+
+    for (int i = 0; i < NB_BUFFER; i++) {
+        mZslFrames[i].filledLen = 0;
+        mZslFrames[i].timestamp = 0;
+        mZslFrames[i].dequeued = false;
+    }
+    mZslHistoryLength = 0;
+    mZslPinned = -1;
+    mZslPinnedReturned = false;
+
+    // keep at least two buffers with the driver so the stream doesn't starve
+    mZslHistoryCount = 0;
+    if (streaming) {
+        mZslHistoryCount = mZslHistoryLimit;
+        if (mZslHistoryCount > MAX_ZSL_HISTORY) {
+            mZslHistoryCount = MAX_ZSL_HISTORY;
+        }
+        if (mZslHistoryCount > mPreviewBufferCountQueueable - 2) {
+            mZslHistoryCount = mPreviewBufferCountQueueable - 2;
+        }
+        if (mZslHistoryCount < 0) {
+            mZslHistoryCount = 0;
+        }
+        CAMHAL_LOGDB("ZSL history of %d V4L buffers", mZslHistoryCount);
+    }
+}
+
+void V4LCameraAdapter::markZslFrame(int index, int filledLen, nsecs_t timestamp)
+{
+    android::AutoMutex lock(mZslLock);
+
+    mZslFrames[index].filledLen = filledLen;
+    mZslFrames[index].timestamp = timestamp;
+    mZslFrames[index].dequeued = true;
+}
+
+// Takes back a buffer from the preview consumers, returns the index of the
+// buffer to queue to the driver or -1 if there is none.
+int V4LCameraAdapter::holdZslFrame(int index)
+{
+    android::AutoMutex lock(mZslLock);
+
+    if (index == mZslPinned) {
+        // takeZslPicture() queues it once copied
+        mZslPinnedReturned = true;
+        return -1;
+    }
+    if (0 == mZslHistoryCount) {
+        mZslFrames[index].dequeued = false;
+        return index;
+    }
+
+    mZslHistory[mZslHistoryLength++] = index;
+    if (mZslHistoryLength <= mZslHistoryCount) {
+        return -1;
+    }
+
+    const int oldest = mZslHistory[0];
+    mZslHistoryLength--;
+    memmove(mZslHistory, mZslHistory + 1, mZslHistoryLength * sizeof(mZslHistory[0]));
+    mZslFrames[oldest].dequeued = false;
+    return oldest;
+}
+
+// Picks the dequeued frame closest to the shutter press and pins it, so that
+// its buffer stays out of the driver until takeZslPicture() copied it.
+// Called with mLock held, returns the buffer index or -1.
+int V4LCameraAdapter::pinZslFrame(nsecs_t shutterTime)
+{
+    int width = 0;
+    int height = 0;
+    int best = -1;
+    nsecs_t bestDistance = 0;
+
+    // the history is only useful if the device delivered the requested size
+    mParams.getPictureSize(&width, &height);
+    if ( (width != (int) mVideoInfo->format.fmt.pix.width) ||
+         (height != (int) mVideoInfo->format.fmt.pix.height) ) {
+        return -1;
+    }
+
+    if ( mCaptureBufs.isEmpty() ) {
+        return -1;
+    }
 
+    android::AutoMutex lock(mZslLock);
+
+    if ( 0 <= mZslPinned ) {
+        return -1;
+    }
+
+    for (int i = 0; i < NB_BUFFER; i++) {
+        nsecs_t distance = mZslFrames[i].timestamp - shutterTime;
+
+        if ( !mZslFrames[i].dequeued || (0 == mZslFrames[i].filledLen) ) {
+            continue;
+        }
+        if ( distance < 0 ) {
+            distance = -distance;
+        }
+        if ( (0 > best) || (distance < bestDistance) ) {
+            best = i;
+            bestDistance = distance;
+        }
+    }
+
+    if ( 0 > best ) {
+        return -1;
+    }
+
+    // a held back buffer is already free of the preview consumers
+    mZslPinnedReturned = false;
+    for (int i = 0; i < mZslHistoryLength; i++) {
+        if ( mZslHistory[i] == best ) {
+            mZslHistoryLength--;
+            memmove(mZslHistory + i, mZslHistory + i + 1,
+                    (mZslHistoryLength - i) * sizeof(mZslHistory[0]));
+            mZslPinnedReturned = true;
+            break;
+        }
+    }
+    mZslPinned = best;
+
+    return best;
+}
+
+void V4LCameraAdapter::waitZslFrame()
+{
+    android::AutoMutex lock(mZslLock);
+
+    while ( 0 <= mZslPinned ) {
+        mZslCondition.wait(mZslLock);
+    }
+}
+
+// Called without mLock, the stream keeps running meanwhile.
+status_t V4LCameraAdapter::takeZslPicture(int index, nsecs_t shutterTime)
+{
+    status_t ret = NO_ERROR;
+    const int width = mVideoInfo->format.fmt.pix.width;
+    const int height = mVideoInfo->format.fmt.pix.height;
+    const size_t frameSize = width * height * 2; // YUV422i
+    size_t filledLen = 0;
+    bool returned = false;
+    CameraBuffer *buffer = mCaptureBufs.keyAt(0);
+    CameraFrame frame;
+
+    LOG_FUNCTION_NAME;
+
+    {
+        android::AutoMutex lock(mZslLock);
+        filledLen = mZslFrames[index].filledLen;
+        frame.mTimestamp = mZslFrames[index].timestamp;
+    }
+    if ( filledLen > frameSize ) {
+        filledLen = frameSize;
+    }
+
+    memcpy(buffer->opaque, mVideoInfo->mem[index], filledLen);
+
+    {
+        android::AutoMutex lock(mZslLock);
+        returned = mZslPinnedReturned;
+        if ( returned ) {
+            mZslFrames[index].dequeued = false;
+        }
+        mZslPinned = -1;
+        mZslPinnedReturned = false;
+        mZslCondition.broadcast();
+    }
+
+    if ( returned ) {
+        android::AutoMutex lock(mLock);
+        if ( mVideoInfo->isStreaming && (NO_ERROR == returnBufferToV4L(index)) ) {
+            nQueued++;
+        }
+    }
+
+    CAMHAL_LOGDB("ZSL frame taken %lld us from shutter", ns2us(frame.mTimestamp - shutterTime));
+
+    frame.mFrameType = CameraFrame::IMAGE_FRAME;
+    frame.mBuffer = buffer;
+    frame.mLength = frameSize;
+    frame.mWidth = width;
+    frame.mHeight = height;
+    frame.mAlignment = width*2;
+    frame.mOffset = 0;
+    frame.mFrameMask = (unsigned int)CameraFrame::IMAGE_FRAME;
+    frame.mQuirks |= CameraFrame::ENCODE_RAW_YUV422I_TO_JPEG;
+    frame.mQuirks |= CameraFrame::FORMAT_YUV422I_YUYV;
+
+    ret = setInitFrameRefCount(frame.mBuffer, frame.mFrameMask);
+    if (ret != NO_ERROR) {
+        CAMHAL_LOGDB("Error in setInitFrameRefCount %d", ret);
+    } else {
+        ret = sendFrameToSubscribers(&frame);
+    }
+
+    CAMHAL_LOGDB("ZSL shutter to image frame %lld us",
+                 ns2us(systemTime(SYSTEM_TIME_MONOTONIC) - shutterTime));
+
+    LOG_FUNCTION_NAME_EXIT;
+    return ret;
+}
 
 /* Preview Thread */
 // ---------------------------------------------------------------------------
@@ -1501,9 +1805,21 @@ int V4LCameraAdapter::previewThread()
         }
         CAMHAL_LOGD("GOT IN frame with ID=%d",index);
 
+        const nsecs_t timestamp = mInBuffers[index]->getTimestamp();
+        const int streamWidth = mVideoInfo->format.fmt.pix.width;
+        const int streamHeight = mVideoInfo->format.fmt.pix.height;
+
+        markZslFrame(index, filledLen, timestamp);
+
         CameraBuffer *buffer = mPreviewBufs[index];
         if (mPixelFormat == V4L2_PIX_FMT_YUYV) {
-            convertYUV422ToNV12Tiler(reinterpret_cast<unsigned char*>(fp), reinterpret_cast<unsigned char*>(buffer->mapped), width, height);
+            if ((streamWidth == width) && (streamHeight == height)) {
+                convertYUV422ToNV12Tiler(reinterpret_cast<unsigned char*>(fp), reinterpret_cast<unsigned char*>(buffer->mapped), width, height);
+            } else {
+                // ZSL streams at picture size, preview gets a downscaled copy
+                convertYUV422ToNV12Scaled(reinterpret_cast<unsigned char*>(fp), streamWidth, streamHeight,
+                                          reinterpret_cast<unsigned char*>(buffer->mapped), width, height);
+            }
         }
         CAMHAL_LOGVB("##...index= %d.;camera buffer= 0x%x; mapped= 0x%x.",index, buffer, buffer->mapped);
 
@@ -1522,7 +1838,7 @@ int V4LCameraAdapter::previewThread()
         frame.mLength = width*height*3/2;
         frame.mAlignment = stride;
         frame.mOffset = 0;
-        frame.mTimestamp = systemTime(SYSTEM_TIME_MONOTONIC);
+        frame.mTimestamp = timestamp;
         frame.mFrameMask = (unsigned int)CameraFrame::PREVIEW_FRAME_SYNC;
 
         if (mRecording)
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BUFFERSLOTMAP_H_
+#define BUFFERSLOTMAP_H_
+
+#include <stdint.h>
+#include <utils/Vector.h>
+
+namespace Ti {
+namespace Camera {
+
+/**
+ * Open-addressed map from the buffer handles of a window to the slots of
+ * BufferSourceAdapter, i.e. the positions of the buffers in its CameraBuffer
+ * array. reset() sizes the table for the slots, keeping its load factor at or
+ * below 1/2, so at most that many handles can be inserted.
+ */
+class BufferSlotMap {
+public:
+    // Drops all the handles and sizes the table for count slots
+    void reset(int count) {
+        unsigned int size = 1;
+
+        while (size < (unsigned int) (2 * count)) {
+            size <<= 1;
+        }
+        mHandles.clear();
+        mSlots.clear();
+        mHandles.insertAt(NULL, 0, size);
+        mSlots.insertAt(-1, 0, size);
+    }
+
+    // Maps handle to slot, replacing the slot it had
+    void insert(const void *handle, int slot) {
+        unsigned int pos = position(handle);
+
+        mHandles.editItemAt(pos) = handle;
+        mSlots.editItemAt(pos) = slot;
+    }
+
+    // Returns the slot of handle, -1 if it isn't in the map
+    int find(const void *handle) const {
+        if (mSlots.isEmpty() || (NULL == handle)) {
+            return -1;
+        }
+        return mSlots[position(handle)];
+    }
+
+private:
+    // Position of handle in the table, or of the empty entry ending its probe
+    unsigned int position(const void *handle) const {
+        const unsigned int mask = mSlots.size() - 1;
+        // Fibonacci hashing of the pointer value, low bits are always zero
+        unsigned int pos = ((uint32_t) (((uintptr_t) handle) >> 2) * 2654435761u) & mask;
+
+        while ((mSlots[pos] >= 0) && (mHandles[pos] != handle)) {
+            pos = (pos + 1) & mask;
+        }
+        return pos;
+    }
+
+    android::Vector<const void *> mHandles;
+    android::Vector<int> mSlots;
+};
+
+}  // namespace Camera
+}  // namespace Ti
+
+#endif /* BUFFERSLOTMAP_H_ */
@@ -20,6 +20,7 @@
 #ifdef OMAP_ENHANCEMENT_CPCAM
 
 #include "CameraHal.h"
+#include "BufferSlotMap.h"
 #include <ui/GraphicBufferMapper.h>
 #include <hal_public.h>
 
@@ -131,10 +132,10 @@ private:
             }
 
             if (frame) {
-                mBufferSourceAdapter->handleFrameCallback(frame);
+                bool queued = mBufferSourceAdapter->handleFrameCallback(frame);
                 frame->mMetaData.clear();
 
-                if (frame->mFrameType != CameraFrame::REPROCESS_INPUT_FRAME) {
+                if (queued) {
                     // signal return frame thread that it can dequeue a buffer now
                     mBufferSourceAdapter->mReturnFrame->signal();
                 }
@@ -158,6 +159,13 @@ private:
         BUFFER_SOURCE_TAP_OUT
     };
 
+    // Current owner of a buffer slot. Slots are indexed by CameraBuffer::index,
+    // which is the position of the buffer in mBuffers.
+    enum BufferOwner {
+        BUFFER_OWNER_WINDOW,
+        BUFFER_OWNER_CAMERA_ADAPTER
+    };
+
 // public member functions
 public:
     BufferSourceAdapter();
@@ -190,13 +198,18 @@ public:
 
     static void frameCallback(CameraFrame* caFrame);
     void addFrame(CameraFrame* caFrame);
-    void handleFrameCallback(CameraFrame* caFrame);
+    bool handleFrameCallback(CameraFrame* caFrame);
     bool handleFrameReturn();
 
 private:
     void destroy();
     status_t returnBuffersToWindow();
 
+    void resetSlots(int count);
+    void registerSlot(int slot, BufferOwner owner);
+    int findSlot(const buffer_handle_t *handle) const;
+    int findSlot(const CameraBuffer *buffer) const;
+
 private:
     preview_stream_ops_t*  mBufferSource;
     FrameProvider *mFrameProvider; // Pointer to the frame provider interface
@@ -205,7 +218,10 @@ private:
     int mBufferCount;
     CameraBuffer *mBuffers;
 
-    android::KeyedVector<buffer_handle_t *, int> mFramesWithCameraAdapterMap;
+    // Per-slot owner and buffer_handle_t* -> slot map, both rebuilt
+    // whenever mBuffers changes. Protected by mLock.
+    android::Vector<int> mSlotOwner;
+    BufferSlotMap mHandleSlots;
     android::sp<ErrorNotifier> mErrorNotifier;
     android::sp<ReturnFrame> mReturnFrame;
     android::sp<QueueFrame> mQueueFrame;
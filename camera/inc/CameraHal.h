@@ -56,6 +56,7 @@
 #include "Semaphore.h"
 #include "CameraProperties.h"
 #include "SensorListener.h"
+#include "PreviewCallbackRing.h"
 
 //temporarily define format here
 #define HAL_PIXEL_FORMAT_TI_NV12 0x100
@@ -702,6 +703,9 @@ public:
     //API for enabling/disabling measurement data
     void setMeasurements(bool enable);
 
+    //Only deliver the newest preview callback frame when the app falls behind
+    void setPreviewCallbackLatestOnly(bool latestOnly);
+
     //thread loops
     bool notificationThread();
 
@@ -731,6 +735,7 @@ public:
     status_t useMetaDataBufferMode(bool enable);
 
     void EncoderDoneCb(void*, void*, CameraFrame::FrameType type, void* cookie1, void* cookie2, void *cookie3);
+    void releaseThumbnailSource(const void *src);
 
     void useVideoBuffers(bool useVideoBuffers);
 
@@ -765,6 +770,9 @@ public:
     friend class NotificationThread;
 
 private:
+    static bool isPreviewCallbackFrame(int frameType);
+    int previewSlotFor(const void *data) const;
+
     void notifyEvent();
     void notifyFrame();
     bool processMessage();
@@ -809,7 +817,8 @@ private:
     bool mPreviewing;
     camera_memory_t* mPreviewMemory;
     CameraBuffer mPreviewBuffers[MAX_BUFFERS];
-    int mPreviewBufCount;
+    // Which of mPreviewBuffers are in use, protected by mLock
+    PreviewCallbackRing mPreviewRing;
     int mPreviewWidth;
     int mPreviewHeight;
     int mPreviewStride;
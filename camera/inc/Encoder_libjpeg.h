@@ -111,6 +111,7 @@ class ExifElementsTable {
         void insertExifToJpeg(unsigned char* jpeg, size_t jpeg_size);
         status_t insertExifThumbnailImage(const char*, int);
         void saveJpeg(unsigned char* picture, size_t jpeg_size);
+        const Section_t* createExifSection(const char* thumb, int thumb_len);
         static const char* degreesToExifOrientation(unsigned int);
         static void stringToRational(const char*, unsigned int*, unsigned int*);
         static bool isAsciiTag(const char* tag);
@@ -142,6 +143,7 @@ class Encoder_libjpeg : public android::Thread {
             int start_offset;
             const char* format;
             size_t jpeg_size;
+            ExifElementsTable* exif; // optional, emitted as APP1 ahead of the scan
          };
     /* public member functions */
     public:
@@ -182,12 +184,7 @@ class Encoder_libjpeg : public android::Thread {
             mCancelSem.Signal();
 
             // check if it is main jpeg thread
-            if(mThumb.get()) {
-                // wait until tn jpeg thread exits.
-                mThumb->join();
-                mThumb.clear();
-                mThumb = NULL;
-            }
+            waitThumbnail();
 
             if(mCb) {
                 mCb(mMainInput, mThumbnailInput, mType, mCookie1, mCookie2, mCookie3, mCookie4, mCancelEncoding);
@@ -206,6 +203,8 @@ class Encoder_libjpeg : public android::Thread {
            }
         }
 
+        static size_t jpegSizeBound(int width, int height);
+
         void getCookies(void **cookie1, void **cookie2, void **cookie3) {
             if (cookie1) *cookie1 = mCookie1;
             if (cookie2) *cookie2 = mCookie2;
@@ -226,6 +225,29 @@ class Encoder_libjpeg : public android::Thread {
         Utils::Semaphore mCancelSem;
 
         size_t encode(params*);
+        void waitThumbnail();
+};
+
+/**
+ * Shared region the encoder writes the final JPEG into, sized for the worst
+ * case by Encoder_libjpeg::jpegSizeBound(). share() maps just the encoded
+ * bytes for the app through its request memory, without copying them.
+ */
+class JpegBuffer {
+    public:
+        static JpegBuffer* allocate(size_t size);
+        ~JpegBuffer();
+
+        camera_memory_t* share(camera_request_memory request_memory, size_t jpeg_size) const {
+            return request_memory(fd, jpeg_size, 1, NULL);
+        }
+
+        int fd;
+        uint8_t* data;
+        size_t size;
+
+    private:
+        JpegBuffer(int fd, uint8_t* data, size_t size) : fd(fd), data(data), size(size) {}
 };
 
 } // namespace Camera
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PREVIEWCALLBACKRING_H_
+#define PREVIEWCALLBACKRING_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <cutils/atomic.h>
+
+namespace Ti {
+namespace Camera {
+
+/**
+ * Slots of the preview callback memory of AppCallbackNotifier. A slot is
+ * referenced while a frame is converted into it and delivered through the
+ * data callback, and while the JPEG encoder reads it as thumbnail source.
+ * Only free slots are written to.
+ *
+ * With latest-only set, a callback frame is returned unconverted when newer
+ * ones are already queued to the notifier, i.e. the app is behind. The queued
+ * count is updated without the lock of the notifier, everything else is
+ * protected by it.
+ */
+class PreviewCallbackRing {
+public:
+    static const int MAX_SLOTS = 8;
+
+    PreviewCallbackRing() : mQueued(0), mLatestOnly(false) {
+        reset(MAX_SLOTS);
+    }
+
+    // Frees count slots and clears the counts, the queued frames stay queued
+    void reset(int count) {
+        mCount = (count < MAX_SLOTS) ? count : MAX_SLOTS;
+        mNext = 0;
+        mLast = -1;
+        memset(mRefs, 0, sizeof(mRefs));
+        mConverted = 0;
+        mSkipped = 0;
+        mDropped = 0;
+    }
+
+    void setLatestOnly(bool latestOnly) {
+        mLatestOnly = latestOnly;
+    }
+
+    // A callback frame was queued to or taken from the notifier queue
+    void queued() {
+        android_atomic_inc(&mQueued);
+    }
+
+    void dequeued() {
+        android_atomic_dec(&mQueued);
+    }
+
+    // Returns the slot to convert the next frame into, -1 when the frame is to
+    // be returned without conversion. Only callback frames are ever skipped.
+    int acquire(bool callbackFrame) {
+        if (mLatestOnly && callbackFrame && (android_atomic_acquire_load(&mQueued) > 0)) {
+            mSkipped++;
+            return -1;
+        }
+
+        // start after the last handed out slot so the app sees the ring in order
+        for (int i = 0; i < mCount; i++) {
+            int slot = (mNext + i) % mCount;
+            if (0 == mRefs[slot]) {
+                mRefs[slot] = 1;
+                mNext = (slot + 1) % mCount;
+                return slot;
+            }
+        }
+
+        // every slot is still referenced, never overwrite one in use
+        if (mLatestOnly) {
+            mSkipped++;
+        } else {
+            mDropped++;
+        }
+        return -1;
+    }
+
+    // The frame acquire() handed slot for was converted into it
+    void converted(int slot) {
+        mConverted++;
+        mLast = slot;
+    }
+
+    // Holds the newest converted slot, for the thumbnail of a snapshot
+    int holdLatest() {
+        int slot = (mLast >= 0) ? mLast : (mNext + mCount - 1) % mCount;
+
+        mRefs[slot]++;
+        return slot;
+    }
+
+    void release(int slot) {
+        if ((slot >= 0) && (slot < mCount) && (mRefs[slot] > 0)) {
+            mRefs[slot]--;
+        }
+    }
+
+    unsigned int convertedFrames() const {
+        return mConverted;
+    }
+
+    unsigned int skippedFrames() const {
+        return mSkipped;
+    }
+
+    unsigned int droppedFrames() const {
+        return mDropped;
+    }
+
+private:
+    int mRefs[MAX_SLOTS];
+    int mCount;
+    int mNext;
+    int mLast;
+    // callback frames sitting in the notifier queue
+    volatile int32_t mQueued;
+    bool mLatestOnly;
+    unsigned int mConverted;
+    unsigned int mSkipped;
+    unsigned int mDropped;
+};
+
+}  // namespace Camera
+}  // namespace Ti
+
+#endif /* PREVIEWCALLBACKRING_H_ */
@@ -69,6 +69,7 @@ static const char  KEY_TEMP_BRACKETING_RANGE_NEG[];
 static const char  KEY_FLUSH_SHOT_CONFIG_QUEUE[];
 static const char  KEY_SHUTTER_ENABLE[];
 static const char  KEY_MEASUREMENT_ENABLE[];
+static const char  KEY_PREVIEW_CALLBACK_LATEST_ONLY[];
 static const char  KEY_INITIAL_VALUES[];
 static const char  KEY_GBCE[];
 static const char  KEY_GBCE_SUPPORTED[];
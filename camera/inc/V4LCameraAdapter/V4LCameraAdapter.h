@@ -105,6 +105,9 @@ public:
     ///Five second timeout
     static const int CAMERA_ADAPTER_TIMEOUT = 5000*1000;
 
+    ///Upper bound for the number of V4L buffers held back for ZSL
+    static const int MAX_ZSL_HISTORY = 4;
+
 public:
 
     V4LCameraAdapter(size_t sensor_index, CameraHal* hal);
@@ -167,6 +170,25 @@ private:
 
     int previewThread();
 
+    // Zero shutter lag: in HIGH_QUALITY_ZSL mode the device streams at picture
+    // resolution. Frames are never copied while streaming: the raw data stays
+    // in its V4L buffer as long as the buffer is dequeued, and the last
+    // buffers returned by the preview consumers are held back from the driver
+    // for a while. A capture copies the frame closest to the shutter press.
+    struct ZslFrame {
+        int filledLen;
+        nsecs_t timestamp;
+        bool dequeued;
+    };
+
+    void getStreamSize(int &width, int &height);
+    void resetZslHistory(bool streaming);
+    void markZslFrame(int index, int filledLen, nsecs_t timestamp);
+    int holdZslFrame(int index);
+    int pinZslFrame(nsecs_t shutterTime);
+    void waitZslFrame();
+    status_t takeZslPicture(int index, nsecs_t shutterTime);
+
 private:
     //capabilities data
     static const CapPixelformat mPixelformats [];
@@ -254,6 +276,18 @@ private:
 
     CameraHal* mCameraHal;
     int mSkipFramesCount;
+
+    bool mZslMode;
+    int mZslHistoryLimit;
+    // protected by mZslLock
+    android::Mutex mZslLock;
+    android::Condition mZslCondition;
+    ZslFrame mZslFrames[NB_BUFFER];
+    int mZslHistory[MAX_ZSL_HISTORY + 1];
+    int mZslHistoryCount;
+    int mZslHistoryLength;
+    int mZslPinned;
+    bool mZslPinnedReturned;
 };
 
 } // namespace Camera
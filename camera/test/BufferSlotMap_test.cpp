@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* @file BufferSlotMap_test.cpp
+*
+* Fills the handle -> slot map of BufferSourceAdapter the way the adapter
+* does for window buffers, with handles a real allocator could hand out and
+* with handles crowding the same table entries, and looks every handle up
+* again along with handles the window never gave. Also times the lookups
+* of a preview frame return.
+*
+* Returns 0 when every case passes.
+*/
+
+#include "BufferSlotMap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+using namespace Ti::Camera;
+
+#define MAX_SLOTS 64
+#define TIMED_LOOKUPS 1000000
+
+// Stands for the buffer_handle_t the window hands out
+static int handles[MAX_SLOTS * 64];
+
+/**
+ * Maps count handles spaced by stride to their slots, and checks each of
+ * them, and the handles in between, is found where expected.
+ */
+static bool checkSlots(BufferSlotMap& map, int count, int stride) {
+    bool ok = true;
+
+    map.reset(count);
+    for (int slot = 0; slot < count; slot++) {
+        map.insert(&handles[slot * stride], slot);
+    }
+    for (int i = 0; i < count * stride; i++) {
+        int expected = (i % stride) ? -1 : i / stride;
+        ok = ok && (map.find(&handles[i]) == expected);
+    }
+    return ok && (map.find(NULL) == -1);
+}
+
+int main(int argc, char** argv) {
+    static const struct {
+        int count;
+        int stride;
+    } layouts[] = {
+        { 1, 1 },
+        { 3, 1 },
+        { 8, 4 },
+        { 9, 16 },
+        { MAX_SLOTS, 1 },
+        { MAX_SLOTS, 64 },
+    };
+    BufferSlotMap map;
+    int failures = 0;
+
+    map.reset(0);
+    printf("%s: empty map\n", (map.find(&handles[0]) == -1) ? "PASS" : "FAIL");
+    failures += (map.find(&handles[0]) != -1);
+
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++) {
+        bool ok = checkSlots(map, layouts[i].count, layouts[i].stride);
+        printf("%s: %d handles %zu bytes apart\n", ok ? "PASS" : "FAIL",
+               layouts[i].count, layouts[i].stride * sizeof(handles[0]));
+        failures += !ok;
+    }
+
+    // A handle registered again, e.g. after getBuffers(reset) reordered the buffers
+    map.reset(4);
+    for (int slot = 0; slot < 4; slot++) {
+        map.insert(&handles[slot], slot);
+    }
+    map.insert(&handles[2], 3);
+    map.insert(&handles[3], 2);
+    bool ok = (map.find(&handles[2]) == 3) && (map.find(&handles[3]) == 2) &&
+              (map.find(&handles[0]) == 0) && (map.find(&handles[1]) == 1);
+    printf("%s: handles moved to other slots\n", ok ? "PASS" : "FAIL");
+    failures += !ok;
+
+    // A reset drops the handles of the previous buffers
+    map.reset(4);
+    ok = (map.find(&handles[0]) == -1) && (map.find(&handles[3]) == -1);
+    printf("%s: reset\n", ok ? "PASS" : "FAIL");
+    failures += !ok;
+
+    struct timespec start, end;
+    int found = 0;
+    checkSlots(map, 8, 4);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < TIMED_LOOKUPS; i++) {
+        found += map.find(&handles[(i & 7) * 4]) >= 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("%lld ns per lookup among 8 buffers, %d found\n",
+           ((end.tv_sec - start.tv_sec) * 1000000000LL + end.tv_nsec - start.tv_nsec) / TIMED_LOOKUPS,
+           found);
+
+    return failures ? 1 : 0;
+}
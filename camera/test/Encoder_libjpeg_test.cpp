@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* @file Encoder_libjpeg_test.cpp
+*
+* Encodes noise, the worst case for the entropy coder, with EXIF thumbnails
+* of growing size into buffers sized by Encoder_libjpeg::jpegSizeBound(), and
+* into a buffer too small for the picture, which has to fail the encode
+* without writing past the buffer. A capture is then encoded into a JpegBuffer
+* and handed to a fake request memory of the camera service, the way
+* AppCallbackNotifier::EncoderDoneCb() does, which has to map the encoded
+* bytes the encoder wrote rather than get them copied.
+*
+* Returns 0 when every case passes.
+*/
+
+#include "Encoder_libjpeg.h"
+
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+using namespace Ti::Camera;
+
+#define MAIN_WIDTH 640
+#define MAIN_HEIGHT 480
+#define GUARD_SIZE 4096
+#define GUARD_BYTE 0xA5
+
+static sem_t encoded;
+
+static void encoderDone(void* main_jpeg, void* thumb_jpeg, CameraFrame::FrameType type,
+                        void* cookie1, void* cookie2, void* cookie3, void* cookie4,
+                        bool canceled) {
+    sem_post(&encoded);
+}
+
+static uint8_t* allocNoise(int width, int height) {
+    size_t size = width * height * 3 / 2;
+    uint8_t* buf = (uint8_t*) malloc(size);
+
+    if (buf) {
+        for (size_t i = 0; i < size; i++) {
+            buf[i] = rand();
+        }
+    }
+    return buf;
+}
+
+static void setParams(Encoder_libjpeg::params* p, uint8_t* src, int width, int height,
+                      uint8_t* dst, int dst_size) {
+    memset(p, 0, sizeof(*p));
+    p->src = src;
+    p->src_size = width * height * 3 / 2;
+    p->dst = dst;
+    p->dst_size = dst_size;
+    p->quality = 100;
+    p->in_width = p->out_width = width;
+    p->in_height = p->out_height = height;
+    p->format = android::CameraParameters::PIXEL_FORMAT_YUV420SP;
+}
+
+// Length of the APP1 segment following SOI, 0 if there is none
+static size_t app1Size(const uint8_t* jpeg, size_t size) {
+    if ((size < 6) || (jpeg[0] != 0xFF) || (jpeg[1] != 0xD8) ||
+        (jpeg[2] != 0xFF) || (jpeg[3] != 0xE1)) {
+        return 0;
+    }
+    return (jpeg[4] << 8) | jpeg[5];
+}
+
+static void runEncoder(Encoder_libjpeg::params* main_jpeg, Encoder_libjpeg::params* tn_jpeg) {
+    android::sp<Encoder_libjpeg> encoder = new Encoder_libjpeg(main_jpeg, tn_jpeg, encoderDone,
+                                                               CameraFrame::IMAGE_FRAME,
+                                                               NULL, NULL, NULL, NULL);
+#ifdef ANDROID_API_N_OR_LATER
+    encoder->run("encoder_test");
+#else
+    encoder->run();
+#endif
+    sem_wait(&encoded);
+    encoder->join();
+}
+
+/**
+ * Encodes a MAIN_WIDTH x MAIN_HEIGHT picture into a buffer of dst_size
+ * bytes, with a tn_width x tn_height thumbnail when tn_width isn't 0.
+ * Returns the JPEG size and the one of the thumbnail in tn_size.
+ */
+static size_t encode(int tn_width, int tn_height, size_t dst_size, size_t* tn_size,
+                     uint8_t** out, bool* overrun) {
+    Encoder_libjpeg::params main_jpeg, tn_jpeg;
+    ExifElementsTable* exif = new ExifElementsTable();
+    uint8_t* src = allocNoise(MAIN_WIDTH, MAIN_HEIGHT);
+    uint8_t* tn_src = NULL;
+    uint8_t* tn_dst = NULL;
+    uint8_t* dst = (uint8_t*) malloc(dst_size + GUARD_SIZE);
+
+    *tn_size = 0;
+    *out = dst;
+    *overrun = false;
+    if (!src || !dst) {
+        free(src);
+        delete exif;
+        return 0;
+    }
+    memset(dst + dst_size, GUARD_BYTE, GUARD_SIZE);
+
+    exif->insertElement(TAG_MODEL, "Encoder_libjpeg_test");
+    setParams(&main_jpeg, src, MAIN_WIDTH, MAIN_HEIGHT, dst, dst_size);
+    main_jpeg.exif = exif;
+
+    if (tn_width) {
+        size_t tn_dst_size = Encoder_libjpeg::jpegSizeBound(tn_width, tn_height);
+        tn_src = allocNoise(tn_width, tn_height);
+        tn_dst = (uint8_t*) malloc(tn_dst_size);
+        setParams(&tn_jpeg, tn_src, tn_width, tn_height, tn_dst, tn_dst_size);
+    }
+
+    runEncoder(&main_jpeg, tn_width ? &tn_jpeg : NULL);
+
+    if (tn_width) {
+        *tn_size = tn_jpeg.jpeg_size;
+    }
+    for (int i = 0; i < GUARD_SIZE; i++) {
+        *overrun = *overrun || (dst[dst_size + i] != GUARD_BYTE);
+    }
+
+    free(tn_dst);
+    free(tn_src);
+    free(src);
+    delete exif;
+    return main_jpeg.jpeg_size;
+}
+
+// Bytes of request memory allocated without an fd, which the HAL would copy into
+static size_t requestCopyBytes;
+
+static void releaseRequest(camera_memory_t* mem) {
+    if (mem->handle) {
+        munmap(mem->data, mem->size);
+    } else {
+        requestCopyBytes -= mem->size;
+        free(mem->data);
+    }
+    delete mem;
+}
+
+// Like the camera service: maps the fd, or allocates the memory without one
+static camera_memory_t* requestMemory(int fd, size_t buf_size, unsigned int num_bufs,
+                                      void* user) {
+    camera_memory_t* mem = new camera_memory_t;
+
+    mem->size = buf_size * num_bufs;
+    mem->release = releaseRequest;
+    if (fd >= 0) {
+        mem->data = mmap(NULL, mem->size, PROT_READ, MAP_SHARED, fd, 0);
+        mem->handle = mem;
+        if (mem->data == MAP_FAILED) {
+            delete mem;
+            return NULL;
+        }
+    } else {
+        mem->data = malloc(mem->size);
+        mem->handle = NULL;
+        requestCopyBytes += mem->size;
+    }
+    return mem;
+}
+
+/**
+ * Encodes a capture with a thumbnail into a JpegBuffer and shares it through
+ * requestMemory(). Returns whether the app got the encoded bytes over the
+ * pages of the buffer, the JPEG size in jpeg_size and the bytes the HAL would
+ * have had to copy in copied.
+ */
+static bool shareCapture(size_t* jpeg_size, size_t* copied) {
+    Encoder_libjpeg::params main_jpeg, tn_jpeg;
+    ExifElementsTable* exif = new ExifElementsTable();
+    size_t tn_dst_size = Encoder_libjpeg::jpegSizeBound(160, 120);
+    uint8_t* src = allocNoise(MAIN_WIDTH, MAIN_HEIGHT);
+    uint8_t* tn_src = allocNoise(160, 120);
+    uint8_t* tn_dst = (uint8_t*) malloc(tn_dst_size);
+    JpegBuffer* buffer = JpegBuffer::allocate(Encoder_libjpeg::jpegSizeBound(MAIN_WIDTH,
+                                                                             MAIN_HEIGHT));
+    camera_memory_t* picture = NULL;
+    bool ok = false;
+
+    *jpeg_size = 0;
+    *copied = 0;
+    if (src && tn_src && tn_dst && buffer) {
+        exif->insertElement(TAG_MODEL, "Encoder_libjpeg_test");
+        setParams(&main_jpeg, src, MAIN_WIDTH, MAIN_HEIGHT, buffer->data, buffer->size);
+        main_jpeg.exif = exif;
+        setParams(&tn_jpeg, tn_src, 160, 120, tn_dst, tn_dst_size);
+        runEncoder(&main_jpeg, &tn_jpeg);
+        *jpeg_size = main_jpeg.jpeg_size;
+    }
+
+    if (*jpeg_size > 0) {
+        requestCopyBytes = 0;
+        picture = buffer->share(requestMemory, *jpeg_size);
+        *copied = requestCopyBytes;
+    }
+    if (picture) {
+        const uint8_t* data = (const uint8_t*) picture->data;
+
+        // The app gets the complete file, EXIF included, over the same pages
+        ok = (picture->size == *jpeg_size) && (app1Size(data, picture->size) > 0) &&
+             !memcmp(data, buffer->data, *jpeg_size);
+        buffer->data[1] ^= 0xFF;
+        ok = ok && (data[1] == buffer->data[1]);
+        picture->release(picture);
+    }
+
+    delete buffer;
+    free(tn_dst);
+    free(tn_src);
+    free(src);
+    delete exif;
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    static const struct {
+        int width;
+        int height;
+        bool embedded;  // fits in the 64KB APP1 segment
+    } thumbnails[] = {
+        { 0, 0, false },
+        { 160, 120, true },
+        { 320, 240, false },
+        { 640, 480, false },
+    };
+    size_t bound = Encoder_libjpeg::jpegSizeBound(MAIN_WIDTH, MAIN_HEIGHT);
+    int failures = 0;
+    uint8_t* out;
+    bool overrun;
+    size_t size, tn_size;
+
+    sem_init(&encoded, 0, 0);
+    srand(1);
+
+    for (size_t i = 0; i < sizeof(thumbnails) / sizeof(thumbnails[0]); i++) {
+        size = encode(thumbnails[i].width, thumbnails[i].height, bound, &tn_size, &out, &overrun);
+        size_t app1 = app1Size(out, size);
+        bool ok = (size > 0) && (size <= bound) && !overrun && (app1 > 0) &&
+                  (!thumbnails[i].embedded || ((tn_size > 0) && (app1 > tn_size)));
+
+        printf("%s: %dx%d thumbnail of %zu bytes, APP1 %zu bytes, %zu of %zu bytes\n",
+               ok ? "PASS" : "FAIL", thumbnails[i].width, thumbnails[i].height,
+               tn_size, app1, size, bound);
+        failures += !ok;
+        free(out);
+    }
+
+    // A buffer too small for the picture fails the encode
+    size = encode(160, 120, bound / 16, &tn_size, &out, &overrun);
+    printf("%s: %zu bytes into a %zu byte buffer%s\n", (size == 0) && !overrun ? "PASS" : "FAIL",
+           size, bound / 16, overrun ? ", written past its end" : "");
+    failures += (size != 0) || overrun;
+    free(out);
+
+    // The app maps the encoded bytes of the capture instead of a copy of them
+    size_t copied;
+    bool ok = shareCapture(&size, &copied) && (copied == 0);
+    printf("%s: %zu byte capture shared, %zu bytes copied per capture\n", ok ? "PASS" : "FAIL",
+           size, copied);
+    failures += !ok;
+
+    sem_destroy(&encoded);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* @file PreviewCallbackRing_test.cpp
+*
+* Runs the preview callback path of AppCallbackNotifier against an app slower
+* than the preview: an adapter thread queues frames from a few buffers, and
+* the notifier takes a slot from PreviewCallbackRing, converts the NV12 frame
+* to NV21 into it, or copies it for data sync frames, returns the frame and
+* calls the app. Measures the CPU time spent on stale frames, the ones with
+* newer frames already queued behind them, with and without latest-only.
+* Halfway through, a slot is held as thumbnail source and checked to be left
+* alone until it is released.
+*
+* Returns 0 when every case passes.
+*/
+
+#include "PreviewCallbackRing.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace Ti::Camera;
+
+#define WIDTH 640
+#define HEIGHT 480
+#define FRAME_SIZE (WIDTH * HEIGHT * 3 / 2)
+// Preview buffers the adapter cycles through, frames wait in the queue on them
+#define ADAPTER_BUFFERS 6
+#define FRAMES 200
+#define FRAME_PERIOD_US 10000
+#define SLOW_APP_US 40000
+#define FAST_APP_US 0
+#define THUMBNAIL_FRAMES 20
+
+static uint8_t adapterBuffers[ADAPTER_BUFFERS][FRAME_SIZE];
+static uint8_t slots[PreviewCallbackRing::MAX_SLOTS][FRAME_SIZE];
+
+// The frame queue of the notifier, holding adapter buffer indexes
+static pthread_mutex_t queueLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queueCond = PTHREAD_COND_INITIALIZER;
+static int queue[ADAPTER_BUFFERS];
+static int queueHead, queueCount;
+static bool adapterDone;
+static bool adapterBusy[ADAPTER_BUFFERS];
+static unsigned int adapterDrops;
+
+static PreviewCallbackRing ring;
+
+static int64_t threadCpuUs() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void push(int buffer) {
+    pthread_mutex_lock(&queueLock);
+    queue[(queueHead + queueCount++) % ADAPTER_BUFFERS] = buffer;
+    pthread_cond_signal(&queueCond);
+    pthread_mutex_unlock(&queueLock);
+}
+
+// Returns the next buffer, -1 at the end, and in behind the frames left queued
+static int pop(int* behind) {
+    int buffer = -1;
+
+    pthread_mutex_lock(&queueLock);
+    while (!queueCount && !adapterDone) {
+        pthread_cond_wait(&queueCond, &queueLock);
+    }
+    if (queueCount) {
+        buffer = queue[queueHead];
+        queueHead = (queueHead + 1) % ADAPTER_BUFFERS;
+        *behind = --queueCount;
+    }
+    pthread_mutex_unlock(&queueLock);
+    return buffer;
+}
+
+static void returnFrame(int buffer) {
+    pthread_mutex_lock(&queueLock);
+    adapterBusy[buffer] = false;
+    pthread_mutex_unlock(&queueLock);
+}
+
+// Queues a frame every FRAME_PERIOD_US, dropping it when no buffer is free
+static void* adapterThread(void*) {
+    struct timespec next;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (int i = 0; i < FRAMES; i++) {
+        int buffer = -1;
+
+        next.tv_nsec += FRAME_PERIOD_US * 1000;
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        pthread_mutex_lock(&queueLock);
+        for (int b = 0; (b < ADAPTER_BUFFERS) && (buffer < 0); b++) {
+            if (!adapterBusy[b]) {
+                adapterBusy[b] = true;
+                buffer = b;
+            }
+        }
+        adapterDrops += (buffer < 0);
+        pthread_mutex_unlock(&queueLock);
+
+        if (buffer >= 0) {
+            adapterBuffers[buffer][0] = i;
+            ring.queued();
+            push(buffer);
+        }
+    }
+    pthread_mutex_lock(&queueLock);
+    adapterDone = true;
+    pthread_cond_signal(&queueCond);
+    pthread_mutex_unlock(&queueLock);
+    return NULL;
+}
+
+// NV12 to the NV21 apps get for YUV420SP
+static void convert(uint8_t* dst, const uint8_t* src) {
+    memcpy(dst, src, WIDTH * HEIGHT);
+    for (int i = WIDTH * HEIGHT; i < FRAME_SIZE; i += 2) {
+        dst[i] = src[i + 1];
+        dst[i + 1] = src[i];
+    }
+}
+
+struct Result {
+    unsigned int delivered;
+    unsigned int staleFrames;
+    int64_t cpuUs;
+    int64_t staleCpuUs;
+    size_t bytesCopied;
+    bool thumbnailIntact;
+};
+
+static void run(bool latestOnly, bool dataSync, int appUs, Result* r) {
+    pthread_t adapter;
+    int thumbnail = -1, thumbnailTag = 0, held = 0;
+    int behind, buffer;
+
+    memset(r, 0, sizeof(*r));
+    r->thumbnailIntact = true;
+    memset(adapterBusy, 0, sizeof(adapterBusy));
+    adapterDrops = 0;
+    adapterDone = false;
+    ring.reset(PreviewCallbackRing::MAX_SLOTS);
+    ring.setLatestOnly(latestOnly);
+
+    pthread_create(&adapter, NULL, adapterThread, NULL);
+    while ((buffer = pop(&behind)) >= 0) {
+        ring.dequeued();
+
+        int slot = ring.acquire(true);
+        if (slot >= 0) {
+            int64_t start = threadCpuUs();
+            if (dataSync) {
+                memcpy(slots[slot], adapterBuffers[buffer], FRAME_SIZE);
+                r->bytesCopied += FRAME_SIZE;
+            } else {
+                convert(slots[slot], adapterBuffers[buffer]);
+            }
+            int64_t cpu = threadCpuUs() - start;
+            ring.converted(slot);
+            r->cpuUs += cpu;
+            if (behind) {
+                r->staleFrames++;
+                r->staleCpuUs += cpu;
+            }
+        }
+        returnFrame(buffer);
+
+        if (slot >= 0) {
+            usleep(appUs);
+            r->delivered++;
+            ring.release(slot);
+        }
+
+        // A snapshot holds the newest frame as thumbnail source for a while
+        if ((thumbnail < 0) && (r->delivered == FRAMES / 8)) {
+            thumbnail = ring.holdLatest();
+            thumbnailTag = slots[thumbnail][0];
+        } else if ((thumbnail >= 0) && (++held == THUMBNAIL_FRAMES)) {
+            r->thumbnailIntact = (slots[thumbnail][0] == thumbnailTag);
+            ring.release(thumbnail);
+        }
+    }
+    pthread_join(adapter, NULL);
+    r->thumbnailIntact = r->thumbnailIntact && (thumbnail >= 0);
+}
+
+static void print(const char* name, bool ok, const Result* r) {
+    printf("%s: %s, %u of %u frames delivered, %u skipped, %u dropped, %u at the adapter\n",
+           ok ? "PASS" : "FAIL", name, r->delivered, FRAMES, ring.skippedFrames(),
+           ring.droppedFrames(), adapterDrops);
+    printf("      %lld us CPU converting, %lld us on %u stale frames, %zu bytes copied per frame%s\n",
+           (long long) r->cpuUs, (long long) r->staleCpuUs, r->staleFrames,
+           r->delivered ? r->bytesCopied / r->delivered : 0,
+           r->thumbnailIntact ? "" : ", thumbnail overwritten");
+}
+
+int main(int argc, char** argv) {
+    Result every, latest, sync, fast;
+    int failures = 0;
+    bool ok;
+
+    for (size_t i = 0; i < sizeof(adapterBuffers[0]); i++) {
+        adapterBuffers[0][i] = rand();
+    }
+    for (int b = 1; b < ADAPTER_BUFFERS; b++) {
+        memcpy(adapterBuffers[b], adapterBuffers[0], FRAME_SIZE);
+    }
+
+    // Every frame is converted, most of them after newer ones arrived
+    run(false, false, SLOW_APP_US, &every);
+    ok = (every.staleFrames > 0) && every.thumbnailIntact;
+    print("slow app, every frame", ok, &every);
+    failures += !ok;
+
+    // Frames with newer ones queued are returned without being converted
+    run(true, false, SLOW_APP_US, &latest);
+    ok = (latest.staleFrames == 0) && (ring.skippedFrames() > 0) &&
+         (latest.staleCpuUs * 20 <= every.staleCpuUs) && latest.thumbnailIntact;
+    print("slow app, latest only", ok, &latest);
+    failures += !ok;
+
+    // Data sync frames aren't converted, the delivered ones are still copied
+    run(true, true, SLOW_APP_US, &sync);
+    ok = (sync.staleFrames == 0) && (sync.bytesCopied == (size_t) sync.delivered * FRAME_SIZE) &&
+         sync.thumbnailIntact;
+    print("slow app, latest only, data sync", ok, &sync);
+    failures += !ok;
+
+    // An app keeping up gets the frames, latest-only hardly skips any
+    run(true, false, FAST_APP_US, &fast);
+    ok = (ring.skippedFrames() * 20 <= FRAMES) && fast.thumbnailIntact;
+    print("app keeping up, latest only", ok, &fast);
+    failures += !ok;
+
+    return failures ? 1 : 0;
+}
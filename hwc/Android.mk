@@ -5,9 +5,9 @@ LOCAL_PATH := $(call my-dir)
 include $(CLEAR_VARS)
 LOCAL_ARM_MODE := arm
 LOCAL_MODULE_PATH := $(TARGET_OUT_SHARED_LIBRARIES)/../vendor/lib/hw
-LOCAL_SHARED_LIBRARIES := liblog libEGL libcutils libutils libhardware libhardware_legacy libz
+LOCAL_SHARED_LIBRARIES := liblog libEGL libcutils libutils libhardware libhardware_legacy libz libdl
 
-LOCAL_SRC_FILES := hwc.c rgz_2d.c dock_image.c sw_vsync.c display.c
+LOCAL_SRC_FILES := hwc.c hwc_plan.c dss_search.c rgz_2d.c hwc_capture.c hwc_stats.c dock_image.c sw_vsync.c display.c
 LOCAL_CFLAGS := -DLOG_TAG=\"ti_hwc\" -Wall -Werror
 
 LOCAL_SHARED_LIBRARIES += libion
@@ -22,6 +22,13 @@ ifdef OMAP_ENHANCEMENT_HWC_EXTENDED_API
 LOCAL_CFLAGS += -DOMAP_ENHANCEMENT_HWC_EXTENDED_API
 endif
 
+# Requires a SurfaceFlinger using HWC 1.3
+ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+LOCAL_CFLAGS += -DOMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+LOCAL_SRC_FILES += virtual_display.c
+LOCAL_SHARED_LIBRARIES += libsync
+endif
+
 LOCAL_STATIC_LIBRARIES := libpng
 
 LOCAL_MODULE_TAGS := optional
@@ -31,9 +38,152 @@ LOCAL_C_INCLUDES += external/libpng external/zlib
 
 LOCAL_C_INCLUDES += \
     $(LOCAL_PATH)/../edid/inc \
-    $(LOCAL_PATH)/../include
+    $(LOCAL_PATH)/../include \
+    $(LOCAL_PATH)/../bltsville/bltsville/include
 LOCAL_SHARED_LIBRARIES += libedid
 
 # LOG_NDEBUG=0 means verbose logging enabled
 # LOCAL_CFLAGS += -DLOG_NDEBUG=0
 include $(BUILD_SHARED_LIBRARY)
+
+# ====================
+# Reads the traces captured with debug.hwc.capture
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := cmd/hwc_trace.c
+LOCAL_CFLAGS := -Wall -Werror
+
+LOCAL_MODULE := hwc_trace
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+# Replays captured traces through hwc_prepare and hwc_set with gralloc, ION,
+# dsscomp and the framebuffer stubbed, see cmd/hwc_replay.c
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := cmd/hwc_replay.c hwc.c hwc_plan.c dss_search.c rgz_2d.c hwc_capture.c hwc_stats.c sw_vsync.c display.c
+LOCAL_CFLAGS := -DLOG_TAG=\"hwc_replay\" -Wall -Werror
+ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+LOCAL_CFLAGS += -DOMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+LOCAL_SRC_FILES += virtual_display.c
+endif
+LOCAL_C_INCLUDES += \
+    $(LOCAL_PATH) \
+    $(LOCAL_PATH)/../kernel-headers \
+    $(LOCAL_PATH)/../libion \
+    $(LOCAL_PATH)/../include \
+    $(LOCAL_PATH)/../edid/inc \
+    $(LOCAL_PATH)/../bltsville/bltsville/include
+LOCAL_STATIC_LIBRARIES := libutils libcutils liblog
+# The replay stands for the device nodes and the properties the HAL reads
+LOCAL_LDFLAGS := -Wl,--wrap=open,--wrap=ioctl,--wrap=property_get
+LOCAL_LDLIBS := -lm -lpthread -lrt -ldl
+
+LOCAL_MODULE := hwc_replay
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+# ====================
+# Checks the regionizer blits against a reference composition and times the
+# regionizer on generated or captured layer stacks, see test/rgz_test.c
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := test/rgz_test.c test/bv_cpu.c rgz_2d.c
+LOCAL_CFLAGS := -DLOG_TAG=\"rgz_test\" -Wall -Werror
+LOCAL_C_INCLUDES += \
+    $(LOCAL_PATH) \
+    $(LOCAL_PATH)/../kernel-headers \
+    $(LOCAL_PATH)/../bltsville/bltsville/include
+LOCAL_STATIC_LIBRARIES := libcutils liblog
+
+LOCAL_MODULE := rgz_test
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_HOST_EXECUTABLE)
+
+# Checks the virtual display composition against a reference one, behind
+# fences and with the blits completing late, and times it, see test/vd_test.c
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := test/vd_test.c test/bv_cpu.c virtual_display.c rgz_2d.c
+LOCAL_CFLAGS := -DLOG_TAG=\"vd_test\" -Wall -Werror -DOMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+LOCAL_C_INCLUDES += \
+    $(LOCAL_PATH) \
+    $(LOCAL_PATH)/../kernel-headers \
+    $(LOCAL_PATH)/../bltsville/bltsville/include
+LOCAL_STATIC_LIBRARIES := libutils libcutils liblog
+# The test stands for the BLTsville libraries virtual_display.c loads
+LOCAL_LDFLAGS := -Wl,--wrap=dlopen,--wrap=dlsym,--wrap=dlclose,--wrap=dlerror
+LOCAL_LDLIBS := -lpthread -lrt
+
+LOCAL_MODULE := vd_test
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_HOST_EXECUTABLE)
+
+# Checks which layer changes reuse the composition plan of hwc_prepare, times
+# the plan match and replays captured traces through it, see test/plan_test.c
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := test/plan_test.c hwc_plan.c
+LOCAL_CFLAGS := -DLOG_TAG=\"plan_test\" -Wall -Werror
+ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+LOCAL_CFLAGS += -DOMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+endif
+LOCAL_C_INCLUDES += \
+    $(LOCAL_PATH) \
+    $(LOCAL_PATH)/../kernel-headers \
+    $(LOCAL_PATH)/../bltsville/bltsville/include
+
+LOCAL_MODULE := plan_test
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_HOST_EXECUTABLE)
+
+# Runs the s/w vsync thread under CPU load and checks its timeline, missed
+# vsync accounting and phase locking, see test/vsync_test.c
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := test/vsync_test.c sw_vsync.c hwc_stats.c
+LOCAL_CFLAGS := -DLOG_TAG=\"vsync_test\" -Wall -Werror
+LOCAL_C_INCLUDES += \
+    $(LOCAL_PATH) \
+    $(LOCAL_PATH)/../kernel-headers \
+    $(LOCAL_PATH)/../bltsville/bltsville/include
+LOCAL_STATIC_LIBRARIES := libutils libcutils liblog
+LOCAL_LDLIBS := -lpthread -lrt
+
+LOCAL_MODULE := vsync_test
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_HOST_EXECUTABLE)
+
+# Checks the composition statistics of the dump and times their recording,
+# see test/stats_test.c
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := test/stats_test.c hwc_stats.c
+LOCAL_CFLAGS := -DLOG_TAG=\"stats_test\" -Wall -Werror
+LOCAL_C_INCLUDES += $(LOCAL_PATH)
+LOCAL_STATIC_LIBRARIES := libutils libcutils liblog
+LOCAL_LDLIBS := -lpthread -lrt
+
+LOCAL_MODULE := stats_test
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_HOST_EXECUTABLE)
+
+# Compares the choice of the DSS layers with all the layer subsets and times
+# it, see test/dss_test.c
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := test/dss_test.c dss_search.c
+LOCAL_CFLAGS := -Wall -Werror
+LOCAL_C_INCLUDES += $(LOCAL_PATH)
+
+LOCAL_MODULE := dss_test
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_HOST_EXECUTABLE)
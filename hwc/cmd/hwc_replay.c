@@ -0,0 +1,816 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Replays the traces captured with debug.hwc.capture through the HWC on the
+ * host
+ *
+ *   hwc_replay [-o <trace>] [-p <property>=<value>]... <trace>
+ *
+ * hwc.c and the rest of the HAL are linked against stubs of gralloc, ION,
+ * dsscomp, the framebuffer, EGL and the uevents, so the calls of a trace are
+ * executed again: the layers of each captured prepare go to hwc_prepare the
+ * way SurfaceFlinger hands them, keeping the composition types of the
+ * previous frame unless the geometry changed, then hwc_set posts them with
+ * the framebuffer target of the captured set.
+ *
+ * Reports the CPU time of each call, how many frames were composed with the
+ * DSS pipes only, SGX and the pipes or with blits, and the frames decided
+ * otherwise than on the device. -p sets a property the HAL reads when it is
+ * opened, e.g. persist.hwc.bltpolicy, the other ones keep their defaults.
+ *
+ * -o makes the HAL capture the replayed calls itself. Replaying a trace with
+ * two builds of the HAL and comparing their captures with hwc_trace -d lists
+ * the decisions that changed from one build to the other.
+ *
+ * Only the primary display is replayed, the external display stays
+ * disconnected. The platform limits are the ones of the OMAP4 dsscomp driver
+ * and the LCD runs at 60fps, so decisions depending on the bandwidth of a
+ * second display or the idle fallback to SGX may differ from the captured
+ * ones.
+ *
+ * Returns 0 when every frame is decided as captured.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <linux/types.h>
+#include <linux/fb.h>
+
+#include <cutils/properties.h>
+#include <hardware/hardware.h>
+#include <hardware/hwcomposer.h>
+#include <hardware_legacy/uevent.h>
+#include <EGL/egl.h>
+#include <ion/ion.h>
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+#include <sync/sync.h>
+#endif
+#include "ion_ti_custom.h"
+
+#include "../hwc_dev.h"
+#include "../hwc_trace.h"
+#include "../dock_image.h"
+
+#define MAX_PROPERTIES 32
+/* Differing frames printed before only counting them */
+#define MAX_PRINTED_DIFFS 20
+
+/* The LCD the trace was captured on, as reported by dsscomp */
+#define LCD_FPS 60
+#define LCD_BLANKING 110        /* percent of the visible pixels */
+
+extern omap_hwc_module_t HAL_MODULE_INFO_SYM;
+
+static struct hwc_trace_header header;
+
+/* ---- properties ---- */
+
+static struct {
+    const char *key;
+    const char *value;
+} properties[MAX_PROPERTIES];
+static int num_properties;
+
+int __wrap_property_get(const char *key, char *value, const char *default_value)
+{
+    const char *v = default_value ? default_value : "";
+    int i;
+
+    for (i = 0; i < num_properties; i++) {
+        if (!strcmp(properties[i].key, key))
+            v = properties[i].value;
+    }
+    snprintf(value, PROPERTY_VALUE_MAX, "%s", v);
+    return strlen(value);
+}
+
+static int set_property(const char *key, const char *value)
+{
+    if (num_properties == MAX_PROPERTIES)
+        return -1;
+    properties[num_properties].key = key;
+    properties[num_properties].value = value;
+    num_properties++;
+    return 0;
+}
+
+/* ---- devices: dsscomp, the framebuffers and the 2D core ---- */
+
+enum { DEV_DSSCOMP, DEV_FB0, DEV_FB1, DEV_GC2D, NUM_DEVS };
+
+static const char *const dev_paths[NUM_DEVS] = {
+    "/dev/dsscomp", "/dev/graphics/fb0", "/dev/graphics/fb1", "/dev/gcioctl",
+};
+static int dev_fds[NUM_DEVS] = { -1, -1, -1, -1 };
+
+int __real_open(const char *path, int flags, ...);
+
+/* The switches, the EDID and the S3D controls of the HDMI display are absent */
+int __wrap_open(const char *path, int flags, ...)
+{
+    int i;
+
+    (void)flags;
+    for (i = 0; i < NUM_DEVS; i++) {
+        if (!strcmp(path, dev_paths[i])) {
+            dev_fds[i] = __real_open("/dev/null", O_RDWR);
+            return dev_fds[i];
+        }
+    }
+    errno = ENOENT;
+    return -1;
+}
+
+static int query_display(struct dsscomp_display_info *dis)
+{
+    if (dis->ix) {
+        errno = ENODEV;
+        return -1;
+    }
+    dis->channel = OMAP_DSS_CHANNEL_LCD;
+    dis->state = OMAP_DSS_DISPLAY_ACTIVE;
+    dis->enabled = 1;
+    dis->timings.x_res = header.fb_width;
+    dis->timings.y_res = header.fb_height;
+    dis->timings.pixel_clock = (uint64_t)header.fb_width * header.fb_height * LCD_FPS *
+                               LCD_BLANKING / 100 / 1000;
+    dis->width_in_mm = dis->height_in_mm = 0;
+    return 0;
+}
+
+static int dsscomp_ioctl(unsigned long request, void *arg)
+{
+    struct dsscomp_platform_info *limits = arg;
+
+    switch (request) {
+    case DSSCIOC_QUERY_PLATFORM:
+        memset(limits, 0, sizeof(*limits));
+        limits->max_xdecim_1d = 16;
+        limits->max_xdecim_2d = 16;
+        limits->max_ydecim_1d = 16;
+        limits->max_ydecim_2d = 2;
+        limits->fclk = 170666666;
+        limits->min_width = 2;
+        limits->max_width = 2048;
+        limits->max_height = 2048;
+        limits->max_downscale = 4;
+        limits->integer_scale_ratio_limit = 2048;
+        limits->tiler1d_slot_size = 16 * 1024 * 1024;
+        limits->fbmem_type = DSSCOMP_FBMEM_TILER2D;
+        return 0;
+    case DSSCIOC_QUERY_DISPLAY:
+        return query_display(arg);
+    case DSSCIOC_SETUP_DISPC:
+    case DSSCIOC_SETUP_DISPLAY:
+        return 0;
+    }
+    errno = ENOTTY;
+    return -1;
+}
+
+static int fb_ioctl(unsigned long request, void *arg)
+{
+    int bpp = header.fb_format == HAL_PIXEL_FORMAT_RGB_565 ? 16 : 32;
+    struct fb_fix_screeninfo *fix = arg;
+    struct fb_var_screeninfo *var = arg;
+
+    switch (request) {
+    case FBIOGET_FSCREENINFO:
+        memset(fix, 0, sizeof(*fix));
+        fix->line_length = header.fb_width * bpp / 8;
+        return 0;
+    case FBIOGET_VSCREENINFO:
+        memset(var, 0, sizeof(*var));
+        var->xres = var->xres_virtual = header.fb_width;
+        var->yres = var->yres_virtual = header.fb_height;
+        var->bits_per_pixel = bpp;
+        return 0;
+    }
+    /* Blanking and the vsync control */
+    return 0;
+}
+
+int __wrap_ioctl(int fd, unsigned long request, ...)
+{
+    va_list ap;
+    void *arg;
+
+    va_start(ap, request);
+    arg = va_arg(ap, void *);
+    va_end(ap);
+
+    if (fd >= 0 && fd == dev_fds[DEV_DSSCOMP])
+        return dsscomp_ioctl(request, arg);
+    if (fd >= 0 && (fd == dev_fds[DEV_FB0] || fd == dev_fds[DEV_FB1]))
+        return fb_ioctl(request, arg);
+    errno = ENOTTY;
+    return -1;
+}
+
+/* ---- gralloc and the framebuffer HAL ---- */
+
+static int posts;
+
+static int post2(framebuffer_device_t *fb, buffer_handle_t *buffers, int num_buffers,
+                 void *data, int data_length)
+{
+    (void)fb;
+    (void)buffers;
+    (void)num_buffers;
+    (void)data;
+    (void)data_length;
+    posts++;
+    return 0;
+}
+
+static IMG_framebuffer_device_public_t fb_dev = {
+    .Post2 = post2,
+};
+
+static IMG_gralloc_module_public_t gralloc_module = {
+    .base = {
+        .common = {
+            .tag = HARDWARE_MODULE_TAG,
+            .id = GRALLOC_HARDWARE_MODULE_ID,
+            .name = "hwc_replay gralloc",
+            .author = "Imagination Technologies",
+        },
+    },
+    .psFrameBufferDevice = &fb_dev,
+};
+
+int hw_get_module(const char *id, const struct hw_module_t **module)
+{
+    if (strcmp(id, GRALLOC_HARDWARE_MODULE_ID))
+        return -ENOENT;
+    *module = &gralloc_module.base.common;
+    return 0;
+}
+
+/* Like gralloc does, the attributes of the framebuffer HAL are constant */
+static void init_fb_dev(void)
+{
+    *(uint32_t *)&fb_dev.base.width = header.fb_width;
+    *(uint32_t *)&fb_dev.base.height = header.fb_height;
+    *(int *)&fb_dev.base.stride = header.fb_width;
+    *(int *)&fb_dev.base.format = header.fb_format;
+    *(float *)&fb_dev.base.xdpi = 160;
+    *(float *)&fb_dev.base.ydpi = 160;
+    *(float *)&fb_dev.base.fps = LCD_FPS;
+}
+
+/* ---- ION, EGL, uevents and the dock image ---- */
+
+/* There is no TILER, it only backs the external display */
+int ion_open(void)
+{
+    errno = ENODEV;
+    return -1;
+}
+
+int ion_close(int fd)
+{
+    (void)fd;
+    return 0;
+}
+
+int ion_free(int fd, ion_user_handle_t handle)
+{
+    (void)fd;
+    (void)handle;
+    return 0;
+}
+
+int ion_alloc_tiler(int fd, size_t w, size_t h, int fmt, unsigned int flags,
+                    struct ion_handle **handle, size_t *stride)
+{
+    (void)fd;
+    (void)w;
+    (void)h;
+    (void)fmt;
+    (void)flags;
+    (void)handle;
+    (void)stride;
+    return -ENODEV;
+}
+
+EGLBoolean eglSwapBuffers(EGLDisplay dpy, EGLSurface surface)
+{
+    (void)dpy;
+    (void)surface;
+    return EGL_TRUE;
+}
+
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+/* Virtual displays aren't replayed, without a timeline they'd compose in set */
+int sync_wait(int fd, int timeout)
+{
+    struct pollfd p = { .fd = fd, .events = POLLIN };
+    int ret = poll(&p, 1, timeout);
+
+    if (ret > 0)
+        return 0;
+    if (!ret)
+        errno = ETIME;
+    return -1;
+}
+
+int sw_sync_timeline_create(void)
+{
+    errno = ENOENT;
+    return -1;
+}
+
+int sw_sync_timeline_inc(int fd, unsigned count)
+{
+    (void)fd;
+    (void)count;
+    return -EINVAL;
+}
+
+int sw_sync_fence_create(int fd, const char *name, unsigned value)
+{
+    (void)fd;
+    (void)name;
+    (void)value;
+    return -EINVAL;
+}
+#endif
+
+/* No hotplug ever comes, the fd stays silent */
+static int uevent_fds[2] = { -1, -1 };
+
+int uevent_init(void)
+{
+    return !pipe(uevent_fds);
+}
+
+int uevent_get_fd(void)
+{
+    return uevent_fds[0];
+}
+
+int uevent_next_event(char *buffer, int buffer_length)
+{
+    (void)buffer;
+    (void)buffer_length;
+    return 0;
+}
+
+int init_dock_image(omap_hwc_device_t *hwc_dev, uint32_t max_width, uint32_t max_height)
+{
+    (void)hwc_dev;
+    (void)max_width;
+    (void)max_height;
+    return 0;
+}
+
+void load_dock_image()
+{
+}
+
+image_info_t *get_dock_image()
+{
+    static image_info_t image;
+    return &image;
+}
+
+/* ---- buffers ---- */
+
+/*
+ * A buffer for each captured handle and set of attributes, a handle freed on
+ * the device may come back for another buffer
+ */
+struct buffer {
+    IMG_native_handle_t handle;
+    uint64_t trace_handle;
+    struct buffer *next;
+};
+
+static struct buffer *buffers;
+
+static buffer_handle_t get_buffer(struct hwc_trace_layer *l)
+{
+    struct buffer *b;
+
+    if (!l->handle)
+        return NULL;
+    for (b = buffers; b; b = b->next) {
+        if (b->trace_handle == l->handle && b->handle.iFormat == l->format &&
+            b->handle.iWidth == l->width && b->handle.iHeight == l->height &&
+            b->handle.usage == l->usage)
+            return (buffer_handle_t)&b->handle;
+    }
+    b = calloc(1, sizeof(*b));
+    if (!b)
+        return NULL;
+    b->handle.base.version = sizeof(native_handle_t);
+    b->handle.base.numFds = IMG_NATIVE_HANDLE_NUMFDS;
+    b->handle.base.numInts = IMG_NATIVE_HANDLE_NUMINTS;
+    b->handle.iFormat = l->format;
+    b->handle.iWidth = l->width;
+    b->handle.iHeight = l->height;
+    b->handle.usage = l->usage;
+    b->trace_handle = l->handle;
+    b->next = buffers;
+    buffers = b;
+    return (buffer_handle_t)&b->handle;
+}
+
+static void free_buffers(void)
+{
+    while (buffers) {
+        struct buffer *b = buffers;
+        buffers = b->next;
+        free(b);
+    }
+}
+
+/* ---- trace ---- */
+
+struct call {
+    struct hwc_trace_call call;
+    struct hwc_trace_layer *layers;
+    uint32_t size;
+};
+
+/* Reads the next call, its layers only. Returns 0 at the end of the trace. */
+static int read_call(FILE *f, struct call *c)
+{
+    if (fread(&c->call, sizeof(c->call), 1, f) != 1)
+        return 0;
+    if (c->call.num_layers > c->size) {
+        void *p = realloc(c->layers, c->call.num_layers * sizeof(*c->layers));
+        if (!p)
+            return -1;
+        c->layers = p;
+        c->size = c->call.num_layers;
+    }
+    if (fread(c->layers, sizeof(*c->layers), c->call.num_layers, f) != c->call.num_layers ||
+        fseek(f, c->call.num_ovls * sizeof(struct hwc_trace_ovl) +
+                 c->call.num_blits * sizeof(struct hwc_trace_blit), SEEK_CUR))
+        return -1;
+    return 1;
+}
+
+/* ---- replay ---- */
+
+static struct {
+    int prepares;
+    int sets;
+    int all_ovl;
+    int sgx;
+    int blit;
+    int differing;
+    int64_t *prepare_times;
+    int64_t *set_times;
+    int size;
+} stats;
+
+static int64_t cpu_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int record_time(int64_t **times, int n, int64_t time)
+{
+    if (n == stats.size) {
+        int size = stats.size ? stats.size * 2 : 1024;
+        int64_t *p = realloc(stats.prepare_times, size * sizeof(*p));
+        if (!p)
+            return -1;
+        stats.prepare_times = p;
+        p = realloc(stats.set_times, size * sizeof(*p));
+        if (!p)
+            return -1;
+        stats.set_times = p;
+        stats.size = size;
+    }
+    (*times)[n] = time;
+    return 0;
+}
+
+static void to_hwc_rect(hwc_rect_t *r, struct hwc_trace_rect *t)
+{
+    r->left = t->left;
+    r->top = t->top;
+    r->right = t->right;
+    r->bottom = t->bottom;
+}
+
+/* SurfaceFlinger only sets the layers up again when they move or change */
+static bool geometry_changed(struct call *c, struct call *last)
+{
+    uint32_t i;
+
+    if (!last->call.num_layers || c->call.num_layers != last->call.num_layers)
+        return true;
+    for (i = 0; i < c->call.num_layers; i++) {
+        struct hwc_trace_layer *l = &c->layers[i], *p = &last->layers[i];
+        if (l->flags != p->flags || l->transform != p->transform || l->blending != p->blending ||
+            memcmp(&l->sourceCrop, &p->sourceCrop, sizeof(l->sourceCrop)) ||
+            memcmp(&l->displayFrame, &p->displayFrame, sizeof(l->displayFrame)))
+            return true;
+    }
+    return false;
+}
+
+static void get_list(hwc_display_contents_1_t *list, struct call *c, bool geometry)
+{
+    uint32_t i;
+
+    list->retireFenceFd = -1;
+    list->flags = geometry ? HWC_GEOMETRY_CHANGED : 0;
+    list->numHwLayers = c->call.num_layers;
+    for (i = 0; i < c->call.num_layers; i++) {
+        struct hwc_trace_layer *t = &c->layers[i];
+        hwc_layer_1_t *l = &list->hwLayers[i];
+
+        /*
+         * The framebuffer target is the last layer and set up again for every
+         * frame, the captured type may be one prepare changed it to
+         */
+        if (i == c->call.num_layers - 1)
+            l->compositionType = HWC_FRAMEBUFFER_TARGET;
+        else if (geometry)
+            l->compositionType = HWC_FRAMEBUFFER;
+        if (geometry)
+            l->hints = 0;
+        l->handle = get_buffer(t);
+        l->flags = t->flags;
+        l->transform = t->transform;
+        l->blending = t->blending;
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+        /* The float crop shares its union with the integer one hwc_prepare converts it to */
+        if (geometry) {
+            l->sourceCropf.left = t->sourceCrop.left;
+            l->sourceCropf.top = t->sourceCrop.top;
+            l->sourceCropf.right = t->sourceCrop.right;
+            l->sourceCropf.bottom = t->sourceCrop.bottom;
+        }
+        l->planeAlpha = 0xFF;
+#else
+        to_hwc_rect(&l->sourceCrop, &t->sourceCrop);
+#endif
+        to_hwc_rect(&l->displayFrame, &t->displayFrame);
+        l->visibleRegionScreen.numRects = 1;
+        l->visibleRegionScreen.rects = &l->displayFrame;
+        l->acquireFenceFd = l->releaseFenceFd = -1;
+    }
+}
+
+static const char *decision(bool use_sgx, uint32_t num_blits)
+{
+    if (num_blits)
+        return "blit";
+    return use_sgx ? "SGX+OVL" : "all-OVL";
+}
+
+static const char *composition(int32_t type)
+{
+    return type == HWC_OVERLAY ? "OVL" : type == HWC_FRAMEBUFFER_TARGET ? "TGT" : "FB";
+}
+
+/* Compares the decisions of hwc_prepare with the captured ones */
+static void check_decisions(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *list,
+                            struct call *c)
+{
+    uint32_t num_ovls = hwc_dev->comp_data.dsscomp_data.num_ovls, i;
+    bool same = hwc_dev->use_sgx == c->call.use_sgx && (uint32_t)hwc_dev->blit_num == c->call.num_blits &&
+                num_ovls == c->call.num_ovls;
+
+    for (i = 0; i < c->call.num_layers; i++)
+        same = same && list->hwLayers[i].compositionType == c->layers[i].compositionType;
+    if (same || stats.differing++ >= MAX_PRINTED_DIFFS)
+        return;
+
+    printf("prepare %d: captured %s with %u ovls and %u blits, replayed %s with %u ovls and %d blits\n",
+           stats.prepares - 1, decision(c->call.use_sgx, c->call.num_blits), c->call.num_ovls,
+           c->call.num_blits, decision(hwc_dev->use_sgx, hwc_dev->blit_num), num_ovls,
+           hwc_dev->blit_num);
+    for (i = 0; i < c->call.num_layers; i++) {
+        if (list->hwLayers[i].compositionType != c->layers[i].compositionType)
+            printf("  layer %u: captured %s, replayed %s\n", i,
+                   composition(c->layers[i].compositionType),
+                   composition(list->hwLayers[i].compositionType));
+    }
+}
+
+static void close_fences(hwc_display_contents_1_t *list)
+{
+    uint32_t i;
+
+    if (list->retireFenceFd >= 0)
+        close(list->retireFenceFd);
+    list->retireFenceFd = -1;
+    for (i = 0; i < list->numHwLayers; i++) {
+        if (list->hwLayers[i].releaseFenceFd >= 0)
+            close(list->hwLayers[i].releaseFenceFd);
+        list->hwLayers[i].releaseFenceFd = -1;
+    }
+}
+
+static int replay(hwc_composer_device_1_t *hwc, FILE *f)
+{
+    omap_hwc_device_t *hwc_dev = (omap_hwc_device_t *)hwc;
+    struct call calls[2], *c = &calls[0], *last = &calls[1], *tmp;
+    hwc_display_contents_1_t *list = NULL;
+    uint32_t size = 0;
+    int rv, err = -1;
+    int64_t start;
+
+    memset(calls, 0, sizeof(calls));
+    rv = read_call(f, c);
+    while (rv > 0) {
+        if (c->call.type != HWC_TRACE_PREPARE) {
+            rv = read_call(f, c);
+            continue;
+        }
+
+        if (c->call.num_layers > size) {
+            void *p = realloc(list, sizeof(*list) + c->call.num_layers * sizeof(list->hwLayers[0]));
+            if (!p)
+                goto out;
+            /* The layers past the old ones start from scratch */
+            list = p;
+            memset(&list->hwLayers[size], 0, (c->call.num_layers - size) * sizeof(list->hwLayers[0]));
+            if (!size)
+                memset(list, 0, sizeof(*list));
+            size = c->call.num_layers;
+        }
+        get_list(list, c, geometry_changed(c, last));
+        /* A visible display, dpy and sur only have to be set */
+        list->dpy = (hwc_display_t)1;
+        list->sur = (hwc_surface_t)1;
+
+        start = cpu_time_ns();
+        if (hwc->prepare(hwc, 1, &list))
+            goto out;
+        if (record_time(&stats.prepare_times, stats.prepares, cpu_time_ns() - start))
+            goto out;
+        stats.prepares++;
+        if (hwc_dev->blit_num)
+            stats.blit++;
+        else if (hwc_dev->use_sgx)
+            stats.sgx++;
+        else
+            stats.all_ovl++;
+        check_decisions(hwc_dev, list, c);
+
+        tmp = last;
+        last = c;
+        c = tmp;
+        rv = read_call(f, c);
+        if (rv <= 0 || c->call.type != HWC_TRACE_SET)
+            continue;
+
+        /* SurfaceFlinger sets the buffer of the framebuffer target after prepare */
+        if (c->call.num_layers && c->call.num_layers == list->numHwLayers)
+            list->hwLayers[list->numHwLayers - 1].handle = get_buffer(&c->layers[c->call.num_layers - 1]);
+        start = cpu_time_ns();
+        hwc->set(hwc, 1, &list);
+        if (record_time(&stats.set_times, stats.sets, cpu_time_ns() - start))
+            goto out;
+        stats.sets++;
+        close_fences(list);
+        rv = read_call(f, c);
+    }
+    if (rv < 0)
+        printf("trace truncated after %d prepares\n", stats.prepares);
+    err = 0;
+
+out:
+    free(calls[0].layers);
+    free(calls[1].layers);
+    free(list);
+    return err;
+}
+
+static int cmp_time(const void *a, const void *b)
+{
+    int64_t ta = *(const int64_t *)a, tb = *(const int64_t *)b;
+    return ta < tb ? -1 : ta > tb;
+}
+
+static void print_times(const char *what, int64_t *times, int n)
+{
+    int64_t total = 0;
+    int i;
+
+    if (!n)
+        return;
+    qsort(times, n, sizeof(*times), cmp_time);
+    for (i = 0; i < n; i++)
+        total += times[i];
+    printf("%s cpu: avg %lldus p50 %lldus p90 %lldus p99 %lldus max %lldus\n", what,
+           (long long)(total / n / 1000), (long long)(times[n / 2] / 1000),
+           (long long)(times[n * 9 / 10] / 1000), (long long)(times[n * 99 / 100] / 1000),
+           (long long)(times[n - 1] / 1000));
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: hwc_replay [-o <trace>] [-p <property>=<value>]... <trace>\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *path;
+    char *value;
+    hw_device_t *device;
+    FILE *f;
+    int opt, err;
+
+    while ((opt = getopt(argc, argv, "o:p:")) != -1) {
+        switch (opt) {
+        case 'o':
+            if (set_property("debug.hwc.capture", optarg))
+                break;
+            continue;
+        case 'p':
+            value = strchr(optarg, '=');
+            if (!value)
+                break;
+            *value++ = '\0';
+            if (set_property(optarg, value))
+                break;
+            continue;
+        }
+        usage();
+        return 2;
+    }
+    if (optind != argc - 1) {
+        usage();
+        return 2;
+    }
+    path = argv[optind];
+
+    f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return 2;
+    }
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        header.magic != HWC_TRACE_MAGIC || header.version != HWC_TRACE_VERSION) {
+        fprintf(stderr, "%s: not a version %d hwc trace\n", path, HWC_TRACE_VERSION);
+        fclose(f);
+        return 2;
+    }
+    init_fb_dev();
+
+    err = HAL_MODULE_INFO_SYM.base.common.methods->open(&HAL_MODULE_INFO_SYM.base.common,
+                                                        HWC_HARDWARE_COMPOSER, &device);
+    if (err) {
+        fprintf(stderr, "opening the HWC failed (%d)\n", err);
+        fclose(f);
+        return 2;
+    }
+
+    err = replay((hwc_composer_device_1_t *)device, f);
+    fclose(f);
+    /* Closing the HWC ends its capture */
+    device->close(device);
+    if (err) {
+        fprintf(stderr, "replay failed\n");
+        return 2;
+    }
+
+    printf("%s: %ux%u fb, %d prepares and %d sets replayed, %d posts\n", path,
+           header.fb_width, header.fb_height, stats.prepares, stats.sets, posts);
+    printf("composition: %d all-OVL, %d SGX+OVL, %d blit\n", stats.all_ovl, stats.sgx, stats.blit);
+    print_times("prepare", stats.prepare_times, stats.prepares);
+    print_times("set", stats.set_times, stats.sets);
+    printf("%d of %d frames decided as captured\n", stats.prepares - stats.differing, stats.prepares);
+
+    free(stats.prepare_times);
+    free(stats.set_times);
+    free_buffers();
+    return stats.differing ? 1 : 0;
+}
@@ -0,0 +1,373 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Reads the traces captured by the HWC with debug.hwc.capture set
+ *
+ *   hwc_trace [-v] <trace>       composition decisions and CPU time summary,
+ *                                -v lists every call
+ *   hwc_trace -d <trace> <trace> decisions that differ between two traces of
+ *                                the same workload, e.g. from two builds, and
+ *                                the SGX composed pixels of each
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../hwc_trace.h"
+
+/* compositionType values of hardware/hwcomposer.h */
+#define HWC_FRAMEBUFFER 0
+#define HWC_OVERLAY 1
+#define HWC_FRAMEBUFFER_TARGET 3
+
+/* Differing frames printed in full before only counting them */
+#define MAX_PRINTED_DIFFS 20
+
+struct call {
+    struct hwc_trace_call call;
+    struct hwc_trace_layer *layers;
+    struct hwc_trace_ovl *ovls;
+    struct hwc_trace_blit *blits;
+};
+
+struct trace {
+    const char *name;
+    struct hwc_trace_header header;
+    struct call *calls;
+    size_t num_calls;
+};
+
+static void *read_array(FILE *f, size_t num, size_t size)
+{
+    void *data;
+
+    if (!num)
+        return NULL;
+    data = malloc(num * size);
+    if (!data || fread(data, size, num, f) != num) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+static int load_trace(struct trace *t, const char *name)
+{
+    FILE *f = fopen(name, "rb");
+    size_t size = 0;
+
+    memset(t, 0, sizeof(*t));
+    t->name = name;
+    if (!f) {
+        fprintf(stderr, "%s: unable to open\n", name);
+        return -1;
+    }
+    if (fread(&t->header, sizeof(t->header), 1, f) != 1 ||
+        t->header.magic != HWC_TRACE_MAGIC || t->header.version != HWC_TRACE_VERSION) {
+        fprintf(stderr, "%s: not a version %d hwc trace\n", name, HWC_TRACE_VERSION);
+        fclose(f);
+        return -1;
+    }
+
+    for (;;) {
+        struct call c;
+
+        if (fread(&c.call, sizeof(c.call), 1, f) != 1)
+            break;
+        c.layers = read_array(f, c.call.num_layers, sizeof(*c.layers));
+        c.ovls = read_array(f, c.call.num_ovls, sizeof(*c.ovls));
+        c.blits = read_array(f, c.call.num_blits, sizeof(*c.blits));
+        if ((c.call.num_layers && !c.layers) || (c.call.num_ovls && !c.ovls) ||
+            (c.call.num_blits && !c.blits)) {
+            /* the capture stops mid record when the device is rebooted */
+            fprintf(stderr, "%s: truncated after %zu calls\n", name, t->num_calls);
+            free(c.layers);
+            free(c.ovls);
+            free(c.blits);
+            break;
+        }
+
+        if (t->num_calls == size) {
+            size = size ? size * 2 : 256;
+            struct call *calls = realloc(t->calls, size * sizeof(*calls));
+            if (!calls) {
+                fprintf(stderr, "%s: out of memory\n", name);
+                fclose(f);
+                return -1;
+            }
+            t->calls = calls;
+        }
+        t->calls[t->num_calls++] = c;
+    }
+
+    fclose(f);
+    return 0;
+}
+
+static const char *decision(struct hwc_trace_call *c)
+{
+    if (c->num_blits)
+        return "blit";
+    return c->use_sgx ? "SGX+OVL" : "all-OVL";
+}
+
+/* pixels of the layers left to SurfaceFlinger to compose */
+static uint64_t sgx_pixels(struct call *c)
+{
+    uint64_t pixels = 0;
+    uint32_t i;
+
+    for (i = 0; i < c->call.num_layers; i++) {
+        struct hwc_trace_layer *l = &c->layers[i];
+        int32_t w = l->displayFrame.right - l->displayFrame.left;
+        int32_t h = l->displayFrame.bottom - l->displayFrame.top;
+
+        if (l->compositionType == HWC_FRAMEBUFFER && w > 0 && h > 0)
+            pixels += (uint64_t)w * h;
+    }
+    return pixels;
+}
+
+static int cmp_time(const void *a, const void *b)
+{
+    int64_t ta = *(const int64_t *)a, tb = *(const int64_t *)b;
+    return ta < tb ? -1 : ta > tb;
+}
+
+static void print_times(const char *what, int64_t *times, size_t n)
+{
+    int64_t total = 0;
+    size_t i;
+
+    if (!n)
+        return;
+    qsort(times, n, sizeof(*times), cmp_time);
+    for (i = 0; i < n; i++)
+        total += times[i];
+    printf("%s cpu: avg %lldus p50 %lldus p90 %lldus p99 %lldus max %lldus\n", what,
+           (long long)(total / n / 1000), (long long)(times[n / 2] / 1000),
+           (long long)(times[n * 9 / 10] / 1000), (long long)(times[n * 99 / 100] / 1000),
+           (long long)(times[n - 1] / 1000));
+}
+
+static void print_call(struct call *c)
+{
+    struct hwc_trace_call *call = &c->call;
+    uint32_t i;
+
+    printf("%s %u: %lldus %s%s, %u layers, %u ovls, %u blits%s%s\n",
+           call->type == HWC_TRACE_PREPARE ? "prepare" : "set", call->sync_id,
+           (long long)(call->cpu_time / 1000), decision(call), call->reused ? " (reused)" : "",
+           call->num_layers, call->num_ovls, call->num_blits,
+           call->ext_enabled ? call->ext_docking ? ", docking" : ", mirroring" : "",
+           call->err ? ", failed" : "");
+
+    if (call->type != HWC_TRACE_PREPARE)
+        return;
+    for (i = 0; i < call->num_layers; i++) {
+        struct hwc_trace_layer *l = &c->layers[i];
+        printf("  layer %u: %s fmt %x %dx%d tr %x blend %x {%d,%d,%d,%d} -> {%d,%d,%d,%d}\n", i,
+               l->compositionType == HWC_OVERLAY ? "OVL" :
+               l->compositionType == HWC_FRAMEBUFFER_TARGET ? "TGT" : "FB ",
+               l->format, l->width, l->height, l->transform, l->blending,
+               l->sourceCrop.left, l->sourceCrop.top, l->sourceCrop.right, l->sourceCrop.bottom,
+               l->displayFrame.left, l->displayFrame.top, l->displayFrame.right, l->displayFrame.bottom);
+    }
+    for (i = 0; i < call->num_ovls; i++) {
+        struct hwc_trace_ovl *o = &c->ovls[i];
+        printf("  ovl %u: ix %u mgr %u z %u {%d,%d,%d,%d} -> {%d,%d,%d,%d}\n", i,
+               o->ix, o->mgr_ix, o->zorder,
+               o->crop.left, o->crop.top, o->crop.right, o->crop.bottom,
+               o->win.left, o->win.top, o->win.right, o->win.bottom);
+    }
+}
+
+static int summarize(struct trace *t, bool verbose)
+{
+    size_t prepares = 0, sets = 0, all_ovl = 0, sgx = 0, blit = 0, reused = 0;
+    size_t layers = 0, ovls = 0, blits = 0;
+    uint64_t pixels = 0;
+    int64_t *prepare_times = malloc(t->num_calls * sizeof(int64_t));
+    int64_t *set_times = malloc(t->num_calls * sizeof(int64_t));
+    size_t i;
+
+    if (t->num_calls && (!prepare_times || !set_times)) {
+        fprintf(stderr, "out of memory\n");
+        free(prepare_times);
+        free(set_times);
+        return 1;
+    }
+
+    for (i = 0; i < t->num_calls; i++) {
+        struct hwc_trace_call *c = &t->calls[i].call;
+
+        if (verbose)
+            print_call(&t->calls[i]);
+
+        if (c->type == HWC_TRACE_SET) {
+            set_times[sets++] = c->cpu_time;
+            blits += c->num_blits;
+            continue;
+        }
+        prepare_times[prepares++] = c->cpu_time;
+        layers += c->num_layers;
+        ovls += c->num_ovls;
+        pixels += sgx_pixels(&t->calls[i]);
+        reused += c->reused;
+        if (c->num_blits)
+            blit++;
+        else if (c->use_sgx)
+            sgx++;
+        else
+            all_ovl++;
+    }
+
+    printf("%s: %ux%u fb, %zu prepares, %zu sets\n", t->name,
+           t->header.fb_width, t->header.fb_height, prepares, sets);
+    printf("composition: %zu all-OVL, %zu SGX+OVL, %zu blit, %zu reused\n",
+           all_ovl, sgx, blit, reused);
+    if (prepares)
+        printf("per frame: %.1f layers, %.1f ovls, %llu pixels composed by SGX\n",
+               (float)layers / prepares, (float)ovls / prepares,
+               (unsigned long long)(pixels / prepares));
+    if (sets)
+        printf("per post: %.1f blits\n", (float)blits / sets);
+    print_times("prepare", prepare_times, prepares);
+    print_times("set", set_times, sets);
+
+    free(prepare_times);
+    free(set_times);
+    return 0;
+}
+
+static bool same_inputs(struct call *a, struct call *b)
+{
+    uint32_t i;
+
+    if (a->call.num_layers != b->call.num_layers)
+        return false;
+    for (i = 0; i < a->call.num_layers; i++) {
+        struct hwc_trace_layer *la = &a->layers[i], *lb = &b->layers[i];
+        if (la->format != lb->format || la->width != lb->width || la->height != lb->height ||
+            la->usage != lb->usage || la->transform != lb->transform ||
+            la->blending != lb->blending ||
+            memcmp(&la->sourceCrop, &lb->sourceCrop, sizeof(la->sourceCrop)) ||
+            memcmp(&la->displayFrame, &lb->displayFrame, sizeof(la->displayFrame)))
+            return false;
+    }
+    return true;
+}
+
+static bool same_decisions(struct call *a, struct call *b)
+{
+    uint32_t i;
+
+    if (a->call.use_sgx != b->call.use_sgx || a->call.num_blits != b->call.num_blits ||
+        a->call.num_ovls != b->call.num_ovls)
+        return false;
+    for (i = 0; i < a->call.num_layers; i++) {
+        if (a->layers[i].compositionType != b->layers[i].compositionType)
+            return false;
+    }
+    for (i = 0; i < a->call.num_ovls; i++) {
+        struct hwc_trace_ovl *oa = &a->ovls[i], *ob = &b->ovls[i];
+        if (oa->ix != ob->ix || oa->mgr_ix != ob->mgr_ix || oa->zorder != ob->zorder ||
+            oa->enabled != ob->enabled || oa->color_mode != ob->color_mode ||
+            memcmp(&oa->crop, &ob->crop, sizeof(oa->crop)) ||
+            memcmp(&oa->win, &ob->win, sizeof(oa->win)))
+            return false;
+    }
+    return true;
+}
+
+static struct call *next_prepare(struct trace *t, size_t *i)
+{
+    while (*i < t->num_calls) {
+        struct call *c = &t->calls[(*i)++];
+        if (c->call.type == HWC_TRACE_PREPARE)
+            return c;
+    }
+    return NULL;
+}
+
+static int diff(struct trace *a, struct trace *b)
+{
+    size_t ia = 0, ib = 0, frames = 0, diverged = 0, differing = 0;
+    int64_t time_a = 0, time_b = 0;
+    uint64_t pixels_a = 0, pixels_b = 0;
+    struct call *ca, *cb;
+
+    while ((ca = next_prepare(a, &ia)) && (cb = next_prepare(b, &ib))) {
+        if (!same_inputs(ca, cb)) {
+            diverged++;
+            continue;
+        }
+        frames++;
+        time_a += ca->call.cpu_time;
+        time_b += cb->call.cpu_time;
+        pixels_a += sgx_pixels(ca);
+        pixels_b += sgx_pixels(cb);
+        if (same_decisions(ca, cb))
+            continue;
+
+        if (differing++ < MAX_PRINTED_DIFFS) {
+            printf("frame %zu differs\n< ", frames - 1);
+            print_call(ca);
+            printf("> ");
+            print_call(cb);
+        }
+    }
+
+    printf("%zu frames compared, %zu with different decisions, %zu with different layers\n",
+           frames, differing, diverged);
+    if (frames) {
+        printf("prepare cpu: avg %lldus vs %lldus\n", (long long)(time_a / frames / 1000),
+               (long long)(time_b / frames / 1000));
+        printf("SGX composed: avg %llu vs %llu pixels per frame\n",
+               (unsigned long long)(pixels_a / frames), (unsigned long long)(pixels_b / frames));
+    }
+    return differing ? 1 : 0;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: hwc_trace [-v] <trace>\n"
+                    "       hwc_trace -d <trace> <trace>\n");
+}
+
+int main(int argc, char **argv)
+{
+    struct trace a, b;
+
+    if (argc == 4 && !strcmp(argv[1], "-d")) {
+        if (load_trace(&a, argv[2]) || load_trace(&b, argv[3]))
+            return 2;
+        return diff(&a, &b);
+    }
+
+    bool verbose = argc == 3 && !strcmp(argv[1], "-v");
+    if (argc != 2 && !verbose) {
+        usage();
+        return 2;
+    }
+    if (load_trace(&a, argv[argc - 1]))
+        return 2;
+    return summarize(&a, verbose);
+}
@@ -18,10 +18,12 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <sys/ioctl.h>
 
 #include <cutils/log.h>
 
+#include <linux/types.h>
 #include <video/dsscomp.h>
 
 #include "hwc_dev.h"
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "dss_search.h"
+
+static void update_best(struct dss_search *s, uint32_t chosen, uint64_t score, uint32_t mem)
+{
+    /* prefer less TILER1D memory, i.e. less DSS fetch bandwidth, on a tie */
+    if (score > s->best_score || (score == s->best_score && mem < s->best_mem)) {
+        s->best = chosen;
+        s->best_score = score;
+        s->best_mem = mem;
+    }
+}
+
+static void search(struct dss_search *s, uint32_t i, uint32_t chosen, uint32_t count,
+                   uint32_t mem, uint64_t score, bool below_fb)
+{
+    if (i == s->num_layers || count == s->max_ovls) {
+        update_best(s, chosen, score, mem);
+        return;
+    }
+    if (score + s->score_left[i] < s->best_score || s->nodes++ >= MAX_DSS_SEARCH_NODES)
+        return;
+
+    if ((s->eligible & (1 << i)) &&
+        mem + s->mem[i] <= s->max_mem &&
+        /* can't have a transparent overlay in the middle of the framebuffer stack */
+        !((s->blended & (1 << i)) && below_fb))
+        search(s, i + 1, chosen | (1 << i), count + 1, mem + s->mem[i],
+               score + s->score[i], below_fb);
+
+    /* layers not on DSS are composed into the framebuffer if SGX is used */
+    search(s, i + 1, chosen, count, mem, score, below_fb || s->use_sgx);
+}
+
+uint32_t run_dss_search(struct dss_search *s)
+{
+    uint32_t i, mem = 0, count = 0;
+    bool below_fb = false;
+
+    s->score_left[s->num_layers] = 0;
+    for (i = s->num_layers; i-- > 0; )
+        s->score_left[i] = s->score_left[i + 1] + s->score[i];
+
+    /* the first layers that fit, as assigned before, is where the search starts from */
+    s->greedy = 0;
+    s->greedy_score = 0;
+    for (i = 0; i < s->num_layers; i++) {
+        if (count < s->max_ovls && (s->eligible & (1 << i)) &&
+            mem + s->mem[i] <= s->max_mem &&
+            !((s->blended & (1 << i)) && below_fb)) {
+            s->greedy |= 1 << i;
+            s->greedy_score += s->score[i];
+            mem += s->mem[i];
+            count++;
+        } else {
+            below_fb = below_fb || s->use_sgx;
+        }
+    }
+    s->best = s->greedy;
+    s->best_score = s->greedy_score;
+    s->best_mem = mem;
+    s->nodes = 0;
+
+    if (s->max_ovls && (s->eligible & ~s->greedy))
+        search(s, 0, 0, 0, 0, 0, false);
+    return s->best;
+}
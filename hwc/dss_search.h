@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DSS_SEARCH_H__
+#define __DSS_SEARCH_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* layers a search covers, one bit each */
+#define MAX_DSS_SEARCH_LAYERS 32
+
+/* layer subsets evaluated before settling for the best one found so far */
+#define MAX_DSS_SEARCH_NODES 4096
+
+/*
+ * Choice of the layers rendered with DSS pipes, for hwc_prepare. The caller
+ * describes the layers and the limits, run_dss_search() fills in the rest.
+ */
+struct dss_search {
+    uint32_t num_layers;
+    uint32_t max_ovls;
+    uint32_t max_mem;                   /* TILER1D slot size */
+    bool use_sgx;
+    uint32_t eligible;                  /* layers DSS can render */
+    uint32_t blended;
+    uint64_t score[MAX_DSS_SEARCH_LAYERS]; /* SGX composition avoided by using DSS */
+    uint32_t mem[MAX_DSS_SEARCH_LAYERS];
+
+    uint64_t score_left[MAX_DSS_SEARCH_LAYERS + 1]; /* of the eligible layers from i on */
+    uint32_t nodes;                     /* > MAX_DSS_SEARCH_NODES if stopped */
+
+    uint32_t greedy;                    /* the first layers that fit */
+    uint64_t greedy_score;
+    uint32_t best;
+    uint64_t best_score;
+    uint32_t best_mem;
+};
+
+/*
+ * Searches the subsets of the eligible layers for the one with the highest
+ * score that fits in the pipes and the TILER1D slot, without a blended layer
+ * in the middle of the framebuffer stack. Returns the layers as a mask.
+ */
+uint32_t run_dss_search(struct dss_search *s);
+
+#endif
@@ -19,6 +19,10 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <math.h>
 #include <fcntl.h>
 #include <poll.h>
 #include <sys/ioctl.h>
@@ -40,6 +44,10 @@
 #endif
 
 #include <linux/fb.h>
+/* Bionic defines it, glibc doesn't for the host build of cmd/hwc_replay.c */
+#ifndef __user
+#define __user
+#endif
 #include <linux/omapfb.h>
 #include <ion/ion.h>
 #include "ion_ti_custom.h"
@@ -48,6 +56,11 @@
 #include "display.h"
 #include "dock_image.h"
 #include "sw_vsync.h"
+#include "virtual_display.h"
+#include "hwc_capture.h"
+#include "hwc_stats.h"
+#include "hwc_plan.h"
+#include "dss_search.h"
 
 #define min(a, b) ( { typeof(a) __a = (a), __b = (b); __a < __b ? __a : __b; } )
 #define max(a, b) ( { typeof(a) __a = (a), __b = (b); __a > __b ? __a : __b; } )
@@ -59,7 +72,6 @@
 #define DIV_ROUND_UP(a, b) (((a) + (b) - 1) / (b))
 
 #define MAX_HWC_LAYERS 32
-#define MAX_HW_OVERLAYS 4
 #define NUM_NONSCALING_OVERLAYS 1
 #define NUM_EXT_DISPLAY_BACK_BUFFERS 2
 #define ASPECT_RATIO_TOLERANCE 0.02f
@@ -100,7 +112,8 @@ static bool debugpost2 = false;
 static bool debugblt = false;
 static rgz_t grgz;
 #ifdef OMAP_ENHANCEMENT_HWC_EXTENDED_API
-static rgz_ext_layer_list_t grgz_ext_layer_list;
+static hwc_layer_extended_t *grgz_ext_layers;
+static uint32_t grgz_ext_layers_size;
 #endif
 static struct bvsurfgeom gscrngeom;
 
@@ -110,10 +123,8 @@ static void showfps(void)
     static int lastframecount = 0;
     static nsecs_t lastfpstime = 0;
     static float fps = 0;
-    char value[PROPERTY_VALUE_MAX];
 
-    property_get("debug.hwc.showfps", value, "0");
-    if (!atoi(value)) {
+    if (!hwc_stats_showfps()) {
         return;
     }
 
@@ -190,13 +201,18 @@ struct dump_buf {
     int len;
 };
 
+/* Output past the end of the buffer is dropped, len stays within buf_len */
 static void dump_printf(struct dump_buf *buf, const char *fmt, ...)
 {
     va_list ap;
 
+    if (buf->len >= buf->buf_len)
+        return;
+
     va_start(ap, fmt);
     buf->len += vsnprintf(buf->buf + buf->len, buf->buf_len - buf->len, fmt, ap);
     va_end(ap);
+    buf->len = min(buf->len, buf->buf_len);
 }
 
 static void dump_set_info(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t* list)
@@ -808,6 +824,12 @@ static bool is_valid_layer(omap_hwc_device_t *hwc_dev, hwc_layer_1_t *layer, IMG
     if (layer->compositionType == HWC_FRAMEBUFFER_TARGET)
         return false;
 
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+    /* Plane alpha came with HWC 1.2, the DSS pipes don't apply it */
+    if (layer->planeAlpha != 0xFF)
+        return false;
+#endif
+
     if (!is_valid_format(handle->iFormat))
         return false;
 
@@ -1161,6 +1183,65 @@ static inline int display_area(struct dss2_ovl_info *o)
     return o->cfg.win.w * o->cfg.win.h;
 }
 
+/*
+ * Chooses the layers to render with DSS pipes, trying to leave as little as
+ * possible for SGX: the largest layers are preferred over the first ones, as
+ * long as the pipes, the TILER1D slot and the z-order allow. Protected layers,
+ * and dockable layers when docking, must not be left to SGX so they come
+ * first. Returns the layers as a mask.
+ */
+static uint32_t choose_dss_layers(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *list,
+                                  uint32_t max_ovls)
+{
+    omap_hwc_ext_t *ext = &hwc_dev->ext;
+    struct dss_search s;
+    uint32_t i;
+
+    memset(&s, 0, sizeof(s));
+    s.num_layers = list ? min(list->numHwLayers, MAX_DSS_SEARCH_LAYERS) : 0;
+    s.max_ovls = max_ovls;
+    s.max_mem = limits.tiler1d_slot_size;
+    s.use_sgx = hwc_dev->use_sgx;
+
+    for (i = 0; i < s.num_layers; i++) {
+        hwc_layer_1_t *layer = &list->hwLayers[i];
+        IMG_native_handle_t *handle = (IMG_native_handle_t *)layer->handle;
+
+        if (is_BLENDED(layer))
+            s.blended |= 1 << i;
+        if (!can_dss_render_layer(hwc_dev, layer) ||
+            (hwc_dev->force_sgx &&
+             /* render protected and dockable layers via DSS */
+             !is_protected(layer) &&
+             !is_upscaled_NV12(hwc_dev, layer) &&
+             !(ext->current.docking && ext->current.enabled && dockable(layer))))
+            continue;
+
+        s.eligible |= 1 << i;
+        s.mem[i] = mem1d(handle);
+        /* the area in the low 32 bits */
+        s.score[i] = (uint64_t)max(WIDTH(layer->displayFrame), 0) * max(HEIGHT(layer->displayFrame), 0);
+        if (is_protected(layer) || (ext->current.docking && ext->current.enabled && dockable(layer)))
+            s.score[i] += 1ULL << 32;
+    }
+
+    run_dss_search(&s);
+
+    if (s.best != s.greedy) {
+        hwc_dev->dss_stats.improved++;
+        for (i = 0; i < s.num_layers; i++) {
+            uint32_t area = (uint32_t)s.score[i];
+            if (s.best & (1 << i))
+                hwc_dev->dss_stats.pixels_saved += area;
+            if (s.greedy & (1 << i))
+                hwc_dev->dss_stats.pixels_saved -= area;
+        }
+    }
+    if (s.nodes > MAX_DSS_SEARCH_NODES)
+        hwc_dev->dss_stats.truncated++;
+    return s.best;
+}
+
 static int clone_layer(omap_hwc_device_t *hwc_dev, int ix) {
     struct dsscomp_setup_dispc_data *dsscomp = &hwc_dev->comp_data.dsscomp_data;
     int ext_ovl_ix = dsscomp->num_ovls - hwc_dev->post2_layers;
@@ -1399,12 +1480,17 @@ static int setup_mirroring(omap_hwc_device_t *hwc_dev)
 
 /*
  * We're using "implicit" synchronization, so make sure we aren't passing any
- * sync object descriptors around.
+ * sync object descriptors around. Virtual displays hand fences back to
+ * SurfaceFlinger and close the ones they are given themselves.
  */
 static void check_sync_fds(size_t numDisplays, hwc_display_contents_1_t** displays)
 {
     //ALOGD("checking sync FDs");
     unsigned int i, j;
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+    if (numDisplays > HWC_DISPLAY_VIRTUAL)
+        numDisplays = HWC_DISPLAY_VIRTUAL;
+#endif
     for (i = 0; i < numDisplays; i++) {
         hwc_display_contents_1_t* list = displays[i];
         if (!list)
@@ -1438,6 +1524,30 @@ static void blit_reset(omap_hwc_device_t *hwc_dev)
     hwc_dev->comp_data.blit_data.rgz_items = 0;
 }
 
+/*
+ * The blit ops are passed to the kernel right after the composition data, make
+ * room for blit_num of them
+ */
+static int reserve_post2_blits(omap_hwc_device_t *hwc_dev, int blit_num)
+{
+    if (hwc_dev->post2_data && blit_num <= hwc_dev->post2_data_blits)
+        return 0;
+
+    int size = hwc_dev->post2_data_blits ? hwc_dev->post2_data_blits : 64;
+    while (size < blit_num)
+        size <<= 1;
+
+    struct omap_hwc_data *post2_data = realloc(hwc_dev->post2_data,
+        sizeof(*post2_data) + size * sizeof(struct rgz_blt_entry));
+    if (!post2_data) {
+        ALOGE("Unable to allocate room for %d blits", blit_num);
+        return -ENOMEM;
+    }
+    hwc_dev->post2_data = post2_data;
+    hwc_dev->post2_data_blits = size;
+    return 0;
+}
+
 static bool blit_layers(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *list, int bufoff)
 {
     if (!list || hwc_dev->ext.mirror.enabled)
@@ -1467,14 +1577,20 @@ static bool blit_layers(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *li
         hwc_dev->procs->extension_cb(hwc_dev->procs, HWC_EXTENDED_OP_LAYERDATA, NULL, -1) != 0)
         goto err_out;
 
-    /* Check if we have enough space in the extended layer list */
-    if ((sizeof(hwc_layer_extended_t) * list->numHwLayers) > sizeof(grgz_ext_layer_list))
-        goto err_out;
+    /* Make room in the extended layer list */
+    if (list->numHwLayers > grgz_ext_layers_size) {
+        hwc_layer_extended_t *ext_layers = realloc(grgz_ext_layers,
+            sizeof(hwc_layer_extended_t) * list->numHwLayers);
+        if (!ext_layers)
+            goto err_out;
+        grgz_ext_layers = ext_layers;
+        grgz_ext_layers_size = list->numHwLayers;
+    }
 #endif
     uint32_t i;
 #ifdef OMAP_ENHANCEMENT_HWC_EXTENDED_API
     for (i = 0; i < list->numHwLayers; i++) {
-        hwc_layer_extended_t *ext_layer = &grgz_ext_layer_list.layers[i];
+        hwc_layer_extended_t *ext_layer = &grgz_ext_layers[i];
         ext_layer->idx = i;
         if (hwc_dev->procs->extension_cb(hwc_dev->procs, HWC_EXTENDED_OP_LAYERDATA,
             (void **) &ext_layer, sizeof(hwc_layer_extended_t)) != 0)
@@ -1489,7 +1605,7 @@ static bool blit_layers(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *li
                 .dstgeom = &gscrngeom,
                 .layers = list->hwLayers,
 #ifdef OMAP_ENHANCEMENT_HWC_EXTENDED_API
-                .extlayers = grgz_ext_layer_list.layers,
+                .extlayers = grgz_ext_layers,
 #endif
                 .layerno = list->numHwLayers
             }
@@ -1534,8 +1650,17 @@ static bool blit_layers(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *li
         goto err_out;
     }
 
+    if (bufoff + out.data.bvc.out_nhndls > MAX_HWC_LAYERS) {
+        ALOGE("Too many blit buffers %d", out.data.bvc.out_nhndls);
+        goto err_out;
+    }
+
+    if (reserve_post2_blits(hwc_dev, out.data.bvc.cmdlen))
+        goto err_out;
+
     hwc_dev->blit_flags |= HWC_BLT_FLAG_USE_FB;
     hwc_dev->blit_num = out.data.bvc.out_blits;
+    hwc_stats_blits(out.data.bvc.out_blits, out.data.bvc.out_saved_blits);
     hwc_dev->post2_blit_buffers = out.data.bvc.out_nhndls;
     for (i = 0; i < hwc_dev->post2_blit_buffers; i++) {
         //ALOGI("blit buffers[%d] = %p", bufoff, out.data.bvc.out_hndls[i]);
@@ -1543,7 +1668,7 @@ static bool blit_layers(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *li
     }
 
     struct rgz_blt_entry *res_blit_ops = (struct rgz_blt_entry *) out.data.bvc.cmdp;
-    memcpy(hwc_dev->comp_data.blit_data.rgz_blts, res_blit_ops, sizeof(*res_blit_ops) * out.data.bvc.cmdlen);
+    memcpy(hwc_dev->post2_data->blit_data.rgz_blts, res_blit_ops, sizeof(*res_blit_ops) * out.data.bvc.cmdlen);
     ALOGI_IF(debugblt, "blt struct sz %d", sizeof(*res_blit_ops) * out.data.bvc.cmdlen);
     ALOGE_IF(hwc_dev->blit_num != out.data.bvc.cmdlen,"blit_num != out.data.bvc.cmdlen, %d != %d", hwc_dev->blit_num, out.data.bvc.cmdlen);
 
@@ -1619,6 +1744,135 @@ handle_error:
     return -1;
 }
 
+static void get_plan_state(omap_hwc_device_t *hwc_dev, omap_hwc_plan_state_t *state)
+{
+    omap_hwc_ext_t *ext = &hwc_dev->ext;
+
+    memset(state, 0, sizeof(*state));
+    state->mirror = ext->mirror;
+    state->dock = ext->dock;
+    state->current = ext->current;
+    state->last = ext->last;
+    state->force_dock = ext->force_dock;
+    state->hdmi_state = ext->hdmi_state;
+    state->ext_on_tv = ext->on_tv;
+    state->on_tv = hwc_dev->on_tv;
+    state->last_xres_used = ext->last_xres_used;
+    state->last_yres_used = ext->last_yres_used;
+    state->last_mode = ext->last_mode;
+    state->last_xpy = ext->last_xpy;
+    state->xres = ext->xres;
+    state->yres = ext->yres;
+    state->force_sgx = hwc_dev->force_sgx;
+    state->last_ext_ovls = hwc_dev->last_ext_ovls;
+    state->last_int_ovls = hwc_dev->last_int_ovls;
+    state->primary_transform = hwc_dev->primary_transform;
+    state->blt_policy = hwc_dev->blt_policy;
+    state->blt_mode = hwc_dev->blt_mode;
+}
+
+/*
+ * Keep the composition just decided if the next frame with the same layers
+ * would come to the same decisions
+ */
+static void store_plan(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *list,
+                       omap_hwc_plan_state_t *state, uint32_t hash)
+{
+    omap_hwc_plan_t *plan = &hwc_dev->plan;
+    omap_hwc_plan_state_t new_state;
+
+    plan->valid = false;
+    plan->misses++;
+
+    /* blits also depend on the layer contents and the regionizer history */
+    bool blits_tried = hwc_dev->blt_policy == BLTPOLICY_ALL ||
+                       (hwc_dev->blt_policy == BLTPOLICY_DEFAULT && hwc_dev->use_sgx);
+    if (hwc_dev->blit_num || (blits_tried && !hwc_dev->ext.mirror.enabled))
+        return;
+#ifdef OMAP_ENHANCEMENT_S3D
+    if (hwc_dev->counts.s3d)
+        return;
+#endif
+
+    /* e.g. HDMI mode changes will lead to different decisions next frame */
+    get_plan_state(hwc_dev, &new_state);
+    if (memcmp(&new_state, state, sizeof(*state)))
+        return;
+
+    if (!hwc_plan_store(plan, list, state, hash))
+        return;
+
+    plan->dsscomp = hwc_dev->comp_data.dsscomp_data;
+    plan->counts = hwc_dev->counts;
+    plan->use_sgx = hwc_dev->use_sgx;
+    plan->swap_rb = hwc_dev->swap_rb;
+    plan->post2_layers = hwc_dev->post2_layers;
+    plan->ext_ovls = hwc_dev->ext_ovls;
+    plan->ext_ovls_wanted = hwc_dev->ext_ovls_wanted;
+    plan->valid = true;
+}
+
+static void apply_plan(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *list)
+{
+    omap_hwc_plan_t *plan = &hwc_dev->plan;
+    struct dsscomp_setup_dispc_data *dsscomp = &hwc_dev->comp_data.dsscomp_data;
+    __u32 id = dsscomp->sync_id;
+    uint32_t i;
+
+    *dsscomp = plan->dsscomp;
+    dsscomp->sync_id = id;
+    hwc_plan_apply(plan, list);
+
+    /* refresh the buffers */
+    for (i = 0; i < plan->post2_layers; i++)
+        hwc_dev->buffers[i] = plan->ovl_layers[i] >= 0 ? list->hwLayers[plan->ovl_layers[i]].handle : NULL;
+    for (i = 0; i < dsscomp->num_ovls; i++) {
+        if (dsscomp->ovls[i].addressing == OMAP_DSS_BUFADDR_ION)
+            dsscomp->ovls[i].ba = (int)hwc_dev->ion_handles[sync_id%2];
+    }
+
+    hwc_dev->counts = plan->counts;
+    hwc_dev->use_sgx = plan->use_sgx;
+    hwc_dev->swap_rb = plan->swap_rb;
+    hwc_dev->post2_layers = plan->post2_layers;
+    hwc_dev->ext_ovls = plan->ext_ovls;
+    hwc_dev->ext_ovls_wanted = plan->ext_ovls_wanted;
+    blit_reset(hwc_dev);
+#ifdef OMAP_ENHANCEMENT_S3D
+    enable_s3d_hdmi(hwc_dev, false);
+#endif
+    plan->hits++;
+}
+
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+/*
+ * From HWC 1.3 on SurfaceFlinger hands the source crop in floats, in a union
+ * with the integer crop everything here reads. It is only written along with
+ * a geometry change, so convert it in place then, the way SurfaceFlinger
+ * rounds it for older composers.
+ */
+static void convert_source_crops(size_t numDisplays, hwc_display_contents_1_t** displays)
+{
+    size_t i, j;
+
+    for (i = 0; i < numDisplays; i++) {
+        hwc_display_contents_1_t* list = displays[i];
+        if (!list || !(list->flags & HWC_GEOMETRY_CHANGED))
+            continue;
+
+        for (j = 0; j < list->numHwLayers; j++) {
+            hwc_layer_1_t *layer = &list->hwLayers[j];
+            hwc_frect_t crop = layer->sourceCropf;
+
+            layer->sourceCrop.left = (int)ceilf(crop.left);
+            layer->sourceCrop.top = (int)ceilf(crop.top);
+            layer->sourceCrop.right = (int)floorf(crop.right);
+            layer->sourceCrop.bottom = (int)floorf(crop.bottom);
+        }
+    }
+}
+#endif
+
 static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
         hwc_display_contents_1_t** displays)
 {
@@ -1631,11 +1885,34 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
     struct dsscomp_setup_dispc_data *dsscomp = &hwc_dev->comp_data.dsscomp_data;
     counts_t *num = &hwc_dev->counts;
     uint32_t i, ix;
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC), capture_cpu_time = 0;
+    nsecs_t blit_start;
+    bool reused = false;
 
     pthread_mutex_lock(&hwc_dev->lock);
+    if (hwc_dev->capture)
+        capture_cpu_time = systemTime(SYSTEM_TIME_THREAD);
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+    convert_source_crops(numDisplays, displays);
+#endif
     memset(dsscomp, 0x0, sizeof(*dsscomp));
     dsscomp->sync_id = sync_id++;
 
+    /* same layers as the last frame, e.g. video playback */
+    omap_hwc_plan_state_t plan_state;
+    uint32_t plan_hash = 0;
+    get_plan_state(hwc_dev, &plan_state);
+    if (!list) {
+        hwc_dev->plan.valid = false;
+    } else if (hwc_plan_match(&hwc_dev->plan, list, &plan_state, &plan_hash)) {
+        apply_plan(hwc_dev, list);
+        ALOGD_IF(debug, "prepare (%d) - reusing the last composition (%s)",
+                 dsscomp->sync_id, hwc_dev->use_sgx ? "SGX+OVL" : "all-OVL");
+        reused = true;
+        goto out;
+    }
+    memset(hwc_dev->plan.ovl_layers, -1, sizeof(hwc_dev->plan.ovl_layers));
+
     gather_layer_statistics(hwc_dev, list);
 
     decide_supported_cloning(hwc_dev);
@@ -1669,7 +1946,9 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
 
     if (hwc_dev->blt_policy == BLTPOLICY_ALL) {
         /* Check if we can blit everything */
+        blit_start = systemTime(SYSTEM_TIME_MONOTONIC);
         blit_all = blit_layers(hwc_dev, list, 0);
+        hwc_stats_record(HWC_STAT_BLIT, systemTime(SYSTEM_TIME_MONOTONIC) - blit_start);
         if (blit_all) {
             needs_fb = 1;
             hwc_dev->use_sgx = 0;
@@ -1684,24 +1963,17 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
     dsscomp->num_ovls = needs_fb ? 1 /*VID1*/ : 0 /*GFX*/;
 
     /* set up if DSS layers */
-    uint32_t mem_used = 0;
+    uint32_t dss_layers = 0;
+    if (!blit_all && dsscomp->num_ovls < num->max_hw_overlays)
+        dss_layers = choose_dss_layers(hwc_dev, list, num->max_hw_overlays - dsscomp->num_ovls);
+    hwc_dev->dss_stats.frames++;
+
     for (i = 0; list && i < list->numHwLayers && !blit_all; i++) {
         hwc_layer_1_t *layer = &list->hwLayers[i];
         IMG_native_handle_t *handle = (IMG_native_handle_t *)layer->handle;
 
-        if (dsscomp->num_ovls < num->max_hw_overlays &&
-            can_dss_render_layer(hwc_dev, layer) &&
-            (!hwc_dev->force_sgx ||
-             /* render protected and dockable layers via DSS */
-             is_protected(layer) ||
-             is_upscaled_NV12(hwc_dev, layer) ||
-             (hwc_dev->ext.current.docking && hwc_dev->ext.current.enabled && dockable(layer))) &&
-            mem_used + mem1d(handle) <= limits.tiler1d_slot_size &&
-            /* can't have a transparent overlay in the middle of the framebuffer stack */
-            !(is_BLENDED(layer) && fb_z >= 0)) {
-
+        if (i < MAX_HWC_LAYERS && (dss_layers & (1 << i))) {
             /* render via DSS overlay */
-            mem_used += mem1d(handle);
             layer->compositionType = HWC_OVERLAY;
             /*
              * This hint will not be used in vanilla ICS, but maybe in
@@ -1715,6 +1987,7 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
                 layer->hints |= HWC_HINT_CLEAR_FB;
 
             hwc_dev->buffers[dsscomp->num_ovls] = layer->handle;
+            hwc_dev->plan.ovl_layers[dsscomp->num_ovls] = i;
             //ALOGI("dss buffers[%d] = %p", dsscomp->num_ovls, hwc_dev->buffers[dsscomp->num_ovls]);
 
             setup_layer(hwc_dev,
@@ -1776,9 +2049,11 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
          * we need to reset its state.
          */
         if (hwc_dev->use_sgx) {
+            blit_start = systemTime(SYSTEM_TIME_MONOTONIC);
             if (blit_layers(hwc_dev, list, dsscomp->num_ovls == 1 ? 0 : dsscomp->num_ovls)) {
                 hwc_dev->use_sgx = 0;
             }
+            hwc_stats_record(HWC_STAT_BLIT, systemTime(SYSTEM_TIME_MONOTONIC) - blit_start);
         } else
             rgz_release(&grgz);
     }
@@ -1799,6 +2074,7 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
          */
         if (hwc_dev->use_sgx) {
             hwc_dev->buffers[0] = NULL;
+            hwc_dev->plan.ovl_layers[0] = -1;
         }
         setup_layer_base(&dsscomp->ovls[0].cfg, fb_z,
                          hwc_dev->fb_dev->base.format,
@@ -1917,6 +2193,9 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
         dsscomp->num_ovls = 0;
     }
 
+    if (list)
+        store_plan(hwc_dev, list, &plan_state, plan_hash);
+
     if (debug) {
         ALOGD("prepare (%d) - %s (comp=%d, poss=%d/%d scaled, RGB=%d,BGR=%d,NV12=%d) (ext=%s%s%ddeg%s %dex/%dmx (last %dex,%din)\n",
              dsscomp->sync_id,
@@ -1931,7 +2210,16 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
              hwc_dev->ext_ovls, num->max_hw_overlays, hwc_dev->last_ext_ovls, hwc_dev->last_int_ovls);
     }
 
+out:
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+    for (i = HWC_DISPLAY_VIRTUAL; i < numDisplays; i++)
+        virtual_display_prepare(hwc_dev, i, displays[i]);
+#endif
+    if (hwc_dev->capture)
+        hwc_capture_prepare(hwc_dev, list, start,
+                            systemTime(SYSTEM_TIME_THREAD) - capture_cpu_time, reused);
     pthread_mutex_unlock(&hwc_dev->lock);
+    hwc_stats_record(HWC_STAT_PREPARE, systemTime(SYSTEM_TIME_MONOTONIC) - start);
     return 0;
 }
 
@@ -1981,8 +2269,14 @@ static int hwc_set(struct hwc_composer_device_1 *dev,
     struct dsscomp_setup_dispc_data *dsscomp = &hwc_dev->comp_data.dsscomp_data;
     int err = 0;
     bool invalidate;
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC), capture_cpu_time = 0;
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+    size_t disp;
+#endif
 
     pthread_mutex_lock(&hwc_dev->lock);
+    if (hwc_dev->capture)
+        capture_cpu_time = systemTime(SYSTEM_TIME_THREAD);
 
     reset_screen(hwc_dev);
 
@@ -2035,6 +2329,12 @@ static int hwc_set(struct hwc_composer_device_1 *dev,
         int omaplfb_comp_data_sz = sizeof(hwc_dev->comp_data) +
             (hwc_dev->comp_data.blit_data.rgz_items * sizeof(struct rgz_blt_entry));
 
+        /* The blit ops follow the composition data in the Post2 payload */
+        struct omap_hwc_data *post2_data = &hwc_dev->comp_data;
+        if (hwc_dev->blit_num) {
+            memcpy(hwc_dev->post2_data, &hwc_dev->comp_data, sizeof(hwc_dev->comp_data));
+            post2_data = hwc_dev->post2_data;
+        }
 
         uint32_t nbufs = hwc_dev->post2_layers;
         if (hwc_dev->post2_blit_buffers) {
@@ -2061,22 +2361,43 @@ static int hwc_set(struct hwc_composer_device_1 *dev,
             hwc_dev->use_sgx);
 
         debug_post2(hwc_dev, nbufs);
+        nsecs_t post2_start = systemTime(SYSTEM_TIME_MONOTONIC);
         err = hwc_dev->fb_dev->Post2((framebuffer_device_t *)hwc_dev->fb_dev,
                                  hwc_dev->buffers,
                                  nbufs,
-                                 dsscomp, omaplfb_comp_data_sz);
+                                 &post2_data->dsscomp_data, omaplfb_comp_data_sz);
+        nsecs_t post2_end = systemTime(SYSTEM_TIME_MONOTONIC);
+        hwc_stats_record(HWC_STAT_POST2, post2_end - post2_start);
+        hwc_stats_post(post2_end, hwc_dev->blit_num ? HWC_STATS_MODE_BLIT :
+                                  hwc_dev->use_sgx ? HWC_STATS_MODE_SGX : HWC_STATS_MODE_OVL);
         showfps();
+        if (hwc_dev->capture)
+            hwc_capture_set(hwc_dev, list, post2_data, start,
+                            systemTime(SYSTEM_TIME_THREAD) - capture_cpu_time, err);
     }
     hwc_dev->last_ext_ovls = hwc_dev->ext_ovls;
     hwc_dev->last_int_ovls = hwc_dev->post2_layers;
     if (err)
         ALOGE("Post2 error");
 
+err_out:
     check_sync_fds(numDisplays, displays);
 
-err_out:
     pthread_mutex_unlock(&hwc_dev->lock);
 
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+    /*
+     * Virtual displays don't depend on the primary one being posted, and
+     * may wait for their buffers, so they are set without the hwc lock
+     */
+    for (disp = HWC_DISPLAY_VIRTUAL; disp < numDisplays; disp++) {
+        int vd_err = virtual_display_set(hwc_dev, disp, displays[disp]);
+        if (!err)
+            err = vd_err;
+    }
+#endif
+    hwc_stats_record(HWC_STAT_SET, systemTime(SYSTEM_TIME_MONOTONIC) - start);
+
     if (invalidate)
         hwc_dev->procs->invalidate(hwc_dev->procs);
 
@@ -2095,6 +2416,26 @@ static void hwc_dump(struct hwc_composer_device_1 *dev, char *buff, int buff_len
 
     dump_printf(&log, "omap_hwc %d:\n", dsscomp->num_ovls);
     dump_printf(&log, "  idle timeout: %dms\n", hwc_dev->idle);
+    dump_printf(&log, "  composition reused: %u of %u frames\n", hwc_dev->plan.hits,
+                      hwc_dev->plan.hits + hwc_dev->plan.misses);
+    dump_printf(&log, "  DSS layers improved on: %u of %u frames, %lld SGX pixels saved, %u searches cut short\n",
+                      hwc_dev->dss_stats.improved, hwc_dev->dss_stats.frames,
+                      hwc_dev->dss_stats.pixels_saved, hwc_dev->dss_stats.truncated);
+    /* These return the full length like snprintf, even when truncated */
+    log.len += hwc_stats_dump(log.buf + log.len, log.buf_len - log.len);
+    log.len = min(log.len, log.buf_len);
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+    log.len += virtual_display_dump(log.buf + log.len, log.buf_len - log.len);
+    log.len = min(log.len, log.buf_len);
+#endif
+    if (hwc_dev->use_sw_vsync) {
+        sw_vsync_stats_t stats;
+        get_sw_vsync_stats(&stats);
+        dump_printf(&log, "  s/w vsync: %lldus period, %u vsyncs, %u missed, "
+                          "jitter mean %lldus p99 %lldus max %lldus\n",
+                    stats.rate / 1000, stats.count, stats.missed,
+                    stats.mean / 1000, stats.p99 / 1000, stats.max / 1000);
+    }
 
     for (i = 0; i < dsscomp->num_ovls; i++) {
         struct dss2_ovl_cfg *cfg = &dsscomp->ovls[i].cfg;
@@ -2135,6 +2476,15 @@ static int hwc_device_close(hw_device_t* device)
         /* pthread will get killed when parent process exits */
         pthread_mutex_destroy(&hwc_dev->lock);
         free_displays(hwc_dev);
+        rgz_release(&grgz);
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+        virtual_display_release();
+#endif
+        hwc_plan_free(&hwc_dev->plan);
+        if (hwc_dev->capture)
+            hwc_capture_close();
+        free(hwc_dev->post2_data);
+        free(hwc_dev->buffers);
         free(hwc_dev);
     }
 
@@ -2259,6 +2609,7 @@ static void handle_hotplug(omap_hwc_device_t *hwc_dev)
     }
 
     pthread_mutex_lock(&hwc_dev->lock);
+    hwc_dev->plan.valid = false;
 #ifdef OMAP_ENHANCEMENT_S3D
     handle_s3d_hotplug(ext, state);
 #endif
@@ -2368,8 +2719,14 @@ static void handle_uevents(omap_hwc_device_t *hwc_dev, const char *buff, int len
     }
 
     if (vsync) {
-        if (hwc_dev->procs)
-            hwc_dev->procs->vsync(hwc_dev->procs, 0, timestamp);
+        /* with s/w vsync the panel vsyncs only keep the generated ones in phase */
+        if (hwc_dev->use_sw_vsync) {
+            lock_sw_vsync(timestamp);
+        } else {
+            hwc_stats_vsync(timestamp);
+            if (hwc_dev->procs)
+                hwc_dev->procs->vsync(hwc_dev->procs, 0, timestamp);
+        }
     } else {
         if (dock)
             hwc_dev->ext.force_dock = state == 1;
@@ -2552,7 +2909,12 @@ static int hwc_device_open(const hw_module_t* module, const char* name, hw_devic
     memset(hwc_dev, 0, sizeof(*hwc_dev));
 
     hwc_dev->base.common.tag = HARDWARE_DEVICE_TAG;
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+    /* Virtual displays are handed to the composer from 1.3 on */
+    hwc_dev->base.common.version = HWC_DEVICE_API_VERSION_1_3;
+#else
     hwc_dev->base.common.version = HWC_DEVICE_API_VERSION_1_1;
+#endif
 
     if (use_sw_vsync()) {
         hwc_dev->use_sw_vsync = true;
@@ -2670,6 +3032,9 @@ static int hwc_device_open(const hw_module_t* module, const char* name, hw_devic
     hwc_dev->flags_nv12_only = atoi(value);
     property_get("debug.hwc.idle", value, "250");
     hwc_dev->idle = atoi(value);
+    if (property_get("debug.hwc.capture", value, "") > 0)
+        hwc_dev->capture = hwc_capture_open(hwc_dev, value) == 0;
+    hwc_stats_init(1000000000.0 / hwc_dev->fb_dev->base.fps);
 
     /* get the board specific clone properties */
     /* 0:0:1280:720 */
@@ -2723,6 +3088,10 @@ static int hwc_device_open(const hw_module_t* module, const char* name, hw_devic
             err = -EINVAL;
             goto done;
         }
+
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+        virtual_display_init();
+#endif
     }
 
     property_get("persist.hwc.upscaled_nv12_limit", value, "2.");
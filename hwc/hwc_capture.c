@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cutils/log.h>
+
+#include "hwc_dev.h"
+#include "hwc_trace.h"
+#include "hwc_capture.h"
+
+static FILE *capture_file;
+
+static void write_data(const void *data, size_t size)
+{
+    if (capture_file && fwrite(data, size, 1, capture_file) != 1) {
+        ALOGE("Stopping the capture, write failed (%d)", errno);
+        fclose(capture_file);
+        capture_file = NULL;
+    }
+}
+
+static void set_rect(struct hwc_trace_rect *r, int left, int top, int right, int bottom)
+{
+    r->left = left;
+    r->top = top;
+    r->right = right;
+    r->bottom = bottom;
+}
+
+static int32_t get_blit_buf(struct bvbuffdesc *desc)
+{
+    uint32_t auxptr = (uint32_t)desc->auxptr;
+
+    if (!desc->structsize)
+        return HWC_TRACE_BUF_NONE;
+    if (desc->auxptr == (void *)-1)
+        return HWC_TRACE_BUF_FILL;
+    if (auxptr & HWC_BLT_DESC_FLAG)
+        return HWC_TRACE_BUF_FB;
+    return auxptr;
+}
+
+static void write_call(omap_hwc_device_t *hwc_dev, uint32_t type, hwc_display_contents_1_t *list,
+                       struct dsscomp_setup_dispc_data *dsscomp, struct rgz_blt_entry *blits,
+                       int num_blits, nsecs_t timestamp, nsecs_t cpu_time, bool reused, int err)
+{
+    struct hwc_trace_call call;
+    uint32_t i;
+
+    memset(&call, 0, sizeof(call));
+    call.type = type;
+    call.sync_id = dsscomp->sync_id;
+    call.timestamp = timestamp;
+    call.cpu_time = cpu_time;
+    call.err = err;
+    call.use_sgx = hwc_dev->use_sgx;
+    call.swap_rb = hwc_dev->swap_rb;
+    call.ext_enabled = hwc_dev->ext.current.enabled;
+    call.ext_docking = hwc_dev->ext.current.docking;
+    call.reused = reused;
+    call.post2_layers = hwc_dev->post2_layers;
+    call.post2_blit_buffers = hwc_dev->post2_blit_buffers;
+    call.num_layers = list ? list->numHwLayers : 0;
+    call.num_ovls = dsscomp->num_ovls;
+    call.num_blits = num_blits;
+    write_data(&call, sizeof(call));
+
+    for (i = 0; i < call.num_layers; i++) {
+        hwc_layer_1_t *layer = &list->hwLayers[i];
+        IMG_native_handle_t *handle = (IMG_native_handle_t *)layer->handle;
+        struct hwc_trace_layer l;
+
+        memset(&l, 0, sizeof(l));
+        l.handle = (uintptr_t)layer->handle;
+        if (handle) {
+            l.format = handle->iFormat;
+            l.width = handle->iWidth;
+            l.height = handle->iHeight;
+            l.usage = handle->usage;
+        }
+        l.compositionType = layer->compositionType;
+        l.hints = layer->hints;
+        l.flags = layer->flags;
+        l.transform = layer->transform;
+        l.blending = layer->blending;
+        l.num_visible_rects = layer->visibleRegionScreen.numRects;
+        set_rect(&l.sourceCrop, layer->sourceCrop.left, layer->sourceCrop.top,
+                 layer->sourceCrop.right, layer->sourceCrop.bottom);
+        set_rect(&l.displayFrame, layer->displayFrame.left, layer->displayFrame.top,
+                 layer->displayFrame.right, layer->displayFrame.bottom);
+        write_data(&l, sizeof(l));
+    }
+
+    for (i = 0; i < call.num_ovls; i++) {
+        struct dss2_ovl_info *oi = &dsscomp->ovls[i];
+        struct dss2_ovl_cfg *c = &oi->cfg;
+        struct hwc_trace_ovl o;
+
+        memset(&o, 0, sizeof(o));
+        o.enabled = c->enabled;
+        o.ix = c->ix;
+        o.mgr_ix = c->mgr_ix;
+        o.zorder = c->zorder;
+        o.rotation = c->rotation;
+        o.mirror = c->mirror;
+        o.pre_mult_alpha = c->pre_mult_alpha;
+        o.global_alpha = c->global_alpha;
+        o.color_mode = c->color_mode;
+        o.addressing = oi->addressing;
+        o.ba = oi->ba;
+        o.width = c->width;
+        o.height = c->height;
+        o.stride = c->stride;
+        set_rect(&o.crop, c->crop.x, c->crop.y, c->crop.x + c->crop.w, c->crop.y + c->crop.h);
+        set_rect(&o.win, c->win.x, c->win.y, c->win.x + c->win.w, c->win.y + c->win.h);
+        write_data(&o, sizeof(o));
+    }
+
+    for (i = 0; i < call.num_blits; i++) {
+        struct rgz_blt_entry *e = &blits[i];
+        struct bvbltparams *bp = &e->bp;
+        struct hwc_trace_blit b;
+
+        memset(&b, 0, sizeof(b));
+        b.flags = bp->flags;
+        b.op = (bp->flags & BVFLAG_OP_MASK) == BVFLAG_BLEND ? (uint32_t)bp->op.blend : bp->op.rop;
+        b.src1 = get_blit_buf(&e->src1desc);
+        b.src2 = get_blit_buf(&e->src2desc);
+        set_rect(&b.dst, bp->dstrect.left, bp->dstrect.top,
+                 bp->dstrect.left + bp->dstrect.width, bp->dstrect.top + bp->dstrect.height);
+        set_rect(&b.src1rect, bp->src1rect.left, bp->src1rect.top,
+                 bp->src1rect.left + bp->src1rect.width, bp->src1rect.top + bp->src1rect.height);
+        set_rect(&b.src2rect, bp->src2rect.left, bp->src2rect.top,
+                 bp->src2rect.left + bp->src2rect.width, bp->src2rect.top + bp->src2rect.height);
+        set_rect(&b.clip, bp->cliprect.left, bp->cliprect.top,
+                 bp->cliprect.left + bp->cliprect.width, bp->cliprect.top + bp->cliprect.height);
+        write_data(&b, sizeof(b));
+    }
+}
+
+int hwc_capture_open(omap_hwc_device_t *hwc_dev, const char *path)
+{
+    struct hwc_trace_header header = {
+        .magic = HWC_TRACE_MAGIC,
+        .version = HWC_TRACE_VERSION,
+        .fb_width = hwc_dev->fb_dev->base.width,
+        .fb_height = hwc_dev->fb_dev->base.height,
+        .fb_format = hwc_dev->fb_dev->base.format,
+    };
+
+    capture_file = fopen(path, "w");
+    if (!capture_file) {
+        ALOGE("Unable to open capture file %s (%d)", path, errno);
+        return -errno;
+    }
+    write_data(&header, sizeof(header));
+    if (!capture_file)
+        return -EIO;
+
+    ALOGI("capturing compositions to %s", path);
+    return 0;
+}
+
+void hwc_capture_prepare(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *list,
+                         nsecs_t timestamp, nsecs_t cpu_time, bool reused)
+{
+    /* the composition data is only copied in front of the blit ops by set */
+    write_call(hwc_dev, HWC_TRACE_PREPARE, list, &hwc_dev->comp_data.dsscomp_data,
+               hwc_dev->blit_num ? hwc_dev->post2_data->blit_data.rgz_blts : NULL,
+               hwc_dev->blit_num, timestamp, cpu_time, reused, 0);
+}
+
+void hwc_capture_set(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *list,
+                     struct omap_hwc_data *post2_data, nsecs_t timestamp, nsecs_t cpu_time, int err)
+{
+    write_call(hwc_dev, HWC_TRACE_SET, list, &post2_data->dsscomp_data,
+               post2_data->blit_data.rgz_blts, post2_data->blit_data.rgz_items,
+               timestamp, cpu_time, false, err);
+}
+
+void hwc_capture_close(void)
+{
+    if (capture_file)
+        fclose(capture_file);
+    capture_file = NULL;
+}
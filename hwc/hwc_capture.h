@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HWC_CAPTURE_H__
+#define __HWC_CAPTURE_H__
+
+#include <utils/Timers.h>
+
+/*
+ * Records the hwc_prepare and hwc_set calls in the format of hwc_trace.h,
+ * enabled by setting debug.hwc.capture to the trace file
+ */
+int hwc_capture_open(omap_hwc_device_t *hwc_dev, const char *path);
+void hwc_capture_prepare(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *list,
+                         nsecs_t timestamp, nsecs_t cpu_time, bool reused);
+void hwc_capture_set(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *list,
+                     struct omap_hwc_data *post2_data, nsecs_t timestamp, nsecs_t cpu_time, int err);
+void hwc_capture_close(void);
+
+#endif
@@ -19,12 +19,14 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <pthread.h>
 
 #include <hardware/hwcomposer.h>
 #ifdef OMAP_ENHANCEMENT_S3D
 #include <ui/S3DFormat.h>
 #endif
 
+#include <linux/types.h>
 #include <linux/bltsville.h>
 #include <video/dsscomp.h>
 #include <video/omap_hwc.h>
@@ -33,6 +35,13 @@
 #include "rgz_2d.h"
 #include "display.h"
 
+/* Bionic has it, glibc doesn't for the host builds of the tests and tools */
+#ifndef __unused
+#define __unused __attribute__((unused))
+#endif
+
+#define MAX_HW_OVERLAYS 4
+
 struct ext_transform {
     uint8_t rotation : 3;          /* 90-degree clockwise rotations */
     uint8_t hflip    : 1;          /* flip l-r (after rotation) */
@@ -115,6 +124,96 @@ struct counts {
 };
 typedef struct counts counts_t;
 
+/* device state the composition decisions depend on besides the layers */
+struct omap_hwc_plan_state {
+    ext_transform_t mirror;
+    ext_transform_t dock;
+    ext_transform_t current;
+    ext_transform_t last;
+    bool force_dock;
+    bool hdmi_state;
+    bool ext_on_tv;
+    bool on_tv;
+    uint32_t last_xres_used;
+    uint32_t last_yres_used;
+    uint32_t last_mode;
+    float last_xpy;
+    uint32_t xres;
+    uint32_t yres;
+    int force_sgx;
+    int last_ext_ovls;
+    int last_int_ovls;
+    int primary_transform;
+    enum bltpolicy blt_policy;
+    enum bltmode blt_mode;
+};
+typedef struct omap_hwc_plan_state omap_hwc_plan_state_t;
+
+/* layer attributes the composition decisions depend on */
+struct omap_hwc_plan_key {
+    int format;
+    int width;
+    int height;
+    int usage;
+    bool has_handle;
+    bool fb_target;
+    uint32_t flags;
+    uint32_t transform;
+    int32_t blending;
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+    uint8_t planeAlpha;
+#endif
+    hwc_rect_t sourceCrop;
+    hwc_rect_t displayFrame;
+};
+
+struct omap_hwc_plan_layer {
+    struct omap_hwc_plan_key key;
+    /*
+     * Composition decided for the layer, and the hints and flags prepare
+     * added to it. While preparing, the hints and flags the layer came with.
+     */
+    int32_t compositionType;
+    uint32_t hints;
+    uint32_t flags;
+};
+
+/*
+ * Composition decided by the last prepare, reused as long as the layer
+ * geometry and the device state don't change. Only the buffer handles are
+ * refreshed on a hit.
+ */
+struct omap_hwc_plan {
+    bool valid;
+    uint32_t hash;
+    omap_hwc_plan_state_t state;
+    struct omap_hwc_plan_layer *layers;
+    struct omap_hwc_plan_layer *next;   /* keys of the frame being prepared */
+    size_t num_layers;
+    size_t size;
+
+    struct dsscomp_setup_dispc_data dsscomp;
+    int ovl_layers[MAX_HW_OVERLAYS];    /* layer shown by each DSS ovl, or -1 */
+    counts_t counts;
+    bool use_sgx;
+    bool swap_rb;
+    uint32_t post2_layers;
+    int ext_ovls;
+    int ext_ovls_wanted;
+
+    uint32_t hits;
+    uint32_t misses;
+};
+typedef struct omap_hwc_plan omap_hwc_plan_t;
+
+/* DSS layer choices compared to taking the first layers that fit */
+struct omap_hwc_dss_stats {
+    uint32_t frames;
+    uint32_t improved;          /* frames where larger layers were chosen */
+    int64_t pixels_saved;       /* SGX composed pixels avoided by that */
+    uint32_t truncated;         /* searches stopped at MAX_DSS_SEARCH_NODES */
+};
+
 struct omap_hwc_device {
     /* static data */
     hwc_composer_device_1_t base;
@@ -164,7 +263,11 @@ struct omap_hwc_device {
     uint32_t blit_flags;
     int blit_num;
     struct omap_hwc_data comp_data; /* This is a kernel data structure */
-    struct rgz_blt_entry blit_ops[RGZ_MAX_BLITS];
+    struct omap_hwc_data *post2_data; /* comp_data followed by the blit ops */
+    int post2_data_blits; /* Number of blit ops post2_data has room for */
+    omap_hwc_plan_t plan;
+    struct omap_hwc_dss_stats dss_stats;
+    bool capture; /* Record prepare and set calls, see hwc_capture.h */
 
     counts_t counts;
 
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <linux/types.h>
+
+#include <hardware/hwcomposer.h>
+
+#include "hwc_dev.h"
+#include "hwc_plan.h"
+
+#define swap(a, b) do { typeof(a) __a = (a); (a) = (b); (b) = __a; } while (0)
+
+bool hwc_plan_match(omap_hwc_plan_t *plan, hwc_display_contents_1_t *list,
+                    omap_hwc_plan_state_t *state, uint32_t *hash)
+{
+    size_t i, j;
+
+    if (list->numHwLayers > plan->size) {
+        struct omap_hwc_plan_layer *layers = realloc(plan->layers, list->numHwLayers * sizeof(*layers));
+        if (layers)
+            plan->layers = layers;
+        struct omap_hwc_plan_layer *next = realloc(plan->next, list->numHwLayers * sizeof(*next));
+        if (next)
+            plan->next = next;
+        if (!layers || !next) {
+            plan->valid = false;
+            return false;
+        }
+        plan->size = list->numHwLayers;
+    }
+
+    /* FNV-1a over the layer keys */
+    *hash = 2166136261u;
+    for (i = 0; i < list->numHwLayers; i++) {
+        hwc_layer_1_t *layer = &list->hwLayers[i];
+        IMG_native_handle_t *handle = (IMG_native_handle_t *)layer->handle;
+        struct omap_hwc_plan_layer *l = &plan->next[i];
+
+        memset(&l->key, 0, sizeof(l->key));
+        if (handle) {
+            l->key.has_handle = true;
+            l->key.format = handle->iFormat;
+            l->key.width = handle->iWidth;
+            l->key.height = handle->iHeight;
+            l->key.usage = handle->usage;
+        }
+        l->key.fb_target = layer->compositionType == HWC_FRAMEBUFFER_TARGET;
+        l->key.flags = layer->flags;
+        l->key.transform = layer->transform;
+        l->key.blending = layer->blending;
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+        l->key.planeAlpha = layer->planeAlpha;
+#endif
+        l->key.sourceCrop = layer->sourceCrop;
+        l->key.displayFrame = layer->displayFrame;
+        l->hints = layer->hints;
+        l->flags = layer->flags;
+
+        const uint8_t *p = (const uint8_t *)&l->key;
+        for (j = 0; j < sizeof(l->key); j++)
+            *hash = (*hash ^ p[j]) * 16777619u;
+    }
+
+    if (!plan->valid || plan->hash != *hash || plan->num_layers != list->numHwLayers ||
+        memcmp(&plan->state, state, sizeof(*state)))
+        return false;
+
+    for (i = 0; i < list->numHwLayers; i++) {
+        if (memcmp(&plan->layers[i].key, &plan->next[i].key, sizeof(plan->next[i].key)))
+            return false;
+    }
+    return true;
+}
+
+bool hwc_plan_store(omap_hwc_plan_t *plan, hwc_display_contents_1_t *list,
+                    omap_hwc_plan_state_t *state, uint32_t hash)
+{
+    size_t i;
+
+    if (list->numHwLayers > plan->size)
+        return false;
+
+    for (i = 0; i < list->numHwLayers; i++) {
+        hwc_layer_1_t *layer = &list->hwLayers[i];
+        struct omap_hwc_plan_layer *l = &plan->next[i];
+
+        l->compositionType = layer->compositionType;
+        l->hints = layer->hints & ~l->hints;
+        l->flags = layer->flags & ~l->flags;
+    }
+    swap(plan->layers, plan->next);
+    plan->num_layers = list->numHwLayers;
+    plan->hash = hash;
+    plan->state = *state;
+    return true;
+}
+
+void hwc_plan_apply(omap_hwc_plan_t *plan, hwc_display_contents_1_t *list)
+{
+    size_t i;
+
+    for (i = 0; i < list->numHwLayers; i++) {
+        hwc_layer_1_t *layer = &list->hwLayers[i];
+
+        layer->compositionType = plan->layers[i].compositionType;
+        layer->hints |= plan->layers[i].hints;
+        layer->flags |= plan->layers[i].flags;
+    }
+}
+
+void hwc_plan_free(omap_hwc_plan_t *plan)
+{
+    free(plan->layers);
+    free(plan->next);
+    plan->layers = plan->next = NULL;
+    plan->size = 0;
+    plan->valid = false;
+}
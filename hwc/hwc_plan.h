@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HWC_PLAN_H__
+#define __HWC_PLAN_H__
+
+/*
+ * Composition plan cache of hwc_prepare, see struct omap_hwc_plan. The device
+ * state and the composition decided besides the layers are handled by hwc.c.
+ */
+
+/*
+ * Records the attributes of the layers and returns true if the plan holds the
+ * composition decided for the same layers in the same device state. hash
+ * receives the hash of the layers for hwc_plan_store.
+ */
+bool hwc_plan_match(omap_hwc_plan_t *plan, hwc_display_contents_1_t *list,
+                    omap_hwc_plan_state_t *state, uint32_t *hash);
+
+/*
+ * Keeps the composition prepare decided for the layers hwc_plan_match last
+ * recorded. Returns false if they couldn't be recorded.
+ */
+bool hwc_plan_store(omap_hwc_plan_t *plan, hwc_display_contents_1_t *list,
+                    omap_hwc_plan_state_t *state, uint32_t hash);
+
+/* Gives the layers the composition types, hints and flags of the plan */
+void hwc_plan_apply(omap_hwc_plan_t *plan, hwc_display_contents_1_t *list);
+
+void hwc_plan_free(omap_hwc_plan_t *plan);
+
+#endif
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cutils/properties.h>
+
+#include "hwc_stats.h"
+
+/* power of 2 buckets in us, the last one takes everything from ~8s */
+#define NUM_BUCKETS 24
+
+/* posts further apart than this are idle time, not missed vsyncs */
+#define IDLE_INTERVAL ms2ns(100)
+
+#define inc(p, v) __atomic_fetch_add(p, v, __ATOMIC_RELAXED)
+#define get(p) __atomic_load_n(p, __ATOMIC_RELAXED)
+
+struct histogram {
+    uint32_t count;
+    uint32_t buckets[NUM_BUCKETS];
+    uint64_t total;             /* us */
+    uint32_t max;               /* us */
+};
+
+static const char *stat_names[HWC_STAT_NUM] = {
+    [HWC_STAT_PREPARE] = "prepare",
+    [HWC_STAT_SET] = "set",
+    [HWC_STAT_POST2] = "Post2",
+    [HWC_STAT_BLIT] = "regionizer",
+    [HWC_STAT_FRAME_INTERVAL] = "frame interval",
+    [HWC_STAT_POST_TO_VSYNC] = "post to vsync",
+};
+
+static const char *mode_names[HWC_STATS_MODE_NUM] = {
+    [HWC_STATS_MODE_OVL] = "all-OVL",
+    [HWC_STATS_MODE_SGX] = "SGX+OVL",
+    [HWC_STATS_MODE_BLIT] = "blit",
+};
+
+static struct histogram histograms[HWC_STAT_NUM];
+static uint32_t mode_frames[HWC_STATS_MODE_NUM];
+static uint32_t mode_switches;
+static uint32_t missed_vsyncs;
+static uint64_t blits;
+static uint64_t saved_blits;
+
+static nsecs_t vsync_period;
+static nsecs_t last_post;               /* only used by hwc_stats_post */
+static enum hwc_stats_mode last_mode;
+static nsecs_t pending_post;            /* post not followed by a vsync yet, or 0 */
+
+static nsecs_t props_time;
+static bool showfps;
+
+static void refresh_properties(nsecs_t now)
+{
+    char value[PROPERTY_VALUE_MAX];
+
+    property_get("debug.hwc.showfps", value, "0");
+    __atomic_store_n(&showfps, atoi(value) != 0, __ATOMIC_RELAXED);
+    props_time = now;
+}
+
+void hwc_stats_init(nsecs_t period)
+{
+    vsync_period = period;
+    refresh_properties(systemTime(SYSTEM_TIME_MONOTONIC));
+}
+
+void hwc_stats_record(enum hwc_stat stat, nsecs_t time)
+{
+    struct histogram *h = &histograms[stat];
+    uint32_t us = time > 0 ? ns2us(time) : 0;
+    uint32_t max = get(&h->max);
+    int bucket = us ? 32 - __builtin_clz(us) : 0;
+
+    inc(&h->buckets[bucket < NUM_BUCKETS ? bucket : NUM_BUCKETS - 1], 1);
+    inc(&h->total, us);
+    while (us > max &&
+           !__atomic_compare_exchange_n(&h->max, &max, us, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+    /* last, so a reader never sees more samples than bucket entries */
+    inc(&h->count, 1);
+}
+
+void hwc_stats_post(nsecs_t timestamp, enum hwc_stats_mode mode)
+{
+    if (last_post) {
+        nsecs_t interval = timestamp - last_post;
+
+        hwc_stats_record(HWC_STAT_FRAME_INTERVAL, interval);
+        if (vsync_period && interval < IDLE_INTERVAL) {
+            nsecs_t vsyncs = (interval + vsync_period / 2) / vsync_period;
+            if (vsyncs > 1)
+                inc(&missed_vsyncs, vsyncs - 1);
+        }
+        if (mode != last_mode)
+            inc(&mode_switches, 1);
+    }
+    inc(&mode_frames[mode], 1);
+    last_post = timestamp;
+    last_mode = mode;
+    __atomic_store_n(&pending_post, timestamp, __ATOMIC_RELAXED);
+
+    if (timestamp - props_time > s2ns(1))
+        refresh_properties(timestamp);
+}
+
+void hwc_stats_vsync(nsecs_t timestamp)
+{
+    nsecs_t post = __atomic_exchange_n(&pending_post, 0, __ATOMIC_RELAXED);
+
+    if (post && timestamp > post)
+        hwc_stats_record(HWC_STAT_POST_TO_VSYNC, timestamp - post);
+}
+
+void hwc_stats_blits(int num, int saved)
+{
+    inc(&blits, num);
+    inc(&saved_blits, saved);
+}
+
+bool hwc_stats_showfps(void)
+{
+    return get(&showfps);
+}
+
+/* upper bound in us of the bucket the p-th percentile falls in */
+static uint32_t percentile(struct histogram *h, uint32_t count, uint32_t p)
+{
+    uint32_t seen = 0, max = get(&h->max);
+    int i;
+
+    for (i = 0; i < NUM_BUCKETS - 1; i++) {
+        seen += get(&h->buckets[i]);
+        if ((uint64_t)seen * 100 >= (uint64_t)count * p)
+            break;
+    }
+    return i < NUM_BUCKETS - 1 && (1U << i) < max ? 1U << i : max;
+}
+
+int hwc_stats_dump(char *buff, int buff_len)
+{
+    int len = 0, i;
+
+#define dump(...) \
+    len += snprintf(buff + len, len < buff_len ? buff_len - len : 0, __VA_ARGS__)
+
+    dump("  timings (us)        count      avg    p50<=    p99<=      max\n");
+    for (i = 0; i < HWC_STAT_NUM; i++) {
+        struct histogram *h = &histograms[i];
+        uint32_t count = get(&h->count);
+
+        if (!count)
+            continue;
+        dump("    %-14s %8u %8llu %8u %8u %8u\n", stat_names[i], count,
+             (unsigned long long)(get(&h->total) / count),
+             percentile(h, count, 50), percentile(h, count, 99), get(&h->max));
+    }
+
+    dump("  frames:");
+    for (i = 0; i < HWC_STATS_MODE_NUM; i++)
+        dump(" %u %s,", get(&mode_frames[i]), mode_names[i]);
+    dump(" %u composition switches, %u missed vsyncs\n",
+         get(&mode_switches), get(&missed_vsyncs));
+    dump("  blits: %llu, %llu before merging subregions\n", (unsigned long long)get(&blits),
+         (unsigned long long)(get(&blits) + get(&saved_blits)));
+#undef dump
+
+    return len;
+}
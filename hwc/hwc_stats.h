@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HWC_STATS_H__
+#define __HWC_STATS_H__
+
+#include <stdbool.h>
+#include <utils/Timers.h>
+
+/*
+ * Always-on composition statistics reported by dumpsys. Recording is lock
+ * free, so it is done from any thread without taking the hwc lock.
+ */
+
+enum hwc_stat {
+    HWC_STAT_PREPARE,           /* hwc_prepare */
+    HWC_STAT_SET,               /* hwc_set */
+    HWC_STAT_POST2,             /* Post2, i.e. the dsscomp ioctl */
+    HWC_STAT_BLIT,              /* regionizer in hwc_prepare */
+    HWC_STAT_FRAME_INTERVAL,    /* between posts */
+    HWC_STAT_POST_TO_VSYNC,     /* post to the following vsync */
+    HWC_STAT_NUM,
+};
+
+enum hwc_stats_mode {
+    HWC_STATS_MODE_OVL,         /* all layers on DSS pipes */
+    HWC_STATS_MODE_SGX,         /* SGX composition in the framebuffer */
+    HWC_STATS_MODE_BLIT,        /* blits in the framebuffer */
+    HWC_STATS_MODE_NUM,
+};
+
+void hwc_stats_init(nsecs_t vsync_period);
+void hwc_stats_record(enum hwc_stat stat, nsecs_t time);
+void hwc_stats_post(nsecs_t timestamp, enum hwc_stats_mode mode);
+void hwc_stats_vsync(nsecs_t timestamp);
+/* Blits generated by the regionizer, and the ones merging subregions avoided */
+void hwc_stats_blits(int blits, int saved_blits);
+
+/* debug.hwc.showfps, re-read once a second by hwc_stats_post */
+bool hwc_stats_showfps(void);
+
+/* Returns the length written, like snprintf */
+int hwc_stats_dump(char *buff, int buff_len);
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HWC_TRACE_H__
+#define __HWC_TRACE_H__
+
+#include <stdint.h>
+
+/*
+ * Binary trace of the hwc_prepare and hwc_set calls, written by the HWC when
+ * debug.hwc.capture names a file, read back by the hwc_trace tool and
+ * replayed through the HWC by hwc_replay. Only fixed size types are used so
+ * traces can be read on the host.
+ *
+ * The file starts with a struct hwc_trace_header followed by one record per
+ * call: a struct hwc_trace_call, then num_layers struct hwc_trace_layer,
+ * num_ovls struct hwc_trace_ovl and num_blits struct hwc_trace_blit. Values
+ * are in the byte order of the device.
+ */
+
+#define HWC_TRACE_MAGIC 0x54435748 /* "HWCT" */
+#define HWC_TRACE_VERSION 1
+
+struct hwc_trace_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t fb_width;
+    uint32_t fb_height;
+    uint32_t fb_format;
+};
+
+enum hwc_trace_call_type {
+    HWC_TRACE_PREPARE = 1,
+    HWC_TRACE_SET = 2,
+};
+
+struct hwc_trace_call {
+    uint32_t type;
+    uint32_t sync_id;
+    int64_t timestamp;          /* monotonic time of the call, ns */
+    int64_t cpu_time;           /* thread CPU time spent in the call, ns */
+    int32_t err;
+    uint8_t use_sgx;
+    uint8_t swap_rb;
+    uint8_t ext_enabled;        /* external display cloning */
+    uint8_t ext_docking;
+    uint8_t reused;             /* prepare reused the last composition */
+    uint8_t pad[3];
+    uint32_t post2_layers;      /* buffers used with DSS pipes */
+    uint32_t post2_blit_buffers;
+    uint32_t num_layers;
+    uint32_t num_ovls;
+    uint32_t num_blits;
+};
+
+struct hwc_trace_rect {
+    int32_t left;
+    int32_t top;
+    int32_t right;
+    int32_t bottom;
+};
+
+struct hwc_trace_layer {
+    uint64_t handle;            /* buffer identity only */
+    int32_t format;             /* buffer attributes, 0 without a buffer */
+    int32_t width;
+    int32_t height;
+    int32_t usage;
+    int32_t compositionType;
+    uint32_t hints;
+    uint32_t flags;
+    uint32_t transform;
+    int32_t blending;
+    uint32_t num_visible_rects;
+    struct hwc_trace_rect sourceCrop;
+    struct hwc_trace_rect displayFrame;
+};
+
+struct hwc_trace_ovl {
+    uint8_t enabled;
+    uint8_t ix;
+    uint8_t mgr_ix;
+    uint8_t zorder;
+    uint8_t rotation;
+    uint8_t mirror;
+    uint8_t pre_mult_alpha;
+    uint8_t global_alpha;
+    uint32_t color_mode;
+    uint32_t addressing;
+    uint32_t ba;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    struct hwc_trace_rect crop;
+    struct hwc_trace_rect win;
+};
+
+/* Blit sources that aren't layer buffers */
+#define HWC_TRACE_BUF_FILL (-1) /* 1x1 fill pixel */
+#define HWC_TRACE_BUF_FB   (-2) /* framebuffer */
+#define HWC_TRACE_BUF_NONE (-3) /* no source */
+
+struct hwc_trace_blit {
+    uint32_t flags;
+    uint32_t op;                /* rop or blend, depending on flags */
+    int32_t src1;               /* index in the Post2 buffers or HWC_TRACE_BUF_* */
+    int32_t src2;
+    struct hwc_trace_rect dst;
+    struct hwc_trace_rect src1rect;
+    struct hwc_trace_rect src2rect;
+    struct hwc_trace_rect clip;
+};
+
+#endif
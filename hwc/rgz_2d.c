@@ -18,10 +18,12 @@
 #include <errno.h>
 #include <time.h>
 #include <assert.h>
+#include <string.h>
 #include <strings.h>
 #include <dlfcn.h>
 
 #include <fcntl.h>
+#include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <linux/fb.h>
 #include <linux/bltsville.h>
@@ -34,6 +36,11 @@
 
 #include "hwc_dev.h"
 
+/* Bionic has it, glibc doesn't for the host build of test/rgz_test.c */
+#ifndef __unused
+#define __unused __attribute__((unused))
+#endif
+
 static int rgz_handle_to_stride(IMG_native_handle_t *h);
 #define BVDUMP(p,t,parms)
 #define HANDLE_TO_BUFFER(h) NULL
@@ -71,27 +78,38 @@ static int rgz_handle_to_stride(IMG_native_handle_t *h);
 #define RGZ_BACKGROUND_BUFFIDX -2
 #define RGZ_CLEARHINT_BUFFIDX -1
 
-struct rgz_blts {
-    struct rgz_blt_entry bvcmds[RGZ_MAX_BLITS];
-    int idx;
-};
+/* Initial number of entries in the blit list, it doubles as needed */
+#define RGZ_BLTS_MINSIZE 64
+/* Initial number of layers to allocate storage for, it doubles as needed */
+#define RGZ_LAYERS_MINSIZE 16
+/* Smallest region arena chunk */
+#define RGZ_ARENA_MINSIZE 4096
+#define RGZ_ARENA_ALIGN(sz) (((sz) + 7) & ~7)
 
+/* Layer edge used to sweep the layers either vertically or horizontally */
+typedef struct rgz_edge {
+    int pos;
+    int z; /* Layer index, z-order */
+    int start; /* The layer begins at pos, otherwise it ends there */
+} rgz_edge_t;
 
-static int rgz_hwc_layer_blit(rgz_out_params_t *params, rgz_layer_t *rgz_layer);
+
+static int rgz_hwc_layer_blit(rgz_t *rgz, rgz_out_params_t *params, rgz_layer_t *rgz_layer);
 static void rgz_blts_init(struct rgz_blts *blts);
 static void rgz_blts_free(struct rgz_blts *blts);
+static int rgz_blts_reserve(struct rgz_blts *blts, int size);
 static struct rgz_blt_entry* rgz_blts_get(struct rgz_blts *blts, rgz_out_params_t *params);
 static int rgz_blts_bvdirect(rgz_t* rgz, struct rgz_blts *blts, rgz_out_params_t *params);
+static void rgz_out_clrdst(rgz_t *rgz, rgz_out_params_t *params, blit_rect_t *rect);
 static void rgz_get_src_rect(hwc_layer_1_t* layer, blit_rect_t *subregion_rect, blit_rect_t *res_rect);
+static int rgz_get_visible_rect(hwc_layer_1_t *layer, int screen_width,
+    int screen_height, blit_rect_t *res_rect);
 static int hal_to_ocd(int color);
 static int rgz_get_orientation(unsigned int transform);
 static int rgz_get_flip_flags(unsigned int transform, int use_src2_flags);
 static int rgz_hwc_scaled(hwc_layer_1_t *layer);
 
 int debug = 0;
-struct rgz_blts blts;
-/* Represents a screen sized background layer */
-static hwc_layer_1_t bg_layer;
 
 static void svgout_header(int htmlw, int htmlh, int coordw, int coordh)
 {
@@ -125,49 +143,36 @@ static int empty_rect(blit_rect_t *r)
     return !r->left && !r->top && !r->right && !r->bottom;
 }
 
-static int get_top_rect(blit_hregion_t *hregion, int subregion, blit_rect_t **routp)
+static int get_top_rect(blit_subregion_t *subregion, blit_rect_t **routp)
 {
-    int l = hregion->nlayers - 1;
-    do {
-        *routp = &hregion->blitrects[l][subregion];
-        if (!empty_rect(*routp))
-            break;
-    }
-    while (--l >= 0);
-    return l;
+    *routp = &subregion->rect;
+    return subregion->nlayers - 1;
 }
 
 /*
  * The idea here is that we walk the layers from front to back and count the
- * number of layers in the hregion until the first layer which doesn't require
- * blending.
+ * number of layers in the subregion until the first layer which doesn't
+ * require blending.
  */
-static int get_layer_ops(blit_hregion_t *hregion, int subregion, int *bottom)
+static int get_layer_ops(blit_subregion_t *subregion, int *bottom)
 {
-    int l = hregion->nlayers - 1;
+    int l = subregion->nlayers - 1;
     int ops = 0;
     *bottom = -1;
-    do {
-        if (!empty_rect(&hregion->blitrects[l][subregion])) {
-            ops++;
-            *bottom = l;
-            hwc_layer_1_t *layer = &hregion->rgz_layers[l]->hwc_layer;
-            IMG_native_handle_t *h = (IMG_native_handle_t *)layer->handle;
-            if ((layer->blending != HWC_BLENDING_PREMULT) || is_OPAQUE(h->iFormat))
-                break;
-        }
+    for (; l >= 0; l--) {
+        ops++;
+        *bottom = l;
+        hwc_layer_1_t *layer = &subregion->rgz_layers[l]->hwc_layer;
+        IMG_native_handle_t *h = (IMG_native_handle_t *)layer->handle;
+        if ((layer->blending != HWC_BLENDING_PREMULT) || is_OPAQUE(h->iFormat))
+            break;
     }
-    while (--l >= 0);
     return ops;
 }
 
-static int get_layer_ops_next(blit_hregion_t *hregion, int subregion, int l)
+static int get_layer_ops_next(blit_subregion_t *subregion, int l)
 {
-    while (++l < hregion->nlayers) {
-        if (!empty_rect(&hregion->blitrects[l][subregion]))
-            return l;
-    }
-    return -1;
+    return ++l < subregion->nlayers ? l : -1;
 }
 
 static int svgout_intersects_display(blit_rect_t *a, int dispw, int disph)
@@ -182,7 +187,7 @@ static void svgout_hregion(blit_hregion_t *hregion, int dispw, int disph)
     int b;
     for (b = 0; b < hregion->nsubregions; b++) {
         blit_rect_t *rect;
-        (void)get_top_rect(hregion, b, &rect);
+        (void)get_top_rect(&hregion->subregions[b], &rect);
         /* Only generate SVG for subregions intersecting the displayed area */
         if (!svgout_intersects_display(rect, dispw, disph))
             continue;
@@ -253,23 +258,40 @@ static int rgz_out_bvdirect_paint(rgz_t *rgz, rgz_out_params_t *params)
 {
     int rv = 0;
     int i;
-    (void)rgz;
 
-    rgz_blts_init(&blts);
+    rgz_blts_init(&rgz->blts);
+    rgz_out_clrdst(rgz, params, NULL);
 
     /* Begin from index 1 to remove the background layer from the output */
     rgz_fb_state_t *cur_fb_state = &rgz->cur_fb_state;
     for (i = 1; i < cur_fb_state->rgz_layerno; i++) {
-        rv = rgz_hwc_layer_blit(params, &cur_fb_state->rgz_layers[i]);
+        rgz_layer_t *rgz_layer = &cur_fb_state->rgz_layers[i];
+        hwc_layer_1_t *l = &rgz_layer->hwc_layer;
+
+        /* Layers with the clear fb hint only leave transparent pixels */
+        if (rgz_layer->buffidx == RGZ_CLEARHINT_BUFFIDX) {
+            struct bvsurfgeom *scrgeom = params->data.bv.dstgeom;
+            blit_rect_t srcregion;
+            /* Nothing to clear if the layer is off the screen */
+            if (rgz_get_visible_rect(l, scrgeom->width, scrgeom->height, &srcregion))
+                rgz_out_clrdst(rgz, params, &srcregion);
+            continue;
+        }
+
+        rv = rgz_hwc_layer_blit(rgz, params, rgz_layer);
         if (rv) {
             OUTE("bvdirect_paint: error in layer %d: %d", i, rv);
             dump_all(cur_fb_state->rgz_layers, cur_fb_state->rgz_layerno, i);
-            rgz_blts_free(&blts);
+            rgz_blts_free(&rgz->blts);
             return rv;
         }
     }
-    rgz_blts_bvdirect(rgz, &blts, params);
-    rgz_blts_free(&blts);
+    if (rgz->blts.error) {
+        rgz_blts_free(&rgz->blts);
+        return -1;
+    }
+    rv = rgz_blts_bvdirect(rgz, &rgz->blts, params);
+    rgz_blts_free(&rgz->blts);
     return rv;
 }
 
@@ -280,12 +302,12 @@ static void rgz_set_async(struct rgz_blt_entry *e, int async)
 
 static void rgz_get_screen_info(rgz_out_params_t *params, struct bvsurfgeom **screen_geom)
 {
-    *screen_geom = params->data.bvc.dstgeom;
+    *screen_geom = IS_BVCMD(params) ? params->data.bvc.dstgeom : params->data.bv.dstgeom;
 }
 
 static int rgz_is_blending_disabled(rgz_out_params_t *params)
 {
-    return params->data.bvc.noblend;
+    return IS_BVCMD(params) ? params->data.bvc.noblend : params->data.bv.noblend;
 }
 
 static void rgz_get_displayframe_rect(hwc_layer_1_t *layer, blit_rect_t *res_rect)
@@ -507,7 +529,7 @@ static void rgz_set_src_data(rgz_out_params_t *params __unused, rgz_layer_t *rgz
 
     srcdesc->structsize = sizeof(struct bvbuffdesc);
     srcdesc->length = handle->iHeight * HANDLE_TO_STRIDE(handle);
-    srcdesc->auxptr = (void*)rgz_layer->buffidx;
+    srcdesc->auxptr = (void*)(intptr_t)rgz_layer->buffidx;
     srcgeom->structsize = sizeof(struct bvsurfgeom);
     srcgeom->format = hal_to_ocd(handle->iFormat);
     srcgeom->width = handle->iWidth;
@@ -585,10 +607,10 @@ static void rgz_cfg_scale_mode(struct rgz_blt_entry* e, hwc_layer_1_t *layer)
 /*
  * Copies src1 into the framebuffer
  */
-static struct rgz_blt_entry* rgz_hwc_subregion_copy(rgz_out_params_t *params,
+static struct rgz_blt_entry* rgz_hwc_subregion_copy(rgz_t *rgz, rgz_out_params_t *params,
     blit_rect_t *subregion_rect, rgz_layer_t *rgz_src1)
 {
-    struct rgz_blt_entry* e = rgz_blts_get(&blts, params);
+    struct rgz_blt_entry* e = rgz_blts_get(&rgz->blts, params);
     hwc_layer_1_t *hwc_src1 = &rgz_src1->hwc_layer;
     e->bp.structsize = sizeof(struct bvbltparams);
     e->bp.op.rop = 0xCCCC; /* SRCCOPY */
@@ -619,10 +641,12 @@ static struct rgz_blt_entry* rgz_hwc_subregion_copy(rgz_out_params_t *params,
     rgz_set_clip_rect(params, subregion_rect, e);
     rgz_set_dst_data(params, &tmp_rect, e, dst_orientation);
 
+    /* Opaque sources fill in the alpha, in the channel order of the destination */
     if((e->src1geom.format == OCDFMT_BGR124) ||
        (e->src1geom.format == OCDFMT_RGB124) ||
        (e->src1geom.format == OCDFMT_RGB16))
-        e->dstgeom.format = OCDFMT_BGR124;
+        e->dstgeom.format = (e->dstgeom.format == OCDFMT_RGBA24 || e->dstgeom.format == OCDFMT_RGB124) ?
+                            OCDFMT_RGB124 : OCDFMT_BGR124;
 
     return e;
 }
@@ -632,10 +656,10 @@ static struct rgz_blt_entry* rgz_hwc_subregion_copy(rgz_out_params_t *params,
  * top most layer while src2 is the one behind. If src2 is NULL means src1 will
  * be blended with the current content of the framebuffer.
  */
-static struct rgz_blt_entry* rgz_hwc_subregion_blend(rgz_out_params_t *params,
+static struct rgz_blt_entry* rgz_hwc_subregion_blend(rgz_t *rgz, rgz_out_params_t *params,
     blit_rect_t *subregion_rect, rgz_layer_t *rgz_src1, rgz_layer_t *rgz_src2)
 {
-    struct rgz_blt_entry* e = rgz_blts_get(&blts, params);
+    struct rgz_blt_entry* e = rgz_blts_get(&rgz->blts, params);
     hwc_layer_1_t *hwc_src1 = &rgz_src1->hwc_layer;
     e->bp.structsize = sizeof(struct bvbltparams);
     e->bp.op.blend = BVBLEND_SRC1OVER;
@@ -693,9 +717,9 @@ static struct rgz_blt_entry* rgz_hwc_subregion_blend(rgz_out_params_t *params,
  * Clear the destination buffer, if rect is NULL means the whole screen, rect
  * cannot be outside the boundaries of the screen
  */
-static void rgz_out_clrdst(rgz_out_params_t *params, blit_rect_t *rect)
+static void rgz_out_clrdst(rgz_t *rgz, rgz_out_params_t *params, blit_rect_t *rect)
 {
-    struct rgz_blt_entry* e = rgz_blts_get(&blts, params);
+    struct rgz_blt_entry* e = rgz_blts_get(&rgz->blts, params);
     e->bp.structsize = sizeof(struct bvbltparams);
     e->bp.op.rop = 0xCCCC; /* SRCCOPY */
     e->bp.flags = BVFLAG_CLIP | BVFLAG_ROP;
@@ -738,11 +762,17 @@ static int rgz_out_bvcmd_paint(rgz_t *rgz, rgz_out_params_t *params)
     int i, j;
     params->data.bvc.out_blits = 0;
     params->data.bvc.out_nhndls = 0;
-    rgz_blts_init(&blts);
-    rgz_out_clrdst(params, NULL);
+    params->data.bvc.out_hndls = rgz->hndls;
+    rgz_blts_init(&rgz->blts);
 
-    /* Begin from index 1 to remove the background layer from the output */
+    /* At most a clear and one blit per layer */
     rgz_fb_state_t *cur_fb_state = &rgz->cur_fb_state;
+    if (rgz_blts_reserve(&rgz->blts, cur_fb_state->rgz_layerno + 1))
+        return -1;
+
+    rgz_out_clrdst(rgz, params, NULL);
+
+    /* Begin from index 1 to remove the background layer from the output */
     for (i = 1, j = 0; i < cur_fb_state->rgz_layerno; i++) {
         rgz_layer_t *rgz_layer = &cur_fb_state->rgz_layers[i];
         hwc_layer_1_t *l = &rgz_layer->hwc_layer;
@@ -756,37 +786,35 @@ static int rgz_out_bvcmd_paint(rgz_t *rgz, rgz_out_params_t *params)
         if (rgz_layer->buffidx == -1) {
             struct bvsurfgeom *scrgeom = params->data.bvc.dstgeom;
             blit_rect_t srcregion;
-            srcregion.left = max(0, l->displayFrame.left);
-            srcregion.top = max(0, l->displayFrame.top);
-            srcregion.bottom = min(scrgeom->height, l->displayFrame.bottom);
-            srcregion.right = min(scrgeom->width, l->displayFrame.right);
-            rgz_out_clrdst(params, &srcregion);
+            /* Nothing to clear if the layer is off the screen */
+            if (rgz_get_visible_rect(l, scrgeom->width, scrgeom->height, &srcregion))
+                rgz_out_clrdst(rgz, params, &srcregion);
             continue;
         }
 
-        rv = rgz_hwc_layer_blit(params, rgz_layer);
+        rv = rgz_hwc_layer_blit(rgz, params, rgz_layer);
         if (rv) {
             OUTE("bvcmd_paint: error in layer %d: %d", i, rv);
             dump_all(cur_fb_state->rgz_layers, cur_fb_state->rgz_layerno, i);
-            rgz_blts_free(&blts);
+            rgz_blts_free(&rgz->blts);
             return rv;
         }
-        params->data.bvc.out_hndls[j++] = l->handle;
+        rgz->hndls[j++] = l->handle;
         params->data.bvc.out_nhndls++;
     }
 
     /* Last blit is made sync to act like a fence for the previous async blits */
-    struct rgz_blt_entry* e = &blts.bvcmds[blts.idx-1];
+    struct rgz_blt_entry* e = &rgz->blts.bvcmds[rgz->blts.idx-1];
     rgz_set_async(e, 0);
 
     /* FIXME: we want to be able to call rgz_blts_free and populate the actual
      * composition data structure ourselves */
-    params->data.bvc.cmdp = blts.bvcmds;
-    params->data.bvc.cmdlen = blts.idx;
+    params->data.bvc.cmdp = rgz->blts.bvcmds;
+    params->data.bvc.cmdlen = rgz->blts.idx;
 
-    if (params->data.bvc.out_blits >= RGZ_MAX_BLITS) {
+    if (rgz->blts.error) {
         rv = -1;
-    // rgz_blts_free(&blts); // FIXME
+    // rgz_blts_free(&rgz->blts); // FIXME
     }
     return rv;
 }
@@ -813,101 +841,198 @@ static float getscaleh(hwc_layer_1_t *layer)
     return ((float)HEIGHT(layer->displayFrame)) / (float)h;
 }
 
+static int rgz_cmp_int(const void *a, const void *b)
+{
+    int ia = *(const int *)a, ib = *(const int *)b;
+    return (ia > ib) - (ia < ib);
+}
+
 /*
- * Simple bubble sort on an array, ascending order
+ * Sort an array in ascending order and leave only unique numbers, returns the
+ * number of unique entries
  */
-static void rgz_bsort(int *a, int len)
+static int rgz_sort_unique(int *a, int len)
 {
-    int i, j;
+    int i, unique = 0;
+    qsort(a, len, sizeof(*a), rgz_cmp_int);
     for (i = 0; i < len; i++) {
-        for (j = 0; j < i; j++) {
-            if (a[i] < a[j]) {
-                int temp = a[i];
-                a[i] = a[j];
-                a[j] = temp;
-            }
+        if (!unique || a[unique - 1] != a[i])
+            a[unique++] = a[i];
+    }
+    return unique;
+}
+
+static int rgz_cmp_edge(const void *a, const void *b)
+{
+    const rgz_edge_t *ea = a, *eb = b;
+    if (ea->pos != eb->pos)
+        return ea->pos < eb->pos ? -1 : 1;
+    return ea->z - eb->z;
+}
+
+/*
+ * Apply the edges at or before pos to the active layer set, which is kept in
+ * z-order. Returns the index of the first edge after pos.
+ */
+static int rgz_sweep_to(rgz_edge_t *edges, int nedges, int e, int pos,
+    int *active, int *nactive)
+{
+    for (; e < nedges && edges[e].pos <= pos; e++) {
+        int z = edges[e].z;
+        /* Binary search the position of the layer in the active set */
+        int i = 0, hi = *nactive;
+        while (i < hi) {
+            int mid = (i + hi) >> 1;
+            if (active[mid] < z)
+                i = mid + 1;
+            else
+                hi = mid;
+        }
+        if (edges[e].start) {
+            memmove(&active[i + 1], &active[i], (*nactive - i) * sizeof(*active));
+            active[i] = z;
+            (*nactive)++;
+        } else if (i < *nactive && active[i] == z) {
+            memmove(&active[i], &active[i + 1], (*nactive - i - 1) * sizeof(*active));
+            (*nactive)--;
         }
     }
+    return e;
 }
 
 /*
- * Leave only unique numbers in a sorted array
+ * Return the layer display frame clipped to the screen, false if nothing of
+ * the layer is visible
  */
-static int rgz_bunique(int *a, int len)
-{
-    int unique = 1;
-    int base = 0;
-    while (base + 1 < len) {
-        if (a[base] == a[base + 1]) {
-            int skip = 1;
-            while (base + skip < len && a[base] == a[base + skip])
-                skip++;
-            if (base + skip == len)
-                break;
-            int i;
-            for (i = 0; i < skip - 1; i++)
-                a[base + 1 + i] = a[base + skip];
+static int rgz_get_visible_rect(hwc_layer_1_t *layer, int screen_width,
+    int screen_height, blit_rect_t *res_rect)
+{
+    res_rect->left = min(max(0, layer->displayFrame.left), screen_width);
+    res_rect->top = min(max(0, layer->displayFrame.top), screen_height);
+    res_rect->right = max(min(layer->displayFrame.right, screen_width), 0);
+    res_rect->bottom = max(min(layer->displayFrame.bottom, screen_height), 0);
+    return res_rect->left < res_rect->right && res_rect->top < res_rect->bottom;
+}
+
+static void *rgz_arena_alloc(rgz_arena_t *arena, size_t size)
+{
+    rgz_arena_chunk_t *chunk = arena->chunks;
+    size = RGZ_ARENA_ALIGN(size);
+    if (!chunk || chunk->used + size > chunk->size) {
+        size_t chunk_size = chunk ? chunk->size << 1 : RGZ_ARENA_MINSIZE;
+        while (chunk_size < size)
+            chunk_size <<= 1;
+        rgz_arena_chunk_t *new_chunk = malloc(RGZ_ARENA_ALIGN(sizeof(*chunk)) + chunk_size);
+        if (!new_chunk) {
+            OUTE("Unable to grow the region arena by %d bytes", (int)chunk_size);
+            return NULL;
         }
-        unique++;
-        base++;
+        new_chunk->next = chunk;
+        new_chunk->size = chunk_size;
+        new_chunk->used = 0;
+        arena->chunks = chunk = new_chunk;
     }
-    return unique;
+    void *p = (char *)chunk + RGZ_ARENA_ALIGN(sizeof(*chunk)) + chunk->used;
+    chunk->used += size;
+    return p;
+}
+
+static void rgz_arena_free(rgz_arena_t *arena)
+{
+    rgz_arena_chunk_t *chunk = arena->chunks;
+    while (chunk) {
+        rgz_arena_chunk_t *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->chunks = NULL;
+}
+
+static void rgz_arena_reset(rgz_arena_t *arena)
+{
+    rgz_arena_chunk_t *chunk = arena->chunks;
+    if (!chunk)
+        return;
+
+    if (chunk->next) {
+        /* Replace the chain with a single chunk able to hold all of it */
+        size_t size = 0;
+        for (; chunk; chunk = chunk->next)
+            size += chunk->size;
+        rgz_arena_free(arena);
+        chunk = malloc(RGZ_ARENA_ALIGN(sizeof(*chunk)) + size);
+        if (!chunk)
+            return; /* Allocate again on demand */
+        chunk->next = NULL;
+        chunk->size = size;
+        arena->chunks = chunk;
+    }
+    chunk->used = 0;
 }
 
-static void rgz_gen_blitregions(rgz_t *rgz, blit_hregion_t *hregion, int screen_width)
+static int rgz_gen_blitregions(rgz_t *rgz, blit_hregion_t *hregion, int screen_width,
+    int screen_height, int *xentries, rgz_edge_t *edges, int *active)
 {
 /*
  * 1. Get the offsets (left/right positions) of each layer within the
  *    hregion. Assume that layers describe the bounds of the hregion.
- * 2. We should then be able to generate an array of rects
- * 3. Each layer will have a different z-order, for each z-order
- *    find the intersection. Some intersections will be empty.
+ * 2. Sweep the layer edges from left to right keeping the set of layers
+ *    covering the current position, in z-order.
+ * 3. Each pair of consecutive offsets is a subregion covered by the layers in
+ *    the set at that point.
  */
 
-    int offsets[RGZ_SUBREGIONMAX];
-    int noffsets=0;
-    int l, r;
+    int noffsets = 0, nedges = 0, nactive = 0;
+    int l, r, e = 0;
 
-    /*
-     * Add damaged region, then all layers. We are guaranteed to not go outside
-     * of offsets array boundaries at this point.
-     */
-    offsets[noffsets++] = rgz->damaged_area.left;
-    offsets[noffsets++] = rgz->damaged_area.right;
+    /* Add damaged region, then all layers */
+    xentries[noffsets++] = rgz->damaged_area.left;
+    xentries[noffsets++] = rgz->damaged_area.right;
 
     for (l = 0; l < hregion->nlayers; l++) {
-        hwc_layer_1_t *layer = &hregion->rgz_layers[l]->hwc_layer;
+        blit_rect_t rect;
         /* Make sure the subregion is not outside the boundaries of the screen */
-        offsets[noffsets++] = max(0, layer->displayFrame.left);
-        offsets[noffsets++] = min(layer->displayFrame.right, screen_width);
-    }
-    rgz_bsort(offsets, noffsets);
-    noffsets = rgz_bunique(offsets, noffsets);
-    hregion->nsubregions = noffsets - 1;
-    bzero(hregion->blitrects, sizeof(hregion->blitrects));
-    for (r = 0; r + 1 < noffsets; r++) {
-        blit_rect_t subregion;
-        subregion.top = hregion->rect.top;
-        subregion.bottom = hregion->rect.bottom;
-        subregion.left = offsets[r];
-        subregion.right = offsets[r+1];
-
-        ALOGD_IF(debug, "                sub l %d r %d",
-            subregion.left, subregion.right);
-        for (l = 0; l < hregion->nlayers; l++) {
-            hwc_layer_1_t *layer = &hregion->rgz_layers[l]->hwc_layer;
-            if (RECT_INTERSECTS(subregion, layer->displayFrame)) {
-
-                hregion->blitrects[l][r] = subregion;
-
-                ALOGD_IF(debug, "hregion->blitrects[%d][%d] (%d %d %d %d)", l, r,
-                        hregion->blitrects[l][r].left,
-                        hregion->blitrects[l][r].top,
-                        hregion->blitrects[l][r].right,
-                        hregion->blitrects[l][r].bottom);
-            }
-        }
+        if (!rgz_get_visible_rect(&hregion->rgz_layers[l]->hwc_layer, screen_width,
+                screen_height, &rect))
+            continue;
+        xentries[noffsets++] = rect.left;
+        xentries[noffsets++] = rect.right;
+        edges[nedges].pos = rect.left;
+        edges[nedges].z = l;
+        edges[nedges++].start = 1;
+        edges[nedges].pos = rect.right;
+        edges[nedges].z = l;
+        edges[nedges++].start = 0;
+    }
+    noffsets = rgz_sort_unique(xentries, noffsets);
+    qsort(edges, nedges, sizeof(*edges), rgz_cmp_edge);
+
+    hregion->nsubregions = max(noffsets - 1, 0);
+    hregion->subregions = rgz_arena_alloc(&rgz->arena,
+        hregion->nsubregions * sizeof(blit_subregion_t));
+    if (!hregion->subregions)
+        return -1;
+
+    for (r = 0; r < hregion->nsubregions; r++) {
+        blit_subregion_t *subregion = &hregion->subregions[r];
+        subregion->rect.top = hregion->rect.top;
+        subregion->rect.bottom = hregion->rect.bottom;
+        subregion->rect.left = xentries[r];
+        subregion->rect.right = xentries[r+1];
+
+        e = rgz_sweep_to(edges, nedges, e, subregion->rect.left, active, &nactive);
+        subregion->nlayers = nactive;
+        subregion->rgz_layers = rgz_arena_alloc(&rgz->arena, nactive * sizeof(rgz_layer_t *));
+        if (!subregion->rgz_layers)
+            return -1;
+        for (l = 0; l < nactive; l++)
+            subregion->rgz_layers[l] = hregion->rgz_layers[active[l]];
+        rgz->nops += nactive;
+
+        ALOGD_IF(debug, "                sub l %d r %d layers %d",
+            subregion->rect.left, subregion->rect.right, subregion->nlayers);
     }
+    return 0;
 }
 
 static int rgz_hwc_scaled(hwc_layer_1_t *layer)
@@ -921,12 +1046,18 @@ static int rgz_hwc_scaled(hwc_layer_1_t *layer)
     return WIDTH(layer->displayFrame) != w || HEIGHT(layer->displayFrame) != h;
 }
 
-static int rgz_in_valid_hwc_layer(hwc_layer_1_t *layer)
+int rgz_in_valid_hwc_layer(hwc_layer_1_t *layer)
 {
     IMG_native_handle_t *handle = (IMG_native_handle_t *)layer->handle;
     if ((layer->flags & HWC_SKIP_LAYER) || !handle)
         return 0;
 
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+    /* Plane alpha came with HWC 1.2 and isn't applied by the blits */
+    if (layer->planeAlpha != 0xFF)
+        return 0;
+#endif
+
     if (is_NV12(handle->iFormat))
         return handle->iFormat == HAL_PIXEL_FORMAT_TI_NV12;
 
@@ -959,13 +1090,70 @@ static int rgz_in_valid_hwc_layer(hwc_layer_1_t *layer)
 static void rgz_delete_region_data(rgz_t *rgz){
     if (!rgz)
         return;
-    if (rgz->hregions)
-        free(rgz->hregions);
+    rgz_arena_reset(&rgz->arena);
     rgz->hregions = NULL;
     rgz->nhregions = 0;
+    rgz->nops = 0;
     rgz->state &= ~RGZ_REGION_DATA;
 }
 
+/*
+ * Make room for layerno layers in the framebuffer states. The region data
+ * points into the current state, it is discarded if the storage moves.
+ */
+static int rgz_reserve_layers(rgz_t *rgz, int layerno)
+{
+    rgz_fb_state_t *cur_fb_state = &rgz->cur_fb_state;
+    int size = cur_fb_state->size ? cur_fb_state->size : RGZ_LAYERS_MINSIZE;
+    int i;
+
+    if (layerno <= cur_fb_state->size)
+        return 0;
+    while (size < layerno)
+        size <<= 1;
+
+    buffer_handle_t *hndls = realloc(rgz->hndls, size * sizeof(*hndls));
+    if (!hndls)
+        goto fail;
+    rgz->hndls = hndls;
+
+    for (i = 0; i < RGZ_NUM_FB; i++) {
+        rgz_fb_state_t *fb_state = &rgz->fb_states[i];
+        if (fb_state->size >= size)
+            continue;
+        rgz_layer_t *rgz_layers = realloc(fb_state->rgz_layers, size * sizeof(*rgz_layers));
+        if (!rgz_layers)
+            goto fail;
+        fb_state->rgz_layers = rgz_layers;
+        fb_state->size = size;
+    }
+
+    rgz_delete_region_data(rgz);
+    rgz_layer_t *rgz_layers = realloc(cur_fb_state->rgz_layers, size * sizeof(*rgz_layers));
+    if (!rgz_layers)
+        goto fail;
+    cur_fb_state->rgz_layers = rgz_layers;
+    cur_fb_state->size = size;
+    return 0;
+
+fail:
+    OUTE("Unable to allocate room for %d layers", layerno);
+    return -1;
+}
+
+/* Forget the previous compositions but keep the allocated storage */
+static void rgz_reset(rgz_t *rgz)
+{
+    int i;
+    rgz_delete_region_data(rgz);
+    rgz->state = 0;
+    rgz->cur_fb_state.rgz_layerno = 0;
+    for (i = 0; i < RGZ_NUM_FB; i++)
+        rgz->fb_states[i].rgz_layerno = 0;
+    rgz->fb_state_idx = 0;
+    bzero(&rgz->damaged_area, sizeof(rgz->damaged_area));
+}
+
 static rgz_fb_state_t* get_prev_fb_state(rgz_t *rgz)
 {
     return &rgz->fb_states[rgz->fb_state_idx];
@@ -1121,11 +1309,12 @@ static void rgz_handle_dirty_region(rgz_t *rgz, rgz_in_params_t *params,
         } else
             cur_rgz_layer->dirty_count = RGZ_NUM_FB;
 
-        /* If the layer is new, redraw the layer area */
-        if (!prev_rgz_layer) {
+        /*
+         * If the layer is new, redraw the layer area. Its identity may still
+         * have been used by a layer somewhere else in the target frame.
+         */
+        if (!prev_rgz_layer)
             rgz_add_to_damaged_area(params, cur_rgz_layer, &rgz->damaged_area);
-            continue;
-        }
 
         /* Nothing more to do with the background layer */
         if (i == 0)
@@ -1172,22 +1361,35 @@ static void rgz_handle_dirty_region(rgz_t *rgz, rgz_in_params_t *params,
     }
 }
 
-/* Adds the background layer in first the position of the passed fb state */
-static void rgz_add_background_layer(rgz_fb_state_t *fb_state)
+/* Adds a screen sized background layer in the first position of the passed fb state */
+static void rgz_add_background_layer(rgz_fb_state_t *fb_state, struct bvsurfgeom *screen_geom)
 {
     rgz_layer_t *rgz_layer = &fb_state->rgz_layers[0];
-    rgz_layer->hwc_layer = bg_layer;
+    bzero(&rgz_layer->hwc_layer, sizeof(rgz_layer->hwc_layer));
+    rgz_layer->hwc_layer.displayFrame.right = screen_geom->width;
+    rgz_layer->hwc_layer.displayFrame.bottom = screen_geom->height;
     rgz_layer->buffidx = RGZ_BACKGROUND_BUFFIDX;
     /* Set dummy handle to maintain dirty region state */
     rgz_layer->hwc_layer.handle = (void*) 0x1;
 }
 
-static int rgz_in_hwccheck(rgz_in_params_t *p, rgz_t *rgz)
+/*
+ * Without identities from SurfaceFlinger the position in the list stands in
+ * for them. A layer taking the place of another one has a different buffer,
+ * so the damage is still found, only redrawing more than needed.
+ */
+static uint32_t rgz_in_layer_identity(rgz_in_params_t *p, int l)
 {
-    hwc_layer_1_t *layers = p->data.hwc.layers;
 #ifdef OMAP_ENHANCEMENT_HWC_EXTENDED_API
-    hwc_layer_extended_t *extlayers = p->data.hwc.extlayers;
+    if (p->data.hwc.extlayers)
+        return p->data.hwc.extlayers[l].identity;
 #endif
+    return l;
+}
+
+static int rgz_in_hwccheck(rgz_in_params_t *p, rgz_t *rgz)
+{
+    hwc_layer_1_t *layers = p->data.hwc.layers;
     int layerno = p->data.hwc.layerno;
 
     rgz->state &= ~RGZ_STATE_INIT;
@@ -1195,6 +1397,10 @@ static int rgz_in_hwccheck(rgz_in_params_t *p, rgz_t *rgz)
     if (!layers)
         return -1;
 
+    /* Account for the background layer */
+    if (rgz_reserve_layers(rgz, layerno + 1))
+        return -1;
+
     /* For debugging */
     //dump_all(layers, layerno, 0);
 
@@ -1215,18 +1421,15 @@ static int rgz_in_hwccheck(rgz_in_params_t *p, rgz_t *rgz)
      * state for dirty region handling
      */
     rgz_fb_state_t *cur_fb_state = &rgz->cur_fb_state;
-    rgz_add_background_layer(cur_fb_state);
+    rgz_add_background_layer(cur_fb_state, p->data.hwc.dstgeom);
 
     for (l = 0; l < layerno; l++) {
         if (layers[l].compositionType == HWC_FRAMEBUFFER) {
             candidates++;
-            if (rgz_in_valid_hwc_layer(&layers[l]) &&
-                    possible_blit < RGZ_INPUT_MAXLAYERS) {
+            if (rgz_in_valid_hwc_layer(&layers[l])) {
                 rgz_layer_t *rgz_layer = &cur_fb_state->rgz_layers[possible_blit+1];
                 rgz_layer->hwc_layer = layers[l];
-#ifdef OMAP_ENHANCEMENT_HWC_EXTENDED_API
-                rgz_layer->identity = extlayers[l].identity;
-#endif
+                rgz_layer->identity = rgz_in_layer_identity(p, l);
                 rgz_layer->buffidx = memidx++;
                 possible_blit++;
             }
@@ -1235,21 +1438,17 @@ static int rgz_in_hwccheck(rgz_in_params_t *p, rgz_t *rgz)
 
         if (layers[l].hints & HWC_HINT_CLEAR_FB) {
             candidates++;
-            if (possible_blit < RGZ_INPUT_MAXLAYERS) {
-                /*
-                 * Use only the layer rectangle as an input to regionize when the clear
-                 * fb hint is present, mark this layer to identify it.
-                 */
-                rgz_layer_t *rgz_layer = &cur_fb_state->rgz_layers[possible_blit+1];
-                rgz_layer->hwc_layer = layers[l];
-#ifdef OMAP_ENHANCEMENT_HWC_EXTENDED_API
-                rgz_layer->identity = extlayers[l].identity;
-#endif
-                rgz_layer->buffidx = RGZ_CLEARHINT_BUFFIDX;
-                /* Set dummy handle to maintain dirty region state */
-                rgz_layer->hwc_layer.handle = (void*) 0x1;
-                possible_blit++;
-            }
+            /*
+             * Use only the layer rectangle as an input to regionize when the clear
+             * fb hint is present, mark this layer to identify it.
+             */
+            rgz_layer_t *rgz_layer = &cur_fb_state->rgz_layers[possible_blit+1];
+            rgz_layer->hwc_layer = layers[l];
+            rgz_layer->identity = rgz_in_layer_identity(p, l);
+            rgz_layer->buffidx = RGZ_CLEARHINT_BUFFIDX;
+            /* Set dummy handle to maintain dirty region state */
+            rgz_layer->hwc_layer.handle = (void*) 0x1;
+            possible_blit++;
         }
     }
 
@@ -1266,6 +1465,11 @@ static int rgz_in_hwccheck(rgz_in_params_t *p, rgz_t *rgz)
 
     /* Modifiy dirty counters and create the damaged region */
     rgz_handle_dirty_region(rgz, p, prev_fb_state, target_fb_state);
+    if (p->data.hwc.flags & RGZ_IN_HWC_REDRAW) {
+        rgz->damaged_area.left = rgz->damaged_area.top = 0;
+        rgz->damaged_area.right = p->data.hwc.dstgeom->width;
+        rgz->damaged_area.bottom = p->data.hwc.dstgeom->height;
+    }
 
     /* Copy the current geometry to use it in the next frame */
     memcpy(target_fb_state->rgz_layers, cur_fb_state->rgz_layers, sizeof(rgz_layer_t) * cur_fb_state->rgz_layerno);
@@ -1274,14 +1478,60 @@ static int rgz_in_hwccheck(rgz_in_params_t *p, rgz_t *rgz)
     return RGZ_ALL;
 }
 
+/* Check whether the region data was generated for the current composition */
+static int rgz_same_geometry(rgz_in_params_t *p, rgz_t *rgz)
+{
+    rgz_geometry_t *geometry = &rgz->geometry;
+    rgz_fb_state_t *cur_fb_state = &rgz->cur_fb_state;
+    int i;
+
+    if (!(rgz->state & RGZ_REGION_DATA) ||
+            geometry->screen_width != p->data.hwc.dstgeom->width ||
+            geometry->screen_height != p->data.hwc.dstgeom->height ||
+            geometry->layerno != cur_fb_state->rgz_layerno ||
+            memcmp(&geometry->damaged_area, &rgz->damaged_area, sizeof(rgz->damaged_area)))
+        return 0;
+
+    for (i = 0; i < cur_fb_state->rgz_layerno; i++) {
+        if (memcmp(&geometry->frames[i], &cur_fb_state->rgz_layers[i].hwc_layer.displayFrame,
+                sizeof(hwc_rect_t)))
+            return 0;
+    }
+    return 1;
+}
+
+static void rgz_set_geometry(rgz_in_params_t *p, rgz_t *rgz)
+{
+    rgz_geometry_t *geometry = &rgz->geometry;
+    rgz_fb_state_t *cur_fb_state = &rgz->cur_fb_state;
+    int i;
+
+    if (geometry->size < cur_fb_state->rgz_layerno) {
+        hwc_rect_t *frames = realloc(geometry->frames, cur_fb_state->size * sizeof(*frames));
+        if (!frames) {
+            /* Never matches, the region data is generated on every frame */
+            geometry->layerno = -1;
+            return;
+        }
+        geometry->frames = frames;
+        geometry->size = cur_fb_state->size;
+    }
+
+    geometry->screen_width = p->data.hwc.dstgeom->width;
+    geometry->screen_height = p->data.hwc.dstgeom->height;
+    geometry->damaged_area = rgz->damaged_area;
+    geometry->layerno = cur_fb_state->rgz_layerno;
+    for (i = 0; i < cur_fb_state->rgz_layerno; i++)
+        geometry->frames[i] = cur_fb_state->rgz_layers[i].hwc_layer.displayFrame;
+}
+
 static int rgz_in_hwc(rgz_in_params_t *p, rgz_t *rgz)
 {
     int i, j;
-    int yentries[RGZ_SUBREGIONMAX];
-    int dispw;  /* widest layer */
     int screen_width = p->data.hwc.dstgeom->width;
     int screen_height = p->data.hwc.dstgeom->height;
     rgz_fb_state_t *cur_fb_state = &rgz->cur_fb_state;
+    int layerno = cur_fb_state->rgz_layerno;
 
     if (!(rgz->state & RGZ_STATE_INIT)) {
         OUTE("rgz_process started with bad state");
@@ -1289,78 +1539,108 @@ static int rgz_in_hwc(rgz_in_params_t *p, rgz_t *rgz)
     }
 
     /*
-     * Figure out if there is enough space to store the top-bottom coordinates
-     * of each layer including the damaged area
+     * Most compositions only change buffer contents, keep the previous region
+     * data if nothing it depends on has moved
      */
-    if (((cur_fb_state->rgz_layerno + 1) * 2) > RGZ_SUBREGIONMAX) {
-        OUTE("%s: Not enough space to store top-bottom coordinates of each layer (max %d, needed %d*2)",
-            __func__, RGZ_SUBREGIONMAX, cur_fb_state->rgz_layerno + 1);
-        return -1;
+    rgz->reused = rgz_same_geometry(p, rgz);
+    if (rgz->reused) {
+        ALOGD_IF(debug, "Geometry unchanged, reusing %d hregions", rgz->nhregions);
+        return 0;
     }
 
     /* Delete the previous region data */
     rgz_delete_region_data(rgz);
 
+    /*
+     * Scratch space for the sweep, the top-bottom or left-right coordinates of
+     * each layer including the damaged area and the edges of each layer
+     */
+    int *yentries = rgz_arena_alloc(&rgz->arena, (layerno + 1) * 2 * sizeof(int));
+    int *xentries = rgz_arena_alloc(&rgz->arena, (layerno + 1) * 2 * sizeof(int));
+    rgz_edge_t *edges = rgz_arena_alloc(&rgz->arena, layerno * 2 * sizeof(rgz_edge_t));
+    int *active = rgz_arena_alloc(&rgz->arena, layerno * sizeof(int));
+    if (!yentries || !xentries || !edges || !active)
+        goto fail;
+
     /*
      * Find the horizontal regions, add damaged area first which is already
      * inside display boundaries
      */
-    int ylen = 0;
+    int ylen = 0, nedges = 0;
     yentries[ylen++] = rgz->damaged_area.top;
     yentries[ylen++] = rgz->damaged_area.bottom;
-    dispw = rgz->damaged_area.right;
 
-    /* Add the top and bottom coordinates of each layer */
-    for (i = 0; i < cur_fb_state->rgz_layerno; i++) {
-        hwc_layer_1_t *layer = &cur_fb_state->rgz_layers[i].hwc_layer;
+    /* Add the top and bottom coordinates of each visible layer */
+    for (i = 0; i < layerno; i++) {
+        blit_rect_t rect;
         /* Maintain regions inside display boundaries */
-        yentries[ylen++] = max(0, layer->displayFrame.top);
-        yentries[ylen++] = min(layer->displayFrame.bottom, screen_height);
-        dispw = dispw > layer->displayFrame.right ? dispw : layer->displayFrame.right;
+        if (!rgz_get_visible_rect(&cur_fb_state->rgz_layers[i].hwc_layer,
+                screen_width, screen_height, &rect))
+            continue;
+        yentries[ylen++] = rect.top;
+        yentries[ylen++] = rect.bottom;
+        edges[nedges].pos = rect.top;
+        edges[nedges].z = i;
+        edges[nedges++].start = 1;
+        edges[nedges].pos = rect.bottom;
+        edges[nedges].z = i;
+        edges[nedges++].start = 0;
     }
-    rgz_bsort(yentries, ylen);
-    ylen = rgz_bunique(yentries, ylen);
+    ylen = rgz_sort_unique(yentries, ylen);
+    qsort(edges, nedges, sizeof(*edges), rgz_cmp_edge);
 
     /* at this point we have an array of horizontal regions */
-    rgz->nhregions = ylen - 1;
+    rgz->nhregions = max(ylen - 1, 0);
 
-    blit_hregion_t *hregions = calloc(rgz->nhregions, sizeof(blit_hregion_t));
+    blit_hregion_t *hregions = rgz_arena_alloc(&rgz->arena, rgz->nhregions * sizeof(blit_hregion_t));
     if (!hregions) {
         OUTE("Unable to allocate memory for hregions");
-        return -1;
+        goto fail;
     }
     rgz->hregions = hregions;
 
     ALOGD_IF(debug, "Allocated %d regions (sz = %d), layerno = %d", rgz->nhregions,
-        rgz->nhregions * sizeof(blit_hregion_t), cur_fb_state->rgz_layerno);
+        rgz->nhregions * sizeof(blit_hregion_t), layerno);
 
+    /*
+     * Sweep the layer edges from top to bottom, the layers intersecting a
+     * hregion are the ones active at its top
+     */
+    int e = 0, nactive = 0;
     for (i = 0; i < rgz->nhregions; i++) {
         hregions[i].rect.top = yentries[i];
         hregions[i].rect.bottom = yentries[i+1];
         /* Avoid hregions outside the display boundaries */
         hregions[i].rect.left = 0;
-        hregions[i].rect.right = dispw > screen_width ? screen_width : dispw;
-        hregions[i].nlayers = 0;
-        for (j = 0; j < cur_fb_state->rgz_layerno; j++) {
-            hwc_layer_1_t *layer = &cur_fb_state->rgz_layers[j].hwc_layer;
-            if (RECT_INTERSECTS(hregions[i].rect, layer->displayFrame)) {
-                int l = hregions[i].nlayers++;
-                hregions[i].rgz_layers[l] = &cur_fb_state->rgz_layers[j];
-            }
-        }
+        hregions[i].rect.right = screen_width;
+
+        e = rgz_sweep_to(edges, nedges, e, hregions[i].rect.top, active, &nactive);
+        hregions[i].nlayers = nactive;
+        hregions[i].rgz_layers = rgz_arena_alloc(&rgz->arena, nactive * sizeof(rgz_layer_t *));
+        if (!hregions[i].rgz_layers)
+            goto fail;
+        for (j = 0; j < nactive; j++)
+            hregions[i].rgz_layers[j] = &cur_fb_state->rgz_layers[active[j]];
     }
 
     /* Calculate blit regions */
     for (i = 0; i < rgz->nhregions; i++) {
-        rgz_gen_blitregions(rgz, &hregions[i], screen_width);
+        if (rgz_gen_blitregions(rgz, &hregions[i], screen_width, screen_height,
+                xentries, edges, active))
+            goto fail;
         ALOGD_IF(debug, "hregion %3d: nsubregions %d", i, hregions[i].nsubregions);
         ALOGD_IF(debug, "           : %d to %d: ",
             hregions[i].rect.top, hregions[i].rect.bottom);
         for (j = 0; j < hregions[i].nlayers; j++)
             ALOGD_IF(debug, "              %p ", &hregions[i].rgz_layers[j]->hwc_layer);
     }
+    rgz_set_geometry(p, rgz);
     rgz->state |= RGZ_REGION_DATA;
     return 0;
+
+fail:
+    rgz_delete_region_data(rgz);
+    return -1;
 }
 
 /*
@@ -1443,7 +1723,7 @@ static void rgz_print_layer(hwc_layer_1_t *l, int idx, int csv)
     e -= snprintf(end - e, e, "%s %1.3f", csv ? "," : " scalew:", getscalew(l));
     e -= snprintf(end - e, e, "%s %1.3f", csv ? "," : " scaleh:", getscaleh(l));
 
-    e -= snprintf(end - e, e, "%s %d", csv ? "," : " visrect:",
+    e -= snprintf(end - e, e, "%s %zu", csv ? "," : " visrect:",
         l->visibleRegionScreen.numRects);
 
     if (!csv) {
@@ -1453,7 +1733,7 @@ static void rgz_print_layer(hwc_layer_1_t *l, int idx, int csv)
         size_t i = 0;
         for (; i < l->visibleRegionScreen.numRects; i++) {
             hwc_rect_t const *r = &l->visibleRegionScreen.rects[i];
-            OUTP("<!-- LAYER-VIS: %d: rect: %d %d %d %d -->",
+            OUTP("<!-- LAYER-VIS: %zu: rect: %d %d %d %d -->",
                     i, r->left, r->top, r->right, r->bottom);
         }
     } else {
@@ -1499,7 +1779,24 @@ static int hal_to_ocd(int color)
     }
 }
 
-static BVFN_BLT bv_blt;
+int rgz_get_buffergeometry(buffer_handle_t handle, struct bvsurfgeom *geom)
+{
+    IMG_native_handle_t *h = (IMG_native_handle_t *)handle;
+
+    /* Only formats reachable through a single CPU mapping can be targets */
+    if (!h || is_NV12(h->iFormat) || hal_to_ocd(h->iFormat) == OCDFMT_UNKNOWN ||
+            h->iFormat == HAL_PIXEL_FORMAT_YV12)
+        return -EINVAL;
+
+    bzero(geom, sizeof(*geom));
+    geom->structsize = sizeof(*geom);
+    geom->width = h->iWidth;
+    geom->height = h->iHeight;
+    geom->virtstride = HANDLE_TO_STRIDE(h);
+    geom->format = hal_to_ocd(h->iFormat);
+    geom->orientation = 0;
+    return 0;
+}
 
 static int rgz_handle_to_stride(IMG_native_handle_t *h)
 {
@@ -1533,7 +1830,7 @@ static int rgz_get_flip_flags(unsigned int transform, int use_src2_flags)
     return flip_flags;
 }
 
-static int rgz_hwc_layer_blit(rgz_out_params_t *params, rgz_layer_t *rgz_layer)
+static int rgz_hwc_layer_blit(rgz_t *rgz, rgz_out_params_t *params, rgz_layer_t *rgz_layer)
 {
     hwc_layer_1_t* layer = &rgz_layer->hwc_layer;
     blit_rect_t srcregion;
@@ -1541,9 +1838,9 @@ static int rgz_hwc_layer_blit(rgz_out_params_t *params, rgz_layer_t *rgz_layer)
 
     int noblend = rgz_is_blending_disabled(params);
     if (!noblend && layer->blending == HWC_BLENDING_PREMULT)
-        rgz_hwc_subregion_blend(params, &srcregion, rgz_layer, NULL);
+        rgz_hwc_subregion_blend(rgz, params, &srcregion, rgz_layer, NULL);
     else
-        rgz_hwc_subregion_copy(params, &srcregion, rgz_layer);
+        rgz_hwc_subregion_copy(rgz, params, &srcregion, rgz_layer);
 
     return 0;
 }
@@ -1570,52 +1867,52 @@ static void rgz_batch_entry(struct rgz_blt_entry* e, unsigned int flag, unsigned
     e->bp.batchflags |= set;
 }
 
-static int rgz_hwc_subregion_blit(blit_hregion_t *hregion, int sidx, rgz_out_params_t *params,
+static int rgz_hwc_subregion_blit(rgz_t *rgz, blit_subregion_t *subregion, rgz_out_params_t *params,
     blit_rect_t *damaged_area)
 {
     int lix;
-    int ldepth = get_layer_ops(hregion, sidx, &lix);
+    int ldepth = get_layer_ops(subregion, &lix);
     if (ldepth == 0) {
         /* Impossible, there are no layers in this region even if the
          * background is covering the whole screen
          */
-        OUTE("hregion %p subregion %d doesn't have any ops", hregion, sidx);
+        OUTE("subregion %p doesn't have any ops", subregion);
         return -1;
     }
 
     /* Determine if this region is dirty */
     int dirty = 0;
-    blit_rect_t *subregion_rect = &hregion->blitrects[lix][sidx];
+    blit_rect_t *subregion_rect = &subregion->rect;
     if (RECT_INTERSECTS(*damaged_area, *subregion_rect)) {
         /* The subregion intersects the damaged area, draw unconditionally */
         dirty = 1;
     } else {
         int dirtylix = lix;
         while (dirtylix != -1) {
-            rgz_layer_t *rgz_layer = hregion->rgz_layers[dirtylix];
+            rgz_layer_t *rgz_layer = subregion->rgz_layers[dirtylix];
             if (rgz_layer->dirty_count){
                 /* One of the layers is dirty, we need to generate blits for this subregion */
                 dirty = 1;
                 break;
             }
-            dirtylix = get_layer_ops_next(hregion, sidx, dirtylix);
+            dirtylix = get_layer_ops_next(subregion, dirtylix);
         }
     }
     if (!dirty)
         return 0;
 
     /* Check if the bottom layer is the background */
-    if (hregion->rgz_layers[lix]->buffidx == RGZ_BACKGROUND_BUFFIDX) {
+    if (subregion->rgz_layers[lix]->buffidx == RGZ_BACKGROUND_BUFFIDX) {
         if (ldepth == 1) {
             /* Background layer is the only operation, clear subregion */
-            rgz_out_clrdst(params, &hregion->blitrects[lix][sidx]);
+            rgz_out_clrdst(rgz, params, &subregion->rect);
             return 0;
         } else {
             /* No need to generate blits with background layer if there is
              * another layer on top of it, discard it
              */
             ldepth--;
-            lix = get_layer_ops_next(hregion, sidx, lix);
+            lix = get_layer_ops_next(subregion, lix);
         }
     }
 
@@ -1623,23 +1920,23 @@ static int rgz_hwc_subregion_blit(blit_hregion_t *hregion, int sidx, rgz_out_par
      * See if the depth most layer needs to be ignored. If this layer is the
      * only operation, we need to clear this subregion.
      */
-    if (hregion->rgz_layers[lix]->buffidx == RGZ_CLEARHINT_BUFFIDX) {
+    if (subregion->rgz_layers[lix]->buffidx == RGZ_CLEARHINT_BUFFIDX) {
         ldepth--;
         if (!ldepth) {
-            rgz_out_clrdst(params, &hregion->blitrects[lix][sidx]);
+            rgz_out_clrdst(rgz, params, &subregion->rect);
             return 0;
         }
-        lix = get_layer_ops_next(hregion, sidx, lix);
+        lix = get_layer_ops_next(subregion, lix);
     }
 
     int noblend = rgz_is_blending_disabled(params);
 
     if (!noblend && ldepth > 1) { /* BLEND */
-        blit_rect_t *rect = &hregion->blitrects[lix][sidx];
+        blit_rect_t *rect = &subregion->rect;
         struct rgz_blt_entry* e;
 
         int s2lix = lix;
-        lix = get_layer_ops_next(hregion, sidx, lix);
+        lix = get_layer_ops_next(subregion, lix);
 
         /*
          * We save a read and a write from the FB if we blend the bottom
@@ -1648,15 +1945,15 @@ static int rgz_hwc_subregion_blit(blit_hregion_t *hregion, int sidx, rgz_out_par
         int prev_layer_scaled = 0;
         int prev_layer_nv12 = 0;
         int first_batchflags = 0;
-        rgz_layer_t *rgz_src1 = hregion->rgz_layers[lix];
-        rgz_layer_t *rgz_src2 = hregion->rgz_layers[s2lix];
+        rgz_layer_t *rgz_src1 = subregion->rgz_layers[lix];
+        rgz_layer_t *rgz_src2 = subregion->rgz_layers[s2lix];
         if (rgz_can_blend_together(&rgz_src1->hwc_layer, &rgz_src2->hwc_layer))
-            e = rgz_hwc_subregion_blend(params, rect, rgz_src1, rgz_src2);
+            e = rgz_hwc_subregion_blend(rgz, params, rect, rgz_src1, rgz_src2);
         else {
             /* Return index to the first operation and make a copy of the first layer */
             lix = s2lix;
-            rgz_src1 = hregion->rgz_layers[lix];
-            e = rgz_hwc_subregion_copy(params, rect, rgz_src1);
+            rgz_src1 = subregion->rgz_layers[lix];
+            e = rgz_hwc_subregion_copy(rgz, params, rect, rgz_src1);
             /*
              * First blit is a copy, the rest will be blends, hence the operation
              * changed on the second blit.
@@ -1675,13 +1972,13 @@ static int rgz_hwc_subregion_blit(blit_hregion_t *hregion, int sidx, rgz_out_par
         rgz_batch_entry(e, BVFLAG_BATCH_BEGIN, 0);
 
         /* Rest of layers blended with FB */
-        while((lix = get_layer_ops_next(hregion, sidx, lix)) != -1) {
+        while((lix = get_layer_ops_next(subregion, lix)) != -1) {
             int batchflags = first_batchflags;
             first_batchflags = 0;
-            rgz_src1 = hregion->rgz_layers[lix];
+            rgz_src1 = subregion->rgz_layers[lix];
 
             /* Blend src1 into dst */
-            e = rgz_hwc_subregion_blend(params, rect, rgz_src1, NULL);
+            e = rgz_hwc_subregion_blend(rgz, params, rect, rgz_src1, NULL);
 
             /*
              * NOTE: After the first blit is configured, consequent blits are
@@ -1729,10 +2026,10 @@ static int rgz_hwc_subregion_blit(blit_hregion_t *hregion, int sidx, rgz_out_par
             rgz_batch_entry(e, BVFLAG_BATCH_END, 0);
 
     } else { /* COPY */
-        blit_rect_t *rect = &hregion->blitrects[lix][sidx];
+        blit_rect_t *rect = &subregion->rect;
         if (noblend)    /* get_layer_ops() doesn't understand this so get the top */
-            lix = get_top_rect(hregion, sidx, &rect);
-        rgz_hwc_subregion_copy(params, rect, hregion->rgz_layers[lix]);
+            lix = get_top_rect(subregion, &rect);
+        rgz_hwc_subregion_copy(rgz, params, rect, subregion->rgz_layers[lix]);
     }
     return 0;
 }
@@ -1747,40 +2044,200 @@ struct bvsurfgeom gscrngeom = {
 
 static void rgz_blts_init(struct rgz_blts *blts)
 {
-    bzero(blts, sizeof(*blts));
+    blts->idx = 0;
+    blts->error = 0;
 }
 
 static void rgz_blts_free(struct rgz_blts *blts)
 {
-    /* TODO ??? maybe we should dynamically allocate this */
+    /* Keep the entries around for the next frame */
     rgz_blts_init(blts);
 }
 
+/* Make room for at least size entries in the blit list */
+static int rgz_blts_reserve(struct rgz_blts *blts, int size)
+{
+    int new_size = blts->size ? blts->size : RGZ_BLTS_MINSIZE;
+    if (size <= blts->size)
+        return 0;
+    while (new_size < size)
+        new_size <<= 1;
+
+    struct rgz_blt_entry *bvcmds = realloc(blts->bvcmds, new_size * sizeof(*bvcmds));
+    if (!bvcmds) {
+        OUTE("Unable to allocate %d blit entries", new_size);
+        return -1;
+    }
+    blts->bvcmds = bvcmds;
+    blts->size = new_size;
+    return 0;
+}
+
 static struct rgz_blt_entry* rgz_blts_get(struct rgz_blts *blts, rgz_out_params_t *params)
 {
     struct rgz_blt_entry *ne;
-    if (blts->idx < RGZ_MAX_BLITS) {
+
+    if (blts->idx == blts->size && rgz_blts_reserve(blts, blts->idx + 1)) {
+        /*
+         * Hand out a scratch entry so the caller can carry on, the error is
+         * reported when the blit list is completed
+         */
+        blts->error = 1;
+        ne = &blts->scratch;
+    } else {
         ne = &blts->bvcmds[blts->idx++];
         if (IS_BVCMD(params))
             params->data.bvc.out_blits++;
-    } else {
-        OUTE("!!! BIG PROBLEM !!! run out of blit entries");
-        ne = &blts->bvcmds[blts->idx - 1]; /* Return last slot */
     }
+    bzero(ne, sizeof(*ne));
     return ne;
 }
 
-static int rgz_blts_bvdirect(rgz_t *rgz __unused, struct rgz_blts *blts, rgz_out_params_t *params __unused)
+/* Transparent pixel used as the source of clear blits */
+static uint32_t rgz_clear_pixel;
+
+/*
+ * Replace a buffer placeholder, which omaplfb resolves in the kernel, with the
+ * CPU visible buffer
+ */
+static int rgz_bvdirect_resolve(rgz_t *rgz, struct bvbuffdesc *desc, rgz_out_params_t *params)
+{
+    struct rgz_out_bvdirect *bv = &params->data.bv;
+    rgz_fb_state_t *cur_fb_state = &rgz->cur_fb_state;
+    int buffidx = (intptr_t)desc->auxptr;
+    int i;
+
+    if (desc->auxptr == (void*)-1) {
+        desc->virtaddr = &rgz_clear_pixel;
+        desc->length = sizeof(rgz_clear_pixel);
+    } else if ((unsigned long)desc->auxptr & HWC_BLT_DESC_FLAG) {
+        /* Only the framebuffer can be referenced this way */
+        *desc = *bv->dstdesc;
+        return 0;
+    } else {
+        for (i = 0; i < cur_fb_state->rgz_layerno; i++) {
+            if (cur_fb_state->rgz_layers[i].buffidx == buffidx)
+                break;
+        }
+        if (i == cur_fb_state->rgz_layerno || !bv->get_buffdesc ||
+                bv->get_buffdesc(bv->data, cur_fb_state->rgz_layers[i].hwc_layer.handle, desc)) {
+            OUTE("Unable to get the buffer of layer buffidx %d", buffidx);
+            return -1;
+        }
+    }
+    desc->auxptr = NULL;
+    return 0;
+}
+
+/* Clears still hold the placeholder of the clear pixel, see rgz_out_clrdst */
+static int rgz_is_clear(struct rgz_blt_entry *e)
+{
+    return e->src1desc.auxptr == (void*)-1 && !(e->bp.flags & BVFLAG_BATCH_MASK);
+}
+
+static int rgz_fill_reserve(struct rgz_fill_rects *f, int size)
+{
+    if (size <= f->size)
+        return 0;
+
+    struct bvrect *rects = realloc(f->rects, size * sizeof(*rects));
+    if (!rects) {
+        OUTE("Unable to allocate %d fill rectangles", size);
+        return -1;
+    }
+    f->rects = rects;
+    f->size = size;
+    return 0;
+}
+
+/*
+ * Clear the gathered rectangles with a single fill, e is the first clear and
+ * stands for all of them
+ */
+static int rgz_bvdirect_fill(rgz_t *rgz, struct rgz_blt_entry *e, int count, rgz_out_params_t *params)
+{
+    struct rgz_out_bvdirect *bv = &params->data.bv;
+    int i, rv;
+
+    e->bp.dstdesc = bv->dstdesc;
+    e->bp.dstgeom = &e->dstgeom;
+    e->bp.src1.desc = &e->src1desc;
+    e->bp.src1geom = &e->src1geom;
+    if (rgz_bvdirect_resolve(rgz, &e->src1desc, params))
+        return -1;
+
+    /*
+     * The clip rectangle only covers the first clear, the clears are inside
+     * the screen already
+     */
+    e->bp.flags &= ~BVFLAG_CLIP;
+    rv = bv->bv_fill(&e->bp, count, rgz->fills.rects);
+    if (rv) {
+        OUTE("BV_FILL of %d rects failed: %d", count, rv);
+        BVDUMP("bv_fill:", "  ", &e->bp);
+        return -1;
+    }
+    bv->out_blits++;
+    for (i = 0; i < count; i++)
+        bv->out_pixels += rgz->fills.rects[i].width * rgz->fills.rects[i].height;
+    return 0;
+}
+
+static int rgz_blts_bvdirect(rgz_t *rgz, struct rgz_blts *blts, rgz_out_params_t *params)
 {
+    struct rgz_out_bvdirect *bv = &params->data.bv;
     struct bvbatch *batch = NULL;
-    int rv = -1;
+    struct rgz_blt_entry *fill = NULL;
+    int nfill = 0;
+    int rv = 0;
     int idx = 0;
 
+    bv->out_blits = 0;
+    bv->out_pixels = 0;
+    if (!bv->bv_blt) {
+        OUTE("No BLTsville implementation to execute the blits");
+        return -1;
+    }
+    if (bv->bv_fill && rgz_fill_reserve(&rgz->fills, blts->idx))
+        return -1;
+
     while (idx < blts->idx) {
         struct rgz_blt_entry *e = &blts->bvcmds[idx];
+
+        if (bv->bv_fill && rgz_is_clear(e)) {
+            if (!nfill)
+                fill = e;
+            rgz->fills.rects[nfill++] = e->bp.dstrect;
+            idx++;
+            continue;
+        }
+        /*
+         * Subregions never overlap, but in paint mode the layers blitted next
+         * may cover the clears, which have to be done first
+         */
+        if (nfill && params->op != RGZ_OUT_BVDIRECT_REGION) {
+            if (rgz_bvdirect_fill(rgz, fill, nfill, params))
+                return -1;
+            nfill = 0;
+        }
+
+        /* The entries only hold the descriptors, point the parameters at them */
+        e->bp.dstdesc = bv->dstdesc;
+        e->bp.dstgeom = &e->dstgeom;
+        e->bp.src1.desc = &e->src1desc;
+        e->bp.src1geom = &e->src1geom;
+        if (rgz_bvdirect_resolve(rgz, &e->src1desc, params))
+            return -1;
+        if (e->src2desc.structsize) {
+            e->bp.src2.desc = &e->src2desc;
+            e->bp.src2geom = &e->src2geom;
+            if (rgz_bvdirect_resolve(rgz, &e->src2desc, params))
+                return -1;
+        }
+
         if (e->bp.flags & BVFLAG_BATCH_MASK)
             e->bp.batch = batch;
-        rv = bv_blt(&e->bp);
+        rv = bv->bv_blt(&e->bp);
         if (rv) {
             OUTE("BV_BLT failed: %d", rv);
             BVDUMP("bv_blt:", "  ", &e->bp);
@@ -1788,11 +2245,113 @@ static int rgz_blts_bvdirect(rgz_t *rgz __unused, struct rgz_blts *blts, rgz_out
         }
         if (e->bp.flags & BVFLAG_BATCH_BEGIN)
             batch = e->bp.batch;
+        bv->out_blits++;
+        bv->out_pixels += e->bp.cliprect.width * e->bp.cliprect.height;
         idx++;
     }
+    if (nfill && rgz_bvdirect_fill(rgz, fill, nfill, params))
+        return -1;
     return rv;
 }
 
+static int rgz_same_layers(blit_subregion_t *a, blit_subregion_t *b)
+{
+    return a->nlayers == b->nlayers &&
+        !memcmp(a->rgz_layers, b->rgz_layers, a->nlayers * sizeof(*a->rgz_layers));
+}
+
+static int rgz_coalesced_reserve(struct rgz_coalesced_rects *c, int size)
+{
+    if (size <= c->size)
+        return 0;
+
+    rgz_coalesced_t *rects = realloc(c->rects, size * sizeof(*rects));
+    if (rects)
+        c->rects = rects;
+    int *open = realloc(c->open, 2 * size * sizeof(*open));
+    if (open)
+        c->open = open;
+    if (!rects || !open) {
+        OUTE("Unable to allocate %d coalesced subregions", size);
+        return -1;
+    }
+    c->size = size;
+    return 0;
+}
+
+/*
+ * Merge the subregions into as few rectangles as possible without changing
+ * the blits generated for each pixel. Subregions next to each other in a
+ * hregion are merged first when they have the same layers, then the
+ * resulting rectangles are extended down into the next hregion when it has a
+ * rectangle with the same horizontal extent and layers. The source rectangles
+ * of unscaled layers follow the destination, and scaled layers are always
+ * blitted whole and clipped, so a merged blit reads the same source pixels.
+ *
+ * Returns the number of rectangles, -1 on failure
+ */
+static int rgz_coalesce_subregions(rgz_t *rgz)
+{
+    int i, s, nsubregions = 0;
+    for (i = 0; i < rgz->nhregions; i++)
+        nsubregions += rgz->hregions[i].nsubregions;
+    if (rgz_coalesced_reserve(&rgz->coalesced, nsubregions))
+        return -1;
+
+    rgz_coalesced_t *rects = rgz->coalesced.rects;
+    int *open = rgz->coalesced.open, *next_open = rgz->coalesced.open + rgz->coalesced.size;
+    int n = 0, nopen = 0;
+
+    for (i = 0; i < rgz->nhregions; i++) {
+        blit_hregion_t *hregion = &rgz->hregions[i];
+        int row = n;
+
+        for (s = 0; s < hregion->nsubregions; s++) {
+            blit_subregion_t *subregion = &hregion->subregions[s];
+            int damaged = RECT_INTERSECTS(rgz->damaged_area, subregion->rect);
+            rgz_coalesced_t *last = n > row ? &rects[n - 1] : NULL;
+            if (last && last->damaged == damaged &&
+                    last->subregion.rect.right == subregion->rect.left &&
+                    rgz_same_layers(&last->subregion, subregion)) {
+                last->subregion.rect.right = subregion->rect.right;
+                last->nmerged++;
+            } else {
+                rects[n].subregion = *subregion;
+                rects[n].nmerged = 1;
+                rects[n++].damaged = damaged;
+            }
+        }
+
+        /* Both the open rects and this hregion rects are sorted left to right */
+        int r, w = row, o = 0, nnext = 0;
+        for (r = row; r < n; r++) {
+            rgz_coalesced_t *run = &rects[r];
+            while (o < nopen && rects[open[o]].subregion.rect.left < run->subregion.rect.left)
+                o++;
+            rgz_coalesced_t *above = o < nopen ? &rects[open[o]] : NULL;
+            if (above && above->subregion.rect.left == run->subregion.rect.left &&
+                    above->subregion.rect.right == run->subregion.rect.right &&
+                    above->subregion.rect.bottom == run->subregion.rect.top &&
+                    above->damaged == run->damaged &&
+                    rgz_same_layers(&above->subregion, &run->subregion)) {
+                above->subregion.rect.bottom = run->subregion.rect.bottom;
+                above->nmerged += run->nmerged;
+                next_open[nnext++] = open[o];
+            } else {
+                rects[w] = *run;
+                next_open[nnext++] = w++;
+            }
+        }
+        n = w;
+
+        int *tmp = open;
+        open = next_open;
+        next_open = tmp;
+        nopen = nnext;
+    }
+    return n;
+}
+
 static int rgz_out_region(rgz_t *rgz, rgz_out_params_t *params)
 {
     if (!(rgz->state & RGZ_REGION_DATA)) {
@@ -1800,16 +2359,19 @@ static int rgz_out_region(rgz_t *rgz, rgz_out_params_t *params)
         return -1;
     }
 
-    rgz_blts_init(&blts);
+    rgz_blts_init(&rgz->blts);
     ALOGD_IF(debug, "rgz_out_region:");
 
     if (IS_BVCMD(params))
         params->data.bvc.out_blits = 0;
 
+    /* Every layer of every subregion may need a blit */
+    if (rgz_blts_reserve(&rgz->blts, rgz->nops))
+        return -1;
+
     int i;
     for (i = 0; i < rgz->nhregions; i++) {
         blit_hregion_t *hregion = &rgz->hregions[i];
-        int s;
         ALOGD_IF(debug, "h[%d] nsubregions = %d", i, hregion->nsubregions);
         if (hregion->nlayers == 0) {
             /* Impossible, there are no layers in this region even if the
@@ -1818,18 +2380,38 @@ static int rgz_out_region(rgz_t *rgz, rgz_out_params_t *params)
             OUTE("hregion %p doesn't have any ops", hregion);
             return -1;
         }
-        for (s = 0; s < hregion->nsubregions; s++) {
-            ALOGD_IF(debug, "h[%d] -> [%d]", i, s);
-            if (rgz_hwc_subregion_blit(hregion, s, params, &rgz->damaged_area))
-                return -1;
-        }
     }
 
+    int nrects = rgz_coalesce_subregions(rgz);
+    if (nrects < 0)
+        return -1;
+
+    /* Every merged subregion would have needed the same blits */
+    int saved_blits = 0;
+    for (i = 0; i < nrects; i++) {
+        rgz_coalesced_t *rect = &rgz->coalesced.rects[i];
+        int idx = rgz->blts.idx;
+        ALOGD_IF(debug, "rect[%d] l %d t %d r %d b %d merged %d", i,
+            rect->subregion.rect.left, rect->subregion.rect.top,
+            rect->subregion.rect.right, rect->subregion.rect.bottom, rect->nmerged);
+        if (rgz_hwc_subregion_blit(rgz, &rect->subregion, params, &rgz->damaged_area))
+            return -1;
+        saved_blits += (rgz->blts.idx - idx) * (rect->nmerged - 1);
+    }
+    if (IS_BVCMD(params))
+        params->data.bvc.out_saved_blits = saved_blits;
+    else
+        params->data.bv.out_saved_blits = saved_blits;
+
+    if (rgz->blts.error)
+        return -1;
+
     int rv = 0;
 
     if (IS_BVCMD(params)) {
         int j;
         params->data.bvc.out_nhndls = 0;
+        params->data.bvc.out_hndls = rgz->hndls;
         rgz_fb_state_t *cur_fb_state = &rgz->cur_fb_state;
         /* Begin from index 1 to remove the background layer from the output */
         for (j = 1, i = 0; j < cur_fb_state->rgz_layerno; j++) {
@@ -1837,26 +2419,24 @@ static int rgz_out_region(rgz_t *rgz, rgz_out_params_t *params)
             /* We don't need the handles for layers marked as -1 */
             if (rgz_layer->buffidx == -1)
                 continue;
-            params->data.bvc.out_hndls[i++] = rgz_layer->hwc_layer.handle;
+            rgz->hndls[i++] = rgz_layer->hwc_layer.handle;
             params->data.bvc.out_nhndls++;
         }
 
-        if (blts.idx > 0) {
+        if (rgz->blts.idx > 0) {
             /* Last blit is made sync to act like a fence for the previous async blits */
-            struct rgz_blt_entry* e = &blts.bvcmds[blts.idx-1];
+            struct rgz_blt_entry* e = &rgz->blts.bvcmds[rgz->blts.idx-1];
             rgz_set_async(e, 0);
         }
 
         /* FIXME: we want to be able to call rgz_blts_free and populate the actual
          * composition data structure ourselves */
-        params->data.bvc.cmdp = blts.bvcmds;
-        params->data.bvc.cmdlen = blts.idx;
-        if (params->data.bvc.out_blits >= RGZ_MAX_BLITS)
-            rv = -1;
-        //rgz_blts_free(&blts);
+        params->data.bvc.cmdp = rgz->blts.bvcmds;
+        params->data.bvc.cmdlen = rgz->blts.idx;
+        //rgz_blts_free(&rgz->blts);
     } else {
-        rv = rgz_blts_bvdirect(rgz, &blts, params);
-        rgz_blts_free(&blts);
+        rv = rgz_blts_bvdirect(rgz, &rgz->blts, params);
+        rgz_blts_free(&rgz->blts);
     }
 
     return rv;
@@ -1886,7 +2466,7 @@ void rgz_profile_hwc(hwc_display_contents_1_t* list, int dispw, int disph)
     property_get("debug.2dhwc.dumplayers", dumplayerdata, "0");
     int dumplayers = atoi(dumplayerdata);
     if (dumplayers && (list->flags & HWC_GEOMETRY_CHANGED)) {
-        OUTP("<!-- BEGUN-LAYER-DUMP: %d -->", list->numHwLayers);
+        OUTP("<!-- BEGUN-LAYER-DUMP: %zu -->", list->numHwLayers);
         rgz_print_layers(list, dumplayers == 1 ? 0 : 1);
         OUTP("<!-- ENDED-LAYER-DUMP -->");
     }
@@ -1895,6 +2475,7 @@ void rgz_profile_hwc(hwc_display_contents_1_t* list, int dispw, int disph)
         return;
 
     rgz_t rgz;
+    bzero(&rgz, sizeof(rgz));
     rgz_in_params_t ip = { .data = { .hwc = {
                            .layers = list->hwLayers,
                            .layerno = list->numHwLayers } } };
@@ -1937,11 +2518,6 @@ int rgz_get_screengeometry(int fd, struct bvsurfgeom *geom, int fmt)
         return -EINVAL;
     }
 
-    bzero(&bg_layer, sizeof(bg_layer));
-    bg_layer.displayFrame.left = bg_layer.displayFrame.top = 0;
-    bg_layer.displayFrame.right = fb_varinfo.xres;
-    bg_layer.displayFrame.bottom = fb_varinfo.yres;
-
     bzero(geom, sizeof(*geom));
     geom->structsize = sizeof(*geom);
     geom->width = fb_varinfo.xres;
@@ -1962,7 +2538,7 @@ int rgz_in(rgz_in_params_t *p, rgz_t *rgz)
             rv = rgz_in_hwc(p, rgz) ? 0 : RGZ_ALL;
         break;
     case RGZ_IN_HWCCHK:
-        bzero(rgz, sizeof(rgz_t));
+        rgz_reset(rgz);
         rv = rgz_in_hwccheck(p, rgz);
         break;
     default:
@@ -1973,10 +2549,19 @@ int rgz_in(rgz_in_params_t *p, rgz_t *rgz)
 
 void rgz_release(rgz_t *rgz)
 {
+    int i;
     if (!rgz)
         return;
-    if (rgz->hregions)
-        free(rgz->hregions);
+    rgz_arena_free(&rgz->arena);
+    free(rgz->cur_fb_state.rgz_layers);
+    for (i = 0; i < RGZ_NUM_FB; i++)
+        free(rgz->fb_states[i].rgz_layers);
+    free(rgz->geometry.frames);
+    free(rgz->hndls);
+    free(rgz->blts.bvcmds);
+    free(rgz->coalesced.rects);
+    free(rgz->coalesced.open);
+    free(rgz->fills.rects);
     bzero(rgz, sizeof(*rgz));
 }
 
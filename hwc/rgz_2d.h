@@ -17,19 +17,7 @@
 #define __RGZ_2D__
 
 #include <linux/bltsville.h>
-
-/*
- * Maximum number of layers used to generate subregion rectangles in a
- * horizontal region.
- */
-#define RGZ_MAXLAYERS 13
-
-/*
- * Maximum number of layers the regionizer will accept as input. Account for an
- * additional 'background layer' to generate empty subregion rectangles and
- * a damage region as well.
- */
-#define RGZ_INPUT_MAXLAYERS (RGZ_MAXLAYERS - 2)
+#include "gcbvext.h"
 
 /* Number of framebuffers to track */
 #define RGZ_NUM_FB 2
@@ -37,7 +25,8 @@
 /*
  * Regionizer data
  *
- * This is an oqaque structure passed in by the client
+ * This is an oqaque structure passed in by the client, it must be zero
+ * initialized before its first use
  */
 struct rgz;
 typedef struct rgz rgz_t;
@@ -48,11 +37,17 @@ typedef struct rgz rgz_t;
  */
 int rgz_get_screengeometry(int fd, struct bvsurfgeom *geom, int fmt);
 
+/*
+ * Get the geometry of a gralloc buffer used as the destination, fails for
+ * formats the regionizer can't write to
+ */
+int rgz_get_buffergeometry(buffer_handle_t handle, struct bvsurfgeom *geom);
+
 /*
  * Regionizer input parameters
  */
 struct rgz_in_hwc {
-    int flags;
+    int flags; /* See RGZ_IN_HWC_* */
     int layerno;
     hwc_layer_1_t *layers;
 #ifdef OMAP_ENHANCEMENT_HWC_EXTENDED_API
@@ -68,12 +63,6 @@ typedef struct rgz_in_params {
     } data;
 } rgz_in_params_t;
 
-#ifdef OMAP_ENHANCEMENT_HWC_EXTENDED_API
-typedef struct rgz_ext_layer_list {
-    hwc_layer_extended_t layers[RGZ_INPUT_MAXLAYERS];
-} rgz_ext_layer_list_t;
-#endif
-
 /*
  * Validate whether the HWC layers can be rendered
  *
@@ -106,8 +95,20 @@ typedef struct rgz_ext_layer_list {
  */
 #define RGZ_IN_HWC 2
 
+/*
+ * data.hwc.flags, RGZ_IN_HWC only
+ *
+ * RGZ_IN_HWC_REDRAW  The destination doesn't hold the frame composed
+ *                    RGZ_NUM_FB frames ago, draw every subregion. Damage
+ *                    tracking carries on from this frame.
+ */
+#define RGZ_IN_HWC_REDRAW 1
+
 int rgz_in(rgz_in_params_t *param, rgz_t *rgz);
 
+/* Whether a HWC layer can be blitted, RGZ_IN_* fail if any candidate can't */
+int rgz_in_valid_hwc_layer(hwc_layer_1_t *layer);
+
 /* This means all layers can be blitted */
 #define RGZ_ALL 1
 
@@ -124,9 +125,10 @@ struct rgz_out_bvcmd {
     int cmdlen;
     struct bvsurfgeom *dstgeom;
     int noblend;
-    buffer_handle_t out_hndls[RGZ_INPUT_MAXLAYERS]; /* OUTPUT */
+    buffer_handle_t *out_hndls; /* OUTPUT, owned by the regionizer */
     int out_nhndls; /* OUTPUT */
     int out_blits; /* OUTPUT */
+    int out_saved_blits; /* OUTPUT, blits avoided by merging subregions, region mode only */
 };
 
 struct rgz_out_svg {
@@ -140,6 +142,13 @@ struct rgz_out_bvdirect {
     struct bvbuffdesc *dstdesc;
     struct bvsurfgeom *dstgeom;
     int noblend;
+    BVFN_BLT bv_blt;
+    BVFN_GCFILL bv_fill; /* Optional */
+    int (*get_buffdesc)(void *data, buffer_handle_t handle, struct bvbuffdesc *desc);
+    void *data; /* Passed to get_buffdesc */
+    int out_blits; /* OUTPUT */
+    int out_pixels; /* OUTPUT */
+    int out_saved_blits; /* OUTPUT, blits avoided by merging subregions, region mode only */
 };
 
 typedef struct rgz_out_params {
@@ -181,7 +190,8 @@ typedef struct rgz_out_params {
  * data.bvc.cmdlen      length of cmdp
  * data.bvc.dstgeom     bltsville struct describing the destination geometry
  * data.bvc.noblend     Test option to disable blending
- * data.bvc.out_hndls   Array of buffer handles (OUTPUT)
+ * data.bvc.out_hndls   Array of buffer handles (OUTPUT), valid until the
+ *                      next regionizer call
  * data.bvc.out_nhndls  Number of buffer handles (OUTPUT)
  * data.bvc.out_blits   Number of blits (OUTPUT)
  */
@@ -204,13 +214,25 @@ typedef struct rgz_out_params {
  * op                  RGZ_OUT_BVDIRECT_PAINT
  * data.bv.dstdesc     bltsville struct describing the destination buffer
  * data.bv.dstgeom     bltsville struct describing the destination geometry
- * data.bv.list        List of HWC layers to blit, only HWC_OVERLAY layers
- *                     will be rendered
  * data.bv.noblend     Test option to disable blending
+ * data.bv.bv_blt      BLTsville implementation executing the blits, e.g. the
+ *                     CPU one
+ * data.bv.bv_fill     gcbvfill of the same implementation or NULL, clears
+ *                     following each other are then done in a single call
+ * data.bv.get_buffdesc
+ *                     Fills in the CPU visible buffer of a layer handle,
+ *                     returns 0 on success
+ * data.bv.data        Passed to get_buffdesc
+ * data.bv.out_blits   Number of bv_blt and bv_fill calls (OUTPUT)
+ * data.bv.out_pixels  Number of destination pixels written (OUTPUT)
  */
 #define RGZ_OUT_BVDIRECT_PAINT 3
 /*
- * Perform actual blits where each blit is a subregion - this is a test mode
+ * Perform actual blits where each blit is a subregion - this is a test mode.
+ * Only the damaged and dirty subregions are written, the destination must hold
+ * the frame rendered RGZ_NUM_FB compositions ago.
+ *
+ * See RGZ_OUT_BVDIRECT_PAINT
  */
 #define RGZ_OUT_BVDIRECT_REGION 5
 
@@ -271,9 +293,6 @@ typedef struct blit_rect {
  * the diagram above H4 has 2 sub-regions, layer 0 intersects with the first
  * region and layers 0 and 2 intersect with the second region.
  */
-#define RGZ_SUBREGIONMAX ((RGZ_MAXLAYERS << 1) - 1)
-#define RGZ_MAX_BLITS (RGZ_SUBREGIONMAX * RGZ_SUBREGIONMAX)
-
 typedef struct rgz_layer {
     hwc_layer_1_t hwc_layer;
     uint32_t identity;
@@ -283,28 +302,112 @@ typedef struct rgz_layer {
 
 typedef struct rgz_fb_state {
     int rgz_layerno;
-    rgz_layer_t rgz_layers[RGZ_MAXLAYERS];
+    int size; /* Number of layers rgz_layers has room for */
+    rgz_layer_t *rgz_layers;
 } rgz_fb_state_t;
 
+/*
+ * A subregion is a rectangle of a hregion covered by the same set of layers,
+ * the layers are stored in z-order, bottom most first.
+ */
+typedef struct blit_subregion {
+    blit_rect_t rect;
+    int nlayers;
+    rgz_layer_t **rgz_layers;
+} blit_subregion_t;
+
 typedef struct blit_hregion {
     blit_rect_t rect;
-    rgz_layer_t *rgz_layers[RGZ_MAXLAYERS];
+    rgz_layer_t **rgz_layers;
     int nlayers;
     int nsubregions;
-    blit_rect_t blitrects[RGZ_MAXLAYERS][RGZ_SUBREGIONMAX]; /* z-order | rectangle */
+    blit_subregion_t *subregions;
 } blit_hregion_t;
 
+/*
+ * Region data is rebuilt from scratch on every geometry change, it is carved
+ * out of an arena which is reset instead of freed. When a chunk runs out a
+ * bigger one is chained, the next reset merges them so a steady composition
+ * ends up in a single allocation.
+ */
+typedef struct rgz_arena_chunk {
+    struct rgz_arena_chunk *next;
+    size_t size;
+    size_t used;
+} rgz_arena_chunk_t;
+
+typedef struct rgz_arena {
+    rgz_arena_chunk_t *chunks; /* Chunk being filled first */
+} rgz_arena_t;
+
+/*
+ * Everything the hregions and their subregions are derived from. When it
+ * matches the previous composition the region data is reused as is. The
+ * hregions only point at the layers, so buffer handles, crops, transforms and
+ * blending are always taken from the current composition.
+ */
+typedef struct rgz_geometry {
+    int screen_width;
+    int screen_height;
+    blit_rect_t damaged_area;
+    int layerno;
+    hwc_rect_t *frames; /* Display frame of each layer, layerno entries */
+    int size;
+} rgz_geometry_t;
+
+struct rgz_blts {
+    struct rgz_blt_entry *bvcmds;
+    int idx;
+    int size;
+    int error; /* An entry could not be allocated, the blit list is incomplete */
+    struct rgz_blt_entry scratch; /* Handed out instead then */
+};
+
+/*
+ * Neighbouring subregions covered by the same layers, merged into a single
+ * rectangle which is blitted at once
+ */
+typedef struct rgz_coalesced {
+    blit_subregion_t subregion; /* Layers of the first subregion merged */
+    int nmerged; /* Number of subregions merged */
+    int damaged; /* The subregions intersect the damaged area */
+} rgz_coalesced_t;
+
+struct rgz_coalesced_rects {
+    rgz_coalesced_t *rects;
+    int *open; /* Rects ending at the bottom of the last two hregions */
+    int size;
+};
+
+/* Clears gathered for a single fill */
+struct rgz_fill_rects {
+    struct bvrect *rects;
+    int size;
+};
+
 enum { RGZ_STATE_INIT = 1, RGZ_REGION_DATA = 2} ;
 
 struct rgz {
     /* All fields here are opaque to the caller */
+    rgz_arena_t arena; /* Storage for hregions and subregions */
     blit_hregion_t *hregions;
     int nhregions;
+    int nops; /* Upper bound of blits needed to render the region data */
     int state;
     rgz_fb_state_t cur_fb_state;
     int fb_state_idx; /* Target framebuffer index. Points to the fb where the blits will be applied to */
     rgz_fb_state_t fb_states[RGZ_NUM_FB]; /* Storage for previous framebuffer geometry states */
     blit_rect_t damaged_area; /* Area of the screen which will be redrawn unconditionally */
+    rgz_geometry_t geometry; /* Geometry the current region data was generated for */
+    int reused; /* The last RGZ_IN_HWC kept the region data of the previous composition */
+    buffer_handle_t *hndls; /* Storage for rgz_out_bvcmd.out_hndls */
+    /*
+     * Storage of rgz_out, kept from one frame to the next. Each regionizer
+     * has its own so they can be used from different threads.
+     */
+    struct rgz_blts blts; /* Also rgz_out_bvcmd.cmdp, until the next rgz_out */
+    struct rgz_coalesced_rects coalesced;
+    struct rgz_fill_rects fills;
 };
 
 #endif /* __RGZ_2D__ */
@@ -16,83 +16,120 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <sys/resource.h>
 #include <pthread.h>
 #include <time.h>
+#include <linux/types.h>
 
 #include <cutils/properties.h>
 #include <cutils/log.h>
 #include <utils/Timers.h>
 
 #include "hwc_dev.h"
+#include "sw_vsync.h"
+#include "hwc_stats.h"
+
+/* Jitter samples kept for hwc_dump */
+#define JITTER_SAMPLES 1024
 
 static pthread_t vsync_thread;
 static pthread_mutex_t vsync_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t vsync_cond;
 static bool vsync_loop_active = false;
 
-nsecs_t vsync_rate;
+/* protected by vsync_mutex */
+static nsecs_t vsync_rate;
+static nsecs_t vsync_reference;     /* last real vsync timestamp, 0 if none */
+static struct {
+    nsecs_t samples[JITTER_SAMPLES]; /* wakeup minus vsync timestamp */
+    uint32_t count;
+    uint32_t missed;
+} jitter;
 
-static struct timespec diff(struct timespec start, struct timespec end)
+static nsecs_t to_ns(struct timespec *tp)
 {
-    struct timespec temp;
-    if ((end.tv_nsec - start.tv_nsec) < 0) {
-        temp.tv_sec = end.tv_sec-start.tv_sec - 1;
-        temp.tv_nsec = 1000000000 + end.tv_nsec-start.tv_nsec;
-    } else {
-        temp.tv_sec = end.tv_sec - start.tv_sec;
-        temp.tv_nsec = end.tv_nsec - start.tv_nsec;
-    }
-    return temp;
+    return (nsecs_t)tp->tv_sec * 1000000000 + tp->tv_nsec;
 }
 
+/*
+ * The vsyncs are generated on an absolute timeline, so the scheduling latency
+ * of a wakeup doesn't delay the following ones. The reported timestamps are
+ * the ones of the timeline, the latency is kept as jitter.
+ */
 static void *vsync_loop(void *data)
 {
-    struct timespec tp, tp_next, tp_sleep;
-    nsecs_t now = 0, period = vsync_rate, next_vsync = 0, next_fake_vsync = 0, sleep = 0;
+    struct timespec tp;
+    nsecs_t now, period, reference, next_vsync = 0;
     omap_hwc_device_t *hwc_dev = (omap_hwc_device_t *)data;
-    tp_sleep.tv_sec = tp_sleep.tv_nsec = 0;
+    uint32_t missed;
+    bool resumed;
 
     setpriority(PRIO_PROCESS, 0, HAL_PRIORITY_URGENT_DISPLAY);
 
     for (;;) {
         pthread_mutex_lock(&vsync_mutex);
+        resumed = !vsync_loop_active;
         while (!vsync_loop_active) {
             pthread_cond_wait(&vsync_cond, &vsync_mutex);
         }
-        /* the vsync_rate should be re-read after
-        * user sets the vsync_rate by calling start_sw_vsync
-        * explicitly. This is guaranteed by re-reading it
-        * after the vsync_cond is signalled.
-        */
-        period = vsync_rate; /* re-read rate */
-
+        /* the rate is re-read every period, it changes from the next vsync */
+        period = vsync_rate;
+        reference = vsync_reference;
+        vsync_reference = 0;
         pthread_mutex_unlock(&vsync_mutex);
 
         clock_gettime(CLOCK_MONOTONIC, &tp);
-        now = (tp.tv_sec * 1000000000) + tp.tv_nsec;
-        next_vsync = next_fake_vsync;
-        sleep = next_vsync - now;
-        if (sleep < 0) {
-            /* we missed, find where the next vsync should be */
-            sleep = (period - ((now - next_vsync) % period));
-            next_vsync = now + sleep;
+        now = to_ns(&tp);
+        missed = 0;
+        if (!next_vsync) {
+            next_vsync = now + period;
+        } else if (next_vsync <= now) {
+            /* we missed, find where the next vsync should be on the timeline */
+            nsecs_t skipped = (now - next_vsync) / period + 1;
+            if (!resumed)
+                missed = skipped;
+            next_vsync += skipped * period;
+        }
+
+        /* move gradually towards the phase of real vsyncs */
+        if (reference) {
+            nsecs_t error = (next_vsync - reference) % period;
+            if (error < 0)
+                error += period;
+            if (error > period / 2)
+                error -= period;
+            next_vsync -= error / 4;
         }
-        next_fake_vsync = next_vsync + period;
-        tp_next.tv_sec = (next_vsync / 1000000000);
-        tp_next.tv_nsec = (next_vsync % 1000000000);
-        tp_sleep = diff(tp, tp_next);
 
-        nanosleep(&tp_sleep, NULL);
+        tp.tv_sec = next_vsync / 1000000000;
+        tp.tv_nsec = next_vsync % 1000000000;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tp, NULL) == EINTR)
+            ;
+
+        clock_gettime(CLOCK_MONOTONIC, &tp);
+        pthread_mutex_lock(&vsync_mutex);
+        jitter.samples[jitter.count++ % JITTER_SAMPLES] = to_ns(&tp) - next_vsync;
+        jitter.missed += missed;
+        pthread_mutex_unlock(&vsync_mutex);
+
+        hwc_stats_vsync(next_vsync);
         if (hwc_dev->procs && hwc_dev->procs->vsync) {
             hwc_dev->procs->vsync(hwc_dev->procs, 0, next_vsync);
         }
+        next_vsync += period;
     }
     return NULL;
 }
 
+static int cmp_nsecs(const void *a, const void *b)
+{
+    nsecs_t na = *(const nsecs_t *)a, nb = *(const nsecs_t *)b;
+    return na < nb ? -1 : na > nb;
+}
+
 bool use_sw_vsync()
 {
     char board[PROPERTY_VALUE_MAX];
@@ -148,3 +185,35 @@ void stop_sw_vsync()
     pthread_mutex_unlock(&vsync_mutex);
     pthread_cond_signal(&vsync_cond);
 }
+
+void lock_sw_vsync(nsecs_t timestamp)
+{
+    pthread_mutex_lock(&vsync_mutex);
+    vsync_reference = timestamp;
+    pthread_mutex_unlock(&vsync_mutex);
+}
+
+void get_sw_vsync_stats(sw_vsync_stats_t *stats)
+{
+    nsecs_t samples[JITTER_SAMPLES];
+    nsecs_t total = 0;
+    uint32_t i, n;
+
+    pthread_mutex_lock(&vsync_mutex);
+    n = jitter.count < JITTER_SAMPLES ? jitter.count : JITTER_SAMPLES;
+    memcpy(samples, jitter.samples, n * sizeof(*samples));
+    stats->count = jitter.count;
+    stats->missed = jitter.missed;
+    stats->rate = vsync_rate;
+    pthread_mutex_unlock(&vsync_mutex);
+
+    stats->mean = stats->p99 = stats->max = 0;
+    if (!n)
+        return;
+    qsort(samples, n, sizeof(*samples), cmp_nsecs);
+    for (i = 0; i < n; i++)
+        total += samples[i];
+    stats->mean = total / n;
+    stats->p99 = samples[n * 99 / 100];
+    stats->max = samples[n - 1];
+}
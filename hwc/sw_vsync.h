@@ -17,9 +17,23 @@
 #ifndef __SWVSYNC_H__
 #define __SWVSYNC_H__
 
+/* Jitter of the last generated vsyncs, in ns */
+struct sw_vsync_stats {
+    nsecs_t rate;       /* period */
+    nsecs_t mean;
+    nsecs_t p99;
+    nsecs_t max;
+    uint32_t count;     /* vsyncs generated */
+    uint32_t missed;    /* periods skipped because of late wakeups */
+};
+typedef struct sw_vsync_stats sw_vsync_stats_t;
+
 bool use_sw_vsync();
 void init_sw_vsync(omap_hwc_device_t *hwc_dev);
 void start_sw_vsync();
 void stop_sw_vsync();
+/* Align the generated vsyncs with a real vsync timestamp */
+void lock_sw_vsync(nsecs_t timestamp);
+void get_sw_vsync_stats(sw_vsync_stats_t *stats);
 
 #endif
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <linux/bltsville.h>
+
+#include "bv_cpu.h"
+
+uint32_t blend(uint32_t src1, uint32_t src2)
+{
+    uint32_t a1 = src1 >> 24;
+    uint32_t res = 0;
+    int shift;
+
+    for (shift = 0; shift < 32; shift += 8) {
+        uint32_t c = (src1 >> shift & 0xFF) + ((src2 >> shift & 0xFF) * (255 - a1) + 127) / 255;
+        res |= (c > 255 ? 255 : c) << shift;
+    }
+    return res;
+}
+
+static bool is_bgr(struct bvsurfgeom *geom)
+{
+    return geom->format == OCDFMT_BGRA24 || geom->format == OCDFMT_BGR124;
+}
+
+static uint32_t swap_rb(uint32_t p)
+{
+    return (p & 0xFF00FF00) | (p >> 16 & 0xFF) | (p & 0xFF) << 16;
+}
+
+uint32_t get_pixel(struct bvbuffdesc *desc, struct bvsurfgeom *geom, int x, int y)
+{
+    uint32_t p = *(uint32_t *)((char *)desc->virtaddr + y * geom->virtstride + x * 4);
+    if (is_bgr(geom))
+        p = swap_rb(p);
+    return geom->format & OCDFMTDEF_ALPHA ? p : p | 0xFF000000;
+}
+
+void put_pixel(struct bvbuffdesc *desc, struct bvsurfgeom *geom, int x, int y, uint32_t p)
+{
+    if (!(geom->format & OCDFMTDEF_ALPHA))
+        p |= 0xFF000000;
+    *(uint32_t *)((char *)desc->virtaddr + y * geom->virtstride + x * 4) = is_bgr(geom) ? swap_rb(p) : p;
+}
+
+static bool supported_geom(struct bvsurfgeom *geom)
+{
+    return !geom->orientation &&
+           (geom->format == OCDFMT_RGBA24 || geom->format == OCDFMT_RGB124 ||
+            geom->format == OCDFMT_BGRA24 || geom->format == OCDFMT_BGR124);
+}
+
+/* Source coordinate of a destination one, only 1x1 sources are stretched */
+static int src_coord(int d, int dstart, int dlen, int sstart, int slen)
+{
+    return sstart + (slen == 1 ? 0 : (d - dstart) * slen / dlen);
+}
+
+/* The CPU BLTsville, copies and SRC1OVER blends */
+enum bverror cpu_blt(struct bvbltparams *bp)
+{
+    unsigned long op = bp->flags & BVFLAG_OP_MASK;
+    struct bvrect *d = &bp->dstrect;
+    struct bvrect *c = &bp->cliprect;
+    int x, y;
+
+    if (bp->flags & ~(BVFLAG_OP_MASK | BVFLAG_CLIP | BVFLAG_ASYNC | BVFLAG_BATCH_MASK))
+        return BVERR_FLAGS;
+    if (!(op == BVFLAG_ROP && bp->op.rop == 0xCCCC) &&
+        !(op == BVFLAG_BLEND && bp->op.blend == BVBLEND_SRC1OVER))
+        return BVERR_OP;
+    if (!supported_geom(bp->dstgeom) || !supported_geom(bp->src1geom) ||
+        (op == BVFLAG_BLEND && !supported_geom(bp->src2geom)))
+        return BVERR_FORMAT;
+    if ((bp->src1rect.width != 1 || bp->src1rect.height != 1) &&
+        (bp->src1rect.width != d->width || bp->src1rect.height != d->height))
+        return BVERR_SRC1_HORZSCALE;
+    if (op == BVFLAG_BLEND &&
+        (bp->src2rect.width != d->width || bp->src2rect.height != d->height))
+        return BVERR_SRC2_HORZSCALE;
+
+    /* The rectangle sizes are unsigned */
+    int dright = d->left + (int)d->width, dbottom = d->top + (int)d->height;
+    int cright = c->left + (int)c->width, cbottom = c->top + (int)c->height;
+
+    for (y = d->top; y < dbottom; y++) {
+        if ((bp->flags & BVFLAG_CLIP) && (y < c->top || y >= cbottom))
+            continue;
+        if (y < 0 || y >= (int)bp->dstgeom->height)
+            return BVERR_DSTRECT;
+
+        for (x = d->left; x < dright; x++) {
+            if ((bp->flags & BVFLAG_CLIP) && (x < c->left || x >= cright))
+                continue;
+            if (x < 0 || x >= (int)bp->dstgeom->width)
+                return BVERR_DSTRECT;
+
+            uint32_t src1 = get_pixel(bp->src1.desc, bp->src1geom,
+                src_coord(x, d->left, d->width, bp->src1rect.left, bp->src1rect.width),
+                src_coord(y, d->top, d->height, bp->src1rect.top, bp->src1rect.height));
+
+            if (op == BVFLAG_BLEND) {
+                uint32_t src2 = get_pixel(bp->src2.desc, bp->src2geom,
+                    bp->src2rect.left + x - d->left, bp->src2rect.top + y - d->top);
+                put_pixel(bp->dstdesc, bp->dstgeom, x, y, blend(src1, src2));
+            } else
+                put_pixel(bp->dstdesc, bp->dstgeom, x, y, src1);
+        }
+    }
+    return BVERR_NONE;
+}
+
+enum bverror cpu_fill(struct bvbltparams *bp, unsigned int count, const struct bvrect *rects)
+{
+    struct bvbltparams fill = *bp;
+    unsigned int i;
+
+    for (i = 0; i < count; i++) {
+        fill.dstrect = rects[i];
+        enum bverror err = cpu_blt(&fill);
+        if (err != BVERR_NONE)
+            return err;
+    }
+    return BVERR_NONE;
+}
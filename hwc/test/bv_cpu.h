@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BV_CPU__
+#define __BV_CPU__
+
+#include <stdint.h>
+#include <linux/bltsville.h>
+
+/*
+ * Minimal CPU BLTsville of the host tests
+ *
+ * Only knows what the regionizer generates: unscaled, untransformed copies
+ * and SRC1OVER blends of RGBA/RGBX and BGRA/BGRX surfaces, and fills from a
+ * 1x1 source. Anything else fails with the matching bverror.
+ */
+
+/* Pixels are handled in the HAL_PIXEL_FORMAT_RGBA_8888 layout, premultiplied */
+uint32_t blend(uint32_t src1, uint32_t src2);
+uint32_t get_pixel(struct bvbuffdesc *desc, struct bvsurfgeom *geom, int x, int y);
+void put_pixel(struct bvbuffdesc *desc, struct bvsurfgeom *geom, int x, int y, uint32_t p);
+
+enum bverror cpu_blt(struct bvbltparams *bp);
+/* gcbvfill, the rectangles stand for dstrect */
+enum bverror cpu_fill(struct bvbltparams *bp, unsigned int count, const struct bvrect *rects);
+
+#endif
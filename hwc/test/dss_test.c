@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host test of the choice of the DSS layers in hwc_prepare
+ *
+ * Checks the layers chosen for a few typical stacks, then compares the search
+ * with all the subsets of random layer stacks small enough to go through, and
+ * checks that the search of a large stack stops at its node budget with a
+ * valid choice. Also times the search.
+ *
+ * Usage: dss_test [-s seed] [-n stacks]
+ *
+ * Returns 0 when every case passes.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../dss_search.h"
+
+#define SCREEN_AREA (1920 * 1080)
+#define PROTECTED (1ULL << 32)
+#define SLOT_SIZE (32 << 20)
+#define MAX_RANDOM_LAYERS 10
+#define TIMED_SEARCHES 100000
+
+static int failures;
+
+static void check(bool ok, const char *what)
+{
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+    failures += !ok;
+}
+
+static void init_search(struct dss_search *s, uint32_t num_layers, uint32_t max_ovls, bool use_sgx)
+{
+    memset(s, 0, sizeof(*s));
+    s->num_layers = num_layers;
+    s->max_ovls = max_ovls;
+    s->max_mem = SLOT_SIZE;
+    s->use_sgx = use_sgx;
+}
+
+static void add_layer(struct dss_search *s, uint32_t i, uint64_t score, uint32_t mem, bool blended)
+{
+    s->eligible |= 1 << i;
+    s->score[i] = score;
+    s->mem[i] = mem;
+    if (blended)
+        s->blended |= 1 << i;
+}
+
+/* Whether DSS can render the layers of chosen together */
+static bool valid(struct dss_search *s, uint32_t chosen, uint32_t *mem)
+{
+    uint32_t i, count = 0;
+    bool below_fb = false;
+
+    *mem = 0;
+    for (i = 0; i < s->num_layers; i++) {
+        if (!(chosen & (1 << i))) {
+            below_fb = below_fb || s->use_sgx;
+            continue;
+        }
+        if (!(s->eligible & (1 << i)) || ((s->blended & (1 << i)) && below_fb))
+            return false;
+        count++;
+        *mem += s->mem[i];
+    }
+    return (s->num_layers == MAX_DSS_SEARCH_LAYERS || !(chosen >> s->num_layers)) &&
+           count <= s->max_ovls && *mem <= s->max_mem;
+}
+
+static uint64_t score(struct dss_search *s, uint32_t chosen)
+{
+    uint64_t total = 0;
+    uint32_t i;
+
+    for (i = 0; i < s->num_layers; i++)
+        if (chosen & (1 << i))
+            total += s->score[i];
+    return total;
+}
+
+/* Best score and the least memory for it over all the subsets */
+static void brute_force(struct dss_search *s, uint64_t *best_score, uint32_t *best_mem)
+{
+    uint32_t chosen, mem;
+
+    *best_score = 0;
+    *best_mem = 0;
+    for (chosen = 0; chosen < 1U << s->num_layers; chosen++) {
+        uint64_t sc = score(s, chosen);
+
+        if (valid(s, chosen, &mem) &&
+            (sc > *best_score || (sc == *best_score && mem < *best_mem))) {
+            *best_score = sc;
+            *best_mem = mem;
+        }
+    }
+}
+
+/* Layers on screen, some with the same area */
+static void random_search(struct dss_search *s, uint32_t max_layers)
+{
+    uint32_t i;
+
+    init_search(s, 1 + rand() % max_layers, rand() % 5, rand() & 1);
+    for (i = 0; i < s->num_layers; i++) {
+        if (rand() % 5 == 0)
+            continue;
+        add_layer(s, i, (rand() % 4 == 0 ? (1 + rand() % 4) * (SCREEN_AREA / 4) : 1 + rand() % SCREEN_AREA) +
+                  (rand() % 10 == 0 ? PROTECTED : 0),
+                  rand() % (SLOT_SIZE / 2), rand() % 3 == 0);
+    }
+}
+
+static void check_typical(void)
+{
+    struct dss_search s;
+    uint32_t mem;
+
+    /* A status bar over a full-screen video with one pipe left */
+    init_search(&s, 3, 1, true);
+    add_layer(&s, 0, 1920 * 48, 1 << 20, true);
+    add_layer(&s, 1, SCREEN_AREA, 4 << 20, false);
+    check(run_dss_search(&s) == 1 << 1 && s.greedy == 1 << 0, "video preferred over the status bar");
+
+    /* Protected content over anything larger */
+    init_search(&s, 2, 1, true);
+    add_layer(&s, 0, SCREEN_AREA, 4 << 20, false);
+    add_layer(&s, 1, 640 * 480 + PROTECTED, 1 << 20, false);
+    check(run_dss_search(&s) == 1 << 1, "protected layer kept on DSS");
+
+    /* Two layers the TILER1D slot can't take together */
+    init_search(&s, 2, 2, true);
+    add_layer(&s, 0, 640 * 480, SLOT_SIZE / 2 + 1, false);
+    add_layer(&s, 1, SCREEN_AREA, SLOT_SIZE / 2 + 1, false);
+    check(run_dss_search(&s) == 1 << 1, "larger layer of those fitting in the TILER1D slot");
+
+    /* A blended layer above one left to SGX */
+    init_search(&s, 3, 3, true);
+    add_layer(&s, 1, SCREEN_AREA, 1 << 20, true);
+    add_layer(&s, 2, 640 * 480, 1 << 20, false);
+    check(run_dss_search(&s) == 1 << 2 && valid(&s, s.best, &mem),
+          "no blended layer in the middle of the framebuffer stack");
+
+    /* Without SGX the framebuffer is unused */
+    s.use_sgx = false;
+    check(run_dss_search(&s) == (1 << 1 | 1 << 2), "blended layer above an unused framebuffer");
+
+    /* Equal areas */
+    init_search(&s, 2, 1, true);
+    add_layer(&s, 0, SCREEN_AREA / 2, 8 << 20, false);
+    add_layer(&s, 1, SCREEN_AREA / 2, 2 << 20, false);
+    check(run_dss_search(&s) == 1 << 1 && s.best_mem == 2 << 20, "less TILER1D memory on a tie");
+
+    init_search(&s, 2, 0, true);
+    add_layer(&s, 0, SCREEN_AREA, 1 << 20, false);
+    check(run_dss_search(&s) == 0 && !s.nodes, "no pipes, no layers");
+}
+
+static void check_random(int stacks)
+{
+    struct dss_search s;
+    uint64_t best_score;
+    uint32_t best_mem, mem;
+    int i, wrong = 0, improved = 0;
+    char what[128];
+
+    for (i = 0; i < stacks; i++) {
+        random_search(&s, MAX_RANDOM_LAYERS);
+        run_dss_search(&s);
+        brute_force(&s, &best_score, &best_mem);
+        if (!valid(&s, s.best, &mem) || mem != s.best_mem || score(&s, s.best) != s.best_score ||
+            s.best_score != best_score || s.best_mem != best_mem || !valid(&s, s.greedy, &mem) ||
+            s.nodes > MAX_DSS_SEARCH_NODES) {
+            if (!wrong)
+                printf("stack %d: %u layers, %u pipes, sgx %d: chose %#x, score %llu, best %llu\n",
+                       i, s.num_layers, s.max_ovls, s.use_sgx, s.best,
+                       (unsigned long long)s.best_score, (unsigned long long)best_score);
+            wrong++;
+        }
+        improved += s.best != s.greedy;
+    }
+    snprintf(what, sizeof(what), "%d random stacks searched as well as through all subsets, "
+             "%d better than the first layers that fit", stacks - wrong, improved);
+    check(!wrong, what);
+}
+
+static void check_budget(void)
+{
+    struct dss_search s;
+    uint32_t i, first, mem;
+
+    /* Equal layers, so the bound prunes nothing */
+    init_search(&s, MAX_DSS_SEARCH_LAYERS, 4, false);
+    for (i = 0; i < MAX_DSS_SEARCH_LAYERS; i++)
+        add_layer(&s, i, SCREEN_AREA / 4, SLOT_SIZE / 8 + i, false);
+    first = run_dss_search(&s);
+    check(s.nodes > MAX_DSS_SEARCH_NODES && valid(&s, s.best, &mem) && s.best_score >= s.greedy_score,
+          "search stopped at its node budget with a valid choice");
+    check(run_dss_search(&s) == first, "stopped search repeatable");
+}
+
+static void time_search(void)
+{
+    static struct dss_search searches[256];
+    struct timespec start, end;
+    uint32_t layers[] = { 8, MAX_DSS_SEARCH_LAYERS };
+    uint32_t i, j, nodes;
+
+    for (i = 0; i < sizeof(layers) / sizeof(layers[0]); i++) {
+        for (j = 0; j < 256; j++)
+            random_search(&searches[j], layers[i]);
+        nodes = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (j = 0; j < TIMED_SEARCHES; j++) {
+            run_dss_search(&searches[j & 255]);
+            nodes += searches[j & 255].nodes;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        printf("%.3f us and %u nodes per search of up to %u layers\n",
+               ((end.tv_sec - start.tv_sec) * 1e9 + end.tv_nsec - start.tv_nsec) / 1e3 / TIMED_SEARCHES,
+               nodes / TIMED_SEARCHES, layers[i]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int seed = 1, stacks = 100000, opt;
+
+    while ((opt = getopt(argc, argv, "s:n:")) != -1) {
+        switch (opt) {
+        case 's':
+            seed = atoi(optarg);
+            break;
+        case 'n':
+            stacks = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: dss_test [-s seed] [-n stacks]\n");
+            return 1;
+        }
+    }
+    srand(seed);
+
+    check_typical();
+    check_random(stacks);
+    check_budget();
+    time_search();
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,395 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host test of the composition plan cache of hwc_prepare
+ *
+ * A composition is stored for a list of layers, then lists differing in one
+ * attribute are matched against it: buffer changes must reuse the plan, any
+ * change of a layer attribute, of the layer count or of the device state must
+ * not. Reused plans must give the layers the composition stored.
+ *
+ * Also times the match hwc_prepare does on every frame.
+ *
+ *   plan_test
+ *   plan_test -r <trace>
+ *
+ * -r replays the prepares of a trace captured with debug.hwc.capture instead,
+ * see hwc_trace.h, and reports how often their layers matched the plan of the
+ * previous composition, next to how often the device reused it. Those can
+ * differ: the device doesn't keep compositions with blits or changing the
+ * device state.
+ *
+ * Returns 0 when every case passes.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/types.h>
+
+#include "../hwc_dev.h"
+#include "../hwc_plan.h"
+#include "../hwc_trace.h"
+
+#define NUM_LAYERS 3
+#define MAX_LAYERS 8
+#define TIMED_MATCHES 100000
+
+static IMG_native_handle_t buffers[2][MAX_LAYERS];
+static int failures;
+
+static void check(bool ok, const char *what)
+{
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+    failures += !ok;
+}
+
+/* A video overlay and a status bar over the framebuffer target */
+static void init_list(hwc_display_contents_1_t *list, int num_layers, int buf)
+{
+    int i;
+
+    memset(list->hwLayers, 0, MAX_LAYERS * sizeof(list->hwLayers[0]));
+    list->numHwLayers = num_layers;
+    for (i = 0; i < num_layers; i++) {
+        hwc_layer_1_t *l = &list->hwLayers[i];
+        IMG_native_handle_t *h = &buffers[buf][i];
+
+        h->iFormat = i ? HAL_PIXEL_FORMAT_RGBA_8888 : HAL_PIXEL_FORMAT_YV12;
+        h->iWidth = 320 + i;
+        h->iHeight = 240 + i;
+        h->usage = GRALLOC_USAGE_HW_RENDER;
+        l->handle = (buffer_handle_t)h;
+        l->compositionType = i == num_layers - 1 ? HWC_FRAMEBUFFER_TARGET : HWC_FRAMEBUFFER;
+        l->blending = i ? HWC_BLENDING_PREMULT : HWC_BLENDING_NONE;
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+        l->planeAlpha = 0xFF;
+#endif
+        l->sourceCrop.right = h->iWidth;
+        l->sourceCrop.bottom = h->iHeight;
+        l->displayFrame.left = 10 * i;
+        l->displayFrame.right = 10 * i + 640;
+        l->displayFrame.bottom = 480;
+        l->acquireFenceFd = l->releaseFenceFd = -1;
+    }
+}
+
+/* Decisions prepare could come to, on top of the hints the layers came with */
+static void prepare(hwc_display_contents_1_t *list)
+{
+    list->hwLayers[0].compositionType = HWC_OVERLAY;
+    list->hwLayers[0].hints |= HWC_HINT_TRIPLE_BUFFER;
+    list->hwLayers[1].hints |= HWC_HINT_CLEAR_FB;
+}
+
+/* Stores the composition of the list as hwc_prepare does on a miss */
+static bool store(omap_hwc_plan_t *plan, hwc_display_contents_1_t *list, omap_hwc_plan_state_t *state)
+{
+    uint32_t hash;
+
+    if (hwc_plan_match(plan, list, state, &hash))
+        return false;
+    prepare(list);
+    if (!hwc_plan_store(plan, list, state, hash))
+        return false;
+    plan->valid = true;
+    return true;
+}
+
+static bool match(omap_hwc_plan_t *plan, hwc_display_contents_1_t *list, omap_hwc_plan_state_t *state)
+{
+    uint32_t hash;
+
+    return hwc_plan_match(plan, list, state, &hash);
+}
+
+static void change_buffer(hwc_layer_1_t *l) { l->handle = (buffer_handle_t)((IMG_native_handle_t *)l->handle - MAX_LAYERS); }
+static void change_format(hwc_layer_1_t *l) { ((IMG_native_handle_t *)l->handle)->iFormat = HAL_PIXEL_FORMAT_BGRA_8888; }
+static void change_width(hwc_layer_1_t *l) { ((IMG_native_handle_t *)l->handle)->iWidth++; }
+static void change_height(hwc_layer_1_t *l) { ((IMG_native_handle_t *)l->handle)->iHeight++; }
+static void change_usage(hwc_layer_1_t *l) { ((IMG_native_handle_t *)l->handle)->usage |= GRALLOC_USAGE_PROTECTED; }
+static void remove_buffer(hwc_layer_1_t *l) { l->handle = NULL; }
+static void make_fb_target(hwc_layer_1_t *l) { l->compositionType = HWC_FRAMEBUFFER_TARGET; }
+static void change_flags(hwc_layer_1_t *l) { l->flags |= HWC_SKIP_LAYER; }
+static void change_transform(hwc_layer_1_t *l) { l->transform = HWC_TRANSFORM_ROT_90; }
+static void change_blending(hwc_layer_1_t *l) { l->blending = HWC_BLENDING_COVERAGE; }
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+static void change_plane_alpha(hwc_layer_1_t *l) { l->planeAlpha = 0x80; }
+#endif
+static void change_crop(hwc_layer_1_t *l) { l->sourceCrop.left++; }
+static void change_frame(hwc_layer_1_t *l) { l->displayFrame.top++; }
+
+static void check_layer_changes(void)
+{
+    static const struct {
+        void (*change)(hwc_layer_1_t *l);
+        bool hit;
+        const char *what;
+    } changes[] = {
+        { change_buffer, true, "new buffer" },
+        { change_format, false, "format" },
+        { change_width, false, "width" },
+        { change_height, false, "height" },
+        { change_usage, false, "usage" },
+        { remove_buffer, false, "no buffer" },
+        { make_fb_target, false, "framebuffer target" },
+        { change_flags, false, "flags" },
+        { change_transform, false, "transform" },
+        { change_blending, false, "blending" },
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+        { change_plane_alpha, false, "plane alpha" },
+#endif
+        { change_crop, false, "source crop" },
+        { change_frame, false, "display frame" },
+    };
+    hwc_display_contents_1_t *list = calloc(1, sizeof(*list) + MAX_LAYERS * sizeof(list->hwLayers[0]));
+    omap_hwc_plan_state_t state;
+    omap_hwc_plan_t plan;
+    unsigned int i;
+    int layer;
+    char what[64];
+
+    memset(&state, 0, sizeof(state));
+    for (i = 0; i < sizeof(changes) / sizeof(changes[0]); i++) {
+        for (layer = 0; layer < NUM_LAYERS - 1; layer++) {
+            memset(&plan, 0, sizeof(plan));
+            init_list(list, NUM_LAYERS, 1);
+            bool stored = store(&plan, list, &state);
+
+            init_list(list, NUM_LAYERS, 1);
+            changes[i].change(&list->hwLayers[layer]);
+            snprintf(what, sizeof(what), "%s of layer %d %s", changes[i].what, layer,
+                     changes[i].hit ? "reuses the plan" : "misses");
+            check(stored && match(&plan, list, &state) == changes[i].hit, what);
+            hwc_plan_free(&plan);
+        }
+    }
+    free(list);
+}
+
+static void to_hwc_rect(hwc_rect_t *r, struct hwc_trace_rect *t)
+{
+    r->left = t->left;
+    r->top = t->top;
+    r->right = t->right;
+    r->bottom = t->bottom;
+}
+
+static int replay(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    struct hwc_trace_header header;
+    struct hwc_trace_call call;
+    struct hwc_trace_layer *trace_layers = NULL;
+    hwc_display_contents_1_t *list = NULL;
+    IMG_native_handle_t *handles = NULL;
+    omap_hwc_plan_state_t state;
+    omap_hwc_plan_t plan;
+    uint32_t size = 0, i, hash;
+    int prepares = 0, hits = 0, reused = 0;
+    int rv = -1;
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    memset(&state, 0, sizeof(state));
+    memset(&plan, 0, sizeof(plan));
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        header.magic != HWC_TRACE_MAGIC || header.version != HWC_TRACE_VERSION) {
+        printf("%s: not a version %d HWC trace\n", path, HWC_TRACE_VERSION);
+        goto out;
+    }
+
+    while (fread(&call, sizeof(call), 1, f) == 1) {
+        if (call.num_layers > size) {
+            void *p = realloc(trace_layers, call.num_layers * sizeof(*trace_layers));
+            if (!p)
+                goto out;
+            trace_layers = p;
+            p = realloc(list, sizeof(*list) + call.num_layers * sizeof(list->hwLayers[0]));
+            if (!p)
+                goto out;
+            list = p;
+            p = realloc(handles, call.num_layers * sizeof(*handles));
+            if (!p)
+                goto out;
+            handles = p;
+            size = call.num_layers;
+        }
+        if (fread(trace_layers, sizeof(*trace_layers), call.num_layers, f) != call.num_layers ||
+            fseek(f, call.num_ovls * sizeof(struct hwc_trace_ovl) +
+                     call.num_blits * sizeof(struct hwc_trace_blit), SEEK_CUR)) {
+            printf("%s: truncated\n", path);
+            goto out;
+        }
+        if (call.type != HWC_TRACE_PREPARE)
+            continue;
+
+        /* The keys only take the buffer attributes, not which buffer it is */
+        memset(list, 0, sizeof(*list) + call.num_layers * sizeof(list->hwLayers[0]));
+        memset(handles, 0, call.num_layers * sizeof(*handles));
+        list->numHwLayers = call.num_layers;
+        for (i = 0; i < call.num_layers; i++) {
+            struct hwc_trace_layer *t = &trace_layers[i];
+            hwc_layer_1_t *l = &list->hwLayers[i];
+
+            if (t->handle) {
+                handles[i].iFormat = t->format;
+                handles[i].iWidth = t->width;
+                handles[i].iHeight = t->height;
+                handles[i].usage = t->usage;
+                l->handle = (buffer_handle_t)&handles[i];
+            }
+            l->compositionType = t->compositionType == HWC_FRAMEBUFFER_TARGET ?
+                                 HWC_FRAMEBUFFER_TARGET : HWC_FRAMEBUFFER;
+            l->flags = t->flags;
+            l->transform = t->transform;
+            l->blending = t->blending;
+            to_hwc_rect(&l->sourceCrop, &t->sourceCrop);
+            to_hwc_rect(&l->displayFrame, &t->displayFrame);
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+            l->planeAlpha = 0xFF;
+#endif
+            l->acquireFenceFd = l->releaseFenceFd = -1;
+        }
+        state.current.enabled = call.ext_enabled;
+        state.current.docking = call.ext_docking;
+
+        prepares++;
+        reused += call.reused;
+        if (hwc_plan_match(&plan, list, &state, &hash)) {
+            hits++;
+        } else {
+            /* The composition the device decided */
+            for (i = 0; i < call.num_layers; i++) {
+                list->hwLayers[i].compositionType = trace_layers[i].compositionType;
+                list->hwLayers[i].hints = trace_layers[i].hints;
+            }
+            plan.valid = hwc_plan_store(&plan, list, &state, hash);
+        }
+    }
+    printf("%s: %d prepares, layers matched the plan in %d (%d%%), reused on the device in %d (%d%%)\n",
+           path, prepares, hits, prepares ? hits * 100 / prepares : 0,
+           reused, prepares ? reused * 100 / prepares : 0);
+    rv = 0;
+
+out:
+    hwc_plan_free(&plan);
+    free(handles);
+    free(list);
+    free(trace_layers);
+    fclose(f);
+    return rv;
+}
+
+int main(int argc, char **argv)
+{
+    hwc_display_contents_1_t *list;
+    omap_hwc_plan_state_t state;
+    omap_hwc_plan_t plan;
+    struct timespec start, end;
+    int i, hits = 0, opt;
+
+    while ((opt = getopt(argc, argv, "r:")) != -1) {
+        if (opt != 'r') {
+            fprintf(stderr, "usage: %s [-r <trace>]\n", argv[0]);
+            return 2;
+        }
+        return replay(optarg) ? 1 : 0;
+    }
+
+    list = calloc(1, sizeof(*list) + MAX_LAYERS * sizeof(list->hwLayers[0]));
+    if (!list)
+        return 1;
+    memset(&state, 0, sizeof(state));
+    memset(&plan, 0, sizeof(plan));
+
+    init_list(list, NUM_LAYERS, 1);
+    check(!match(&plan, list, &state), "empty plan misses");
+    check(plan.size == NUM_LAYERS, "layer keys allocated");
+
+    init_list(list, NUM_LAYERS, 1);
+    check(store(&plan, list, &state), "plan stored");
+
+    /* The layers come without the decisions of the last prepare */
+    init_list(list, NUM_LAYERS, 1);
+    list->hwLayers[2].hints = HWC_HINT_TRIPLE_BUFFER;
+    check(match(&plan, list, &state), "same layers reuse the plan");
+    hwc_plan_apply(&plan, list);
+    check(list->hwLayers[0].compositionType == HWC_OVERLAY &&
+          list->hwLayers[0].hints == HWC_HINT_TRIPLE_BUFFER &&
+          list->hwLayers[1].compositionType == HWC_FRAMEBUFFER &&
+          list->hwLayers[1].hints == HWC_HINT_CLEAR_FB &&
+          list->hwLayers[2].compositionType == HWC_FRAMEBUFFER_TARGET,
+          "composition restored");
+
+    /* Only the hints prepare added are part of the plan */
+    init_list(list, NUM_LAYERS, 1);
+    list->hwLayers[1].hints = HWC_HINT_CLEAR_FB;
+    plan.valid = false;
+    check(store(&plan, list, &state), "plan stored again");
+    init_list(list, NUM_LAYERS, 1);
+    check(match(&plan, list, &state), "hints don't change the layer keys");
+    hwc_plan_apply(&plan, list);
+    check(list->hwLayers[0].hints == HWC_HINT_TRIPLE_BUFFER && !list->hwLayers[1].hints,
+          "hints the layers came with not restored");
+
+    init_list(list, NUM_LAYERS - 1, 1);
+    check(!match(&plan, list, &state), "fewer layers miss");
+
+    init_list(list, MAX_LAYERS, 1);
+    check(!match(&plan, list, &state) && plan.size == MAX_LAYERS, "more layers miss and grow the keys");
+    init_list(list, MAX_LAYERS, 1);
+    check(store(&plan, list, &state), "plan of more layers stored");
+    init_list(list, MAX_LAYERS, 0);
+    check(match(&plan, list, &state), "plan of more layers reused");
+
+    state.xres = 1920;
+    init_list(list, MAX_LAYERS, 0);
+    check(!match(&plan, list, &state), "device state change misses");
+
+    plan.valid = false;
+    init_list(list, MAX_LAYERS, 0);
+    check(!match(&plan, list, &state), "invalidated plan misses");
+    hwc_plan_free(&plan);
+
+    check_layer_changes();
+
+    memset(&plan, 0, sizeof(plan));
+    init_list(list, MAX_LAYERS, 1);
+    store(&plan, list, &state);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < TIMED_MATCHES; i++) {
+        init_list(list, MAX_LAYERS, i & 1);
+        hits += match(&plan, list, &state);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    hwc_plan_free(&plan);
+    check(hits == TIMED_MATCHES, "buffer flips reuse the plan");
+    printf("%.3f us per match of %d layers, with the list setup\n",
+           ((end.tv_sec - start.tv_sec) * 1e9 + end.tv_nsec - start.tv_nsec) / 1e3 / TIMED_MATCHES,
+           MAX_LAYERS);
+
+    free(list);
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,875 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host test and benchmark of the regionizer
+ *
+ *   rgz_test [-s <seed>] [-n <frames>] [-l <layers>]
+ *   rgz_test -r <trace>
+ *
+ * Random sequences of layer stacks are regionized frame after frame. Each
+ * frame is blitted in region mode into framebuffers rotating like the
+ * regionizer framebuffer states, so only the damaged and dirty subregions are
+ * written, and in paint mode. Both are compared pixel by pixel with the layers
+ * composed back to front by the test itself. Fixed sequences first check the
+ * region data is kept while only buffer contents change, that subregions get
+ * merged, and that stacks above the 11 layers the regionizer used to take are
+ * blitted. -l sets the largest random stack, 8 layers by default.
+ *
+ * The blits are executed by a minimal CPU BLTsville, see bv_cpu.h, anything it
+ * doesn't implement fails the blit and the test.
+ *
+ * -r replays the layer stacks of a trace captured with debug.hwc.capture
+ * instead, see hwc_trace.h. The layers the HWC didn't put on a DSS pipe are
+ * regionized as if all of them were blitted, nothing is checked.
+ *
+ * Both report how often the region data was reused, the blits saved by merging
+ * subregions and the CPU time of the rgz_in and rgz_out calls the HWC makes,
+ * with RGZ_OUT_BVCMD_REGION.
+ *
+ * Returns 0 when every frame matches.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/types.h>
+
+#include "../hwc_dev.h"
+#include "../hwc_trace.h"
+#include "../rgz_2d.h"
+#include "bv_cpu.h"
+
+#define SCREEN_WIDTH 96
+#define SCREEN_HEIGHT 64
+/* Padding at the end of the framebuffer lines */
+#define SCREEN_PAD 8
+
+#define MAX_LAYERS 64
+#define DEFAULT_MAX_LAYERS 8
+#define MANY_LAYERS 24
+#define DEFAULT_FRAMES 2000
+
+/* Mismatching frames printed before only counting them */
+#define MAX_PRINTED_FAILURES 10
+
+struct buffer {
+    IMG_native_handle_t handle;
+    uint32_t *pixels;
+    int stride;                 /* pixels */
+    int last_frame;             /* last frame the buffer was shown in */
+    struct buffer *next;
+};
+
+struct layer {
+    struct buffer *buffer;
+    hwc_rect_t crop;
+    hwc_rect_t frame;
+    int32_t blending;
+    int type;                   /* LAYER_* */
+};
+
+enum {
+    LAYER_BLIT,                 /* HWC_FRAMEBUFFER, blitted */
+    LAYER_CLEAR,                /* HWC_OVERLAY with the clear fb hint */
+    LAYER_OVERLAY,              /* HWC_OVERLAY, left to the DSS */
+};
+
+static struct buffer *buffers;
+static struct layer layers[MAX_LAYERS];
+static int num_layers;
+static int max_layers = DEFAULT_MAX_LAYERS;
+static int frame;
+
+static struct bvsurfgeom fbgeom;
+static struct bvbuffdesc shadows[RGZ_NUM_FB];
+static struct bvbuffdesc paint_fb;
+static uint32_t *reference;
+
+static struct {
+    int regionized;             /* frames rgz_in accepted */
+    int rejected;
+    int reused;                 /* frames keeping the previous region data */
+    long long in_ns;
+    long long out_ns;
+    int frames;                 /* frames checked */
+    int failures;
+    int fills;
+    long long region_blits;
+    long long saved_blits;
+    long long paint_blits;
+} stats;
+
+static int rand_range(int lo, int hi)
+{
+    return lo + rand() % (hi - lo + 1);
+}
+
+/* Random premultiplied pixel, opaque one time out of four */
+static uint32_t rand_pixel(void)
+{
+    uint32_t a = rand() % 4 ? rand() % 256 : 255;
+    uint32_t r = a ? rand() % (a + 1) : 0;
+    uint32_t g = a ? rand() % (a + 1) : 0;
+    uint32_t b = a ? rand() % (a + 1) : 0;
+    return a << 24 | b << 16 | g << 8 | r;
+}
+
+static struct buffer *new_buffer(int width, int height, int format)
+{
+    struct buffer *b = calloc(1, sizeof(*b));
+    int i;
+
+    if (!b)
+        return NULL;
+    b->stride = ALIGN(width, HW_ALIGN);
+    b->pixels = malloc(b->stride * height * sizeof(uint32_t));
+    if (!b->pixels) {
+        free(b);
+        return NULL;
+    }
+    for (i = 0; i < b->stride * height; i++)
+        b->pixels[i] = rand_pixel();
+
+    b->handle.iWidth = width;
+    b->handle.iHeight = height;
+    b->handle.iFormat = format;
+    b->handle.usage = GRALLOC_USAGE_HW_RENDER;
+    b->last_frame = frame;
+    b->next = buffers;
+    buffers = b;
+    return b;
+}
+
+/*
+ * Buffers are only freed once unused for a frame, so a handle never stands
+ * for new content in the frame following the one it was shown in
+ */
+static void free_buffers(bool all)
+{
+    struct buffer **p = &buffers;
+
+    while (*p) {
+        struct buffer *b = *p;
+        if (all || b->last_frame < frame - 1) {
+            *p = b->next;
+            free(b->pixels);
+            free(b);
+        } else
+            p = &b->next;
+    }
+}
+
+/* Gives the layer new content of the size of its frame */
+static int new_content(struct layer *l)
+{
+    int width = l->frame.right - l->frame.left;
+    int height = l->frame.bottom - l->frame.top;
+    /* The crop sits anywhere in a bigger buffer */
+    int left = rand_range(0, 8);
+    int top = rand_range(0, 8);
+    int format = rand() % 2 ? HAL_PIXEL_FORMAT_RGBA_8888 : HAL_PIXEL_FORMAT_RGBX_8888;
+
+    l->buffer = new_buffer(left + width + rand_range(0, 8), top + height + rand_range(0, 8), format);
+    if (!l->buffer)
+        return -1;
+    l->crop.left = left;
+    l->crop.top = top;
+    l->crop.right = left + width;
+    l->crop.bottom = top + height;
+    return 0;
+}
+
+/* Frames may hang off the screen */
+static void move_layer(struct layer *l)
+{
+    int width = l->frame.right - l->frame.left;
+    int height = l->frame.bottom - l->frame.top;
+
+    l->frame.left = rand_range(-width / 2, SCREEN_WIDTH - width / 2);
+    l->frame.top = rand_range(-height / 2, SCREEN_HEIGHT - height / 2);
+    l->frame.right = l->frame.left + width;
+    l->frame.bottom = l->frame.top + height;
+}
+
+static int new_layer(struct layer *l)
+{
+    int r = rand() % 16;
+
+    memset(l, 0, sizeof(*l));
+    l->type = r == 0 ? LAYER_CLEAR : r == 1 ? LAYER_OVERLAY : LAYER_BLIT;
+    /* Clear fb layers have no content the regionizer would look at */
+    l->blending = l->type == LAYER_BLIT && rand() % 3 ? HWC_BLENDING_PREMULT : HWC_BLENDING_NONE;
+
+    if (rand() % 4 == 0) {
+        /* Full screen, e.g. a wallpaper */
+        l->frame.right = SCREEN_WIDTH;
+        l->frame.bottom = SCREEN_HEIGHT;
+    } else {
+        l->frame.right = rand_range(1, SCREEN_WIDTH);
+        l->frame.bottom = rand_range(1, SCREEN_HEIGHT);
+        move_layer(l);
+    }
+    return new_content(l);
+}
+
+/* Changes the layers the way a UI does between two frames */
+static int next_frame(void)
+{
+    int i;
+
+    if (!num_layers || rand() % 32 == 0) {
+        num_layers = rand_range(1, max_layers);
+        for (i = 0; i < num_layers; i++) {
+            if (new_layer(&layers[i]))
+                return -1;
+        }
+        return 0;
+    }
+
+    if (num_layers < max_layers && rand() % 16 == 0) {
+        int z = rand_range(0, num_layers);
+        memmove(&layers[z + 1], &layers[z], (num_layers - z) * sizeof(layers[0]));
+        num_layers++;
+        if (new_layer(&layers[z]))
+            return -1;
+    }
+    if (num_layers > 1 && rand() % 16 == 0) {
+        int z = rand_range(0, num_layers - 1);
+        num_layers--;
+        memmove(&layers[z], &layers[z + 1], (num_layers - z) * sizeof(layers[0]));
+    }
+
+    for (i = 0; i < num_layers; i++) {
+        struct layer *l = &layers[i];
+        int r = rand() % 32;
+
+        if (r < 2) {
+            move_layer(l);
+        } else if (r < 3) {
+            l->frame.right = l->frame.left + rand_range(1, SCREEN_WIDTH);
+            l->frame.bottom = l->frame.top + rand_range(1, SCREEN_HEIGHT);
+            if (new_content(l))
+                return -1;
+        } else if (r < 10) {
+            if (new_content(l))
+                return -1;
+        }
+    }
+    return 0;
+}
+
+static void get_hwc_layers(hwc_layer_1_t *hwc_layers)
+{
+    int i;
+
+    memset(hwc_layers, 0, num_layers * sizeof(*hwc_layers));
+    for (i = 0; i < num_layers; i++) {
+        struct layer *l = &layers[i];
+        hwc_layer_1_t *h = &hwc_layers[i];
+
+        h->compositionType = l->type == LAYER_BLIT ? HWC_FRAMEBUFFER : HWC_OVERLAY;
+        h->hints = l->type == LAYER_CLEAR ? HWC_HINT_CLEAR_FB : 0;
+        h->handle = (buffer_handle_t)&l->buffer->handle;
+        h->blending = l->blending;
+        h->sourceCrop = l->crop;
+        h->displayFrame = l->frame;
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+        h->planeAlpha = 0xFF;
+#endif
+        h->acquireFenceFd = h->releaseFenceFd = -1;
+        l->buffer->last_frame = frame;
+    }
+}
+
+/* The regionizer only blits layers of its hwc layer array */
+static int get_buffdesc(void *data, buffer_handle_t handle, struct bvbuffdesc *desc)
+{
+    struct buffer *b = (struct buffer *)handle;
+
+    desc->virtaddr = b->pixels;
+    desc->length = b->stride * b->handle.iHeight * sizeof(uint32_t);
+    return 0;
+}
+
+/* gcbvfill, counted */
+static enum bverror count_fill(struct bvbltparams *bp, unsigned int count, const struct bvrect *rects)
+{
+    stats.fills++;
+    return cpu_fill(bp, count, rects);
+}
+
+/* Paints the layers back to front, like SGX would */
+static void compose_reference(void)
+{
+    int stride = fbgeom.virtstride / 4;
+    int i, x, y;
+
+    /* Transparent black, like the clears, in the layout of the layer pixels */
+    memset(reference, 0, fbgeom.virtstride * fbgeom.height);
+    for (i = 0; i < num_layers; i++) {
+        struct layer *l = &layers[i];
+        struct buffer *b = l->buffer;
+
+        if (l->type == LAYER_OVERLAY)
+            continue;
+
+        for (y = l->frame.top; y < l->frame.bottom; y++) {
+            if (y < 0 || y >= SCREEN_HEIGHT)
+                continue;
+            for (x = l->frame.left; x < l->frame.right; x++) {
+                if (x < 0 || x >= SCREEN_WIDTH)
+                    continue;
+                uint32_t *dst = &reference[y * stride + x];
+                if (l->type == LAYER_CLEAR) {
+                    *dst = 0;
+                    continue;
+                }
+
+                uint32_t src = b->pixels[(l->crop.top + y - l->frame.top) * b->stride +
+                                         l->crop.left + x - l->frame.left];
+                if (b->handle.iFormat == HAL_PIXEL_FORMAT_RGBX_8888)
+                    src |= 0xFF000000;
+                *dst = l->blending == HWC_BLENDING_PREMULT ? blend(src, *dst) : src;
+            }
+        }
+    }
+}
+
+/* Returns the number of pixels differing from the reference */
+static int compare(const char *mode, struct bvbuffdesc *desc)
+{
+    int stride = fbgeom.virtstride / 4;
+    int mismatches = 0;
+    int x, y, first_x = 0, first_y = 0;
+
+    for (y = 0; y < SCREEN_HEIGHT; y++) {
+        for (x = 0; x < SCREEN_WIDTH; x++) {
+            if (get_pixel(desc, &fbgeom, x, y) == reference[y * stride + x])
+                continue;
+            if (!mismatches++) {
+                first_x = x;
+                first_y = y;
+            }
+        }
+    }
+
+    if (mismatches && stats.failures < MAX_PRINTED_FAILURES)
+        printf("frame %d: %s composition differs in %d pixels, first at (%d,%d): %08x instead of %08x\n",
+               frame, mode, mismatches, first_x, first_y,
+               get_pixel(desc, &fbgeom, first_x, first_y), reference[first_y * stride + first_x]);
+    return mismatches;
+}
+
+static void print_layers(void)
+{
+    static const char *types[] = { "blit", "clear", "overlay" };
+    int i;
+
+    for (i = 0; i < num_layers; i++) {
+        struct layer *l = &layers[i];
+        printf("  %d: %s %s %s crop (%d,%d)-(%d,%d) frame (%d,%d)-(%d,%d)\n", i, types[l->type],
+               l->buffer->handle.iFormat == HAL_PIXEL_FORMAT_RGBX_8888 ? "RGBX" : "RGBA",
+               l->blending == HWC_BLENDING_PREMULT ? "premult" : "none",
+               l->crop.left, l->crop.top, l->crop.right, l->crop.bottom,
+               l->frame.left, l->frame.top, l->frame.right, l->frame.bottom);
+    }
+}
+
+static int alloc_fb(struct bvbuffdesc *desc)
+{
+    desc->structsize = sizeof(*desc);
+    desc->length = fbgeom.virtstride * fbgeom.height;
+    desc->virtaddr = calloc(1, desc->length);
+    return desc->virtaddr ? 0 : -1;
+}
+
+static long long cpu_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * Regionizes the layers and generates the blits like the HWC, timing both.
+ * Returns RGZ_ALL, 0 if the layers can't be blitted or -1 on failure.
+ */
+static int regionize(rgz_t *rgz, hwc_layer_1_t *hwc_layers, int layerno, int flags)
+{
+    rgz_in_params_t in = {
+        .op = RGZ_IN_HWC,
+        .data = {
+            .hwc = {
+                .flags = flags,
+                .layerno = layerno,
+                .layers = hwc_layers,
+                .dstgeom = &fbgeom,
+            }
+        }
+    };
+    rgz_out_params_t out = {
+        .op = RGZ_OUT_BVCMD_REGION,
+        .data = {
+            .bvc = {
+                .dstgeom = &fbgeom,
+            }
+        }
+    };
+    long long start = cpu_time_ns();
+    int rv = rgz_in(&in, rgz);
+    long long mid = cpu_time_ns();
+
+    if (rv != RGZ_ALL) {
+        stats.rejected++;
+        return 0;
+    }
+    if (rgz_out(rgz, &out)) {
+        printf("frame %d: generating the blits failed\n", frame);
+        return -1;
+    }
+    stats.in_ns += mid - start;
+    stats.out_ns += cpu_time_ns() - mid;
+    stats.regionized++;
+    stats.reused += rgz->reused;
+    stats.region_blits += out.data.bvc.out_blits;
+    stats.saved_blits += out.data.bvc.out_saved_blits;
+    return RGZ_ALL;
+}
+
+/* trash overwrites the framebuffer the next frame is blitted into */
+static int run_frame(rgz_t *rgz, bool trash)
+{
+    hwc_layer_1_t hwc_layers[MAX_LAYERS];
+    /* Until a frame is blitted into the trashed destination */
+    static bool redraw;
+    bool use_fill = rand() % 2;
+    int rv;
+
+    get_hwc_layers(hwc_layers);
+
+    /* A destination not holding the frame from RGZ_NUM_FB frames ago */
+    if (!redraw && trash) {
+        memset(shadows[(rgz->fb_state_idx + 1) % RGZ_NUM_FB].virtaddr, 0x5A, fbgeom.virtstride * fbgeom.height);
+        redraw = true;
+    }
+
+    rv = regionize(rgz, hwc_layers, num_layers, redraw ? RGZ_IN_HWC_REDRAW : 0);
+    if (rv < 0)
+        return -1;
+    if (rv != RGZ_ALL) {
+        /* Only stacks without anything to blit are rejected */
+        int i;
+        for (i = 0; i < num_layers; i++) {
+            if (layers[i].type != LAYER_OVERLAY) {
+                printf("frame %d: regionizer rejected the layers\n", frame);
+                return -1;
+            }
+        }
+        return 0;
+    }
+    redraw = false;
+
+    rgz_out_params_t region = {
+        .op = RGZ_OUT_BVDIRECT_REGION,
+        .data = {
+            .bv = {
+                .dstdesc = &shadows[rgz->fb_state_idx],
+                .dstgeom = &fbgeom,
+                .bv_blt = cpu_blt,
+                .bv_fill = use_fill ? count_fill : NULL,
+                .get_buffdesc = get_buffdesc,
+            }
+        }
+    };
+    if (rgz_out(rgz, &region)) {
+        printf("frame %d: region blits failed\n", frame);
+        return -1;
+    }
+
+    rgz_out_params_t paint = region;
+    paint.op = RGZ_OUT_BVDIRECT_PAINT;
+    paint.data.bv.dstdesc = &paint_fb;
+    if (rgz_out(rgz, &paint)) {
+        printf("frame %d: paint blits failed\n", frame);
+        return -1;
+    }
+
+    stats.frames++;
+    stats.paint_blits += paint.data.bv.out_blits;
+
+    compose_reference();
+    if (compare("region", region.data.bv.dstdesc) + compare("paint", paint.data.bv.dstdesc)) {
+        if (stats.failures++ < MAX_PRINTED_FAILURES)
+            print_layers();
+    }
+    return 0;
+}
+
+/*
+ * The region data is kept while only the buffer contents change, and rebuilt
+ * once a layer moves. Damage tracking needs RGZ_NUM_FB frames to settle.
+ */
+static int check_geometry_cache(rgz_t *rgz)
+{
+    static const struct {
+        bool move;
+        int reused;             /* -1 for either */
+    } steps[] = {
+        { false, 0 }, { false, -1 }, { false, -1 }, { false, 1 }, { false, 1 },
+        { true, 0 }, { false, -1 }, { false, -1 }, { false, 1 },
+    };
+    unsigned int i;
+    int j;
+
+    num_layers = 4;
+    for (j = 0; j < num_layers; j++) {
+        if (new_layer(&layers[j]))
+            return -1;
+        layers[j].type = LAYER_BLIT;
+    }
+
+    for (i = 0; i < sizeof(steps) / sizeof(steps[0]); i++, frame++) {
+        for (j = 0; j < num_layers; j++) {
+            if (new_content(&layers[j]))
+                return -1;
+        }
+        if (steps[i].move) {
+            layers[1].frame.left++;
+            layers[1].frame.right++;
+        }
+        if (run_frame(rgz, false))
+            return -1;
+        free_buffers(false);
+
+        if (steps[i].reused != -1 && rgz->reused != steps[i].reused) {
+            printf("frame %d: region data %s\n", frame,
+                   rgz->reused ? "reused after a layer moved" : "rebuilt while only contents changed");
+            print_layers();
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Two windows side by side over a wallpaper, the shorter one splits the
+ * taller one in three hregions which merge back into a single blit
+ */
+static int check_coalescing(rgz_t *rgz)
+{
+    long long saved_blits = stats.saved_blits;
+    int i;
+
+    num_layers = 3;
+    for (i = 0; i < num_layers; i++) {
+        memset(&layers[i], 0, sizeof(layers[i]));
+        layers[i].type = LAYER_BLIT;
+        layers[i].blending = i ? HWC_BLENDING_PREMULT : HWC_BLENDING_NONE;
+    }
+    layers[0].frame.right = SCREEN_WIDTH;
+    layers[0].frame.bottom = SCREEN_HEIGHT;
+    layers[1].frame.left = SCREEN_WIDTH / 8;
+    layers[1].frame.top = SCREEN_HEIGHT / 8;
+    layers[1].frame.right = SCREEN_WIDTH * 3 / 8;
+    layers[1].frame.bottom = SCREEN_HEIGHT * 7 / 8;
+    layers[2].frame.left = SCREEN_WIDTH * 5 / 8;
+    layers[2].frame.top = SCREEN_HEIGHT * 3 / 8;
+    layers[2].frame.right = SCREEN_WIDTH * 7 / 8;
+    layers[2].frame.bottom = SCREEN_HEIGHT * 5 / 8;
+
+    /* Redraw the whole screen so every subregion is blitted */
+    for (i = 0; i < num_layers; i++) {
+        if (new_content(&layers[i]))
+            return -1;
+    }
+    if (run_frame(rgz, true))
+        return -1;
+    free_buffers(false);
+    frame++;
+
+    if (stats.saved_blits == saved_blits) {
+        printf("frame %d: no subregions merged\n", frame - 1);
+        print_layers();
+        return -1;
+    }
+    return 0;
+}
+
+/* More layers than the regionizer used to store, each blitted a few frames */
+static int check_many_layers(rgz_t *rgz)
+{
+    int failures = stats.failures;
+    int i, j;
+
+    num_layers = MANY_LAYERS;
+    for (i = 0; i < num_layers; i++) {
+        if (new_layer(&layers[i]))
+            return -1;
+        layers[i].type = LAYER_BLIT;
+    }
+    for (i = 0; i < RGZ_NUM_FB + 1; i++, frame++) {
+        for (j = 0; j < num_layers; j += 2) {
+            if (new_content(&layers[j]))
+                return -1;
+        }
+        if (run_frame(rgz, false))
+            return -1;
+        free_buffers(false);
+    }
+    return stats.failures == failures ? 0 : -1;
+}
+
+/* Buffer attributes of each handle of a trace, the addresses stand for the handles */
+static IMG_native_handle_t *trace_handle(uint64_t id, struct hwc_trace_layer *t)
+{
+    static struct {
+        uint64_t id;
+        IMG_native_handle_t *handle;
+    } *handles;
+    static int num_handles;
+    IMG_native_handle_t *h = NULL;
+    int i;
+
+    for (i = 0; i < num_handles && !h; i++) {
+        if (handles[i].id == id)
+            h = handles[i].handle;
+    }
+    if (!h) {
+        void *p = realloc(handles, (num_handles + 1) * sizeof(*handles));
+        if (!p)
+            return NULL;
+        handles = p;
+        h = calloc(1, sizeof(*h));
+        if (!h)
+            return NULL;
+        handles[num_handles].id = id;
+        handles[num_handles++].handle = h;
+    }
+
+    h->iFormat = t->format;
+    h->iWidth = t->width;
+    h->iHeight = t->height;
+    h->usage = t->usage;
+    return h;
+}
+
+static void to_hwc_rect(hwc_rect_t *r, struct hwc_trace_rect *t)
+{
+    r->left = t->left;
+    r->top = t->top;
+    r->right = t->right;
+    r->bottom = t->bottom;
+}
+
+static int replay(rgz_t *rgz, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    struct hwc_trace_header header;
+    struct hwc_trace_call call;
+    struct hwc_trace_layer *trace_layers = NULL;
+    hwc_layer_1_t *hwc_layers = NULL;
+    uint32_t size = 0, i;
+    int prepares = 0;
+    int rv = -1;
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        header.magic != HWC_TRACE_MAGIC || header.version != HWC_TRACE_VERSION) {
+        printf("%s: not a version %d HWC trace\n", path, HWC_TRACE_VERSION);
+        goto out;
+    }
+    fbgeom.width = header.fb_width;
+    fbgeom.height = header.fb_height;
+    fbgeom.virtstride = ALIGN(header.fb_width, HW_ALIGN) * 4;
+
+    while (fread(&call, sizeof(call), 1, f) == 1) {
+        if (call.num_layers > size) {
+            void *p = realloc(trace_layers, call.num_layers * sizeof(*trace_layers));
+            if (!p)
+                goto out;
+            trace_layers = p;
+            p = realloc(hwc_layers, call.num_layers * sizeof(*hwc_layers));
+            if (!p)
+                goto out;
+            hwc_layers = p;
+            size = call.num_layers;
+        }
+        if (fread(trace_layers, sizeof(*trace_layers), call.num_layers, f) != call.num_layers ||
+            fseek(f, call.num_ovls * sizeof(struct hwc_trace_ovl) +
+                     call.num_blits * sizeof(struct hwc_trace_blit), SEEK_CUR)) {
+            printf("%s: truncated\n", path);
+            goto out;
+        }
+        if (call.type != HWC_TRACE_PREPARE)
+            continue;
+
+        memset(hwc_layers, 0, call.num_layers * sizeof(*hwc_layers));
+        for (i = 0; i < call.num_layers; i++) {
+            struct hwc_trace_layer *t = &trace_layers[i];
+            hwc_layer_1_t *l = &hwc_layers[i];
+
+            /* Layers on a DSS pipe have the triple buffer hint */
+            if (t->compositionType == HWC_FRAMEBUFFER_TARGET)
+                l->compositionType = HWC_FRAMEBUFFER_TARGET;
+            else if (t->compositionType == HWC_OVERLAY && (t->hints & HWC_HINT_TRIPLE_BUFFER))
+                l->compositionType = HWC_OVERLAY;
+            else
+                l->compositionType = HWC_FRAMEBUFFER;
+            l->hints = t->hints;
+            l->flags = t->flags;
+            if (t->handle) {
+                l->handle = (buffer_handle_t)trace_handle(t->handle, t);
+                if (!l->handle)
+                    goto out;
+            }
+            l->transform = t->transform;
+            l->blending = t->blending;
+            to_hwc_rect(&l->sourceCrop, &t->sourceCrop);
+            to_hwc_rect(&l->displayFrame, &t->displayFrame);
+#ifdef OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+            l->planeAlpha = 0xFF;
+#endif
+            l->acquireFenceFd = l->releaseFenceFd = -1;
+        }
+
+        prepares++;
+        if (regionize(rgz, hwc_layers, call.num_layers, 0) < 0)
+            goto out;
+        frame++;
+    }
+    printf("%s: %d prepares\n", path, prepares);
+    rv = 0;
+
+out:
+    free(trace_layers);
+    free(hwc_layers);
+    fclose(f);
+    return rv;
+}
+
+static void print_timing(void)
+{
+    printf("%d frames regionized, %d rejected, region data reused in %d (%d%%)\n",
+           stats.regionized, stats.rejected, stats.reused,
+           stats.regionized ? stats.reused * 100 / stats.regionized : 0);
+    if (!stats.regionized)
+        return;
+    printf("region %lld blits per 100 frames, %lld without merging subregions\n",
+           stats.region_blits * 100 / stats.regionized,
+           (stats.region_blits + stats.saved_blits) * 100 / stats.regionized);
+    printf("rgz_in %lld us, rgz_out %lld us per frame\n",
+           stats.in_ns / 1000 / stats.regionized, stats.out_ns / 1000 / stats.regionized);
+}
+
+int main(int argc, char **argv)
+{
+    rgz_t rgz;
+    unsigned int seed = 1;
+    int frames = DEFAULT_FRAMES;
+    const char *trace = NULL;
+    int opt, i;
+    int rv = 0;
+
+    while ((opt = getopt(argc, argv, "s:n:l:r:")) != -1) {
+        switch (opt) {
+        case 's':
+            seed = strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            frames = atoi(optarg);
+            break;
+        case 'l':
+            max_layers = atoi(optarg);
+            if (max_layers < 1 || max_layers > MAX_LAYERS) {
+                fprintf(stderr, "%s: 1 to %d layers\n", argv[0], MAX_LAYERS);
+                return 2;
+            }
+            break;
+        case 'r':
+            trace = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-s <seed>] [-n <frames>] [-l <layers>] | -r <trace>\n", argv[0]);
+            return 2;
+        }
+    }
+    srand(seed);
+
+    memset(&rgz, 0, sizeof(rgz));
+    memset(&fbgeom, 0, sizeof(fbgeom));
+    fbgeom.structsize = sizeof(fbgeom);
+    /* The framebuffer is BGRA_8888 on the devices, the layers RGBA_8888 */
+    fbgeom.format = OCDFMT_BGRA24;
+    fbgeom.width = SCREEN_WIDTH;
+    fbgeom.height = SCREEN_HEIGHT;
+    fbgeom.virtstride = (SCREEN_WIDTH + SCREEN_PAD) * 4;
+
+    if (trace) {
+        rv = replay(&rgz, trace);
+        print_timing();
+        rgz_release(&rgz);
+        return rv ? 1 : 0;
+    }
+
+    for (i = 0; i < RGZ_NUM_FB; i++) {
+        if (alloc_fb(&shadows[i]))
+            return 1;
+    }
+    reference = malloc(fbgeom.virtstride * fbgeom.height);
+    if (alloc_fb(&paint_fb) || !reference)
+        return 1;
+
+    if (check_geometry_cache(&rgz) || check_coalescing(&rgz) || check_many_layers(&rgz))
+        rv = 1;
+
+    for (; !rv && frame < frames; frame++) {
+        if (next_frame()) {
+            printf("out of memory\n");
+            rv = 1;
+            break;
+        }
+        if (run_frame(&rgz, rand() % 64 == 0)) {
+            print_layers();
+            rv = 1;
+            break;
+        }
+        free_buffers(false);
+    }
+
+    printf("%s: %d frames, %d mismatching\n",
+           rv || stats.failures ? "FAIL" : "PASS", stats.frames, stats.failures);
+    if (stats.frames)
+        printf("paint %lld blits per 100 frames, %d fills\n",
+               stats.paint_blits * 100 / stats.frames, stats.fills);
+    print_timing();
+
+    rgz_release(&rgz);
+    free_buffers(true);
+    for (i = 0; i < RGZ_NUM_FB; i++)
+        free(shadows[i].virtaddr);
+    free(paint_fb.virtaddr);
+    free(reference);
+    return rv || stats.failures ? 1 : 0;
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host test of the composition statistics of hwc_dump
+ *
+ * Feeds known timings, posts and vsyncs to hwc_stats.c and checks the
+ * figures of the dump, including samples recorded from several threads at
+ * once and a dump into a buffer too small for it. Also times the statistics
+ * hwc_prepare, hwc_set and the vsync thread record for every frame.
+ *
+ * Returns 0 when every case passes.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <utils/Timers.h>
+
+#include "../hwc_stats.h"
+
+#define PERIOD 16666667
+#define THREADS 4
+#define THREAD_SAMPLES 100000
+#define TIMED_FRAMES 1000000
+#define SMALL_DUMP 64
+#define GUARD_SIZE 4096
+#define GUARD_BYTE 0xA5
+
+static char dump[4096];
+static char small[SMALL_DUMP + GUARD_SIZE];
+static int failures;
+
+static void check(bool ok, const char *what)
+{
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+    failures += !ok;
+}
+
+struct timing {
+    unsigned int count, p50, p99, max;
+    unsigned long long avg;
+};
+
+/* Parses the dump line of a timing, returns false if there is none */
+static bool get_timing(const char *name, struct timing *t)
+{
+    char *line;
+
+    hwc_stats_dump(dump, sizeof(dump));
+    line = strstr(dump, name);
+    return line && sscanf(line + strlen(name), "%u %llu %u %u %u",
+                          &t->count, &t->avg, &t->p50, &t->p99, &t->max) == 5;
+}
+
+static void *record_loop(void *data)
+{
+    int i;
+
+    for (i = 0; i < THREAD_SAMPLES; i++)
+        hwc_stats_record(HWC_STAT_SET, us2ns(1 + (i & 1023)));
+    return NULL;
+}
+
+int main(void)
+{
+    struct timing t;
+    pthread_t threads[THREADS];
+    unsigned int ovl, sgx, blit, switches, missed;
+    unsigned long long blits, unmerged;
+    char *line;
+    nsecs_t now, start;
+    bool overrun = false;
+    int i, len;
+
+    hwc_stats_init(PERIOD);
+    check(!hwc_stats_showfps(), "fps not shown by default");
+    check(!get_timing("prepare", &t), "no timing before the first sample");
+
+    /* 98 frames of 100us and 2 of 5ms */
+    for (i = 0; i < 100; i++)
+        hwc_stats_record(HWC_STAT_PREPARE, us2ns(i < 98 ? 100 : 5000));
+    check(get_timing("prepare", &t) && t.count == 100 && t.avg == 198 &&
+          t.p50 == 128 && t.p99 == 5000 && t.max == 5000,
+          "prepare count, average, percentile bounds and max");
+
+    /* Posts 1, 1 and 3 periods apart, then after an idle second */
+    now = s2ns(10);
+    hwc_stats_post(now, HWC_STATS_MODE_OVL);
+    hwc_stats_vsync(now + ms2ns(3));
+    hwc_stats_vsync(now + ms2ns(3) + PERIOD);
+    now += PERIOD;
+    hwc_stats_post(now, HWC_STATS_MODE_OVL);
+    now += PERIOD;
+    hwc_stats_post(now, HWC_STATS_MODE_SGX);
+    now += 3 * PERIOD;
+    hwc_stats_post(now, HWC_STATS_MODE_BLIT);
+    now += s2ns(1);
+    hwc_stats_post(now, HWC_STATS_MODE_BLIT);
+    hwc_stats_blits(10, 4);
+
+    hwc_stats_dump(dump, sizeof(dump));
+    line = strstr(dump, "frames:");
+    check(line && sscanf(line, "frames: %u all-OVL, %u SGX+OVL, %u blit, %u composition switches, %u missed vsyncs",
+                         &ovl, &sgx, &blit, &switches, &missed) == 5 &&
+          ovl == 2 && sgx == 1 && blit == 2 && switches == 2 && missed == 2,
+          "frames per composition, switches and missed vsyncs without idle time");
+    line = strstr(dump, "blits:");
+    check(line && sscanf(line, "blits: %llu, %llu before merging", &blits, &unmerged) == 2 &&
+          blits == 10 && unmerged == 14, "blits before and after merging");
+    check(get_timing("frame interval", &t) && t.count == 4 && t.max == 1000000, "frame intervals");
+    check(get_timing("post to vsync", &t) && t.count == 1 && t.max == 3000,
+          "post to the following vsync only");
+
+    /* Concurrent samples */
+    for (i = 0; i < THREADS; i++)
+        pthread_create(&threads[i], NULL, record_loop, NULL);
+    for (i = 0; i < THREADS; i++)
+        pthread_join(threads[i], NULL);
+    check(get_timing("set", &t) && t.count == THREADS * THREAD_SAMPLES && t.max == 1024 &&
+          t.avg == (THREADS * (THREAD_SAMPLES / 1024) * 1024ULL * 1025 / 2 +
+                    THREADS * (THREAD_SAMPLES % 1024) * (THREAD_SAMPLES % 1024 + 1ULL) / 2) /
+                   (THREADS * THREAD_SAMPLES),
+          "samples of concurrent threads all counted");
+
+    /* A dump larger than the buffer */
+    len = hwc_stats_dump(dump, sizeof(dump));
+    memset(small, GUARD_BYTE, sizeof(small));
+    check(hwc_stats_dump(small, SMALL_DUMP) == len, "truncated dump returns the full length");
+    for (i = SMALL_DUMP; i < SMALL_DUMP + GUARD_SIZE; i++)
+        overrun = overrun || (unsigned char)small[i] != GUARD_BYTE;
+    check(strlen(small) == SMALL_DUMP - 1 && !strncmp(small, dump, SMALL_DUMP - 1) && !overrun,
+          "truncated dump within the buffer");
+
+    /* Statistics of a frame */
+    start = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (i = 0; i < TIMED_FRAMES; i++) {
+        now += PERIOD;
+        hwc_stats_record(HWC_STAT_PREPARE, us2ns(i & 2047));
+        hwc_stats_record(HWC_STAT_SET, us2ns(i & 4095));
+        hwc_stats_post(now, i & 16 ? HWC_STATS_MODE_OVL : HWC_STATS_MODE_SGX);
+        hwc_stats_vsync(now + ms2ns(5));
+    }
+    printf("%lld ns per frame for prepare, set, post and vsync\n",
+           (long long)(systemTime(SYSTEM_TIME_MONOTONIC) - start) / TIMED_FRAMES);
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,1203 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host test and benchmark of the virtual display composition
+ *
+ *   vd_test [-s <seed>] [-n <frames>]
+ *
+ * Random layer stacks go through virtual_display_prepare and
+ * virtual_display_set frame after frame, into output buffers rotating like
+ * the ones of a BufferQueue, and every blitted frame is compared pixel by
+ * pixel with the framebuffer target and the blitted layers composed back to
+ * front by the test itself. Some layers are skipped so GLES composes them,
+ * and some come with fences their producer signals after hwc_set.
+ *
+ * gralloc, the BLTsville libraries, the fences and the s/w sync timeline of
+ * libsync are stubbed. Both libraries blit with the minimal CPU BLTsville of
+ * bv_cpu.h; libbltsville_hw2d also has the gcbvfill and gcbvfence entry
+ * points, and only completes its batches some time after they are submitted,
+ * as if the 2D core was running them.
+ *
+ * The frames are composed in hwc_set with libbltsville_cpu, then behind
+ * fences with libbltsville_cpu and with libbltsville_hw2d. Fixed frames check
+ * that hwc_set returns before the producers signal the layers and the retire
+ * fence waits for them, that a frame left to GLES retires with its
+ * framebuffer target, that a frame whose blits fail is followed by a correct
+ * one and that the buffers stay locked while hw2d takes longer than the fence
+ * timeout. No buffer may be unlocked while hw2d still runs the blits, and no
+ * fence may be leaked. While a frame is composed the test regionizes the
+ * layers of a primary display, whose blit list must not change under it.
+ *
+ * Reports the time hwc_set takes and the compose time of the display, from
+ * virtual_display_dump, in each mode.
+ *
+ * Returns 0 when every case passes.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <linux/types.h>
+
+#include <hardware/hardware.h>
+#include <sync/sync.h>
+
+#include "../hwc_dev.h"
+#include "../virtual_display.h"
+#include "gcbvext.h"
+#include "bv_cpu.h"
+
+#define VD_DISP HWC_DISPLAY_VIRTUAL
+/* Narrower than the aligned stride, so the lines are padded */
+#define VD_WIDTH 80
+#define VD_HEIGHT 48
+
+#define MAX_LAYERS 8
+#define NUM_OUTBUFS 3
+#define DEFAULT_FRAMES 300
+
+/* Completion time of the hw2d batches of the random frames */
+#define HW_DELAY_US 200
+/* Longer than the FENCE_TIMEOUT_MS of virtual_display.c */
+#define SLOW_BLIT_MS 1500
+/* How long a frame may take to retire before it counts as lost */
+#define RETIRE_TIMEOUT_MS 5000
+
+#define MAX_TIMELINE_FENCES 16
+#define MAX_HW_BATCHES 256
+
+/* Mismatching frames printed before only counting them */
+#define MAX_PRINTED_FAILURES 10
+
+struct buffer {
+    IMG_native_handle_t handle;
+    uint32_t *pixels;
+    int stride;                 /* pixels */
+    int locks;
+    int last_frame;             /* last frame the buffer was shown in */
+    struct buffer *next;
+};
+
+struct layer {
+    struct buffer *buffer;
+    hwc_rect_t crop;
+    hwc_rect_t frame;
+    int32_t blending;
+    bool skip;                  /* composed by GLES */
+};
+
+static struct buffer *buffers;
+static struct layer layers[MAX_LAYERS];
+static int num_layers;
+static struct buffer *fb_buffer;
+static struct buffer *outbufs[NUM_OUTBUFS];
+static uint32_t reference[VD_WIDTH * VD_HEIGHT];
+static int frame;
+
+static omap_hwc_device_t hwc_dev;
+static hwc_display_contents_1_t *list;
+
+static int failures;
+static int printed_failures;
+
+/* Stub settings of the current mode */
+static bool have_hw2d;
+static bool have_timeline;
+static long long hw_delay_ns;
+static int fail_blits;          /* blits failing from now on */
+
+/*
+ * State of the stubs, the composition thread uses them while the test waits
+ * for the retire fence
+ */
+static pthread_mutex_t stub_lock = PTHREAD_MUTEX_INITIALIZER;
+static int busy_unlocks;        /* buffers unlocked while hw2d still blits */
+static int timeline = -1;
+static unsigned timeline_value;
+static struct {
+    unsigned value;
+    int signal;
+} timeline_fences[MAX_TIMELINE_FENCES];
+static int timeline_pending;
+
+/* hw2d batches in submission order, the 2D core runs them one after the other */
+static struct {
+    long long done;
+    BVFN_GCFENCE_SIGNAL callbackfn;
+    unsigned long callbackdata;
+} hw_batches[MAX_HW_BATCHES];
+static int hw_queued;
+static long long hw_busy_until;
+static int hw_completed;        /* batches the fence counts and wasn't read for */
+
+static void check(bool ok, const char *what)
+{
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+    failures += !ok;
+}
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void sleep_ns(long long ns)
+{
+    struct timespec ts = { ns / 1000000000LL, ns % 1000000000LL };
+
+    if (ns > 0)
+        while (nanosleep(&ts, &ts) && errno == EINTR)
+            ;
+}
+
+/* ---- fences: pipes that become readable once signalled ---- */
+
+static int new_fence(int *signal)
+{
+    int fds[2];
+
+    if (pipe(fds))
+        return -1;
+    *signal = fds[1];
+    return fds[0];
+}
+
+static void signal_fence(int *signal)
+{
+    char c = 0;
+
+    if (*signal < 0)
+        return;
+    /* The consumer may have closed the fence already, see main() */
+    if (write(*signal, &c, 1) != 1 && errno != EPIPE)
+        perror("signal_fence");
+    close(*signal);
+    *signal = -1;
+}
+
+int sync_wait(int fd, int timeout)
+{
+    struct pollfd p = { .fd = fd, .events = POLLIN };
+    int ret = poll(&p, 1, timeout);
+
+    if (ret > 0)
+        return 0;
+    if (!ret)
+        errno = ETIME;
+    return -1;
+}
+
+static bool signalled(int fd)
+{
+    return !sync_wait(fd, 0);
+}
+
+int sw_sync_timeline_create(void)
+{
+    if (!have_timeline) {
+        errno = ENOENT;
+        return -1;
+    }
+    pthread_mutex_lock(&stub_lock);
+    timeline_value = 0;
+    timeline = open("/dev/null", O_RDONLY);
+    pthread_mutex_unlock(&stub_lock);
+    return timeline;
+}
+
+int sw_sync_timeline_inc(int fd, unsigned count)
+{
+    int i;
+
+    pthread_mutex_lock(&stub_lock);
+    timeline_value += count;
+    for (i = 0; i < timeline_pending; ) {
+        if (timeline_fences[i].value <= timeline_value) {
+            signal_fence(&timeline_fences[i].signal);
+            timeline_fences[i] = timeline_fences[--timeline_pending];
+        } else {
+            i++;
+        }
+    }
+    pthread_mutex_unlock(&stub_lock);
+    return fd == timeline ? 0 : -EINVAL;
+}
+
+int sw_sync_fence_create(int fd, const char *name, unsigned value)
+{
+    int fence, signal;
+
+    if (fd != timeline)
+        return -EINVAL;
+
+    pthread_mutex_lock(&stub_lock);
+    fence = new_fence(&signal);
+    if (fence >= 0) {
+        if (value <= timeline_value) {
+            signal_fence(&signal);
+        } else if (timeline_pending < MAX_TIMELINE_FENCES) {
+            timeline_fences[timeline_pending].value = value;
+            timeline_fences[timeline_pending++].signal = signal;
+        } else {
+            close(signal);
+            close(fence);
+            fence = -ENOMEM;
+        }
+    }
+    pthread_mutex_unlock(&stub_lock);
+    return fence;
+}
+
+/* ---- gralloc ---- */
+
+static int gralloc_lock(struct gralloc_module_t const *module, buffer_handle_t handle, int usage,
+                        int l, int t, int w, int h, void **vaddr)
+{
+    struct buffer *b = (struct buffer *)handle;
+
+    pthread_mutex_lock(&stub_lock);
+    b->locks++;
+    pthread_mutex_unlock(&stub_lock);
+    *vaddr = b->pixels;
+    return 0;
+}
+
+static int gralloc_unlock(struct gralloc_module_t const *module, buffer_handle_t handle)
+{
+    struct buffer *b = (struct buffer *)handle;
+
+    pthread_mutex_lock(&stub_lock);
+    b->locks--;
+    busy_unlocks += hw_busy_until > now_ns();
+    pthread_mutex_unlock(&stub_lock);
+    return 0;
+}
+
+static gralloc_module_t gralloc_module = {
+    .common = {
+        .id = GRALLOC_HARDWARE_MODULE_ID,
+        .name = "vd_test gralloc",
+    },
+    .lock = gralloc_lock,
+    .unlock = gralloc_unlock,
+};
+
+int hw_get_module(const char *id, const struct hw_module_t **module)
+{
+    if (strcmp(id, GRALLOC_HARDWARE_MODULE_ID))
+        return -ENOENT;
+    *module = &gralloc_module.common;
+    return 0;
+}
+
+/* ---- BLTsville ---- */
+
+/* The blits are done when submitted, only their completion is delayed */
+static enum bverror test_blt(struct bvbltparams *bp)
+{
+    if (fail_blits > 0) {
+        fail_blits--;
+        return BVERR_OP;
+    }
+    return cpu_blt(bp);
+}
+
+static void hw_submit(BVFN_GCFENCE_SIGNAL callbackfn, unsigned long callbackdata)
+{
+    long long now = now_ns();
+
+    if (hw_queued == MAX_HW_BATCHES) {
+        printf("too many hw2d batches in flight\n");
+        exit(1);
+    }
+    pthread_mutex_lock(&stub_lock);
+    hw_busy_until = (hw_busy_until > now ? hw_busy_until : now) + hw_delay_ns;
+    pthread_mutex_unlock(&stub_lock);
+    hw_batches[hw_queued].done = hw_busy_until;
+    hw_batches[hw_queued].callbackfn = callbackfn;
+    hw_batches[hw_queued++].callbackdata = callbackdata;
+}
+
+/* Runs the callbacks of the batches done */
+static void hw_complete(void)
+{
+    long long now = now_ns();
+    int i, done = 0;
+
+    while (done < hw_queued && hw_batches[done].done <= now)
+        done++;
+    for (i = 0; i < done; i++)
+        hw_batches[i].callbackfn(NULL, hw_batches[i].callbackdata);
+    hw_queued -= done;
+    memmove(hw_batches, hw_batches + done, hw_queued * sizeof(hw_batches[0]));
+}
+
+static enum bverror test_fill(struct bvbltparams *bp, unsigned int count, const struct bvrect *rects)
+{
+    enum bverror err = cpu_fill(bp, count, rects);
+
+    if (!err && (bp->flags & BVFLAG_ASYNC) && bp->callbackfn)
+        hw_submit(bp->callbackfn, bp->callbackdata);
+    return err;
+}
+
+static int hw_fence_create(void)
+{
+    return open("/dev/null", O_RDONLY);
+}
+
+static void hw_fence_destroy(int fence)
+{
+    close(fence);
+}
+
+static void hw_fence_signal(struct bvcallbackerror *err, unsigned long callbackdata)
+{
+    hw_completed++;
+}
+
+static enum bverror hw_fence_blt(struct bvbltparams *bp, int *fence)
+{
+    unsigned long batch = bp->flags & BVFLAG_BATCH_MASK;
+    enum bverror err = test_blt(bp);
+
+    if (!err && batch != BVFLAG_BATCH_BEGIN && batch != BVFLAG_BATCH_CONTINUE)
+        hw_submit(hw_fence_signal, *fence);
+    return err;
+}
+
+static int hw_fence_wait(int fence, int timeoutms)
+{
+    int completed;
+
+    if (!hw_completed && hw_queued) {
+        long long wait = hw_batches[0].done - now_ns();
+        if (timeoutms >= 0 && wait > timeoutms * 1000000LL)
+            wait = timeoutms * 1000000LL;
+        sleep_ns(wait);
+    }
+    hw_complete();
+    completed = hw_completed;
+    hw_completed = 0;
+    return completed;
+}
+
+static char cpu_lib, hw2d_lib;
+
+static const struct {
+    const char *name;
+    void *fn;
+    bool hw2d;                  /* only in libbltsville_hw2d */
+} symbols[] = {
+    { "bv_blt", test_blt, false },
+    { "gcbvfill", test_fill, true },
+    { "gcbvfence_create", hw_fence_create, true },
+    { "gcbvfence_destroy", hw_fence_destroy, true },
+    { "gcbvfence_blt", hw_fence_blt, true },
+    { "gcbvfence_signal", hw_fence_signal, true },
+    { "gcbvfence_wait", hw_fence_wait, true },
+};
+
+/*
+ * The libraries virtual_display.c loads, the test is linked with
+ * --wrap=dlopen,--wrap=dlsym,--wrap=dlclose,--wrap=dlerror so libc and
+ * the libraries it loads still have the real ones
+ */
+void *__wrap_dlopen(const char *file, int mode)
+{
+    if (!strcmp(file, "libbltsville_cpu.so"))
+        return &cpu_lib;
+    if (!strcmp(file, "libbltsville_hw2d.so") && have_hw2d)
+        return &hw2d_lib;
+    return NULL;
+}
+
+void *__wrap_dlsym(void *handle, const char *name)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(symbols) / sizeof(symbols[0]); i++) {
+        if (!strcmp(symbols[i].name, name) && (handle == &hw2d_lib || !symbols[i].hw2d))
+            return symbols[i].fn;
+    }
+    return NULL;
+}
+
+int __wrap_dlclose(void *handle)
+{
+    return 0;
+}
+
+char *__wrap_dlerror(void)
+{
+    return "not stubbed by vd_test";
+}
+
+/* ---- layers ---- */
+
+static int rand_range(int lo, int hi)
+{
+    return lo + rand() % (hi - lo + 1);
+}
+
+/* Random premultiplied pixel, opaque one time out of four */
+static uint32_t rand_pixel(void)
+{
+    uint32_t a = rand() % 4 ? rand() % 256 : 255;
+    uint32_t r = a ? rand() % (a + 1) : 0;
+    uint32_t g = a ? rand() % (a + 1) : 0;
+    uint32_t b = a ? rand() % (a + 1) : 0;
+    return a << 24 | b << 16 | g << 8 | r;
+}
+
+static void fill_buffer(struct buffer *b)
+{
+    int i;
+
+    for (i = 0; i < b->stride * b->handle.iHeight; i++)
+        b->pixels[i] = rand_pixel();
+}
+
+static struct buffer *new_buffer(int width, int height, int format, bool listed)
+{
+    struct buffer *b = calloc(1, sizeof(*b));
+
+    if (!b)
+        return NULL;
+    b->stride = ALIGN(width, HW_ALIGN);
+    b->pixels = malloc(b->stride * height * sizeof(uint32_t));
+    if (!b->pixels) {
+        free(b);
+        return NULL;
+    }
+    b->handle.iWidth = width;
+    b->handle.iHeight = height;
+    b->handle.iFormat = format;
+    b->handle.usage = GRALLOC_USAGE_HW_RENDER;
+    fill_buffer(b);
+
+    b->last_frame = frame;
+    if (listed) {
+        b->next = buffers;
+        buffers = b;
+    }
+    return b;
+}
+
+static void free_buffer(struct buffer *b)
+{
+    if (b) {
+        free(b->pixels);
+        free(b);
+    }
+}
+
+/*
+ * Buffers are only freed once unused for a frame, so a handle never stands
+ * for new content in the frame following the one it was shown in
+ */
+static void free_buffers(bool all)
+{
+    struct buffer **p = &buffers;
+
+    while (*p) {
+        struct buffer *b = *p;
+        if (all || b->last_frame < frame - 1) {
+            *p = b->next;
+            free_buffer(b);
+        } else
+            p = &b->next;
+    }
+}
+
+/* Gives the layer new content of the size of its frame */
+static int new_content(struct layer *l)
+{
+    int width = l->frame.right - l->frame.left;
+    int height = l->frame.bottom - l->frame.top;
+    /* The crop sits anywhere in a bigger buffer */
+    int left = rand_range(0, 8);
+    int top = rand_range(0, 8);
+    int format = rand() % 2 ? HAL_PIXEL_FORMAT_RGBA_8888 : HAL_PIXEL_FORMAT_RGBX_8888;
+
+    l->buffer = new_buffer(left + width + rand_range(0, 8), top + height + rand_range(0, 8), format, true);
+    if (!l->buffer)
+        return -1;
+    l->crop.left = left;
+    l->crop.top = top;
+    l->crop.right = left + width;
+    l->crop.bottom = top + height;
+    return 0;
+}
+
+/* Frames may hang off the display */
+static void move_layer(struct layer *l)
+{
+    int width = l->frame.right - l->frame.left;
+    int height = l->frame.bottom - l->frame.top;
+
+    l->frame.left = rand_range(-width / 2, VD_WIDTH - width / 2);
+    l->frame.top = rand_range(-height / 2, VD_HEIGHT - height / 2);
+    l->frame.right = l->frame.left + width;
+    l->frame.bottom = l->frame.top + height;
+}
+
+static int new_layer(struct layer *l)
+{
+    memset(l, 0, sizeof(*l));
+    l->skip = rand() % 6 == 0;
+    l->blending = rand() % 3 ? HWC_BLENDING_PREMULT : HWC_BLENDING_NONE;
+    if (rand() % 4 == 0) {
+        l->frame.right = VD_WIDTH;
+        l->frame.bottom = VD_HEIGHT;
+    } else {
+        l->frame.right = rand_range(1, VD_WIDTH);
+        l->frame.bottom = rand_range(1, VD_HEIGHT);
+        move_layer(l);
+    }
+    return new_content(l);
+}
+
+/* Changes the layers and the GLES composition the way a UI does */
+static int next_frame(void)
+{
+    int i;
+
+    if (!num_layers || rand() % 16 == 0) {
+        num_layers = rand_range(1, MAX_LAYERS);
+        for (i = 0; i < num_layers; i++) {
+            if (new_layer(&layers[i]))
+                return -1;
+        }
+    } else {
+        for (i = 0; i < num_layers; i++) {
+            int r = rand() % 16;
+            if (r < 1)
+                move_layer(&layers[i]);
+            else if (r < 4 && new_content(&layers[i]))
+                return -1;
+        }
+    }
+
+    if (!fb_buffer || rand() % 2) {
+        fb_buffer = new_buffer(VD_WIDTH, VD_HEIGHT, HAL_PIXEL_FORMAT_RGBA_8888, true);
+        if (!fb_buffer)
+            return -1;
+    }
+    return 0;
+}
+
+static void set_layer(hwc_layer_1_t *h, struct buffer *b, hwc_rect_t crop, hwc_rect_t frame, int32_t blending)
+{
+    memset(h, 0, sizeof(*h));
+    h->compositionType = HWC_FRAMEBUFFER;
+    h->handle = (buffer_handle_t)&b->handle;
+    h->blending = blending;
+    h->sourceCrop = crop;
+    h->displayFrame = frame;
+    h->planeAlpha = 0xFF;
+    h->acquireFenceFd = h->releaseFenceFd = -1;
+}
+
+/* The list SurfaceFlinger hands to prepare, the framebuffer target last */
+static void get_list(struct buffer *outbuf)
+{
+    hwc_rect_t full = { 0, 0, VD_WIDTH, VD_HEIGHT };
+    int i;
+
+    list->retireFenceFd = -1;
+    list->outbuf = (buffer_handle_t)&outbuf->handle;
+    list->outbufAcquireFenceFd = -1;
+    list->flags = 0;
+    list->numHwLayers = num_layers + 1;
+    for (i = 0; i < num_layers; i++) {
+        struct layer *l = &layers[i];
+        set_layer(&list->hwLayers[i], l->buffer, l->crop, l->frame, l->blending);
+        list->hwLayers[i].flags = l->skip ? HWC_SKIP_LAYER : 0;
+        l->buffer->last_frame = frame;
+    }
+    set_layer(&list->hwLayers[num_layers], fb_buffer, full, full, HWC_BLENDING_PREMULT);
+    list->hwLayers[num_layers].compositionType = HWC_FRAMEBUFFER_TARGET;
+    fb_buffer->last_frame = frame;
+}
+
+/* Layers from the first one above the topmost skipped layer on are blitted */
+static int blitted_from(void)
+{
+    int i;
+
+    for (i = num_layers; i > 0 && !layers[i - 1].skip; i--)
+        ;
+    return i;
+}
+
+static void draw(struct buffer *b, hwc_rect_t crop, hwc_rect_t frame, int32_t blending)
+{
+    int x, y;
+
+    for (y = frame.top; y < frame.bottom; y++) {
+        if (y < 0 || y >= VD_HEIGHT)
+            continue;
+        for (x = frame.left; x < frame.right; x++) {
+            if (x < 0 || x >= VD_WIDTH)
+                continue;
+            uint32_t *dst = &reference[y * VD_WIDTH + x];
+            uint32_t src = b->pixels[(crop.top + y - frame.top) * b->stride + crop.left + x - frame.left];
+            if (b->handle.iFormat == HAL_PIXEL_FORMAT_RGBX_8888)
+                src |= 0xFF000000;
+            *dst = blending == HWC_BLENDING_PREMULT ? blend(src, *dst) : src;
+        }
+    }
+}
+
+/* The framebuffer target over transparent black, and the blitted layers */
+static void compose_reference(int first)
+{
+    hwc_rect_t full = { 0, 0, VD_WIDTH, VD_HEIGHT };
+    int i;
+
+    memset(reference, 0, sizeof(reference));
+    if (first)
+        draw(fb_buffer, full, full, HWC_BLENDING_NONE);
+    for (i = first; i < num_layers; i++)
+        draw(layers[i].buffer, layers[i].crop, layers[i].frame, layers[i].blending);
+}
+
+/*
+ * Returns the number of pixels of the output buffer differing from the
+ * reference, both are in the layout of the layer pixels
+ */
+static int compare(const char *what, struct buffer *outbuf)
+{
+    int mismatches = 0;
+    int x, y, first_x = 0, first_y = 0;
+
+    for (y = 0; y < VD_HEIGHT; y++) {
+        for (x = 0; x < VD_WIDTH; x++) {
+            if (outbuf->pixels[y * outbuf->stride + x] == reference[y * VD_WIDTH + x])
+                continue;
+            if (!mismatches++) {
+                first_x = x;
+                first_y = y;
+            }
+        }
+    }
+
+    if (mismatches && printed_failures++ < MAX_PRINTED_FAILURES)
+        printf("frame %d: %s differs in %d pixels, first at (%d,%d): %08x instead of %08x\n",
+               frame, what, mismatches, first_x, first_y,
+               outbuf->pixels[first_y * outbuf->stride + first_x], reference[first_y * VD_WIDTH + first_x]);
+    return mismatches;
+}
+
+static int locked_buffers(void)
+{
+    struct buffer *b;
+    int i, locks = 0;
+
+    pthread_mutex_lock(&stub_lock);
+    for (b = buffers; b; b = b->next)
+        locks += b->locks;
+    for (i = 0; i < NUM_OUTBUFS; i++)
+        locks += outbufs[i]->locks;
+    pthread_mutex_unlock(&stub_lock);
+    return locks;
+}
+
+/*
+ * Waits for the frame to retire and closes the fences set returned. Returns
+ * 0 once the frame retired with its layers released.
+ */
+static int retire_frame(void)
+{
+    int i, err = 0;
+
+    if (list->retireFenceFd >= 0 && sync_wait(list->retireFenceFd, RETIRE_TIMEOUT_MS)) {
+        printf("frame %d: not retired after %dms\n", frame, RETIRE_TIMEOUT_MS);
+        err = -1;
+    }
+    for (i = 0; i < (int)list->numHwLayers; i++) {
+        int fd = list->hwLayers[i].releaseFenceFd;
+        if (fd >= 0) {
+            err = err ? err : !signalled(fd) ? -1 : 0;
+            close(fd);
+        }
+        list->hwLayers[i].releaseFenceFd = -1;
+    }
+    if (list->retireFenceFd >= 0)
+        close(list->retireFenceFd);
+    list->retireFenceFd = -1;
+    return err;
+}
+
+static int open_fds(void)
+{
+    int fd, count = 0;
+
+    for (fd = 0; fd < 1024; fd++)
+        count += fcntl(fd, F_GETFD) != -1;
+    return count;
+}
+
+/* ---- primary display ---- */
+
+/*
+ * The primary display regionizes its layers with a regionizer of its own
+ * while the composition thread runs, its blit list must come out the same
+ * every time
+ */
+#define PRIMARY_LAYERS 3
+
+static rgz_t primary_rgz;
+static struct buffer *primary_buffers[PRIMARY_LAYERS];
+static hwc_layer_1_t primary_layers[PRIMARY_LAYERS];
+static struct bvsurfgeom primary_geom;
+static unsigned primary_sum;
+static int primary_runs;
+static int primary_changes;
+
+static int init_primary(void)
+{
+    static const hwc_rect_t frames[] = {
+        { 0, 0, VD_WIDTH, VD_HEIGHT },
+        { 10, 6, 50, 30 },
+        { 24, 20, 70, 44 },
+    };
+    int i;
+
+    for (i = 0; i < PRIMARY_LAYERS; i++) {
+        hwc_rect_t crop = { 0, 0, frames[i].right - frames[i].left, frames[i].bottom - frames[i].top };
+        primary_buffers[i] = new_buffer(crop.right, crop.bottom, HAL_PIXEL_FORMAT_RGBA_8888, false);
+        if (!primary_buffers[i])
+            return -1;
+        set_layer(&primary_layers[i], primary_buffers[i], crop, frames[i],
+                  i ? HWC_BLENDING_PREMULT : HWC_BLENDING_NONE);
+    }
+    primary_geom.structsize = sizeof(primary_geom);
+    primary_geom.format = OCDFMT_BGRA24;
+    primary_geom.width = VD_WIDTH;
+    primary_geom.height = VD_HEIGHT;
+    primary_geom.virtstride = VD_WIDTH * 4;
+    return 0;
+}
+
+/* Regionizes the primary layers in full and sums up the blits generated */
+static void run_primary(void)
+{
+    rgz_in_params_t in = {
+        .op = RGZ_IN_HWC,
+        .data = {
+            .hwc = {
+                .flags = RGZ_IN_HWC_REDRAW,
+                .layerno = PRIMARY_LAYERS,
+                .layers = primary_layers,
+                .dstgeom = &primary_geom,
+            }
+        }
+    };
+    rgz_out_params_t out = {
+        .op = RGZ_OUT_BVCMD_REGION,
+        .data = {
+            .bvc = {
+                .dstgeom = &primary_geom,
+            }
+        }
+    };
+    struct rgz_blt_entry *e;
+    unsigned sum;
+    int i;
+
+    if (rgz_in(&in, &primary_rgz) != RGZ_ALL || rgz_out(&primary_rgz, &out)) {
+        primary_changes++;
+        return;
+    }
+    /* hwc_set copies the list right away, it is only checked here */
+    e = out.data.bvc.cmdp;
+    sum = out.data.bvc.cmdlen;
+    for (i = 0; i < out.data.bvc.cmdlen; i++, e++) {
+        sum = sum * 31 + e->bp.flags;
+        sum = sum * 31 + e->bp.dstrect.left + (e->bp.dstrect.top << 8);
+        sum = sum * 31 + e->bp.dstrect.width + (e->bp.dstrect.height << 8);
+        sum = sum * 31 + e->bp.src1rect.left + (e->bp.src1rect.top << 8);
+        sum = sum * 31 + (unsigned)(uintptr_t)e->bp.src1.desc;
+    }
+    if (primary_runs++ && sum != primary_sum)
+        primary_changes++;
+    primary_sum = sum;
+}
+
+static void release_primary(void)
+{
+    int i;
+
+    rgz_release(&primary_rgz);
+    for (i = 0; i < PRIMARY_LAYERS; i++)
+        free_buffer(primary_buffers[i]);
+}
+
+/* ---- frames ---- */
+
+static struct {
+    int frames;
+    int blitted;                /* frames checked */
+    int mismatches;
+    int lost;                   /* frames not retired or wrongly prepared */
+    long long set_ns;
+    long long max_set_ns;
+} stats;
+
+/*
+ * Runs the next random frame. Some layers are given fences, signalled after
+ * hwc_set when it doesn't compose itself. The GLES composition is not
+ * checked, for frames without blits GLES renders straight into the output
+ * buffer, which gets random content.
+ */
+static int run_frame(void)
+{
+    int signals[MAX_LAYERS];
+    struct buffer *outbuf;
+    int i, first;
+    long long start, time;
+
+    if (next_frame())
+        return -1;
+
+    /* The output buffers rotate, sometimes one is skipped or taken twice */
+    outbuf = outbufs[rand() % 8 ? frame % 2 : rand() % NUM_OUTBUFS];
+    get_list(outbuf);
+
+    virtual_display_prepare(&hwc_dev, VD_DISP, list);
+    first = blitted_from();
+    for (i = 0; i < num_layers; i++) {
+        if (list->hwLayers[i].compositionType != (i < first ? HWC_FRAMEBUFFER : HWC_OVERLAY)) {
+            printf("frame %d: layer %d %s blitted\n", frame, i, i < first ? "wrongly" : "not");
+            stats.lost++;
+            return 0;
+        }
+    }
+
+    if (first == num_layers) {
+        fill_buffer(outbuf);
+        list->hwLayers[num_layers].handle = (buffer_handle_t)&outbuf->handle;
+    }
+
+    for (i = 0; i < num_layers; i++) {
+        signals[i] = -1;
+        if (rand() % 4 == 0)
+            list->hwLayers[i].acquireFenceFd = new_fence(&signals[i]);
+        /* hwc_set composing itself would wait for them */
+        if (!have_timeline)
+            signal_fence(&signals[i]);
+    }
+
+    start = now_ns();
+    virtual_display_set(&hwc_dev, VD_DISP, list);
+    time = now_ns() - start;
+    stats.set_ns += time;
+    if (time > stats.max_set_ns)
+        stats.max_set_ns = time;
+    stats.frames++;
+
+    for (i = 0; i < num_layers; i++)
+        signal_fence(&signals[i]);
+    /* SurfaceFlinger goes on with the primary display meanwhile */
+    while (have_timeline && list->retireFenceFd >= 0 && !signalled(list->retireFenceFd))
+        run_primary();
+    if (retire_frame()) {
+        stats.lost++;
+        return 0;
+    }
+
+    if (first < num_layers) {
+        compose_reference(first);
+        stats.blitted++;
+        stats.mismatches += compare("composition", outbuf) != 0;
+    }
+    return 0;
+}
+
+static int run_frames(int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++, frame++) {
+        if (run_frame())
+            return -1;
+        free_buffers(false);
+    }
+    return 0;
+}
+
+/* A fixed stack of opaque and blended layers, the bottom one composed by GLES */
+static int fixed_frame(struct buffer *outbuf, bool gles_only)
+{
+    static const hwc_rect_t frames[] = {
+        { 0, 0, VD_WIDTH, VD_HEIGHT },
+        { 4, 4, 60, 40 },
+        { 30, 10, VD_WIDTH, 30 },
+        { -10, 20, 20, 60 },
+    };
+    int i;
+
+    num_layers = sizeof(frames) / sizeof(frames[0]);
+    for (i = 0; i < num_layers; i++) {
+        struct layer *l = &layers[i];
+        memset(l, 0, sizeof(*l));
+        l->frame = frames[i];
+        l->blending = i ? HWC_BLENDING_PREMULT : HWC_BLENDING_NONE;
+        l->skip = gles_only || !i;
+        if (new_content(l))
+            return -1;
+    }
+    fb_buffer = new_buffer(VD_WIDTH, VD_HEIGHT, HAL_PIXEL_FORMAT_RGBA_8888, true);
+    if (!fb_buffer)
+        return -1;
+    get_list(outbuf);
+    if (gles_only)
+        list->hwLayers[num_layers].handle = (buffer_handle_t)&outbuf->handle;
+    virtual_display_prepare(&hwc_dev, VD_DISP, list);
+    return 0;
+}
+
+static void check_producers(void)
+{
+    int signals[MAX_LAYERS + 1], i;
+    struct buffer *outbuf = outbufs[frame % 2];
+    bool ok;
+
+    if (fixed_frame(outbuf, false))
+        return;
+    for (i = 0; i < num_layers; i++)
+        list->hwLayers[i].acquireFenceFd = new_fence(&signals[i]);
+    list->hwLayers[num_layers].acquireFenceFd = new_fence(&signals[num_layers]);
+    list->outbufAcquireFenceFd = new_fence(&signals[MAX_LAYERS]);
+
+    virtual_display_set(&hwc_dev, VD_DISP, list);
+    ok = list->retireFenceFd >= 0;
+    usleep(20000);
+    check(ok && !signalled(list->retireFenceFd), "hwc_set returns before the producers signal the buffers");
+
+    for (i = 0; i < num_layers; i++)
+        signal_fence(&signals[i]);
+    signal_fence(&signals[num_layers]);
+    usleep(20000);
+    ok = ok && !signalled(list->retireFenceFd);
+    signal_fence(&signals[MAX_LAYERS]);
+    ok = !retire_frame() && ok;
+    compose_reference(1);
+    check(ok && !compare("frame behind fences", outbuf) && !locked_buffers(),
+          "frame retired once the output buffer is free too");
+    frame++;
+    free_buffers(false);
+}
+
+static void check_gles_frame(void)
+{
+    int signal;
+    struct buffer *outbuf = outbufs[frame % 2];
+    bool ok = true;
+    int i;
+
+    if (fixed_frame(outbuf, true))
+        return;
+    for (i = 0; i < num_layers; i++)
+        ok = ok && list->hwLayers[i].compositionType == HWC_FRAMEBUFFER;
+    list->hwLayers[num_layers].acquireFenceFd = new_fence(&signal);
+
+    virtual_display_set(&hwc_dev, VD_DISP, list);
+    ok = ok && list->retireFenceFd >= 0 && !signalled(list->retireFenceFd);
+    signal_fence(&signal);
+    ok = ok && signalled(list->retireFenceFd);
+    check(!retire_frame() && ok, "frame left to GLES retires with the framebuffer target");
+    frame++;
+    free_buffers(false);
+}
+
+static void check_failed_blit(void)
+{
+    struct buffer *outbuf = outbufs[frame % 2];
+    bool ok;
+
+    if (fixed_frame(outbuf, false))
+        return;
+    memset(outbuf->pixels, 0x5A, outbuf->stride * VD_HEIGHT * sizeof(uint32_t));
+    fail_blits = 2;
+    virtual_display_set(&hwc_dev, VD_DISP, list);
+    ok = !retire_frame() && !locked_buffers();
+    fail_blits = 0;
+    frame++;
+
+    /* The same layers into the other buffer, then into the failed one again */
+    outbuf = outbufs[frame % 2];
+    get_list(outbuf);
+    virtual_display_prepare(&hwc_dev, VD_DISP, list);
+    virtual_display_set(&hwc_dev, VD_DISP, list);
+    ok = !retire_frame() && ok;
+    frame++;
+    outbuf = outbufs[frame % 2];
+    get_list(outbuf);
+    virtual_display_prepare(&hwc_dev, VD_DISP, list);
+    virtual_display_set(&hwc_dev, VD_DISP, list);
+    ok = !retire_frame() && ok;
+    compose_reference(1);
+    check(ok && !compare("frame after a failed one", outbuf), "frames after failed blits redrawn in full");
+    frame++;
+    free_buffers(false);
+}
+
+static void check_slow_blits(void)
+{
+    struct buffer *outbuf = outbufs[frame % 2];
+    long long start, time;
+    bool ok;
+    char what[128];
+
+    if (fixed_frame(outbuf, false))
+        return;
+    /* The 2D core is busy with something else for a while */
+    busy_unlocks = 0;
+    start = now_ns();
+    pthread_mutex_lock(&stub_lock);
+    hw_busy_until = start + SLOW_BLIT_MS * 1000000LL;
+    pthread_mutex_unlock(&stub_lock);
+    virtual_display_set(&hwc_dev, VD_DISP, list);
+    ok = !retire_frame();
+    time = now_ns() - start;
+
+    compose_reference(1);
+    snprintf(what, sizeof(what), "buffers locked until the blits complete, %lldms after hwc_set",
+             time / 1000000);
+    check(ok && time >= SLOW_BLIT_MS * 1000000LL && !busy_unlocks && !locked_buffers() &&
+          !compare("slow frame", outbuf), what);
+    frame++;
+    free_buffers(false);
+}
+
+static const struct mode {
+    const char *name;
+    bool hw2d;
+    bool timeline;
+} modes[] = {
+    { "libbltsville_cpu in hwc_set", false, false },
+    { "libbltsville_cpu behind fences", false, true },
+    { "libbltsville_hw2d behind fences", true, true },
+};
+
+static void run_mode(const struct mode *m, int frames)
+{
+    char what[256], dump[1024];
+
+    printf("%s\n", m->name);
+    have_hw2d = m->hw2d;
+    have_timeline = m->timeline;
+    hw_delay_ns = HW_DELAY_US * 1000LL;
+    busy_unlocks = 0;
+    memset(&stats, 0, sizeof(stats));
+    primary_runs = primary_changes = 0;
+    num_layers = 0;
+    fb_buffer = NULL;
+
+    if (virtual_display_init()) {
+        check(false, "virtual_display_init");
+        return;
+    }
+
+    if (run_frames(frames)) {
+        check(false, "out of memory");
+        return;
+    }
+    snprintf(what, sizeof(what), "%d of %d random frames blitted as composed back to front, %d lost",
+             stats.blitted - stats.mismatches, stats.blitted, stats.lost);
+    check(!stats.mismatches && !stats.lost, what);
+    check(!busy_unlocks && !locked_buffers(), "buffers unlocked once blitted");
+    if (m->timeline) {
+        snprintf(what, sizeof(what), "primary display regionized %d times during the compositions, %d changed",
+                 primary_runs, primary_changes);
+        check(!primary_changes, what);
+    }
+
+    if (m->timeline)
+        check_producers();
+    check_gles_frame();
+    check_failed_blit();
+    if (m->hw2d)
+        check_slow_blits();
+
+    printf("hwc_set avg %lldus max %lldus\n", stats.set_ns / 1000 / (stats.frames ? stats.frames : 1),
+           stats.max_set_ns / 1000);
+    virtual_display_dump(dump, sizeof(dump));
+    printf("%s", dump);
+    virtual_display_release();
+}
+
+int main(int argc, char **argv)
+{
+    int seed = 1, frames = DEFAULT_FRAMES, opt, fds, i;
+
+    while ((opt = getopt(argc, argv, "s:n:")) != -1) {
+        switch (opt) {
+        case 's':
+            seed = atoi(optarg);
+            break;
+        case 'n':
+            frames = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: vd_test [-s seed] [-n frames]\n");
+            return 1;
+        }
+    }
+    srand(seed);
+    /* Fences are pipes, nobody may be waiting on them any more when signalled */
+    signal(SIGPIPE, SIG_IGN);
+
+    hwc_dev.blt_policy = BLTPOLICY_DEFAULT;
+    list = calloc(1, sizeof(*list) + (MAX_LAYERS + 1) * sizeof(hwc_layer_1_t));
+    for (i = 0; i < NUM_OUTBUFS; i++)
+        outbufs[i] = new_buffer(VD_WIDTH, VD_HEIGHT, HAL_PIXEL_FORMAT_RGBA_8888, false);
+    if (!list || !outbufs[0] || !outbufs[1] || !outbufs[2] || init_primary()) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    fds = open_fds();
+    for (i = 0; i < (int)(sizeof(modes) / sizeof(modes[0])); i++)
+        run_mode(&modes[i], frames);
+    check(open_fds() == fds, "no fence left open");
+
+    free_buffers(true);
+    release_primary();
+    for (i = 0; i < NUM_OUTBUFS; i++)
+        free_buffer(outbufs[i]);
+    free(list);
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
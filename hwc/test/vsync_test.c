@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host load test of the s/w vsync generator
+ *
+ * Runs the s/w vsync thread for a number of vsyncs, 2000 by default, while
+ * other threads keep every CPU busy, and checks that the reported vsyncs
+ * stay on their timeline: late wakeups may only skip whole periods, which
+ * have to be counted as missed. A callback blocking the thread for a few
+ * periods checks the same without relying on the scheduler. Also checks that
+ * the timeline locks onto the phase of real vsyncs, and that a stop and a
+ * restart don't count the pause as missed periods.
+ *
+ * Usage: vsync_test [-l load threads] [-n vsyncs under load]
+ *
+ * Returns 0 when every case passes.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <linux/types.h>
+
+#include <utils/Timers.h>
+
+#include "../hwc_dev.h"
+#include "../sw_vsync.h"
+
+#define LOAD_VSYNCS 2000
+#define LOCK_VSYNCS 60
+#define BLOCK_VSYNCS 10
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static nsecs_t *timestamps;
+static int num_vsyncs, wanted_vsyncs;
+static nsecs_t lock_reference;      /* real vsync timestamp, 0 if none */
+static useconds_t block_us;         /* blocks the next callback */
+
+static volatile bool loaded;
+static int failures;
+
+static void check(bool ok, const char *what)
+{
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+    failures += !ok;
+}
+
+static void vsync(const struct hwc_procs *procs, int disp, int64_t timestamp)
+{
+    pthread_mutex_lock(&mutex);
+    if (num_vsyncs < wanted_vsyncs) {
+        timestamps[num_vsyncs++] = timestamp;
+        if (num_vsyncs == wanted_vsyncs)
+            pthread_cond_signal(&cond);
+    }
+    if (lock_reference)
+        lock_sw_vsync(lock_reference);
+    useconds_t block = block_us;
+    block_us = 0;
+    pthread_mutex_unlock(&mutex);
+
+    if (block)
+        usleep(block);
+}
+
+/* Checks that the intervals of the last vsyncs are whole periods */
+static void check_timeline(int count, nsecs_t period, uint32_t missed, const char *what)
+{
+    uint32_t skipped = 0;
+    bool on_timeline = true;
+    char msg[128];
+    int i;
+
+    for (i = 1; i < count; i++) {
+        nsecs_t interval = timestamps[i] - timestamps[i - 1];
+        on_timeline = on_timeline && interval > 0 && interval % period == 0;
+        skipped += interval / period - 1;
+    }
+    snprintf(msg, sizeof(msg), "%d vsyncs %s on a %lld ns timeline", count, what, (long long)period);
+    check(on_timeline, msg);
+    snprintf(msg, sizeof(msg), "%u skipped periods counted as missed", skipped);
+    check(missed == skipped, msg);
+}
+
+/* Collects the next count vsyncs */
+static void wait_vsyncs(int count)
+{
+    pthread_mutex_lock(&mutex);
+    num_vsyncs = 0;
+    wanted_vsyncs = count;
+    while (num_vsyncs < wanted_vsyncs)
+        pthread_cond_wait(&cond, &mutex);
+    pthread_mutex_unlock(&mutex);
+}
+
+static void *load_loop(void *data)
+{
+    volatile uint32_t x = 0;
+
+    while (loaded)
+        x++;
+    return NULL;
+}
+
+/* Phase of t against the timeline of reference, in [-period/2, period/2] */
+static nsecs_t phase(nsecs_t t, nsecs_t reference, nsecs_t period)
+{
+    nsecs_t error = (t - reference) % period;
+
+    if (error < 0)
+        error += period;
+    if (error > period / 2)
+        error -= period;
+    return error;
+}
+
+int main(int argc, char **argv)
+{
+    static hwc_procs_t procs = { .vsync = vsync };
+    omap_hwc_device_t hwc_dev;
+    sw_vsync_stats_t before, after;
+    pthread_t *load;
+    int num_load = sysconf(_SC_NPROCESSORS_ONLN) * 2;
+    int load_vsyncs = LOAD_VSYNCS;
+    int i, opt;
+    char what[128];
+
+    while ((opt = getopt(argc, argv, "l:n:")) != -1) {
+        switch (opt) {
+        case 'l':
+            num_load = atoi(optarg);
+            break;
+        case 'n':
+            load_vsyncs = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: vsync_test [-l load threads] [-n vsyncs under load]\n");
+            return 1;
+        }
+    }
+    if (load_vsyncs < LOCK_VSYNCS)
+        load_vsyncs = LOCK_VSYNCS;
+    timestamps = calloc(load_vsyncs, sizeof(*timestamps));
+
+    memset(&hwc_dev, 0, sizeof(hwc_dev));
+    hwc_dev.procs = &procs;
+    init_sw_vsync(&hwc_dev);
+    start_sw_vsync();
+    wait_vsyncs(1);
+
+    /* Generated vsyncs under load */
+    load = calloc(num_load, sizeof(*load));
+    loaded = true;
+    for (i = 0; i < num_load; i++)
+        pthread_create(&load[i], NULL, load_loop, NULL);
+    get_sw_vsync_stats(&before);
+    wait_vsyncs(load_vsyncs);
+    get_sw_vsync_stats(&after);
+    loaded = false;
+    for (i = 0; i < num_load; i++)
+        pthread_join(load[i], NULL);
+    free(load);
+
+    nsecs_t period = after.rate;
+    snprintf(what, sizeof(what), "with %d load threads", num_load);
+    check_timeline(load_vsyncs, period, after.missed - before.missed, what);
+    printf("wakeup latency under load: mean %lld us, p99 %lld us, max %lld us\n",
+           (long long)after.mean / 1000, (long long)after.p99 / 1000, (long long)after.max / 1000);
+
+    /* A late wakeup */
+    get_sw_vsync_stats(&before);
+    pthread_mutex_lock(&mutex);
+    block_us = period * 5 / 2 / 1000;
+    pthread_mutex_unlock(&mutex);
+    wait_vsyncs(BLOCK_VSYNCS);
+    get_sw_vsync_stats(&after);
+    check_timeline(BLOCK_VSYNCS, period, after.missed - before.missed, "after a blocked callback");
+    check(after.missed - before.missed >= 2, "blocked callback missed vsyncs");
+
+    /* Locking onto real vsyncs a third of a period away */
+    nsecs_t reference = timestamps[BLOCK_VSYNCS - 1] + period / 3;
+    pthread_mutex_lock(&mutex);
+    lock_reference = reference;
+    pthread_mutex_unlock(&mutex);
+    wait_vsyncs(LOCK_VSYNCS);
+    pthread_mutex_lock(&mutex);
+    lock_reference = 0;
+    pthread_mutex_unlock(&mutex);
+    nsecs_t first = phase(timestamps[0], reference, period);
+    nsecs_t last = phase(timestamps[LOCK_VSYNCS - 1], reference, period);
+    snprintf(what, sizeof(what), "phase locked from %lld us to %lld ns",
+             (long long)first / 1000, (long long)last);
+    check(llabs(last) < 1000, what);
+
+    /* A pause isn't missed vsyncs */
+    get_sw_vsync_stats(&before);
+    stop_sw_vsync();
+    usleep(period * 10 / 1000);
+    start_sw_vsync();
+    wait_vsyncs(2);
+    get_sw_vsync_stats(&after);
+    check(after.missed == before.missed, "stop and restart miss no vsyncs");
+    check(timestamps[1] - timestamps[0] == period, "restarted on the period");
+
+    stop_sw_vsync();
+    free(timestamps);
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,769 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <linux/types.h>
+
+#include <cutils/log.h>
+#include <hardware/hardware.h>
+#include <sync/sync.h>
+#include <utils/Timers.h>
+
+#include "hwc_dev.h"
+#include "virtual_display.h"
+#include "gcbvext.h"
+
+#define BLTSVILLE_HW_LIB "libbltsville_hw2d.so"
+#define BLTSVILLE_CPU_LIB "libbltsville_cpu.so"
+
+/* How long to wait for the producers of the buffers before giving up on a frame */
+#define FENCE_TIMEOUT_MS 1000
+
+/* Frames queued for the composition thread before hwc_set waits for it */
+#define MAX_JOBS 2
+
+/* The s/w sync timeline of libsync, which has no header for it */
+int sw_sync_timeline_create(void);
+int sw_sync_timeline_inc(int fd, unsigned count);
+int sw_sync_fence_create(int fd, const char *name, unsigned value);
+
+struct virtual_display {
+    /* Set by virtual_display_prepare for virtual_display_set */
+    bool blit;                  /* layers from fb_layers on are blitted */
+    uint32_t fb_layers;         /* layers composed by GLES in the framebuffer target */
+    bool reset;                 /* the display went away since the last frame */
+
+    /* Owned by the composition thread */
+    rgz_t rgz;
+    /* output buffers of the last frames, the regionizer state of each one */
+    buffer_handle_t outbufs[RGZ_NUM_FB];
+    uint32_t frame;
+
+    /* statistics, under lock */
+    uint32_t width;
+    uint32_t height;
+    uint32_t frames;
+    uint32_t gles_frames;       /* everything left to GLES */
+    uint32_t redraws;           /* blitted frames without damage tracking */
+    uint32_t failures;
+    uint64_t blits;
+    uint64_t pixels;
+    nsecs_t compose_time;
+    nsecs_t max_compose_time;
+};
+
+/* A frame of a virtual display, composed once its buffers are ready */
+struct job {
+    int disp;
+    bool reset;                 /* forget the output buffers of the display first */
+    bool compose;               /* GLES rendered the frame otherwise */
+    buffer_handle_t outbuf;
+    int outbuf_fence;
+    hwc_layer_1_t *layers;      /* regionizer input, owns the acquire fences */
+    uint32_t num_layers;
+    uint32_t size;
+};
+
+static struct virtual_display displays[MAX_DISPLAYS];
+
+/*
+ * The frames are queued to the composition thread, which signals the
+ * timeline once per frame, so hwc_set neither waits for the producers nor
+ * for the blits. Without a timeline to hand back fences from, hwc_set
+ * composes the frame itself.
+ */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static struct job jobs[MAX_JOBS];
+static uint32_t jobs_queued;
+static uint32_t jobs_done;
+static bool threaded;
+static bool stop;
+static pthread_t thread;
+static int timeline = -1;
+
+static void *bv_lib;
+static const char *bv_lib_name;
+static BVFN_BLT bv_blt;
+static BVFN_GCFILL bv_fill;
+static gralloc_module_t const *gralloc;
+
+/*
+ * With the fences of libbltsville_gc2d the blits of a frame run asynchronously
+ * and are waited for once before the buffers are unlocked, other
+ * implementations blit synchronously
+ */
+static BVFN_GCFENCE_BLT fence_blt;
+static BVFN_GCFENCE_SIGNAL fence_signal;
+static BVFN_GCFENCE_WAIT fence_wait;
+static BVFN_GCFENCE_DESTROY fence_destroy;
+static int fence = -1;
+static uint32_t fence_pending;  /* batches submitted and not signalled yet */
+
+/* Buffers locked for the BLTsville implementation during the current frame */
+static buffer_handle_t *locked_hndls;
+static void **locked_addrs;
+static uint32_t nlocked;
+static uint32_t locked_size;
+
+static bool can_blit(hwc_layer_1_t *layer)
+{
+    IMG_native_handle_t *handle = (IMG_native_handle_t *)layer->handle;
+
+    if (!rgz_in_valid_hwc_layer(layer))
+        return false;
+
+    /* The chroma plane of TILER NV12 buffers isn't reachable through the lock */
+    return handle->iFormat != HAL_PIXEL_FORMAT_TI_NV12;
+}
+
+static int get_buffdesc(void *data __unused, buffer_handle_t handle, struct bvbuffdesc *desc)
+{
+    uint32_t i;
+    for (i = 0; i < nlocked; i++) {
+        if (locked_hndls[i] == handle) {
+            desc->virtaddr = locked_addrs[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static enum bverror submit_blt(struct bvbltparams *bp)
+{
+    unsigned long batch = bp->flags & BVFLAG_BATCH_MASK;
+    enum bverror err;
+
+    if (!fence_blt) {
+        bp->flags &= ~BVFLAG_ASYNC;
+        return bv_blt(bp);
+    }
+
+    err = fence_blt(bp, &fence);
+    if (!err && batch != BVFLAG_BATCH_BEGIN && batch != BVFLAG_BATCH_CONTINUE)
+        fence_pending++;
+    return err;
+}
+
+static enum bverror submit_fill(struct bvbltparams *bp, unsigned int count, const struct bvrect *rects)
+{
+    enum bverror err;
+
+    if (!fence_blt) {
+        bp->flags &= ~BVFLAG_ASYNC;
+        return bv_fill(bp, count, rects);
+    }
+
+    /* gcbvfill has no fence of its own, the fence is signalled from its callback */
+    bp->flags |= BVFLAG_ASYNC;
+    bp->callbackfn = fence_signal;
+    bp->callbackdata = fence;
+    err = bv_fill(bp, count, rects);
+    bp->callbackfn = NULL;
+    bp->callbackdata = 0;
+    if (!err)
+        fence_pending++;
+    return err;
+}
+
+/*
+ * hw2d may use the buffers until the blits submitted are done, so they can't
+ * be unlocked or handed back before. Batches taking longer than
+ * FENCE_TIMEOUT_MS are reported and still waited for.
+ */
+static int wait_blits(void)
+{
+    int err = 0;
+
+    while (fence_pending > 0) {
+        int completed = fence_wait(fence, FENCE_TIMEOUT_MS);
+        if (completed == -EINTR)
+            continue;
+        if (completed < 0) {
+            ALOGE("Unable to wait for %u blits (%d)", fence_pending, completed);
+            return completed;
+        }
+        if (!completed) {
+            ALOGE("%u blits still running after %dms", fence_pending, FENCE_TIMEOUT_MS);
+            err = -ETIME;
+            continue;
+        }
+        fence_pending -= (uint32_t)completed < fence_pending ? (uint32_t)completed : fence_pending;
+    }
+    return err;
+}
+
+static void unlock_buffers(void)
+{
+    while (nlocked > 0) {
+        nlocked--;
+        gralloc->unlock(gralloc, locked_hndls[nlocked]);
+    }
+}
+
+static int lock_buffer(buffer_handle_t handle, int usage, void **addr)
+{
+    IMG_native_handle_t *h = (IMG_native_handle_t *)handle;
+
+    if (gralloc->lock(gralloc, handle, usage, 0, 0, h->iWidth, h->iHeight, addr)) {
+        ALOGE("Unable to lock buffer %p", handle);
+        return -EINVAL;
+    }
+    locked_hndls[nlocked] = handle;
+    locked_addrs[nlocked++] = *addr;
+    return 0;
+}
+
+static int reserve_locks(uint32_t num)
+{
+    if (num <= locked_size)
+        return 0;
+
+    buffer_handle_t *hndls = realloc(locked_hndls, num * sizeof(*hndls));
+    if (hndls)
+        locked_hndls = hndls;
+    void **addrs = realloc(locked_addrs, num * sizeof(*addrs));
+    if (addrs)
+        locked_addrs = addrs;
+    if (!hndls || !addrs)
+        return -ENOMEM;
+    locked_size = num;
+    return 0;
+}
+
+static int reserve_layers(struct job *job, uint32_t num)
+{
+    if (num <= job->size)
+        return 0;
+
+    hwc_layer_1_t *layers = realloc(job->layers, num * sizeof(*layers));
+    if (!layers)
+        return -ENOMEM;
+    job->layers = layers;
+    job->size = num;
+    return 0;
+}
+
+/* Waits for the producer of a buffer and closes the fence */
+static int wait_fence(int *fd)
+{
+    int err = 0;
+
+    if (*fd < 0)
+        return 0;
+    if (sync_wait(*fd, FENCE_TIMEOUT_MS)) {
+        ALOGE("Timed out waiting for fence %d", *fd);
+        err = -ETIME;
+    }
+    close(*fd);
+    *fd = -1;
+    return err;
+}
+
+/* Closes the fences still open in the list, hwc owns the ones it is given */
+static void close_fences(hwc_display_contents_1_t *list)
+{
+    uint32_t i;
+
+    if (list->outbufAcquireFenceFd >= 0)
+        close(list->outbufAcquireFenceFd);
+    list->outbufAcquireFenceFd = -1;
+    for (i = 0; i < list->numHwLayers; i++) {
+        hwc_layer_1_t *layer = &list->hwLayers[i];
+        if (layer->acquireFenceFd >= 0)
+            close(layer->acquireFenceFd);
+        layer->acquireFenceFd = -1;
+    }
+}
+
+/* Forget the output buffer contents, the next frame redraws everything */
+static void reset_display(struct virtual_display *vd)
+{
+    rgz_release(&vd->rgz);
+    memset(vd->outbufs, 0, sizeof(vd->outbufs));
+}
+
+static void *compose_thread(void *data __unused);
+
+int virtual_display_init(void)
+{
+    const struct hw_module_t *module;
+    BVFN_GCFENCE_CREATE create_fence;
+
+    if (hw_get_module(GRALLOC_HARDWARE_MODULE_ID, &module))
+        return -ENOENT;
+    gralloc = (gralloc_module_t const *)module;
+
+    /* The CPU implementation still frees the SGX for the primary display */
+    bv_lib_name = BLTSVILLE_HW_LIB;
+    bv_lib = dlopen(bv_lib_name, RTLD_NOW);
+    if (!bv_lib) {
+        ALOGW("Unable to load %s: %s", bv_lib_name, dlerror());
+        bv_lib_name = BLTSVILLE_CPU_LIB;
+        bv_lib = dlopen(bv_lib_name, RTLD_NOW);
+    }
+    if (!bv_lib) {
+        ALOGE("Unable to load %s: %s", bv_lib_name, dlerror());
+        return -ENOENT;
+    }
+    bv_blt = (BVFN_BLT)dlsym(bv_lib, "bv_blt");
+    if (!bv_blt) {
+        ALOGE("Missing bv_blt in %s", bv_lib_name);
+        virtual_display_release();
+        return -ENOENT;
+    }
+
+    bv_fill = (BVFN_GCFILL)dlsym(bv_lib, "gcbvfill");
+
+    /* Fills signal the fence too, it is created up front for them */
+    create_fence = (BVFN_GCFENCE_CREATE)dlsym(bv_lib, "gcbvfence_create");
+    fence_blt = (BVFN_GCFENCE_BLT)dlsym(bv_lib, "gcbvfence_blt");
+    fence_signal = (BVFN_GCFENCE_SIGNAL)dlsym(bv_lib, "gcbvfence_signal");
+    fence_wait = (BVFN_GCFENCE_WAIT)dlsym(bv_lib, "gcbvfence_wait");
+    fence_destroy = (BVFN_GCFENCE_DESTROY)dlsym(bv_lib, "gcbvfence_destroy");
+    if (create_fence && fence_blt && fence_signal && fence_wait && fence_destroy)
+        fence = create_fence();
+    if (fence < 0)
+        fence_blt = NULL;
+
+    /* The kernel may lack the s/w sync timeline */
+    stop = false;
+    timeline = sw_sync_timeline_create();
+    if (timeline >= 0 && pthread_create(&thread, NULL, compose_thread, NULL)) {
+        close(timeline);
+        timeline = -1;
+    }
+    threaded = timeline >= 0;
+
+    ALOGI("virtual displays composed with %s%s%s", bv_lib_name,
+          fence_blt ? ", asynchronously" : "", threaded ? ", behind fences" : "");
+    return 0;
+}
+
+void virtual_display_prepare(omap_hwc_device_t *hwc_dev, int disp, hwc_display_contents_1_t *list)
+{
+    struct virtual_display *vd = &displays[disp];
+    struct bvsurfgeom geom;
+    uint32_t i, num_layers;
+
+    if (!list || !list->numHwLayers) {
+        /* The display is gone, a new one may reuse the slot */
+        if (!list) {
+            vd->reset = true;
+            vd->blit = false;
+        }
+        return;
+    }
+
+    /* The framebuffer target is last */
+    num_layers = list->numHwLayers - 1;
+    vd->blit = false;
+    vd->fb_layers = num_layers;
+
+    if (bv_blt && hwc_dev->blt_policy != BLTPOLICY_DISABLED &&
+            !rgz_get_buffergeometry(list->outbuf, &geom)) {
+        /* Blit everything above the topmost layer the blitter can't handle */
+        for (i = num_layers; i > 0; i--) {
+            if (!can_blit(&list->hwLayers[i - 1]))
+                break;
+        }
+        vd->fb_layers = i;
+        vd->blit = vd->fb_layers < num_layers;
+    }
+
+    for (i = 0; i < num_layers; i++) {
+        hwc_layer_1_t *layer = &list->hwLayers[i];
+        layer->compositionType = i < vd->fb_layers ? HWC_FRAMEBUFFER : HWC_OVERLAY;
+    }
+}
+
+/* Takes the layers to blit and their fences from the list */
+static int get_job(struct virtual_display *vd, struct job *job, hwc_display_contents_1_t *list)
+{
+    hwc_layer_1_t *fb_target = &list->hwLayers[list->numHwLayers - 1];
+    uint32_t i;
+
+    job->num_layers = 0;
+    if (reserve_layers(job, list->numHwLayers))
+        return -ENOMEM;
+
+    /* The regionizer composes the layers marked for the framebuffer */
+    if (vd->fb_layers) {
+        job->layers[job->num_layers] = *fb_target;
+        /* Nothing is underneath but the cleared background */
+        job->layers[job->num_layers++].blending = HWC_BLENDING_NONE;
+        fb_target->acquireFenceFd = -1;
+    }
+    for (i = vd->fb_layers; i < list->numHwLayers - 1; i++) {
+        job->layers[job->num_layers++] = list->hwLayers[i];
+        list->hwLayers[i].acquireFenceFd = -1;
+    }
+    for (i = 0; i < job->num_layers; i++) {
+        job->layers[i].compositionType = HWC_FRAMEBUFFER;
+        job->layers[i].hints = 0;
+    }
+
+    job->outbuf_fence = list->outbufAcquireFenceFd;
+    list->outbufAcquireFenceFd = -1;
+    /* Nothing else is read, e.g. a framebuffer target GLES drew nothing into */
+    close_fences(list);
+    return 0;
+}
+
+static void put_job(struct job *job)
+{
+    uint32_t i;
+
+    if (job->outbuf_fence >= 0)
+        close(job->outbuf_fence);
+    job->outbuf_fence = -1;
+    for (i = 0; i < job->num_layers; i++) {
+        if (job->layers[i].acquireFenceFd >= 0)
+            close(job->layers[i].acquireFenceFd);
+        job->layers[i].acquireFenceFd = -1;
+    }
+}
+
+/* Closes every fence even if one times out, the job owns them */
+static int wait_fences(struct job *job)
+{
+    uint32_t i;
+    int err = 0;
+
+    if (wait_fence(&job->outbuf_fence))
+        err = -ETIME;
+    for (i = 0; i < job->num_layers; i++) {
+        if (wait_fence(&job->layers[i].acquireFenceFd))
+            err = -ETIME;
+    }
+    return err;
+}
+
+static int compose(struct virtual_display *vd, struct job *job)
+{
+    struct bvsurfgeom geom;
+    struct bvbuffdesc desc = { .structsize = sizeof(desc) };
+    uint32_t i;
+    int err = 0, blits_err;
+
+    if (rgz_get_buffergeometry(job->outbuf, &geom))
+        return -EINVAL;
+    if (reserve_locks(job->num_layers + 1))
+        return -ENOMEM;
+
+    desc.length = geom.virtstride * geom.height;
+    err = lock_buffer(job->outbuf, GRALLOC_USAGE_SW_WRITE_OFTEN, &desc.virtaddr);
+    for (i = 0; i < job->num_layers && !err; i++) {
+        void *addr;
+        err = lock_buffer(job->layers[i].handle, GRALLOC_USAGE_SW_READ_OFTEN, &addr);
+    }
+    if (err)
+        goto out;
+
+    /*
+     * Damage is tracked against the frame composed RGZ_NUM_FB frames ago, the
+     * output buffer has to be that one and not written since
+     */
+    buffer_handle_t *outbuf = &vd->outbufs[vd->frame % RGZ_NUM_FB];
+    bool tracked = *outbuf == job->outbuf && vd->width == geom.width && vd->height == geom.height;
+    for (i = 1; i < RGZ_NUM_FB; i++)
+        tracked = tracked && vd->outbufs[(vd->frame + i) % RGZ_NUM_FB] != job->outbuf;
+
+    rgz_in_params_t in = {
+        .op = RGZ_IN_HWC,
+        .data = {
+            .hwc = {
+                .flags = tracked ? 0 : RGZ_IN_HWC_REDRAW,
+                .dstgeom = &geom,
+                .layers = job->layers,
+                .layerno = job->num_layers,
+            }
+        }
+    };
+    if (rgz_in(&in, &vd->rgz) != RGZ_ALL) {
+        err = -EINVAL;
+        goto out;
+    }
+
+    rgz_out_params_t out = {
+        .op = RGZ_OUT_BVDIRECT_REGION,
+        .data = {
+            .bv = {
+                .dstdesc = &desc,
+                .dstgeom = &geom,
+                .bv_blt = submit_blt,
+                .bv_fill = bv_fill ? submit_fill : NULL,
+                .get_buffdesc = get_buffdesc,
+            }
+        }
+    };
+    err = rgz_out(&vd->rgz, &out);
+    if (!err) {
+        /* Only a frame written in full can be tracked against */
+        *outbuf = job->outbuf;
+        vd->frame++;
+    }
+
+    pthread_mutex_lock(&lock);
+    if (!err) {
+        vd->redraws += !tracked;
+        vd->blits += out.data.bv.out_blits;
+        vd->pixels += out.data.bv.out_pixels;
+    }
+    vd->width = geom.width;
+    vd->height = geom.height;
+    pthread_mutex_unlock(&lock);
+
+out:
+    blits_err = wait_blits();
+    if (blits_err && blits_err != -ETIME) {
+        /*
+         * hw2d may still use the buffers, they stay locked and the next
+         * frames are blitted synchronously
+         */
+        nlocked = 0;
+        fence_pending = 0;
+        fence_blt = NULL;
+    }
+    unlock_buffers();
+    return err ? err : blits_err;
+}
+
+static void run_job(struct job *job)
+{
+    struct virtual_display *vd = &displays[job->disp];
+    nsecs_t start, time;
+    int err, i;
+
+    if (job->reset)
+        reset_display(vd);
+
+    if (!job->compose) {
+        /* GLES wrote the output buffer, its contents are unknown */
+        for (i = 0; i < RGZ_NUM_FB; i++) {
+            if (vd->outbufs[i] == job->outbuf)
+                vd->outbufs[i] = NULL;
+        }
+        return;
+    }
+
+    /* The compose time leaves out the wait for the producers */
+    err = wait_fences(job);
+    start = systemTime(SYSTEM_TIME_MONOTONIC);
+    if (!err)
+        err = compose(vd, job);
+    time = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+    put_job(job);
+
+    pthread_mutex_lock(&lock);
+    if (err) {
+        vd->failures++;
+    } else {
+        vd->compose_time += time;
+        if (time > vd->max_compose_time)
+            vd->max_compose_time = time;
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (err) {
+        ALOGE("Virtual display %d composition failed (%d)", job->disp, err);
+        reset_display(vd);
+    }
+}
+
+static void *compose_thread(void *data __unused)
+{
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        while (!stop && jobs_done == jobs_queued)
+            pthread_cond_wait(&cond, &lock);
+        if (jobs_done == jobs_queued)
+            break;
+        pthread_mutex_unlock(&lock);
+
+        run_job(&jobs[jobs_done % MAX_JOBS]);
+        sw_sync_timeline_inc(timeline, 1);
+
+        pthread_mutex_lock(&lock);
+        jobs_done++;
+        pthread_cond_broadcast(&cond);
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+int virtual_display_set(omap_hwc_device_t *hwc_dev __unused, int disp, hwc_display_contents_1_t *list)
+{
+    struct virtual_display *vd = &displays[disp];
+    hwc_layer_1_t *fb_target;
+    struct job *job;
+    int err, retire = -1;
+    uint32_t i, seqno;
+
+    if (!list || !list->numHwLayers)
+        return 0;
+
+    fb_target = &list->hwLayers[list->numHwLayers - 1];
+
+    /* Back-pressure once the composition thread is MAX_JOBS frames behind */
+    pthread_mutex_lock(&lock);
+    vd->frames++;
+    if (!vd->blit)
+        vd->gles_frames++;
+    while (jobs_queued - jobs_done == MAX_JOBS)
+        pthread_cond_wait(&cond, &lock);
+    job = &jobs[jobs_queued % MAX_JOBS];
+    pthread_mutex_unlock(&lock);
+
+    job->disp = disp;
+    job->reset = vd->reset;
+    job->compose = vd->blit;
+    job->outbuf = list->outbuf;
+    job->outbuf_fence = -1;
+    job->num_layers = 0;
+    if (!vd->blit) {
+        /*
+         * GLES rendered straight into the output buffer, which is written
+         * once the framebuffer target is ready
+         */
+        list->retireFenceFd = fb_target->acquireFenceFd >= 0 ? dup(fb_target->acquireFenceFd) : -1;
+        close_fences(list);
+    } else if ((err = get_job(vd, job, list))) {
+        close_fences(list);
+        pthread_mutex_lock(&lock);
+        vd->failures++;
+        pthread_mutex_unlock(&lock);
+        return err;
+    }
+    vd->reset = false;
+
+    if (!threaded) {
+        /* The blits are done when the job returns, no fences to hand back */
+        run_job(job);
+        pthread_mutex_lock(&lock);
+        jobs_queued++;
+        jobs_done++;
+        pthread_mutex_unlock(&lock);
+        return 0;
+    }
+
+    pthread_mutex_lock(&lock);
+    seqno = ++jobs_queued;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&lock);
+    if (!job->compose)
+        return 0;
+
+    /*
+     * The output buffer is written and the layers are read until the
+     * composition thread signals the frame
+     */
+    retire = sw_sync_fence_create(timeline, "hwc_virtual", seqno);
+    if (retire < 0) {
+        ALOGE("Unable to create the fence of virtual display %d (%d)", disp, retire);
+        pthread_mutex_lock(&lock);
+        while (jobs_done < seqno)
+            pthread_cond_wait(&cond, &lock);
+        pthread_mutex_unlock(&lock);
+        return 0;
+    }
+    list->retireFenceFd = retire;
+    if (vd->fb_layers)
+        fb_target->releaseFenceFd = dup(retire);
+    for (i = vd->fb_layers; i < list->numHwLayers - 1; i++)
+        list->hwLayers[i].releaseFenceFd = dup(retire);
+    return 0;
+}
+
+int virtual_display_dump(char *buff, int buff_len)
+{
+    int len = 0, i;
+
+#define dump(...) \
+    len += snprintf(buff + len, len < buff_len ? buff_len - len : 0, __VA_ARGS__)
+
+    pthread_mutex_lock(&lock);
+    for (i = 0; i < MAX_DISPLAYS; i++) {
+        struct virtual_display *vd = &displays[i];
+        uint32_t blitted = vd->frames - vd->gles_frames - vd->failures;
+
+        if (!vd->frames)
+            continue;
+        dump("  virtual display %d: %ux%u, %u frames, %u GLES only, %u failed\n",
+             i, vd->width, vd->height, vd->frames, vd->gles_frames, vd->failures);
+        if (!blitted)
+            continue;
+        dump("    blitted with %s%s: %u redrawn, %llu blits %llu pixels per frame, "
+             "compose avg %lldus max %lldus\n", bv_lib_name, threaded ? " behind fences" : "",
+             vd->redraws, (unsigned long long)(vd->blits / blitted),
+             (unsigned long long)(vd->pixels / blitted),
+             (long long)ns2us(vd->compose_time / blitted), (long long)ns2us(vd->max_compose_time));
+    }
+    pthread_mutex_unlock(&lock);
+#undef dump
+
+    return len;
+}
+
+void virtual_display_release(void)
+{
+    int i;
+
+    if (threaded) {
+        /* The frames queued are composed first */
+        pthread_mutex_lock(&lock);
+        stop = true;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&lock);
+        pthread_join(thread, NULL);
+        threaded = false;
+    }
+    if (timeline >= 0)
+        close(timeline);
+    timeline = -1;
+
+    for (i = 0; i < MAX_DISPLAYS; i++)
+        reset_display(&displays[i]);
+    memset(displays, 0, sizeof(displays));
+    for (i = 0; i < MAX_JOBS; i++)
+        free(jobs[i].layers);
+    memset(jobs, 0, sizeof(jobs));
+    jobs_queued = jobs_done = 0;
+
+    free(locked_hndls);
+    free(locked_addrs);
+    locked_hndls = NULL;
+    locked_addrs = NULL;
+    locked_size = 0;
+
+    if (fence >= 0)
+        fence_destroy(fence);
+    fence = -1;
+    fence_pending = 0;
+    fence_blt = NULL;
+
+    if (bv_lib)
+        dlclose(bv_lib);
+    bv_lib = NULL;
+    bv_blt = NULL;
+    bv_fill = NULL;
+}
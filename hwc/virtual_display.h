@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __VIRTUAL_DISPLAY__
+#define __VIRTUAL_DISPLAY__
+
+#include <hardware/hwcomposer.h>
+
+/*
+ * Virtual display composition with the 2D blitter, enabled with
+ * OMAP_ENHANCEMENT_HWC_VIRTUAL_DISPLAY
+ *
+ * Layers above the topmost one the regionizer can't blit are composed into
+ * the output buffer with BLTsville, the rest is left to GLES and the
+ * framebuffer target is blitted underneath. Each display has its own
+ * regionizer state, so only the damaged area is redrawn while the output
+ * buffers rotate like the framebuffer does.
+ *
+ * virtual_display_prepare is called with the hwc lock held,
+ * virtual_display_set without it. The frames are composed on a thread once
+ * their buffers are ready, and the retire fence set returns signals the
+ * output buffer written and the layers read. Without the s/w sync timeline
+ * of libsync, set composes the frame before returning.
+ */
+
+typedef struct omap_hwc_device omap_hwc_device_t;
+
+int virtual_display_init(void);
+void virtual_display_prepare(omap_hwc_device_t *hwc_dev, int disp, hwc_display_contents_1_t *list);
+int virtual_display_set(omap_hwc_device_t *hwc_dev, int disp, hwc_display_contents_1_t *list);
+/* Returns the length written, like snprintf */
+int virtual_display_dump(char *buff, int buff_len);
+void virtual_display_release(void);
+
+#endif